@@ -0,0 +1,475 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusBenchmark.h"
+
+// IGSIO includes
+#include <vtkIGSIOAccurateTimer.h>
+
+// VTK includes
+#include <vtksys/RegularExpression.hxx>
+#include <vtksys/SystemInformation.hxx>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+  /*! The number of iterations is not increased above this limit, even if the minimum time is not reached */
+  const long long MAX_NUMBER_OF_ITERATIONS = 1000000000LL;
+  /*! Width of the benchmark name column in the console output */
+  const int NAME_COLUMN_WIDTH = 56;
+}
+
+//----------------------------------------------------------------------------
+PlusBenchmark::PlusBenchmark(const std::string& name)
+  : Name(name)
+  , ItemsPerIteration(0)
+  , BytesPerIteration(0)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusBenchmark::~PlusBenchmark()
+{
+}
+
+//----------------------------------------------------------------------------
+const std::string& PlusBenchmark::GetName() const
+{
+  return this->Name;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusBenchmark::SetUp()
+{
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusBenchmark::TearDown()
+{
+}
+
+//----------------------------------------------------------------------------
+double PlusBenchmark::GetItemsPerIteration() const
+{
+  return this->ItemsPerIteration;
+}
+
+//----------------------------------------------------------------------------
+double PlusBenchmark::GetBytesPerIteration() const
+{
+  return this->BytesPerIteration;
+}
+
+//----------------------------------------------------------------------------
+void PlusBenchmark::SetItemsPerIteration(double items)
+{
+  this->ItemsPerIteration = items;
+}
+
+//----------------------------------------------------------------------------
+void PlusBenchmark::SetBytesPerIteration(double bytes)
+{
+  this->BytesPerIteration = bytes;
+}
+
+//----------------------------------------------------------------------------
+PlusBenchmarkRunner::Result::Result()
+  : RepetitionIndex(0)
+  , Iterations(0)
+  , RealTimeSec(0)
+  , CpuTimeSec(0)
+  , ItemsPerSecond(0)
+  , BytesPerSecond(0)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusBenchmarkRunner::PlusBenchmarkRunner()
+  : MinimumTimeSec(0.5)
+  , NumberOfRepetitions(1)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusBenchmarkRunner::~PlusBenchmarkRunner()
+{
+}
+
+//----------------------------------------------------------------------------
+void PlusBenchmarkRunner::AddBenchmark(const std::shared_ptr<PlusBenchmark>& benchmark)
+{
+  this->Benchmarks.push_back(benchmark);
+}
+
+//----------------------------------------------------------------------------
+void PlusBenchmarkRunner::SetFilter(const std::string& filter)
+{
+  this->Filter = filter;
+}
+
+//----------------------------------------------------------------------------
+void PlusBenchmarkRunner::SetMinimumTimeSec(double minimumTimeSec)
+{
+  this->MinimumTimeSec = minimumTimeSec;
+}
+
+//----------------------------------------------------------------------------
+void PlusBenchmarkRunner::SetNumberOfRepetitions(int numberOfRepetitions)
+{
+  this->NumberOfRepetitions = std::max(numberOfRepetitions, 1);
+}
+
+//----------------------------------------------------------------------------
+void PlusBenchmarkRunner::SetExecutableName(const std::string& executableName)
+{
+  this->ExecutableName = executableName;
+}
+
+//----------------------------------------------------------------------------
+const std::vector<PlusBenchmarkRunner::Result>& PlusBenchmarkRunner::GetResults() const
+{
+  return this->Results;
+}
+
+//----------------------------------------------------------------------------
+bool PlusBenchmarkRunner::IsSelected(const PlusBenchmark& benchmark) const
+{
+  if (this->Filter.empty())
+  {
+    return true;
+  }
+  vtksys::RegularExpression filter(this->Filter.c_str());
+  return filter.find(benchmark.GetName());
+}
+
+//----------------------------------------------------------------------------
+void PlusBenchmarkRunner::PrintBenchmarkNames(std::ostream& os) const
+{
+  for (std::vector<std::shared_ptr<PlusBenchmark> >::const_iterator it = this->Benchmarks.begin(); it != this->Benchmarks.end(); ++it)
+  {
+    if (this->IsSelected(**it))
+    {
+      os << (*it)->GetName() << std::endl;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusBenchmarkRunner::Run()
+{
+  if (!this->Filter.empty())
+  {
+    vtksys::RegularExpression filter;
+    if (!filter.compile(this->Filter.c_str()))
+    {
+      LOG_ERROR("Invalid benchmark filter: " << this->Filter);
+      return PLUS_FAIL;
+    }
+  }
+
+  this->Results.clear();
+  std::cout << std::left << std::setw(NAME_COLUMN_WIDTH) << "Benchmark" << std::right << std::setw(14) << "Time" << std::setw(14) << "CPU" << std::setw(14) << "Iterations" << std::endl;
+  std::cout << std::string(NAME_COLUMN_WIDTH + 3 * 14, '-') << std::endl;
+
+  int numberOfFailedBenchmarks = 0;
+  for (std::vector<std::shared_ptr<PlusBenchmark> >::iterator it = this->Benchmarks.begin(); it != this->Benchmarks.end(); ++it)
+  {
+    if (!this->IsSelected(**it))
+    {
+      continue;
+    }
+    if (this->RunBenchmark(**it) != PLUS_SUCCESS)
+    {
+      numberOfFailedBenchmarks++;
+    }
+  }
+
+  if (numberOfFailedBenchmarks > 0)
+  {
+    LOG_ERROR(numberOfFailedBenchmarks << " benchmark(s) failed");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusBenchmarkRunner::RunBenchmark(PlusBenchmark& benchmark)
+{
+  LOG_DEBUG("Set up benchmark " << benchmark.GetName());
+  if (benchmark.SetUp() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to set up benchmark " << benchmark.GetName());
+    benchmark.TearDown();
+    return PLUS_FAIL;
+  }
+
+  // Find the number of iterations that takes at least the minimum time.
+  // The last measurement is used as the first repetition.
+  long long iterations = 1;
+  double realTimeSec = 0;
+  double cpuTimeSec = 0;
+  while (1)
+  {
+    if (this->MeasureIterations(benchmark, iterations, realTimeSec, cpuTimeSec) != PLUS_SUCCESS)
+    {
+      benchmark.TearDown();
+      return PLUS_FAIL;
+    }
+    if (realTimeSec >= this->MinimumTimeSec || iterations >= MAX_NUMBER_OF_ITERATIONS)
+    {
+      break;
+    }
+    // Overshoot the minimum time a bit to avoid an extra round, but do not increase too fast based on a too short measurement
+    double multiplier = (realTimeSec > 0 ? this->MinimumTimeSec * 1.4 / realTimeSec : 10.0);
+    multiplier = std::min(std::max(multiplier, 1.0), 10.0);
+    iterations = std::min(std::max(static_cast<long long>(iterations * multiplier), iterations + 1), MAX_NUMBER_OF_ITERATIONS);
+  }
+
+  std::vector<Result> repetitions;
+  for (int repetitionIndex = 0; repetitionIndex < this->NumberOfRepetitions; ++repetitionIndex)
+  {
+    if (repetitionIndex > 0 && this->MeasureIterations(benchmark, iterations, realTimeSec, cpuTimeSec) != PLUS_SUCCESS)
+    {
+      benchmark.TearDown();
+      return PLUS_FAIL;
+    }
+    Result result;
+    result.Name = benchmark.GetName();
+    result.RepetitionIndex = repetitionIndex;
+    result.Iterations = iterations;
+    result.RealTimeSec = realTimeSec / iterations;
+    result.CpuTimeSec = cpuTimeSec / iterations;
+    if (realTimeSec > 0)
+    {
+      result.ItemsPerSecond = benchmark.GetItemsPerIteration() * iterations / realTimeSec;
+      result.BytesPerSecond = benchmark.GetBytesPerIteration() * iterations / realTimeSec;
+    }
+    this->PrintResult(result);
+    this->Results.push_back(result);
+    repetitions.push_back(result);
+  }
+  if (repetitions.size() > 1)
+  {
+    this->AddAggregateResults(repetitions);
+  }
+
+  benchmark.TearDown();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusBenchmarkRunner::MeasureIterations(PlusBenchmark& benchmark, long long iterations, double& realTimeSec, double& cpuTimeSec)
+{
+  std::clock_t startCpuTime = std::clock();
+  double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  for (long long i = 0; i < iterations; ++i)
+  {
+    if (benchmark.RunIteration() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Benchmark " << benchmark.GetName() << " failed in iteration " << i);
+      return PLUS_FAIL;
+    }
+  }
+  realTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+  cpuTimeSec = static_cast<double>(std::clock() - startCpuTime) / CLOCKS_PER_SEC;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusBenchmarkRunner::AddAggregateResults(const std::vector<Result>& repetitions)
+{
+  const int n = static_cast<int>(repetitions.size());
+  std::vector<double> realTimes;
+  std::vector<double> cpuTimes;
+  for (std::vector<Result>::const_iterator it = repetitions.begin(); it != repetitions.end(); ++it)
+  {
+    realTimes.push_back(it->RealTimeSec);
+    cpuTimes.push_back(it->CpuTimeSec);
+  }
+
+  Result mean;
+  for (std::vector<Result>::const_iterator it = repetitions.begin(); it != repetitions.end(); ++it)
+  {
+    mean.RealTimeSec += it->RealTimeSec / n;
+    mean.CpuTimeSec += it->CpuTimeSec / n;
+    mean.ItemsPerSecond += it->ItemsPerSecond / n;
+    mean.BytesPerSecond += it->BytesPerSecond / n;
+  }
+
+  Result median;
+  std::sort(realTimes.begin(), realTimes.end());
+  std::sort(cpuTimes.begin(), cpuTimes.end());
+  median.RealTimeSec = (n % 2 == 1 ? realTimes[n / 2] : (realTimes[n / 2 - 1] + realTimes[n / 2]) / 2);
+  median.CpuTimeSec = (n % 2 == 1 ? cpuTimes[n / 2] : (cpuTimes[n / 2 - 1] + cpuTimes[n / 2]) / 2);
+
+  Result stddev;
+  for (std::vector<Result>::const_iterator it = repetitions.begin(); it != repetitions.end(); ++it)
+  {
+    stddev.RealTimeSec += (it->RealTimeSec - mean.RealTimeSec) * (it->RealTimeSec - mean.RealTimeSec);
+    stddev.CpuTimeSec += (it->CpuTimeSec - mean.CpuTimeSec) * (it->CpuTimeSec - mean.CpuTimeSec);
+  }
+  stddev.RealTimeSec = std::sqrt(stddev.RealTimeSec / (n - 1));
+  stddev.CpuTimeSec = std::sqrt(stddev.CpuTimeSec / (n - 1));
+
+  mean.AggregateName = "mean";
+  median.AggregateName = "median";
+  stddev.AggregateName = "stddev";
+  Result* aggregates[] = { &mean, &median, &stddev };
+  for (int i = 0; i < 3; ++i)
+  {
+    aggregates[i]->Name = repetitions[0].Name;
+    aggregates[i]->Iterations = n;
+    this->PrintResult(*aggregates[i]);
+    this->Results.push_back(*aggregates[i]);
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusBenchmarkRunner::PrintResult(const Result& result) const
+{
+  std::string name = result.Name;
+  if (!result.AggregateName.empty())
+  {
+    name += "_" + result.AggregateName;
+  }
+  std::cout << std::left << std::setw(NAME_COLUMN_WIDTH) << name << std::right << std::fixed << std::setprecision(3)
+            << std::setw(11) << result.RealTimeSec * 1e6 << " us"
+            << std::setw(11) << result.CpuTimeSec * 1e6 << " us"
+            << std::setw(14) << result.Iterations;
+  if (result.ItemsPerSecond > 0)
+  {
+    std::cout << "  " << std::setprecision(1) << result.ItemsPerSecond << " items/s";
+  }
+  if (result.BytesPerSecond > 0)
+  {
+    std::cout << "  " << std::setprecision(1) << result.BytesPerSecond / (1024 * 1024) << " MiB/s";
+  }
+  std::cout << std::defaultfloat << std::setprecision(6) << std::endl;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusBenchmarkRunner::WriteResultsToJsonFile(const std::string& fileName) const
+{
+  std::ofstream file(fileName.c_str());
+  if (!file.is_open())
+  {
+    LOG_ERROR("Failed to open benchmark result file for writing: " << fileName);
+    return PLUS_FAIL;
+  }
+
+  vtksys::SystemInformation systemInformation;
+  systemInformation.RunCPUCheck();
+  systemInformation.RunOSCheck();
+
+  char dateStr[64] = "";
+  std::time_t now = std::time(NULL);
+  std::strftime(dateStr, sizeof(dateStr), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+  file << std::setprecision(12);
+  file << "{" << std::endl;
+  file << "  \"context\": {" << std::endl;
+  file << "    \"date\": \"" << dateStr << "\"," << std::endl;
+  file << "    \"host_name\": \"" << EscapeJsonString(systemInformation.GetHostname()) << "\"," << std::endl;
+  file << "    \"executable\": \"" << EscapeJsonString(this->ExecutableName) << "\"," << std::endl;
+  file << "    \"num_cpus\": " << systemInformation.GetNumberOfLogicalCPU() << "," << std::endl;
+  file << "    \"mhz_per_cpu\": " << static_cast<int>(systemInformation.GetProcessorClockFrequency()) << "," << std::endl;
+  file << "    \"plus_version\": \"" << EscapeJsonString(PlusCommon::GetPlusLibVersionString()) << "\"," << std::endl;
+#ifdef NDEBUG
+  file << "    \"library_build_type\": \"release\"" << std::endl;
+#else
+  file << "    \"library_build_type\": \"debug\"" << std::endl;
+#endif
+  file << "  }," << std::endl;
+  file << "  \"benchmarks\": [" << std::endl;
+  for (std::vector<Result>::const_iterator it = this->Results.begin(); it != this->Results.end(); ++it)
+  {
+    bool isAggregate = !it->AggregateName.empty();
+    std::string name = it->Name + (isAggregate ? "_" + it->AggregateName : std::string());
+    file << "    {" << std::endl;
+    file << "      \"name\": \"" << EscapeJsonString(name) << "\"," << std::endl;
+    file << "      \"run_name\": \"" << EscapeJsonString(it->Name) << "\"," << std::endl;
+    file << "      \"run_type\": \"" << (isAggregate ? "aggregate" : "iteration") << "\"," << std::endl;
+    file << "      \"repetitions\": " << this->NumberOfRepetitions << "," << std::endl;
+    if (isAggregate)
+    {
+      file << "      \"aggregate_name\": \"" << it->AggregateName << "\"," << std::endl;
+    }
+    else
+    {
+      file << "      \"repetition_index\": " << it->RepetitionIndex << "," << std::endl;
+    }
+    file << "      \"iterations\": " << it->Iterations << "," << std::endl;
+    file << "      \"real_time\": " << it->RealTimeSec * 1e6 << "," << std::endl;
+    file << "      \"cpu_time\": " << it->CpuTimeSec * 1e6 << "," << std::endl;
+    file << "      \"time_unit\": \"us\"";
+    if (it->ItemsPerSecond > 0)
+    {
+      file << "," << std::endl << "      \"items_per_second\": " << it->ItemsPerSecond;
+    }
+    if (it->BytesPerSecond > 0)
+    {
+      file << "," << std::endl << "      \"bytes_per_second\": " << it->BytesPerSecond;
+    }
+    file << std::endl << "    }" << (it + 1 != this->Results.end() ? "," : "") << std::endl;
+  }
+  file << "  ]" << std::endl;
+  file << "}" << std::endl;
+
+  if (file.fail())
+  {
+    LOG_ERROR("Failed to write benchmark result file: " << fileName);
+    return PLUS_FAIL;
+  }
+  LOG_INFO("Benchmark results are written to " << fileName);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+std::string PlusBenchmarkRunner::EscapeJsonString(const std::string& str)
+{
+  std::ostringstream escaped;
+  for (std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+  {
+    switch (*it)
+    {
+      case '"':
+        escaped << "\\\"";
+        break;
+      case '\\':
+        escaped << "\\\\";
+        break;
+      case '\n':
+        escaped << "\\n";
+        break;
+      case '\r':
+        escaped << "\\r";
+        break;
+      case '\t':
+        escaped << "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(*it) < 0x20)
+        {
+          escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(*it) << std::dec << std::setfill(' ');
+        }
+        else
+        {
+          escaped << *it;
+        }
+    }
+  }
+  return escaped.str();
+}
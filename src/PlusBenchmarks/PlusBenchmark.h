@@ -0,0 +1,147 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusBenchmark_h
+#define __PlusBenchmark_h
+
+#include "PlusConfigure.h"
+
+// STL includes
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*!
+  \class PlusBenchmark
+  \brief Base class of the benchmarks that are run by PlusBenchmarkRunner
+
+  SetUp is called once before the measurement, it prepares the input data and it is not timed.
+  RunIteration is called repeatedly and only the time spent in it is measured.
+  A benchmark that processes items (frames, transforms, messages) or bytes in each iteration
+  may set the number of items or bytes per iteration, so that the throughput is reported as well.
+
+  \ingroup PlusLibBenchmarks
+*/
+class PlusBenchmark
+{
+public:
+  PlusBenchmark(const std::string& name);
+  virtual ~PlusBenchmark();
+
+  /*! Name of the benchmark, in Group/Operation/Variant form */
+  const std::string& GetName() const;
+
+  /*! Prepare the benchmark. If it fails then the benchmark is not measured and the run fails after the remaining benchmarks. */
+  virtual PlusStatus SetUp();
+
+  /*! Execute the measured operation once */
+  virtual PlusStatus RunIteration() = 0;
+
+  /*! Release the resources allocated in SetUp */
+  virtual void TearDown();
+
+  /*! Number of items processed in one iteration, 0 if throughput is not reported */
+  double GetItemsPerIteration() const;
+
+  /*! Number of bytes processed in one iteration, 0 if throughput is not reported */
+  double GetBytesPerIteration() const;
+
+protected:
+  void SetItemsPerIteration(double items);
+  void SetBytesPerIteration(double bytes);
+
+  std::string Name;
+  double ItemsPerIteration;
+  double BytesPerIteration;
+};
+
+/*!
+  \class PlusBenchmarkRunner
+  \brief Runs benchmarks and reports the results on the console and in a JSON file
+
+  Each benchmark is run with an increasing number of iterations until the measurement takes at least
+  MinimumTimeSec, then the measurement is repeated NumberOfRepetitions times with the same number of iterations.
+  The JSON file uses the Google Benchmark output format, so the results can be compared and tracked over time
+  with the same tools.
+
+  \ingroup PlusLibBenchmarks
+*/
+class PlusBenchmarkRunner
+{
+public:
+  /*! Result of a repetition or an aggregate of the repetitions of a benchmark */
+  struct Result
+  {
+    Result();
+    std::string Name;
+    /*! Empty for repetitions, mean, median, or stddev for aggregates */
+    std::string AggregateName;
+    int RepetitionIndex;
+    long long Iterations;
+    /*! Elapsed wall clock time per iteration */
+    double RealTimeSec;
+    /*! Process CPU time per iteration */
+    double CpuTimeSec;
+    double ItemsPerSecond;
+    double BytesPerSecond;
+  };
+
+  PlusBenchmarkRunner();
+  virtual ~PlusBenchmarkRunner();
+
+  /*! Add a benchmark to be run */
+  void AddBenchmark(const std::shared_ptr<PlusBenchmark>& benchmark);
+
+  /*! Only the benchmarks with a name that matches this regular expression are run. All benchmarks are run if empty. */
+  void SetFilter(const std::string& filter);
+
+  /*! Minimum duration of the measurement of a benchmark */
+  void SetMinimumTimeSec(double minimumTimeSec);
+
+  /*! Number of times the measurement is repeated, mean, median, and standard deviation is reported if more than 1 */
+  void SetNumberOfRepetitions(int numberOfRepetitions);
+
+  /*! Name of the executable, reported in the context of the results */
+  void SetExecutableName(const std::string& executableName);
+
+  /*! Print the name of the benchmarks that would be run */
+  void PrintBenchmarkNames(std::ostream& os) const;
+
+  /*! Run the benchmarks. Returns PLUS_FAIL if any of the benchmarks failed. */
+  PlusStatus Run();
+
+  /*! Write the results in Google Benchmark JSON format */
+  PlusStatus WriteResultsToJsonFile(const std::string& fileName) const;
+
+  const std::vector<Result>& GetResults() const;
+
+protected:
+  /*! Returns true if the benchmark is selected by the filter */
+  bool IsSelected(const PlusBenchmark& benchmark) const;
+
+  /*! Set up, measure, and tear down a benchmark */
+  PlusStatus RunBenchmark(PlusBenchmark& benchmark);
+
+  /*! Execute the given number of iterations and measure the total elapsed time */
+  PlusStatus MeasureIterations(PlusBenchmark& benchmark, long long iterations, double& realTimeSec, double& cpuTimeSec);
+
+  /*! Add mean, median, and standard deviation of the repetitions of a benchmark */
+  void AddAggregateResults(const std::vector<Result>& repetitions);
+
+  void PrintResult(const Result& result) const;
+
+  static std::string EscapeJsonString(const std::string& str);
+
+  std::vector<std::shared_ptr<PlusBenchmark> > Benchmarks;
+  std::vector<Result> Results;
+  std::string Filter;
+  double MinimumTimeSec;
+  int NumberOfRepetitions;
+  std::string ExecutableName;
+};
+
+#endif
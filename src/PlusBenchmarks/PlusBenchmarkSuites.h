@@ -0,0 +1,48 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusBenchmarkSuites_h
+#define __PlusBenchmarkSuites_h
+
+#include "PlusBenchmark.h"
+
+class vtkIGSIOTrackedFrameList;
+class vtkXMLDataElement;
+
+/*!
+  \file PlusBenchmarkSuites.h
+  \brief Functions that add the benchmarks of the Plus modules to a benchmark runner
+
+  Benchmarks that use recorded data read the sequence files from the test data directory
+  and the configuration files from the configuration files directory of PlusLibData.
+
+  \ingroup PlusLibBenchmarks
+*/
+
+/*! Pixel encoding conversions of PixelCodec */
+void AddPixelCodecBenchmarks(PlusBenchmarkRunner& runner);
+
+/*! Adding items to and retrieving items from data source buffers, and tracked frame assembly in vtkPlusChannel */
+void AddDataCollectionBenchmarks(PlusBenchmarkRunner& runner);
+
+/*! RF to brightness conversion and scan conversion */
+void AddImageProcessingBenchmarks(PlusBenchmarkRunner& runner, const std::string& testDataDirectory, const std::string& configFilesDirectory);
+
+/*! Fiducial pattern recognition of calibration phantom images */
+void AddCalibrationBenchmarks(PlusBenchmarkRunner& runner, const std::string& testDataDirectory, const std::string& configFilesDirectory);
+
+/*! Ultrasound image simulation */
+void AddUsSimulatorBenchmarks(PlusBenchmarkRunner& runner, const std::string& testDataDirectory, const std::string& configFilesDirectory);
+
+/*! Read the device set configuration and the sequence file that are used as input of a benchmark */
+PlusStatus ReadBenchmarkInput(const std::string& configFilePath, const std::string& sequenceFilePath, vtkXMLDataElement* configRootElement, vtkIGSIOTrackedFrameList* trackedFrameList);
+
+#ifdef PLUS_USE_OpenIGTLink
+/*! Packing tracked frames into OpenIGTLink messages */
+void AddOpenIGTLinkBenchmarks(PlusBenchmarkRunner& runner);
+#endif
+
+#endif
@@ -0,0 +1,122 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusBenchmarks.cxx
+  \brief Measure the performance of the time-critical operations of the Plus modules
+
+  Benchmarks can be selected by a regular expression that is matched against the benchmark names.
+  Results are printed on the console and optionally written into a JSON file in Google Benchmark format.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusBenchmarkSuites.h"
+#include "vtkPlusSequenceIO.h"
+
+// IGSIO includes
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkXMLDataElement.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+//----------------------------------------------------------------------------
+PlusStatus ReadBenchmarkInput(const std::string& configFilePath, const std::string& sequenceFilePath, vtkXMLDataElement* configRootElement, vtkIGSIOTrackedFrameList* trackedFrameList)
+{
+  if (PlusXmlUtils::ReadDeviceSetConfigurationFromFile(configRootElement, configFilePath.c_str()) == PLUS_FAIL)
+  {
+    LOG_ERROR("Unable to read configuration from file " << configFilePath);
+    return PLUS_FAIL;
+  }
+  if (vtkPlusSequenceIO::Read(sequenceFilePath, trackedFrameList) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read sequence file: " << sequenceFilePath);
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  bool printHelp = false;
+  bool listBenchmarks = false;
+  std::string filter;
+  double minimumTimeSec = 0.5;
+  int numberOfRepetitions = 1;
+  std::string outputJsonFile;
+  std::string testDataDirectory;
+  std::string configFilesDirectory;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--list", vtksys::CommandLineArguments::NO_ARGUMENT, &listBenchmarks, "Print the names of the benchmarks and exit.");
+  args.AddArgument("--filter", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &filter, "Run only the benchmarks that have a name matching this regular expression (e.g., PixelCodec/.*)");
+  args.AddArgument("--min-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &minimumTimeSec, "Minimum duration of a measurement in seconds (default: 0.5)");
+  args.AddArgument("--repetitions", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfRepetitions, "Number of times each measurement is repeated. Mean, median, and standard deviation are reported if more than 1 (default: 1)");
+  args.AddArgument("--output-json-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputJsonFile, "Write the results into this JSON file in Google Benchmark format");
+  args.AddArgument("--test-data-dir", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &testDataDirectory, "Directory of the input sequence files (default: image directory of the Plus configuration)");
+  args.AddArgument("--config-files-dir", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &configFilesDirectory, "Directory of the device set configuration files (default: device set configuration directory of the Plus configuration)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (testDataDirectory.empty())
+  {
+    testDataDirectory = vtkPlusConfig::GetInstance()->GetImageDirectory();
+  }
+  if (configFilesDirectory.empty())
+  {
+    configFilesDirectory = vtkPlusConfig::GetInstance()->GetDeviceSetConfigurationDirectory();
+  }
+
+  PlusBenchmarkRunner runner;
+  runner.SetExecutableName(argv[0]);
+  runner.SetFilter(filter);
+  runner.SetMinimumTimeSec(minimumTimeSec);
+  runner.SetNumberOfRepetitions(numberOfRepetitions);
+
+  AddPixelCodecBenchmarks(runner);
+  AddDataCollectionBenchmarks(runner);
+  AddImageProcessingBenchmarks(runner, testDataDirectory, configFilesDirectory);
+  AddCalibrationBenchmarks(runner, testDataDirectory, configFilesDirectory);
+  AddUsSimulatorBenchmarks(runner, testDataDirectory, configFilesDirectory);
+#ifdef PLUS_USE_OpenIGTLink
+  AddOpenIGTLinkBenchmarks(runner);
+#endif
+
+  if (listBenchmarks)
+  {
+    runner.PrintBenchmarkNames(std::cout);
+    exit(EXIT_SUCCESS);
+  }
+
+  PlusStatus status = runner.Run();
+
+  if (!outputJsonFile.empty() && runner.WriteResultsToJsonFile(outputJsonFile) != PLUS_SUCCESS)
+  {
+    status = PLUS_FAIL;
+  }
+
+  return (status == PLUS_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,88 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusBenchmarkSuites.h"
+#include "PlusFidPatternRecognition.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkXMLDataElement.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  class PatternRecognitionBenchmark : public PlusBenchmark
+  {
+  public:
+    PatternRecognitionBenchmark(const std::string& name, const std::string& configFilePath, const std::string& sequenceFilePath)
+      : PlusBenchmark(name)
+      , ConfigFilePath(configFilePath)
+      , SequenceFilePath(sequenceFilePath)
+      , FrameIndex(0)
+    {
+      this->SetItemsPerIteration(1);
+    }
+
+    virtual PlusStatus SetUp()
+    {
+      vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+      this->Frames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+      if (ReadBenchmarkInput(this->ConfigFilePath, this->SequenceFilePath, configRootElement, this->Frames) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      if (this->Frames->GetNumberOfTrackedFrames() == 0)
+      {
+        LOG_ERROR("No frames in " << this->SequenceFilePath);
+        return PLUS_FAIL;
+      }
+      if (this->PatternRecognition.ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to read pattern recognition configuration from " << this->ConfigFilePath);
+        return PLUS_FAIL;
+      }
+      this->FrameIndex = 0;
+      return PLUS_SUCCESS;
+    }
+
+    virtual PlusStatus RunIteration()
+    {
+      unsigned int frameIndex = (this->FrameIndex++) % this->Frames->GetNumberOfTrackedFrames();
+      PlusPatternRecognitionResult result;
+      PlusFidPatternRecognition::PatternRecognitionError error;
+      // Pattern may not be found in all the frames, only processing errors are reported as failure
+      return this->PatternRecognition.RecognizePattern(this->Frames->GetTrackedFrame(frameIndex), result, error, frameIndex);
+    }
+
+    virtual void TearDown()
+    {
+      this->Frames = NULL;
+    }
+
+  protected:
+    std::string ConfigFilePath;
+    std::string SequenceFilePath;
+    PlusFidPatternRecognition PatternRecognition;
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> Frames;
+    unsigned int FrameIndex;
+  };
+}
+
+//----------------------------------------------------------------------------
+void AddCalibrationBenchmarks(PlusBenchmarkRunner& runner, const std::string& testDataDirectory, const std::string& configFilesDirectory)
+{
+  runner.AddBenchmark(std::make_shared<PatternRecognitionBenchmark>("FidPatternRecognition/6PointPhantom",
+                      configFilesDirectory + "/Testing/PlusDeviceSet_iCal_CalibrationOnly_SonixRP_Ulterius.xml",
+                      testDataDirectory + "/UsTestSeqBaselineThomasShortened.igs.mha"));
+  runner.AddBenchmark(std::make_shared<PatternRecognitionBenchmark>("FidPatternRecognition/3NWires",
+                      configFilesDirectory + "/Testing/PlusDeviceSet_fCal_Sim_SpatialCalibration_1.2.xml",
+                      testDataDirectory + "/fCal_Test_Calibration_3NWires.igs.mha"));
+}
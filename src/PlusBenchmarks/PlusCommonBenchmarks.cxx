@@ -0,0 +1,81 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PixelCodec.h"
+#include "PlusBenchmarkSuites.h"
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  class PixelCodecBenchmark : public PlusBenchmark
+  {
+  public:
+    /*! The input image is converted to gray if convertToGray is true, otherwise to 24-bit color with the specified component ordering */
+    PixelCodecBenchmark(const std::string& name, PixelCodec::PixelEncoding inputEncoding, int bytesPerInputPixel, bool convertToGray, PixelCodec::ComponentOrdering outputOrdering,
+                        int width, int height)
+      : PlusBenchmark(name)
+      , InputEncoding(inputEncoding)
+      , BytesPerInputPixel(bytesPerInputPixel)
+      , ConvertToGray(convertToGray)
+      , OutputOrdering(outputOrdering)
+      , Width(width)
+      , Height(height)
+    {
+      this->SetItemsPerIteration(1);
+      this->SetBytesPerIteration(static_cast<double>(width) * height * bytesPerInputPixel);
+    }
+
+    virtual PlusStatus SetUp()
+    {
+      this->Input.resize(static_cast<size_t>(this->Width) * this->Height * this->BytesPerInputPixel);
+      for (size_t i = 0; i < this->Input.size(); ++i)
+      {
+        this->Input[i] = static_cast<unsigned char>((i * 7) % 253);
+      }
+      this->Output.assign(static_cast<size_t>(this->Width) * this->Height * (this->ConvertToGray ? 1 : 3), 0);
+      return PLUS_SUCCESS;
+    }
+
+    virtual PlusStatus RunIteration()
+    {
+      if (this->ConvertToGray)
+      {
+        return PixelCodec::ConvertToGray(this->InputEncoding, this->Width, this->Height, &this->Input[0], &this->Output[0]);
+      }
+      return PixelCodec::ConvertToBmp24(this->OutputOrdering, this->InputEncoding, this->Width, this->Height, &this->Input[0], &this->Output[0]);
+    }
+
+    virtual void TearDown()
+    {
+      this->Input.clear();
+      this->Output.clear();
+    }
+
+  protected:
+    PixelCodec::PixelEncoding InputEncoding;
+    int BytesPerInputPixel;
+    bool ConvertToGray;
+    PixelCodec::ComponentOrdering OutputOrdering;
+    int Width;
+    int Height;
+    std::vector<unsigned char> Input;
+    std::vector<unsigned char> Output;
+  };
+}
+
+//----------------------------------------------------------------------------
+void AddPixelCodecBenchmarks(PlusBenchmarkRunner& runner)
+{
+  runner.AddBenchmark(std::make_shared<PixelCodecBenchmark>("PixelCodec/ConvertToGray/YUY2/640x480", PixelCodec::PixelEncoding_YUY2, 2, true, PixelCodec::ComponentOrder_RGB, 640, 480));
+  runner.AddBenchmark(std::make_shared<PixelCodecBenchmark>("PixelCodec/ConvertToGray/YUY2/1920x1080", PixelCodec::PixelEncoding_YUY2, 2, true, PixelCodec::ComponentOrder_RGB, 1920, 1080));
+  runner.AddBenchmark(std::make_shared<PixelCodecBenchmark>("PixelCodec/ConvertToGray/RGB24/640x480", PixelCodec::PixelEncoding_RGB24, 3, true, PixelCodec::ComponentOrder_RGB, 640, 480));
+  runner.AddBenchmark(std::make_shared<PixelCodecBenchmark>("PixelCodec/ConvertToGray/RGBA32/640x480", PixelCodec::PixelEncoding_RGBA32, 4, true, PixelCodec::ComponentOrder_RGB, 640, 480));
+  runner.AddBenchmark(std::make_shared<PixelCodecBenchmark>("PixelCodec/ConvertToBmp24/YUY2/640x480", PixelCodec::PixelEncoding_YUY2, 2, false, PixelCodec::ComponentOrder_RGB, 640, 480));
+  runner.AddBenchmark(std::make_shared<PixelCodecBenchmark>("PixelCodec/ConvertToBmp24/BGR24ToRGB/640x480", PixelCodec::PixelEncoding_BGR24, 3, false, PixelCodec::ComponentOrder_RGB, 640, 480));
+  runner.AddBenchmark(std::make_shared<PixelCodecBenchmark>("PixelCodec/ConvertToBmp24/RGBA32ToBGR/640x480", PixelCodec::PixelEncoding_RGBA32, 4, false, PixelCodec::ComponentOrder_BGR, 640, 480));
+}
@@ -0,0 +1,380 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusBenchmarkSuites.h"
+#include "PlusStreamBufferItem.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataSource.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+
+// STL includes
+#include <cmath>
+
+namespace
+{
+  const unsigned int FRAME_WIDTH = 640;
+  const unsigned int FRAME_HEIGHT = 480;
+  const int TRACKER_BUFFER_SIZE = 1000;
+  const double TRACKER_FRAME_PERIOD_SEC = 1.0 / 120.0;
+  const int VIDEO_BUFFER_SIZE = 50;
+  const double VIDEO_FRAME_PERIOD_SEC = 1.0 / 30.0;
+  /*! Number of precomputed lookup timestamps, must be a power of 2 */
+  const unsigned int NUMBER_OF_LOOKUP_TIMESTAMPS = 1024;
+
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkPlusDataSource> CreateToolSource(const std::string& toolId, int bufferSize)
+  {
+    vtkSmartPointer<vtkPlusDataSource> tool = vtkSmartPointer<vtkPlusDataSource>::New();
+    tool->SetId(toolId);
+    tool->SetBufferSize(bufferSize);
+    return tool;
+  }
+
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkPlusDataSource> CreateVideoSource(const std::string& sourceId, int bufferSize)
+  {
+    vtkSmartPointer<vtkPlusDataSource> source = vtkSmartPointer<vtkPlusDataSource>::New();
+    source->SetId(sourceId);
+    source->SetInputImageOrientation(US_IMG_ORIENT_MF);
+    source->SetOutputImageOrientation(US_IMG_ORIENT_MF);
+    source->SetPixelType(VTK_UNSIGNED_CHAR);
+    source->SetNumberOfScalarComponents(1);
+    source->SetImageType(US_IMG_BRIGHTNESS);
+    source->SetInputFrameSize(FRAME_WIDTH, FRAME_HEIGHT, 1);
+    source->SetBufferSize(bufferSize);
+    return source;
+  }
+
+  //----------------------------------------------------------------------------
+  // Add tool positions along a circular path, so that interpolated transforms are different from the recorded ones
+  PlusStatus AddToolItems(vtkPlusDataSource* tool, int numberOfItems, double firstTimestamp, double framePeriodSec)
+  {
+    vtkSmartPointer<vtkMatrix4x4> toolToTracker = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (int i = 0; i < numberOfItems; ++i)
+    {
+      double angleRad = i * 0.01;
+      toolToTracker->SetElement(0, 0, cos(angleRad));
+      toolToTracker->SetElement(0, 1, -sin(angleRad));
+      toolToTracker->SetElement(1, 0, sin(angleRad));
+      toolToTracker->SetElement(1, 1, cos(angleRad));
+      toolToTracker->SetElement(0, 3, 100 * cos(angleRad));
+      toolToTracker->SetElement(1, 3, 100 * sin(angleRad));
+      double timestamp = firstTimestamp + i * framePeriodSec;
+      if (tool->AddTimeStampedItem(toolToTracker, TOOL_OK, i + 1, timestamp, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add item " << i << " to tool " << tool->GetId());
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  // Pseudo-random lookup timestamps in the [firstTimestamp, lastTimestamp] range.
+  // If exactItemTimestamps is true then timestamps of randomly selected items are returned.
+  PlusStatus GetLookupTimestamps(vtkPlusDataSource* source, bool exactItemTimestamps, std::vector<double>& timestamps)
+  {
+    BufferItemUidType oldestUid = source->GetOldestItemUidInBuffer();
+    BufferItemUidType latestUid = source->GetLatestItemUidInBuffer();
+    double oldestTimestamp = 0;
+    double latestTimestamp = 0;
+    if (source->GetTimeStamp(oldestUid, oldestTimestamp) != ITEM_OK || source->GetTimeStamp(latestUid, latestTimestamp) != ITEM_OK)
+    {
+      LOG_ERROR("Failed to get timestamp range of source " << source->GetId());
+      return PLUS_FAIL;
+    }
+    timestamps.clear();
+    unsigned int randomState = 12345;
+    for (unsigned int i = 0; i < NUMBER_OF_LOOKUP_TIMESTAMPS; ++i)
+    {
+      // Linear congruential generator, enough for spreading the lookups in the buffer
+      randomState = randomState * 1103515245 + 12345;
+      double random = (randomState >> 8) / double(1 << 24);
+      if (exactItemTimestamps)
+      {
+        BufferItemUidType uid = oldestUid + static_cast<BufferItemUidType>(random * (latestUid - oldestUid));
+        double timestamp = 0;
+        if (source->GetTimeStamp(uid, timestamp) != ITEM_OK)
+        {
+          LOG_ERROR("Failed to get timestamp of item " << uid << " of source " << source->GetId());
+          return PLUS_FAIL;
+        }
+        timestamps.push_back(timestamp);
+      }
+      else
+      {
+        timestamps.push_back(oldestTimestamp + random * (latestTimestamp - oldestTimestamp));
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  class AddTransformBenchmark : public PlusBenchmark
+  {
+  public:
+    AddTransformBenchmark()
+      : PlusBenchmark("CircularBuffer/AddTransform")
+      , FrameNumber(0)
+    {
+      this->SetItemsPerIteration(1);
+    }
+
+    virtual PlusStatus SetUp()
+    {
+      this->Tool = CreateToolSource("ProbeToTracker", TRACKER_BUFFER_SIZE);
+      this->ToolToTracker = vtkSmartPointer<vtkMatrix4x4>::New();
+      this->FrameNumber = 0;
+      return PLUS_SUCCESS;
+    }
+
+    virtual PlusStatus RunIteration()
+    {
+      this->FrameNumber++;
+      this->ToolToTracker->SetElement(0, 3, this->FrameNumber % 100);
+      double timestamp = this->FrameNumber * TRACKER_FRAME_PERIOD_SEC;
+      return this->Tool->AddTimeStampedItem(this->ToolToTracker, TOOL_OK, this->FrameNumber, timestamp, timestamp);
+    }
+
+    virtual void TearDown()
+    {
+      this->Tool = NULL;
+      this->ToolToTracker = NULL;
+    }
+
+  protected:
+    vtkSmartPointer<vtkPlusDataSource> Tool;
+    vtkSmartPointer<vtkMatrix4x4> ToolToTracker;
+    unsigned long FrameNumber;
+  };
+
+  //----------------------------------------------------------------------------
+  class AddVideoFrameBenchmark : public PlusBenchmark
+  {
+  public:
+    AddVideoFrameBenchmark()
+      : PlusBenchmark("CircularBuffer/AddVideoFrame/640x480")
+      , FrameNumber(0)
+    {
+      this->SetItemsPerIteration(1);
+      this->SetBytesPerIteration(FRAME_WIDTH * FRAME_HEIGHT);
+    }
+
+    virtual PlusStatus SetUp()
+    {
+      this->Source = CreateVideoSource("Video", VIDEO_BUFFER_SIZE);
+      this->Pixels.assign(FRAME_WIDTH * FRAME_HEIGHT, 0);
+      for (unsigned int i = 0; i < this->Pixels.size(); ++i)
+      {
+        this->Pixels[i] = static_cast<unsigned char>(i % 251);
+      }
+      this->FrameNumber = 0;
+      return PLUS_SUCCESS;
+    }
+
+    virtual PlusStatus RunIteration()
+    {
+      this->FrameNumber++;
+      FrameSizeType frameSize = {FRAME_WIDTH, FRAME_HEIGHT, 1};
+      double timestamp = this->FrameNumber * VIDEO_FRAME_PERIOD_SEC;
+      return this->Source->AddItem(&this->Pixels[0], US_IMG_ORIENT_MF, frameSize, VTK_UNSIGNED_CHAR, 1, US_IMG_BRIGHTNESS, 0, this->FrameNumber, timestamp, timestamp);
+    }
+
+    virtual void TearDown()
+    {
+      this->Source = NULL;
+      this->Pixels.clear();
+    }
+
+  protected:
+    vtkSmartPointer<vtkPlusDataSource> Source;
+    std::vector<unsigned char> Pixels;
+    long FrameNumber;
+  };
+
+  //----------------------------------------------------------------------------
+  class GetItemUidFromTimeBenchmark : public PlusBenchmark
+  {
+  public:
+    GetItemUidFromTimeBenchmark()
+      : PlusBenchmark("CircularBuffer/GetItemUidFromTime")
+      , LookupIndex(0)
+    {
+      this->SetItemsPerIteration(1);
+    }
+
+    virtual PlusStatus SetUp()
+    {
+      this->Tool = CreateToolSource("ProbeToTracker", TRACKER_BUFFER_SIZE);
+      if (AddToolItems(this->Tool, TRACKER_BUFFER_SIZE, 1.0, TRACKER_FRAME_PERIOD_SEC) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      return GetLookupTimestamps(this->Tool, false, this->Timestamps);
+    }
+
+    virtual PlusStatus RunIteration()
+    {
+      BufferItemUidType uid = 0;
+      double timestamp = this->Timestamps[(this->LookupIndex++) & (NUMBER_OF_LOOKUP_TIMESTAMPS - 1)];
+      if (this->Tool->GetItemUidFromTime(timestamp, uid) != ITEM_OK)
+      {
+        LOG_ERROR("Failed to get item UID at time " << std::fixed << timestamp);
+        return PLUS_FAIL;
+      }
+      return PLUS_SUCCESS;
+    }
+
+    virtual void TearDown()
+    {
+      this->Tool = NULL;
+    }
+
+  protected:
+    vtkSmartPointer<vtkPlusDataSource> Tool;
+    std::vector<double> Timestamps;
+    unsigned int LookupIndex;
+  };
+
+  //----------------------------------------------------------------------------
+  class GetItemFromTimeBenchmark : public PlusBenchmark
+  {
+  public:
+    GetItemFromTimeBenchmark(const std::string& name, vtkPlusBuffer::DataItemTemporalInterpolationType interpolation)
+      : PlusBenchmark(name)
+      , Interpolation(interpolation)
+      , LookupIndex(0)
+    {
+      this->SetItemsPerIteration(1);
+    }
+
+    virtual PlusStatus SetUp()
+    {
+      this->Tool = CreateToolSource("ProbeToTracker", TRACKER_BUFFER_SIZE);
+      if (AddToolItems(this->Tool, TRACKER_BUFFER_SIZE, 1.0, TRACKER_FRAME_PERIOD_SEC) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      return GetLookupTimestamps(this->Tool, this->Interpolation == vtkPlusBuffer::EXACT_TIME, this->Timestamps);
+    }
+
+    virtual PlusStatus RunIteration()
+    {
+      StreamBufferItem bufferItem;
+      double timestamp = this->Timestamps[(this->LookupIndex++) & (NUMBER_OF_LOOKUP_TIMESTAMPS - 1)];
+      if (this->Tool->GetStreamBufferItemFromTime(timestamp, &bufferItem, this->Interpolation) != ITEM_OK)
+      {
+        LOG_ERROR("Failed to get item at time " << std::fixed << timestamp);
+        return PLUS_FAIL;
+      }
+      return PLUS_SUCCESS;
+    }
+
+    virtual void TearDown()
+    {
+      this->Tool = NULL;
+    }
+
+  protected:
+    vtkPlusBuffer::DataItemTemporalInterpolationType Interpolation;
+    vtkSmartPointer<vtkPlusDataSource> Tool;
+    std::vector<double> Timestamps;
+    unsigned int LookupIndex;
+  };
+
+  //----------------------------------------------------------------------------
+  class GetTrackedFrameBenchmark : public PlusBenchmark
+  {
+  public:
+    GetTrackedFrameBenchmark(const std::string& name, bool enableImageData)
+      : PlusBenchmark(name)
+      , EnableImageData(enableImageData)
+      , LookupIndex(0)
+    {
+      this->SetItemsPerIteration(1);
+    }
+
+    virtual PlusStatus SetUp()
+    {
+      this->Channel = vtkSmartPointer<vtkPlusChannel>::New();
+      this->Channel->SetChannelId("TrackedVideoStream");
+
+      // Video frames are recorded between 1.0 and 2.6 sec
+      this->VideoSource = CreateVideoSource("Video", VIDEO_BUFFER_SIZE);
+      std::vector<unsigned char> pixels(FRAME_WIDTH * FRAME_HEIGHT, 0);
+      FrameSizeType frameSize = {FRAME_WIDTH, FRAME_HEIGHT, 1};
+      for (int i = 0; i < VIDEO_BUFFER_SIZE; ++i)
+      {
+        double timestamp = 1.0 + i * VIDEO_FRAME_PERIOD_SEC;
+        if (this->VideoSource->AddItem(&pixels[0], US_IMG_ORIENT_MF, frameSize, VTK_UNSIGNED_CHAR, 1, US_IMG_BRIGHTNESS, 0, i + 1, timestamp, timestamp) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to add video frame " << i);
+          return PLUS_FAIL;
+        }
+      }
+      this->Channel->SetVideoSource(this->VideoSource);
+
+      // Tool positions are recorded at a higher rate, before and after the video frames
+      const char* toolIds[] = { "ProbeToTracker", "StylusToTracker", "ReferenceToTracker" };
+      const int numberOfToolItems = static_cast<int>(2.0 / TRACKER_FRAME_PERIOD_SEC);
+      for (int i = 0; i < 3; ++i)
+      {
+        vtkSmartPointer<vtkPlusDataSource> tool = CreateToolSource(toolIds[i], numberOfToolItems);
+        if (AddToolItems(tool, numberOfToolItems, 0.9, TRACKER_FRAME_PERIOD_SEC) != PLUS_SUCCESS)
+        {
+          return PLUS_FAIL;
+        }
+        this->Channel->AddTool(tool);
+        this->Tools.push_back(tool);
+      }
+
+      return GetLookupTimestamps(this->VideoSource, true, this->Timestamps);
+    }
+
+    virtual PlusStatus RunIteration()
+    {
+      igsioTrackedFrame trackedFrame;
+      double timestamp = this->Timestamps[(this->LookupIndex++) & (NUMBER_OF_LOOKUP_TIMESTAMPS - 1)];
+      return this->Channel->GetTrackedFrame(timestamp, trackedFrame, this->EnableImageData);
+    }
+
+    virtual void TearDown()
+    {
+      this->Channel = NULL;
+      this->VideoSource = NULL;
+      this->Tools.clear();
+    }
+
+  protected:
+    bool EnableImageData;
+    vtkSmartPointer<vtkPlusChannel> Channel;
+    vtkSmartPointer<vtkPlusDataSource> VideoSource;
+    std::vector<vtkSmartPointer<vtkPlusDataSource> > Tools;
+    std::vector<double> Timestamps;
+    unsigned int LookupIndex;
+  };
+}
+
+//----------------------------------------------------------------------------
+void AddDataCollectionBenchmarks(PlusBenchmarkRunner& runner)
+{
+  runner.AddBenchmark(std::make_shared<AddTransformBenchmark>());
+  runner.AddBenchmark(std::make_shared<AddVideoFrameBenchmark>());
+  runner.AddBenchmark(std::make_shared<GetItemUidFromTimeBenchmark>());
+  runner.AddBenchmark(std::make_shared<GetItemFromTimeBenchmark>("CircularBuffer/GetItemFromTime/Exact", vtkPlusBuffer::EXACT_TIME));
+  runner.AddBenchmark(std::make_shared<GetItemFromTimeBenchmark>("CircularBuffer/GetItemFromTime/Closest", vtkPlusBuffer::CLOSEST_TIME));
+  runner.AddBenchmark(std::make_shared<GetItemFromTimeBenchmark>("CircularBuffer/GetItemFromTime/Interpolated", vtkPlusBuffer::INTERPOLATED));
+  runner.AddBenchmark(std::make_shared<GetTrackedFrameBenchmark>("Channel/GetTrackedFrame/Interpolated", true));
+  runner.AddBenchmark(std::make_shared<GetTrackedFrameBenchmark>("Channel/GetTrackedFrame/InterpolatedTransformsOnly", false));
+}
@@ -0,0 +1,166 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusBenchmarkSuites.h"
+#include "vtkPlusRfProcessor.h"
+#include "vtkPlusUsScanConvert.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkXMLDataElement.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Returns the first RfProcessing element of the output channels of the first device
+  vtkXMLDataElement* FindRfProcessingElement(vtkXMLDataElement* configRootElement)
+  {
+    vtkXMLDataElement* dataCollectionElement = configRootElement->FindNestedElementWithName("DataCollection");
+    vtkXMLDataElement* deviceElement = (dataCollectionElement != NULL ? dataCollectionElement->FindNestedElementWithName("Device") : NULL);
+    vtkXMLDataElement* outputChannelsElement = (deviceElement != NULL ? deviceElement->FindNestedElementWithName("OutputChannels") : NULL);
+    if (outputChannelsElement == NULL)
+    {
+      return NULL;
+    }
+    for (int i = 0; i < outputChannelsElement->GetNumberOfNestedElements(); ++i)
+    {
+      vtkXMLDataElement* rfProcessingElement = outputChannelsElement->GetNestedElement(i)->FindNestedElementWithName(vtkPlusRfProcessor::GetRfProcessorTagName());
+      if (rfProcessingElement != NULL)
+      {
+        return rfProcessingElement;
+      }
+    }
+    return NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  class RfProcessingBenchmark : public PlusBenchmark
+  {
+  public:
+    enum Operation
+    {
+      BRIGHTNESS_CONVERSION,
+      SCAN_CONVERSION
+    };
+
+    RfProcessingBenchmark(const std::string& name, Operation operation, const std::string& configFilePath, const std::string& sequenceFilePath)
+      : PlusBenchmark(name)
+      , ProcessingOperation(operation)
+      , ConfigFilePath(configFilePath)
+      , SequenceFilePath(sequenceFilePath)
+      , FrameIndex(0)
+    {
+      this->SetItemsPerIteration(1);
+    }
+
+    virtual PlusStatus SetUp()
+    {
+      vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+      this->Frames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+      if (ReadBenchmarkInput(this->ConfigFilePath, this->SequenceFilePath, configRootElement, this->Frames) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      vtkXMLDataElement* rfProcessingElement = FindRfProcessingElement(configRootElement);
+      if (rfProcessingElement == NULL)
+      {
+        LOG_ERROR("Cannot find RF processing element in " << this->ConfigFilePath);
+        return PLUS_FAIL;
+      }
+      this->RfProcessor = vtkSmartPointer<vtkPlusRfProcessor>::New();
+      if (this->RfProcessor->ReadConfiguration(rfProcessingElement) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to read RF processing configuration from " << this->ConfigFilePath);
+        return PLUS_FAIL;
+      }
+
+      if (this->ProcessingOperation == SCAN_CONVERSION)
+      {
+        // Brightness conversion is not measured, the brightness images are computed in advance
+        if (this->RfProcessor->GetScanConverter() == NULL)
+        {
+          LOG_ERROR("Scan conversion is not defined in " << this->ConfigFilePath);
+          return PLUS_FAIL;
+        }
+        for (unsigned int i = 0; i < this->Frames->GetNumberOfTrackedFrames(); ++i)
+        {
+          igsioVideoFrame* frame = this->Frames->GetTrackedFrame(i)->GetImageData();
+          this->RfProcessor->SetRfFrame(frame->GetImage(), frame->GetImageType());
+          vtkSmartPointer<vtkImageData> brightnessImage = vtkSmartPointer<vtkImageData>::New();
+          brightnessImage->DeepCopy(this->RfProcessor->GetBrightnessConvertedImage());
+          this->BrightnessImages.push_back(brightnessImage);
+        }
+      }
+
+      if (this->Frames->GetNumberOfTrackedFrames() == 0)
+      {
+        LOG_ERROR("No frames in " << this->SequenceFilePath);
+        return PLUS_FAIL;
+      }
+      this->FrameIndex = 0;
+      return PLUS_SUCCESS;
+    }
+
+    virtual PlusStatus RunIteration()
+    {
+      unsigned int frameIndex = (this->FrameIndex++) % this->Frames->GetNumberOfTrackedFrames();
+      vtkImageData* outputImage = NULL;
+      if (this->ProcessingOperation == BRIGHTNESS_CONVERSION)
+      {
+        igsioVideoFrame* frame = this->Frames->GetTrackedFrame(frameIndex)->GetImageData();
+        this->RfProcessor->SetRfFrame(frame->GetImage(), frame->GetImageType());
+        // The input may be the same image as in the previous iteration, make sure it is processed again
+        this->RfProcessor->GetRfToBrightnessConverter()->Modified();
+        outputImage = this->RfProcessor->GetBrightnessConvertedImage();
+      }
+      else
+      {
+        vtkPlusUsScanConvert* scanConverter = this->RfProcessor->GetScanConverter();
+        scanConverter->SetInputData(this->BrightnessImages[frameIndex]);
+        scanConverter->Modified();
+        scanConverter->Update();
+        outputImage = scanConverter->GetOutput();
+      }
+      return (outputImage != NULL ? PLUS_SUCCESS : PLUS_FAIL);
+    }
+
+    virtual void TearDown()
+    {
+      this->RfProcessor = NULL;
+      this->Frames = NULL;
+      this->BrightnessImages.clear();
+    }
+
+  protected:
+    Operation ProcessingOperation;
+    std::string ConfigFilePath;
+    std::string SequenceFilePath;
+    vtkSmartPointer<vtkPlusRfProcessor> RfProcessor;
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> Frames;
+    std::vector<vtkSmartPointer<vtkImageData> > BrightnessImages;
+    unsigned int FrameIndex;
+  };
+}
+
+//----------------------------------------------------------------------------
+void AddImageProcessingBenchmarks(PlusBenchmarkRunner& runner, const std::string& testDataDirectory, const std::string& configFilesDirectory)
+{
+  std::string curvilinearConfigFilePath = configFilesDirectory + "/Testing/PlusDeviceSet_RfProcessingAlgoCurvilinearTest.xml";
+  std::string curvilinearRfFilePath = testDataDirectory + "/UltrasonixCurvilinearRfData.igs.mha";
+  std::string linearConfigFilePath = configFilesDirectory + "/Testing/PlusDeviceSet_RfProcessingAlgoLinearTest.xml";
+  std::string linearRfFilePath = testDataDirectory + "/UltrasonixLinearRfData.igs.mha";
+
+  runner.AddBenchmark(std::make_shared<RfProcessingBenchmark>("RfProcessing/RfToBrightness/Curvilinear", RfProcessingBenchmark::BRIGHTNESS_CONVERSION, curvilinearConfigFilePath, curvilinearRfFilePath));
+  runner.AddBenchmark(std::make_shared<RfProcessingBenchmark>("RfProcessing/RfToBrightness/Linear", RfProcessingBenchmark::BRIGHTNESS_CONVERSION, linearConfigFilePath, linearRfFilePath));
+  runner.AddBenchmark(std::make_shared<RfProcessingBenchmark>("RfProcessing/ScanConvert/Curvilinear", RfProcessingBenchmark::SCAN_CONVERSION, curvilinearConfigFilePath, curvilinearRfFilePath));
+  runner.AddBenchmark(std::make_shared<RfProcessingBenchmark>("RfProcessing/ScanConvert/Linear", RfProcessingBenchmark::SCAN_CONVERSION, linearConfigFilePath, linearRfFilePath));
+}
@@ -0,0 +1,143 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusBenchmarkSuites.h"
+#include "PlusIgtlClientInfo.h"
+#include "vtkPlusIgtlMessageFactory.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <igsioVideoFrame.h>
+#include <vtkIGSIOTransformRepository.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+
+// OpenIGTLink includes
+#include <igtlMessageBase.h>
+
+namespace
+{
+  const unsigned int FRAME_WIDTH = 640;
+  const unsigned int FRAME_HEIGHT = 480;
+
+  //----------------------------------------------------------------------------
+  class IgtlMessagePackingBenchmark : public PlusBenchmark
+  {
+  public:
+    /*! Messages of the specified OpenIGTLink message type are created from a synthetic tracked frame */
+    IgtlMessagePackingBenchmark(const std::string& name, const std::string& messageType)
+      : PlusBenchmark(name)
+      , MessageType(messageType)
+      , Timestamp(1.0)
+    {
+      this->SetItemsPerIteration(1);
+      if (messageType == "IMAGE")
+      {
+        this->SetBytesPerIteration(static_cast<double>(FRAME_WIDTH) * FRAME_HEIGHT);
+      }
+    }
+
+    virtual PlusStatus SetUp()
+    {
+      igsioVideoFrame image;
+      FrameSizeType frameSize = {FRAME_WIDTH, FRAME_HEIGHT, 1};
+      if (image.AllocateFrame(frameSize, VTK_UNSIGNED_CHAR, 1) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to allocate benchmark image");
+        return PLUS_FAIL;
+      }
+      image.SetImageOrientation(US_IMG_ORIENT_MF);
+      image.SetImageType(US_IMG_BRIGHTNESS);
+      unsigned char* pixels = static_cast<unsigned char*>(image.GetImage()->GetScalarPointer());
+      for (unsigned int i = 0; i < FRAME_WIDTH * FRAME_HEIGHT; ++i)
+      {
+        pixels[i] = static_cast<unsigned char>(i % 251);
+      }
+      this->TrackedFrame.SetImageData(image);
+
+      this->ClientInfo = PlusIgtlClientInfo();
+      this->ClientInfo.IgtlMessageTypes.push_back(this->MessageType);
+      this->ClientInfo.SetTDATARequested(true);
+      this->ClientInfo.SetTDATAResolution(0);
+
+      vtkSmartPointer<vtkMatrix4x4> toolToTracker = vtkSmartPointer<vtkMatrix4x4>::New();
+      const char* toolNames[] = { "Probe", "Stylus", "Reference" };
+      for (int i = 0; i < 3; ++i)
+      {
+        toolToTracker->SetElement(0, 3, 10.0 * (i + 1));
+        igsioTransformName toolToTrackerName(toolNames[i], "Tracker");
+        this->TrackedFrame.SetFrameTransform(toolToTrackerName, toolToTracker);
+        this->TrackedFrame.SetFrameTransformStatus(toolToTrackerName, TOOL_OK);
+        this->ClientInfo.TransformNames.push_back(toolToTrackerName);
+      }
+
+      // The image is sent in the tracker coordinate system, so the image pose is computed through the probe
+      vtkSmartPointer<vtkMatrix4x4> imageToProbe = vtkSmartPointer<vtkMatrix4x4>::New();
+      imageToProbe->SetElement(0, 0, 0.2);
+      imageToProbe->SetElement(1, 1, 0.2);
+      igsioTransformName imageToProbeName("Image", "Probe");
+      this->TrackedFrame.SetFrameTransform(imageToProbeName, imageToProbe);
+      this->TrackedFrame.SetFrameTransformStatus(imageToProbeName, TOOL_OK);
+
+      PlusIgtlClientInfo::ImageStream imageStream;
+      imageStream.Name = "Image";
+      imageStream.EmbeddedTransformToFrame = "Tracker";
+      this->ClientInfo.ImageStreams.push_back(imageStream);
+
+      this->MessageFactory = vtkSmartPointer<vtkPlusIgtlMessageFactory>::New();
+      this->TransformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+      return PLUS_SUCCESS;
+    }
+
+    virtual PlusStatus RunIteration()
+    {
+      // TDATA messages are only created if the frame is newer than the last sent one
+      this->Timestamp += 0.01;
+      this->TrackedFrame.SetTimestamp(this->Timestamp);
+      this->Messages.clear();
+      if (this->MessageFactory->PackMessages(0, this->ClientInfo, this->Messages, this->TrackedFrame, false, this->TransformRepository) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to pack " << this->MessageType << " messages");
+        return PLUS_FAIL;
+      }
+      if (this->Messages.empty())
+      {
+        LOG_ERROR("No " << this->MessageType << " message was created");
+        return PLUS_FAIL;
+      }
+      return PLUS_SUCCESS;
+    }
+
+    virtual void TearDown()
+    {
+      this->Messages.clear();
+      this->MessageFactory = NULL;
+      this->TransformRepository = NULL;
+      this->TrackedFrame = igsioTrackedFrame();
+    }
+
+  protected:
+    std::string MessageType;
+    double Timestamp;
+    igsioTrackedFrame TrackedFrame;
+    PlusIgtlClientInfo ClientInfo;
+    vtkSmartPointer<vtkPlusIgtlMessageFactory> MessageFactory;
+    vtkSmartPointer<vtkIGSIOTransformRepository> TransformRepository;
+    std::vector<igtl::MessageBase::Pointer> Messages;
+  };
+}
+
+//----------------------------------------------------------------------------
+void AddOpenIGTLinkBenchmarks(PlusBenchmarkRunner& runner)
+{
+  runner.AddBenchmark(std::make_shared<IgtlMessagePackingBenchmark>("IgtlMessageFactory/PackMessages/Image/640x480", "IMAGE"));
+  runner.AddBenchmark(std::make_shared<IgtlMessagePackingBenchmark>("IgtlMessageFactory/PackMessages/Transform", "TRANSFORM"));
+  runner.AddBenchmark(std::make_shared<IgtlMessagePackingBenchmark>("IgtlMessageFactory/PackMessages/TrackingData", "TDATA"));
+}
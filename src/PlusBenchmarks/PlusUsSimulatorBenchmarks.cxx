@@ -0,0 +1,112 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusBenchmarkSuites.h"
+#include "vtkPlusUsSimulatorAlgo.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOTrackedFrameList.h>
+#include <vtkIGSIOTransformRepository.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkXMLDataElement.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  class UsSimulatorBenchmark : public PlusBenchmark
+  {
+  public:
+    /*! numberOfThreads is passed to the simulator, 0 means the number of processors */
+    UsSimulatorBenchmark(const std::string& name, const std::string& configFilePath, const std::string& sequenceFilePath, int numberOfThreads)
+      : PlusBenchmark(name)
+      , ConfigFilePath(configFilePath)
+      , SequenceFilePath(sequenceFilePath)
+      , NumberOfThreads(numberOfThreads)
+      , FrameIndex(0)
+    {
+      this->SetItemsPerIteration(1);
+    }
+
+    virtual PlusStatus SetUp()
+    {
+      vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+      this->Frames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+      if (ReadBenchmarkInput(this->ConfigFilePath, this->SequenceFilePath, configRootElement, this->Frames) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      if (this->Frames->GetNumberOfTrackedFrames() == 0)
+      {
+        LOG_ERROR("No frames in " << this->SequenceFilePath);
+        return PLUS_FAIL;
+      }
+      this->TransformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+      if (this->TransformRepository->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to read transforms from " << this->ConfigFilePath);
+        return PLUS_FAIL;
+      }
+      this->Simulator = vtkSmartPointer<vtkPlusUsSimulatorAlgo>::New();
+      if (this->Simulator->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to read US simulator configuration from " << this->ConfigFilePath);
+        return PLUS_FAIL;
+      }
+      this->Simulator->SetTransformRepository(this->TransformRepository);
+      this->Simulator->SetNumberOfThreads(this->NumberOfThreads);
+      // Every frame is simulated completely, results of the previous frame are not reused
+      this->Simulator->PoseCachingOff();
+      this->FrameIndex = 0;
+      return PLUS_SUCCESS;
+    }
+
+    virtual PlusStatus RunIteration()
+    {
+      unsigned int frameIndex = (this->FrameIndex++) % this->Frames->GetNumberOfTrackedFrames();
+      if (this->TransformRepository->SetTransforms(*this->Frames->GetTrackedFrame(frameIndex)) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to set transforms of frame " << frameIndex);
+        return PLUS_FAIL;
+      }
+      this->Simulator->Modified();
+      this->Simulator->Update();
+      return (this->Simulator->GetOutput() != NULL ? PLUS_SUCCESS : PLUS_FAIL);
+    }
+
+    virtual void TearDown()
+    {
+      this->Simulator = NULL;
+      this->TransformRepository = NULL;
+      this->Frames = NULL;
+    }
+
+  protected:
+    std::string ConfigFilePath;
+    std::string SequenceFilePath;
+    int NumberOfThreads;
+    vtkSmartPointer<vtkPlusUsSimulatorAlgo> Simulator;
+    vtkSmartPointer<vtkIGSIOTransformRepository> TransformRepository;
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> Frames;
+    unsigned int FrameIndex;
+  };
+}
+
+//----------------------------------------------------------------------------
+void AddUsSimulatorBenchmarks(PlusBenchmarkRunner& runner, const std::string& testDataDirectory, const std::string& configFilesDirectory)
+{
+  std::string transformsFilePath = testDataDirectory + "/SpinePhantom2Freehand.igs.mha";
+  std::string linearConfigFilePath = configFilesDirectory + "/Testing/PlusDeviceSet_UsSimulatorAlgoTestLinear.xml";
+  std::string curvilinearConfigFilePath = configFilesDirectory + "/Testing/PlusDeviceSet_UsSimulatorAlgoTestCurvilinear.xml";
+
+  runner.AddBenchmark(std::make_shared<UsSimulatorBenchmark>("UsSimulator/Linear/SingleThread", linearConfigFilePath, transformsFilePath, 1));
+  runner.AddBenchmark(std::make_shared<UsSimulatorBenchmark>("UsSimulator/Linear/MultiThread", linearConfigFilePath, transformsFilePath, 0));
+  runner.AddBenchmark(std::make_shared<UsSimulatorBenchmark>("UsSimulator/Curvilinear/MultiThread", curvilinearConfigFilePath, transformsFilePath, 0));
+}
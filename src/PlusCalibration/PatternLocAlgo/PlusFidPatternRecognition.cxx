@@ -6,6 +6,7 @@ See License.txt for details.
 
 #include "PlusConfigure.h"
 #include "PlusFidPatternRecognition.h"
+#include "PlusProfiler.h"
 #include "vtkMath.h"
 #include "vtkPoints.h"
 #include "vtkLine.h"
@@ -78,6 +79,7 @@ PlusStatus PlusFidPatternRecognition::RecognizePattern(igsioTrackedFrame* tracke
 PlusStatus PlusFidPatternRecognition::RecognizePattern(igsioTrackedFrame* trackedFrame, PatternRecognitionError& patternRecognitionError, unsigned int frameIndex)
 {
   LOG_TRACE("FidPatternRecognition::RecognizePattern");
+  PLUS_PROFILE_SCOPE("FidPatternRecognition");
 
   patternRecognitionError = PATTERN_RECOGNITION_ERROR_NO_ERROR;
 
@@ -103,10 +105,14 @@ PlusStatus PlusFidPatternRecognition::RecognizePattern(igsioTrackedFrame* tracke
   memcpy(m_FidSegmentation.GetUnalteredImage(), image, bytes);
 
   //Start of the segmentation
-  m_FidSegmentation.MorphologicalOperations();
-  m_FidSegmentation.Suppress(m_FidSegmentation.GetWorking(), m_FidSegmentation.GetThresholdImagePercent() / 100.00);
   bool tooManyCandidates = false;
-  bool clusteringSuccessful = m_FidSegmentation.Cluster(tooManyCandidates);
+  bool clusteringSuccessful = false;
+  {
+    PLUS_PROFILE_SCOPE("Segmentation");
+    m_FidSegmentation.MorphologicalOperations();
+    m_FidSegmentation.Suppress(m_FidSegmentation.GetWorking(), m_FidSegmentation.GetThresholdImagePercent() / 100.00);
+    clusteringSuccessful = m_FidSegmentation.Cluster(tooManyCandidates);
+  }
   if (tooManyCandidates)
   {
     patternRecognitionError = PATTERN_RECOGNITION_ERROR_TOO_MANY_CANDIDATES;
@@ -124,10 +130,14 @@ PlusStatus PlusFidPatternRecognition::RecognizePattern(igsioTrackedFrame* tracke
   m_FidLineFinder.SetDotsVector(m_FidSegmentation.GetDotsVector());
   m_FidLabeling.SetDotsVector(m_FidSegmentation.GetDotsVector());
 
-  m_FidLineFinder.FindLines();
+  {
+    PLUS_PROFILE_SCOPE("LineFinding");
+    m_FidLineFinder.FindLines();
+  }
 
   if (m_FidLineFinder.GetLinesVector().size() > 3)
   {
+    PLUS_PROFILE_SCOPE("Labeling");
     m_FidLabeling.SetLinesVector(m_FidLineFinder.GetLinesVector());
     m_FidLabeling.FindPattern();
   }
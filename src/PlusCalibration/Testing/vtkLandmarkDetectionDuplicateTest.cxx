@@ -0,0 +1,160 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file vtkLandmarkDetectionDuplicateTest.cxx
+\brief This test checks on synthetic stylus data that a landmark is detected only once: pivoting again
+near an already detected landmark or inserting a landmark near an existing one must not add a new point
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusLandmarkDetectionAlgo.h"
+#include "vtkMath.h"
+#include "vtkMatrix4x4.h"
+#include "vtkMinimalStandardRandomSequence.h"
+#include "vtkPoints.h"
+#include "vtkSmartPointer.h"
+#include "vtkTransform.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+namespace
+{
+  const double MAX_LANDMARK_POSITION_ERROR_MM = 0.5;
+  const double NOISE_MM = 0.1;
+  // 1.5 detection times at the default 20 samples/sec acquisition rate and 1 sec detection time
+  const unsigned int NUMBER_OF_SAMPLES_PER_PIVOTING = 30;
+
+  //----------------------------------------------------------------------------
+  /*! Pivot the stylus around a fixed tip position. Returns the number of newly detected landmarks or -1 on failure. */
+  int PivotStylus(vtkPlusLandmarkDetectionAlgo* landmarkDetection, vtkMinimalStandardRandomSequence* random, const double tipPosition_Reference[3])
+  {
+    int numberOfDetectedLandmarks = 0;
+    vtkSmartPointer<vtkTransform> stylusTipToReference = vtkSmartPointer<vtkTransform>::New();
+    for (unsigned int sampleIndex = 0; sampleIndex < NUMBER_OF_SAMPLES_PER_PIVOTING; ++sampleIndex)
+    {
+      stylusTipToReference->Identity();
+      stylusTipToReference->Translate(tipPosition_Reference);
+      stylusTipToReference->RotateY(-30.0 + 60.0 * (sampleIndex % 20) / 19.0);
+      stylusTipToReference->RotateZ(random->GetRangeValue(-20, 20));
+      random->Next();
+      vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+      matrix->DeepCopy(stylusTipToReference->GetMatrix());
+      for (int i = 0; i < 3; ++i)
+      {
+        matrix->SetElement(i, 3, matrix->GetElement(i, 3) + random->GetRangeValue(-NOISE_MM, NOISE_MM));
+        random->Next();
+      }
+
+      int newLandmarkDetected = -1;
+      if (landmarkDetection->InsertNextStylusTipToReferenceTransform(matrix, newLandmarkDetected) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to insert stylus tip transform");
+        return -1;
+      }
+      if (newLandmarkDetected > 0)
+      {
+        numberOfDetectedLandmarks++;
+      }
+    }
+    return numberOfDetectedLandmarks;
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckLandmarks(vtkPlusLandmarkDetectionAlgo* landmarkDetection, int expectedNumberOfDetectedLandmarks, int numberOfNewLandmarks, int expectedNumberOfNewLandmarks,
+                     const double expectedLastLandmark_Reference[3], const std::string& stepName)
+  {
+    int numberOfFailures = 0;
+    if (numberOfNewLandmarks != expectedNumberOfNewLandmarks)
+    {
+      LOG_ERROR(stepName << ": " << numberOfNewLandmarks << " new landmarks were reported instead of " << expectedNumberOfNewLandmarks);
+      numberOfFailures++;
+    }
+    vtkPoints* landmarks = landmarkDetection->GetDetectedLandmarkPoints_Reference();
+    if (landmarks->GetNumberOfPoints() != expectedNumberOfDetectedLandmarks)
+    {
+      LOG_ERROR(stepName << ": " << landmarks->GetNumberOfPoints() << " landmarks are detected instead of " << expectedNumberOfDetectedLandmarks);
+      return numberOfFailures + 1;
+    }
+    if (expectedNumberOfDetectedLandmarks > 0)
+    {
+      double lastLandmark_Reference[3] = {0, 0, 0};
+      landmarks->GetPoint(landmarks->GetNumberOfPoints() - 1, lastLandmark_Reference);
+      double error = sqrt(vtkMath::Distance2BetweenPoints(lastLandmark_Reference, expectedLastLandmark_Reference));
+      LOG_INFO(stepName << ": " << landmarks->GetNumberOfPoints() << " landmarks, last landmark position error: " << error << " mm");
+      if (error > MAX_LANDMARK_POSITION_ERROR_MM)
+      {
+        LOG_ERROR(stepName << ": last landmark is too far from the ground truth: " << error << " mm");
+        numberOfFailures++;
+      }
+    }
+    return numberOfFailures;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkMinimalStandardRandomSequence> random = vtkSmartPointer<vtkMinimalStandardRandomSequence>::New();
+  random->SetSeed(531);
+
+  // Default detection parameters: 20 samples/sec, 1 sec detection time, 15 mm minimum distance between landmarks (5 mm "near" distance)
+  vtkSmartPointer<vtkPlusLandmarkDetectionAlgo> landmarkDetection = vtkSmartPointer<vtkPlusLandmarkDetectionAlgo>::New();
+  int numberOfFailures = 0;
+
+  const double firstLandmark_Reference[3] = {20.0, -35.0, 140.0};
+  const double firstLandmarkShifted_Reference[3] = {21.5, -34.0, 141.0};
+  const double secondLandmark_Reference[3] = {60.0, -35.0, 140.0};
+
+  // First pivoting detects a landmark
+  numberOfFailures += CheckLandmarks(landmarkDetection, 1, PivotStylus(landmarkDetection, random, firstLandmark_Reference), 1, firstLandmark_Reference, "First pivoting");
+
+  // Pivoting again at the same place and close to it does not add a new landmark
+  numberOfFailures += CheckLandmarks(landmarkDetection, 1, PivotStylus(landmarkDetection, random, firstLandmark_Reference), 0, firstLandmark_Reference, "Pivoting at the same place");
+  numberOfFailures += CheckLandmarks(landmarkDetection, 1, PivotStylus(landmarkDetection, random, firstLandmarkShifted_Reference), 0, firstLandmark_Reference, "Pivoting near the landmark");
+
+  // Pivoting at a different place adds a new landmark
+  numberOfFailures += CheckLandmarks(landmarkDetection, 2, PivotStylus(landmarkDetection, random, secondLandmark_Reference), 1, secondLandmark_Reference, "Pivoting at a new place");
+
+  // Direct insertion near an existing landmark is ignored, far from all of them it is added
+  double insertedLandmark_Reference[4] = {firstLandmark_Reference[0] + 2.0, firstLandmark_Reference[1], firstLandmark_Reference[2], 1.0};
+  landmarkDetection->InsertLandmark_Reference(insertedLandmark_Reference);
+  numberOfFailures += CheckLandmarks(landmarkDetection, 2, 0, 0, secondLandmark_Reference, "Inserting near a landmark");
+  insertedLandmark_Reference[2] = firstLandmark_Reference[2] + 40.0;
+  landmarkDetection->InsertLandmark_Reference(insertedLandmark_Reference);
+  numberOfFailures += CheckLandmarks(landmarkDetection, 3, 0, 0, insertedLandmark_Reference, "Inserting far from the landmarks");
+
+  // After deleting the last landmark it can be detected again
+  landmarkDetection->DeleteLastLandmark();
+  landmarkDetection->DeleteLastLandmark();
+  numberOfFailures += CheckLandmarks(landmarkDetection, 2, PivotStylus(landmarkDetection, random, secondLandmark_Reference), 1, secondLandmark_Reference, "Pivoting at a deleted landmark");
+
+  // After reset all landmarks can be detected again
+  landmarkDetection->ResetDetection();
+  numberOfFailures += CheckLandmarks(landmarkDetection, 1, PivotStylus(landmarkDetection, random, firstLandmark_Reference), 1, firstLandmark_Reference, "Pivoting after reset");
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfFailures << " errors");
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Exit success!!!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -204,6 +204,32 @@ int CompareLineSegmentationResults( const std::vector<vtkPlusLineSegmentationAlg
   return numberOfFailures;
 }
 
+//----------------------------------------------------------------------------
+int CompareLineSegmentationResultsExact( const std::vector<vtkPlusLineSegmentationAlgo::LineParameters>& lineParameters, const std::vector<vtkPlusLineSegmentationAlgo::LineParameters>& serialLineParameters )
+{
+  if ( lineParameters.size() != serialLineParameters.size() )
+  {
+    LOG_ERROR( "Number of frames mismatch: parallel=" << lineParameters.size() << ", serial=" << serialLineParameters.size() );
+    return 1;
+  }
+  unsigned int numberOfFailures = 0;
+  for ( unsigned int frameIndex = 0; frameIndex < lineParameters.size(); ++frameIndex )
+  {
+    const vtkPlusLineSegmentationAlgo::LineParameters& currentParam = lineParameters[frameIndex];
+    const vtkPlusLineSegmentationAlgo::LineParameters& serialParam = serialLineParameters[frameIndex];
+    if ( currentParam.lineDetected != serialParam.lineDetected
+         || currentParam.lineOriginPoint_Image[0] != serialParam.lineOriginPoint_Image[0]
+         || currentParam.lineOriginPoint_Image[1] != serialParam.lineOriginPoint_Image[1]
+         || currentParam.lineDirectionVector_Image[0] != serialParam.lineDirectionVector_Image[0]
+         || currentParam.lineDirectionVector_Image[1] != serialParam.lineDirectionVector_Image[1] )
+    {
+      LOG_ERROR( "Parallel and serial segmentation results differ in Frame #" << frameIndex );
+      numberOfFailures++;
+    }
+  }
+  return numberOfFailures;
+}
+
 //----------------------------------------------------------------------------
 int main( int argc, char** argv )
 {
@@ -217,6 +243,8 @@ int main( int argc, char** argv )
   std::vector<int> clipRectSize;
   std::string inputBaselineFileName;
   bool saveImages = false;
+  int numberOfThreads = 0;
+  bool compareWithSerial = false;
 
   args.AddArgument( "--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help." );
   args.AddArgument( "--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)" );
@@ -225,6 +253,8 @@ int main( int argc, char** argv )
   args.AddArgument( "--clip-rect-size", vtksys::CommandLineArguments::MULTI_ARGUMENT, &clipRectSize, "Size of the clipping rectangle" );
   args.AddArgument( "--save-images", vtksys::CommandLineArguments::NO_ARGUMENT, &saveImages, "Save images with detected lines overlaid" );
   args.AddArgument( "--baseline-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputBaselineFileName, "Input xml baseline file name with path" );
+  args.AddArgument( "--number-of-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of threads used for segmentation (0=number of processors)" );
+  args.AddArgument( "--compare-with-serial", vtksys::CommandLineArguments::NO_ARGUMENT, &compareWithSerial, "Segment the frames on a single thread as well and require identical results" );
 
   if ( !args.Parse() )
   {
@@ -274,6 +304,7 @@ int main( int argc, char** argv )
   lineSegmenter->SetTrackedFrameList( *trackedFrameList );
   lineSegmenter->SetSaveIntermediateImages( saveImages );
   lineSegmenter->SetIntermediateFilesOutputDirectory( vtkPlusConfig::GetInstance()->GetOutputDirectory() );
+  lineSegmenter->SetNumberOfThreads( numberOfThreads );
 
   LOG_DEBUG( "Segment lines" );
   if ( lineSegmenter->Update() != PLUS_SUCCESS )
@@ -289,6 +320,33 @@ int main( int argc, char** argv )
   LOG_INFO( "Save calibration results to XML file: " << resultSaveFilename );
   WriteLineSegmentationResultsToFile( resultSaveFilename, lineParameters );
 
+  if ( compareWithSerial )
+  {
+    LOG_INFO( "Comparing result with single-threaded segmentation..." );
+    vtkSmartPointer<vtkPlusLineSegmentationAlgo> serialLineSegmenter = vtkSmartPointer<vtkPlusLineSegmentationAlgo>::New();
+    if ( clipRectOrigin.size() == 2 && clipRectSize.size() == 2 )
+    {
+      int origin[2] = {clipRectOrigin[0], clipRectOrigin[1]};
+      int size[2] = {clipRectSize[0], clipRectSize[1]};
+      serialLineSegmenter->SetClipRectangle( origin, size );
+    }
+    serialLineSegmenter->SetTrackedFrameList( *trackedFrameList );
+    serialLineSegmenter->SetNumberOfThreads( 1 );
+    if ( serialLineSegmenter->Update() != PLUS_SUCCESS )
+    {
+      LOG_ERROR( "Failed to get line positions from video frames on a single thread" );
+      exit( EXIT_FAILURE );
+    }
+    std::vector<vtkPlusLineSegmentationAlgo::LineParameters> serialLineParameters;
+    serialLineSegmenter->GetDetectedLineParameters( serialLineParameters );
+    int numberOfFailures = CompareLineSegmentationResultsExact( lineParameters, serialLineParameters );
+    if ( numberOfFailures > 0 )
+    {
+      LOG_ERROR( "Number of differences compared to single-threaded segmentation: " << numberOfFailures << ". Test failed!" );
+      exit( EXIT_FAILURE );
+    }
+  }
+
   // Compare result to baseline
   if ( !inputBaselineFileName.empty() )
   {
@@ -0,0 +1,153 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file vtkPivotCalibrationIncrementalTest.cxx
+\brief This test checks the incremental outlier rejection of the pivot calibration on synthetic data:
+outliers must be rejected and the running estimate must follow the pivot point when it is moved
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusPivotCalibrationAlgo.h"
+#include "vtkMath.h"
+#include "vtkMatrix4x4.h"
+#include "vtkMinimalStandardRandomSequence.h"
+#include "vtkSmartPointer.h"
+#include "vtkTransform.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+namespace
+{
+  const double MAX_PIVOT_POINT_ERROR_MM = 0.5;
+  const double NOISE_MM = 0.2;
+  const double OUTLIER_OFFSET_MM = 15.0;
+  const unsigned int OUTLIER_PERIOD = 13;
+  const unsigned int NUMBER_OF_SAMPLES = 400;
+
+  //----------------------------------------------------------------------------
+  /*! Insert samples of a marker rotated around the pivot point. Every OUTLIER_PERIOD-th sample is an outlier if requested. */
+  int InsertSamples(vtkPlusPivotCalibrationAlgo* pivotCalibration, vtkMinimalStandardRandomSequence* random, const double pivotPoint_Marker[3], const double pivotPoint_Reference[3], bool addOutliers)
+  {
+    int numberOfOutliers = 0;
+    vtkSmartPointer<vtkTransform> markerToReference = vtkSmartPointer<vtkTransform>::New();
+    for (unsigned int sampleIndex = 0; sampleIndex < NUMBER_OF_SAMPLES; ++sampleIndex)
+    {
+      markerToReference->Identity();
+      markerToReference->RotateX(random->GetRangeValue(-40, 40));
+      random->Next();
+      markerToReference->RotateY(random->GetRangeValue(-40, 40));
+      random->Next();
+      markerToReference->RotateZ(random->GetRangeValue(-180, 180));
+      random->Next();
+      vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+      matrix->DeepCopy(markerToReference->GetMatrix());
+
+      // Translation that maps the pivot point to its position in the reference coordinate system
+      double rotatedPivotPoint[3] = {0, 0, 0};
+      markerToReference->TransformPoint(pivotPoint_Marker, rotatedPivotPoint);
+      for (int i = 0; i < 3; ++i)
+      {
+        double noise = random->GetRangeValue(-NOISE_MM, NOISE_MM);
+        random->Next();
+        matrix->SetElement(i, 3, pivotPoint_Reference[i] - rotatedPivotPoint[i] + noise);
+      }
+      if (addOutliers && sampleIndex % OUTLIER_PERIOD == OUTLIER_PERIOD - 1)
+      {
+        matrix->SetElement(0, 3, matrix->GetElement(0, 3) + OUTLIER_OFFSET_MM);
+        numberOfOutliers++;
+      }
+
+      pivotCalibration->InsertNextCalibrationPoint(matrix);
+    }
+    return numberOfOutliers;
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckIncrementalResult(vtkPlusPivotCalibrationAlgo* pivotCalibration, const double expectedPivotPoint_Marker[3], const double expectedPivotPoint_Reference[3])
+  {
+    double pivotPoint_Marker[3] = {0, 0, 0};
+    double pivotPoint_Reference[3] = {0, 0, 0};
+    double rmsError = 0;
+    if (pivotCalibration->GetIncrementalPivotPointPosition(pivotPoint_Marker, pivotPoint_Reference, rmsError) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Incremental pivot calibration result is not available");
+      return 1;
+    }
+    int numberOfFailures = 0;
+    double markerError = sqrt(vtkMath::Distance2BetweenPoints(pivotPoint_Marker, expectedPivotPoint_Marker));
+    double referenceError = sqrt(vtkMath::Distance2BetweenPoints(pivotPoint_Reference, expectedPivotPoint_Reference));
+    LOG_INFO("Incremental pivot point error: " << markerError << " mm (marker), " << referenceError << " mm (reference), RMS error: " << rmsError << " mm");
+    if (markerError > MAX_PIVOT_POINT_ERROR_MM || referenceError > MAX_PIVOT_POINT_ERROR_MM)
+    {
+      LOG_ERROR("Incremental pivot point is too far from the ground truth: " << markerError << " mm (marker), " << referenceError << " mm (reference)");
+      numberOfFailures++;
+    }
+    return numberOfFailures;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkMinimalStandardRandomSequence> random = vtkSmartPointer<vtkMinimalStandardRandomSequence>::New();
+  random->SetSeed(183);
+
+  vtkSmartPointer<vtkPlusPivotCalibrationAlgo> pivotCalibration = vtkSmartPointer<vtkPlusPivotCalibrationAlgo>::New();
+  int numberOfFailures = 0;
+
+  // Outliers are rejected
+  const double pivotPoint_Marker[3] = {10.0, -5.0, 150.0};
+  const double pivotPoint_Reference[3] = {100.0, 50.0, -20.0};
+  int numberOfGeneratedOutliers = InsertSamples(pivotCalibration, random, pivotPoint_Marker, pivotPoint_Reference, true);
+  int numberOfIncrementalOutliers = pivotCalibration->GetNumberOfIncrementalOutliers();
+  LOG_INFO("Generated outliers: " << numberOfGeneratedOutliers << ", rejected samples: " << numberOfIncrementalOutliers);
+  // All generated outliers must be rejected, but only a small fraction of the inliers may be
+  const int maxNumberOfRejectedInliers = (NUMBER_OF_SAMPLES - numberOfGeneratedOutliers) / 20;
+  if (numberOfIncrementalOutliers < numberOfGeneratedOutliers || numberOfIncrementalOutliers > numberOfGeneratedOutliers + maxNumberOfRejectedInliers)
+  {
+    LOG_ERROR("Unexpected number of rejected samples: " << numberOfIncrementalOutliers << " (generated outliers: " << numberOfGeneratedOutliers << ")");
+    numberOfFailures++;
+  }
+  numberOfFailures += CheckIncrementalResult(pivotCalibration, pivotPoint_Marker, pivotPoint_Reference);
+
+  // When the pivot point is moved all new samples are outliers at first, after a full window of them the estimate is restarted
+  const double movedPivotPoint_Reference[3] = {150.0, 20.0, -40.0};
+  InsertSamples(pivotCalibration, random, pivotPoint_Marker, movedPivotPoint_Reference, false);
+  numberOfFailures += CheckIncrementalResult(pivotCalibration, pivotPoint_Marker, movedPivotPoint_Reference);
+
+  // Removing all points resets the incremental calibration
+  pivotCalibration->RemoveAllCalibrationPoints();
+  double pivotPoint[3] = {0, 0, 0};
+  double rmsError = 0;
+  if (pivotCalibration->GetIncrementalPivotPointPosition(pivotPoint, pivotPoint, rmsError) == PLUS_SUCCESS || pivotCalibration->GetNumberOfIncrementalOutliers() != 0)
+  {
+    LOG_ERROR("Incremental pivot calibration is not reset by RemoveAllCalibrationPoints");
+    numberOfFailures++;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfFailures << " errors");
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Exit success!!!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file vtkProbeCalibrationOptimizerJacobianTest.cxx
+\brief This test compares the closed-form Jacobian of the Levenberg-Marquardt probe calibration residuals
+to finite differences on synthetic wire intersection data
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusProbeCalibrationOptimizerAlgo.h"
+#include "vtkMinimalStandardRandomSequence.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <cmath>
+
+namespace
+{
+  const double FINITE_DIFFERENCE_STEP_SIZE = 1e-6;
+  const double MAX_JACOBIAN_ERROR = 1e-4;
+  const unsigned int NUMBER_OF_WIRE_INTERSECTIONS = 30;
+
+  typedef vtkPlusProbeCalibrationOptimizerAlgo::WireIntersectionData WireIntersectionData;
+
+  //----------------------------------------------------------------------------
+  void GenerateWireIntersections(std::vector<WireIntersectionData>& wireIntersections)
+  {
+    vtkSmartPointer<vtkMinimalStandardRandomSequence> random = vtkSmartPointer<vtkMinimalStandardRandomSequence>::New();
+    random->SetSeed(12345);
+    wireIntersections.clear();
+    for (unsigned int i = 0; i < NUMBER_OF_WIRE_INTERSECTIONS; ++i)
+    {
+      WireIntersectionData data;
+      for (int axis = 0; axis < 3; ++axis)
+      {
+        data.SegmentedPoint_Image[axis] = (axis < 2) ? random->GetRangeValue(0, 600) : 0.0;
+        random->Next();
+        data.ComputedPoint_Probe[axis] = random->GetRangeValue(-50, 50);
+        random->Next();
+        data.WireEndPointFront_Probe[axis] = random->GetRangeValue(-50, 50);
+        random->Next();
+      }
+      // Back end points are far enough from the front end points so that the wires are not parallel to the image plane
+      data.WireEndPointBack_Probe = data.WireEndPointFront_Probe;
+      data.WireEndPointBack_Probe[0] += random->GetRangeValue(-10, 10);
+      random->Next();
+      data.WireEndPointBack_Probe[1] += random->GetRangeValue(-10, 10);
+      random->Next();
+      data.WireEndPointBack_Probe[2] += 40.0;
+      wireIntersections.push_back(data);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  vnl_vector<double> GetParameters(double qx, double qy, double qz, bool isotropicPixelSpacing)
+  {
+    vnl_vector<double> parameters(isotropicPixelSpacing ? 7 : 8);
+    parameters[0] = qx;
+    parameters[1] = qy;
+    parameters[2] = qz;
+    parameters[3] = 10.0;
+    parameters[4] = -20.0;
+    parameters[5] = 5.0;
+    parameters[6] = 0.2;
+    if (!isotropicPixelSpacing)
+    {
+      parameters[7] = 0.25;
+    }
+    return parameters;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  std::vector<WireIntersectionData> wireIntersections;
+  GenerateWireIntersections(wireIntersections);
+
+  // Versors: small rotation, large rotation
+  const double versors[2][3] = { { 0.05, -0.1, 0.2 }, { 0.6, 0.5, -0.4 } };
+  const vtkPlusProbeCalibrationOptimizerAlgo::OptimizationMethodType methods[2] =
+  {
+    vtkPlusProbeCalibrationOptimizerAlgo::MINIMIZE_DISTANCE_OF_MIDDLE_WIRES_IN_3D,
+    vtkPlusProbeCalibrationOptimizerAlgo::MINIMIZE_DISTANCE_OF_ALL_WIRES_IN_2D
+  };
+
+  int numberOfFailures = 0;
+  for (int methodIndex = 0; methodIndex < 2; ++methodIndex)
+  {
+    for (int isotropic = 0; isotropic < 2; ++isotropic)
+    {
+      for (int versorIndex = 0; versorIndex < 2; ++versorIndex)
+      {
+        vnl_vector<double> parameters = GetParameters(versors[versorIndex][0], versors[versorIndex][1], versors[versorIndex][2], isotropic != 0);
+        double error = vtkPlusProbeCalibrationOptimizerAlgo::ComputeJacobianError(wireIntersections, methods[methodIndex], isotropic != 0, parameters, FINITE_DIFFERENCE_STEP_SIZE);
+        LOG_INFO("Method " << vtkPlusProbeCalibrationOptimizerAlgo::GetOptimizationMethodAsString(methods[methodIndex])
+                 << (isotropic ? ", isotropic" : ", anisotropic") << " spacing, versor #" << versorIndex << ": max Jacobian error = " << error);
+        if (error < 0 || error > MAX_JACOBIAN_ERROR)
+        {
+          LOG_ERROR("Analytic Jacobian does not match finite differences: max error = " << error << " (threshold: " << MAX_JACOBIAN_ERROR << ")");
+          numberOfFailures++;
+        }
+      }
+
+      // Close to 180 deg rotation the derivatives are bounded, they must not be infinite or NaN
+      vnl_vector<double> parameters = GetParameters(0.6, 0.8, 0.0, isotropic != 0);
+      double error = vtkPlusProbeCalibrationOptimizerAlgo::ComputeJacobianError(wireIntersections, methods[methodIndex], isotropic != 0, parameters, FINITE_DIFFERENCE_STEP_SIZE);
+      if (error < 0 || !std::isfinite(error))
+      {
+        LOG_ERROR("Jacobian is not finite at 180 deg rotation");
+        numberOfFailures++;
+      }
+    }
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfFailures << " errors");
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Exit success!!!" << std::endl;
+  return EXIT_SUCCESS;
+}
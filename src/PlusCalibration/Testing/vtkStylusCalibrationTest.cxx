@@ -221,6 +221,31 @@ int main(int argc, char* argv[])
   LOG_INFO("Number of detected outliers: " << pivotCalibration->GetNumberOfDetectedOutliers());
   LOG_INFO("Mean calibration error: " << pivotCalibration->GetCalibrationError() << " mm");
 
+  // The running estimate should be close to the batch result, as both reject the outliers
+  double incrementalPivotPoint_Marker[3] = {0, 0, 0};
+  double incrementalPivotPoint_Reference[3] = {0, 0, 0};
+  double incrementalError = 0;
+  if (pivotCalibration->GetIncrementalPivotPointPosition(incrementalPivotPoint_Marker, incrementalPivotPoint_Reference, incrementalError) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Incremental pivot calibration result is not available!");
+    exit(EXIT_FAILURE);
+  }
+  LOG_INFO("Number of incremental outliers: " << pivotCalibration->GetNumberOfIncrementalOutliers());
+  LOG_INFO("Incremental calibration RMS error: " << incrementalError << " mm");
+  double batchPivotPoint_Marker[3] =
+  {
+    pivotCalibration->GetPivotPointToMarkerTransformMatrix()->GetElement(0, 3),
+    pivotCalibration->GetPivotPointToMarkerTransformMatrix()->GetElement(1, 3),
+    pivotCalibration->GetPivotPointToMarkerTransformMatrix()->GetElement(2, 3)
+  };
+  const double incrementalPivotPointToleranceMm = 1.0;
+  double incrementalPivotPointDifference = sqrt(vtkMath::Distance2BetweenPoints(incrementalPivotPoint_Marker, batchPivotPoint_Marker));
+  if (incrementalPivotPointDifference > incrementalPivotPointToleranceMm)
+  {
+    LOG_ERROR("Incremental pivot point differs from the batch result by " << incrementalPivotPointDifference << " mm (tolerance: " << incrementalPivotPointToleranceMm << " mm)");
+    exit(EXIT_FAILURE);
+  }
+
   // Save result
   if (transformRepository->WriteConfiguration(configRootElement) != PLUS_SUCCESS)
   {
@@ -14,10 +14,12 @@ compares the results to a baseline
 
 #include "PlusFidPatternRecognition.h"
 #include "PlusMath.h"
+#include "PlusProfiler.h"
 #include "vtkCallbackCommand.h"
 #include "vtkCommand.h"
 #include "vtkMath.h"
 #include "vtkMatrix4x4.h"
+#include "vtkPlusHTMLGenerator.h"
 #include "vtkPlusProbeCalibrationAlgo.h"
 #include "vtkIGSIOSequenceIO.h"
 #include "vtkSmartPointer.h"
@@ -50,6 +52,7 @@ int main(int argc, char* argv[])
   std::string inputConfigFileName;
   std::string inputBaselineFileName;
   std::string resultConfigFileName;
+  std::string optimizationAlgorithm;
 
 #ifndef _WIN32
   double inputTranslationErrorThreshold(LINUXTOLERANCE * 2); // *PE* methods on linux can have up to about 0.7mm translation error
@@ -59,6 +62,8 @@ int main(int argc, char* argv[])
   double inputRotationErrorThreshold(1e-10);
 #endif
 
+  bool profileReport(false);
+
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   vtksys::CommandLineArguments args;
@@ -75,7 +80,9 @@ int main(int argc, char* argv[])
   args.AddArgument("--translation-error-threshold", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputTranslationErrorThreshold, "Translation error threshold in mm. Used for baseline comparison.");
   args.AddArgument("--rotation-error-threshold", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputRotationErrorThreshold, "Rotation error threshold in degrees. Used for baseline comparison.");
 
+  args.AddArgument("--optimization-algorithm", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &optimizationAlgorithm, "Override the optimization algorithm of the configuration file (POWELL or LEVENBERG_MARQUARDT). Optional.");
   args.AddArgument("--output-config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &resultConfigFileName, "Result configuration file name. Optional.");
+  args.AddArgument("--profile-report", vtksys::CommandLineArguments::NO_ARGUMENT, &profileReport, "Write an HTML report of the processing time of the calibration stages into the output directory.");
 
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
@@ -93,6 +100,7 @@ int main(int argc, char* argv[])
   }
 
   vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+  PlusProfiler::SetEnabled(profileReport);
 
   LOG_INFO("Read configuration file...");
 
@@ -115,6 +123,22 @@ int main(int argc, char* argv[])
 
   vtkSmartPointer<vtkPlusProbeCalibrationAlgo> freehandCalibration = vtkSmartPointer<vtkPlusProbeCalibrationAlgo>::New();
   freehandCalibration->ReadConfiguration(configRootElement);
+  if (!optimizationAlgorithm.empty())
+  {
+    if (STRCASECMP(optimizationAlgorithm.c_str(), vtkPlusProbeCalibrationOptimizerAlgo::GetOptimizationAlgorithmAsString(vtkPlusProbeCalibrationOptimizerAlgo::OPTIMIZATION_ALGORITHM_POWELL)) == 0)
+    {
+      freehandCalibration->GetOptimizer()->SetOptimizationAlgorithm(vtkPlusProbeCalibrationOptimizerAlgo::OPTIMIZATION_ALGORITHM_POWELL);
+    }
+    else if (STRCASECMP(optimizationAlgorithm.c_str(), vtkPlusProbeCalibrationOptimizerAlgo::GetOptimizationAlgorithmAsString(vtkPlusProbeCalibrationOptimizerAlgo::OPTIMIZATION_ALGORITHM_LEVENBERG_MARQUARDT)) == 0)
+    {
+      freehandCalibration->GetOptimizer()->SetOptimizationAlgorithm(vtkPlusProbeCalibrationOptimizerAlgo::OPTIMIZATION_ALGORITHM_LEVENBERG_MARQUARDT);
+    }
+    else
+    {
+      LOG_ERROR("Invalid optimization algorithm: " << optimizationAlgorithm);
+      return EXIT_FAILURE;
+    }
+  }
 
   PlusFidPatternRecognition patternRecognition;
   PlusFidPatternRecognition::PatternRecognitionError error;
@@ -208,6 +232,15 @@ int main(int argc, char* argv[])
     }
   }
 
+  if (profileReport)
+  {
+    vtkSmartPointer<vtkPlusHTMLGenerator> htmlGenerator = vtkSmartPointer<vtkPlusHTMLGenerator>::New();
+    htmlGenerator->SetTitle("Probe calibration performance profile");
+    htmlGenerator->SetBaseFilename("ProbeCalibrationProfile");
+    htmlGenerator->AddProfilerReport();
+    htmlGenerator->SaveHtmlPageAutoFilename();
+  }
+
   std::cout << "Calibration has been completed successfully" << std::endl;
   return EXIT_SUCCESS;
 }
@@ -19,8 +19,10 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusProfiler.h"
 #include "igsioTrackedFrame.h"
 #include "vtkIGSIOSequenceIO.h"
+#include "vtkPlusHTMLGenerator.h"
 #include "vtkPlusTemporalCalibrationAlgo.h"
 #include "vtkIGSIOTrackedFrameList.h"
 
@@ -188,6 +190,7 @@ int main(int argc, char** argv)
   bool printHelp(false);
   bool plotResults(false);
   bool saveIntermediateImages(false);
+  bool profileReport(false);
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
   std::string inputMovingSequenceMetafile("");
   std::string inputFixedSequenceMetafile("");
@@ -217,6 +220,7 @@ int main(int argc, char** argv)
   args.AddArgument("--clip-rect-origin", vtksys::CommandLineArguments::MULTI_ARGUMENT, &clipRectOrigin, "Origin of the clipping rectangle");
   args.AddArgument("--clip-rect-size", vtksys::CommandLineArguments::MULTI_ARGUMENT, &clipRectSize, "Size of the clipping rectangle");
   args.AddArgument("--baseline-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputBaselineFileName, "Input xml baseline file name with path");
+  args.AddArgument("--profile-report", vtksys::CommandLineArguments::NO_ARGUMENT, &profileReport, "Write an HTML report of the processing time of the calibration stages into the output directory");
 
   if (!args.Parse())
   {
@@ -232,6 +236,7 @@ int main(int argc, char** argv)
   }
 
   vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+  PlusProfiler::SetEnabled(profileReport);
 
   if (inputMovingSequenceMetafile.empty())
   {
@@ -410,6 +415,15 @@ int main(int argc, char** argv)
     LOG_INFO("Baseline comparison completed successfully");
   }
 
+  if (profileReport)
+  {
+    vtkSmartPointer<vtkPlusHTMLGenerator> htmlGenerator = vtkSmartPointer<vtkPlusHTMLGenerator>::New();
+    htmlGenerator->SetTitle("Temporal calibration performance profile");
+    htmlGenerator->SetBaseFilename("TemporalCalibrationProfile");
+    htmlGenerator->AddProfilerReport();
+    htmlGenerator->SaveHtmlPageAutoFilename();
+  }
+
   testTemporalCalibrationObject->Delete();
 
   return EXIT_SUCCESS;
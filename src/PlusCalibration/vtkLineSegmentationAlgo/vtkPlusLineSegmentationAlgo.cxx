@@ -24,6 +24,10 @@ See License.txt for details.
 #include <itkResampleImageFilter.h>
 #include <itkRescaleIntensityImageFilter.h>
 
+// STL includes
+#include <algorithm>
+#include <atomic>
+
 // VTK includes
 #include <vtkChartXY.h>
 #include <vtkContextScene.h>
@@ -31,7 +35,9 @@ See License.txt for details.
 #include <vtkContextView.h>
 #endif
 #include <vtkDoubleArray.h>
+#include <vtkImageData.h>
 #include <vtkIntArray.h>
+#include <vtkMultiThreader.h>
 #include <vtkObjectFactory.h>
 #include <vtkPen.h>
 #include <vtkPlot.h>
@@ -71,6 +77,7 @@ vtkPlusLineSegmentationAlgo::vtkPlusLineSegmentationAlgo()
   , m_SaveIntermediateImages(false)
   , IntermediateFilesOutputDirectory("")
   , PlotIntensityProfile(false)
+  , NumberOfThreads(0)
   , m_SignalTimeRangeMin(0.0)
   , m_SignalTimeRangeMax(-1.0)
 {
@@ -181,6 +188,43 @@ PlusStatus vtkPlusLineSegmentationAlgo::VerifyVideoInput()
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+struct vtkPlusLineSegmentationAlgo::FrameSegmentationWorkspace
+{
+  typedef itk::PlaneParametersEstimator<DIMENSION> PlaneEstimatorType;
+  typedef itk::RANSAC<itk::Point<double, DIMENSION>, double> RANSACType;
+
+  FrameSegmentationWorkspace()
+    : PlaneEstimator(PlaneEstimatorType::New())
+    , RansacEstimator(RANSACType::New())
+  {
+    // Frames are already processed in parallel, so RANSAC itself runs on the calling thread
+    RansacEstimator->SetNumberOfThreads(1);
+  }
+
+  /*! Intensity values along the currently processed scanline */
+  std::vector<int> IntensityProfile;
+  /*! Intensity peak positions found on the scanlines of the currently processed frame */
+  std::vector<itk::Point<double, 2> > IntensityPeakPositions;
+  /*! Output of the line fitting (n, a) */
+  std::vector<double> LineFitParameters;
+
+  PlaneEstimatorType::Pointer PlaneEstimator;
+  RANSACType::Pointer RansacEstimator;
+};
+
+//-----------------------------------------------------------------------------
+struct vtkPlusLineSegmentationAlgo::SegmentFramesJob
+{
+  vtkPlusLineSegmentationAlgo* Self;
+  /*! One workspace for each thread, indexed by the thread ID */
+  std::vector<FrameSegmentationWorkspace> Workspaces;
+  /*! One result for each frame, indexed by the frame number */
+  std::vector<FrameSegmentationResult> Results;
+  /*! Index of the next frame that is not yet taken by any thread */
+  std::atomic<unsigned int> NextFrameNumber;
+};
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric()
 {
@@ -193,206 +237,263 @@ PlusStatus vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric()
   nonDetectedLineParams.lineOriginPoint_Image[1] = 0;
   nonDetectedLineParams.lineDirectionVector_Image[0] = 0;
   nonDetectedLineParams.lineDirectionVector_Image[1] = 1;
-  m_LineParameters.assign(m_TrackedFrameList->GetNumberOfTrackedFrames(), nonDetectedLineParams);
+  const unsigned int numberOfFrames = m_TrackedFrameList->GetNumberOfTrackedFrames();
+  m_LineParameters.assign(numberOfFrames, nonDetectedLineParams);
+
+  FrameSegmentationResult nonDetectedResult;
+  nonDetectedResult.LineDetected = false;
+  nonDetectedResult.Parameters = nonDetectedLineParams;
+  nonDetectedResult.SignalValue = 0.0;
+  nonDetectedResult.Timestamp = 0.0;
+
+  int numberOfThreads = (this->NumberOfThreads > 0) ? this->NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  if (m_SaveIntermediateImages || this->PlotIntensityProfile)
+  {
+    // Debugging outputs are generated frame by frame
+    numberOfThreads = 1;
+  }
+  numberOfThreads = std::max(1, std::min(numberOfThreads, static_cast<int>(std::min<unsigned int>(numberOfFrames, VTK_MAX_THREADS))));
 
   //  For each video frame, detect line and extract mindpoint and slope parameters
-  int numberOfSuccessfulLineSegmentations = 0;
-  bool signalTimeRangeDefined = (m_SignalTimeRangeMin <= m_SignalTimeRangeMax);
-  for (unsigned int frameNumber = 0; frameNumber < m_TrackedFrameList->GetNumberOfTrackedFrames(); ++frameNumber)
+  SegmentFramesJob job;
+  job.Self = this;
+  job.Workspaces.resize(numberOfThreads);
+  job.Results.assign(numberOfFrames, nonDetectedResult);
+  job.NextFrameNumber = 0;
+  if (numberOfThreads == 1)
   {
-    LOG_TRACE("Calculating video position metric for frame " << frameNumber);
-    igsioTrackedFrame* trackedFrame = m_TrackedFrameList->GetTrackedFrame(frameNumber);
-    if (signalTimeRangeDefined && (trackedFrame->GetTimestamp() < m_SignalTimeRangeMin || trackedFrame->GetTimestamp() > m_SignalTimeRangeMax))
+    for (unsigned int frameNumber = 0; frameNumber < numberOfFrames; ++frameNumber)
     {
-      // frame is out of the specified signal range
-      LOG_TRACE("Skip frame, it is out of the valid signal range");
-      continue;
+      SegmentFrame(frameNumber, job.Workspaces[0], job.Results[frameNumber]);
     }
+  }
+  else
+  {
+    vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod((vtkThreadFunctionType)&SegmentFramesThread, &job);
+    threader->SingleMethodExecute();
+  }
 
-    // Get current image
-    if (trackedFrame->GetImageData()->GetVTKScalarPixelType() != VTK_UNSIGNED_CHAR)
-    {
-      LOG_ERROR("vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric only supports 8-bit images");
-      continue;
-    }
-    CharImageType::Pointer localImage = CharImageType::New();
-    PlusCommon::DeepCopyVtkVolumeToItkImage<CharPixelType>(trackedFrame->GetImageData()->GetImage(), localImage);
-    if (localImage.IsNull())
+  // Merge the results in frame order, so the output is the same regardless of the number of threads
+  int numberOfSuccessfulLineSegmentations = 0;
+  for (unsigned int frameNumber = 0; frameNumber < numberOfFrames; ++frameNumber)
+  {
+    const FrameSegmentationResult& result = job.Results[frameNumber];
+    if (!result.LineDetected)
     {
-      // Dropped frame
-      LOG_ERROR("vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric failed to retrieve image data from frame");
       continue;
     }
+    ++numberOfSuccessfulLineSegmentations;
+    m_LineParameters[frameNumber] = result.Parameters;
+    m_SignalValues.push_back(result.SignalValue);
+    m_SignalTimestamps.push_back(result.Timestamp);
+  }
 
-    // Create an image duplicator to copy the original image
-    typedef itk::ImageDuplicator<CharImageType> DuplicatorType;
-    DuplicatorType::Pointer duplicator = DuplicatorType::New();
-    CharImageType::Pointer scanlineImage;
-    if (m_SaveIntermediateImages == true)
-    {
-      duplicator->SetInputImage(localImage);
-      duplicator->Update();
-
-      // Create an image copy to draw the scanlines on
-      scanlineImage = duplicator->GetOutput();
-    }
-
-    std::vector<itk::Point<double, 2> > intensityPeakPositions;
-    CharImageType::RegionType region = localImage->GetLargestPossibleRegion();
-    LimitToClipRegion(region);
+  double segmentationSuccessRate = double(numberOfSuccessfulLineSegmentations) / numberOfFrames;
+  if (segmentationSuccessRate < EXPECTED_LINE_SEGMENTATION_SUCCESS_RATE)
+  {
+    LOG_WARNING("Line segmentation success rate is very low (" << segmentationSuccessRate * 100 << "%): a line could only be detected on " << numberOfSuccessfulLineSegmentations << " frames out of " << numberOfFrames);
+  }
 
-    int numOfValidScanlines = 0;
+  bool plotVideoMetric = vtkPlusLogger::Instance()->GetLogLevel() >= vtkPlusLogger::LOG_LEVEL_TRACE;
+  if (plotVideoMetric)
+  {
+    PlotDoubleArray(m_SignalValues);
+  }
 
-    for (int currScanlineNum = 0; currScanlineNum < NUMBER_OF_SCANLINES; ++currScanlineNum)
-    {
-      // Set the scanline start pixel
-      CharImageType::IndexType startPixel;
-      double scanlineSpacingPix = static_cast<double>(region.GetSize()[0] - 1) / (NUMBER_OF_SCANLINES - 1);
-      startPixel[0] = region.GetIndex()[0] + scanlineSpacingPix * (currScanlineNum);
-      startPixel[1] = region.GetIndex()[1];
-
-      // Set the scanline end pixel
-      CharImageType::IndexType endPixel;
-      endPixel[0] = startPixel[0];
-      endPixel[1] = startPixel[1] + region.GetSize()[1] - 1;
-
-      std::deque<int> intensityProfile; // Holds intensity profile of the line
-      itk::LineIterator<CharImageType> it(localImage, startPixel, endPixel);
-      it.GoToBegin();
-
-      itk::LineIterator<CharImageType>* itScanlineImage = NULL;
-      if (m_SaveIntermediateImages == true)
-      {
-        // Iterator for the scanline image copy
-        // it's time-consuming to instantiate this iterator, so only do it if intermediate image saving is requested
-        itScanlineImage = new itk::LineIterator<CharImageType>(scanlineImage, startPixel, endPixel);
-        itScanlineImage->GoToBegin();
-      }
+  return PLUS_SUCCESS;
 
-      while (!it.IsAtEnd())
-      {
-        intensityProfile.push_back((int)it.Get());
-        if (m_SaveIntermediateImages == true)
-        {
-          // Set the pixels on the scanline image copy to white
-          itScanlineImage->Set(255);
-          ++(*itScanlineImage);
-        }
-        ++it;
-      }
+} //  End LineDetection
 
-      // Delete the iterator declared with new()
-      if (itScanlineImage != NULL)
-      {
-        delete itScanlineImage;
-        itScanlineImage = NULL;
-      }
+//-----------------------------------------------------------------------------
+void* vtkPlusLineSegmentationAlgo::SegmentFramesThread(vtkMultiThreader::ThreadInfo* data)
+{
+  SegmentFramesJob* job = static_cast<SegmentFramesJob*>(data->UserData);
+  FrameSegmentationWorkspace& workspace = job->Workspaces[data->ThreadID];
+  const unsigned int numberOfFrames = job->Results.size();
+  for (unsigned int frameNumber = job->NextFrameNumber++; frameNumber < numberOfFrames; frameNumber = job->NextFrameNumber++)
+  {
+    job->Self->SegmentFrame(frameNumber, workspace, job->Results[frameNumber]);
+  }
+  return NULL;
+}
 
-      if (this->PlotIntensityProfile)
-      {
-        // Plot the intensity profile
-        PlotIntArray(intensityProfile);
-      }
+//-----------------------------------------------------------------------------
+void vtkPlusLineSegmentationAlgo::SegmentFrame(unsigned int frameNumber, FrameSegmentationWorkspace& workspace, FrameSegmentationResult& result)
+{
+  result.LineDetected = false;
 
-      // Find the max intensity value from the peak with the largest area
-      int maxFromLargestArea = -1;
-      int maxFromLargestAreaIndex = -1;
-      int startOfMaxArea = -1;
-      if (FindLargestPeak(intensityProfile, maxFromLargestArea, maxFromLargestAreaIndex, startOfMaxArea) == PLUS_SUCCESS)
-      {
-        double currPeakPos_y = -1;
-        switch (PEAK_POS_METRIC)
-        {
-          case PEAK_POS_COG:
-            {
-              /* Use center-of-gravity (COG) as peak-position metric*/
-              if (ComputeCenterOfGravity(intensityProfile, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
-              {
-                // unable to compute center-of-gravity; this scanline is invalid
-                continue;
-              }
-              break;
-            }
-          case PEAK_POS_START:
-            {
-              /* Use peak start as peak-position metric*/
-              if (FindPeakStart(intensityProfile, maxFromLargestArea, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
-              {
-                // unable to compute peak start; this scanline is invalid
-                continue;
-              }
-              break;
-            }
-        }
+  LOG_TRACE("Calculating video position metric for frame " << frameNumber);
+  igsioTrackedFrame* trackedFrame = m_TrackedFrameList->GetTrackedFrame(frameNumber);
+  bool signalTimeRangeDefined = (m_SignalTimeRangeMin <= m_SignalTimeRangeMax);
+  if (signalTimeRangeDefined && (trackedFrame->GetTimestamp() < m_SignalTimeRangeMin || trackedFrame->GetTimestamp() > m_SignalTimeRangeMax))
+  {
+    // frame is out of the specified signal range
+    LOG_TRACE("Skip frame, it is out of the valid signal range");
+    return;
+  }
 
-        itk::Point<double, 2> currPeakPos;
-        currPeakPos[0] = static_cast<double>(startPixel[0]);
-        currPeakPos[1] = startPixel[1] + currPeakPos_y;
-        intensityPeakPositions.push_back(currPeakPos);
-        ++numOfValidScanlines;
+  // Get current image
+  if (trackedFrame->GetImageData()->GetVTKScalarPixelType() != VTK_UNSIGNED_CHAR)
+  {
+    LOG_ERROR("vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric only supports 8-bit images");
+    return;
+  }
+  vtkImageData* frameImage = trackedFrame->GetImageData()->GetImage();
+  if (!trackedFrame->GetImageData()->IsImageValid() || frameImage == NULL)
+  {
+    // Dropped frame
+    LOG_DEBUG("vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric skipped frame " << frameNumber << ": image data is invalid");
+    return;
+  }
 
-      } // end if() found intensity peak
+  // The scanlines are read directly from the frame buffer, no image copy is needed
+  int frameExtent[6] = {0, -1, 0, -1, 0, -1};
+  frameImage->GetExtent(frameExtent);
+  vtkIdType frameIncrements[3] = {0, 0, 0};
+  frameImage->GetIncrements(frameIncrements);
+  const CharPixelType* framePixels = static_cast<const CharPixelType*>(frameImage->GetScalarPointer());
+
+  CharImageType::IndexType frameIndex;
+  frameIndex[0] = 0;
+  frameIndex[1] = 0;
+  CharImageType::SizeType frameSize;
+  frameSize[0] = frameExtent[1] - frameExtent[0] + 1;
+  frameSize[1] = frameExtent[3] - frameExtent[2] + 1;
+  CharImageType::RegionType region(frameIndex, frameSize);
+  LimitToClipRegion(region);
+
+  CharImageType::Pointer scanlineImage;
+  if (m_SaveIntermediateImages == true)
+  {
+    // Create an image copy to draw the scanlines on
+    scanlineImage = CharImageType::New();
+    PlusCommon::DeepCopyVtkVolumeToItkImage<CharPixelType>(frameImage, scanlineImage);
+  }
 
-    } // end currScanlineNum loop
+  workspace.IntensityPeakPositions.clear();
+  int numOfValidScanlines = 0;
 
-    if (numOfValidScanlines < MINIMUM_NUMBER_OF_VALID_SCANLINES)
+  const double scanlineSpacingPix = static_cast<double>(region.GetSize()[0] - 1) / (NUMBER_OF_SCANLINES - 1);
+  for (int currScanlineNum = 0; currScanlineNum < NUMBER_OF_SCANLINES; ++currScanlineNum)
+  {
+    // Set the scanline start pixel
+    CharImageType::IndexType startPixel;
+    startPixel[0] = region.GetIndex()[0] + scanlineSpacingPix * (currScanlineNum);
+    startPixel[1] = region.GetIndex()[1];
+
+    // Set the scanline end pixel
+    const CharImageType::IndexValueType endPixelY = startPixel[1] + region.GetSize()[1] - 1;
+
+    // Holds intensity profile of the (vertical) scanline
+    std::vector<int>& intensityProfile = workspace.IntensityProfile;
+    intensityProfile.clear();
+    const CharPixelType* scanlinePixel = framePixels + startPixel[0] * frameIncrements[0] + startPixel[1] * frameIncrements[1];
+    for (CharImageType::IndexValueType y = startPixel[1]; y <= endPixelY; ++y, scanlinePixel += frameIncrements[1])
     {
-      //TODO: drop the frame from the analysis
-      LOG_DEBUG("Only " << numOfValidScanlines << " valid scanlines; this is less than the required " << MINIMUM_NUMBER_OF_VALID_SCANLINES << ". Skipping frame" << frameNumber);
+      intensityProfile.push_back(static_cast<int>(*scanlinePixel));
     }
 
-    LineParameters params;
-    ComputeLineParameters(intensityPeakPositions, params);
-    if (!params.lineDetected)
+    if (m_SaveIntermediateImages == true)
     {
-      LOG_DEBUG("Unable to compute line parameters for frame " << frameNumber);
-      continue;
+      // Set the pixels on the scanline image copy to white
+      CharImageType::IndexType scanlineImageIndex = startPixel;
+      for (; scanlineImageIndex[1] <= endPixelY; ++scanlineImageIndex[1])
+      {
+        scanlineImage->SetPixel(scanlineImageIndex, 255);
+      }
     }
-    if (params.lineDirectionVector_Image[0] < MIN_X_SLOPE_COMPONENT_FOR_DETECTED_LINE)
+
+    if (this->PlotIntensityProfile)
     {
-      // Line is close to vertical, skip frame because intersection of
-      // line with image's horizontal half point is unstable
-      LOG_TRACE("Line on frame " << frameNumber << " is too close to vertical, skip the frame");
-      continue;
+      // Plot the intensity profile
+      PlotIntArray(intensityProfile);
     }
 
-    ++numberOfSuccessfulLineSegmentations;
-    m_LineParameters[frameNumber] = params;
-
-    // Store the y-value of the line, when the line's x-value is half of the image's width
-    double t = (region.GetIndex()[0] + 0.5 * region.GetSize()[0] - params.lineOriginPoint_Image[0]) / params.lineDirectionVector_Image[0];
-    m_SignalValues.push_back(std::abs(params.lineOriginPoint_Image[1] + t * params.lineDirectionVector_Image[1]));
+    // Find the max intensity value from the peak with the largest area
+    int maxFromLargestArea = -1;
+    int maxFromLargestAreaIndex = -1;
+    int startOfMaxArea = -1;
+    if (FindLargestPeak(intensityProfile, maxFromLargestArea, maxFromLargestAreaIndex, startOfMaxArea) == PLUS_SUCCESS)
+    {
+      double currPeakPos_y = -1;
+      switch (PEAK_POS_METRIC)
+      {
+        case PEAK_POS_COG:
+          {
+            /* Use center-of-gravity (COG) as peak-position metric*/
+            if (ComputeCenterOfGravity(intensityProfile, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
+            {
+              // unable to compute center-of-gravity; this scanline is invalid
+              continue;
+            }
+            break;
+          }
+        case PEAK_POS_START:
+          {
+            /* Use peak start as peak-position metric*/
+            if (FindPeakStart(intensityProfile, maxFromLargestArea, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
+            {
+              // unable to compute peak start; this scanline is invalid
+              continue;
+            }
+            break;
+          }
+      }
 
-    //  Store timestamp for image frame
-    m_SignalTimestamps.push_back(m_TrackedFrameList->GetTrackedFrame(frameNumber)->GetTimestamp());
+      itk::Point<double, 2> currPeakPos;
+      currPeakPos[0] = static_cast<double>(startPixel[0]);
+      currPeakPos[1] = startPixel[1] + currPeakPos_y;
+      workspace.IntensityPeakPositions.push_back(currPeakPos);
+      ++numOfValidScanlines;
 
-    if (m_SaveIntermediateImages == true)
-    {
-      SaveIntermediateImage(frameNumber, scanlineImage,
-                            params.lineOriginPoint_Image[0], params.lineOriginPoint_Image[1], params.lineDirectionVector_Image[0], params.lineDirectionVector_Image[1],
-                            numOfValidScanlines, intensityPeakPositions);
-    }
+    } // end if() found intensity peak
 
-  } // end frameNum loop
+  } // end currScanlineNum loop
 
-  double segmentationSuccessRate = double(numberOfSuccessfulLineSegmentations) / m_TrackedFrameList->GetNumberOfTrackedFrames();
-  if (segmentationSuccessRate < EXPECTED_LINE_SEGMENTATION_SUCCESS_RATE)
+  if (numOfValidScanlines < MINIMUM_NUMBER_OF_VALID_SCANLINES)
   {
-    LOG_WARNING("Line segmentation success rate is very low (" << segmentationSuccessRate * 100 << "%): a line could only be detected on " << numberOfSuccessfulLineSegmentations << " frames out of " << m_TrackedFrameList->GetNumberOfTrackedFrames());
+    LOG_DEBUG("Only " << numOfValidScanlines << " valid scanlines; this is less than the required " << MINIMUM_NUMBER_OF_VALID_SCANLINES << ". Skipping frame " << frameNumber);
+    return;
   }
 
-  bool plotVideoMetric = vtkPlusLogger::Instance()->GetLogLevel() >= vtkPlusLogger::LOG_LEVEL_TRACE;
-  if (plotVideoMetric)
+  LineParameters params;
+  // Seed RANSAC with the frame index, so the result of a frame does not depend on which thread processed it
+  ComputeLineParameters(workspace, frameNumber, params);
+  if (!params.lineDetected)
   {
-    PlotDoubleArray(m_SignalValues);
+    LOG_DEBUG("Unable to compute line parameters for frame " << frameNumber);
+    return;
+  }
+  if (params.lineDirectionVector_Image[0] < MIN_X_SLOPE_COMPONENT_FOR_DETECTED_LINE)
+  {
+    // Line is close to vertical, skip frame because intersection of
+    // line with image's horizontal half point is unstable
+    LOG_TRACE("Line on frame " << frameNumber << " is too close to vertical, skip the frame");
+    return;
   }
 
-  return PLUS_SUCCESS;
+  result.LineDetected = true;
+  result.Parameters = params;
 
-} //  End LineDetection
+  // Store the y-value of the line, when the line's x-value is half of the image's width
+  double t = (region.GetIndex()[0] + 0.5 * region.GetSize()[0] - params.lineOriginPoint_Image[0]) / params.lineDirectionVector_Image[0];
+  result.SignalValue = std::abs(params.lineOriginPoint_Image[1] + t * params.lineDirectionVector_Image[1]);
+
+  //  Store timestamp for image frame
+  result.Timestamp = trackedFrame->GetTimestamp();
+
+  if (m_SaveIntermediateImages == true)
+  {
+    SaveIntermediateImage(frameNumber, scanlineImage,
+                          params.lineOriginPoint_Image[0], params.lineOriginPoint_Image[1], params.lineDirectionVector_Image[0], params.lineDirectionVector_Image[1],
+                          numOfValidScanlines, workspace.IntensityPeakPositions);
+  }
+}
 
 //-----------------------------------------------------------------------------
-PlusStatus vtkPlusLineSegmentationAlgo::FindPeakStart(std::deque<int>& intensityProfile, int maxFromLargestArea, int startOfMaxArea, double& startOfPeak)
+PlusStatus vtkPlusLineSegmentationAlgo::FindPeakStart(const std::vector<int>& intensityProfile, int maxFromLargestArea, int startOfMaxArea, double& startOfPeak)
 {
   // Start of peak is defined as the location at which it reaches 50% of its maximum value.
   double startPeakValue = maxFromLargestArea * 0.5;
@@ -410,7 +511,7 @@ PlusStatus vtkPlusLineSegmentationAlgo::FindPeakStart(std::deque<int>& intensity
 }
 
 //-----------------------------------------------------------------------------
-PlusStatus vtkPlusLineSegmentationAlgo::FindLargestPeak(std::deque<int>& intensityProfile, int& maxFromLargestArea, int& maxFromLargestAreaIndex, int& startOfMaxArea)
+PlusStatus vtkPlusLineSegmentationAlgo::FindLargestPeak(const std::vector<int>& intensityProfile, int& maxFromLargestArea, int& maxFromLargestAreaIndex, int& startOfMaxArea)
 {
   int currentLargestArea = 0;
   int currentArea = 0;
@@ -489,7 +590,7 @@ PlusStatus vtkPlusLineSegmentationAlgo::FindLargestPeak(std::deque<int>& intensi
 }
 //-----------------------------------------------------------------------------
 
-PlusStatus vtkPlusLineSegmentationAlgo::ComputeCenterOfGravity(std::deque<int>& intensityProfile, int startOfMaxArea, double& centerOfGravity)
+PlusStatus vtkPlusLineSegmentationAlgo::ComputeCenterOfGravity(const std::vector<int>& intensityProfile, int startOfMaxArea, double& centerOfGravity)
 {
   if (intensityProfile.size() == 0)
   {
@@ -528,17 +629,17 @@ PlusStatus vtkPlusLineSegmentationAlgo::ComputeCenterOfGravity(std::deque<int>&
 }
 
 //-----------------------------------------------------------------------------
-void vtkPlusLineSegmentationAlgo::ComputeLineParameters(std::vector<itk::Point<double, 2> >& data, LineParameters& outputParameters)
+void vtkPlusLineSegmentationAlgo::ComputeLineParameters(FrameSegmentationWorkspace& workspace, unsigned int randomSeed, LineParameters& outputParameters)
 {
   outputParameters.lineDetected = false;
 
-  std::vector<double> ransacParameterResult;
-  typedef itk::PlaneParametersEstimator<DIMENSION> PlaneEstimatorType;
-  typedef itk::RANSAC<itk::Point<double, DIMENSION>, double> RANSACType;
+  std::vector<itk::Point<double, 2> >& data = workspace.IntensityPeakPositions;
+  std::vector<double>& ransacParameterResult = workspace.LineFitParameters;
+  ransacParameterResult.clear();
 
-  //create and initialize the parameter estimator
+  //initialize the parameter estimator
   double maximalDistanceFromPlane = 0.5;
-  PlaneEstimatorType::Pointer planeEstimator = PlaneEstimatorType::New();
+  FrameSegmentationWorkspace::PlaneEstimatorType::Pointer planeEstimator = workspace.PlaneEstimator;
   planeEstimator->SetDelta(maximalDistanceFromPlane);
   planeEstimator->LeastSquaresEstimate(data, ransacParameterResult);
   if (ransacParameterResult.empty())
@@ -554,10 +655,11 @@ void vtkPlusLineSegmentationAlgo::ComputeLineParameters(std::vector<itk::Point<d
     }
   }
 
-  //create and initialize the RANSAC algorithm
+  //initialize the RANSAC algorithm
   double desiredProbabilityForNoOutliers = 0.999;
-  RANSACType::Pointer ransacEstimator = RANSACType::New();
+  FrameSegmentationWorkspace::RANSACType::Pointer ransacEstimator = workspace.RansacEstimator;
 
+  ransacEstimator->SetRandomSeed(randomSeed);
   try
   {
     ransacEstimator->SetData(data);
@@ -731,7 +833,7 @@ PlusStatus vtkPlusLineSegmentationAlgo::Update()
 }
 
 //-----------------------------------------------------------------------------
-void vtkPlusLineSegmentationAlgo::PlotIntArray(const std::deque<int>& intensityValues)
+void vtkPlusLineSegmentationAlgo::PlotIntArray(const std::vector<int>& intensityValues)
 {
 #ifdef PLUS_RENDERING_ENABLED
   //  Create table
@@ -926,6 +1028,7 @@ PlusStatus vtkPlusLineSegmentationAlgo::ReadConfiguration(vtkXMLDataElement* aCo
 
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(SaveIntermediateImages, lineSegmentationElement);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(PlotIntensityProfile, lineSegmentationElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfThreads, lineSegmentationElement);
 
   this->IntermediateFilesOutputDirectory = vtkPlusConfig::GetInstance()->GetOutputDirectory();
   XML_READ_CSTRING_ATTRIBUTE_OPTIONAL(IntermediateFilesOutputDirectory, lineSegmentationElement);
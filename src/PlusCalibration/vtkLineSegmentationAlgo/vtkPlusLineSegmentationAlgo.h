@@ -9,8 +9,10 @@
 
 #include "itkImage.h"
 #include "vtkPlusCalibrationExport.h"
+#include "vtkMultiThreader.h"
 #include "vtkObject.h"
 #include <deque>
+#include <vector>
 
 //class igsioTrackedFrame; 
 //class vtkIGSIOTrackedFrameList;
@@ -81,7 +83,30 @@ public:
   vtkGetMacro(PlotIntensityProfile, bool);
   vtkSetMacro(PlotIntensityProfile, bool);
 
+  /*!
+    Number of threads used for processing the video frames. If 0 then the number of threads is set to the number of available processors.
+    Frames are always processed on a single thread if intermediate images are saved or intensity profiles are plotted.
+    The detected lines do not depend on the number of threads.
+  */
+  vtkGetMacro(NumberOfThreads, int);
+  vtkSetMacro(NumberOfThreads, int);
+
 protected:
+  /*! Scratch buffers and ITK estimator objects that are reused for all the frames processed by the same thread */
+  struct FrameSegmentationWorkspace;
+
+  /*! Segmentation result of a single frame. Results are stored by frame index, so the merged output does not depend on thread scheduling. */
+  struct FrameSegmentationResult
+  {
+    bool LineDetected;
+    LineParameters Parameters;
+    double SignalValue;
+    double Timestamp;
+  };
+
+  /*! Shared state of the frame segmentation threads */
+  struct SegmentFramesJob;
+
   vtkPlusLineSegmentationAlgo();
   virtual ~vtkPlusLineSegmentationAlgo();
 
@@ -89,15 +114,22 @@ protected:
 
   PlusStatus ComputeVideoPositionMetric();
 
-  PlusStatus FindPeakStart(std::deque<int>& intensityProfile, int maxFromLargestArea, int startOfMaxArea, double& startOfPeak);
+  /*! Detect the line on a single frame. Only the workspace and the result are modified, so it can be called concurrently for different frames. */
+  void SegmentFrame(unsigned int frameNumber, FrameSegmentationWorkspace& workspace, FrameSegmentationResult& result);
+
+  /*! Thread function that segments the frames of the list until all frames are processed */
+  static void* SegmentFramesThread(vtkMultiThreader::ThreadInfo* data);
 
-  PlusStatus FindLargestPeak(std::deque<int>& intensityProfile, int& maxFromLargestArea, int& maxFromLargestAreaIndex, int& startOfMaxArea);
+  PlusStatus FindPeakStart(const std::vector<int>& intensityProfile, int maxFromLargestArea, int startOfMaxArea, double& startOfPeak);
 
-  PlusStatus ComputeCenterOfGravity(std::deque<int>& intensityProfile, int startOfMaxArea, double& centerOfGravity);
+  PlusStatus FindLargestPeak(const std::vector<int>& intensityProfile, int& maxFromLargestArea, int& maxFromLargestAreaIndex, int& startOfMaxArea);
 
-  void ComputeLineParameters(std::vector<itk::Point<double, 2> >& data, LineParameters& outputParameters);
+  PlusStatus ComputeCenterOfGravity(const std::vector<int>& intensityProfile, int startOfMaxArea, double& centerOfGravity);
 
-  void PlotIntArray(const std::deque<int>& intensityValues);
+  /*! Fit a line on the intensity peak positions of the workspace. The RANSAC random seed is specified by the caller to make the result reproducible. */
+  void ComputeLineParameters(FrameSegmentationWorkspace& workspace, unsigned int randomSeed, LineParameters& outputParameters);
+
+  void PlotIntArray(const std::vector<int>& intensityValues);
 
   void PlotDoubleArray(const std::deque<double>& intensityValues);
 
@@ -122,6 +154,9 @@ protected:
   /*! Plot intensity profile for each scanline. Enable for debugging. */
   bool PlotIntensityProfile;
 
+  /*! Number of threads used for processing the video frames (0 = number of available processors) */
+  int NumberOfThreads;
+
   double m_SignalTimeRangeMin;
   double m_SignalTimeRangeMax;
 
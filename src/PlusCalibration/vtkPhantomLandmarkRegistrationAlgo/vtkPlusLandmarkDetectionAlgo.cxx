@@ -12,12 +12,42 @@ See License.txt for details.
 
 #include "vtkMatrix4x4.h"
 
+#include <algorithm>
+
 vtkStandardNewMacro( vtkPlusLandmarkDetectionAlgo );
 
 //-----------------------------------------------------------------------------
 // Default algorithm parameters
 static const double PERCENTAGE_WINDOWS_SKIP = 0.1;//The first windows detected as pivoting wont be used for averaging.
 
+//-----------------------------------------------------------------------------
+vtkPlusLandmarkDetectionAlgo::StylusTipPositionSums::StylusTipPositionSums()
+{
+  this->Clear();
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusLandmarkDetectionAlgo::StylusTipPositionSums::Clear()
+{
+  this->NumberOfSamples = 0;
+  for ( int i = 0; i < 3; i++ )
+  {
+    this->PositionSum_Reference[i] = 0.0;
+    this->PositionSquaredSum_Reference[i] = 0.0;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusLandmarkDetectionAlgo::StylusTipPositionSums::Add( const StylusTipPositionSums& other )
+{
+  this->NumberOfSamples += other.NumberOfSamples;
+  for ( int i = 0; i < 3; i++ )
+  {
+    this->PositionSum_Reference[i] += other.PositionSum_Reference[i];
+    this->PositionSquaredSum_Reference[i] += other.PositionSquaredSum_Reference[i];
+  }
+}
+
 //-----------------------------------------------------------------------------
 vtkPlusLandmarkDetectionAlgo::vtkPlusLandmarkDetectionAlgo()
 {
@@ -30,12 +60,16 @@ vtkPlusLandmarkDetectionAlgo::vtkPlusLandmarkDetectionAlgo()
   this->StylusShaftMinimumDisplacementThresholdMm = 30;
   this->StylusTipMaximumDisplacementThresholdMm = 1.5;
   this->MinimunDistanceBetweenLandmarksMm = 15.0;
+
+  this->CompletedWindowSumsRingNextIndex = 0;
+  this->NumberOfAcquiredWindows = 0;
+  this->LandmarkGridCellSizeMm = 0.0;
+  this->LandmarkGridNumberOfLandmarks = 0;
 }
 
 //-----------------------------------------------------------------------------
 vtkPlusLandmarkDetectionAlgo::~vtkPlusLandmarkDetectionAlgo()
 {
-  this->StylusTipToReferenceTransformsDeque.clear();
   this->SetDetectedLandmarkPoints_Reference( NULL );
 }
 
@@ -129,15 +163,47 @@ PlusStatus vtkPlusLandmarkDetectionAlgo::ComputeNumberOfWindows( unsigned int& n
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusLandmarkDetectionAlgo::ComputeNumberOfEstimationWindows( unsigned int& numberOfEstimationWindows )
+{
+  unsigned int numberOfRequiredWindows = 0;
+  if ( ComputeNumberOfWindows( numberOfRequiredWindows ) == PLUS_FAIL )
+  {
+    return PLUS_FAIL;
+  }
+  unsigned int numberOfWindowsSkip = static_cast<unsigned int>( igsioMath::Round( numberOfRequiredWindows * PERCENTAGE_WINDOWS_SKIP ) );
+  if ( numberOfWindowsSkip >= numberOfRequiredWindows )
+  {
+    numberOfWindowsSkip = numberOfRequiredWindows - 1;
+  }
+  numberOfEstimationWindows = numberOfRequiredWindows - numberOfWindowsSkip;
+  return PLUS_SUCCESS;
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusLandmarkDetectionAlgo::ResetDetection()
 {
   LOG_DEBUG( "Reset" );
-  this->StylusTipToReferenceTransformsDeque.clear();
+  this->RestartLandmarkDetection();
   this->DetectedLandmarkPoints_Reference->Reset();
+  this->RebuildLandmarkGrid();
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+void vtkPlusLandmarkDetectionAlgo::RestartLandmarkDetection()
+{
+  this->StylusTipPathBoundingBox.Reset();
+  this->StylusShaftPathBoundingBox.Reset();
+  this->CurrentWindowSums.Clear();
+  for ( std::vector<StylusTipPositionSums>::iterator windowIt = this->CompletedWindowSumsRing.begin(); windowIt != this->CompletedWindowSumsRing.end(); ++windowIt )
+  {
+    windowIt->Clear();
+  }
+  this->CompletedWindowSumsRingNextIndex = 0;
+  this->NumberOfAcquiredWindows = 0;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusLandmarkDetectionAlgo::DeleteLastLandmark()
 {
@@ -147,6 +213,7 @@ PlusStatus vtkPlusLandmarkDetectionAlgo::DeleteLastLandmark()
     return PLUS_FAIL;
   }
   this->DetectedLandmarkPoints_Reference->GetData()->RemoveTuple( this->DetectedLandmarkPoints_Reference->GetNumberOfPoints() - 1 );
+  this->RebuildLandmarkGrid();
   return PLUS_SUCCESS;
 }
 
@@ -159,7 +226,8 @@ PlusStatus vtkPlusLandmarkDetectionAlgo::InsertLandmark_Reference( double stylus
     LOG_INFO( "No landmark inserted, landmark #" << existingLandmarkId << " was already detected" );
     return PLUS_SUCCESS;
   }
-  this->DetectedLandmarkPoints_Reference->InsertNextPoint( stylusTipPosition_Reference );
+  int landmarkId = this->DetectedLandmarkPoints_Reference->InsertNextPoint( stylusTipPosition_Reference );
+  this->AddLandmarkToGrid( landmarkId, stylusTipPosition_Reference );
   return PLUS_SUCCESS;
 }
 
@@ -172,30 +240,15 @@ PlusStatus vtkPlusLandmarkDetectionAlgo::FilterStylusTipPositionsWindow( double
     return PLUS_FAIL;
   }
 
-  if( this->StylusTipToReferenceTransformsDeque.size() < filterWindowSize )
+  if( this->CurrentWindowSums.NumberOfSamples < filterWindowSize )
   {
     LOG_ERROR( "There are not enough stylus tip positions acquired yet" );
     return PLUS_FAIL;
   }
 
-  std::deque< vtkSmartPointer<vtkMatrix4x4> >::iterator stylusTipToReferenceTransformIt = this->StylusTipToReferenceTransformsDeque.end();
-  double stylusTipPositionSum_Reference[4] = {0, 0, 0, 1};
-  for( unsigned int i = 0; i < filterWindowSize; i++ )
-  {
-    stylusTipToReferenceTransformIt--;
-    stylusTipPositionSum_Reference[0] += ( *stylusTipToReferenceTransformIt )->Element[0][3];
-    stylusTipPositionSum_Reference[1] += ( *stylusTipToReferenceTransformIt )->Element[1][3];
-    stylusTipPositionSum_Reference[2] += ( *stylusTipToReferenceTransformIt )->Element[2][3];
-  }
-  //make sure we don't divide by zero
-  if( filterWindowSize == 0 )
-  {
-    LOG_ERROR( "Filter window size is zero can not be used, how does it happened!" );
-    return PLUS_FAIL;
-  }
-  stylusTipFiltered_Reference[0] = stylusTipPositionSum_Reference[0] / filterWindowSize;
-  stylusTipFiltered_Reference[1] = stylusTipPositionSum_Reference[1] / filterWindowSize;
-  stylusTipFiltered_Reference[2] = stylusTipPositionSum_Reference[2] / filterWindowSize;
+  stylusTipFiltered_Reference[0] = this->CurrentWindowSums.PositionSum_Reference[0] / this->CurrentWindowSums.NumberOfSamples;
+  stylusTipFiltered_Reference[1] = this->CurrentWindowSums.PositionSum_Reference[1] / this->CurrentWindowSums.NumberOfSamples;
+  stylusTipFiltered_Reference[2] = this->CurrentWindowSums.PositionSum_Reference[2] / this->CurrentWindowSums.NumberOfSamples;
   stylusTipFiltered_Reference[3] = 1.0;
   return PLUS_SUCCESS;
 }
@@ -210,17 +263,31 @@ PlusStatus vtkPlusLandmarkDetectionAlgo::InsertNextStylusTipToReferenceTransform
     return PLUS_FAIL;
   }
 
-  this->StylusTipToReferenceTransformsDeque.push_back( stylusTipToReferenceTransform );
-
   unsigned int filterWindowSize = 0;
   unsigned int numberOfRequiredWindows = 0;
-  if ( ComputeFilterWindowSize( filterWindowSize ) == PLUS_FAIL || ComputeNumberOfWindows( numberOfRequiredWindows ) == PLUS_FAIL )
+  unsigned int numberOfEstimationWindows = 0;
+  if ( ComputeFilterWindowSize( filterWindowSize ) == PLUS_FAIL || ComputeNumberOfWindows( numberOfRequiredWindows ) == PLUS_FAIL
+       || ComputeNumberOfEstimationWindows( numberOfEstimationWindows ) == PLUS_FAIL )
   {
     return PLUS_FAIL;
   }
+  if ( this->CompletedWindowSumsRing.size() != numberOfEstimationWindows )
+  {
+    // Detection parameters have been changed, start from scratch
+    this->CompletedWindowSumsRing.resize( numberOfEstimationWindows );
+    this->RestartLandmarkDetection();
+  }
+
+  for ( int i = 0; i < 3; i++ )
+  {
+    double stylusTipPosition = stylusTipToReferenceTransform->Element[i][3];
+    this->CurrentWindowSums.PositionSum_Reference[i] += stylusTipPosition;
+    this->CurrentWindowSums.PositionSquaredSum_Reference[i] += stylusTipPosition * stylusTipPosition;
+  }
+  this->CurrentWindowSums.NumberOfSamples++;
+  LOG_TRACE( "P( " << stylusTipToReferenceTransform->Element[0][3] << ", " << stylusTipToReferenceTransform->Element[1][3] << ", " << stylusTipToReferenceTransform->Element[2][3] << ")" );
 
-  bool windowCompleted = ( this->StylusTipToReferenceTransformsDeque.size() % filterWindowSize ) == 0;
-  if ( !windowCompleted )
+  if ( this->CurrentWindowSums.NumberOfSamples < filterWindowSize )
   {
     // just keep collecting more data
     return PLUS_SUCCESS;
@@ -243,25 +310,13 @@ PlusStatus vtkPlusLandmarkDetectionAlgo::InsertNextStylusTipToReferenceTransform
   stylusTipToReferenceTransform->MultiplyPoint( StylusShaftPoint_StylusTip, StylusShaftPoint_Reference );
   this->StylusShaftPathBoundingBox.AddPoint( StylusShaftPoint_Reference );
 
-  unsigned int numberOfAcquiredWindows = igsioMath::Floor( this->StylusTipToReferenceTransformsDeque.size() / filterWindowSize );
+  // Move the window into the ring of completed windows (overwriting the oldest one)
+  this->CompletedWindowSumsRing[this->CompletedWindowSumsRingNextIndex] = this->CurrentWindowSums;
+  this->CompletedWindowSumsRingNextIndex = ( this->CompletedWindowSumsRingNextIndex + 1 ) % this->CompletedWindowSumsRing.size();
+  this->CurrentWindowSums.Clear();
+  this->NumberOfAcquiredWindows++;
 
-  // Print all available StylusTipToReferenceTransform positions if debug level is TRACE
-  bool debugOutput = vtkPlusLogger::Instance()->GetLogLevel() >= vtkPlusLogger::LOG_LEVEL_TRACE;
-  if ( debugOutput )
-  {
-    LOG_TRACE( "Window Landmark (" << stylusTipFiltered_Reference[0] << ", " << stylusTipFiltered_Reference[1] << ", " << stylusTipFiltered_Reference[2] << ") found keep going" );
-    int i = 0;
-    for ( std::deque< vtkSmartPointer<vtkMatrix4x4> >::iterator markerToReferenceTransformIt = this->StylusTipToReferenceTransformsDeque.begin();
-          markerToReferenceTransformIt != this->StylusTipToReferenceTransformsDeque.end(); ++markerToReferenceTransformIt )
-    {
-      if( i % filterWindowSize == 0 )
-      {
-        LOG_TRACE( "Window " << ( i / filterWindowSize ) << ":" );
-      }
-      LOG_TRACE( "P( " << -( *markerToReferenceTransformIt )->Element[0][3] << ", " << -( *markerToReferenceTransformIt )->Element[1][3] << ", " << -( *markerToReferenceTransformIt )->Element[2][3] << ")" );
-      i++;
-    }
-  }
+  LOG_TRACE( "Window " << this->NumberOfAcquiredWindows - 1 << " Landmark (" << stylusTipFiltered_Reference[0] << ", " << stylusTipFiltered_Reference[1] << ", " << stylusTipFiltered_Reference[2] << ") found keep going" );
 
   // If tip is moved then clear transforms and start detection of the latest landmark from scratch
   double stylusTipPathBoundingBoxSize[3] = {0};
@@ -269,14 +324,12 @@ PlusStatus vtkPlusLandmarkDetectionAlgo::InsertNextStylusTipToReferenceTransform
   if( vtkMath::Norm( stylusTipPathBoundingBoxSize ) > this->StylusTipMaximumDisplacementThresholdMm )
   {
     LOG_TRACE( "StylusTip has moved: StylusTipBoundingBox norm = " << vtkMath::Norm( stylusTipPathBoundingBoxSize ) );
-    this->StylusTipToReferenceTransformsDeque.clear();
-    this->StylusShaftPathBoundingBox.Reset();
-    this->StylusTipPathBoundingBox.Reset();
+    this->RestartLandmarkDetection();
     return PLUS_SUCCESS;
   }
 
   // If enough rotation range has been covered and we collected enough windows then we accept this as a new landmark point
-  if( numberOfAcquiredWindows < numberOfRequiredWindows )
+  if( this->NumberOfAcquiredWindows < numberOfRequiredWindows )
   {
     // not enough windows yet
     // just keep collecting more data
@@ -296,9 +349,7 @@ PlusStatus vtkPlusLandmarkDetectionAlgo::InsertNextStylusTipToReferenceTransform
   int numberOfLandmarksBefore = this->DetectedLandmarkPoints_Reference->GetNumberOfPoints();
 
   EstimateLandmarkPosition();
-  this->StylusTipPathBoundingBox.Reset();
-  this->StylusShaftPathBoundingBox.Reset();
-  this->StylusTipToReferenceTransformsDeque.clear();
+  this->RestartLandmarkDetection();
 
   if( numberOfLandmarksBefore != this->DetectedLandmarkPoints_Reference->GetNumberOfPoints() )
   {
@@ -308,70 +359,120 @@ PlusStatus vtkPlusLandmarkDetectionAlgo::InsertNextStylusTipToReferenceTransform
 }
 
 //----------------------------------------------------------------------------
-int vtkPlusLandmarkDetectionAlgo::GetNearExistingLandmarkId( double stylusTipPosition_Reference[4] )
+long long vtkPlusLandmarkDetectionAlgo::GetLandmarkGridKey( int cellIndexX, int cellIndexY, int cellIndexZ )
 {
-  double detectedLandmark_Reference[4] = {0, 0, 0, 1};
-  double landmarkDifference_Reference[4] = {0, 0, 0, 0};
-  for( int id = 0; id < this->DetectedLandmarkPoints_Reference->GetNumberOfPoints(); id++ )
+  // 21 bits per axis, which is enough for any tracker volume
+  const long long mask = 0x1FFFFF;
+  return ( ( static_cast<long long>( cellIndexX ) & mask ) << 42 ) | ( ( static_cast<long long>( cellIndexY ) & mask ) << 21 ) | ( static_cast<long long>( cellIndexZ ) & mask );
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusLandmarkDetectionAlgo::AddLandmarkToGrid( int landmarkId, const double landmark_Reference[3] )
+{
+  if ( this->LandmarkGridCellSizeMm <= 0 )
   {
-    this->DetectedLandmarkPoints_Reference->GetPoint( id, detectedLandmark_Reference );
-    landmarkDifference_Reference[0] = detectedLandmark_Reference[0] - stylusTipPosition_Reference[0];
-    landmarkDifference_Reference[1] = detectedLandmark_Reference[1] - stylusTipPosition_Reference[1];
-    landmarkDifference_Reference[2] = detectedLandmark_Reference[2] - stylusTipPosition_Reference[2];
-    landmarkDifference_Reference[3] = detectedLandmark_Reference[3] - stylusTipPosition_Reference[3];
-    if( vtkMath::Norm( landmarkDifference_Reference ) < this->MinimunDistanceBetweenLandmarksMm / 3 )
-    {
-      return id;
-    }
+    // no landmark can be near to another one
+    this->LandmarkGridNumberOfLandmarks++;
+    return;
   }
-  return -1;
+  long long key = GetLandmarkGridKey( static_cast<int>( floor( landmark_Reference[0] / this->LandmarkGridCellSizeMm ) ),
+                                      static_cast<int>( floor( landmark_Reference[1] / this->LandmarkGridCellSizeMm ) ),
+                                      static_cast<int>( floor( landmark_Reference[2] / this->LandmarkGridCellSizeMm ) ) );
+  this->LandmarkGrid[key].push_back( landmarkId );
+  this->LandmarkGridNumberOfLandmarks++;
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusLandmarkDetectionAlgo::EstimateLandmarkPosition()
+void vtkPlusLandmarkDetectionAlgo::RebuildLandmarkGrid()
 {
-  unsigned int filterWindowSize = 0;
-  unsigned int numberOfRequiredWindows = 0;
-  if ( ComputeFilterWindowSize( filterWindowSize ) == PLUS_FAIL || ComputeNumberOfWindows( numberOfRequiredWindows ) == PLUS_FAIL )
+  this->LandmarkGrid.clear();
+  this->LandmarkGridNumberOfLandmarks = 0;
+  this->LandmarkGridCellSizeMm = this->MinimunDistanceBetweenLandmarksMm / 3;
+  double landmark_Reference[3] = {0, 0, 0};
+  for( int id = 0; id < this->DetectedLandmarkPoints_Reference->GetNumberOfPoints(); id++ )
   {
-    return PLUS_FAIL;
+    this->DetectedLandmarkPoints_Reference->GetPoint( id, landmark_Reference );
+    this->AddLandmarkToGrid( id, landmark_Reference );
   }
+}
 
-  int numberOfWindowsSkip = filterWindowSize = igsioMath::Round( numberOfRequiredWindows * PERCENTAGE_WINDOWS_SKIP );
-  if( filterWindowSize < 1 )
+//----------------------------------------------------------------------------
+int vtkPlusLandmarkDetectionAlgo::GetNearExistingLandmarkId( double stylusTipPosition_Reference[4] )
+{
+  // The grid is rebuilt if the landmark points or the distance threshold were changed directly
+  double nearDistanceMm = this->MinimunDistanceBetweenLandmarksMm / 3;
+  if ( this->LandmarkGridCellSizeMm != nearDistanceMm || this->LandmarkGridNumberOfLandmarks != this->DetectedLandmarkPoints_Reference->GetNumberOfPoints() )
   {
-    LOG_WARNING( "The smallest number of windows to skip is set to 1" );
-    filterWindowSize = 1;
+    this->RebuildLandmarkGrid();
+  }
+  if ( nearDistanceMm <= 0 )
+  {
+    return -1;
   }
 
-  unsigned int i = 0;
-  std::vector<double> values[4];
-  for ( std::deque< vtkSmartPointer<vtkMatrix4x4> >::iterator stylusTipToReferenceTransformIt = this->StylusTipToReferenceTransformsDeque.begin();
-        stylusTipToReferenceTransformIt != this->StylusTipToReferenceTransformsDeque.end(); ++stylusTipToReferenceTransformIt )
+  // Cell size is the same as the distance threshold, so only the neighbor cells have to be checked
+  int cellIndex[3] = {0, 0, 0};
+  for ( int i = 0; i < 3; i++ )
+  {
+    cellIndex[i] = static_cast<int>( floor( stylusTipPosition_Reference[i] / this->LandmarkGridCellSizeMm ) );
+  }
+  int nearestId = -1;
+  double detectedLandmark_Reference[3] = {0, 0, 0};
+  for ( int x = cellIndex[0] - 1; x <= cellIndex[0] + 1; x++ )
   {
-    //Don't use first numberOfWindowsSkip windows
-    if( i >= ( filterWindowSize * numberOfWindowsSkip ) && i < ( numberOfRequiredWindows )*filterWindowSize )
+    for ( int y = cellIndex[1] - 1; y <= cellIndex[1] + 1; y++ )
     {
-      double sylusTip_Reference[3] = {( *stylusTipToReferenceTransformIt )->Element[0][3], ( *stylusTipToReferenceTransformIt )->Element[1][3], ( *stylusTipToReferenceTransformIt )->Element[2][3]};
-      values[0].push_back( sylusTip_Reference[0] );
-      values[1].push_back( sylusTip_Reference[1] );
-      values[2].push_back( sylusTip_Reference[2] );
-      values[3].push_back( vtkMath::Norm( sylusTip_Reference ) );
+      for ( int z = cellIndex[2] - 1; z <= cellIndex[2] + 1; z++ )
+      {
+        std::map< long long, std::vector<int> >::iterator cellIt = this->LandmarkGrid.find( GetLandmarkGridKey( x, y, z ) );
+        if ( cellIt == this->LandmarkGrid.end() )
+        {
+          continue;
+        }
+        for ( std::vector<int>::iterator idIt = cellIt->second.begin(); idIt != cellIt->second.end(); ++idIt )
+        {
+          // the lowest id is returned if there are multiple near landmarks
+          if ( nearestId >= 0 && *idIt > nearestId )
+          {
+            continue;
+          }
+          this->DetectedLandmarkPoints_Reference->GetPoint( *idIt, detectedLandmark_Reference );
+          if( sqrt( vtkMath::Distance2BetweenPoints( detectedLandmark_Reference, stylusTipPosition_Reference ) ) < nearDistanceMm )
+          {
+            nearestId = *idIt;
+          }
+        }
+      }
     }
-    i++;
   }
+  return nearestId;
+}
 
-  if( values[0].size() != ( numberOfRequiredWindows - numberOfWindowsSkip )*filterWindowSize )
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusLandmarkDetectionAlgo::EstimateLandmarkPosition()
+{
+  if ( this->CompletedWindowSumsRing.empty() || this->NumberOfAcquiredWindows < this->CompletedWindowSumsRing.size() )
   {
-    LOG_ERROR( "Not right number of points to estimate landmark position" ); //LOG error and do something CLEAR?
+    LOG_ERROR( "Not right number of points to estimate landmark position" );
     return PLUS_FAIL;
   }
 
+  // The ring contains the last windows, the first (skipped) windows of the detection time have been already overwritten
+  StylusTipPositionSums estimationSums;
+  for ( std::vector<StylusTipPositionSums>::iterator windowIt = this->CompletedWindowSumsRing.begin(); windowIt != this->CompletedWindowSumsRing.end(); ++windowIt )
+  {
+    estimationSums.Add( *windowIt );
+  }
+
   double stylusTipMean_Reference[4] = {0, 0, 0, 1};
-  double stylusTipStdev_Reference[4] = {0, 0, 0, 0};
-  for ( int j = 0; j < 4; ++j )
+  double stylusTipStdev_Reference[3] = {0, 0, 0};
+  double stylusTipVarianceSum = 0;
+  for ( int j = 0; j < 3; ++j )
   {
-    igsioMath::ComputeMeanAndStdev( values[j], stylusTipMean_Reference[j], stylusTipStdev_Reference[j] );
+    stylusTipMean_Reference[j] = estimationSums.PositionSum_Reference[j] / estimationSums.NumberOfSamples;
+    double variance = estimationSums.PositionSquaredSum_Reference[j] / estimationSums.NumberOfSamples - stylusTipMean_Reference[j] * stylusTipMean_Reference[j];
+    stylusTipVarianceSum += std::max( 0.0, variance );
+    stylusTipStdev_Reference[j] = sqrt( std::max( 0.0, variance ) );
   }
   int existingLandmarkId = GetNearExistingLandmarkId( stylusTipMean_Reference );
   if ( existingLandmarkId != -1 )
@@ -379,26 +480,13 @@ PlusStatus vtkPlusLandmarkDetectionAlgo::EstimateLandmarkPosition()
     LOG_INFO( "Landmark #" << existingLandmarkId << " was already detected" );
     return PLUS_SUCCESS;
   }
-  this->DetectedLandmarkPoints_Reference->InsertNextPoint( stylusTipMean_Reference );
+  int landmarkId = this->DetectedLandmarkPoints_Reference->InsertNextPoint( stylusTipMean_Reference );
+  this->AddLandmarkToGrid( landmarkId, stylusTipMean_Reference );
 
-  LOG_DEBUG( "Stylus tip positions used for detection" );
+  LOG_DEBUG( "Stylus tip positions used for detection: " << estimationSums.NumberOfSamples );
   LOG_DEBUG( "Stylus tips STD deviation ( " << stylusTipStdev_Reference[0] << ", " << stylusTipStdev_Reference[1] << ", " << stylusTipStdev_Reference[2] << ") Norm = " << vtkMath::Norm( stylusTipStdev_Reference ) );
-  LOG_DEBUG( "Stylus tips Magnitude STD deviation " << stylusTipStdev_Reference[3] );
-
-  //compute the mean vector, compute the magnitude of error vector, get stats for this magnitude
-  std::vector<double> sylusTipsToMeanVectorsMagnitude;
-  for( unsigned int j = 0; j < values[0].size(); j++ )
-  {
-    double sylusTipToMeanVector[3] = {stylusTipMean_Reference[0] - values[0][j], stylusTipMean_Reference[1] - values[1][j], stylusTipMean_Reference[2] - values[2][j]};
-    sylusTipsToMeanVectorsMagnitude.push_back( vtkMath::Norm( sylusTipToMeanVector ) );
-  }
-
-  double stylusVectorsMagnitudeMean = 0;
-  double stylusVectorsMagnitudeStdev = 0;
-  igsioMath::ComputeMeanAndStdev( sylusTipsToMeanVectorsMagnitude, stylusVectorsMagnitudeMean, stylusVectorsMagnitudeStdev );
   LOG_DEBUG( "Error magnitude = ||StylusTipsMean-StylusTip||" );
-  LOG_DEBUG( "Error magnitude Mean = " << stylusVectorsMagnitudeMean );
-  LOG_DEBUG( "Error magnitude STD deviation = " << stylusVectorsMagnitudeStdev );
+  LOG_DEBUG( "Error magnitude RMS = " << sqrt( stylusTipVarianceSum ) );
 
   return PLUS_SUCCESS;
 }
@@ -14,9 +14,8 @@ See License.txt for details.
 #include "vtkPoints.h"
 #include "vtkBoundingBox.h"
 
-#include <list>
-#include <deque>
-#include <set>
+#include <map>
+#include <vector>
 
 class vtkMatrix4x4;
 //class vtkIGSIOTransformRepository;
@@ -28,6 +27,8 @@ class vtkXMLDataElement;
 \class vtkPlusLandmarkDetectionAlgo
 \brief Landmark detection algorithm detects when a calibrated stylus is pivoting around its tip.
 The stylus pivoting point (landmark) is computed assuming that the stylus is calibrated.
+Samples are not stored: only running sums of the current filter window and of the last few completed windows (in a fixed size ring)
+are kept, therefore processing time of a sample does not depend on the acquisition rate or on the length of the session.
 \ingroup PlusLibCalibrationAlgorithm
 */
 class vtkPlusCalibrationExport vtkPlusLandmarkDetectionAlgo : public vtkObject
@@ -125,14 +126,37 @@ protected:
   PlusStatus EstimateLandmarkPosition();
 
   /*!
-    During detection time windows of stylus tip positions are filtered. When a pivot is detected or the stylus tip position is outside the bounding box threshold.
-    Then all the points acquired,except the last window, will be erased.
+    Number of completed windows that the landmark position is estimated from (the first windows of the detection
+    time are skipped, as the stylus tip may not be stable yet).
   */
-  PlusStatus KeepLastWindow();
+  PlusStatus ComputeNumberOfEstimationWindows( unsigned int& numberOfEstimationWindows );
 
   /* Computes the average of the stylus tip positions in the last FilterWindowSize samples.*/
   PlusStatus FilterStylusTipPositionsWindow( double stylusTipFiltered_Reference[4] );
 
+  /*! Discard the collected samples and start detection of the next landmark from scratch (detected landmarks are kept) */
+  void RestartLandmarkDetection();
+
+  /*! Add a landmark to the spatial hash that is used for finding nearby landmarks */
+  void AddLandmarkToGrid( int landmarkId, const double landmark_Reference[3] );
+
+  /*! Rebuild the spatial hash from the detected landmark points */
+  void RebuildLandmarkGrid();
+
+  /*! Get the spatial hash key of a grid cell */
+  static long long GetLandmarkGridKey( int cellIndexX, int cellIndexY, int cellIndexZ );
+
+  /*! Running sums of stylus tip positions */
+  struct StylusTipPositionSums
+  {
+    StylusTipPositionSums();
+    void Clear();
+    void Add( const StylusTipPositionSums& other );
+    unsigned int NumberOfSamples;
+    double PositionSum_Reference[3];
+    double PositionSquaredSum_Reference[3];
+  };
+
 protected:
   /*! The detected landmark point position(s)(defined in the reference coordinate system).*/
   vtkPoints* DetectedLandmarkPoints_Reference;
@@ -164,8 +188,19 @@ protected:
     StylusTipMaximumDisplacementThresholdMm a landmark is detected.
   */
   vtkBoundingBox StylusTipPathBoundingBox;
-  /*! Double ended queue the input point transformations. These are used for determining the next landmark (once the landmark is detected this list is cleared).*/
-  std::deque< vtkSmartPointer<vtkMatrix4x4> > StylusTipToReferenceTransformsDeque;
+  /*! Running sums of the stylus tip positions in the current (not yet completed) filter window. */
+  StylusTipPositionSums CurrentWindowSums;
+  /*! Running sums of the last completed filter windows, in a ring of NumberOfEstimationWindows items. These are used for estimating the landmark position. */
+  std::vector<StylusTipPositionSums> CompletedWindowSumsRing;
+  /*! Index of the ring item that the next completed window will overwrite. */
+  unsigned int CompletedWindowSumsRingNextIndex;
+  /*! Number of completed filter windows since the detection of the current landmark was started. */
+  unsigned int NumberOfAcquiredWindows;
+
+  /*! Detected landmark ids, hashed by grid cell (cell size is the distance within a position is considered to be an existing landmark). */
+  std::map< long long, std::vector<int> > LandmarkGrid;
+  double LandmarkGridCellSizeMm;
+  int LandmarkGridNumberOfLandmarks;
 };
 
 #endif
@@ -16,8 +16,22 @@
 #include "vtkMath.h"
 #include "vtksys/SystemTools.hxx"
 
+#include "vnl/algo/vnl_svd.h"
+
+#include <algorithm>
+
 vtkStandardNewMacro(vtkPlusPivotCalibrationAlgo);
 
+namespace
+{
+  // Outlier rejection of the incremental calibration only starts when errors of this many samples are available,
+  // as error statistics of just a few samples are not reliable
+  const unsigned int MINIMUM_NUMBER_OF_INCREMENTAL_WINDOW_SAMPLES = 20;
+  // The incremental estimate is not reported while the normal matrix is close to singular (e.g., until the marker is rotated around at least two axes)
+  const double INCREMENTAL_NORMAL_MATRIX_CONDITION_TOLERANCE = 1e-5;
+  const unsigned int NUMBER_OF_UNKNOWNS = 6;
+}
+
 //-----------------------------------------------------------------------------
 vtkPlusPivotCalibrationAlgo::vtkPlusPivotCalibrationAlgo()
 {
@@ -31,6 +45,11 @@ vtkPlusPivotCalibrationAlgo::vtkPlusPivotCalibrationAlgo()
   this->PivotPointPosition_Reference[1] = 0.0;
   this->PivotPointPosition_Reference[2] = 0.0;
   this->PivotPointPosition_Reference[3] = 1.0;
+
+  this->IncrementalOutlierWindowSize = 50;
+  this->IncrementalOutlierThreshold = 3.0;
+  this->NumberOfIncrementalOutliers = 0;
+  this->ResetIncrementalCalibration();
 }
 
 //-----------------------------------------------------------------------------
@@ -43,20 +62,258 @@ vtkPlusPivotCalibrationAlgo::~vtkPlusPivotCalibrationAlgo()
 //-----------------------------------------------------------------------------
 void vtkPlusPivotCalibrationAlgo::RemoveAllCalibrationPoints()
 {
-  for (std::list<vtkMatrix4x4*>::iterator it = this->MarkerToReferenceTransformMatrixArray.begin(); it != this->MarkerToReferenceTransformMatrixArray.end(); ++it)
-  {
-    (*it)->Delete();
-  }
-  this->MarkerToReferenceTransformMatrixArray.clear();
+  this->MarkerToReferenceTransformSamples.clear();
   this->OutlierIndices.clear();
+  this->NumberOfIncrementalOutliers = 0;
+  this->ResetIncrementalCalibration();
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusPivotCalibrationAlgo::InsertNextCalibrationPoint(vtkMatrix4x4* aMarkerToReferenceTransformMatrix)
 {
-  vtkMatrix4x4* markerToReferenceTransformMatrixCopy = vtkMatrix4x4::New();
-  markerToReferenceTransformMatrixCopy->DeepCopy(aMarkerToReferenceTransformMatrix);
-  this->MarkerToReferenceTransformMatrixArray.push_back(markerToReferenceTransformMatrixCopy);
+  if (aMarkerToReferenceTransformMatrix == NULL)
+  {
+    LOG_ERROR("Failed to insert pivot calibration point: invalid marker to reference transform");
+    return PLUS_FAIL;
+  }
+
+  MarkerToReferenceTransformSample sample;
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 4; j++)
+    {
+      sample.Element[i][j] = aMarkerToReferenceTransformMatrix->Element[i][j];
+    }
+  }
+  this->MarkerToReferenceTransformSamples.push_back(sample);
+
+  this->UpdateIncrementalCalibration(this->MarkerToReferenceTransformSamples.size() - 1);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusPivotCalibrationAlgo::ResetIncrementalCalibration()
+{
+  this->IncrementalNormalMatrix.set_size(NUMBER_OF_UNKNOWNS, NUMBER_OF_UNKNOWNS);
+  this->IncrementalNormalMatrix.fill(0.0);
+  this->IncrementalNormalVector.set_size(NUMBER_OF_UNKNOWNS);
+  this->IncrementalNormalVector.fill(0.0);
+  this->IncrementalSquaredNormB = 0.0;
+  this->NumberOfIncrementalSamples = 0;
+  this->NumberOfSuccessiveIncrementalOutliers = 0;
+
+  this->IncrementalSolution.set_size(NUMBER_OF_UNKNOWNS);
+  this->IncrementalSolution.fill(0.0);
+  this->IncrementalSolutionValid = false;
+  this->IncrementalCalibrationError = -1.0;
+
+  this->IncrementalOutlierRejectionActive = false;
+  this->IncrementalInitialSampleIndices.clear();
+  this->IncrementalErrorWindow.clear();
+  this->IncrementalErrorWindowSum = 0.0;
+  this->IncrementalErrorWindowSumSquares = 0.0;
+}
+
+//----------------------------------------------------------------------------
+/*
+Each sample adds 3 rows to the Ax=b problem described at GetPivotPointPosition:
+ Ai = [ R | -I ], bi = -t
+where R and t are the rotation and translation of the MarkerToReference transform. The normal equations are accumulated as
+ A^T*A += [ R^T*R  -R^T ]    A^T*b += [ -R^T*t ]    b^T*b += t^T*t
+          [ -R      I   ]             [  t     ]
+so the running least squares solution can be computed by solving a 6x6 system, independently of the number of samples.
+A sample can be removed from the solution by accumulating it with -1 weight.
+*/
+void vtkPlusPivotCalibrationAlgo::AccumulateIncrementalSample(const MarkerToReferenceTransformSample& sample, double weight)
+{
+  const double(*m)[4] = sample.Element;
+  for (int r = 0; r < 3; r++)
+  {
+    for (int c = 0; c < 3; c++)
+    {
+      this->IncrementalNormalMatrix(r, c) += weight * (m[0][r] * m[0][c] + m[1][r] * m[1][c] + m[2][r] * m[2][c]);
+      this->IncrementalNormalMatrix(r, 3 + c) -= weight * m[c][r];
+      this->IncrementalNormalMatrix(3 + r, c) -= weight * m[r][c];
+    }
+    this->IncrementalNormalMatrix(3 + r, 3 + r) += weight;
+    this->IncrementalNormalVector[r] -= weight * (m[0][r] * m[0][3] + m[1][r] * m[1][3] + m[2][r] * m[2][3]);
+    this->IncrementalNormalVector[3 + r] += weight * m[r][3];
+    this->IncrementalSquaredNormB += weight * m[r][3] * m[r][3];
+  }
+  this->NumberOfIncrementalSamples += (weight > 0 ? 1 : -1);
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusPivotCalibrationAlgo::ComputeIncrementalSampleError(const MarkerToReferenceTransformSample& sample)
+{
+  const double(*m)[4] = sample.Element;
+  const vnl_vector<double>& x = this->IncrementalSolution;
+  double pivotPointError[3] = {0, 0, 0};
+  for (int i = 0; i < 3; i++)
+  {
+    pivotPointError[i] = m[i][0] * x[0] + m[i][1] * x[1] + m[i][2] * x[2] + m[i][3] - x[3 + i];
+  }
+  return vtkMath::Norm(pivotPointError);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusPivotCalibrationAlgo::AddIncrementalErrorToWindow(double error)
+{
+  this->IncrementalErrorWindow.push_back(error);
+  this->IncrementalErrorWindowSum += error;
+  this->IncrementalErrorWindowSumSquares += error * error;
+  while (this->IncrementalErrorWindow.size() > this->IncrementalOutlierWindowSize)
+  {
+    double oldestError = this->IncrementalErrorWindow.front();
+    this->IncrementalErrorWindow.pop_front();
+    this->IncrementalErrorWindowSum -= oldestError;
+    this->IncrementalErrorWindowSumSquares -= oldestError * oldestError;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusPivotCalibrationAlgo::UpdateIncrementalCalibration(unsigned int sampleIndex)
+{
+  const MarkerToReferenceTransformSample& sample = this->MarkerToReferenceTransformSamples[sampleIndex];
+
+  if (this->IncrementalOutlierRejectionActive && !this->IncrementalErrorWindow.empty())
+  {
+    // Compare the error of the new sample (as predicted by the current estimate) to the errors of the recently accepted samples
+    double error = this->ComputeIncrementalSampleError(sample);
+    double windowSize = static_cast<double>(this->IncrementalErrorWindow.size());
+    double mean = this->IncrementalErrorWindowSum / windowSize;
+    double variance = this->IncrementalErrorWindowSumSquares / windowSize - mean * mean;
+    double stdev = (variance > 0 ? sqrt(variance) : 0.0);
+    if (error > mean + this->IncrementalOutlierThreshold * stdev)
+    {
+      this->NumberOfIncrementalOutliers++;
+      this->NumberOfSuccessiveIncrementalOutliers++;
+      if (this->NumberOfSuccessiveIncrementalOutliers < std::max(this->IncrementalOutlierWindowSize, MINIMUM_NUMBER_OF_INCREMENTAL_WINDOW_SAMPLES))
+      {
+        return;
+      }
+      // A whole window of samples was rejected, so the estimate does not describe the current data (e.g., the pivot point was moved)
+      LOG_DEBUG("Incremental pivot calibration restarted after " << this->NumberOfSuccessiveIncrementalOutliers << " successive outliers");
+      this->ResetIncrementalCalibration();
+    }
+    else
+    {
+      this->NumberOfSuccessiveIncrementalOutliers = 0;
+      this->AddIncrementalErrorToWindow(error);
+    }
+  }
+
+  this->AccumulateIncrementalSample(sample, 1.0);
+  this->SolveIncrementalCalibration();
+
+  if (!this->IncrementalOutlierRejectionActive)
+  {
+    this->IncrementalInitialSampleIndices.push_back(sampleIndex);
+    this->InitializeIncrementalOutlierRejection();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusPivotCalibrationAlgo::InitializeIncrementalOutlierRejection()
+{
+  if (!this->IncrementalSolutionValid || this->IncrementalInitialSampleIndices.size() < MINIMUM_NUMBER_OF_INCREMENTAL_WINDOW_SAMPLES)
+  {
+    return;
+  }
+
+  // Samples that were accepted before an estimate was available are not checked yet, so remove the outliers from them
+  // (repeat until no more outliers are found). A few outliers in this small set would inflate the standard deviation
+  // enough to mask each other, therefore median and median absolute deviation are used instead of mean and standard deviation.
+  std::vector<double> errors;
+  std::vector<double> sortedValues;
+  bool outlierFound = true;
+  while (outlierFound)
+  {
+    errors.clear();
+    for (std::vector<unsigned int>::iterator indexIt = this->IncrementalInitialSampleIndices.begin(); indexIt != this->IncrementalInitialSampleIndices.end(); ++indexIt)
+    {
+      errors.push_back(this->ComputeIncrementalSampleError(this->MarkerToReferenceTransformSamples[*indexIt]));
+    }
+    sortedValues = errors;
+    std::nth_element(sortedValues.begin(), sortedValues.begin() + sortedValues.size() / 2, sortedValues.end());
+    double median = sortedValues[sortedValues.size() / 2];
+    for (unsigned int i = 0; i < errors.size(); i++)
+    {
+      sortedValues[i] = fabs(errors[i] - median);
+    }
+    std::nth_element(sortedValues.begin(), sortedValues.begin() + sortedValues.size() / 2, sortedValues.end());
+    // Scale factor makes the median absolute deviation consistent with the standard deviation of normally distributed values
+    double robustStdev = 1.4826 * sortedValues[sortedValues.size() / 2];
+
+    outlierFound = false;
+    std::vector<unsigned int> inlierSampleIndices;
+    for (unsigned int i = 0; i < errors.size(); i++)
+    {
+      if (errors[i] > median + this->IncrementalOutlierThreshold * robustStdev)
+      {
+        this->AccumulateIncrementalSample(this->MarkerToReferenceTransformSamples[this->IncrementalInitialSampleIndices[i]], -1.0);
+        this->NumberOfIncrementalOutliers++;
+        outlierFound = true;
+      }
+      else
+      {
+        inlierSampleIndices.push_back(this->IncrementalInitialSampleIndices[i]);
+      }
+    }
+    this->IncrementalInitialSampleIndices.swap(inlierSampleIndices);
+
+    if (outlierFound && (this->SolveIncrementalCalibration() != PLUS_SUCCESS || this->IncrementalInitialSampleIndices.size() < MINIMUM_NUMBER_OF_INCREMENTAL_WINDOW_SAMPLES))
+    {
+      // Not enough samples remained, wait for more
+      return;
+    }
+  }
+
+  for (unsigned int i = 0; i < errors.size(); i++)
+  {
+    this->AddIncrementalErrorToWindow(errors[i]);
+  }
+  this->IncrementalInitialSampleIndices.clear();
+  this->IncrementalOutlierRejectionActive = true;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusPivotCalibrationAlgo::SolveIncrementalCalibration()
+{
+  this->IncrementalSolutionValid = false;
+  if (this->NumberOfIncrementalSamples < 2)
+  {
+    return PLUS_FAIL;
+  }
+
+  vnl_svd<double> svd(this->IncrementalNormalMatrix);
+  if (svd.sigma_min() < INCREMENTAL_NORMAL_MATRIX_CONDITION_TOLERANCE * svd.sigma_max())
+  {
+    return PLUS_FAIL;
+  }
+  this->IncrementalSolution = svd.solve(this->IncrementalNormalVector);
+
+  // Sum of squared residuals: |Ax-b|^2 = x^T*A^T*A*x - 2*x^T*A^T*b + b^T*b
+  const vnl_vector<double>& x = this->IncrementalSolution;
+  double sumSquaredResiduals = dot_product(x, this->IncrementalNormalMatrix * x) - 2.0 * dot_product(x, this->IncrementalNormalVector) + this->IncrementalSquaredNormB;
+  this->IncrementalCalibrationError = sqrt(std::max(0.0, sumSquaredResiduals) / this->NumberOfIncrementalSamples);
+  this->IncrementalSolutionValid = true;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusPivotCalibrationAlgo::GetIncrementalPivotPointPosition(double pivotPoint_Marker[3], double pivotPoint_Reference[3], double& rmsError)
+{
+  if (!this->IncrementalSolutionValid)
+  {
+    return PLUS_FAIL;
+  }
+  for (int i = 0; i < 3; i++)
+  {
+    pivotPoint_Marker[i] = this->IncrementalSolution[i];
+    pivotPoint_Reference[i] = this->IncrementalSolution[3 + i];
+  }
+  rmsError = this->IncrementalCalibrationError;
   return PLUS_SUCCESS;
 }
 
@@ -85,23 +342,26 @@ PlusStatus vtkPlusPivotCalibrationAlgo::GetPivotPointPosition(double* pivotPoint
   std::vector<double> bVector;
   vnl_vector<double> xVector(6, 0);   // result vector
 
+  aMatrix.reserve(3 * this->MarkerToReferenceTransformSamples.size());
+  bVector.reserve(3 * this->MarkerToReferenceTransformSamples.size());
+
   vnl_vector<double> aMatrixRow(6);
-  for (std::list< vtkMatrix4x4* >::iterator markerToReferenceTransformIt = this->MarkerToReferenceTransformMatrixArray.begin();
-       markerToReferenceTransformIt != this->MarkerToReferenceTransformMatrixArray.end(); ++markerToReferenceTransformIt)
+  for (std::vector<MarkerToReferenceTransformSample>::const_iterator markerToReferenceTransformIt = this->MarkerToReferenceTransformSamples.begin();
+       markerToReferenceTransformIt != this->MarkerToReferenceTransformSamples.end(); ++markerToReferenceTransformIt)
   {
     for (int i = 0; i < 3; i++)
     {
-      aMatrixRow(0) = (*markerToReferenceTransformIt)->Element[i][0];
-      aMatrixRow(1) = (*markerToReferenceTransformIt)->Element[i][1];
-      aMatrixRow(2) = (*markerToReferenceTransformIt)->Element[i][2];
+      aMatrixRow(0) = markerToReferenceTransformIt->Element[i][0];
+      aMatrixRow(1) = markerToReferenceTransformIt->Element[i][1];
+      aMatrixRow(2) = markerToReferenceTransformIt->Element[i][2];
       aMatrixRow(3) = (i == 0 ? -1 : 0);
       aMatrixRow(4) = (i == 1 ? -1 : 0);
       aMatrixRow(5) = (i == 2 ? -1 : 0);
       aMatrix.push_back(aMatrixRow);
     }
-    bVector.push_back(-(*markerToReferenceTransformIt)->Element[0][3]);
-    bVector.push_back(-(*markerToReferenceTransformIt)->Element[1][3]);
-    bVector.push_back(-(*markerToReferenceTransformIt)->Element[2][3]);
+    bVector.push_back(-markerToReferenceTransformIt->Element[0][3]);
+    bVector.push_back(-markerToReferenceTransformIt->Element[1][3]);
+    bVector.push_back(-markerToReferenceTransformIt->Element[2][3]);
   }
 
   double mean = 0;
@@ -113,7 +373,7 @@ PlusStatus vtkPlusPivotCalibrationAlgo::GetPivotPointPosition(double* pivotPoint
   {
     notOutliersIndices.put(i, i);
   }
-  if (PlusMath::LSQRMinimize(aMatrix, bVector, xVector, &mean, &stdev, &notOutliersIndices) != PLUS_SUCCESS)
+  if (PlusMath::LSQRMinimizeDense(aMatrix, bVector, xVector, &mean, &stdev, &notOutliersIndices) != PLUS_SUCCESS)
   {
     LOG_ERROR("vtkPlusPivotCalibrationAlgo failed: LSQRMinimize error");
     return PLUS_FAIL;
@@ -157,7 +417,7 @@ PlusStatus vtkPlusPivotCalibrationAlgo::GetPivotPointPosition(double* pivotPoint
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusPivotCalibrationAlgo::DoPivotCalibration(vtkIGSIOTransformRepository* aTransformRepository/* = NULL*/)
 {
-  if (this->MarkerToReferenceTransformMatrixArray.empty())
+  if (this->MarkerToReferenceTransformSamples.empty())
   {
     LOG_ERROR("No points are available for pivot calibration");
     return PLUS_FAIL;
@@ -282,6 +542,15 @@ PlusStatus vtkPlusPivotCalibrationAlgo::ReadConfiguration(vtkXMLDataElement* aCo
   XML_READ_CSTRING_ATTRIBUTE_REQUIRED(ObjectMarkerCoordinateFrame, pivotCalibrationElement);
   XML_READ_CSTRING_ATTRIBUTE_REQUIRED(ReferenceCoordinateFrame, pivotCalibrationElement);
   XML_READ_CSTRING_ATTRIBUTE_REQUIRED(ObjectPivotPointCoordinateFrame, pivotCalibrationElement);
+  int incrementalOutlierWindowSize = static_cast<int>(this->IncrementalOutlierWindowSize);
+  XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, IncrementalOutlierWindowSize, incrementalOutlierWindowSize, pivotCalibrationElement);
+  if (incrementalOutlierWindowSize < 1)
+  {
+    LOG_ERROR("Invalid IncrementalOutlierWindowSize: " << incrementalOutlierWindowSize << ". It must be a positive number.");
+    return PLUS_FAIL;
+  }
+  this->SetIncrementalOutlierWindowSize(static_cast<unsigned int>(incrementalOutlierWindowSize));
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, IncrementalOutlierThreshold, pivotCalibrationElement);
   return PLUS_SUCCESS;
 }
 
@@ -289,15 +558,19 @@ PlusStatus vtkPlusPivotCalibrationAlgo::ReadConfiguration(vtkXMLDataElement* aCo
 void vtkPlusPivotCalibrationAlgo::ComputeCalibrationError()
 {
   double* pivotPoint_Reference = this->PivotPointPosition_Reference;
-
-  vtkSmartPointer<vtkMatrix4x4> pivotPointToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  double pivotPoint_Marker[3] =
+  {
+    this->PivotPointToMarkerTransformMatrix->Element[0][3],
+    this->PivotPointToMarkerTransformMatrix->Element[1][3],
+    this->PivotPointToMarkerTransformMatrix->Element[2][3]
+  };
 
   // Compute the error for each sample as distance between the mean pivot point position and the pivot point position computed from each sample
   std::vector<double> errorValues;
   double currentPivotPoint_Reference[4] = {0, 0, 0, 1};
   unsigned int sampleIndex = 0;
-  for (std::list< vtkMatrix4x4* >::iterator markerToReferenceTransformIt = this->MarkerToReferenceTransformMatrixArray.begin();
-       markerToReferenceTransformIt != this->MarkerToReferenceTransformMatrixArray.end(); ++markerToReferenceTransformIt, ++sampleIndex)
+  for (std::vector<MarkerToReferenceTransformSample>::const_iterator markerToReferenceTransformIt = this->MarkerToReferenceTransformSamples.begin();
+       markerToReferenceTransformIt != this->MarkerToReferenceTransformSamples.end(); ++markerToReferenceTransformIt, ++sampleIndex)
   {
     if (this->OutlierIndices.find(sampleIndex) != this->OutlierIndices.end())
     {
@@ -305,10 +578,11 @@ void vtkPlusPivotCalibrationAlgo::ComputeCalibrationError()
       continue;
     }
 
-    vtkMatrix4x4::Multiply4x4((*markerToReferenceTransformIt), this->PivotPointToMarkerTransformMatrix, pivotPointToReferenceMatrix);
+    const double(*markerToReference)[4] = markerToReferenceTransformIt->Element;
     for (int i = 0; i < 3; i++)
     {
-      currentPivotPoint_Reference[i] = pivotPointToReferenceMatrix->Element[i][3];
+      currentPivotPoint_Reference[i] = markerToReference[i][0] * pivotPoint_Marker[0] + markerToReference[i][1] * pivotPoint_Marker[1]
+                                       + markerToReference[i][2] * pivotPoint_Marker[2] + markerToReference[i][3];
     }
     double errorValue = sqrt(vtkMath::Distance2BetweenPoints(currentPivotPoint_Reference, pivotPoint_Reference));
     errorValues.push_back(errorValue);
@@ -326,3 +600,15 @@ int vtkPlusPivotCalibrationAlgo::GetNumberOfDetectedOutliers()
 {
   return this->OutlierIndices.size();
 }
+
+//-----------------------------------------------------------------------------
+int vtkPlusPivotCalibrationAlgo::GetNumberOfIncrementalOutliers()
+{
+  return this->NumberOfIncrementalOutliers;
+}
+
+//-----------------------------------------------------------------------------
+int vtkPlusPivotCalibrationAlgo::GetNumberOfCalibrationPoints()
+{
+  return this->MarkerToReferenceTransformSamples.size();
+}
@@ -15,9 +15,14 @@ See License.txt for details.
 #include <vtkObject.h>
 #include <vtkMatrix4x4.h>
 
+// VNL includes
+#include "vnl/vnl_matrix.h"
+#include "vnl/vnl_vector.h"
+
 // STL includes
-#include <list>
+#include <deque>
 #include <set>
+#include <vector>
 
 //class vtkIGSIOTransformRepository;
 class vtkXMLDataElement;
@@ -40,6 +45,12 @@ class vtkXMLDataElement;
   The method detects outlier points (points that have larger than 3x error than the standard deviation) and ignores them when computing the pivot point
   coordinates and the calibration error.
 
+  In addition to the batch computation in DoPivotCalibration, a running estimate is maintained while calibration points are inserted:
+  the 6x6 normal equations of the linear problem are accumulated in constant time per sample and solved on each accepted sample,
+  so a live result can be displayed at tracker rate (see GetIncrementalPivotPointPosition). Each new sample is compared to the
+  running estimate and rejected if its error exceeds the mean plus IncrementalOutlierThreshold times the standard deviation of the
+  errors of the last IncrementalOutlierWindowSize accepted samples.
+
   \ingroup PlusLibCalibrationAlgorithm
 */
 class vtkPlusCalibrationExport vtkPlusPivotCalibrationAlgo : public vtkObject
@@ -86,6 +97,23 @@ public:
   */
   int GetNumberOfDetectedOutliers();
 
+  /*!
+    Get the running pivot calibration result, which is updated each time a calibration point is inserted.
+    DoPivotCalibration does not have to be called. The estimate is available as soon as enough samples
+    with sufficiently different orientations have been accepted.
+    \param pivotPoint_Marker Pivot point position in the marker coordinate system
+    \param pivotPoint_Reference Pivot point position in the reference coordinate system
+    \param rmsError Root mean square distance (in mm) between the estimated pivot point and the pivot point computed from each accepted sample
+    \return PLUS_FAIL if the estimate is not available yet
+  */
+  PlusStatus GetIncrementalPivotPointPosition(double pivotPoint_Marker[3], double pivotPoint_Reference[3], double& rmsError);
+
+  /*! Get the number of samples that were rejected as outliers by the incremental calibration */
+  int GetNumberOfIncrementalOutliers();
+
+  /*! Get the number of inserted calibration points */
+  int GetNumberOfCalibrationPoints();
+
 public:
   vtkGetMacro(CalibrationError, double);
   vtkGetObjectMacro(PivotPointToMarkerTransformMatrix, vtkMatrix4x4);
@@ -94,6 +122,14 @@ public:
   vtkGetStringMacro(ReferenceCoordinateFrame);
   vtkGetStringMacro(ObjectPivotPointCoordinateFrame);
 
+  /*! Number of recently accepted samples that the incremental outlier rejection computes the error statistics from */
+  vtkSetMacro(IncrementalOutlierWindowSize, unsigned int);
+  vtkGetMacro(IncrementalOutlierWindowSize, unsigned int);
+
+  /*! A new sample is an incremental outlier if its error is larger than the windowed mean error plus this many times the standard deviation */
+  vtkSetMacro(IncrementalOutlierThreshold, double);
+  vtkGetMacro(IncrementalOutlierThreshold, double);
+
 protected:
   vtkSetObjectMacro(PivotPointToMarkerTransformMatrix, vtkMatrix4x4);
   vtkSetStringMacro(ObjectMarkerCoordinateFrame);
@@ -105,11 +141,37 @@ protected:
   virtual ~vtkPlusPivotCalibrationAlgo();
 
 protected:
+  /*! Rotation and translation part (first three rows) of a marker to reference transform */
+  struct MarkerToReferenceTransformSample
+  {
+    double Element[3][4];
+  };
+
   /*! Compute the mean position error of the pivot point (in mm) */
   void ComputeCalibrationError();
 
   PlusStatus GetPivotPointPosition(double* pivotPoint_Marker, double* pivotPoint_Reference);
 
+  /*! Reject the sample if it is an outlier compared to the running estimate, otherwise add it to the normal equations and update the estimate */
+  void UpdateIncrementalCalibration(unsigned int sampleIndex);
+
+  /*! Add (weight = 1) or remove (weight = -1) a sample to/from the incremental normal equations */
+  void AccumulateIncrementalSample(const MarkerToReferenceTransformSample& sample, double weight);
+
+  /*! Distance between the pivot point computed from the sample and the running estimate */
+  double ComputeIncrementalSampleError(const MarkerToReferenceTransformSample& sample);
+
+  /*! Remove outliers from the samples accepted before the first estimate was available and start outlier rejection if enough samples remain */
+  void InitializeIncrementalOutlierRejection();
+
+  void AddIncrementalErrorToWindow(double error);
+
+  /*! Solve the accumulated normal equations. Returns PLUS_FAIL if the system is not well conditioned yet. */
+  PlusStatus SolveIncrementalCalibration();
+
+  /*! Clear the accumulated normal equations and the outlier window */
+  void ResetIncrementalCalibration();
+
 protected:
   /*! Pivot point to marker transform (eg. stylus tip to stylus) - the result of the calibration */
   vtkMatrix4x4*             PivotPointToMarkerTransformMatrix;
@@ -117,8 +179,8 @@ protected:
   /*! Mean error of the calibration result in mm */
   double                    CalibrationError;
 
-  /*! Array of the input points */
-  std::list<vtkMatrix4x4*>  MarkerToReferenceTransformMatrixArray;
+  /*! Array of the input points, stored contiguously */
+  std::vector<MarkerToReferenceTransformSample> MarkerToReferenceTransformSamples;
 
   /*! Name of the object marker coordinate frame (eg. Stylus) */
   char*                     ObjectMarkerCoordinateFrame;
@@ -134,6 +196,43 @@ protected:
 
   /*! List of outlier sample indices */
   std::set<unsigned int>    OutlierIndices;
+
+  /*! Accumulated A^T*A of the incremental calibration (6x6) */
+  vnl_matrix<double>        IncrementalNormalMatrix;
+
+  /*! Accumulated A^T*b of the incremental calibration */
+  vnl_vector<double>        IncrementalNormalVector;
+
+  /*! Accumulated b^T*b of the incremental calibration, used for computing the residual error without revisiting the samples */
+  double                    IncrementalSquaredNormB;
+
+  /*! Number of samples accumulated in the incremental normal equations */
+  unsigned int              NumberOfIncrementalSamples;
+
+  /*! Number of samples rejected by the incremental outlier detection */
+  unsigned int              NumberOfIncrementalOutliers;
+
+  /*! Number of successive samples rejected, used for detecting a stale estimate */
+  unsigned int              NumberOfSuccessiveIncrementalOutliers;
+
+  /*! Running estimate: pivot point in marker (0-2) and reference (3-5) coordinate systems */
+  vnl_vector<double>        IncrementalSolution;
+  bool                      IncrementalSolutionValid;
+  double                    IncrementalCalibrationError;
+
+  /*! Outlier rejection starts when an estimate and errors of enough samples are available */
+  bool                      IncrementalOutlierRejectionActive;
+
+  /*! Indices of the samples accepted before outlier rejection started */
+  std::vector<unsigned int> IncrementalInitialSampleIndices;
+
+  /*! Errors of the most recently accepted samples and their running sums */
+  std::deque<double>        IncrementalErrorWindow;
+  double                    IncrementalErrorWindowSum;
+  double                    IncrementalErrorWindowSumSquares;
+
+  unsigned int              IncrementalOutlierWindowSize;
+  double                    IncrementalOutlierThreshold;
 };
 
 #endif
@@ -16,6 +16,7 @@ See License.txt for details.
 
 #include "PlusMath.h"
 #include "PlusFidPatternRecognitionCommon.h"
+#include "PlusProfiler.h"
 
 #include "vtkObjectFactory.h"
 #include "vtkMatrix4x4.h"
@@ -96,6 +97,8 @@ PlusStatus vtkPlusProbeCalibrationAlgo::Calibrate(vtkIGSIOTrackedFrameList* vali
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusProbeCalibrationAlgo::ComputeImageToProbeTransformByLinearLeastSquaresMethod(vnl_matrix_fixed<double, 4, 4>& imageToProbeTransformMatrix, std::set<int>& outliers)
 {
+  PLUS_PROFILE_SCOPE("LinearLeastSquares");
+
   // Do calibration for all dimensions and assemble output matrix
   const int n = 4; // number of point dimensions + 1 (homogeneous coordinate system representation: x, y, z, 1)
   const unsigned int numberOfNWiresOnEachFrame = this->NWires.size();
@@ -208,6 +211,7 @@ PlusStatus vtkPlusProbeCalibrationAlgo::ComputeImageToProbeTransformByLinearLeas
 PlusStatus vtkPlusProbeCalibrationAlgo::Calibrate(vtkIGSIOTrackedFrameList* validationTrackedFrameList, int validationStartFrame, int validationEndFrame, vtkIGSIOTrackedFrameList* calibrationTrackedFrameList, int calibrationStartFrame, int calibrationEndFrame, vtkIGSIOTransformRepository* transformRepository, const std::vector<PlusNWire>& nWires)
 {
   LOG_TRACE("vtkPlusProbeCalibrationAlgo::Calibrate(validation: " << validationStartFrame << "-" << validationEndFrame << ", calibration: " << calibrationStartFrame << "-" << calibrationEndFrame << ")");
+  PLUS_PROFILE_SCOPE("ProbeCalibration");
 
   // Set range boundaries
   if (validationStartFrame < 0)
@@ -296,6 +300,7 @@ PlusStatus vtkPlusProbeCalibrationAlgo::Calibrate(vtkIGSIOTrackedFrameList* vali
   if (this->Optimizer->Enabled())
   {
     LOG_INFO("Additional calibration optimization is requested");
+    PLUS_PROFILE_SCOPE("Optimization");
     UpdateNonOutlierData(outliers);
     this->Optimizer->SetImageToProbeSeedTransform(imageToProbeTransformMatrix);
     this->Optimizer->Update();
@@ -369,6 +374,7 @@ PlusStatus vtkPlusProbeCalibrationAlgo::Calibrate(vtkIGSIOTrackedFrameList* vali
 PlusStatus vtkPlusProbeCalibrationAlgo::AddPositionsPerImage(igsioTrackedFrame* trackedFrame, vtkIGSIOTransformRepository* transformRepository, PreProcessedWirePositionIdType datasetType)
 {
   LOG_TRACE("vtkPlusProbeCalibrationAlgo::AddPositionsPerImage(type=" << datasetType << ")");
+  PLUS_PROFILE_SCOPE("AddPositionsPerImage");
 
   // Get position of segmented fiducial points in the image
   std::vector<vnl_vector<double> > segmentedWireIntersectionPointsPos_Image;
@@ -550,6 +556,7 @@ void vtkPlusProbeCalibrationAlgo::SetAndValidateImageToProbeTransform(const vnl_
 PlusStatus vtkPlusProbeCalibrationAlgo::ComputeReprojectionErrors3D(PreProcessedWirePositionIdType datasetType, const vnl_matrix_fixed<double, 4, 4>& imageToProbeTransformMatrix)
 {
   LOG_TRACE("vtkPlusProbeCalibrationAlgo::ComputeReprojectionErrors3D");
+  PLUS_PROFILE_SCOPE("ReprojectionErrors3D");
 
   std::vector<double> reprojectionErrors;
   ComputeError3d(reprojectionErrors, datasetType, imageToProbeTransformMatrix);
@@ -577,6 +584,7 @@ PlusStatus vtkPlusProbeCalibrationAlgo::ComputeReprojectionErrors3D(PreProcessed
 PlusStatus vtkPlusProbeCalibrationAlgo::ComputeReprojectionErrors2D(PreProcessedWirePositionIdType datasetType, const vnl_matrix_fixed<double, 4, 4>& imageToProbeMatrix)
 {
   LOG_TRACE("vtkPlusProbeCalibrationAlgo::ComputeReprojectionErrors2D");
+  PLUS_PROFILE_SCOPE("ReprojectionErrors2D");
 
   // Initialize objects
 
@@ -1145,6 +1153,43 @@ void vtkPlusProbeCalibrationAlgo::ComputeError3d(const vnl_matrix_fixed<double,
   igsioMath::ComputeRms(reprojectionErrors, errorRms);
 }
 
+//--------------------------------------------------------------------------------
+void vtkPlusProbeCalibrationAlgo::GetWireIntersectionData(vtkPlusProbeCalibrationOptimizerAlgo::OptimizationMethodType method, std::vector<vtkPlusProbeCalibrationOptimizerAlgo::WireIntersectionData>& wireIntersections)
+{
+  wireIntersections.clear();
+  const std::vector<NWirePositionType>& framePositions = this->PreProcessedWirePositions[CALIBRATION_NOT_OUTLIER].FramePositions;
+  for (unsigned int frameIndex = 0; frameIndex < framePositions.size(); frameIndex++)
+  {
+    const NWirePositionType& framePosition = framePositions[frameIndex];
+    vnl_matrix_fixed<double, 4, 4> phantomToProbeTransform_vnl = vnl_inverse(framePosition.ProbeToPhantomTransform);
+    for (unsigned int nWireIndex = 0; nWireIndex < this->NWires.size(); nWireIndex++)
+    {
+      for (unsigned int wireIndex = 0; wireIndex < 3; wireIndex++)
+      {
+        if (method == vtkPlusProbeCalibrationOptimizerAlgo::MINIMIZE_DISTANCE_OF_MIDDLE_WIRES_IN_3D && wireIndex != 1)
+        {
+          // only the middle wire is used for the 3D error
+          continue;
+        }
+        vtkPlusProbeCalibrationOptimizerAlgo::WireIntersectionData wireIntersection;
+        const vnl_vector_fixed<double, 4>& segmentedPoint_Image = framePosition.AllWiresIntersectionPointsPos_Image[3 * nWireIndex + wireIndex];
+        const vnl_vector_fixed<double, 4>& middleWirePoint_Probe = framePosition.MiddleWireIntersectionPointsPos_Probe[nWireIndex];
+        const PlusFidWire& wire = this->NWires[nWireIndex].GetWires()[wireIndex];
+        vnl_vector_fixed<double, 4> wireEndPointFront_Probe = phantomToProbeTransform_vnl * vnl_vector_fixed<double, 4>(wire.EndPointFront[0], wire.EndPointFront[1], wire.EndPointFront[2], 1.0);
+        vnl_vector_fixed<double, 4> wireEndPointBack_Probe = phantomToProbeTransform_vnl * vnl_vector_fixed<double, 4>(wire.EndPointBack[0], wire.EndPointBack[1], wire.EndPointBack[2], 1.0);
+        for (int i = 0; i < 3; i++)
+        {
+          wireIntersection.SegmentedPoint_Image[i] = segmentedPoint_Image[i];
+          wireIntersection.ComputedPoint_Probe[i] = middleWirePoint_Probe[i];
+          wireIntersection.WireEndPointFront_Probe[i] = wireEndPointFront_Probe[i];
+          wireIntersection.WireEndPointBack_Probe[i] = wireEndPointBack_Probe[i];
+        }
+        wireIntersections.push_back(wireIntersection);
+      }
+    }
+  }
+}
+
 //--------------------------------------------------------------------------------
 double vtkPlusProbeCalibrationAlgo::GetCalibrationReprojectionError3DMean()
 {
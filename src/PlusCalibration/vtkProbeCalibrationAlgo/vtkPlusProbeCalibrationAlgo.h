@@ -122,6 +122,13 @@ public:
   void ComputeError2d( const vnl_matrix_fixed<double, 4, 4>& imageToProbeMatrix, double& errorMean, double& errorStDev, double& errorRms );
   void ComputeError3d( const vnl_matrix_fixed<double, 4, 4>& imageToProbeMatrix, double& errorMean, double& errorStDev, double& errorRms );
 
+  /*!
+    Get the non-outlier calibration data in the form that is used by the Levenberg-Marquardt optimizer
+    \param method Cost function that the data will be used for (3D: one item for each middle wire intersection, 2D: one item for each wire intersection)
+    \param wireIntersections Output list of wire intersections
+  */
+  void GetWireIntersectionData( vtkPlusProbeCalibrationOptimizerAlgo::OptimizationMethodType method, std::vector<vtkPlusProbeCalibrationOptimizerAlgo::WireIntersectionData>& wireIntersections );
+
 protected:
 
   enum PreProcessedWirePositionIdType
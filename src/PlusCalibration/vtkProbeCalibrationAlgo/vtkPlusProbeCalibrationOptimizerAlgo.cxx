@@ -13,17 +13,31 @@ See License.txt for details.
 #include "vtkPlusProbeCalibrationOptimizerAlgo.h"
 #include "vtkPlusProbeCalibrationAlgo.h"
 #include "vtkTransform.h"
+#include "vtkIGSIOAccurateTimer.h"
 #include "vtkIGSIOTransformRepository.h"
 #include "vtkXMLUtilities.h"
 
 #include "vtksys/SystemTools.hxx"
 
+#include "vtkSMPTools.h"
+
 #include "itkPowellOptimizer.h"
 #include "itkScaleVersor3DTransform.h"
 #include "itkSimilarity3DTransform.h"
 
+#include <algorithm>
+
+#include <vnl/vnl_least_squares_function.h>
+#include <vnl/algo/vnl_levenberg_marquardt.h>
+
 typedef  itk::PowellOptimizer  OptimizerType;
 
+static const double VERSOR_EPSILON = 1e-10; // same as the epsilon used for versor normalization in itk::VersorRigid3DTransform
+static const double VERSOR_MIN_W_FOR_DERIVATIVES = 1e-4; // dw/dq = -q/w is unbounded at w=0 (180 deg rotation), w is not allowed to go below this value when computing derivatives
+static const double PARALLEL_WIRE_TOLERANCE = 1e-9; // wire is considered to be parallel to the image plane if the z distance of its endpoints in the image frame is below this value
+static const int LEVENBERG_MARQUARDT_MAX_FUNCTION_EVALUATIONS = 200;
+static const double LEVENBERG_MARQUARDT_TOLERANCE = 1e-10;
+
 //-----------------------------------------------------------------------------
 class DistanceToWiresCostFunction : public itk::SingleValuedCostFunction 
 {
@@ -159,12 +173,338 @@ private:
   vtkPlusProbeCalibrationOptimizerAlgo* m_CalibrationOptimizer;
 }; 
 
+//-----------------------------------------------------------------------------
+/*!
+  Point-to-wire residuals and their closed-form Jacobian for the Levenberg-Marquardt optimizer.
+  The parameters are the same as in DistanceToWiresCostFunction: versor (3), translation (3), pixel spacing (1 or 2).
+*/
+class DistanceToWiresLeastSquaresFunction : public vnl_least_squares_function
+{
+public:
+  typedef vtkPlusProbeCalibrationOptimizerAlgo::WireIntersectionData WireIntersectionData;
+
+  DistanceToWiresLeastSquaresFunction(const std::vector<WireIntersectionData>& wireIntersections, vtkPlusProbeCalibrationOptimizerAlgo::OptimizationMethodType method, bool isotropicPixelSpacing)
+  : vnl_least_squares_function(isotropicPixelSpacing ? 7 : 8, wireIntersections.size() * GetNumberOfResidualsPerPoint(method), vnl_least_squares_function::use_gradient)
+  , WireIntersections(wireIntersections)
+  , Method(method)
+  , IsotropicPixelSpacing(isotropicPixelSpacing)
+  {
+  }
+
+  static unsigned int GetNumberOfResidualsPerPoint(vtkPlusProbeCalibrationOptimizerAlgo::OptimizationMethodType method)
+  {
+    // 3D method: x, y, z distance; 2D method: x, y distance in the image plane
+    return (method == vtkPlusProbeCalibrationOptimizerAlgo::MINIMIZE_DISTANCE_OF_MIDDLE_WIRES_IN_3D) ? 3 : 2;
+  }
+
+  virtual void f(vnl_vector<double> const& x, vnl_vector<double>& fx)
+  {
+    Evaluate(x, &fx, NULL);
+  }
+
+  virtual void gradf(vnl_vector<double> const& x, vnl_matrix<double>& jacobian)
+  {
+    Evaluate(x, NULL, &jacobian);
+  }
+
+protected:
+  /*! Transform computed from the parameters, with derivatives with respect to the parameters */
+  struct TransformModel
+  {
+    vnl_matrix_fixed<double,3,3> Rotation;
+    /*! Derivatives of the rotation matrix with respect to the 3 versor parameters */
+    vnl_matrix_fixed<double,3,3> RotationDerivatives[3];
+    vnl_vector_fixed<double,3> Translation;
+    /*! Scaling of the x, y, z image axes */
+    vnl_vector_fixed<double,3> Scale;
+    /*! Derivative of the scaling of the image axes with respect to the 1 or 2 scaling parameters */
+    double ScaleDerivatives[3][2];
+    unsigned int NumberOfScaleParameters;
+  };
+
+  /*! Computes the same transform as DistanceToWiresCostFunction::GetTransformMatrix (versor to matrix conversion is identical to itk::Versor) */
+  void ComputeTransformModel(const vnl_vector<double>& x, TransformModel& model) const
+  {
+    double q[3] = { x[0], x[1], x[2] };
+    double vectorNorm = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2]);
+    if (vectorNorm >= 1.0 - VERSOR_EPSILON)
+    {
+      // Same normalization as in itk::VersorRigid3DTransform::SetParameters
+      q[0] /= vectorNorm + VERSOR_EPSILON * vectorNorm;
+      q[1] /= vectorNorm + VERSOR_EPSILON * vectorNorm;
+      q[2] /= vectorNorm + VERSOR_EPSILON * vectorNorm;
+    }
+    const double vectorNormSquared = q[0] * q[0] + q[1] * q[1] + q[2] * q[2];
+    const double w = sqrt(std::max(0.0, 1.0 - vectorNormSquared));
+    const double& qx = q[0];
+    const double& qy = q[1];
+    const double& qz = q[2];
+
+    vnl_matrix_fixed<double,3,3>& r = model.Rotation;
+    r(0,0) = 1.0 - 2.0 * (qy * qy + qz * qz);
+    r(0,1) = 2.0 * (qx * qy - qz * w);
+    r(0,2) = 2.0 * (qx * qz + qy * w);
+    r(1,0) = 2.0 * (qx * qy + qz * w);
+    r(1,1) = 1.0 - 2.0 * (qx * qx + qz * qz);
+    r(1,2) = 2.0 * (qy * qz - qx * w);
+    r(2,0) = 2.0 * (qx * qz - qy * w);
+    r(2,1) = 2.0 * (qy * qz + qx * w);
+    r(2,2) = 1.0 - 2.0 * (qx * qx + qy * qy);
+
+    // Partial derivatives of the rotation matrix with respect to the versor components and w
+    const double dRdx[9] = { 0, 2 * qy, 2 * qz, 2 * qy, -4 * qx, -2 * w, 2 * qz, 2 * w, -4 * qx };
+    const double dRdy[9] = { -4 * qy, 2 * qx, 2 * w, 2 * qx, 0, 2 * qz, -2 * w, 2 * qz, -4 * qy };
+    const double dRdz[9] = { -4 * qz, -2 * w, 2 * qx, 2 * w, -4 * qz, 2 * qy, 2 * qx, 2 * qy, 0 };
+    const double dRdw[9] = { 0, -2 * qz, 2 * qy, 2 * qz, 0, -2 * qx, -2 * qy, 2 * qx, 0 };
+    const double* dRdq[3] = { dRdx, dRdy, dRdz };
+    // Near 180 deg rotations the versor parametrization is singular. The bounded derivative is only an approximation there,
+    // but it keeps the Jacobian finite and the Levenberg-Marquardt damping compensates for the inaccuracy.
+    const double wForDerivatives = std::max(w, VERSOR_MIN_W_FOR_DERIVATIVES);
+    for (int paramIndex = 0; paramIndex < 3; ++paramIndex)
+    {
+      // w = sqrt(1-qx^2-qy^2-qz^2) => dw/dq = -q/w
+      const double dwdq = -q[paramIndex] / wForDerivatives;
+      for (int i = 0; i < 3; ++i)
+      {
+        for (int j = 0; j < 3; ++j)
+        {
+          model.RotationDerivatives[paramIndex](i,j) = dRdq[paramIndex][i * 3 + j] + dRdw[i * 3 + j] * dwdq;
+        }
+      }
+    }
+
+    model.Translation[0] = x[3];
+    model.Translation[1] = x[4];
+    model.Translation[2] = x[5];
+
+    if (this->IsotropicPixelSpacing)
+    {
+      model.NumberOfScaleParameters = 1;
+      model.Scale[0] = x[6];
+      model.Scale[1] = x[6];
+      model.Scale[2] = x[6];
+      model.ScaleDerivatives[0][0] = 1.0;
+      model.ScaleDerivatives[1][0] = 1.0;
+      model.ScaleDerivatives[2][0] = 1.0;
+    }
+    else
+    {
+      model.NumberOfScaleParameters = 2;
+      model.Scale[0] = x[6];
+      model.Scale[1] = x[7];
+      model.Scale[2] = (x[6] + x[7]) / 2.0;
+      model.ScaleDerivatives[0][0] = 1.0;
+      model.ScaleDerivatives[0][1] = 0.0;
+      model.ScaleDerivatives[1][0] = 0.0;
+      model.ScaleDerivatives[1][1] = 1.0;
+      model.ScaleDerivatives[2][0] = 0.5;
+      model.ScaleDerivatives[2][1] = 0.5;
+    }
+  }
+
+  /*! Computes the residuals and/or the Jacobian of a range of wire intersections. Each intersection writes only its own rows, therefore ranges can be processed in parallel. */
+  struct EvaluateFunctor
+  {
+    const DistanceToWiresLeastSquaresFunction* Self;
+    const TransformModel* Model;
+    vnl_vector<double>* Residuals;
+    vnl_matrix<double>* Jacobian;
+
+    void operator()(vtkIdType begin, vtkIdType end) const
+    {
+      for (vtkIdType pointIndex = begin; pointIndex < end; ++pointIndex)
+      {
+        if (this->Self->Method == vtkPlusProbeCalibrationOptimizerAlgo::MINIMIZE_DISTANCE_OF_MIDDLE_WIRES_IN_3D)
+        {
+          this->Self->EvaluatePoint3d(*this->Model, this->Self->WireIntersections[pointIndex], pointIndex * 3, this->Residuals, this->Jacobian);
+        }
+        else
+        {
+          this->Self->EvaluatePoint2d(*this->Model, this->Self->WireIntersections[pointIndex], pointIndex * 2, this->Residuals, this->Jacobian);
+        }
+      }
+    }
+  };
+
+  void Evaluate(const vnl_vector<double>& x, vnl_vector<double>* residuals, vnl_matrix<double>* jacobian)
+  {
+    TransformModel model;
+    ComputeTransformModel(x, model);
+    EvaluateFunctor functor = { this, &model, residuals, jacobian };
+    vtkSMPTools::For(0, static_cast<vtkIdType>(this->WireIntersections.size()), functor);
+  }
+
+  /*! Residual: segmented middle wire point transformed to the Probe frame minus the computed middle wire point in the Probe frame */
+  void EvaluatePoint3d(const TransformModel& model, const WireIntersectionData& data, unsigned int firstRow, vnl_vector<double>* residuals, vnl_matrix<double>* jacobian) const
+  {
+    const vnl_vector_fixed<double,3>& p = data.SegmentedPoint_Image;
+    vnl_vector_fixed<double,3> scaledPoint(model.Scale[0] * p[0], model.Scale[1] * p[1], model.Scale[2] * p[2]);
+    if (residuals != NULL)
+    {
+      vnl_vector_fixed<double,3> residual = model.Rotation * scaledPoint + model.Translation - data.ComputedPoint_Probe;
+      for (int i = 0; i < 3; ++i)
+      {
+        (*residuals)[firstRow + i] = residual[i];
+      }
+    }
+    if (jacobian != NULL)
+    {
+      for (int paramIndex = 0; paramIndex < 3; ++paramIndex)
+      {
+        vnl_vector_fixed<double,3> derivative = model.RotationDerivatives[paramIndex] * scaledPoint;
+        for (int i = 0; i < 3; ++i)
+        {
+          (*jacobian)(firstRow + i, paramIndex) = derivative[i];
+        }
+      }
+      for (int i = 0; i < 3; ++i)
+      {
+        for (int j = 0; j < 3; ++j)
+        {
+          (*jacobian)(firstRow + i, 3 + j) = (i == j) ? 1.0 : 0.0;
+        }
+        for (unsigned int scaleParamIndex = 0; scaleParamIndex < model.NumberOfScaleParameters; ++scaleParamIndex)
+        {
+          double derivative = 0.0;
+          for (int k = 0; k < 3; ++k)
+          {
+            derivative += model.Rotation(i,k) * p[k] * model.ScaleDerivatives[k][scaleParamIndex];
+          }
+          (*jacobian)(firstRow + i, 6 + scaleParamIndex) = derivative;
+        }
+      }
+    }
+  }
+
+  /*!
+    Transform a point from the Probe to the Image coordinate system and compute its derivatives with respect to the parameters.
+    The Image to Probe matrix is R*S, therefore its inverse is S^-1*R^T and no matrix inversion is needed.
+  */
+  static void TransformProbeToImage(const TransformModel& model, const vnl_vector_fixed<double,3>& point_Probe, double point_Image[3], double pointDerivatives_Image[3][8])
+  {
+    vnl_vector_fixed<double,3> u = point_Probe - model.Translation;
+    for (int k = 0; k < 3; ++k)
+    {
+      double rotated = model.Rotation(0,k) * u[0] + model.Rotation(1,k) * u[1] + model.Rotation(2,k) * u[2];
+      point_Image[k] = rotated / model.Scale[k];
+      for (int paramIndex = 0; paramIndex < 3; ++paramIndex)
+      {
+        const vnl_matrix_fixed<double,3,3>& dR = model.RotationDerivatives[paramIndex];
+        pointDerivatives_Image[k][paramIndex] = (dR(0,k) * u[0] + dR(1,k) * u[1] + dR(2,k) * u[2]) / model.Scale[k];
+      }
+      for (int translationIndex = 0; translationIndex < 3; ++translationIndex)
+      {
+        pointDerivatives_Image[k][3 + translationIndex] = -model.Rotation(translationIndex,k) / model.Scale[k];
+      }
+      for (unsigned int scaleParamIndex = 0; scaleParamIndex < model.NumberOfScaleParameters; ++scaleParamIndex)
+      {
+        pointDerivatives_Image[k][6 + scaleParamIndex] = -point_Image[k] / model.Scale[k] * model.ScaleDerivatives[k][scaleParamIndex];
+      }
+    }
+  }
+
+  /*! Residual: segmented point minus the intersection of the wire and the image plane, in the Image coordinate system */
+  void EvaluatePoint2d(const TransformModel& model, const WireIntersectionData& data, unsigned int firstRow, vnl_vector<double>* residuals, vnl_matrix<double>* jacobian) const
+  {
+    const unsigned int numberOfParameters = 6 + model.NumberOfScaleParameters;
+    double a[3] = {0};
+    double b[3] = {0};
+    double da[3][8] = {{0}};
+    double db[3][8] = {{0}};
+    TransformProbeToImage(model, data.WireEndPointFront_Probe, a, da);
+    TransformProbeToImage(model, data.WireEndPointBack_Probe, b, db);
+
+    const double denominator = a[2] - b[2];
+    if (fabs(denominator) < PARALLEL_WIRE_TOLERANCE)
+    {
+      // Image plane and wire are parallel, the point does not contribute to the cost
+      for (int i = 0; i < 2; ++i)
+      {
+        if (residuals != NULL)
+        {
+          (*residuals)[firstRow + i] = 0.0;
+        }
+        if (jacobian != NULL)
+        {
+          for (unsigned int paramIndex = 0; paramIndex < numberOfParameters; ++paramIndex)
+          {
+            (*jacobian)(firstRow + i, paramIndex) = 0.0;
+          }
+        }
+      }
+      return;
+    }
+
+    // Intersection with the z=0 plane: a + t*(b-a), where t = a_z/(a_z-b_z)
+    const double t = a[2] / denominator;
+    for (int i = 0; i < 2; ++i)
+    {
+      if (residuals != NULL)
+      {
+        (*residuals)[firstRow + i] = data.SegmentedPoint_Image[i] - (a[i] + t * (b[i] - a[i]));
+      }
+      if (jacobian != NULL)
+      {
+        for (unsigned int paramIndex = 0; paramIndex < numberOfParameters; ++paramIndex)
+        {
+          const double dt = (a[2] * db[2][paramIndex] - b[2] * da[2][paramIndex]) / (denominator * denominator);
+          const double dIntersection = da[i][paramIndex] + dt * (b[i] - a[i]) + t * (db[i][paramIndex] - da[i][paramIndex]);
+          (*jacobian)(firstRow + i, paramIndex) = -dIntersection;
+        }
+      }
+    }
+  }
+
+private:
+  const std::vector<WireIntersectionData>& WireIntersections;
+  vtkPlusProbeCalibrationOptimizerAlgo::OptimizationMethodType Method;
+  bool IsotropicPixelSpacing;
+};
+
 //-----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkPlusProbeCalibrationOptimizerAlgo);
 
+//-----------------------------------------------------------------------------
+double vtkPlusProbeCalibrationOptimizerAlgo::ComputeJacobianError(const std::vector<WireIntersectionData>& wireIntersections, OptimizationMethodType method, bool isotropicPixelSpacing, const vnl_vector<double>& parameters, double stepSize)
+{
+  DistanceToWiresLeastSquaresFunction leastSquaresFunction(wireIntersections, method, isotropicPixelSpacing);
+  const unsigned int numberOfParameters = leastSquaresFunction.get_number_of_unknowns();
+  const unsigned int numberOfResiduals = leastSquaresFunction.get_number_of_residuals();
+  if (parameters.size() != numberOfParameters)
+  {
+    LOG_ERROR("Number of transformation parameters is incorrect");
+    return -1.0;
+  }
+
+  vnl_matrix<double> analyticJacobian(numberOfResiduals, numberOfParameters);
+  leastSquaresFunction.gradf(parameters, analyticJacobian);
+
+  // Central differences
+  double maxError = 0.0;
+  vnl_vector<double> residualsPlus(numberOfResiduals);
+  vnl_vector<double> residualsMinus(numberOfResiduals);
+  for (unsigned int paramIndex = 0; paramIndex < numberOfParameters; ++paramIndex)
+  {
+    vnl_vector<double> parametersPlus = parameters;
+    vnl_vector<double> parametersMinus = parameters;
+    parametersPlus[paramIndex] += stepSize;
+    parametersMinus[paramIndex] -= stepSize;
+    leastSquaresFunction.f(parametersPlus, residualsPlus);
+    leastSquaresFunction.f(parametersMinus, residualsMinus);
+    for (unsigned int residualIndex = 0; residualIndex < numberOfResiduals; ++residualIndex)
+    {
+      const double numericDerivative = (residualsPlus[residualIndex] - residualsMinus[residualIndex]) / (2.0 * stepSize);
+      const double analyticDerivative = analyticJacobian(residualIndex, paramIndex);
+      maxError = std::max(maxError, fabs(numericDerivative - analyticDerivative) / std::max(1.0, fabs(analyticDerivative)));
+    }
+  }
+  return maxError;
+}
+
 //-----------------------------------------------------------------------------
 vtkPlusProbeCalibrationOptimizerAlgo::vtkPlusProbeCalibrationOptimizerAlgo()
 : IsotropicPixelSpacing(true)
+, OptimizationAlgorithm(OPTIMIZATION_ALGORITHM_POWELL)
 , ProbeCalibrationAlgo(NULL)
 {  
 }
@@ -253,74 +593,95 @@ PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::Update()
     igsioMath::LogVtkMatrix(vtkMatrix);
   }
 
-  OptimizerType::Pointer  optimizer = OptimizerType::New();
-  try 
+  DistanceToWiresCostFunction::ParametersType optimizedParameters = imageToProbeSeedTransformParameters;
+  if (this->OptimizationAlgorithm == OPTIMIZATION_ALGORITHM_LEVENBERG_MARQUARDT)
   {
-    optimizer->SetCostFunction( costFunction.GetPointer() );
+    vnl_vector<double> parameters(imageToProbeSeedTransformParameters.GetSize());
+    for (unsigned int i = 0; i < parameters.size(); ++i)
+    {
+      parameters[i] = imageToProbeSeedTransformParameters[i];
+    }
+    if (OptimizeLevenbergMarquardt(parameters) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    for (unsigned int i = 0; i < parameters.size(); ++i)
+    {
+      optimizedParameters[i] = parameters[i];
+    }
   }
-  catch( itk::ExceptionObject & e )
+  else
   {
-    LOG_ERROR("Exception thrown ! An error ocurred during Optimization: "<<e);
-    return PLUS_FAIL;
-  }
+    OptimizerType::Pointer  optimizer = OptimizerType::New();
+    try 
+    {
+      optimizer->SetCostFunction( costFunction.GetPointer() );
+    }
+    catch( itk::ExceptionObject & e )
+    {
+      LOG_ERROR("Exception thrown ! An error ocurred during Optimization: "<<e);
+      return PLUS_FAIL;
+    }
 
-  optimizer->SetStepLength( 10 );
-  optimizer->SetStepTolerance( 1e-8 );
-  optimizer->SetValueTolerance( 1e-8 );
-  optimizer->SetMaximumIteration( 300 );
+    optimizer->SetStepLength( 10 );
+    optimizer->SetStepTolerance( 1e-8 );
+    optimizer->SetValueTolerance( 1e-8 );
+    optimizer->SetMaximumIteration( 300 );
 
 
-  const double rotationParametersScale=1.0;
-  const double translationParametersScale=0.5;
-  const double scalesParametersScale=10.0;
+    const double rotationParametersScale=1.0;
+    const double translationParametersScale=0.5;
+    const double scalesParametersScale=10.0;
 
-  // Scale the translation components of the transform in the Optimizer
-  OptimizerType::ScalesType scales( costFunction->GetNumberOfParameters() );
-  switch (costFunction->GetNumberOfParameters())
-  {
-  case 7:
-    scales[0] = rotationParametersScale;
-    scales[1] = rotationParametersScale;
-    scales[2] = rotationParametersScale;
-    scales[3] = translationParametersScale; 
-    scales[4] = translationParametersScale; 
-    scales[5] = translationParametersScale;
-    scales[6] = scalesParametersScale;  
-    break;
-  case 8:
-    scales[0] = rotationParametersScale;
-    scales[1] = rotationParametersScale;
-    scales[2] = rotationParametersScale;
-    scales[3] = translationParametersScale; 
-    scales[4] = translationParametersScale; 
-    scales[5] = translationParametersScale;
-    scales[6] = scalesParametersScale;  
-    scales[7] = scalesParametersScale;  
-    break;
-  default:
-    LOG_ERROR("Number of transformation parameters is incorrect");
-    return PLUS_FAIL;
-  }
-  optimizer->SetScales(scales);
+    // Scale the translation components of the transform in the Optimizer
+    OptimizerType::ScalesType scales( costFunction->GetNumberOfParameters() );
+    switch (costFunction->GetNumberOfParameters())
+    {
+    case 7:
+      scales[0] = rotationParametersScale;
+      scales[1] = rotationParametersScale;
+      scales[2] = rotationParametersScale;
+      scales[3] = translationParametersScale; 
+      scales[4] = translationParametersScale; 
+      scales[5] = translationParametersScale;
+      scales[6] = scalesParametersScale;  
+      break;
+    case 8:
+      scales[0] = rotationParametersScale;
+      scales[1] = rotationParametersScale;
+      scales[2] = rotationParametersScale;
+      scales[3] = translationParametersScale; 
+      scales[4] = translationParametersScale; 
+      scales[5] = translationParametersScale;
+      scales[6] = scalesParametersScale;  
+      scales[7] = scalesParametersScale;  
+      break;
+    default:
+      LOG_ERROR("Number of transformation parameters is incorrect");
+      return PLUS_FAIL;
+    }
+    optimizer->SetScales(scales);
 
-  optimizer->SetInitialPosition(imageToProbeSeedTransformParameters);
+    optimizer->SetInitialPosition(imageToProbeSeedTransformParameters);
 
-  try 
-  {
-    optimizer->StartOptimization();
-  }
-  catch( itk::ExceptionObject & e )
-  {
-    LOG_ERROR("Exception thrown ! An error ocurred during Optimization: Location = " << e.GetLocation() << "Description = " << e.GetDescription());
-    return PLUS_FAIL;
-  }
+    try 
+    {
+      optimizer->StartOptimization();
+    }
+    catch( itk::ExceptionObject & e )
+    {
+      LOG_ERROR("Exception thrown ! An error ocurred during Optimization: Location = " << e.GetLocation() << "Description = " << e.GetDescription());
+      return PLUS_FAIL;
+    }
 
-  std::string stopCondition=optimizer->GetStopConditionDescription();
-  LOG_INFO("Optimization stopping condition: "<<stopCondition<<". Number of iterations: " << optimizer->GetCurrentIteration());
+    std::string stopCondition=optimizer->GetStopConditionDescription();
+    LOG_INFO("Optimization stopping condition: "<<stopCondition<<". Number of iterations: " << optimizer->GetCurrentIteration());
+    optimizedParameters = optimizer->GetCurrentPosition();
+  }
 
   // Store the matrix
 
-  costFunction->GetTransformMatrix(this->ImageToProbeTransformMatrix, optimizer->GetCurrentPosition());
+  costFunction->GetTransformMatrix(this->ImageToProbeTransformMatrix, optimizedParameters);
   {
     vtkSmartPointer<vtkMatrix4x4> vtkMatrix=vtkSmartPointer<vtkMatrix4x4>::New();
     PlusMath::ConvertVnlMatrixToVtkMatrix(this->ImageToProbeTransformMatrix, vtkMatrix); 
@@ -328,7 +689,7 @@ PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::Update()
   }
 
   // Store the optimized parameters and show the results
-  LOG_INFO("Cost function = " << GetOptimizationMethodAsString(this->OptimizationMethod));
+  LOG_INFO("Cost function = " << GetOptimizationMethodAsString(this->OptimizationMethod) << ", optimizer = " << GetOptimizationAlgorithmAsString(this->OptimizationAlgorithm));
 
   LOG_INFO("Without optimization:");
   ShowTransformation(this->ImageToProbeSeedTransformMatrix);
@@ -346,6 +707,48 @@ PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::Update()
   return PLUS_SUCCESS; 
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::OptimizeLevenbergMarquardt(vnl_vector<double>& imageToProbeTransformParameters)
+{
+  if (this->OptimizationMethod != MINIMIZE_DISTANCE_OF_MIDDLE_WIRES_IN_3D && this->OptimizationMethod != MINIMIZE_DISTANCE_OF_ALL_WIRES_IN_2D)
+  {
+    LOG_ERROR("Invalid cost function");
+    return PLUS_FAIL;
+  }
+
+  const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+
+  std::vector<WireIntersectionData> wireIntersections;
+  this->ProbeCalibrationAlgo->GetWireIntersectionData(this->OptimizationMethod, wireIntersections);
+
+  DistanceToWiresLeastSquaresFunction leastSquaresFunction(wireIntersections, this->OptimizationMethod, this->IsotropicPixelSpacing);
+  if (leastSquaresFunction.get_number_of_residuals() < leastSquaresFunction.get_number_of_unknowns())
+  {
+    LOG_ERROR("Not enough wire intersection points for Levenberg-Marquardt optimization: " << wireIntersections.size());
+    return PLUS_FAIL;
+  }
+  if (imageToProbeTransformParameters.size() != leastSquaresFunction.get_number_of_unknowns())
+  {
+    LOG_ERROR("Number of transformation parameters is incorrect");
+    return PLUS_FAIL;
+  }
+
+  vnl_levenberg_marquardt optimizer(leastSquaresFunction);
+  optimizer.set_f_tolerance(LEVENBERG_MARQUARDT_TOLERANCE);
+  optimizer.set_x_tolerance(LEVENBERG_MARQUARDT_TOLERANCE);
+  optimizer.set_g_tolerance(LEVENBERG_MARQUARDT_TOLERANCE);
+  optimizer.set_max_function_evals(LEVENBERG_MARQUARDT_MAX_FUNCTION_EVALUATIONS);
+  if (!optimizer.minimize_using_gradient(imageToProbeTransformParameters))
+  {
+    LOG_ERROR("Levenberg-Marquardt optimization failed (failure code: " << optimizer.get_failure_code() << ")");
+    return PLUS_FAIL;
+  }
+
+  LOG_INFO("Levenberg-Marquardt optimization finished in " << (vtkIGSIOAccurateTimer::GetSystemTime() - startTime) * 1000.0 << "ms. Number of iterations: " << optimizer.get_num_iterations()
+           << ", number of residuals: " << leastSquaresFunction.get_number_of_residuals());
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 vnl_matrix_fixed<double,4,4> vtkPlusProbeCalibrationOptimizerAlgo::GetOptimizedImageToProbeTransformMatrix()
 {
@@ -383,6 +786,19 @@ const char* vtkPlusProbeCalibrationOptimizerAlgo::GetOptimizationMethodAsString(
   }
 }
 
+//----------------------------------------------------------------------------
+const char* vtkPlusProbeCalibrationOptimizerAlgo::GetOptimizationAlgorithmAsString(OptimizationAlgorithmType type)
+{
+  switch (type)
+  {
+  case OPTIMIZATION_ALGORITHM_POWELL: return "POWELL";
+  case OPTIMIZATION_ALGORITHM_LEVENBERG_MARQUARDT: return "LEVENBERG_MARQUARDT";
+  default:
+    LOG_ERROR("Unknown optimization algorithm: "<<type);
+    return "unknown";
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::ReadConfiguration( vtkXMLDataElement* aConfig )
 {
@@ -415,5 +831,20 @@ PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::ReadConfiguration( vtkXMLDataEl
 
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(IsotropicPixelSpacing, aConfig);
 
+  const char* optimizationAlgorithm=aConfig->GetAttribute("OptimizationAlgorithm");
+  if (optimizationAlgorithm==NULL || STRCASECMP(optimizationAlgorithm, GetOptimizationAlgorithmAsString(OPTIMIZATION_ALGORITHM_POWELL)) == 0)
+  {
+    this->OptimizationAlgorithm=OPTIMIZATION_ALGORITHM_POWELL;
+  }
+  else if (STRCASECMP(optimizationAlgorithm, GetOptimizationAlgorithmAsString(OPTIMIZATION_ALGORITHM_LEVENBERG_MARQUARDT)) == 0)
+  {
+    this->OptimizationAlgorithm=OPTIMIZATION_ALGORITHM_LEVENBERG_MARQUARDT;
+  }
+  else
+  {
+    LOG_WARNING("Unknown OptimizationAlgorithm: " << optimizationAlgorithm << ". Using " << GetOptimizationAlgorithmAsString(OPTIMIZATION_ALGORITHM_POWELL) << " optimizer.");
+    this->OptimizationAlgorithm=OPTIMIZATION_ALGORITHM_POWELL;
+  }
+
   return PLUS_SUCCESS;
 }
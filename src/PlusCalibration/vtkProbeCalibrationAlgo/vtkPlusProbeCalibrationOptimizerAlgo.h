@@ -14,6 +14,9 @@ See License.txt for details.
 #include "PlusFidPatternRecognitionCommon.h"
 
 #include <set>
+#include <vector>
+
+#include <vnl/vnl_vector_fixed.h>
 
 class vtkXMLDataElement;
 class vtkPlusProbeCalibrationAlgo;
@@ -31,6 +34,10 @@ class vtkPlusProbeCalibrationAlgo;
   it is more accurate to optimize the in-plane (2D) error. Also this optimizer enforces orthogonality of the image to
   probe matrix and optionally it can enforce isotropic image pixel spacing.
 
+  The refinement is either performed by a Powell optimizer (using cost function values only) or by a
+  Levenberg-Marquardt optimizer that uses closed-form Jacobians of the point-to-wire residuals. The latter
+  typically converges in a few iterations, so it is fast enough to be rerun whenever new frames are added.
+
   \ingroup PlusLibCalibrationAlgo
 */
 class vtkPlusProbeCalibrationOptimizerAlgo : public vtkObject
@@ -46,6 +53,29 @@ public:
     MINIMIZE_DISTANCE_OF_ALL_WIRES_IN_2D
   };  
 
+  /* Choose one of the possible optimizers */
+  enum OptimizationAlgorithmType
+  {
+    OPTIMIZATION_ALGORITHM_POWELL,
+    OPTIMIZATION_ALGORITHM_LEVENBERG_MARQUARDT
+  };
+
+  /*!
+    Input of the Levenberg-Marquardt optimization for one wire intersection point.
+    Positions that do not depend on the ImageToProbe transform are precomputed, so residuals can be evaluated without matrix inversions.
+  */
+  struct WireIntersectionData
+  {
+    /*! Segmented wire intersection point position in the Image coordinate system (pixel) */
+    vnl_vector_fixed<double,3> SegmentedPoint_Image;
+    /*! Computed middle wire intersection point position in the Probe coordinate system (mm), used by the 3D method */
+    vnl_vector_fixed<double,3> ComputedPoint_Probe;
+    /*! Front end point of the wire in the Probe coordinate system (mm), used by the 2D method */
+    vnl_vector_fixed<double,3> WireEndPointFront_Probe;
+    /*! Back end point of the wire in the Probe coordinate system (mm), used by the 2D method */
+    vnl_vector_fixed<double,3> WireEndPointBack_Probe;
+  };
+
   vtkTypeMacro(vtkPlusProbeCalibrationOptimizerAlgo,vtkObject);
   static vtkPlusProbeCalibrationOptimizerAlgo *New();
 
@@ -75,13 +105,33 @@ public:
   void SetOptimizationMethod(OptimizationMethodType optimizationMethod) { this->OptimizationMethod=optimizationMethod; }
   static const char* GetOptimizationMethodAsString(OptimizationMethodType type);
 
+  OptimizationAlgorithmType GetOptimizationAlgorithm() { return this->OptimizationAlgorithm; }
+  void SetOptimizationAlgorithm(OptimizationAlgorithmType optimizationAlgorithm) { this->OptimizationAlgorithm=optimizationAlgorithm; }
+  static const char* GetOptimizationAlgorithmAsString(OptimizationAlgorithmType type);
+
   void SetImageToProbeSeedTransform(const vnl_matrix_fixed<double,4,4> &imageToProbeTransformMatrix);
 
   void SetProbeCalibrationAlgo(vtkPlusProbeCalibrationAlgo* probeCalibrationAlgo);
 
+  /*!
+    Compute the largest difference between the closed-form Jacobian of the Levenberg-Marquardt residuals
+    and its central finite difference approximation. Differences are relative to the derivative for derivatives
+    larger than 1, absolute otherwise. Used for verifying the derivatives.
+    \param parameters Transform parameters (versor, translation, pixel spacing) where the Jacobian is evaluated
+    \param stepSize Parameter step size of the finite differences
+    \return Largest difference, or a negative value in case of an error
+  */
+  static double ComputeJacobianError(const std::vector<WireIntersectionData>& wireIntersections, OptimizationMethodType method, bool isotropicPixelSpacing, const vnl_vector<double>& parameters, double stepSize);
+
 protected:
 
   PlusStatus ShowTransformation(const vnl_matrix_fixed<double,4,4> &transformationMatrix);
+
+  /*!
+    Refine the transform parameters (versor, translation, pixel spacing) using Levenberg-Marquardt optimization with analytic Jacobians
+    \param imageToProbeTransformParameters Seed parameters as input, optimized parameters as output
+  */
+  PlusStatus OptimizeLevenbergMarquardt(vnl_vector<double>& imageToProbeTransformParameters);
   
   vtkPlusProbeCalibrationOptimizerAlgo();
   virtual  ~vtkPlusProbeCalibrationOptimizerAlgo();
@@ -93,6 +143,9 @@ protected:
   /*! Cost function to minimize during the optimization */
   OptimizationMethodType OptimizationMethod;
 
+  /*! Optimizer used for minimizing the cost function */
+  OptimizationAlgorithmType OptimizationAlgorithm;
+
   /*! Store the seed for the optimization process */
   vnl_matrix_fixed<double,4,4> ImageToProbeSeedTransformMatrix;
 
@@ -138,7 +138,7 @@ PlusStatus vtkPlusSpacingCalibAlgo::Update()
   }
 
   vnl_vector<double> scalingCalibResult(2, 0);   // [sx, sy]
-  if (PlusMath::LSQRMinimize(aMatrix, bVector, scalingCalibResult, &this->ErrorMean, &this->ErrorStdev) != PLUS_SUCCESS)
+  if (PlusMath::LSQRMinimizeDense(aMatrix, bVector, scalingCalibResult, &this->ErrorMean, &this->ErrorStdev) != PLUS_SUCCESS)
   {
     LOG_WARNING("Failed to run LSQRMinimize!");
     return PLUS_FAIL;
@@ -5,6 +5,7 @@
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusProfiler.h"
 #include "igsioTrackedFrame.h"
 #include "vtkObjectFactory.h"
 #include "vtkDoubleArray.h"
@@ -105,6 +106,7 @@ vtkPlusTemporalCalibrationAlgo::~vtkPlusTemporalCalibrationAlgo()
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusTemporalCalibrationAlgo::Update(TEMPORAL_CALIBRATION_ERROR& error)
 {
+  PLUS_PROFILE_SCOPE("TemporalCalibration");
   if (ComputeMovingSignalLagSec(error) != PLUS_SUCCESS)
   {
     return PLUS_FAIL;
@@ -449,6 +451,8 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::ResampleSignalLinearly(const std::deq
 //-----------------------------------------------------------------------------
 void vtkPlusTemporalCalibrationAlgo::ComputeCorrelationBetweenFixedAndMovingSignal(double minTrackerLagSec, double maxTrackerLagSec, double stepSizeSec, double& bestCorrelationValue, double& bestCorrelationTimeOffset, double& bestCorrelationNormalizationFactor, std::deque<double>& corrTimeOffsets, std::deque<double>& corrValues)
 {
+  PLUS_PROFILE_SCOPE("CrossCorrelation");
+
   // We will let the tracker metric be the "sliding" metric and let the video metric be the "fixed" metric. Since we are assuming a maximum offset between the two streams.
 
   // Construct piecewise function for tracker signal
@@ -563,6 +567,7 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::ComputePositionSignalValues(SignalTyp
   {
     case FRAME_TYPE_TRACKER:
       {
+        PLUS_PROFILE_SCOPE("TrackerPositionSignal");
         vtkSmartPointer<vtkPlusPrincipalMotionDetectionAlgo> trackerDataMetricExtractor = vtkSmartPointer<vtkPlusPrincipalMotionDetectionAlgo>::New();
 
         trackerDataMetricExtractor->SetTrackerFrames(signal.frameList);
@@ -592,6 +597,7 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::ComputePositionSignalValues(SignalTyp
       }
     case FRAME_TYPE_VIDEO:
       {
+        PLUS_PROFILE_SCOPE("VideoPositionSignal");
         vtkSmartPointer<vtkPlusLineSegmentationAlgo> lineSegmenter = vtkSmartPointer<vtkPlusLineSegmentationAlgo>::New();
         lineSegmenter->SetTrackedFrameList(*signal.frameList);
         lineSegmenter->SetClipRectangle(this->LineSegmentationClipRectangleOrigin, this->LineSegmentationClipRectangleSize);
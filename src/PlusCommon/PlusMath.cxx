@@ -11,13 +11,170 @@
 #include "vnl/vnl_sparse_matrix.h"
 #include "vnl/vnl_sparse_matrix_linear_system.h"
 #include "vnl/algo/vnl_lsqr.h"
+#include "vnl/algo/vnl_qr.h"
 #include "vnl/vnl_cross.h"
 
 #include "vtkMath.h"
 #include "vtkTransform.h"
 
+#include <algorithm>
+
 #define MINIMUM_NUMBER_OF_CALIBRATION_EQUATIONS 8
 
+namespace
+{
+  const double LSQR_OUTLIER_THRESHOLD_MULTIPLIER = 3.0;
+  // Estimate of the reciprocal condition number (ratio of the smallest and largest diagonal element of R) below which the dense solver is not used
+  const double DENSE_LSQR_MINIMUM_RECIPROCAL_CONDITION = 1e-12;
+  // Number of corrected semi-normal equation steps that compute the solution after outlier rows are removed from the factorization
+  const unsigned int DENSE_LSQR_NUMBER_OF_REFINEMENT_STEPS = 2;
+
+  //----------------------------------------------------------------------------
+  void ConvertToSparseLinearSystem(const std::vector< vnl_vector<double> >& aMatrix, const std::vector<double>& bVector, vnl_sparse_matrix<double>& sparseMatrixLeftSide, vnl_vector<double>& vectorRightSide)
+  {
+    const int n = aMatrix.begin()->size();
+    const int m = bVector.size();
+
+    sparseMatrixLeftSide.set_size(m, n);
+    vectorRightSide.set_size(m);
+    for (int row = 0; row < m; row++)
+    {
+      // Populate the sparse matrix
+      for (int i = 0; i < n; i++)
+      {
+        sparseMatrixLeftSide(row, i) = aMatrix[row].get(i);
+      }
+
+      // Populate the vector
+      vectorRightSide.put(row, bVector[row]);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // The system is rank deficient or badly conditioned if the diagonal of R has (relatively) tiny elements
+  bool IsWellConditionedTriangularFactor(const vnl_matrix<double>& r)
+  {
+    double minDiagonal = fabs(r(0, 0));
+    double maxDiagonal = minDiagonal;
+    for (unsigned int i = 1; i < r.rows(); ++i)
+    {
+      minDiagonal = std::min(minDiagonal, fabs(r(i, i)));
+      maxDiagonal = std::max(maxDiagonal, fabs(r(i, i)));
+    }
+    return minDiagonal > DENSE_LSQR_MINIMUM_RECIPROCAL_CONDITION * maxDiagonal;
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    QR factorization of the active rows (at least as many as unknowns). Returns the n-by-n upper triangular factor R
+    and the least squares solution. Returns false and does not compute the solution if the system is badly conditioned.
+  */
+  bool FactorizeActiveRows(const std::vector< vnl_vector<double> >& aMatrix, const std::vector<double>& bVector, const std::vector<unsigned int>& activeRows, vnl_matrix<double>& r, vnl_vector<double>& x)
+  {
+    const unsigned int n = aMatrix.begin()->size();
+    vnl_matrix<double> activeMatrix(activeRows.size(), n);
+    vnl_vector<double> activeVector(activeRows.size());
+    for (unsigned int i = 0; i < activeRows.size(); ++i)
+    {
+      activeMatrix.set_row(i, aMatrix[activeRows[i]]);
+      activeVector[i] = bVector[activeRows[i]];
+    }
+    vnl_qr<double> qr(activeMatrix);
+    r = qr.R().extract(n, n);
+    if (!IsWellConditionedTriangularFactor(r))
+    {
+      return false;
+    }
+    x = qr.solve(activeVector);
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  /*!
+    Remove a row from the system by downdating the upper triangular factor R (R^T*R = A^T*A) with Givens rotations
+    (LINPACK dchdd algorithm). Returns false and does not change R if the downdated matrix would be singular.
+  */
+  bool DowndateTriangularFactor(vnl_matrix<double>& r, const vnl_vector<double>& row)
+  {
+    const int n = r.rows();
+
+    // Solve R^T*p = row
+    vnl_vector<double> p(n);
+    for (int j = 0; j < n; ++j)
+    {
+      double sum = row[j];
+      for (int i = 0; i < j; ++i)
+      {
+        sum -= r(i, j) * p[i];
+      }
+      p[j] = sum / r(j, j);
+    }
+    const double pNorm = p.two_norm();
+    if (pNorm >= 1.0)
+    {
+      return false;
+    }
+
+    // Determine the rotations
+    vnl_vector<double> c(n);
+    vnl_vector<double> s(n);
+    double alpha = sqrt(1.0 - pNorm * pNorm);
+    for (int i = n - 1; i >= 0; --i)
+    {
+      const double scale = alpha + fabs(p[i]);
+      const double a = alpha / scale;
+      const double b = p[i] / scale;
+      const double norm = sqrt(a * a + b * b);
+      c[i] = a / norm;
+      s[i] = b / norm;
+      alpha = scale * norm;
+    }
+
+    // Apply the rotations to R
+    for (int j = 0; j < n; ++j)
+    {
+      double xx = 0;
+      for (int i = j; i >= 0; --i)
+      {
+        const double t = c[i] * xx + s[i] * r(i, j);
+        r(i, j) = c[i] * r(i, j) - s[i] * xx;
+        xx = t;
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  // Corrected semi-normal equations step: solve R^T*R*dx = A^T*(b - A*x) for the active rows and add dx to x
+  void RefineSolution(const vnl_matrix<double>& r, const std::vector< vnl_vector<double> >& aMatrix, const std::vector<double>& bVector, const std::vector<unsigned int>& activeRows, vnl_vector<double>& x)
+  {
+    const int n = r.rows();
+    vnl_vector<double> dx(n, 0.0);
+    for (std::vector<unsigned int>::const_iterator rowIt = activeRows.begin(); rowIt != activeRows.end(); ++rowIt)
+    {
+      dx += (bVector[*rowIt] - dot_product(aMatrix[*rowIt], x)) * aMatrix[*rowIt];
+    }
+    // Solve R^T*y = A^T*(b - A*x), then R*dx = y (in place)
+    for (int j = 0; j < n; ++j)
+    {
+      for (int i = 0; i < j; ++i)
+      {
+        dx[j] -= r(i, j) * dx[i];
+      }
+      dx[j] /= r(j, j);
+    }
+    for (int i = n - 1; i >= 0; --i)
+    {
+      for (int j = i + 1; j < n; ++j)
+      {
+        dx[i] -= r(i, j) * dx[j];
+      }
+      dx[i] /= r(i, i);
+    }
+    x += dx;
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusMath::PlusMath()
 {
@@ -52,7 +209,8 @@ PlusStatus PlusMath::LSQRMinimize(const std::vector< std::vector<double> >& aMat
   const int n = aMatrix.begin()->size();
   const int m = bVector.size();
 
-  std::vector<vnl_vector<double> > aMatrixVnl(m);
+  std::vector<vnl_vector<double> > aMatrixVnl;
+  aMatrixVnl.reserve(m);
   vnl_vector<double> row(n);
   for (unsigned int i = 0; i < aMatrix.size(); ++i)
   {
@@ -84,33 +242,186 @@ PlusStatus PlusMath::LSQRMinimize(const std::vector< vnl_vector<double> >& aMatr
     return PLUS_FAIL;
   }
 
-  // The coefficient matrix aMatrix should be m-by-n and the column vector bVector must have length m.
-  const int n = aMatrix.begin()->size();
-  const int m = bVector.size();
+  vnl_sparse_matrix<double> sparseMatrixLeftSide;
+  vnl_vector<double> vectorRightSide;
+  ConvertToSparseLinearSystem(aMatrix, bVector, sparseMatrixLeftSide, vectorRightSide);
+
+  return PlusMath::LSQRMinimizeIterative(sparseMatrixLeftSide, vectorRightSide, resultVector, mean, stdev, notOutliersIndices);
+}
 
-  vnl_sparse_matrix<double> sparseMatrixLeftSide(m, n);
-  vnl_vector<double> vectorRightSide(m);
+//----------------------------------------------------------------------------
+PlusStatus PlusMath::LSQRMinimize(const vnl_sparse_matrix<double>& sparseMatrixLeftSide, const vnl_vector<double>& vectorRightSide, vnl_vector<double>& resultVector, double* mean/*=NULL*/, double* stdev/*=NULL*/, vnl_vector<unsigned int>* notOutliersIndices/*NULL*/)
+{
+  LOG_TRACE("PlusMath::LSQRMinimize");
+
+  return PlusMath::LSQRMinimizeIterative(sparseMatrixLeftSide, vectorRightSide, resultVector, mean, stdev, notOutliersIndices);
+}
+
+//----------------------------------------------------------------------------
+/*
+The same robust least squares fitting as in LSQRMinimizeIterative, but the active rows are solved directly by QR factorization.
+The normal equations (A^T*A) x = A^T*b are not used, as forming A^T*A squares the condition number of the system.
+The factorization is O(m*n^2), which is cheap when the number of unknowns (n) is small. It is computed only once:
+outlier rows are removed from the R factor by Givens downdates, and the solution of the remaining rows is computed
+from the previous solution by corrected semi-normal equation steps. If downdating is inaccurate then the remaining
+rows are factorized again.
+*/
+PlusStatus PlusMath::LSQRMinimizeDense(const std::vector< vnl_vector<double> >& aMatrix, const std::vector<double>& bVector, vnl_vector<double>& resultVector, double* mean/*=NULL*/, double* stdev/*=NULL*/, vnl_vector<unsigned int>* notOutliersIndices/*=NULL*/)
+{
+  LOG_TRACE("PlusMath::LSQRMinimizeDense");
 
-  for (int row = 0; row < m; row++)
+  if (aMatrix.size() == 0)
+  {
+    LOG_ERROR("LSQRMinimize: A matrix is empty");
+    resultVector.clear();
+    return PLUS_FAIL;
+  }
+  if (bVector.size() == 0)
+  {
+    LOG_ERROR("LSQRMinimize: b vector is empty");
+    resultVector.clear();
+    return PLUS_FAIL;
+  }
+  if (aMatrix.size() != bVector.size())
+  {
+    LOG_ERROR("Input A matrix and b vector dimensions were not met (number of equations were not the same)!");
+    return PLUS_FAIL;
+  }
+
+  const unsigned int n = aMatrix.begin()->size();
+  const unsigned int m = bVector.size();
+  if (m <= MINIMUM_NUMBER_OF_CALIBRATION_EQUATIONS || m < n)
   {
-    // Populate the sparse matrix
-    for (int i = 0; i < n; i++)
+    LOG_ERROR("It was not possible calibrate! Not enough equations (equations: " << m << ", unknowns: " << n << ")");
+    return PLUS_FAIL;
+  }
+
+  std::vector<unsigned int> activeRows(m);
+  for (unsigned int row = 0; row < m; ++row)
+  {
+    activeRows[row] = row;
+  }
+  std::vector<unsigned int> remainingRows;
+  remainingRows.reserve(m);
+  std::vector<unsigned int> removedRows;
+  std::vector<double> differences;
+  differences.reserve(m);
+
+  vnl_matrix<double> r;
+  if (!FactorizeActiveRows(aMatrix, bVector, activeRows, r, resultVector))
+  {
+    // The iterative solver handles rank deficient systems more gracefully
+    LOG_DEBUG("LSQRMinimizeDense: system is rank deficient or badly conditioned, use iterative solver");
+    vnl_sparse_matrix<double> sparseMatrixLeftSide;
+    vnl_vector<double> vectorRightSide;
+    ConvertToSparseLinearSystem(aMatrix, bVector, sparseMatrixLeftSide, vectorRightSide);
+    return PlusMath::LSQRMinimizeIterative(sparseMatrixLeftSide, vectorRightSide, resultVector, mean, stdev, notOutliersIndices);
+  }
+
+  bool outlierRemoved(false);
+  while (true)
+  {
+    // Compute the difference between the measured and computed data ( Ax - b )
+    differences.clear();
+    double sumDifference = 0;
+    for (std::vector<unsigned int>::iterator rowIt = activeRows.begin(); rowIt != activeRows.end(); ++rowIt)
+    {
+      double difference = dot_product(aMatrix[*rowIt], resultVector) - bVector[*rowIt];
+      differences.push_back(difference);
+      sumDifference += difference;
+    }
+    const double meanDifference = sumDifference / differences.size();
+    double sumSquaredDiffFromMean = 0;
+    for (std::vector<double>::iterator differenceIt = differences.begin(); differenceIt != differences.end(); ++differenceIt)
+    {
+      sumSquaredDiffFromMean += (*differenceIt - meanDifference) * (*differenceIt - meanDifference);
+    }
+    const double stdevDifference = sqrt(sumSquaredDiffFromMean / differences.size());
+
+    LOG_DEBUG("Mean = " << std::fixed << meanDifference << "   Stdev = " << stdevDifference);
+
+    if (mean != NULL)
+    {
+      *mean = meanDifference;
+    }
+    if (stdev != NULL)
     {
-      sparseMatrixLeftSide(row, i) = aMatrix[row].get(i);
+      *stdev = stdevDifference;
     }
 
-    // Populate the vector
-    vectorRightSide.put(row, bVector[row]);
+    // If the difference from mean larger than thresholdMultiplier * stdev, remove it from equation
+    remainingRows.clear();
+    removedRows.clear();
+    for (unsigned int i = 0; i < activeRows.size(); ++i)
+    {
+      if (fabs(differences[i] - meanDifference) < LSQR_OUTLIER_THRESHOLD_MULTIPLIER * stdevDifference)
+      {
+        // Not an outlier
+        remainingRows.push_back(activeRows[i]);
+        continue;
+      }
+      removedRows.push_back(activeRows[i]);
+      LOG_DEBUG("Outlier: " << std::fixed << differences[i] << "(mean: " << meanDifference << "  stdev: " << stdevDifference << "  outlierTreshold: " << LSQR_OUTLIER_THRESHOLD_MULTIPLIER * stdevDifference << ")");
+    }
+
+    if (removedRows.empty())
+    {
+      LOG_DEBUG("*** Outlier removal was successful! No more outlier found!");
+      break;
+    }
+    outlierRemoved = true;
+    activeRows.swap(remainingRows);
+
+    if (activeRows.size() <= MINIMUM_NUMBER_OF_CALIBRATION_EQUATIONS || activeRows.size() < n)
+    {
+      LOG_ERROR("It was not possible calibrate! Not enough equations!");
+      return PLUS_FAIL;
+    }
+
+    // Remove the outlier rows from the factorization and continue from the previous solution
+    bool downdated = true;
+    for (std::vector<unsigned int>::iterator rowIt = removedRows.begin(); rowIt != removedRows.end() && downdated; ++rowIt)
+    {
+      downdated = DowndateTriangularFactor(r, aMatrix[*rowIt]);
+    }
+    if (downdated && IsWellConditionedTriangularFactor(r))
+    {
+      for (unsigned int step = 0; step < DENSE_LSQR_NUMBER_OF_REFINEMENT_STEPS; ++step)
+      {
+        RefineSolution(r, aMatrix, bVector, activeRows, resultVector);
+      }
+    }
+    else
+    {
+      LOG_DEBUG("LSQRMinimizeDense: downdated factorization is inaccurate, factorize the remaining rows");
+      if (!FactorizeActiveRows(aMatrix, bVector, activeRows, r, resultVector))
+      {
+        LOG_DEBUG("LSQRMinimizeDense: system is rank deficient or badly conditioned, use iterative solver");
+        vnl_sparse_matrix<double> sparseMatrixLeftSide;
+        vnl_vector<double> vectorRightSide;
+        ConvertToSparseLinearSystem(aMatrix, bVector, sparseMatrixLeftSide, vectorRightSide);
+        return PlusMath::LSQRMinimizeIterative(sparseMatrixLeftSide, vectorRightSide, resultVector, mean, stdev, notOutliersIndices);
+      }
+    }
   }
 
-  return PlusMath::LSQRMinimize(sparseMatrixLeftSide, vectorRightSide, resultVector, mean, stdev, notOutliersIndices);
-}
+  if (outlierRemoved && notOutliersIndices != NULL)
+  {
+    vnl_vector<unsigned int> remainingIndices(activeRows.size());
+    for (unsigned int i = 0; i < activeRows.size(); ++i)
+    {
+      remainingIndices.put(i, notOutliersIndices->get(activeRows[i]));
+    }
+    *notOutliersIndices = remainingIndices;
+  }
 
+  return PLUS_SUCCESS;
+}
 
 //----------------------------------------------------------------------------
-PlusStatus PlusMath::LSQRMinimize(const vnl_sparse_matrix<double>& sparseMatrixLeftSide, const vnl_vector<double>& vectorRightSide, vnl_vector<double>& resultVector, double* mean/*=NULL*/, double* stdev/*=NULL*/, vnl_vector<unsigned int>* notOutliersIndices/*NULL*/)
+PlusStatus PlusMath::LSQRMinimizeIterative(const vnl_sparse_matrix<double>& sparseMatrixLeftSide, const vnl_vector<double>& vectorRightSide, vnl_vector<double>& resultVector, double* mean/*=NULL*/, double* stdev/*=NULL*/, vnl_vector<unsigned int>* notOutliersIndices/*NULL*/)
 {
-  LOG_TRACE("PlusMath::LSQRMinimize");
+  LOG_TRACE("PlusMath::LSQRMinimizeIterative");
 
   PlusStatus returnStatus = PLUS_SUCCESS;
 
@@ -174,9 +485,7 @@ PlusStatus PlusMath::LSQRMinimize(const vnl_sparse_matrix<double>& sparseMatrixL
         return PLUS_FAIL;
     }
 
-    const double thresholdMultiplier = 3.0;
-
-    if (PlusMath::RemoveOutliersFromLSQR(aMatrix, bVector, resultVector, outlierFound, thresholdMultiplier, mean, stdev, notOutliersIndices) != PLUS_SUCCESS)
+    if (PlusMath::RemoveOutliersFromLSQR(aMatrix, bVector, resultVector, outlierFound, LSQR_OUTLIER_THRESHOLD_MULTIPLIER, mean, stdev, notOutliersIndices) != PLUS_SUCCESS)
     {
       LOG_WARNING("Failed to remove outliers from linear equations!");
       return PLUS_FAIL;
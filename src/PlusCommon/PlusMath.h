@@ -68,6 +68,20 @@ public:
   */
   static PlusStatus LSQRMinimize(const vnl_sparse_matrix<double> &sparseMatrixLeftSide, const vnl_vector<double> &vectorRightSide, vnl_vector<double> &resultVector, double* mean = NULL, double* stdev = NULL, vnl_vector<unsigned int>* notOutliersIndices=NULL); 
 
+  /*!
+    Solve Ax = b linear equations with the same robust method as LSQRMinimize, but using a direct QR factorization of the dense system.
+    Outlier rows are removed by downdating the factorization. Fast for small number of unknowns (used by pivot and spacing calibration).
+    If the system is rank deficient or badly conditioned then LSQRMinimizeIterative is used instead.
+    Fails if the number of equations is not larger than the minimum number of calibration equations (8) or the number of unknowns.
+  */
+  static PlusStatus LSQRMinimizeDense(const std::vector<vnl_vector<double> > &aMatrix, const std::vector<double> &bVector, vnl_vector<double> &resultVector, double* mean = NULL, double* stdev = NULL, vnl_vector<unsigned int>* notOutliersIndices=NULL); 
+
+  /*!
+    Solve Ax = b sparse linear equations with the iterative vnl_lsqr solver and outlier removal.
+    LSQRMinimize uses this method.
+  */
+  static PlusStatus LSQRMinimizeIterative(const vnl_sparse_matrix<double> &sparseMatrixLeftSide, const vnl_vector<double> &vectorRightSide, vnl_vector<double> &resultVector, double* mean = NULL, double* stdev = NULL, vnl_vector<unsigned int>* notOutliersIndices=NULL); 
+
   /*! Convert matrix between VTK and VNL */
   static void ConvertVnlMatrixToVtkMatrix(const vnl_matrix_fixed<double,4,4>& inVnlMatrix, vtkMatrix4x4* outVtkMatrix); 
   static void ConvertVtkMatrixToVnlMatrix(const vtkMatrix4x4* inVtkMatrix, vnl_matrix_fixed<double,4,4>& outVnlMatrix );
@@ -0,0 +1,290 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusProfiler.h"
+#include "vtkIGSIORecursiveCriticalSection.h"
+
+#include <atomic>
+#include <map>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+//------ File local content ---------------------------------------------------
+namespace
+{
+  // Heap allocations of the current thread. These are plain values, because they are updated
+  // from operator new, where no memory can be allocated.
+  thread_local unsigned long long ThreadNumberOfAllocations = 0;
+  thread_local unsigned long long ThreadAllocatedBytes = 0;
+
+  std::atomic<bool> AllocationCountingAvailable(false);
+
+  //-----------------------------------------------------------------------------
+  /*! Region that has been started on the current thread and not yet ended */
+  struct ActiveRegion
+  {
+    /*! Index in the statistics list, -1 if the region is not recorded */
+    int StatisticsIndex;
+    /*! Regions that were started before the last reset are not recorded */
+    unsigned long long Generation;
+    double StartWallTimeSec;
+    double StartCpuTimeSec;
+    unsigned long long StartNumberOfAllocations;
+    unsigned long long StartAllocatedBytes;
+  };
+
+  //-----------------------------------------------------------------------------
+  struct ThreadState
+  {
+    ThreadState()
+      : ThreadIndex(0)
+    {
+    }
+    int ThreadIndex;
+    std::vector<ActiveRegion> Stack;
+  };
+
+  thread_local ThreadState CurrentThreadState;
+
+  //-----------------------------------------------------------------------------
+  struct ProfilerState
+  {
+    ProfilerState()
+      : Enabled(false)
+      , NumberOfThreads(0)
+      , Generation(0)
+    {
+    }
+
+    std::atomic<bool> Enabled;
+    std::atomic<int> NumberOfThreads;
+
+    /*! Guards the members below */
+    vtkIGSIOSimpleRecursiveCriticalSection Mutex;
+    unsigned long long Generation;
+    std::vector<PlusProfiler::RegionStatistics> Statistics;
+    /*! Index of the statistics of each region, identified by the thread index and the region path */
+    std::map<std::pair<int, std::string>, int> StatisticsIndices;
+  };
+
+  //-----------------------------------------------------------------------------
+  // The state is intentionally never deleted: threads may still end regions during static destruction
+  ProfilerState& GetProfilerState()
+  {
+    static ProfilerState* state = new ProfilerState;
+    return *state;
+  }
+
+  //-----------------------------------------------------------------------------
+  double GetThreadCpuTimeSec()
+  {
+#ifdef _WIN32
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+    {
+      return 0.0;
+    }
+    ULARGE_INTEGER kernel, user;
+    kernel.LowPart = kernelTime.dwLowDateTime;
+    kernel.HighPart = kernelTime.dwHighDateTime;
+    user.LowPart = userTime.dwLowDateTime;
+    user.HighPart = userTime.dwHighDateTime;
+    // FILETIME is in 100 ns units
+    return (kernel.QuadPart + user.QuadPart) * 1e-7;
+#else
+    timespec cpuTime;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuTime) != 0)
+    {
+      return 0.0;
+    }
+    return cpuTime.tv_sec + cpuTime.tv_nsec * 1e-9;
+#endif
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusProfiler::RegionStatistics::RegionStatistics()
+  : ThreadIndex(0)
+  , ParentIndex(-1)
+  , Depth(0)
+  , NumberOfCalls(0)
+  , TotalWallTimeSec(0.0)
+  , MaxWallTimeSec(0.0)
+  , TotalCpuTimeSec(0.0)
+  , NumberOfAllocations(0)
+  , AllocatedBytes(0)
+{
+}
+
+//----------------------------------------------------------------------------
+void PlusProfiler::SetEnabled(bool enabled)
+{
+  GetProfilerState().Enabled = enabled;
+}
+
+//----------------------------------------------------------------------------
+bool PlusProfiler::IsEnabled()
+{
+  return GetProfilerState().Enabled;
+}
+
+//----------------------------------------------------------------------------
+void PlusProfiler::BeginRegion(const char* name)
+{
+  ProfilerState& state = GetProfilerState();
+  ThreadState& thread = CurrentThreadState;
+
+  ActiveRegion region;
+  region.StatisticsIndex = -1;
+  region.Generation = 0;
+  if (state.Enabled)
+  {
+    if (thread.ThreadIndex == 0)
+    {
+      thread.ThreadIndex = ++state.NumberOfThreads;
+    }
+    std::string regionName = (name != NULL ? name : "");
+
+    igsioLockGuard<vtkIGSIOSimpleRecursiveCriticalSection> stateGuard(&state.Mutex);
+    region.Generation = state.Generation;
+    bool parentRecorded = true;
+    int parentIndex = -1;
+    if (!thread.Stack.empty())
+    {
+      const ActiveRegion& parent = thread.Stack.back();
+      parentRecorded = (parent.StatisticsIndex >= 0 && parent.Generation == state.Generation);
+      parentIndex = parent.StatisticsIndex;
+    }
+    // Children of regions that are not recorded are not recorded either, as they could not be placed in the tree
+    if (parentRecorded)
+    {
+      std::string path = (parentIndex >= 0 ? state.Statistics[parentIndex].Path + "/" + regionName : regionName);
+      std::pair<int, std::string> key(thread.ThreadIndex, path);
+      std::map<std::pair<int, std::string>, int>::iterator indexIt = state.StatisticsIndices.find(key);
+      if (indexIt == state.StatisticsIndices.end())
+      {
+        RegionStatistics statistics;
+        statistics.Name = regionName;
+        statistics.Path = path;
+        statistics.ThreadIndex = thread.ThreadIndex;
+        statistics.ParentIndex = parentIndex;
+        statistics.Depth = (parentIndex >= 0 ? state.Statistics[parentIndex].Depth + 1 : 0);
+        state.Statistics.push_back(statistics);
+        indexIt = state.StatisticsIndices.insert(std::make_pair(key, static_cast<int>(state.Statistics.size()) - 1)).first;
+      }
+      region.StatisticsIndex = indexIt->second;
+    }
+  }
+
+  // Measurement starts after the bookkeeping, so that it is not included in the region time
+  thread.Stack.push_back(region);
+  thread.Stack.back().StartNumberOfAllocations = ThreadNumberOfAllocations;
+  thread.Stack.back().StartAllocatedBytes = ThreadAllocatedBytes;
+  thread.Stack.back().StartCpuTimeSec = GetThreadCpuTimeSec();
+  thread.Stack.back().StartWallTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+}
+
+//----------------------------------------------------------------------------
+void PlusProfiler::EndRegion()
+{
+  double endWallTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+  double endCpuTimeSec = GetThreadCpuTimeSec();
+  unsigned long long endNumberOfAllocations = ThreadNumberOfAllocations;
+  unsigned long long endAllocatedBytes = ThreadAllocatedBytes;
+
+  ThreadState& thread = CurrentThreadState;
+  if (thread.Stack.empty())
+  {
+    LOG_ERROR("PlusProfiler::EndRegion is called without a matching BeginRegion");
+    return;
+  }
+  ActiveRegion region = thread.Stack.back();
+  thread.Stack.pop_back();
+  if (region.StatisticsIndex < 0)
+  {
+    return;
+  }
+
+  ProfilerState& state = GetProfilerState();
+  igsioLockGuard<vtkIGSIOSimpleRecursiveCriticalSection> stateGuard(&state.Mutex);
+  if (region.Generation != state.Generation)
+  {
+    // statistics have been reset since the region started
+    return;
+  }
+  RegionStatistics& statistics = state.Statistics[region.StatisticsIndex];
+  double wallTimeSec = endWallTimeSec - region.StartWallTimeSec;
+  statistics.NumberOfCalls++;
+  statistics.TotalWallTimeSec += wallTimeSec;
+  if (wallTimeSec > statistics.MaxWallTimeSec)
+  {
+    statistics.MaxWallTimeSec = wallTimeSec;
+  }
+  statistics.TotalCpuTimeSec += endCpuTimeSec - region.StartCpuTimeSec;
+  statistics.NumberOfAllocations += endNumberOfAllocations - region.StartNumberOfAllocations;
+  statistics.AllocatedBytes += endAllocatedBytes - region.StartAllocatedBytes;
+}
+
+//----------------------------------------------------------------------------
+void PlusProfiler::Reset()
+{
+  ProfilerState& state = GetProfilerState();
+  igsioLockGuard<vtkIGSIOSimpleRecursiveCriticalSection> stateGuard(&state.Mutex);
+  state.Generation++;
+  state.Statistics.clear();
+  state.StatisticsIndices.clear();
+}
+
+//----------------------------------------------------------------------------
+std::vector<PlusProfiler::RegionStatistics> PlusProfiler::GetRegionStatistics()
+{
+  ProfilerState& state = GetProfilerState();
+  igsioLockGuard<vtkIGSIOSimpleRecursiveCriticalSection> stateGuard(&state.Mutex);
+  return state.Statistics;
+}
+
+//----------------------------------------------------------------------------
+bool PlusProfiler::IsAllocationCountingAvailable()
+{
+  return AllocationCountingAvailable;
+}
+
+//----------------------------------------------------------------------------
+void PlusProfiler::SetAllocationCountingAvailable(bool available)
+{
+  AllocationCountingAvailable = available;
+}
+
+//----------------------------------------------------------------------------
+void PlusProfiler::CountAllocation(size_t size)
+{
+  ThreadNumberOfAllocations++;
+  ThreadAllocatedBytes += size;
+}
+
+//----------------------------------------------------------------------------
+PlusProfilerScope::PlusProfilerScope(const char* name)
+  : Active(PlusProfiler::IsEnabled())
+{
+  if (this->Active)
+  {
+    PlusProfiler::BeginRegion(name);
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusProfilerScope::~PlusProfilerScope()
+{
+  if (this->Active)
+  {
+    PlusProfiler::EndRegion();
+  }
+}
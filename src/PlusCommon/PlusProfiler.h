@@ -0,0 +1,111 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusProfiler_h
+#define __PlusProfiler_h
+
+#include "vtkPlusCommonExport.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*!
+  \class PlusProfiler
+  \brief Collects timing statistics of named, nested code regions
+
+  Algorithms mark their processing stages with PLUS_PROFILE_SCOPE. Regions that are entered while
+  another region is active on the same thread are recorded as its children, so the statistics form
+  a call tree for each thread. Wall time, CPU time of the thread and, if Plus is built with
+  PLUS_PROFILER_COUNT_ALLOCATIONS, the number and size of heap allocations of the thread are accumulated
+  for each region. The statistics can be added to HTML reports by vtkPlusHTMLGenerator::AddProfilerReport.
+
+  Profiling is disabled by default, then a region costs only a flag check. Regions are meant
+  for processing stages (a frame, an optimization step), not for per-pixel operations,
+  because entering and leaving a region locks a mutex.
+
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusProfiler
+{
+public:
+  /*! Accumulated statistics of a region. Times and allocations include those of the child regions. */
+  struct RegionStatistics
+  {
+    RegionStatistics();
+    /*! Name of the region */
+    std::string Name;
+    /*! Names of the enclosing regions and the region, separated by '/' */
+    std::string Path;
+    /*! Sequential index of the thread that executed the region, starting from 1 */
+    int ThreadIndex;
+    /*! Index of the enclosing region in the statistics list, -1 for top-level regions */
+    int ParentIndex;
+    /*! Number of enclosing regions */
+    int Depth;
+    unsigned long long NumberOfCalls;
+    double TotalWallTimeSec;
+    double MaxWallTimeSec;
+    double TotalCpuTimeSec;
+    /*! Number and total size of heap allocations, only counted if IsAllocationCountingAvailable() */
+    unsigned long long NumberOfAllocations;
+    unsigned long long AllocatedBytes;
+  };
+
+  /*! Enable or disable recording of regions. Regions that are active when profiling is disabled are still completed. */
+  static void SetEnabled(bool enabled);
+  static bool IsEnabled();
+
+  /*! Start a region on the current thread. Prefer PLUS_PROFILE_SCOPE, which ends the region automatically. */
+  static void BeginRegion(const char* name);
+
+  /*! End the most recently started region of the current thread */
+  static void EndRegion();
+
+  /*! Remove all recorded statistics. Regions that are active during the reset are not recorded. */
+  static void Reset();
+
+  /*! Returns the statistics of all regions. Parent regions precede their children. */
+  static std::vector<RegionStatistics> GetRegionStatistics();
+
+  /*!
+    Returns true if heap allocations are counted. The global operator new is replaced in PlusProfilerAllocationCounting.cxx,
+    which is built into vtkPlusCommon if Plus is built with PLUS_PROFILER_COUNT_ALLOCATIONS.
+  */
+  static bool IsAllocationCountingAvailable();
+
+  /*! Called by the replaced operator new when the allocation counting is registered */
+  static void SetAllocationCountingAvailable(bool available);
+
+  /*! Count a heap allocation of the current thread. Called by the replaced operator new, it does not allocate memory. */
+  static void CountAllocation(size_t size);
+};
+
+/*!
+  \class PlusProfilerScope
+  \brief Records a profiler region from construction until destruction
+  \ingroup PlusLibCommon
+*/
+class vtkPlusCommonExport PlusProfilerScope
+{
+public:
+  explicit PlusProfilerScope(const char* name);
+  ~PlusProfilerScope();
+
+private:
+  bool Active;
+
+  PlusProfilerScope(const PlusProfilerScope&);  // Not implemented.
+  void operator=(const PlusProfilerScope&);  // Not implemented.
+};
+
+#define PLUS_PROFILER_CONCATENATE_IMPL(a, b) a##b
+#define PLUS_PROFILER_CONCATENATE(a, b) PLUS_PROFILER_CONCATENATE_IMPL(a, b)
+
+/*! Record the enclosing scope as a profiler region with the specified name */
+#define PLUS_PROFILE_SCOPE(name) PlusProfilerScope PLUS_PROFILER_CONCATENATE(plusProfilerScope, __LINE__)(name)
+
+#endif
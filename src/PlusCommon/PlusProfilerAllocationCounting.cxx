@@ -0,0 +1,114 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Replaces the global operator new and delete to count heap allocations in PlusProfiler regions.
+// This file is only built if Plus is built with PLUS_PROFILER_COUNT_ALLOCATIONS (and into the allocation counting test).
+// Nothing here may allocate memory or log, as it would recurse into operator new.
+
+#include "PlusConfigure.h"
+#include "PlusProfiler.h"
+
+#include <cstdlib>
+#include <new>
+
+//------ File local content ---------------------------------------------------
+namespace
+{
+  //-----------------------------------------------------------------------------
+  void* AllocateCounted(size_t size)
+  {
+    PlusProfiler::CountAllocation(size);
+    return malloc(size > 0 ? size : 1);
+  }
+
+  //-----------------------------------------------------------------------------
+  void* AllocateCountedOrThrow(size_t size)
+  {
+    void* memory = AllocateCounted(size);
+    while (memory == NULL)
+    {
+      std::new_handler handler = std::get_new_handler();
+      if (handler == NULL)
+      {
+        throw std::bad_alloc();
+      }
+      handler();
+      memory = malloc(size > 0 ? size : 1);
+    }
+    return memory;
+  }
+
+  //-----------------------------------------------------------------------------
+  struct AllocationCountingRegistration
+  {
+    AllocationCountingRegistration()
+    {
+      PlusProfiler::SetAllocationCountingAvailable(true);
+    }
+  };
+
+  AllocationCountingRegistration Registration;
+}
+
+//----------------------------------------------------------------------------
+void* operator new(size_t size)
+{
+  return AllocateCountedOrThrow(size);
+}
+
+//----------------------------------------------------------------------------
+void* operator new[](size_t size)
+{
+  return AllocateCountedOrThrow(size);
+}
+
+//----------------------------------------------------------------------------
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+  return AllocateCounted(size);
+}
+
+//----------------------------------------------------------------------------
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+  return AllocateCounted(size);
+}
+
+//----------------------------------------------------------------------------
+void operator delete(void* memory) noexcept
+{
+  free(memory);
+}
+
+//----------------------------------------------------------------------------
+void operator delete[](void* memory) noexcept
+{
+  free(memory);
+}
+
+//----------------------------------------------------------------------------
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+  free(memory);
+}
+
+//----------------------------------------------------------------------------
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+  free(memory);
+}
+
+//----------------------------------------------------------------------------
+void operator delete(void* memory, size_t) noexcept
+{
+  free(memory);
+}
+
+//----------------------------------------------------------------------------
+void operator delete[](void* memory, size_t) noexcept
+{
+  free(memory);
+}
@@ -0,0 +1,260 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusMathTest.cxx
+  \brief This test solves robust linear least squares problems with both the dense and the iterative
+  solver of PlusMath and checks that the results (solution, error statistics, outliers) are the same.
+  It also checks that the dense solver remains accurate for badly scaled systems and that it fails if there are
+  not enough equations.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusMath.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkMinimalStandardRandomSequence.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <iostream>
+#include <stdlib.h>
+
+///////////////////////////////////////////////////////////////////
+const double SOLUTION_TOLERANCE = 1e-6; // relative to the magnitude of the solution
+const double STATISTICS_TOLERANCE = 1e-6; // relative to the noise amplitude
+
+//-----------------------------------------------------------------------------
+// Generate an Ax = b system with uniform noise, where some rows are replaced by gross outliers
+void GenerateLinearSystem(vtkMinimalStandardRandomSequence* random, unsigned int numberOfEquations, unsigned int numberOfUnknowns, double noiseAmplitude, double outlierProbability,
+                          std::vector< vnl_vector<double> >& aMatrix, std::vector<double>& bVector, vnl_vector<double>& expectedSolution, int& numberOfOutliers)
+{
+  expectedSolution.set_size(numberOfUnknowns);
+  for (unsigned int i = 0; i < numberOfUnknowns; ++i)
+  {
+    random->Next();
+    expectedSolution[i] = random->GetRangeValue(-100, 100);
+  }
+
+  aMatrix.clear();
+  bVector.clear();
+  numberOfOutliers = 0;
+  vnl_vector<double> row(numberOfUnknowns);
+  for (unsigned int r = 0; r < numberOfEquations; ++r)
+  {
+    for (unsigned int i = 0; i < numberOfUnknowns; ++i)
+    {
+      random->Next();
+      row[i] = random->GetRangeValue(-1, 1);
+    }
+    random->Next();
+    double b = dot_product(row, expectedSolution) + random->GetRangeValue(-noiseAmplitude, noiseAmplitude);
+    random->Next();
+    if (random->GetValue() < outlierProbability)
+    {
+      random->Next();
+      b += random->GetRangeValue(50, 100) * noiseAmplitude * (random->GetValue() < 0.5 ? -1 : 1);
+      numberOfOutliers++;
+    }
+    aMatrix.push_back(row);
+    bVector.push_back(b);
+  }
+}
+
+//-----------------------------------------------------------------------------
+int CompareSolvers(vtkMinimalStandardRandomSequence* random, unsigned int numberOfEquations, unsigned int numberOfUnknowns, double noiseAmplitude, double outlierProbability)
+{
+  std::vector< vnl_vector<double> > aMatrix;
+  std::vector<double> bVector;
+  vnl_vector<double> expectedSolution;
+  int numberOfOutliers = 0;
+  GenerateLinearSystem(random, numberOfEquations, numberOfUnknowns, noiseAmplitude, outlierProbability, aMatrix, bVector, expectedSolution, numberOfOutliers);
+
+  vnl_sparse_matrix<double> sparseMatrixLeftSide(numberOfEquations, numberOfUnknowns);
+  vnl_vector<double> vectorRightSide(numberOfEquations);
+  for (unsigned int r = 0; r < numberOfEquations; ++r)
+  {
+    for (unsigned int i = 0; i < numberOfUnknowns; ++i)
+    {
+      sparseMatrixLeftSide(r, i) = aMatrix[r][i];
+    }
+    vectorRightSide[r] = bVector[r];
+  }
+
+  vnl_vector<unsigned int> allIndices(numberOfEquations);
+  for (unsigned int r = 0; r < numberOfEquations; ++r)
+  {
+    allIndices[r] = r;
+  }
+
+  vnl_vector<double> denseSolution(numberOfUnknowns, 0);
+  double denseMean = 0;
+  double denseStdev = 0;
+  vnl_vector<unsigned int> denseNotOutliers(allIndices);
+  double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  if (PlusMath::LSQRMinimizeDense(aMatrix, bVector, denseSolution, &denseMean, &denseStdev, &denseNotOutliers) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Dense solver failed (" << numberOfEquations << " equations, " << numberOfUnknowns << " unknowns)");
+    return 1;
+  }
+  double denseTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+  vnl_vector<double> iterativeSolution(numberOfUnknowns, 0);
+  double iterativeMean = 0;
+  double iterativeStdev = 0;
+  vnl_vector<unsigned int> iterativeNotOutliers(allIndices);
+  startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  if (PlusMath::LSQRMinimizeIterative(sparseMatrixLeftSide, vectorRightSide, iterativeSolution, &iterativeMean, &iterativeStdev, &iterativeNotOutliers) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Iterative solver failed (" << numberOfEquations << " equations, " << numberOfUnknowns << " unknowns)");
+    return 1;
+  }
+  double iterativeTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+  LOG_INFO(numberOfEquations << " equations, " << numberOfUnknowns << " unknowns, " << numberOfOutliers << " generated outliers: dense solver "
+           << denseTimeSec * 1000.0 << " ms, iterative solver " << iterativeTimeSec * 1000.0 << " ms");
+
+  int numberOfFailures = 0;
+  double solutionDifference = (denseSolution - iterativeSolution).inf_norm();
+  if (solutionDifference > SOLUTION_TOLERANCE * expectedSolution.inf_norm())
+  {
+    LOG_ERROR("Dense and iterative solutions differ by " << solutionDifference);
+    numberOfFailures++;
+  }
+  if (fabs(denseMean - iterativeMean) > STATISTICS_TOLERANCE * noiseAmplitude || fabs(denseStdev - iterativeStdev) > STATISTICS_TOLERANCE * noiseAmplitude)
+  {
+    LOG_ERROR("Dense and iterative error statistics differ: mean " << denseMean << " vs. " << iterativeMean << ", stdev " << denseStdev << " vs. " << iterativeStdev);
+    numberOfFailures++;
+  }
+  if (denseNotOutliers != iterativeNotOutliers)
+  {
+    LOG_ERROR("Dense and iterative solvers found different outliers: " << numberOfEquations - denseNotOutliers.size() << " vs. " << numberOfEquations - iterativeNotOutliers.size());
+    numberOfFailures++;
+  }
+  if (numberOfEquations - denseNotOutliers.size() < static_cast<unsigned int>(numberOfOutliers))
+  {
+    LOG_ERROR("Not all generated outliers were detected: " << numberOfEquations - denseNotOutliers.size() << " of " << numberOfOutliers);
+    numberOfFailures++;
+  }
+
+  return numberOfFailures;
+}
+
+//-----------------------------------------------------------------------------
+// Solve a system with badly scaled columns. Solving it through the normal equations would square the condition number and lose accuracy.
+int CheckBadlyScaledSystem(vtkMinimalStandardRandomSequence* random, unsigned int numberOfEquations, unsigned int numberOfUnknowns, double conditionNumber, double noiseAmplitude)
+{
+  std::vector< vnl_vector<double> > aMatrix;
+  std::vector<double> bVector;
+  vnl_vector<double> expectedSolution;
+  int numberOfOutliers = 0;
+  GenerateLinearSystem(random, numberOfEquations, numberOfUnknowns, noiseAmplitude, 0.0, aMatrix, bVector, expectedSolution, numberOfOutliers);
+
+  // Scale the columns from 1 to 1/conditionNumber, scale the solution inversely so b does not change
+  for (unsigned int i = 0; i < numberOfUnknowns; ++i)
+  {
+    double scale = pow(conditionNumber, -static_cast<double>(i) / (numberOfUnknowns - 1));
+    for (unsigned int r = 0; r < numberOfEquations; ++r)
+    {
+      aMatrix[r][i] *= scale;
+    }
+    expectedSolution[i] /= scale;
+  }
+
+  // Standard deviation of the residuals of the exact solution (only noise)
+  double sumResiduals = 0;
+  double sumSquaredResiduals = 0;
+  for (unsigned int r = 0; r < numberOfEquations; ++r)
+  {
+    double residual = dot_product(aMatrix[r], expectedSolution) - bVector[r];
+    sumResiduals += residual;
+    sumSquaredResiduals += residual * residual;
+  }
+  double expectedMean = sumResiduals / numberOfEquations;
+  double expectedStdev = sqrt(sumSquaredResiduals / numberOfEquations - expectedMean * expectedMean);
+
+  vnl_vector<double> denseSolution(numberOfUnknowns, 0);
+  double denseMean = 0;
+  double denseStdev = 0;
+  if (PlusMath::LSQRMinimizeDense(aMatrix, bVector, denseSolution, &denseMean, &denseStdev) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Dense solver failed on badly scaled system (condition number: " << conditionNumber << ")");
+    return 1;
+  }
+  LOG_INFO("Badly scaled system (condition number: " << conditionNumber << "): residual stdev " << denseStdev << ", noise stdev " << expectedStdev);
+
+  // The least squares solution cannot fit the data much worse than the exact solution
+  if (denseStdev > expectedStdev * 1.01)
+  {
+    LOG_ERROR("Dense solver is inaccurate on badly scaled system: residual stdev " << denseStdev << ", noise stdev " << expectedStdev);
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+// The dense solver must fail instead of returning an undefined solution if there are not enough equations (errors are logged)
+int CheckNotEnoughEquations(vtkMinimalStandardRandomSequence* random, unsigned int numberOfEquations, unsigned int numberOfUnknowns)
+{
+  std::vector< vnl_vector<double> > aMatrix;
+  std::vector<double> bVector;
+  vnl_vector<double> expectedSolution;
+  int numberOfOutliers = 0;
+  GenerateLinearSystem(random, numberOfEquations, numberOfUnknowns, 0.1, 0.0, aMatrix, bVector, expectedSolution, numberOfOutliers);
+
+  vnl_vector<double> denseSolution(numberOfUnknowns, 0);
+  if (PlusMath::LSQRMinimizeDense(aMatrix, bVector, denseSolution) != PLUS_FAIL)
+  {
+    LOG_ERROR("Dense solver did not fail with " << numberOfEquations << " equations and " << numberOfUnknowns << " unknowns");
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments cmdargs;
+  cmdargs.Initialize(argc, argv);
+  cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!cmdargs.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << cmdargs.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkMinimalStandardRandomSequence> random = vtkSmartPointer<vtkMinimalStandardRandomSequence>::New();
+  random->SetSeed(183495439); // Just some random number was chosen as seed
+
+  int numberOfFailures = 0;
+  // Spacing calibration like problem
+  numberOfFailures += CompareSolvers(random, 200, 2, 0.1, 0.0);
+  numberOfFailures += CompareSolvers(random, 200, 2, 0.1, 0.05);
+  // Pivot calibration like problem
+  numberOfFailures += CompareSolvers(random, 300, 6, 0.5, 0.05);
+  numberOfFailures += CompareSolvers(random, 3000, 6, 0.5, 0.05);
+  // Larger number of unknowns
+  numberOfFailures += CompareSolvers(random, 1000, 20, 0.5, 0.02);
+  // Badly scaled problem
+  numberOfFailures += CheckBadlyScaledSystem(random, 500, 4, 1e7, 1e-3);
+  // Not enough equations
+  numberOfFailures += CheckNotEnoughEquations(random, 8, 2);
+  numberOfFailures += CheckNotEnoughEquations(random, 10, 12);
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Number of failures: " << numberOfFailures);
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Exit success!!!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusProfilerAllocationTest.cxx
+  \brief This test is built with the replaced operator new of PLUS_PROFILER_COUNT_ALLOCATIONS and checks
+  that nested profiler regions report the heap allocations made in them and that the allocation
+  columns appear in the HTML report
+*/
+
+#include "PlusConfigure.h"
+#include "PlusProfiler.h"
+#include "vtkPlusHTMLGenerator.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+
+///////////////////////////////////////////////////////////////////
+const int NUMBER_OF_OUTER_CALLS = 3;
+const int NUMBER_OF_OUTER_ALLOCATIONS_PER_CALL = 2;
+const int NUMBER_OF_INNER_ALLOCATIONS_PER_CALL = 5;
+const size_t ALLOCATION_SIZE_BYTES = 1000;
+
+// The allocated blocks are kept here until the regions end, so that the allocations cannot be optimized away
+char* AllocatedBlocks[NUMBER_OF_OUTER_ALLOCATIONS_PER_CALL + NUMBER_OF_INNER_ALLOCATIONS_PER_CALL] = { NULL };
+
+//-----------------------------------------------------------------------------
+void RunNestedRegions()
+{
+  for (int i = 0; i < NUMBER_OF_OUTER_CALLS; i++)
+  {
+    {
+      PLUS_PROFILE_SCOPE("Outer");
+      for (int j = 0; j < NUMBER_OF_OUTER_ALLOCATIONS_PER_CALL; j++)
+      {
+        AllocatedBlocks[j] = new char[ALLOCATION_SIZE_BYTES];
+      }
+      {
+        PLUS_PROFILE_SCOPE("Inner");
+        for (int j = 0; j < NUMBER_OF_INNER_ALLOCATIONS_PER_CALL; j++)
+        {
+          AllocatedBlocks[NUMBER_OF_OUTER_ALLOCATIONS_PER_CALL + j] = new char[ALLOCATION_SIZE_BYTES];
+        }
+      }
+      {
+        PLUS_PROFILE_SCOPE("Empty");
+      }
+    }
+    for (int j = 0; j < NUMBER_OF_OUTER_ALLOCATIONS_PER_CALL + NUMBER_OF_INNER_ALLOCATIONS_PER_CALL; j++)
+    {
+      delete[] AllocatedBlocks[j];
+      AllocatedBlocks[j] = NULL;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+const PlusProfiler::RegionStatistics* FindRegion(const std::vector<PlusProfiler::RegionStatistics>& statistics, const std::string& path)
+{
+  for (std::vector<PlusProfiler::RegionStatistics>::const_iterator it = statistics.begin(); it != statistics.end(); ++it)
+  {
+    if (it->Path == path)
+    {
+      return &(*it);
+    }
+  }
+  return NULL;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments cmdargs;
+  cmdargs.Initialize(argc, argv);
+  cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!cmdargs.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << cmdargs.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (!PlusProfiler::IsAllocationCountingAvailable())
+  {
+    LOG_ERROR("Allocation counting is not available");
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int numberOfFailures = 0;
+
+  PlusProfiler::SetEnabled(true);
+  RunNestedRegions();
+  std::vector<PlusProfiler::RegionStatistics> statistics = PlusProfiler::GetRegionStatistics();
+  const PlusProfiler::RegionStatistics* outer = FindRegion(statistics, "Outer");
+  const PlusProfiler::RegionStatistics* inner = FindRegion(statistics, "Outer/Inner");
+  const PlusProfiler::RegionStatistics* empty = FindRegion(statistics, "Outer/Empty");
+  if (outer == NULL || inner == NULL || empty == NULL)
+  {
+    LOG_ERROR("Regions are not recorded");
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (inner->ParentIndex < 0 || &statistics[inner->ParentIndex] != outer || empty->ParentIndex < 0 || &statistics[empty->ParentIndex] != outer)
+  {
+    LOG_ERROR("Inner regions are not recorded as children of the outer region");
+    numberOfFailures++;
+  }
+
+  // The region bookkeeping is done outside of the measured interval, so a region only counts its own allocations
+  unsigned long long expectedInnerAllocations = NUMBER_OF_OUTER_CALLS * NUMBER_OF_INNER_ALLOCATIONS_PER_CALL;
+  if (inner->NumberOfAllocations != expectedInnerAllocations || inner->AllocatedBytes != expectedInnerAllocations * ALLOCATION_SIZE_BYTES)
+  {
+    LOG_ERROR("Unexpected allocations in the inner region: " << inner->NumberOfAllocations << " allocations, " << inner->AllocatedBytes << " bytes"
+              << " (expected " << expectedInnerAllocations << " allocations, " << expectedInnerAllocations * ALLOCATION_SIZE_BYTES << " bytes)");
+    numberOfFailures++;
+  }
+  if (empty->NumberOfAllocations != 0 || empty->AllocatedBytes != 0)
+  {
+    LOG_ERROR("Unexpected allocations in the empty region: " << empty->NumberOfAllocations << " allocations, " << empty->AllocatedBytes << " bytes");
+    numberOfFailures++;
+  }
+
+  // The outer region includes its own allocations, those of the child regions and the bookkeeping of the child regions
+  unsigned long long minimumOuterAllocations = expectedInnerAllocations + NUMBER_OF_OUTER_CALLS * NUMBER_OF_OUTER_ALLOCATIONS_PER_CALL;
+  if (outer->NumberOfAllocations < minimumOuterAllocations || outer->AllocatedBytes < minimumOuterAllocations * ALLOCATION_SIZE_BYTES)
+  {
+    LOG_ERROR("Unexpected allocations in the outer region: " << outer->NumberOfAllocations << " allocations, " << outer->AllocatedBytes << " bytes"
+              << " (expected at least " << minimumOuterAllocations << " allocations, " << minimumOuterAllocations * ALLOCATION_SIZE_BYTES << " bytes)");
+    numberOfFailures++;
+  }
+
+  // HTML report
+  vtkSmartPointer<vtkPlusHTMLGenerator> htmlGenerator = vtkSmartPointer<vtkPlusHTMLGenerator>::New();
+  htmlGenerator->SetTitle("Profiler allocation test report");
+  htmlGenerator->SetBaseFilename("PlusProfilerAllocationTestReport");
+  htmlGenerator->AddProfilerReport();
+  std::string htmlPage = htmlGenerator->GetHtmlPage();
+  if (htmlPage.find("<th>Allocations</th>") == std::string::npos || htmlPage.find("<th>Allocated [kB]</th>") == std::string::npos)
+  {
+    LOG_ERROR("Allocation columns are missing from the HTML report");
+    numberOfFailures++;
+  }
+  htmlGenerator->SaveHtmlPageAutoFilename();
+
+  PlusProfiler::SetEnabled(false);
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Number of failures: " << numberOfFailures);
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Exit success!!!" << std::endl;
+  return EXIT_SUCCESS;
+}
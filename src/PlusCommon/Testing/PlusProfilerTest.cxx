@@ -0,0 +1,194 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusProfilerTest.cxx
+  \brief This test records nested profiler regions on multiple threads and checks that the statistics
+  form the expected call tree, that nothing is recorded while profiling is disabled, and that the
+  statistics can be added to an HTML report
+*/
+
+#include "PlusConfigure.h"
+#include "PlusProfiler.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkMultiThreader.h"
+#include "vtkPlusHTMLGenerator.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+
+///////////////////////////////////////////////////////////////////
+const int NUMBER_OF_THREADS = 3;
+const int NUMBER_OF_OUTER_CALLS = 5;
+const int NUMBER_OF_INNER_CALLS_PER_OUTER_CALL = 4;
+const double INNER_REGION_DURATION_SEC = 0.002;
+
+//-----------------------------------------------------------------------------
+void RunNestedRegions()
+{
+  for (int i = 0; i < NUMBER_OF_OUTER_CALLS; i++)
+  {
+    PLUS_PROFILE_SCOPE("Outer");
+    for (int j = 0; j < NUMBER_OF_INNER_CALLS_PER_OUTER_CALL; j++)
+    {
+      PLUS_PROFILE_SCOPE("Inner");
+      vtkIGSIOAccurateTimer::Delay(INNER_REGION_DURATION_SEC);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void* RunNestedRegionsThread(vtkMultiThreader::ThreadInfo* vtkNotUsed(data))
+{
+  RunNestedRegions();
+  return NULL;
+}
+
+//-----------------------------------------------------------------------------
+const PlusProfiler::RegionStatistics* FindRegion(const std::vector<PlusProfiler::RegionStatistics>& statistics, int threadIndex, const std::string& path)
+{
+  for (std::vector<PlusProfiler::RegionStatistics>::const_iterator it = statistics.begin(); it != statistics.end(); ++it)
+  {
+    if (it->ThreadIndex == threadIndex && it->Path == path)
+    {
+      return &(*it);
+    }
+  }
+  return NULL;
+}
+
+//-----------------------------------------------------------------------------
+int CheckNestedRegions(const std::vector<PlusProfiler::RegionStatistics>& statistics, int threadIndex)
+{
+  int numberOfFailures = 0;
+  const PlusProfiler::RegionStatistics* outer = FindRegion(statistics, threadIndex, "Outer");
+  const PlusProfiler::RegionStatistics* inner = FindRegion(statistics, threadIndex, "Outer/Inner");
+  if (outer == NULL || inner == NULL)
+  {
+    LOG_ERROR("Regions of thread " << threadIndex << " are not recorded");
+    return 1;
+  }
+  if (outer->NumberOfCalls != NUMBER_OF_OUTER_CALLS || inner->NumberOfCalls != NUMBER_OF_OUTER_CALLS * NUMBER_OF_INNER_CALLS_PER_OUTER_CALL)
+  {
+    LOG_ERROR("Unexpected number of calls in thread " << threadIndex << ": Outer=" << outer->NumberOfCalls << ", Inner=" << inner->NumberOfCalls);
+    numberOfFailures++;
+  }
+  if (outer->Depth != 0 || inner->Depth != 1 || inner->ParentIndex < 0 || &statistics[inner->ParentIndex] != outer)
+  {
+    LOG_ERROR("Inner region of thread " << threadIndex << " is not recorded as a child of the outer region");
+    numberOfFailures++;
+  }
+  double minimumInnerTimeSec = 0.9 * INNER_REGION_DURATION_SEC * NUMBER_OF_OUTER_CALLS * NUMBER_OF_INNER_CALLS_PER_OUTER_CALL;
+  if (inner->TotalWallTimeSec < minimumInnerTimeSec || outer->TotalWallTimeSec < inner->TotalWallTimeSec)
+  {
+    LOG_ERROR("Unexpected region times in thread " << threadIndex << ": Outer=" << outer->TotalWallTimeSec << " sec, Inner=" << inner->TotalWallTimeSec << " sec");
+    numberOfFailures++;
+  }
+  if (inner->MaxWallTimeSec > inner->TotalWallTimeSec)
+  {
+    LOG_ERROR("Maximum time of a region is larger than its total time in thread " << threadIndex);
+    numberOfFailures++;
+  }
+  return numberOfFailures;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments cmdargs;
+  cmdargs.Initialize(argc, argv);
+  cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!cmdargs.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << cmdargs.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfFailures = 0;
+
+  // Disabled: nothing is recorded
+  PlusProfiler::SetEnabled(false);
+  RunNestedRegions();
+  if (!PlusProfiler::GetRegionStatistics().empty())
+  {
+    LOG_ERROR("Regions are recorded while profiling is disabled");
+    numberOfFailures++;
+  }
+
+  // Main thread
+  PlusProfiler::SetEnabled(true);
+  RunNestedRegions();
+  std::vector<PlusProfiler::RegionStatistics> statistics = PlusProfiler::GetRegionStatistics();
+  if (statistics.size() != 2)
+  {
+    LOG_ERROR("Unexpected number of regions recorded on the main thread: " << statistics.size());
+    numberOfFailures++;
+  }
+  else
+  {
+    numberOfFailures += CheckNestedRegions(statistics, statistics[0].ThreadIndex);
+  }
+
+  // Reset removes all statistics
+  PlusProfiler::Reset();
+  if (!PlusProfiler::GetRegionStatistics().empty())
+  {
+    LOG_ERROR("Regions are not removed by reset");
+    numberOfFailures++;
+  }
+
+  // Worker threads: each thread has its own call tree
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  threader->SetNumberOfThreads(NUMBER_OF_THREADS);
+  threader->SetSingleMethod((vtkThreadFunctionType)&RunNestedRegionsThread, NULL);
+  threader->SingleMethodExecute();
+  statistics = PlusProfiler::GetRegionStatistics();
+  if (statistics.size() != 2 * NUMBER_OF_THREADS)
+  {
+    LOG_ERROR("Unexpected number of regions recorded on " << NUMBER_OF_THREADS << " threads: " << statistics.size());
+    numberOfFailures++;
+  }
+  for (std::vector<PlusProfiler::RegionStatistics>::const_iterator it = statistics.begin(); it != statistics.end(); ++it)
+  {
+    if (it->Depth == 0)
+    {
+      numberOfFailures += CheckNestedRegions(statistics, it->ThreadIndex);
+    }
+  }
+
+  // HTML report
+  vtkSmartPointer<vtkPlusHTMLGenerator> htmlGenerator = vtkSmartPointer<vtkPlusHTMLGenerator>::New();
+  htmlGenerator->SetTitle("Profiler test report");
+  htmlGenerator->SetBaseFilename("PlusProfilerTestReport");
+  htmlGenerator->AddProfilerReport();
+  std::string htmlPage = htmlGenerator->GetHtmlPage();
+  if (htmlPage.find("Outer") == std::string::npos || htmlPage.find("Inner") == std::string::npos)
+  {
+    LOG_ERROR("Profiler regions are missing from the HTML report");
+    numberOfFailures++;
+  }
+  htmlGenerator->SaveHtmlPageAutoFilename();
+
+  PlusProfiler::SetEnabled(false);
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Number of failures: " << numberOfFailures);
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Exit success!!!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,225 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusLoggerTest.cxx
+  \brief This test logs debug messages from multiple threads with asynchronous logging enabled, checks that
+  no messages are dropped if the queues are large enough, that long messages are not truncated, and that the
+  written messages show the time when they were logged, not when they were written.
+  With --test-dropping it checks that full queues drop messages instead of blocking the logging threads.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkCallbackCommand.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkMultiThreader.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+
+///////////////////////////////////////////////////////////////////
+const int NUMBER_OF_THREADS = 4;
+const int NUMBER_OF_MESSAGES_PER_THREAD = 500;
+const int LARGE_QUEUE_CAPACITY = 1024;
+const int SMALL_QUEUE_CAPACITY = 16;
+const int NUMBER_OF_MESSAGES_TO_OVERFLOW = 2000;
+const double WRITER_BLOCKING_TIME_SEC = 0.2;
+const double MAX_TIMESTAMP_ERROR_SEC = 0.05;
+const char BLOCKING_MESSAGE[] = "Block the asynchronous log writer";
+const char DELAYED_MESSAGE[] = "Message written after the writer is unblocked";
+
+//-----------------------------------------------------------------------------
+struct LoggingThreadData
+{
+  int NumberOfMessages;
+  double LoggingTimeSec[NUMBER_OF_THREADS];
+};
+
+//-----------------------------------------------------------------------------
+void* LogMessages(vtkMultiThreader::ThreadInfo* data)
+{
+  LoggingThreadData* threadData = (LoggingThreadData*)(data->UserData);
+  double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  for (int i = 0; i < threadData->NumberOfMessages; i++)
+  {
+    LOG_DEBUG("Asynchronous log test message " << i << " of thread " << data->ThreadID << " value: " << i * 0.5);
+  }
+  threadData->LoggingTimeSec[data->ThreadID] = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+  return NULL;
+}
+
+//-----------------------------------------------------------------------------
+struct MessageObserverData
+{
+  MessageObserverData()
+    : WriterBlocked(false)
+    , DelayedMessageReceived(false)
+    , DelayedMessageTimestamp(0)
+  {
+  }
+  std::atomic<bool> WriterBlocked;
+  std::atomic<bool> DelayedMessageReceived;
+  double DelayedMessageTimestamp;
+};
+
+//-----------------------------------------------------------------------------
+// Called by the writer thread for each written message. It blocks the writer when it receives the blocking message.
+void OnMessageLogged(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eventId), void* clientData, void* callData)
+{
+  MessageObserverData* observerData = static_cast<MessageObserverData*>(clientData);
+  std::string message(static_cast<const char*>(callData));
+  if (message.find(BLOCKING_MESSAGE) != std::string::npos)
+  {
+    observerData->WriterBlocked = true;
+    vtkIGSIOAccurateTimer::Delay(WRITER_BLOCKING_TIME_SEC);
+  }
+  else if (message.find(DELAYED_MESSAGE) != std::string::npos)
+  {
+    // The message starts with |LEVEL|timestamp|
+    size_t timestampStart = message.find('|', 1) + 1;
+    observerData->DelayedMessageTimestamp = atof(message.substr(timestampStart, message.find('|', timestampStart) - timestampStart).c_str());
+    observerData->DelayedMessageReceived = true;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Log a message while the writer is blocked and check that the written message shows the time when it was logged
+int TestMessageTimestamp()
+{
+  MessageObserverData observerData;
+  vtkSmartPointer<vtkCallbackCommand> messageCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  messageCallback->SetCallback(OnMessageLogged);
+  messageCallback->SetClientData(&observerData);
+  unsigned long observerTag = vtkPlusLogger::Instance()->AddObserver(vtkPlusLogger::MessageLogged, messageCallback);
+
+  LOG_DEBUG(BLOCKING_MESSAGE);
+  while (!observerData.WriterBlocked)
+  {
+    vtkIGSIOAccurateTimer::Delay(0.001);
+  }
+  double loggingTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  LOG_DEBUG(DELAYED_MESSAGE);
+  vtkPlusLogger::FlushAsynchronousMessages();
+  vtkPlusLogger::Instance()->RemoveObserver(observerTag);
+
+  if (!observerData.DelayedMessageReceived)
+  {
+    LOG_ERROR("Message logged while the writer was blocked was not written");
+    return 1;
+  }
+  double timestampError = observerData.DelayedMessageTimestamp - loggingTime;
+  LOG_INFO("Timestamp of a message written " << WRITER_BLOCKING_TIME_SEC * 1000.0 << " ms after logging differs from the logging time by " << timestampError * 1000.0 << " ms");
+  if (fabs(timestampError) > MAX_TIMESTAMP_ERROR_SEC)
+  {
+    LOG_ERROR("Written message timestamp differs from the logging time by " << timestampError * 1000.0 << " ms");
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+  bool testDropping = false;
+
+  vtksys::CommandLineArguments cmdargs;
+  cmdargs.Initialize(argc, argv);
+  cmdargs.AddArgument("--test-dropping", vtksys::CommandLineArguments::NO_ARGUMENT, &testDropping, "Overflow a small queue and check that messages are dropped (the dropped messages are reported as warnings)");
+  cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!cmdargs.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << cmdargs.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  // Debug messages must be enabled, otherwise they are not queued
+  vtkPlusLogger::Instance()->SetLogLevel(std::max(verboseLevel, static_cast<int>(vtkPlusLogger::LOG_LEVEL_DEBUG)));
+
+  int numberOfFailures = 0;
+
+  // Large queues: all messages are written
+  vtkPlusLogger::SetAsynchronousQueueCapacity(LARGE_QUEUE_CAPACITY);
+  vtkPlusLogger::SetAsynchronousLogging(true);
+  if (!vtkPlusLogger::GetAsynchronousLogging())
+  {
+    LOG_ERROR("Asynchronous logging could not be enabled");
+    numberOfFailures++;
+  }
+
+  LoggingThreadData threadData;
+  threadData.NumberOfMessages = NUMBER_OF_MESSAGES_PER_THREAD;
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  threader->SetNumberOfThreads(NUMBER_OF_THREADS);
+  threader->SetSingleMethod((vtkThreadFunctionType)&LogMessages, &threadData);
+  threader->SingleMethodExecute();
+  vtkPlusLogger::FlushAsynchronousMessages();
+
+  double meanLogTimeUsec = 0;
+  for (int i = 0; i < NUMBER_OF_THREADS; i++)
+  {
+    meanLogTimeUsec += threadData.LoggingTimeSec[i] * 1e6 / (NUMBER_OF_THREADS * NUMBER_OF_MESSAGES_PER_THREAD);
+  }
+  // The time depends on the machine load, therefore it is only reported
+  LOG_INFO("Mean time of logging a debug message: " << meanLogTimeUsec << " us");
+  if (vtkPlusLogger::GetNumberOfDroppedMessages() != 0)
+  {
+    LOG_ERROR(vtkPlusLogger::GetNumberOfDroppedMessages() << " messages were dropped, although the queues were large enough for all messages");
+    numberOfFailures++;
+  }
+
+  // Small queue: the logging thread does not wait for the writer, the oldest messages are dropped instead
+  if (testDropping)
+  {
+    vtkPlusLogger::SetAsynchronousQueueCapacity(SMALL_QUEUE_CAPACITY);
+    threadData.NumberOfMessages = NUMBER_OF_MESSAGES_TO_OVERFLOW;
+    threader->SetNumberOfThreads(1);
+    threader->SingleMethodExecute();
+    vtkPlusLogger::FlushAsynchronousMessages();
+    LOG_INFO("Number of dropped messages: " << vtkPlusLogger::GetNumberOfDroppedMessages());
+    if (vtkPlusLogger::GetNumberOfDroppedMessages() == 0)
+    {
+      LOG_ERROR("No messages were dropped, although " << NUMBER_OF_MESSAGES_TO_OVERFLOW << " messages were logged into a queue of " << SMALL_QUEUE_CAPACITY << " messages");
+      numberOfFailures++;
+    }
+  }
+
+  numberOfFailures += TestMessageTimestamp();
+
+  // Long messages are not truncated
+  const std::string longMessage = std::string(10000, 'x') + "end";
+  vtkPlusLogger::GetThreadMessageStream() << longMessage;
+  size_t msgLength = 0;
+  const char* msgText = vtkPlusLogger::GetThreadMessage(msgLength);
+  if (msgLength != longMessage.size() || longMessage != msgText)
+  {
+    LOG_ERROR("Long message is truncated, length: " << msgLength << " (expected: " << longMessage.size() << ")");
+    numberOfFailures++;
+  }
+
+  vtkPlusLogger::SetAsynchronousLogging(false);
+  if (vtkPlusLogger::GetAsynchronousLogging())
+  {
+    LOG_ERROR("Asynchronous logging could not be disabled");
+    numberOfFailures++;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Number of failures: " << numberOfFailures);
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Exit success!!!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -304,6 +304,13 @@ PlusStatus vtkPlusConfig::LoadApplicationConfiguration()
     saveNeeded = true;
   }
 
+  // Read asynchronous logging
+  const char* asynchronousLogging = applicationConfigurationRoot->GetAttribute("AsynchronousLogging");
+  if (asynchronousLogging != NULL)
+  {
+    vtkPlusLogger::SetAsynchronousLogging(STRCASECMP(asynchronousLogging, "TRUE") == 0);
+  }
+
   // Read last device set config file
   const char* lastDeviceSetConfigFile = applicationConfigurationRoot->GetAttribute("LastDeviceSetConfigurationFileName");
   if ((lastDeviceSetConfigFile != NULL) && (STRCASECMP(lastDeviceSetConfigFile, "") != 0))
@@ -456,6 +463,11 @@ PlusStatus vtkPlusConfig::WriteApplicationConfiguration()
 
   // Save log level
   applicationConfigurationRoot->SetIntAttribute("LogLevel", vtkPlusLogger::Instance()->GetLogLevel());
+  // Asynchronous logging is only saved if it is set in the configuration, as it may be enabled temporarily from the command line
+  if (applicationConfigurationRoot->GetAttribute("AsynchronousLogging") != NULL)
+  {
+    applicationConfigurationRoot->SetAttribute("AsynchronousLogging", vtkPlusLogger::GetAsynchronousLogging() ? "TRUE" : "FALSE");
+  }
 
   // Save device set directory
   applicationConfigurationRoot->SetAttribute("DeviceSetConfigurationDirectory", this->DeviceSetConfigurationDirectory.c_str());
@@ -5,15 +5,66 @@
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusProfiler.h"
 #include "vtkPlusHTMLGenerator.h"
 #include "vtkObjectFactory.h"
 #include "vtksys/SystemTools.hxx"
 #include "vtkTable.h"
 #include "vtkVariant.h"
+#include <algorithm>
+#include <iomanip>
+#include <map>
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkPlusHTMLGenerator);
 
+//------ File local content ---------------------------------------------------
+namespace
+{
+  const int FLAME_GRAPH_ROW_HEIGHT_PX = 20;
+
+  //----------------------------------------------------------------------------
+  std::string EscapeHtml(const std::string& text)
+  {
+    std::string escaped;
+    for (std::string::const_iterator it = text.begin(); it != text.end(); ++it)
+    {
+      switch (*it)
+      {
+        case '<':
+          escaped += "&lt;";
+          break;
+        case '>':
+          escaped += "&gt;";
+          break;
+        case '&':
+          escaped += "&amp;";
+          break;
+        case '\'':
+          escaped += "&#39;";
+          break;
+        case '"':
+          escaped += "&quot;";
+          break;
+        default:
+          escaped += *it;
+      }
+    }
+    return escaped;
+  }
+
+  //----------------------------------------------------------------------------
+  // Append the indices of the region and its descendants in call tree order
+  void AppendRegionSubtree(int regionIndex, const std::vector<std::vector<int> >& children, std::vector<int>& orderedIndices)
+  {
+    orderedIndices.push_back(regionIndex);
+    for (std::vector<int>::const_iterator it = children[regionIndex].begin(); it != children[regionIndex].end(); ++it)
+    {
+      AppendRegionSubtree(*it, children, orderedIndices);
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkPlusHTMLGenerator::vtkPlusHTMLGenerator()
 {
@@ -245,6 +296,125 @@ void vtkPlusHTMLGenerator::AddTable(vtkTable* inputTable, int borderPx)
   this->HtmlBody << openTag.str() << table.str() << closeTag << std::endl;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusHTMLGenerator::AddProfilerReport()
+{
+  LOG_TRACE("vtkPlusHTMLGenerator::AddProfilerReport");
+  this->HtmlBody << "<h2>Performance profile</h2>" << std::endl;
+
+  std::vector<PlusProfiler::RegionStatistics> statistics = PlusProfiler::GetRegionStatistics();
+  if (statistics.empty())
+  {
+    this->HtmlBody << "<p>No profiling data is available. Profiling has to be enabled before the processing is started.</p>" << std::endl;
+    return;
+  }
+  bool showAllocations = PlusProfiler::IsAllocationCountingAvailable();
+
+  // Build the call tree of each thread. Parents precede their children in the statistics list.
+  std::vector<std::vector<int> > children(statistics.size());
+  std::map<int, std::vector<int> > rootsOfThreads;
+  for (int i = 0; i < static_cast<int>(statistics.size()); ++i)
+  {
+    if (statistics[i].ParentIndex >= 0)
+    {
+      children[statistics[i].ParentIndex].push_back(i);
+    }
+    else
+    {
+      rootsOfThreads[statistics[i].ThreadIndex].push_back(i);
+    }
+  }
+
+  for (std::map<int, std::vector<int> >::iterator threadIt = rootsOfThreads.begin(); threadIt != rootsOfThreads.end(); ++threadIt)
+  {
+    const std::vector<int>& roots = threadIt->second;
+    std::vector<int> orderedIndices;
+    double threadTotalTimeSec = 0.0;
+    int maxDepth = 0;
+    for (std::vector<int>::const_iterator rootIt = roots.begin(); rootIt != roots.end(); ++rootIt)
+    {
+      threadTotalTimeSec += statistics[*rootIt].TotalWallTimeSec;
+      AppendRegionSubtree(*rootIt, children, orderedIndices);
+    }
+
+    this->HtmlBody << "<h3>Thread " << threadIt->first << "</h3>" << std::endl;
+
+    // Table of the regions
+    std::ostringstream table;
+    table << std::fixed << std::setprecision(3);
+    table << "<table border='1'><tr><th>Region</th><th>Calls</th><th>Total time [ms]</th><th>Self time [ms]</th><th>Mean time [ms]</th><th>Max time [ms]</th><th>CPU time [ms]</th><th>Share of thread time [%]</th>";
+    if (showAllocations)
+    {
+      table << "<th>Allocations</th><th>Allocated [kB]</th>";
+    }
+    table << "</tr>";
+    for (std::vector<int>::const_iterator it = orderedIndices.begin(); it != orderedIndices.end(); ++it)
+    {
+      const PlusProfiler::RegionStatistics& region = statistics[*it];
+      maxDepth = std::max(maxDepth, region.Depth);
+      double childrenTimeSec = 0.0;
+      for (std::vector<int>::const_iterator childIt = children[*it].begin(); childIt != children[*it].end(); ++childIt)
+      {
+        childrenTimeSec += statistics[*childIt].TotalWallTimeSec;
+      }
+      table << "<tr><td style='padding-left:" << 5 + region.Depth * 20 << "px'>" << EscapeHtml(region.Name) << "</td>";
+      table << "<td>" << region.NumberOfCalls << "</td>";
+      table << "<td>" << region.TotalWallTimeSec * 1000.0 << "</td>";
+      table << "<td>" << std::max(0.0, region.TotalWallTimeSec - childrenTimeSec) * 1000.0 << "</td>";
+      table << "<td>" << (region.NumberOfCalls > 0 ? region.TotalWallTimeSec / region.NumberOfCalls : 0.0) * 1000.0 << "</td>";
+      table << "<td>" << region.MaxWallTimeSec * 1000.0 << "</td>";
+      table << "<td>" << region.TotalCpuTimeSec * 1000.0 << "</td>";
+      table << "<td>" << std::setprecision(1) << (threadTotalTimeSec > 0 ? region.TotalWallTimeSec / threadTotalTimeSec * 100.0 : 0.0) << std::setprecision(3) << "</td>";
+      if (showAllocations)
+      {
+        table << "<td>" << region.NumberOfAllocations << "</td>";
+        table << "<td>" << std::setprecision(1) << region.AllocatedBytes / 1024.0 << std::setprecision(3) << "</td>";
+      }
+      table << "</tr>";
+    }
+    table << "</table>";
+    this->HtmlBody << table.str() << std::endl;
+
+    // Flame graph: each region is a bar below its parent, its width is proportional to its time
+    if (threadTotalTimeSec <= 0)
+    {
+      continue;
+    }
+    std::vector<double> regionOffsetSec(statistics.size(), 0.0);
+    double rootOffsetSec = 0.0;
+    for (std::vector<int>::const_iterator rootIt = roots.begin(); rootIt != roots.end(); ++rootIt)
+    {
+      regionOffsetSec[*rootIt] = rootOffsetSec;
+      rootOffsetSec += statistics[*rootIt].TotalWallTimeSec;
+    }
+    std::ostringstream graph;
+    graph << std::fixed << std::setprecision(3);
+    graph << "<div style='position:relative; width:100%; height:" << (maxDepth + 1) * FLAME_GRAPH_ROW_HEIGHT_PX << "px; margin-top:10px; font-family:sans-serif; font-size:12px'>";
+    for (std::vector<int>::const_iterator it = orderedIndices.begin(); it != orderedIndices.end(); ++it)
+    {
+      const PlusProfiler::RegionStatistics& region = statistics[*it];
+      // Children are placed next to each other, starting at the beginning of the parent
+      double childOffsetSec = regionOffsetSec[*it];
+      for (std::vector<int>::const_iterator childIt = children[*it].begin(); childIt != children[*it].end(); ++childIt)
+      {
+        regionOffsetSec[*childIt] = childOffsetSec;
+        childOffsetSec += statistics[*childIt].TotalWallTimeSec;
+      }
+      // Warm colors from red (top-level) to yellow (deeply nested)
+      int hue = std::min(60, region.Depth * 12);
+      std::ostringstream title;
+      title << std::fixed << std::setprecision(3) << region.Path << ": " << region.TotalWallTimeSec * 1000.0 << " ms, " << region.NumberOfCalls << " calls";
+      graph << "<div title='" << EscapeHtml(title.str()) << "' style='position:absolute; overflow:hidden; white-space:nowrap; box-sizing:border-box; border:1px solid white;"
+            << " left:" << regionOffsetSec[*it] / threadTotalTimeSec * 100.0 << "%;"
+            << " width:" << region.TotalWallTimeSec / threadTotalTimeSec * 100.0 << "%;"
+            << " top:" << region.Depth * FLAME_GRAPH_ROW_HEIGHT_PX << "px; height:" << FLAME_GRAPH_ROW_HEIGHT_PX << "px;"
+            << " background-color:hsl(" << hue << ",85%,60%)'>" << EscapeHtml(region.Name) << "</div>";
+    }
+    graph << "</div>";
+    this->HtmlBody << graph.str() << std::endl;
+  }
+}
+
 //----------------------------------------------------------------------------
 std::string vtkPlusHTMLGenerator::GetHtmlBody()
 {
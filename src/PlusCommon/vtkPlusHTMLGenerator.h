@@ -62,6 +62,13 @@ public:
   /*! Add horizontal line separator to the document */
   virtual void AddHorizontalLine();
 
+  /*!
+    Add the statistics of the regions recorded by PlusProfiler to the document.
+    For each thread a table lists the regions in call tree order and a flame graph shows
+    the share of the child regions in the time of their parents.
+  */
+  virtual void AddProfilerReport();
+
   /*! Set the page title */
   vtkSetStringMacro(Title);
   /*! Get the page title */
@@ -8,10 +8,365 @@
 #include "PlusCommon.h"
 #include "vtkPlusLogger.h"
 
+// IGSIO includes
+#include <vtkIGSIOAccurateTimer.h>
+#include <vtkIGSIORecursiveCriticalSection.h>
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+// STL includes
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <vector>
+
 //-----------------------------------------------------------------------------
 namespace
 {
   vtkIGSIOSimpleRecursiveCriticalSection LoggerCreationCriticalSection;
+
+  const size_t MAX_ASYNC_MESSAGE_LENGTH = 511;
+  const size_t INITIAL_MESSAGE_BUFFER_SIZE = MAX_ASYNC_MESSAGE_LENGTH + 1;
+  const int DEFAULT_ASYNC_QUEUE_CAPACITY = 256;
+  const double ASYNC_WRITER_PERIOD_SEC = 0.005;
+  const int MAX_MESSAGE_NESTING_DEPTH = 4;
+
+  //-----------------------------------------------------------------------------
+  /*!
+    Stream buffer that writes into a reusable array. The array grows if a message does not fit, so messages are never truncated.
+    The grown array is kept, therefore memory is allocated only for the longest message of the thread.
+  */
+  class ThreadMessageBuffer : public std::streambuf
+  {
+  public:
+    ThreadMessageBuffer()
+      : Buffer(INITIAL_MESSAGE_BUFFER_SIZE)
+    {
+      this->Clear();
+    }
+    void Clear()
+    {
+      // the last character is reserved for the terminating zero
+      this->setp(&this->Buffer[0], &this->Buffer[0] + this->Buffer.size() - 1);
+    }
+    const char* GetMessage(size_t& length)
+    {
+      length = static_cast<size_t>(this->pptr() - this->pbase());
+      this->Buffer[length] = 0;
+      return &this->Buffer[0];
+    }
+  protected:
+    virtual int_type overflow(int_type ch)
+    {
+      if (traits_type::eq_int_type(ch, traits_type::eof()))
+      {
+        return traits_type::not_eof(ch);
+      }
+      size_t length = static_cast<size_t>(this->pptr() - this->pbase());
+      this->Buffer.resize(2 * this->Buffer.size());
+      this->setp(&this->Buffer[0], &this->Buffer[0] + this->Buffer.size() - 1);
+      this->pbump(static_cast<int>(length));
+      *this->pptr() = traits_type::to_char_type(ch);
+      this->pbump(1);
+      return ch;
+    }
+  private:
+    std::vector<char> Buffer;
+  };
+
+  //-----------------------------------------------------------------------------
+  struct ThreadMessageStream
+  {
+    ThreadMessageStream()
+      : Stream(&Buffer)
+    {
+      this->DefaultFlags = this->Stream.flags();
+    }
+    ThreadMessageBuffer Buffer;
+    std::ostream Stream;
+    std::ios_base::fmtflags DefaultFlags;
+  };
+
+  /*!
+    A message may be formatted while another one is being formatted on the same thread (when a function called
+    while formatting logs a message), therefore each nesting level has its own stream
+  */
+  struct ThreadMessageStreams
+  {
+    ThreadMessageStreams()
+      : Depth(0)
+    {
+    }
+    ThreadMessageStream Streams[MAX_MESSAGE_NESTING_DEPTH];
+    int Depth;
+  };
+
+  thread_local ThreadMessageStreams CurrentThreadMessageStreams;
+
+  //-----------------------------------------------------------------------------
+  /*! Message waiting to be written */
+  struct LogRecord
+  {
+    vtkIGSIOLogger::LogLevelType Level;
+    double Timestamp;
+    const char* FileName;
+    int LineNumber;
+    size_t MessageLength;
+    char Message[MAX_ASYNC_MESSAGE_LENGTH + 1];
+  };
+
+  //-----------------------------------------------------------------------------
+  /*!
+    Bounded lock-free queue of log records (D. Vyukov's bounded MPMC queue).
+    Records are pushed by the owner thread only, but both the owner (when dropping the oldest record)
+    and the writer thread pop records, therefore popping must be safe from multiple threads.
+  */
+  class ThreadLogQueue
+  {
+  public:
+    explicit ThreadLogQueue(size_t capacity)
+      : NumberOfDroppedRecords(0)
+      , Orphaned(false)
+      , Slots(new Slot[capacity])
+      , Mask(capacity - 1)
+      , EnqueuePosition(0)
+      , DequeuePosition(0)
+    {
+      for (size_t i = 0; i < capacity; i++)
+      {
+        this->Slots[i].Sequence.store(i, std::memory_order_relaxed);
+      }
+    }
+
+    /*! Copy a message into the queue. Returns false if the queue is full. */
+    bool TryPush(vtkIGSIOLogger::LogLevelType level, double timestamp, const char* msg, size_t msgLength, const char* fileName, int lineNumber)
+    {
+      Slot* slot = NULL;
+      size_t position = this->EnqueuePosition.load(std::memory_order_relaxed);
+      while (true)
+      {
+        slot = &this->Slots[position & this->Mask];
+        size_t sequence = slot->Sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0)
+        {
+          if (this->EnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+          {
+            break;
+          }
+        }
+        else if (difference < 0)
+        {
+          // full
+          return false;
+        }
+        else
+        {
+          position = this->EnqueuePosition.load(std::memory_order_relaxed);
+        }
+      }
+      LogRecord& record = slot->Record;
+      record.Level = level;
+      record.Timestamp = timestamp;
+      record.FileName = fileName;
+      record.LineNumber = lineNumber;
+      record.MessageLength = std::min(msgLength, MAX_ASYNC_MESSAGE_LENGTH);
+      memcpy(record.Message, msg, record.MessageLength);
+      record.Message[record.MessageLength] = 0;
+      slot->Sequence.store(position + 1, std::memory_order_release);
+      return true;
+    }
+
+    /*! Remove the oldest record from the queue. If record is NULL then the record is discarded. Returns false if the queue is empty. */
+    bool TryPop(LogRecord* record)
+    {
+      Slot* slot = NULL;
+      size_t position = this->DequeuePosition.load(std::memory_order_relaxed);
+      while (true)
+      {
+        slot = &this->Slots[position & this->Mask];
+        size_t sequence = slot->Sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+        if (difference == 0)
+        {
+          if (this->DequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+          {
+            break;
+          }
+        }
+        else if (difference < 0)
+        {
+          // empty
+          return false;
+        }
+        else
+        {
+          position = this->DequeuePosition.load(std::memory_order_relaxed);
+        }
+      }
+      if (record != NULL)
+      {
+        const LogRecord& queuedRecord = slot->Record;
+        record->Level = queuedRecord.Level;
+        record->Timestamp = queuedRecord.Timestamp;
+        record->FileName = queuedRecord.FileName;
+        record->LineNumber = queuedRecord.LineNumber;
+        record->MessageLength = queuedRecord.MessageLength;
+        memcpy(record->Message, queuedRecord.Message, queuedRecord.MessageLength + 1);
+      }
+      slot->Sequence.store(position + this->Mask + 1, std::memory_order_release);
+      return true;
+    }
+
+    /*! Number of records dropped since the writer thread last checked the queue */
+    std::atomic<unsigned long long> NumberOfDroppedRecords;
+
+    /*! Set when the owner thread exits, the writer thread deletes the queue when it is empty */
+    std::atomic<bool> Orphaned;
+
+  private:
+    struct Slot
+    {
+      std::atomic<size_t> Sequence;
+      LogRecord Record;
+    };
+    std::unique_ptr<Slot[]> Slots;
+    size_t Mask;
+    std::atomic<size_t> EnqueuePosition;
+    std::atomic<size_t> DequeuePosition;
+  };
+
+  //-----------------------------------------------------------------------------
+  /*! Shared state of the asynchronous logging */
+  struct AsyncLoggingState
+  {
+    AsyncLoggingState()
+      : Enabled(false)
+      , QueueCapacity(DEFAULT_ASYNC_QUEUE_CAPACITY)
+      , NumberOfDroppedRecords(0)
+      , WriterStopRequested(false)
+      , WriterThreadId(-1)
+      , ExitHandlerRegistered(false)
+    {
+    }
+
+    std::atomic<bool> Enabled;
+    std::atomic<int> QueueCapacity;
+
+    /*! Queues of all threads that have logged asynchronously, guarded by QueuesMutex */
+    std::vector<ThreadLogQueue*> Queues;
+    vtkIGSIOSimpleRecursiveCriticalSection QueuesMutex;
+
+    /*! Records that are dropped and already reported, guarded by WriteMutex */
+    unsigned long long NumberOfDroppedRecords;
+
+    /*! Only one thread can collect records at a time */
+    vtkIGSIOSimpleRecursiveCriticalSection WriteMutex;
+
+    /*!
+      Collected batches are written without holding WriteMutex. OutputMutex is locked before WriteMutex is released,
+      so batches are written in the order they were collected.
+    */
+    vtkIGSIOSimpleRecursiveCriticalSection OutputMutex;
+
+    /*! Enabling and disabling is serialized by ControlMutex */
+    vtkIGSIOSimpleRecursiveCriticalSection ControlMutex;
+    vtkSmartPointer<vtkMultiThreader> Threader;
+    std::atomic<bool> WriterStopRequested;
+    int WriterThreadId;
+    bool ExitHandlerRegistered;
+  };
+
+  //-----------------------------------------------------------------------------
+  // The state is intentionally never deleted: the writer thread and exiting threads may still access it during static destruction
+  AsyncLoggingState& GetAsyncLoggingState()
+  {
+    static AsyncLoggingState* state = new AsyncLoggingState;
+    return *state;
+  }
+
+  //-----------------------------------------------------------------------------
+  /*!
+    Set when the queue of the current thread is released. Messages that are logged by the thread after that
+    (e.g., by destructors of other thread-local objects) are written immediately.
+    It has no destructor, therefore it can be read until the thread ends.
+  */
+  thread_local bool CurrentThreadLogQueueReleased = false;
+
+  //-----------------------------------------------------------------------------
+  /*! Queue of the current thread, marked as orphaned when the thread exits */
+  struct ThreadLogQueueHandle
+  {
+    ThreadLogQueueHandle()
+      : Queue(NULL)
+    {
+    }
+    ~ThreadLogQueueHandle()
+    {
+      if (this->Queue != NULL)
+      {
+        this->Queue->Orphaned.store(true, std::memory_order_release);
+        this->Queue = NULL;
+      }
+      CurrentThreadLogQueueReleased = true;
+    }
+    ThreadLogQueue* Queue;
+  };
+
+  thread_local ThreadLogQueueHandle CurrentThreadLogQueue;
+
+  //-----------------------------------------------------------------------------
+  bool IsRecordOlder(const LogRecord* a, const LogRecord* b)
+  {
+    return a->Timestamp < b->Timestamp;
+  }
+
+  //-----------------------------------------------------------------------------
+  /*!
+    Format a record the same way as vtkIGSIOLogger::LogMessage, but with the time when the message was logged
+    instead of the time when it is written. consoleLine receives the line without the date and time prefix of the log file,
+    the file line is appended to fileLines.
+  */
+  void FormatRecord(const LogRecord& record, std::string& consoleLine, std::ostream& fileLines)
+  {
+    std::ostringstream line;
+    line << (record.Level == vtkIGSIOLogger::LOG_LEVEL_TRACE ? "|TRACE" : "|DEBUG");
+    line << "|" << std::fixed << std::setw(10) << std::right << std::setfill('0') << record.Timestamp;
+    line << "| ";
+    line.write(record.Message, record.MessageLength);
+    if (record.FileName != NULL)
+    {
+      line << "| in " << record.FileName << "(" << record.LineNumber << ")";
+    }
+    consoleLine = line.str();
+
+    // Date and time in the format of vtkIGSIOAccurateTimer::GetDateAndTimeMSecString
+    double universalTime = vtkIGSIOAccurateTimer::GetUniversalTimeFromSystemTime(record.Timestamp);
+    time_t seconds = static_cast<time_t>(floor(universalTime));
+    int milliseconds = static_cast<int>((universalTime - floor(universalTime)) * 1000.0);
+    char dateAndTime[32] = {0};
+    strftime(dateAndTime, sizeof(dateAndTime), "%m%d%y_%H%M%S", localtime(&seconds));
+    std::ostringstream dateAndTimeMSec;
+    dateAndTimeMSec << dateAndTime << "." << std::setw(3) << std::setfill('0') << milliseconds;
+    fileLines << std::setw(17) << std::left << std::setfill(' ') << dateAndTimeMSec.str() << consoleLine << "\n";
+  }
+
+  //-----------------------------------------------------------------------------
+  /*! Write the queued messages when the application exits without disabling asynchronous logging */
+  void StopAsynchronousLoggingAtExit()
+  {
+    vtkPlusLogger::SetAsynchronousLogging(false);
+  }
 }
 
 //-------------------------------------------------------
@@ -54,3 +409,289 @@ vtkIGSIOLogger* vtkPlusLogger::Instance()
 
   return m_pInstance;
 }
+
+//-------------------------------------------------------
+void vtkPlusLogger::SetAsynchronousLogging(bool enable)
+{
+  AsyncLoggingState& state = GetAsyncLoggingState();
+  igsioLockGuard<vtkIGSIOSimpleRecursiveCriticalSection> controlGuard(&state.ControlMutex);
+  if (enable == state.Enabled.load())
+  {
+    return;
+  }
+
+  if (enable)
+  {
+    if (state.Threader == NULL)
+    {
+      state.Threader = vtkSmartPointer<vtkMultiThreader>::New();
+    }
+    if (!state.ExitHandlerRegistered)
+    {
+      atexit(StopAsynchronousLoggingAtExit);
+      state.ExitHandlerRegistered = true;
+    }
+    state.WriterStopRequested.store(false);
+    state.WriterThreadId = state.Threader->SpawnThread((vtkThreadFunctionType)&AsyncWriterThread, &state);
+    state.Enabled.store(true, std::memory_order_release);
+    return;
+  }
+
+  // New messages are written immediately from now on, the writer thread writes all the queued messages before it stops
+  state.Enabled.store(false, std::memory_order_release);
+  state.WriterStopRequested.store(true);
+  // Wait until the thread stops
+  state.Threader->TerminateThread(state.WriterThreadId);
+  state.WriterThreadId = -1;
+
+  // Messages that were queued while the writer was stopping
+  WriteQueuedMessages();
+}
+
+//-------------------------------------------------------
+bool vtkPlusLogger::GetAsynchronousLogging()
+{
+  return GetAsyncLoggingState().Enabled.load(std::memory_order_acquire);
+}
+
+//-------------------------------------------------------
+void vtkPlusLogger::SetAsynchronousQueueCapacity(int numberOfRecords)
+{
+  int capacity = 2;
+  while (capacity < numberOfRecords && capacity < (1 << 20))
+  {
+    capacity *= 2;
+  }
+  GetAsyncLoggingState().QueueCapacity.store(capacity);
+}
+
+//-------------------------------------------------------
+int vtkPlusLogger::GetAsynchronousQueueCapacity()
+{
+  return GetAsyncLoggingState().QueueCapacity.load();
+}
+
+//-------------------------------------------------------
+unsigned long long vtkPlusLogger::GetNumberOfDroppedMessages()
+{
+  AsyncLoggingState& state = GetAsyncLoggingState();
+  unsigned long long numberOfDroppedRecords = 0;
+  {
+    igsioLockGuard<vtkIGSIOSimpleRecursiveCriticalSection> writeGuard(&state.WriteMutex);
+    numberOfDroppedRecords = state.NumberOfDroppedRecords;
+  }
+  igsioLockGuard<vtkIGSIOSimpleRecursiveCriticalSection> queuesGuard(&state.QueuesMutex);
+  for (std::vector<ThreadLogQueue*>::iterator it = state.Queues.begin(); it != state.Queues.end(); ++it)
+  {
+    numberOfDroppedRecords += (*it)->NumberOfDroppedRecords.load();
+  }
+  return numberOfDroppedRecords;
+}
+
+//-------------------------------------------------------
+void vtkPlusLogger::FlushAsynchronousMessages()
+{
+  // A write pass that is in progress is completed before this one starts, so all previously queued records are written when this returns
+  WriteQueuedMessages();
+}
+
+//-------------------------------------------------------
+void vtkPlusLogger::LogMessageAsync(LogLevelType level, const char* msg, size_t msgLength, const char* fileName, int lineNumber)
+{
+  AsyncLoggingState& state = GetAsyncLoggingState();
+  // Messages that do not fit into a queue record are written immediately, so that they are not truncated
+  if (!state.Enabled.load(std::memory_order_acquire) || CurrentThreadLogQueueReleased || msgLength > MAX_ASYNC_MESSAGE_LENGTH)
+  {
+    Instance()->LogMessage(level, std::string(msg, msgLength), fileName, lineNumber);
+    return;
+  }
+
+  ThreadLogQueue* queue = CurrentThreadLogQueue.Queue;
+  if (queue == NULL)
+  {
+    // First asynchronous message of this thread
+    queue = new ThreadLogQueue(static_cast<size_t>(state.QueueCapacity.load()));
+    {
+      igsioLockGuard<vtkIGSIOSimpleRecursiveCriticalSection> queuesGuard(&state.QueuesMutex);
+      state.Queues.push_back(queue);
+    }
+    CurrentThreadLogQueue.Queue = queue;
+  }
+
+  double timestamp = vtkIGSIOAccurateTimer::GetSystemTime();
+  if (queue->TryPush(level, timestamp, msg, msgLength, fileName, lineNumber))
+  {
+    return;
+  }
+
+  // The queue is full: drop the oldest record to make room for the newest one.
+  // If the writer thread empties the slot in the meantime then the push succeeds without dropping.
+  if (queue->TryPop(NULL))
+  {
+    queue->NumberOfDroppedRecords++;
+  }
+  if (!queue->TryPush(level, timestamp, msg, msgLength, fileName, lineNumber))
+  {
+    queue->NumberOfDroppedRecords++;
+  }
+}
+
+//-------------------------------------------------------
+std::ostream& vtkPlusLogger::GetThreadMessageStream()
+{
+  ThreadMessageStreams& streams = CurrentThreadMessageStreams;
+  ThreadMessageStream& messageStream = streams.Streams[std::min(streams.Depth, MAX_MESSAGE_NESTING_DEPTH - 1)];
+  streams.Depth++;
+  messageStream.Buffer.Clear();
+  messageStream.Stream.clear();
+  messageStream.Stream.flags(messageStream.DefaultFlags);
+  messageStream.Stream.precision(6);
+  messageStream.Stream.fill(' ');
+  return messageStream.Stream;
+}
+
+//-------------------------------------------------------
+const char* vtkPlusLogger::GetThreadMessage(size_t& msgLength)
+{
+  ThreadMessageStreams& streams = CurrentThreadMessageStreams;
+  streams.Depth = std::max(streams.Depth - 1, 0);
+  return streams.Streams[std::min(streams.Depth, MAX_MESSAGE_NESTING_DEPTH - 1)].Buffer.GetMessage(msgLength);
+}
+
+//-------------------------------------------------------
+void* vtkPlusLogger::AsyncWriterThread(vtkMultiThreader::ThreadInfo* data)
+{
+  AsyncLoggingState* state = (AsyncLoggingState*)(data->UserData);
+
+  // Write messages until a stop is requested
+  while (!state->WriterStopRequested.load())
+  {
+    WriteQueuedMessages();
+    vtkIGSIOAccurateTimer::Delay(ASYNC_WRITER_PERIOD_SEC);
+  }
+
+  // Messages that were queued before the stop request are still written
+  WriteQueuedMessages();
+  return NULL;
+}
+
+//-------------------------------------------------------
+void vtkPlusLogger::WriteQueuedMessages()
+{
+  AsyncLoggingState& state = GetAsyncLoggingState();
+  std::vector<LogRecord> batch;
+  size_t numberOfRecords = 0;
+  unsigned long long numberOfNewlyDroppedRecords = 0;
+  unsigned long long totalNumberOfDroppedRecords = 0;
+
+  state.WriteMutex.Lock();
+
+  std::vector<ThreadLogQueue*> queues;
+  {
+    igsioLockGuard<vtkIGSIOSimpleRecursiveCriticalSection> queuesGuard(&state.QueuesMutex);
+    queues = state.Queues;
+  }
+
+  // Collect the records of all threads. The queue mutex is not locked, so threads can log while records are collected.
+  std::vector<ThreadLogQueue*> emptyOrphanedQueues;
+  for (std::vector<ThreadLogQueue*>::iterator queueIt = queues.begin(); queueIt != queues.end(); ++queueIt)
+  {
+    ThreadLogQueue* queue = *queueIt;
+    // Orphaned must be checked before the queue is emptied, as nothing is pushed into an orphaned queue
+    bool orphaned = queue->Orphaned.load(std::memory_order_acquire);
+    while (true)
+    {
+      if (numberOfRecords >= batch.size())
+      {
+        batch.resize(std::max<size_t>(2 * batch.size(), 64));
+      }
+      if (!queue->TryPop(&batch[numberOfRecords]))
+      {
+        break;
+      }
+      numberOfRecords++;
+    }
+    numberOfNewlyDroppedRecords += queue->NumberOfDroppedRecords.exchange(0);
+    if (orphaned)
+    {
+      emptyOrphanedQueues.push_back(queue);
+    }
+  }
+
+  if (!emptyOrphanedQueues.empty())
+  {
+    igsioLockGuard<vtkIGSIOSimpleRecursiveCriticalSection> queuesGuard(&state.QueuesMutex);
+    for (std::vector<ThreadLogQueue*>::iterator queueIt = emptyOrphanedQueues.begin(); queueIt != emptyOrphanedQueues.end(); ++queueIt)
+    {
+      state.Queues.erase(std::remove(state.Queues.begin(), state.Queues.end(), *queueIt), state.Queues.end());
+      delete *queueIt;
+    }
+  }
+
+  state.NumberOfDroppedRecords += numberOfNewlyDroppedRecords;
+  totalNumberOfDroppedRecords = state.NumberOfDroppedRecords;
+
+  // The records are written outside WriteMutex, so collecting the next batch does not wait for the disk.
+  // OutputMutex is locked even if there is nothing to write, so that a flush returns only after
+  // the batches collected before it are written.
+  state.OutputMutex.Lock();
+  state.WriteMutex.Unlock();
+
+  if (numberOfRecords > 0)
+  {
+    // Records of different threads are written in the order they were logged
+    std::vector<const LogRecord*> sortedBatch;
+    sortedBatch.reserve(numberOfRecords);
+    for (size_t i = 0; i < numberOfRecords; i++)
+    {
+      sortedBatch.push_back(&batch[i]);
+    }
+    std::stable_sort(sortedBatch.begin(), sortedBatch.end(), IsRecordOlder);
+
+    vtkPlusLogger* logger = dynamic_cast<vtkPlusLogger*>(Instance());
+    if (logger != NULL)
+    {
+      // Format the whole batch, then write it with one lock of the logger and one write to the console and to the file
+      std::vector<std::string> messages(sortedBatch.size());
+      std::ostringstream consoleLines;
+      std::ostringstream fileLines;
+      for (size_t i = 0; i < sortedBatch.size(); i++)
+      {
+        FormatRecord(*sortedBatch[i], messages[i], fileLines);
+        consoleLines << messages[i] << "\n";
+      }
+      std::string consoleBlock = consoleLines.str();
+      std::string fileBlock = fileLines.str();
+
+      igsioLockGuard<vtkIGSIORecursiveCriticalSection> critSectionGuard(logger->m_CriticalSection);
+      std::cout.write(consoleBlock.c_str(), consoleBlock.size());
+      std::cout.flush();
+      logger->m_LogStream.write(fileBlock.c_str(), fileBlock.size());
+      logger->m_LogStream.flush();
+      // Message observers (e.g., the status icon) get each message separately
+      for (std::vector<std::string>::iterator messageIt = messages.begin(); messageIt != messages.end(); ++messageIt)
+      {
+        logger->InvokeEvent(vtkIGSIOLogger::MessageLogged, (void*)(messageIt->c_str()));
+      }
+    }
+    else
+    {
+      // The shared logger was not created by vtkPlusLogger, its output can only be written message by message
+      for (std::vector<const LogRecord*>::iterator recordIt = sortedBatch.begin(); recordIt != sortedBatch.end(); ++recordIt)
+      {
+        const LogRecord* record = *recordIt;
+        Instance()->LogMessage(record->Level, std::string(record->Message, record->MessageLength), record->FileName, record->LineNumber);
+      }
+    }
+  }
+
+  if (numberOfNewlyDroppedRecords > 0)
+  {
+    std::ostringstream msg;
+    msg << numberOfNewlyDroppedRecords << " debug/trace log messages were dropped because the asynchronous log queue was full (total: "
+        << totalNumberOfDroppedRecords << "). Increase the queue capacity or decrease the log level.";
+    Instance()->LogMessage(LOG_LEVEL_WARNING, msg.str(), __FILE__, __LINE__);
+  }
+
+  state.OutputMutex.Unlock();
+}
@@ -13,9 +13,27 @@
 // PlusCommon includes
 #include "vtkPlusCommonExport.h"
 
+// VTK includes
+#include <vtkMultiThreader.h>
+
+// STL includes
+#include <cstddef>
+#include <ostream>
+#include <sstream>
+
 /*!
   \class vtkPlusLogger
-  \brief Class to abstract away specific sequence file read/write details
+  \brief Plus logger singleton, with optional asynchronous writing of debug and trace messages
+
+  If asynchronous logging is enabled then LOG_DEBUG and LOG_TRACE messages are not written by the calling thread.
+  The message is formatted into a thread-local buffer and the record is copied into a lock-free queue of the calling thread.
+  A background thread collects the records of all threads and writes them in batches to the log file and console.
+  Each written message shows the time when it was logged.
+  The calling thread never waits: if the queue of a thread is full then its oldest record is dropped and counted.
+  Errors, warnings and info messages, and debug and trace messages that are too long for a queue record, are always
+  written immediately, therefore they may appear in the log before messages that were logged slightly earlier.
+  Messages that are still queued when the application exits are written by an exit handler.
+
   \ingroup PlusLibCommon
 */
 class vtkPlusCommonExport vtkPlusLogger : public vtkIGSIOLogger
@@ -23,9 +41,89 @@ class vtkPlusCommonExport vtkPlusLogger : public vtkIGSIOLogger
 public:
   static vtkIGSIOLogger* Instance();
 
+  /*!
+    Enable or disable asynchronous writing of debug and trace messages.
+    Disabling waits until all queued messages are written, therefore it should be called before the application exits.
+  */
+  static void SetAsynchronousLogging(bool enable);
+  static bool GetAsynchronousLogging();
+
+  /*! Maximum number of queued records per thread, rounded up to a power of two. Applied to queues created after the call. */
+  static void SetAsynchronousQueueCapacity(int numberOfRecords);
+  static int GetAsynchronousQueueCapacity();
+
+  /*! Number of records that were dropped since asynchronous logging was enabled, because a queue was full */
+  static unsigned long long GetNumberOfDroppedMessages();
+
+  /*! Wait until all records that have been queued before the call are written */
+  static void FlushAsynchronousMessages();
+
+  /*!
+    Write a message asynchronously if asynchronous logging is enabled, otherwise write it immediately.
+    The message is copied, so the buffer can be reused after the call. The file name must be a string literal (__FILE__).
+    Messages longer than 511 characters are always written immediately.
+  */
+  static void LogMessageAsync(LogLevelType level, const char* msg, size_t msgLength, const char* fileName, int lineNumber);
+
+  /*! Returns a cleared, thread-local stream for formatting a log message. Memory is allocated only if the message is longer than any previous message of the thread. */
+  static std::ostream& GetThreadMessageStream();
+
+  /*! Get the contents of the stream returned by the matching GetThreadMessageStream call */
+  static const char* GetThreadMessage(size_t& msgLength);
+
 private:
   vtkPlusLogger();
   ~vtkPlusLogger();
+
+  /*! Thread that periodically writes the queued messages */
+  static void* AsyncWriterThread(vtkMultiThreader::ThreadInfo* data);
+
+  /*! Collect the queued messages of all threads, format them, and write them with one lock of the logger and one write per output */
+  static void WriteQueuedMessages();
 };
 
+// Debug and trace messages are written through the asynchronous logger if asynchronous logging is enabled.
+// The level is checked before the message is formatted, so disabled messages cost only a comparison.
+#undef LOG_DEBUG
+#define LOG_DEBUG(msg) \
+  { \
+    if (vtkPlusLogger::Instance()->GetLogLevel() >= vtkPlusLogger::LOG_LEVEL_DEBUG) \
+    { \
+      if (vtkPlusLogger::GetAsynchronousLogging()) \
+      { \
+        vtkPlusLogger::GetThreadMessageStream() << msg; \
+        size_t msgLength = 0; \
+        const char* msgText = vtkPlusLogger::GetThreadMessage(msgLength); \
+        vtkPlusLogger::LogMessageAsync(vtkPlusLogger::LOG_LEVEL_DEBUG, msgText, msgLength, __FILE__, __LINE__); \
+      } \
+      else \
+      { \
+        std::ostringstream msgStream; \
+        msgStream << msg; \
+        vtkPlusLogger::Instance()->LogMessage(vtkPlusLogger::LOG_LEVEL_DEBUG, msgStream.str(), __FILE__, __LINE__); \
+      } \
+    } \
+  }
+
+#undef LOG_TRACE
+#define LOG_TRACE(msg) \
+  { \
+    if (vtkPlusLogger::Instance()->GetLogLevel() >= vtkPlusLogger::LOG_LEVEL_TRACE) \
+    { \
+      if (vtkPlusLogger::GetAsynchronousLogging()) \
+      { \
+        vtkPlusLogger::GetThreadMessageStream() << msg; \
+        size_t msgLength = 0; \
+        const char* msgText = vtkPlusLogger::GetThreadMessage(msgLength); \
+        vtkPlusLogger::LogMessageAsync(vtkPlusLogger::LOG_LEVEL_TRACE, msgText, msgLength, __FILE__, __LINE__); \
+      } \
+      else \
+      { \
+        std::ostringstream msgStream; \
+        msgStream << msg; \
+        vtkPlusLogger::Instance()->LogMessage(vtkPlusLogger::LOG_LEVEL_TRACE, msgStream.str(), __FILE__, __LINE__); \
+      } \
+    } \
+  }
+
 #endif // __vtkPlusLogger_h 
@@ -8,6 +8,8 @@
 #include "vtkPlusSequenceIO.h"
 
 #include <vtkIGSIOSequenceIO.h>
+#include <vtkIGSIOSequenceIOBase.h>
+#include <vtkIGSIOTrackedFrameList.h>
 
 /// VTK includes
 #include <vtkNew.h>
@@ -50,3 +52,35 @@ igsioStatus vtkPlusSequenceIO::Read(const std::string& trackedSequenceDataFileNa
   }
   return vtkIGSIOSequenceIO::Read(trackedSequenceDataFilePath, frameList);
 }
+
+//----------------------------------------------------------------------------
+igsioStatus vtkPlusSequenceIO::AppendFramesToFile(vtkIGSIOSequenceIOBase* writer, bool& isHeaderPrepared)
+{
+  if (!isHeaderPrepared)
+  {
+    if (writer->PrepareHeader() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to prepare header of sequence file: " << writer->GetFileName());
+      return PLUS_FAIL;
+    }
+    isHeaderPrepared = true;
+  }
+  if (writer->AppendImagesToHeader() != PLUS_SUCCESS || writer->WriteImages() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to write frames into sequence file: " << writer->GetFileName());
+    return PLUS_FAIL;
+  }
+  writer->GetTrackedFrameList()->Clear();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+igsioStatus vtkPlusSequenceIO::FinalizeFile(vtkIGSIOSequenceIOBase* writer, int numberOfFrames)
+{
+  writer->UpdateDimensionsCustomStrings(numberOfFrames, false);
+  writer->UpdateFieldInImageHeader(writer->GetDimensionSizeString());
+  writer->UpdateFieldInImageHeader(writer->GetDimensionKindsString());
+  igsioStatus status = writer->FinalizeHeader();
+  writer->Close();
+  return status;
+}
@@ -9,6 +9,8 @@
 
 #include "igsioCommon.h"
 
+class vtkIGSIOSequenceIOBase;
+
 /*!
   \class vtkPlusSequenceIO
   \brief Class to abstract away specific sequence file read/write details
@@ -26,6 +28,17 @@ public:
   /*! Read file contents into the object */
   static igsioStatus Read(const std::string& filename, vtkIGSIOTrackedFrameList* frameList);
 
+  /*!
+    Append the frames of the writer's tracked frame list to the file and clear the list, so that long sequences
+    can be written in batches without keeping all frames in memory. The header is prepared at the first call.
+    \param writer Sequence writer with file name and tracked frame list set
+    \param isHeaderPrepared Set to true when the header is prepared, must be false before the first call
+  */
+  static igsioStatus AppendFramesToFile(vtkIGSIOSequenceIOBase* writer, bool& isHeaderPrepared);
+
+  /*! Update the header of a file written by AppendFramesToFile with the total number of frames and close the file */
+  static igsioStatus FinalizeFile(vtkIGSIOSequenceIOBase* writer, int numberOfFrames);
+
 protected:
   vtkPlusSequenceIO();
   virtual ~vtkPlusSequenceIO();
@@ -257,6 +257,13 @@ PlusStatus vtkPlusFakeTracker::InternalStopRecording()
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusFakeTracker::GetLiveConfigurationAttributes(std::vector<std::string>& attributeNames) const
+{
+  Superclass::GetLiveConfigurationAttributes(attributeNames);
+  attributeNames.push_back("AcquisitionRate");
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusFakeTracker::InternalUpdate()
 {
@@ -86,6 +86,9 @@ protected:
   /*! Get an update from the tracking system and push the new transforms to the tools. */
   PlusStatus InternalUpdate();
 
+  /*! AcquisitionRate only sets the update rate of the internal update thread, so it can be changed while connected */
+  virtual void GetLiveConfigurationAttributes(std::vector<std::string>& attributeNames) const;
+
   vtkPlusFakeTracker();
   ~vtkPlusFakeTracker();
 
@@ -9,8 +9,11 @@ See License.txt for details.
 #include "vtkPlusImplicitSplineForce.h"
 #include "vtkMatrix4x4.h"
 #include "vtkObjectFactory.h"
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
 #include <math.h>
+#include <sstream>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -19,6 +22,9 @@ See License.txt for details.
 
 vtkStandardNewMacro(vtkPlusImplicitSplineForce)
 
+// Interpolation error of the distance grid is estimated at the center of every N-th cell along each axis
+static const int DISTANCE_GRID_ERROR_ESTIMATION_CELL_STRIDE = 4;
+
 //----------------------------------------------------------------------------
 vtkPlusImplicitSplineForce::vtkPlusImplicitSplineForce()
 {
@@ -28,6 +34,16 @@ vtkPlusImplicitSplineForce::vtkPlusImplicitSplineForce()
   this->SplineKnots = "knot3DHeart.txt";
   this->ControlPoints = " ";
 
+  this->UseDistanceGrid = false;
+  this->DistanceGridSamplesPerKnotInterval = 3;
+  this->ExactEvaluationDistance = 0;
+  this->DistanceGridMaxError = 0;
+  for (int i = 0; i < 3; i++)
+  {
+    this->DistanceGridDimensions[i] = 0;
+    this->DistanceGridOrigin[i] = 0;
+    this->DistanceGridSpacing[i] = 0;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -35,6 +51,13 @@ void vtkPlusImplicitSplineForce::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent.GetNextIndent());
   os << indent.GetNextIndent() << "Gamma Sigmoid: " << this->gammaSigmoid << endl;
+  os << indent.GetNextIndent() << "Use distance grid: " << (this->UseDistanceGrid ? "true" : "false") << endl;
+  os << indent.GetNextIndent() << "Distance grid samples per knot interval: " << this->DistanceGridSamplesPerKnotInterval << endl;
+  os << indent.GetNextIndent() << "Exact evaluation distance: " << this->ExactEvaluationDistance << endl;
+  os << indent.GetNextIndent() << "Distance grid dimensions: " << this->DistanceGridDimensions[0] << " x " << this->DistanceGridDimensions[1]
+     << " x " << this->DistanceGridDimensions[2] << (this->DistanceGrid.empty() ? " (not built)" : "") << endl;
+  os << indent.GetNextIndent() << "Distance grid max error: " << this->DistanceGridMaxError << endl;
+  os << indent.GetNextIndent() << "Number of cached control point sets: " << this->ControlPointsCache.size() << endl;
 }
 
 //----------------------------------------------------------------------------
@@ -46,104 +69,67 @@ vtkPlusImplicitSplineForce::~vtkPlusImplicitSplineForce()
 //----------------------------------------------------------------------------
 void vtkPlusImplicitSplineForce::SetInput(char * controlPnt)
 {
+  if (controlPnt == NULL || ReadFileControlPoints(controlPnt) != 0)
+  {
+    LOG_ERROR("Failed to read B-spline control points from file: " << (controlPnt ? controlPnt : "(NULL)"));
+    return;
+  }
   this->ControlPoints = controlPnt;
-  ReadFileControlPoints(controlPnt);
+  BuildDistanceGrid();
 }
 
 //----------------------------------------------------------------------------
 void vtkPlusImplicitSplineForce::SetInput(int splineId)
 {
-  ReadFile3DBSplineKnots(this->SplineKnots);
+  bool modified = false;
+
+  // Knots are the same for all models, so they are only read if they have not been loaded yet
+  if (this->LoadedSplineKnots != this->SplineKnots)
+  {
+    if (ReadFile3DBSplineKnots(this->SplineKnots) != 0)
+    {
+      LOG_ERROR("Failed to read B-spline knots from file: " << this->SplineKnots);
+      return;
+    }
+    modified = true;
+  }
 
   // Read B-spline control points (coefficients) from file
-  if (splineId <= 0 || splineId > 20)
+  if (splineId > 0 && splineId <= 20)
   {
-    return;
+    std::ostringstream controlPointsFileName;
+    controlPointsFileName << "control3DLSHeart" << std::setw(2) << std::setfill('0') << splineId << ".txt";
+    if (ReadFileControlPoints(controlPointsFileName.str()) == 0)
+    {
+      modified = true;
+    }
   }
 
-  switch(splineId)
-  {
-  case 1:
-    ReadFileControlPoints("control3DLSHeart01.txt");
-    break;
-  case 2:
-    ReadFileControlPoints("control3DLSHeart02.txt");
-    break;
-  case 3:
-    ReadFileControlPoints("control3DLSHeart03.txt");
-    break;
-  case 4:
-    ReadFileControlPoints("control3DLSHeart04.txt");
-    break;
-  case 5:
-    ReadFileControlPoints("control3DLSHeart05.txt");
-    break;
-  case 6:
-    ReadFileControlPoints("control3DLSHeart06.txt");
-    break;
-  case 7:
-    ReadFileControlPoints("control3DLSHeart07.txt");
-    break;
-  case 8:
-    ReadFileControlPoints("control3DLSHeart08.txt");
-    break;
-  case 9:
-    ReadFileControlPoints("control3DLSHeart09.txt");
-    break;
-  case 10:
-    ReadFileControlPoints("control3DLSHeart10.txt");
-    break;
-  case 11:
-    ReadFileControlPoints("control3DLSHeart11.txt");
-    break;
-  case 12:
-    ReadFileControlPoints("control3DLSHeart12.txt");
-    break;
-  case 13:
-    ReadFileControlPoints("control3DLSHeart13.txt");
-    break;
-  case 14:
-    ReadFileControlPoints("control3DLSHeart14.txt");
-    break;
-  case 15:
-    ReadFileControlPoints("control3DLSHeart15.txt");
-    break;
-  case 16:
-    ReadFileControlPoints("control3DLSHeart16.txt");
-    break;
-  case 17:
-    ReadFileControlPoints("control3DLSHeart17.txt");
-    break;
-  case 18:
-    ReadFileControlPoints("control3DLSHeart18.txt");
-    break;
-  case 19:
-    ReadFileControlPoints("control3DLSHeart19.txt");
-    break;
-  case 20:
-    ReadFileControlPoints("control3DLSHeart20.txt");
-    break;
+  if (modified)
+  {
+    BuildDistanceGrid();
   }
 }
 
 //----------------------------------------------------------------------------
 int vtkPlusImplicitSplineForce::GenerateForce(vtkMatrix4x4 * transformMatrix, double force[3])
 {
-  int n=3; //Cubic spline
   int i,j;
   int flag = 0;
   double dSpline, value, deriv, gradient[3];
 
-  // Calculate distance (dSpline) to B-spline surface
-  dSpline = CalculateDistanceBasis(transformMatrix->GetElement(0,3), transformMatrix->GetElement(1,3), transformMatrix->GetElement(2,3), n, 3);
+  // Calculate distance (dSpline) to B-spline surface and its gradient
+  double position[3] = { transformMatrix->GetElement(0,3), transformMatrix->GetElement(1,3), transformMatrix->GetElement(2,3) };
+  if (!InterpolateDistanceGrid(position, dSpline, gradient) || fabs(dSpline) < this->ExactEvaluationDistance)
+  {
+    CalculateDistanceAndGradientBasis(position, dSpline, gradient);
+  }
 
   if(dSpline > -1.0)
   {
     flag = 1;
   }
 
-  CalculateDistanceDerivativeBasis(transformMatrix->GetElement(0,3), transformMatrix->GetElement(1,3), transformMatrix->GetElement(2,3), n, 3, gradient);
-
   fnGaussValueDeriv(gammaSigmoid, dSpline, value, deriv);
 
   for(i=0; i<3; i++)
@@ -191,14 +177,16 @@ int vtkPlusImplicitSplineForce::fnSigmoidValueDeriv(double a, double x, double&
 //----------------------------------------------------------------------------
 int vtkPlusImplicitSplineForce::fnGaussValueDeriv(double a, double x, double& value, double& deriv)
 {
-  int m=2;
+  // Exponent m=2, multiplications are used instead of pow() as this is computed in the servo loop
   a = 2;
+  double a2 = a*a;
+  double x2a2 = x*x/a2;
 
-  double tmp = exp(-pow(x*x/(a*a), m));
+  double tmp = exp(-x2a2*x2a2);
 
   value = 1-tmp;
 
-  deriv = tmp*2*m*pow(x,2*m-1)/pow(a*a, m);
+  deriv = tmp*4*x*x*x/(a2*a2);
 
   return 0;
 }
@@ -211,136 +199,6 @@ int vtkPlusImplicitSplineForce::SetGamma(double gamma)
   return 0;
 }
 
-//----------------------------------------------------------------------------
-int vtkPlusImplicitSplineForce::CalculateDistanceDerivativeBasis(double x, double y, double z, int n, int direction, double *gradient)
-{
-  double u = x;
-  double v = y;
-  double w = z;
-  int Nk;
-  int Iu, Iv, Iw;
-  int i,j,k;
-
-  Iu = DimKnot_U-1-n;
-  Iv = DimKnot_V-1-n;
-  Iw = DimKnot_W-1-n;
-
-  //   Calculate Iu, Iv, Iw;
-  for(i=0; i<DimKnot_U; i++)
-  {
-    if(u<knot1b[i])
-    {
-      Iu = i-1;
-      break;
-    }
-  }
-  if(Iu<n-1)
-  {
-    Iu = n-1;
-  }
-  else if(Iu>DimKnot_U-1-n)
-  {
-    Iu = DimKnot_U-1-n;
-  }
-
-  for(i=0; i<DimKnot_V; i++)
-  {
-    if(v<knot2b[i])
-    {
-      Iv = i-1;
-      break;
-    }
-  }
-  if(Iv<n-1)
-  {
-    Iv = n-1;
-  }
-  else if(Iv>DimKnot_V-1-n)
-  {
-    Iv = DimKnot_V-1-n;
-  }
-
-  for(i=0; i<DimKnot_W; i++)
-  {
-    if(w<knot3b[i])
-    {
-      Iw = i-1;
-      break;
-    }
-  }
-  if(Iw<n-1)
-  {
-    Iw = n-1;
-  }
-  else if(Iw>DimKnot_W-1-n)
-  {
-    Iw = DimKnot_W-1-n;
-  }
-
-  double Nu[10], Nv[10], Nw[10];
-  double dNu[10], dNv[10], dNw[10];
-  for(i=0; i<=n; i++)
-  {
-    Nk = Iu - 2 + i;
-    Nu[i] = BasisFunction3(Nk, knot1b, u, DimKnot_U-1);
-    dNu[i] = BasisFunction3DerivativeD(Nk, knot1b, u, DimKnot_U-1);
-  }
-  for(i=0; i<=n; i++)
-  {
-    Nk = Iv - 2 + i;
-    Nv[i] = BasisFunction3(Nk, knot2b, v, DimKnot_V-1);
-    dNv[i] = BasisFunction3DerivativeD(Nk, knot2b, v, DimKnot_V-1);
-  }
-  for(i=0; i<=n; i++)
-  {
-    Nk = Iw - 2 + i;
-    Nw[i] = BasisFunction3(Nk, knot3b, w, DimKnot_W-1);
-    dNw[i] = BasisFunction3DerivativeD(Nk, knot3b, w, DimKnot_W-1);
-  }
-
-  double distDT;
-  distDT = 0;
-  for(k=0; k<=n; k++)
-  {
-    for(i=0; i<=n; i++)
-    {
-      for(j=0; j<=n; j++)
-      {
-        distDT += controlQ3D[Iw-2+k][Iv-2+i][Iu-2+j]*Nw[k]*Nv[i]*dNu[j];
-      }
-    }
-  }
-  gradient[0] = distDT;
-
-  distDT = 0;
-  for(k=0; k<=n; k++)
-  {
-    for(i=0; i<=n; i++)
-    {
-      for(j=0; j<=n; j++)
-      {
-        distDT += controlQ3D[Iw-2+k][Iv-2+i][Iu-2+j]*Nw[k]*dNv[i]*Nu[j];
-      }
-    }
-  }
-  gradient[1] = distDT;
-
-  distDT = 0;
-  for(k=0; k<=n; k++)
-  {
-    for(i=0; i<=n; i++)
-    {
-      for(j=0; j<=n; j++)
-      {
-        distDT += controlQ3D[Iw-2+k][Iv-2+i][Iu-2+j]*dNw[k]*Nv[i]*Nu[j];
-      }
-    }
-  }
-  gradient[2] = distDT;
-
-  return 0;
-}
-
 //----------------------------------------------------------------------------
 double vtkPlusImplicitSplineForce::BasisFunction3(int k, double *knot, double u, int K)
 {
@@ -541,54 +399,6 @@ double vtkPlusImplicitSplineForce::BasisFunction3DerivativeD(int k, double *knot
   return dNu;
 }
 
-//----------------------------------------------------------------------------
-double vtkPlusImplicitSplineForce::CalculateDistanceBasis(double x, double y, double z, int n, int direction)
-{
-  double u = x;
-  double v = y;
-  double w = z;
-  int Nk;
-  int Iu, Iv, Iw;
-  int i,j,k;
-
-  //   Calculate Iu, Iv, Iw;
-  Iu = CalculateKnotIu(u, knot1b, DimKnot_U-1, n);
-  Iv = CalculateKnotIu(v, knot2b, DimKnot_V-1, n);
-  Iw = CalculateKnotIu(w, knot3b, DimKnot_W-1, n);
-
-  //double distance = BasisFunction3(Nk, knot, u, K);
-  double Nu[10], Nv[10], Nw[10];
-  for(i=0; i<=n; i++)
-  {
-    Nk = Iu - 2 + i;
-    Nu[i] = BasisFunction3(Nk, knot1b, u, DimKnot_U-1);
-  }
-  for(i=0; i<=n; i++)
-  {
-    Nk = Iv - 2 + i;
-    Nv[i] = BasisFunction3(Nk, knot2b, v, DimKnot_V-1);
-  }
-  for(i=0; i<=n; i++)
-  {
-    Nk = Iw - 2 + i;
-    Nw[i] = BasisFunction3(Nk, knot3b, w, DimKnot_W-1);
-  }
-
-  double distT = 0;
-  for(k=0; k<=n; k++)
-  {
-    for(i=0; i<=n; i++)
-    {
-      for(j=0; j<=n; j++)
-      {
-        distT += controlQ3D[Iw-2+k][Iv-2+i][Iu-2+j]*Nw[k]*Nv[i]*Nu[j];
-      }
-    }
-  }
-
-  return distT;
-}
-
 //----------------------------------------------------------------------------
 int vtkPlusImplicitSplineForce::CalculateKnotIu(double u, double *knot, int K, int n)
 {
@@ -630,38 +440,58 @@ int vtkPlusImplicitSplineForce::ReadFile3DBSplineKnots(const std::string& fname)
     return -1;
   }
 
+  // Knots are read into temporary arrays, so that the current knots are kept if the file cannot be read
+  double newKnot1[NUM_INTERVALU_S+1];
+  double newKnot2[NUM_INTERVALV_S+1];
+  double newKnot3[NUM_INTERVALW_S+1];
+  double newKnot1b[DimKnot_U];
+  double newKnot2b[DimKnot_V];
+  double newKnot3b[DimKnot_W];
+
   // knot1/2/3
   for(int k=0; k<=NUM_INTERVALU_S; k++)
   {
-    fpInKnot >> knot1[k];
+    fpInKnot >> newKnot1[k];
   }
 
   for(int k=0; k<=NUM_INTERVALV_S; k++)
   {
-    fpInKnot >> knot2[k];
+    fpInKnot >> newKnot2[k];
   }
 
   for(int k=0; k<=NUM_INTERVALW_S; k++)
   {
-    fpInKnot >> knot3[k];
+    fpInKnot >> newKnot3[k];
   }
 
   // knot1/2/3b
   for(int k=0; k<=DimKnot_U-1; k++)
   {
-    fpInKnot >> knot1b[k];
+    fpInKnot >> newKnot1b[k];
   }
   for(int k=0; k<=DimKnot_V-1; k++)
   {
-    fpInKnot >> knot2b[k];
+    fpInKnot >> newKnot2b[k];
   }
   for(int k=0; k<=DimKnot_W-1; k++)
   {
-    fpInKnot >> knot3b[k];
+    fpInKnot >> newKnot3b[k];
   }
 
+  if( fpInKnot.fail() )
+  {
+    return -1;
+  }
   fpInKnot.close();
 
+  std::copy(newKnot1, newKnot1+NUM_INTERVALU_S+1, knot1);
+  std::copy(newKnot2, newKnot2+NUM_INTERVALV_S+1, knot2);
+  std::copy(newKnot3, newKnot3+NUM_INTERVALW_S+1, knot3);
+  std::copy(newKnot1b, newKnot1b+DimKnot_U, knot1b);
+  std::copy(newKnot2b, newKnot2b+DimKnot_V, knot2b);
+  std::copy(newKnot3b, newKnot3b+DimKnot_W, knot3b);
+
+  this->LoadedSplineKnots = fname;
   return 0;
 }
 
@@ -672,27 +502,301 @@ int vtkPlusImplicitSplineForce::ReadFileControlPoints(const std::string& fname)
   {
     return -1;
   }
-  ifstream fpInKnot;
-  fpInKnot.open(fname.c_str());
 
-  if( !fpInKnot.is_open() )
+  std::map<std::string, std::vector<double> >::iterator cachedControlPoints = this->ControlPointsCache.find(fname);
+  if( cachedControlPoints == this->ControlPointsCache.end() )
   {
-    return -1;
+    ifstream fpInKnot;
+    fpInKnot.open(fname.c_str());
+
+    if( !fpInKnot.is_open() )
+    {
+      return -1;
+    }
+
+    // Control points are stored in the file in the same order as in controlQ3D
+    std::vector<double> controlPoints(sizeof(controlQ3D) / sizeof(double));
+    for(std::vector<double>::iterator controlPointIt = controlPoints.begin(); controlPointIt != controlPoints.end(); ++controlPointIt)
+    {
+      fpInKnot >> *controlPointIt;
+    }
+
+    if( fpInKnot.fail() )
+    {
+      return -1;
+    }
+    fpInKnot.close();
+
+    cachedControlPoints = this->ControlPointsCache.insert(std::make_pair(fname, controlPoints)).first;
   }
 
-  int i,j,k;
-  for(k=0; k<DimCPoint_W; k++)
+  std::copy(cachedControlPoints->second.begin(), cachedControlPoints->second.end(), &controlQ3D[0][0][0]);
+
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusImplicitSplineForce::CalculateBasisValues(double u, double* knot, int K, int n, int& Iu, double* Nu, double* dNu)
+{
+  Iu = CalculateKnotIu(u, knot, K, n);
+  for(int i=0; i<=n; i++)
   {
-    for(i=0; i<DimCPoint_V; i++)
+    int Nk = Iu - 2 + i;
+    Nu[i] = BasisFunction3(Nk, knot, u, K);
+    dNu[i] = BasisFunction3DerivativeD(Nk, knot, u, K);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusImplicitSplineForce::CalculateDistanceAndGradientFromBasis(int Iu, int Iv, int Iw, int n, const double* Nu, const double* dNu, const double* Nv, const double* dNv,
+    const double* Nw, const double* dNw, double& distance, double gradient[3])
+{
+  distance = 0;
+  gradient[0] = 0;
+  gradient[1] = 0;
+  gradient[2] = 0;
+  for(int k=0; k<=n; k++)
+  {
+    for(int i=0; i<=n; i++)
     {
-      for(j=0; j<DimCPoint_U; j++)
+      for(int j=0; j<=n; j++)
       {
-        fpInKnot >> controlQ3D[k][i][j];
+        double controlPoint = controlQ3D[Iw-2+k][Iv-2+i][Iu-2+j];
+        distance += controlPoint*Nw[k]*Nv[i]*Nu[j];
+        gradient[0] += controlPoint*Nw[k]*Nv[i]*dNu[j];
+        gradient[1] += controlPoint*Nw[k]*dNv[i]*Nu[j];
+        gradient[2] += controlPoint*dNw[k]*Nv[i]*Nu[j];
       }
     }
   }
+}
 
-  fpInKnot.close();
+//----------------------------------------------------------------------------
+void vtkPlusImplicitSplineForce::CalculateDistanceAndGradientBasis(const double position[3], double& distance, double gradient[3])
+{
+  const int n=3; //Cubic spline
+  int Iu, Iv, Iw;
+  double Nu[4], Nv[4], Nw[4];
+  double dNu[4], dNv[4], dNw[4];
+  CalculateBasisValues(position[0], knot1b, DimKnot_U-1, n, Iu, Nu, dNu);
+  CalculateBasisValues(position[1], knot2b, DimKnot_V-1, n, Iv, Nv, dNv);
+  CalculateBasisValues(position[2], knot3b, DimKnot_W-1, n, Iw, Nw, dNw);
+  CalculateDistanceAndGradientFromBasis(Iu, Iv, Iw, n, Nu, dNu, Nv, dNv, Nw, dNw, distance, gradient);
+}
 
-  return 0;
+//----------------------------------------------------------------------------
+void vtkPlusImplicitSplineForce::CalculateDistanceAndGradientOnGrid(const int dims[3], const std::vector<int> spanIndex[3], const std::vector<double> basis[3],
+    const std::vector<double> basisDerivative[3], std::vector<float>& distanceAndGradient)
+{
+  // The spline is separable, so the z and then the y basis functions are applied to the control points once per plane and row
+  // of grid points, which leaves only a few operations per grid point
+  const int n=3; //Cubic spline
+  const int numberOfControlPointsU = DimCPoint_U;
+  const int numberOfControlPointsV = DimCPoint_V;
+  std::vector<double> planeValue(numberOfControlPointsV*numberOfControlPointsU);
+  std::vector<double> planeDerivativeZ(numberOfControlPointsV*numberOfControlPointsU);
+  std::vector<double> rowValue(numberOfControlPointsU);
+  std::vector<double> rowDerivativeY(numberOfControlPointsU);
+  std::vector<double> rowDerivativeZ(numberOfControlPointsU);
+
+  distanceAndGradient.resize(static_cast<size_t>(dims[0])*dims[1]*dims[2]*4);
+  float* gridPoint = &distanceAndGradient[0];
+  for(int z=0; z<dims[2]; z++)
+  {
+    const int Iw = spanIndex[2][z];
+    const double* Nw = &basis[2][z*(n+1)];
+    const double* dNw = &basisDerivative[2][z*(n+1)];
+    std::fill(planeValue.begin(), planeValue.end(), 0.0);
+    std::fill(planeDerivativeZ.begin(), planeDerivativeZ.end(), 0.0);
+    for(int k=0; k<=n; k++)
+    {
+      for(int v=0; v<numberOfControlPointsV; v++)
+      {
+        for(int u=0; u<numberOfControlPointsU; u++)
+        {
+          double controlPoint = controlQ3D[Iw-2+k][v][u];
+          planeValue[v*numberOfControlPointsU+u] += Nw[k]*controlPoint;
+          planeDerivativeZ[v*numberOfControlPointsU+u] += dNw[k]*controlPoint;
+        }
+      }
+    }
+
+    for(int y=0; y<dims[1]; y++)
+    {
+      const int Iv = spanIndex[1][y];
+      const double* Nv = &basis[1][y*(n+1)];
+      const double* dNv = &basisDerivative[1][y*(n+1)];
+      std::fill(rowValue.begin(), rowValue.end(), 0.0);
+      std::fill(rowDerivativeY.begin(), rowDerivativeY.end(), 0.0);
+      std::fill(rowDerivativeZ.begin(), rowDerivativeZ.end(), 0.0);
+      for(int i=0; i<=n; i++)
+      {
+        const double* planeValueRow = &planeValue[(Iv-2+i)*numberOfControlPointsU];
+        const double* planeDerivativeZRow = &planeDerivativeZ[(Iv-2+i)*numberOfControlPointsU];
+        for(int u=0; u<numberOfControlPointsU; u++)
+        {
+          rowValue[u] += Nv[i]*planeValueRow[u];
+          rowDerivativeY[u] += dNv[i]*planeValueRow[u];
+          rowDerivativeZ[u] += Nv[i]*planeDerivativeZRow[u];
+        }
+      }
+
+      for(int x=0; x<dims[0]; x++)
+      {
+        const int Iu = spanIndex[0][x];
+        const double* Nu = &basis[0][x*(n+1)];
+        const double* dNu = &basisDerivative[0][x*(n+1)];
+        double distance = 0;
+        double gradient[3] = {0, 0, 0};
+        for(int j=0; j<=n; j++)
+        {
+          distance += Nu[j]*rowValue[Iu-2+j];
+          gradient[0] += dNu[j]*rowValue[Iu-2+j];
+          gradient[1] += Nu[j]*rowDerivativeY[Iu-2+j];
+          gradient[2] += Nu[j]*rowDerivativeZ[Iu-2+j];
+        }
+        *(gridPoint++) = static_cast<float>(distance);
+        *(gridPoint++) = static_cast<float>(gradient[0]);
+        *(gridPoint++) = static_cast<float>(gradient[1]);
+        *(gridPoint++) = static_cast<float>(gradient[2]);
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusImplicitSplineForce::BuildDistanceGrid()
+{
+  this->DistanceGrid.clear();
+  this->DistanceGridMaxError = 0;
+  if( !this->UseDistanceGrid || this->LoadedSplineKnots.empty() || this->DistanceGridSamplesPerKnotInterval < 1 )
+  {
+    return;
+  }
+
+  const int n=3; //Cubic spline
+  double* knots[3] = { knot1b, knot2b, knot3b };
+  const int lastKnotIndex[3] = { DimKnot_U-1, DimKnot_V-1, DimKnot_W-1 };
+
+  // Basis functions are computed once for each grid coordinate along each axis, at the grid points (index 0)
+  // and at the sampled grid cell centers (index 1). Values at the cell centers are used for estimating the interpolation error.
+  const int cellStride = DISTANCE_GRID_ERROR_ESTIMATION_CELL_STRIDE;
+  int dims[2][3];
+  std::vector<int> spanIndex[2][3];
+  std::vector<double> basis[2][3];
+  std::vector<double> basisDerivative[2][3];
+  for(int axis=0; axis<3; axis++)
+  {
+    const int K = lastKnotIndex[axis];
+    const int dim = K*this->DistanceGridSamplesPerKnotInterval+1;
+    const double origin = knots[axis][0];
+    const double spacing = (knots[axis][K]-origin)/(dim-1);
+    if( !(spacing > 0) )
+    {
+      return;
+    }
+    this->DistanceGridDimensions[axis] = dim;
+    this->DistanceGridOrigin[axis] = origin;
+    this->DistanceGridSpacing[axis] = spacing;
+    for(int cellCenter=0; cellCenter<2; cellCenter++)
+    {
+      const int numberOfPositions = cellCenter ? (dim-2)/cellStride+1 : dim;
+      dims[cellCenter][axis] = numberOfPositions;
+      spanIndex[cellCenter][axis].resize(numberOfPositions);
+      basis[cellCenter][axis].resize(numberOfPositions*(n+1));
+      basisDerivative[cellCenter][axis].resize(numberOfPositions*(n+1));
+      for(int i=0; i<numberOfPositions; i++)
+      {
+        // The last grid point is set exactly to the last knot, as the spline is zero outside of the knot range
+        double u = cellCenter ? origin+(i*cellStride+0.5)*spacing : (i==dim-1 ? knots[axis][K] : origin+i*spacing);
+        CalculateBasisValues(u, knots[axis], K, n, spanIndex[cellCenter][axis][i],
+                             &basis[cellCenter][axis][i*(n+1)], &basisDerivative[cellCenter][axis][i*(n+1)]);
+      }
+    }
+  }
+
+  CalculateDistanceAndGradientOnGrid(dims[0], spanIndex[0], basis[0], basisDerivative[0], this->DistanceGrid);
+
+  // Interpolation error is largest far from the grid points, so it is estimated at the cell centers
+  std::vector<float> cellCenterDistanceAndGradient;
+  CalculateDistanceAndGradientOnGrid(dims[1], spanIndex[1], basis[1], basisDerivative[1], cellCenterDistanceAndGradient);
+  const float* exactDistance = &cellCenterDistanceAndGradient[0];
+  double interpolatedDistance = 0;
+  double interpolatedGradient[3] = {0, 0, 0};
+  for(int z=0; z<dims[1][2]; z++)
+  {
+    for(int y=0; y<dims[1][1]; y++)
+    {
+      for(int x=0; x<dims[1][0]; x++)
+      {
+        double position[3] =
+        {
+          this->DistanceGridOrigin[0]+(x*cellStride+0.5)*this->DistanceGridSpacing[0],
+          this->DistanceGridOrigin[1]+(y*cellStride+0.5)*this->DistanceGridSpacing[1],
+          this->DistanceGridOrigin[2]+(z*cellStride+0.5)*this->DistanceGridSpacing[2]
+        };
+        InterpolateDistanceGrid(position, interpolatedDistance, interpolatedGradient);
+        this->DistanceGridMaxError = std::max(this->DistanceGridMaxError, fabs(interpolatedDistance-*exactDistance));
+        exactDistance += 4;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusImplicitSplineForce::InterpolateDistanceGrid(const double position[3], double& distance, double gradient[3]) const
+{
+  if( this->DistanceGrid.empty() )
+  {
+    return false;
+  }
+
+  // Catmull-Rom weights and clamped grid indices of the 4 neighbor grid points along each axis
+  double weights[3][4];
+  int indices[3][4];
+  for(int axis=0; axis<3; axis++)
+  {
+    const int dim = this->DistanceGridDimensions[axis];
+    double t = (position[axis]-this->DistanceGridOrigin[axis])/this->DistanceGridSpacing[axis];
+    if( !(t >= 0 && t <= dim-1) )
+    {
+      return false;
+    }
+    int i = std::min(static_cast<int>(t), dim-2);
+    double f = t-i;
+    weights[axis][0] = f*(-0.5+f*(1.0-0.5*f));
+    weights[axis][1] = 1.0+f*f*(-2.5+1.5*f);
+    weights[axis][2] = f*(0.5+f*(2.0-1.5*f));
+    weights[axis][3] = f*f*(-0.5+0.5*f);
+    for(int k=0; k<4; k++)
+    {
+      indices[axis][k] = std::min(std::max(i-1+k, 0), dim-1);
+    }
+  }
+
+  double values[4] = {0, 0, 0, 0};
+  const float* grid = &this->DistanceGrid[0];
+  for(int z=0; z<4; z++)
+  {
+    for(int y=0; y<4; y++)
+    {
+      const double weightZY = weights[2][z]*weights[1][y];
+      const float* gridRow = grid + (static_cast<size_t>(indices[2][z])*this->DistanceGridDimensions[1]+indices[1][y])*this->DistanceGridDimensions[0]*4;
+      for(int x=0; x<4; x++)
+      {
+        const double weight = weightZY*weights[0][x];
+        const float* gridPoint = gridRow + indices[0][x]*4;
+        values[0] += weight*gridPoint[0];
+        values[1] += weight*gridPoint[1];
+        values[2] += weight*gridPoint[2];
+        values[3] += weight*gridPoint[3];
+      }
+    }
+  }
+
+  distance = values[0];
+  gradient[0] = values[1];
+  gradient[1] = values[2];
+  gradient[2] = values[3];
+  return true;
 }
@@ -12,6 +12,9 @@ See License.txt for details.
 
 #include "vtkPlusForceFeedback.h"
 
+#include <map>
+#include <vector>
+
 class vtkMatrix4x4;
 
 #define DIM_BASE 20
@@ -25,6 +28,14 @@ class vtkMatrix4x4;
 #define DimKnot_V DimCPoint_V+2
 #define DimKnot_W DimCPoint_W+2
 
+/*!
+  \class vtkPlusImplicitSplineForce
+  \brief Force feedback computed from the distance to an implicit surface that is defined by a cubic B-spline
+
+  The distance and its gradient can be either evaluated from the spline at each GenerateForce call or interpolated
+  from a grid that is precomputed in SetInput (see UseDistanceGrid). Control points that are read from file are cached,
+  so switching between models that were already loaded does not require reading the files again.
+*/
 class vtkPlusHapticsExport vtkPlusImplicitSplineForce : public vtkPlusForceFeedback
 {
 public:
@@ -32,25 +43,71 @@ public:
   vtkTypeMacro(vtkPlusImplicitSplineForce,vtkPlusForceFeedback);
   virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
 
+  /*! Read the knots (if not read yet) and the control points of the specified heart model. Nothing is changed if the knots cannot be read. */
   void SetInput(int splineId);
+  /*! Read the control points from the specified file. Nothing is changed if the file cannot be read. */
   void SetInput(char * controlPnt);
+
+  /*! Name of the file that B-spline knots are read from in SetInput(int) */
+  vtkSetStdStringMacro(SplineKnots);
+  vtkGetStdStringMacro(SplineKnots);
+
   int GenerateForce(vtkMatrix4x4 * transformMatrix, double force[3]);
   int SetGamma(double gamma);
 
+  /*!
+    If enabled then distance and gradient are interpolated (tricubic interpolation) from a grid that is computed in SetInput,
+    instead of evaluating the spline at each GenerateForce call. Distance grid settings must be set before SetInput is called.
+  */
+  vtkSetMacro(UseDistanceGrid, bool);
+  vtkGetMacro(UseDistanceGrid, bool);
+  vtkBooleanMacro(UseDistanceGrid, bool);
+
+  /*! Number of distance grid intervals along each knot interval of the spline */
+  vtkSetMacro(DistanceGridSamplesPerKnotInterval, int);
+  vtkGetMacro(DistanceGridSamplesPerKnotInterval, int);
+
+  /*!
+    If the absolute value of the interpolated distance is smaller than this value then the spline is evaluated exactly.
+    This allows limiting the error close to the surface, where the force changes rapidly. If 0 then the grid is used everywhere.
+  */
+  vtkSetMacro(ExactEvaluationDistance, double);
+  vtkGetMacro(ExactEvaluationDistance, double);
+
+  /*! Largest difference between the interpolated and the exact distance at the grid cell centers, computed when the grid is built */
+  vtkGetMacro(DistanceGridMaxError, double);
+
 protected:
   vtkPlusImplicitSplineForce();
   virtual ~vtkPlusImplicitSplineForce();
 
   int fnGaussValueDeriv(double a, double x, double& value, double& deriv);
   int fnSigmoidValueDeriv(double a, double x, double& value, double& deriv);
-  int CalculateDistanceDerivativeBasis(double x, double y, double z, int n, int direction, double *gradient);
   double BasisFunction3(int k, double *knot, double u, int K);
   double BasisFunction3DerivativeD(int k, double *knot, double u, int K);
-  double CalculateDistanceBasis(double x, double y, double z, int n, int direction);
   int CalculateKnotIu(double u, double *knot, int K, int n);
   int ReadFile3DBSplineKnots(const std::string& fname);
   int ReadFileControlPoints(const std::string& fname);
 
+  /*! Compute the B-spline basis functions and their derivatives that are nonzero at position u */
+  void CalculateBasisValues(double u, double* knot, int K, int n, int& Iu, double* Nu, double* dNu);
+  /*! Compute the distance and its gradient from basis function values that were computed by CalculateBasisValues */
+  void CalculateDistanceAndGradientFromBasis(int Iu, int Iv, int Iw, int n, const double* Nu, const double* dNu, const double* Nv, const double* dNv,
+      const double* Nw, const double* dNw, double& distance, double gradient[3]);
+  /*! Compute distance and gradient by evaluating the spline at the given position */
+  void CalculateDistanceAndGradientBasis(const double position[3], double& distance, double gradient[3]);
+
+  /*!
+    Compute distance and gradient (4 values per point, x index changing fastest) at all combinations of the given x, y, z coordinates,
+    defined by the basis function values computed by CalculateBasisValues for each coordinate
+  */
+  void CalculateDistanceAndGradientOnGrid(const int dims[3], const std::vector<int> spanIndex[3], const std::vector<double> basis[3],
+      const std::vector<double> basisDerivative[3], std::vector<float>& distanceAndGradient);
+  /*! Compute the distance grid from the current knots and control points. Clears the grid if UseDistanceGrid is disabled. */
+  void BuildDistanceGrid();
+  /*! Interpolate distance and gradient from the distance grid. Returns false if there is no grid or the position is outside of the grid. */
+  bool InterpolateDistanceGrid(const double position[3], double& distance, double gradient[3]) const;
+
   double controlQ3D[DimCPoint_W][DimCPoint_V][DimCPoint_U];
   double knot1[NUM_INTERVALU_S+1];
   double knot2[NUM_INTERVALV_S+1];
@@ -64,6 +121,21 @@ protected:
   double scaleForce;
   std::string SplineKnots;
   std::string ControlPoints;
+
+  /*! Name of the file that the current knots were read from, empty if no knots are loaded */
+  std::string LoadedSplineKnots;
+  /*! Control points that have been read from file, indexed by file name */
+  std::map<std::string, std::vector<double> > ControlPointsCache;
+
+  bool UseDistanceGrid;
+  int DistanceGridSamplesPerKnotInterval;
+  double ExactEvaluationDistance;
+  double DistanceGridMaxError;
+  int DistanceGridDimensions[3];
+  double DistanceGridOrigin[3];
+  double DistanceGridSpacing[3];
+  /*! Distance and gradient (x, y, z) at each grid point, with x index changing fastest */
+  std::vector<float> DistanceGrid;
 };
 
 #endif
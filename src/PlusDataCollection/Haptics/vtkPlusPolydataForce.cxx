@@ -6,6 +6,8 @@ See License.txt for details.
 
 #include "PlusConfigure.h"
 
+#include "vtkCellLocator.h"
+#include "vtkGenericCell.h"
 #include "vtkObjectFactory.h"
 #include "vtkPolyData.h"
 #include "vtkPlusPolydataForce.h"
@@ -15,8 +17,12 @@ See License.txt for details.
 
 vtkStandardNewMacro( vtkPlusPolydataForce )
 
+const double vtkPlusPolydataForce::FORCE_DISTANCE_THRESHOLD = 5.0;
+
 //----------------------------------------------------------------------------
 vtkPlusPolydataForce::vtkPlusPolydataForce()
+  : poly(NULL)
+  , closestCell(vtkSmartPointer<vtkGenericCell>::New())
 {
   // Constant for sigmoid function
   this->gammaSigmoid = 2;
@@ -43,15 +49,35 @@ vtkPlusPolydataForce::~vtkPlusPolydataForce()
 void vtkPlusPolydataForce::SetInput( vtkPolyData* poly )
 {
   this->poly = poly;
+  if ( poly == NULL || poly->GetNumberOfCells() < 1 )
+  {
+    this->locator = NULL;
+    return;
+  }
+  this->locator = vtkSmartPointer<vtkCellLocator>::New();
+  this->locator->SetDataSet( poly );
+  this->locator->CacheCellBoundsOn();
+  this->locator->BuildLocator();
+  // Make sure the cells are ready for random access (builds the cell links of the polydata) before the servo loop starts
+  poly->BuildCells();
 }
 
 //----------------------------------------------------------------------------
 int vtkPlusPolydataForce::GenerateForce( vtkMatrix4x4* transformMatrix, double force[3] )
 {
+  if ( this->locator == NULL )
+  {
+    // no surface is defined
+    force[0] = ( 0 );
+    force[1] = ( 0 );
+    force[2] = ( 0 );
+    return 1;
+  }
+
   double distance;
   distance = CalculateDistance( transformMatrix->GetElement( 0, 3 ), transformMatrix->GetElement( 1, 3 ), transformMatrix->GetElement( 2, 3 ) );
 
-  if ( distance <= 5 )
+  if ( distance <= FORCE_DISTANCE_THRESHOLD )
   {
     CalculateForce( transformMatrix->GetElement( 0, 3 ), transformMatrix->GetElement( 1, 3 ), transformMatrix->GetElement( 2, 3 ), force );
   }
@@ -61,21 +87,23 @@ int vtkPlusPolydataForce::GenerateForce( vtkMatrix4x4* transformMatrix, double f
     force[1] = ( 0 );
     force[2] = ( 0 );
   }
-  cout <<  " FORCE: " << force[0] << ",  " << force[1] << ",  " << force[2] << endl;
   return 1;
 }
 
 //----------------------------------------------------------------------------
 double vtkPlusPolydataForce::CalculateDistance( double x, double y, double z )
 {
-  int pointID;
-  double distance;
-  pointID = this->poly->FindPoint( x, y, z );
-  this->poly->GetPoint( pointID, this->lastPos );
-
-  double tmp = pow( ( x - lastPos[0] ), 2 ) + pow( ( y - lastPos[1] ), 2 ) + pow( ( z - lastPos[2] ), 2 );
-  distance = sqrt( tmp );
-  return distance;
+  // Only the neighborhood where force is generated is searched, which limits the computation time far from the surface.
+  // The locator reuses its internal buffers, so there are no allocations in the servo loop.
+  double position[3] = { x, y, z };
+  vtkIdType cellId = -1;
+  int subId = 0;
+  double distance2 = 0;
+  if ( !this->locator->FindClosestPointWithinRadius( position, FORCE_DISTANCE_THRESHOLD, this->lastPos, this->closestCell, cellId, subId, distance2 ) )
+  {
+    return VTK_DOUBLE_MAX;
+  }
+  return sqrt( distance2 );
 }
 
 //----------------------------------------------------------------------------
@@ -95,10 +123,6 @@ void vtkPlusPolydataForce::CalculateForce( double x, double y, double z, double
   vector[1] = fabs( y - this->lastPos[1] );
   vector[2] = fabs( z - this->lastPos[2] );
 
-  cout << "vector[0]: " << vector[0] << endl;
-  cout << "vector[1]: " << vector[1] << endl;
-  cout << "vector[2]: " << vector[2] << endl;
-
   for ( int i = 0; i < 3; i++ )
   {
     if ( vector[i] > 0 )
@@ -106,10 +130,6 @@ void vtkPlusPolydataForce::CalculateForce( double x, double y, double z, double
       force[i] = ( 0.1 / ( vector[i] * vector[i] ) ) * .6;
     }
   }
-  cout << "X: " << force[0] << endl;
-  cout << "Y: " << force[1] << endl;
-  cout << "Z: " << force[2] << endl;
-
   if ( force[0] > 1 )
   {
     force[0] = .6;
@@ -11,28 +11,51 @@ See License.txt for details.
 #include "vtkPlusHapticsExport.h"
 
 #include "vtkPlusForceFeedback.h"
+#include "vtkSmartPointer.h"
 
+class vtkCellLocator;
+class vtkGenericCell;
 class vtkPolyData;
 
+/*!
+  \class vtkPlusPolydataForce
+  \brief Force feedback that pushes the haptic device away from a surface model
+
+  GenerateForce is called from the haptic servo loop, therefore it does not perform any I/O or memory allocation:
+  the cell locator that is used for finding the closest point on the surface is built in SetInput.
+*/
 class vtkPlusHapticsExport vtkPlusPolydataForce : public vtkPlusForceFeedback
 {
 public:
   static vtkPlusPolydataForce *New();
   vtkTypeMacro(vtkPlusPolydataForce, vtkPlusForceFeedback);
+
+  /*! Force is only generated if the device is closer to the surface than this distance */
+  static const double FORCE_DISTANCE_THRESHOLD;
+
   virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
 
   int GenerateForce(vtkMatrix4x4 * transformMatrix, double force[3]);
   int SetGamma(double gamma);
+  /*! Set the surface model and build the cell locator for it. Must not be called while forces are generated. */
   void SetInput(vtkPolyData * poly);
 
 protected:
   vtkPlusPolydataForce();
   virtual ~vtkPlusPolydataForce();
+  /*!
+    Get the distance from the closest point of the surface. The closest point is stored in lastPos.
+    Only the surface within the force distance threshold is searched, if there is no surface point there then VTK_DOUBLE_MAX is returned.
+  */
   double CalculateDistance(double x, double y, double z);
   void CalculateForce(double x, double y, double z, double force[3]);
 
 private:
   vtkPolyData * poly;
+  /*! Locator for finding the closest point of the surface, built when the surface is set */
+  vtkSmartPointer<vtkCellLocator> locator;
+  /*! Cell used by the locator queries, allocated in advance to avoid allocations in the servo loop */
+  vtkSmartPointer<vtkGenericCell> closestCell;
   double gammaSigmoid;
   double scaleForce;
   double lastPos[3];
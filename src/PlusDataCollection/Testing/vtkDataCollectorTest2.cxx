@@ -19,12 +19,42 @@ See License.txt for details.
 #include "vtkPlusSavedDataSource.h"
 
 // VTK includes
+#include <vtkCallbackCommand.h>
 #include <vtkSmartPointer.h>
 #include <vtkTimerLog.h>
 #include <vtkXMLUtilities.h>
 #include <vtksys/CommandLineArguments.hxx>
 #include <vtksys/SystemTools.hxx>
 
+//----------------------------------------------------------------------------
+struct BufferDumpObserverData
+{
+  BufferDumpObserverData() : NumberOfCompletedEvents(0), CompletionStatus(PLUS_FAIL) {}
+  std::vector<std::string> WrittenFileNames;
+  int NumberOfCompletedEvents;
+  PlusStatus CompletionStatus;
+};
+
+//----------------------------------------------------------------------------
+void OnBufferDumpEvent(vtkObject* vtkNotUsed(caller), unsigned long eventId, void* clientData, void* callData)
+{
+  BufferDumpObserverData* observerData = static_cast<BufferDumpObserverData*>(clientData);
+  vtkPlusDataCollector::BufferDumpProgress* progress = static_cast<vtkPlusDataCollector::BufferDumpProgress*>(callData);
+  if (eventId == vtkPlusDataCollector::BufferDumpProgressEvent)
+  {
+    if (progress->Status == PLUS_SUCCESS)
+    {
+      observerData->WrittenFileNames.push_back(progress->FileName);
+    }
+  }
+  else if (eventId == vtkPlusDataCollector::BufferDumpCompletedEvent)
+  {
+    observerData->NumberOfCompletedEvents++;
+    observerData->CompletionStatus = progress->Status;
+  }
+}
+
+//----------------------------------------------------------------------------
 int main(int argc, char** argv)
 {
   int numberOfFailures(0);
@@ -208,6 +238,40 @@ int main(int argc, char** argv)
     }
   }
 
+  // Dump all buffers while the acquisition is running
+  BufferDumpObserverData bufferDumpObserverData;
+  vtkSmartPointer<vtkCallbackCommand> bufferDumpCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  bufferDumpCallback->SetCallback(OnBufferDumpEvent);
+  bufferDumpCallback->SetClientData(&bufferDumpObserverData);
+  dataCollector->AddObserver(vtkPlusDataCollector::BufferDumpProgressEvent, bufferDumpCallback);
+  dataCollector->AddObserver(vtkPlusDataCollector::BufferDumpCompletedEvent, bufferDumpCallback);
+  if (dataCollector->StartBufferDump(vtkPlusConfig::GetInstance()->GetOutputDirectory().c_str()) != PLUS_SUCCESS
+      || dataCollector->WaitForBufferDump() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to dump the buffers");
+    numberOfFailures++;
+  }
+  dataCollector->RemoveObserver(bufferDumpCallback);
+  if (bufferDumpObserverData.NumberOfCompletedEvents != 1 || bufferDumpObserverData.CompletionStatus != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Buffer dump completion is not reported correctly");
+    numberOfFailures++;
+  }
+  // One file for the video source and at least one for the tracker tools
+  if (bufferDumpObserverData.WrittenFileNames.size() < 2)
+  {
+    LOG_ERROR("Unexpected number of buffer dump files: " << bufferDumpObserverData.WrittenFileNames.size());
+    numberOfFailures++;
+  }
+  for (std::vector<std::string>::iterator it = bufferDumpObserverData.WrittenFileNames.begin(); it != bufferDumpObserverData.WrittenFileNames.end(); ++it)
+  {
+    if (!vtksys::SystemTools::FileExists(it->c_str(), true) || !vtksys::SystemTools::RemoveFile(it->c_str()))
+    {
+      LOG_ERROR("Unable to find or remove buffer dump file: " << *it);
+      numberOfFailures++;
+    }
+  }
+
   if (dataCollector->Stop() != PLUS_SUCCESS)
   {
     LOG_ERROR("Failed to stop data collection!");
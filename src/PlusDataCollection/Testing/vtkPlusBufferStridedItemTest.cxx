@@ -0,0 +1,183 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusBufferStridedItemTest.cxx
+  \brief This test adds frames that consist of every n-th row or column of a source frame (as the deinterlacer does)
+  and checks the copied pixels for odd frame sizes, RGB frames, general strides and clipping
+*/
+
+#include "PlusConfigure.h"
+#include "vtkImageData.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusDataSource.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <iostream>
+#include <stdlib.h>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Pixel value of the source frame, different for each column, row, and component
+unsigned char GetSourcePixelValue(int x, int y, int component)
+{
+  return static_cast<unsigned char>((x * 17 + y * 31 + component * 101 + 3) % 256);
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPlusDataSource> CreateVideoSource(const std::string& sourceId, unsigned int numberOfScalarComponents)
+{
+  vtkSmartPointer<vtkPlusDataSource> source = vtkSmartPointer<vtkPlusDataSource>::New();
+  source->SetId(sourceId);
+  source->SetInputImageOrientation(US_IMG_ORIENT_MF);
+  source->SetOutputImageOrientation(US_IMG_ORIENT_MF);
+  source->SetPixelType(VTK_UNSIGNED_CHAR);
+  source->SetNumberOfScalarComponents(numberOfScalarComponents);
+  source->SetImageType(numberOfScalarComponents == 3 ? US_IMG_RGB_COLOR : US_IMG_BRIGHTNESS);
+  return source;
+}
+
+//-----------------------------------------------------------------------------
+/*!
+  Add a source frame of the specified size, add a strided frame of it to an output source, and compare each output pixel
+  to the source pixel that it is expected to be copied from. The output frame size is rounded up, as in the deinterlacer,
+  or it is the clip rectangle size if clipping is requested.
+*/
+int TestStridedItem(const std::string& testName, int width, int height, unsigned int numberOfScalarComponents,
+                    const std::array<int, 2>& firstPixel, const std::array<int, 2>& pixelStride,
+                    const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize)
+{
+  vtkSmartPointer<vtkPlusDataSource> inputSource = CreateVideoSource("Input", numberOfScalarComponents);
+  inputSource->SetInputFrameSize(width, height, 1);
+  std::vector<unsigned char> pixels(width * height * numberOfScalarComponents);
+  for (int y = 0; y < height; y++)
+  {
+    for (int x = 0; x < width; x++)
+    {
+      for (unsigned int c = 0; c < numberOfScalarComponents; c++)
+      {
+        pixels[(y * width + x) * numberOfScalarComponents + c] = GetSourcePixelValue(x, y, c);
+      }
+    }
+  }
+  FrameSizeType frameSize = {static_cast<unsigned int>(width), static_cast<unsigned int>(height), 1};
+  const double timestamp = 10.0;
+  if (inputSource->AddItem(&pixels[0], US_IMG_ORIENT_MF, frameSize, VTK_UNSIGNED_CHAR, numberOfScalarComponents,
+                           numberOfScalarComponents == 3 ? US_IMG_RGB_COLOR : US_IMG_BRIGHTNESS, 0, 1, timestamp, timestamp) != PLUS_SUCCESS)
+  {
+    LOG_ERROR(testName << ": failed to add source frame");
+    return 1;
+  }
+
+  vtkSmartPointer<vtkPlusDataSource> outputSource = CreateVideoSource("Output", numberOfScalarComponents);
+  outputSource->SetClipRectangleOrigin(clipRectangleOrigin);
+  outputSource->SetClipRectangleSize(clipRectangleSize);
+  outputSource->SetInputFrameSize((width + pixelStride[0] - 1) / pixelStride[0], (height + pixelStride[1] - 1) / pixelStride[1], 1);
+  if (outputSource->AddStridedItem(inputSource, inputSource->GetLatestItemUidInBuffer(), firstPixel, pixelStride, 1) != PLUS_SUCCESS)
+  {
+    LOG_ERROR(testName << ": failed to add strided frame");
+    return 1;
+  }
+
+  StreamBufferItem outputItem;
+  if (outputSource->GetStreamBufferItem(outputSource->GetLatestItemUidInBuffer(), &outputItem) != ITEM_OK)
+  {
+    LOG_ERROR(testName << ": failed to get strided frame");
+    return 1;
+  }
+  if (outputItem.GetFilteredTimestamp(0) != timestamp)
+  {
+    LOG_ERROR(testName << ": timestamp of the strided frame is " << outputItem.GetFilteredTimestamp(0) << " instead of " << timestamp);
+    return 1;
+  }
+
+  vtkImageData* outputImage = outputItem.GetFrame().GetImage();
+  int* outputDimensions = outputImage->GetDimensions();
+  const bool clipping = igsioCommon::IsClippingRequested(clipRectangleOrigin, clipRectangleSize);
+  const int clipOrigin[2] = {clipping ? clipRectangleOrigin[0] : 0, clipping ? clipRectangleOrigin[1] : 0};
+  if (clipping && (outputDimensions[0] != clipRectangleSize[0] || outputDimensions[1] != clipRectangleSize[1]))
+  {
+    LOG_ERROR(testName << ": strided frame size is " << outputDimensions[0] << "x" << outputDimensions[1]
+              << " instead of the clip rectangle size " << clipRectangleSize[0] << "x" << clipRectangleSize[1]);
+    return 1;
+  }
+
+  int numberOfDifferentValues = 0;
+  const unsigned char* outputPixels = static_cast<const unsigned char*>(outputImage->GetScalarPointer());
+  for (int y = 0; y < outputDimensions[1]; y++)
+  {
+    for (int x = 0; x < outputDimensions[0]; x++)
+    {
+      const int sourceX = firstPixel[0] + (clipOrigin[0] + x) * pixelStride[0];
+      const int sourceY = firstPixel[1] + (clipOrigin[1] + y) * pixelStride[1];
+      for (unsigned int c = 0; c < numberOfScalarComponents; c++)
+      {
+        // Pixels that are not covered by the source frame are set to zero
+        unsigned char expectedValue = (sourceX < width && sourceY < height) ? GetSourcePixelValue(sourceX, sourceY, c) : 0;
+        if (outputPixels[(y * outputDimensions[0] + x) * numberOfScalarComponents + c] != expectedValue)
+        {
+          numberOfDifferentValues++;
+        }
+      }
+    }
+  }
+  if (numberOfDifferentValues > 0)
+  {
+    LOG_ERROR(testName << ": " << numberOfDifferentValues << " values of the " << outputDimensions[0] << "x" << outputDimensions[1] << " strided frame are incorrect");
+    return 1;
+  }
+
+  LOG_INFO(testName << ": " << outputDimensions[0] << "x" << outputDimensions[1] << " strided frame is correct");
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  const std::array<int, 3> noClip = {igsioCommon::NO_CLIP, igsioCommon::NO_CLIP, igsioCommon::NO_CLIP};
+  int numberOfFailures = 0;
+
+  // Horizontal interlace with odd number of rows: the last row of the right frame is not covered
+  numberOfFailures += TestStridedItem("Horizontal left", 7, 5, 1, {0, 0}, {1, 2}, noClip, noClip);
+  numberOfFailures += TestStridedItem("Horizontal right", 7, 5, 1, {0, 1}, {1, 2}, noClip, noClip);
+
+  // Vertical interlace of RGB frames with odd number of columns: the last column of the right frame is not covered
+  numberOfFailures += TestStridedItem("Vertical RGB left", 9, 6, 3, {0, 0}, {2, 1}, noClip, noClip);
+  numberOfFailures += TestStridedItem("Vertical RGB right", 9, 6, 3, {1, 0}, {2, 1}, noClip, noClip);
+
+  // Stride in both directions, starting from an inner pixel
+  numberOfFailures += TestStridedItem("Stride 3x2 RGB", 11, 7, 3, {2, 1}, {3, 2}, noClip, noClip);
+
+  // The clip rectangle is applied to the strided frame
+  const std::array<int, 3> clipRectangleOrigin = {1, 1, 0};
+  const std::array<int, 3> clipRectangleSize = {5, 2, 1};
+  numberOfFailures += TestStridedItem("Clipped horizontal RGB right", 9, 7, 3, {0, 1}, {1, 2}, clipRectangleOrigin, clipRectangleSize);
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfFailures << " errors");
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Exit success!!!" << std::endl;
+  return EXIT_SUCCESS;
+}
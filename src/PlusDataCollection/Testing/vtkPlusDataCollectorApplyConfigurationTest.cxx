@@ -0,0 +1,304 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusDataCollectorApplyConfigurationTest.cxx
+  \brief This test applies modified configurations to running fake tracker devices and checks that live changes are applied
+  in place, other changes restart the device, a device that cannot be restarted is rolled back, and changes that would
+  invalidate the channels of other devices are rejected. Errors are logged on purpose by the failing cases.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDevice.h"
+#include "vtkPlusFakeTracker.h"
+#include "vtkPlusSavedDataSource.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+#include "vtkXMLUtilities.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <iostream>
+#include <stdlib.h>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////
+const char* TRACKER_DEVICE_ID = "TrackerDevice";
+const char* TRACKER_CHANNEL_ID = "TrackerStream";
+
+// The default mode of the fake tracker requires the Reference, Stylus, Stylus-2, and Stylus-3 tools
+const char* TRACKER_CONFIG =
+  "<PlusConfiguration version=\"2.1\">"
+  "  <DataCollection StartupDelaySec=\"0.1\">"
+  "    <DeviceSet Name=\"ApplyConfigurationTest\" Description=\"Fake tracker\" />"
+  "    <Device Id=\"TrackerDevice\" Type=\"FakeTracker\" Mode=\"Default\" AcquisitionRate=\"50\" ToolReferenceFrame=\"Tracker\">"
+  "      <DataSources>"
+  "        <DataSource Type=\"Tool\" Id=\"Reference\" BufferSize=\"100\" />"
+  "        <DataSource Type=\"Tool\" Id=\"Stylus\" BufferSize=\"100\" />"
+  "        <DataSource Type=\"Tool\" Id=\"Stylus-2\" BufferSize=\"100\" />"
+  "        <DataSource Type=\"Tool\" Id=\"Stylus-3\" BufferSize=\"100\" />"
+  "      </DataSources>"
+  "      <OutputChannels>"
+  "        <OutputChannel Id=\"TrackerStream\">"
+  "          <DataSource Id=\"Reference\" />"
+  "          <DataSource Id=\"Stylus\" />"
+  "        </OutputChannel>"
+  "      </OutputChannels>"
+  "    </Device>"
+  "  </DataCollection>"
+  "</PlusConfiguration>";
+
+// The mixer collects the buffers of its input channels when it is configured, it has no internal update thread
+const char* MIXER_DEVICE_CONFIG =
+  "<Device Id=\"MixerDevice\" Type=\"VirtualMixer\">"
+  "  <InputChannels>"
+  "    <InputChannel Id=\"TrackerStream\" />"
+  "  </InputChannels>"
+  "  <OutputChannels>"
+  "    <OutputChannel Id=\"MixedStream\" />"
+  "  </OutputChannels>"
+  "</Device>";
+
+//-----------------------------------------------------------------------------
+vtkXMLDataElement* GetTrackerElement(vtkXMLDataElement* configRootElement)
+{
+  return configRootElement->FindNestedElementWithName("DataCollection")->FindNestedElementWithNameAndAttribute("Device", "Id", TRACKER_DEVICE_ID);
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPlusDataCollector> StartDataCollector(vtkXMLDataElement* configRootElement)
+{
+  vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+  if (dataCollector->ReadConfiguration(configRootElement) != PLUS_SUCCESS
+      || dataCollector->Connect() != PLUS_SUCCESS
+      || dataCollector->Start() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to start the data collector");
+    return NULL;
+  }
+  return dataCollector;
+}
+
+//-----------------------------------------------------------------------------
+// Apply the configuration and compare the result to the expected one
+int ApplyConfiguration(vtkPlusDataCollector* dataCollector, vtkXMLDataElement* configRootElement, PlusStatus expectedStatus,
+                       unsigned int expectedNumberOfUpdatedDevices, unsigned int expectedNumberOfRestartedDevices, const std::string& stepName)
+{
+  std::vector<std::string> updatedDeviceIds;
+  std::vector<std::string> restartedDeviceIds;
+  PlusStatus status = dataCollector->ApplyConfiguration(configRootElement, updatedDeviceIds, restartedDeviceIds);
+  if (status != expectedStatus || updatedDeviceIds.size() != expectedNumberOfUpdatedDevices || restartedDeviceIds.size() != expectedNumberOfRestartedDevices)
+  {
+    LOG_ERROR(stepName << ": ApplyConfiguration " << (status == PLUS_SUCCESS ? "succeeded" : "failed") << " with " << updatedDeviceIds.size() << " updated and "
+              << restartedDeviceIds.size() << " restarted devices (expected: " << (expectedStatus == PLUS_SUCCESS ? "success" : "failure") << " with "
+              << expectedNumberOfUpdatedDevices << " updated and " << expectedNumberOfRestartedDevices << " restarted devices)");
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Check that the tracker is running and its channel provides the expected number of tools
+int CheckTracker(vtkPlusDataCollector* dataCollector, vtkPlusDevice* expectedDevice, bool expectSameDevice, int expectedNumberOfChannelTools, const std::string& stepName)
+{
+  vtkPlusDevice* device = NULL;
+  if (dataCollector->GetDevice(device, TRACKER_DEVICE_ID) != PLUS_SUCCESS)
+  {
+    LOG_ERROR(stepName << ": tracker device is not found");
+    return 1;
+  }
+  int numberOfFailures = 0;
+  if ((device == expectedDevice) != expectSameDevice)
+  {
+    LOG_ERROR(stepName << ": tracker device is " << (expectSameDevice ? "replaced" : "not replaced"));
+    numberOfFailures++;
+  }
+  if (!device->IsRecording())
+  {
+    LOG_ERROR(stepName << ": tracker device is not recording");
+    numberOfFailures++;
+  }
+  vtkPlusChannel* channel = NULL;
+  if (dataCollector->GetChannel(channel, TRACKER_CHANNEL_ID) != PLUS_SUCCESS || channel->GetOwnerDevice() != device)
+  {
+    LOG_ERROR(stepName << ": channel " << TRACKER_CHANNEL_ID << " is not provided by the tracker device");
+    return numberOfFailures + 1;
+  }
+  if (channel->ToolCount() != expectedNumberOfChannelTools)
+  {
+    LOG_ERROR(stepName << ": channel " << TRACKER_CHANNEL_ID << " has " << channel->ToolCount() << " tools instead of " << expectedNumberOfChannelTools);
+    numberOfFailures++;
+  }
+  return numberOfFailures;
+}
+
+//-----------------------------------------------------------------------------
+// Only the attributes that the device opted in to can be changed while it is connected
+int TestCanApplyConfigurationChanges()
+{
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(TRACKER_CONFIG));
+  vtkXMLDataElement* currentElement = GetTrackerElement(configRootElement);
+
+  vtkSmartPointer<vtkXMLDataElement> rateElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  rateElement->DeepCopy(currentElement);
+  rateElement->SetDoubleAttribute("AcquisitionRate", 20);
+  vtkSmartPointer<vtkXMLDataElement> gracePeriodElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  gracePeriodElement->DeepCopy(currentElement);
+  gracePeriodElement->SetDoubleAttribute("MissingInputGracePeriodSec", 3);
+
+  int numberOfFailures = 0;
+  vtkSmartPointer<vtkPlusFakeTracker> fakeTracker = vtkSmartPointer<vtkPlusFakeTracker>::New();
+  if (!fakeTracker->CanApplyConfigurationChanges(currentElement, rateElement))
+  {
+    LOG_ERROR("Fake tracker cannot apply an acquisition rate change while connected");
+    numberOfFailures++;
+  }
+  if (fakeTracker->CanApplyConfigurationChanges(currentElement, gracePeriodElement))
+  {
+    LOG_ERROR("Fake tracker can apply a missing input grace period change while connected");
+    numberOfFailures++;
+  }
+  // The saved data source computes its loop times from the acquisition rate when it is connected
+  vtkSmartPointer<vtkPlusSavedDataSource> savedDataSource = vtkSmartPointer<vtkPlusSavedDataSource>::New();
+  if (savedDataSource->CanApplyConfigurationChanges(currentElement, rateElement))
+  {
+    LOG_ERROR("Saved data source can apply an acquisition rate change while connected");
+    numberOfFailures++;
+  }
+  return numberOfFailures;
+}
+
+//-----------------------------------------------------------------------------
+// Live changes, restart, and failed restart of a running tracker
+int TestApplyConfiguration()
+{
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(TRACKER_CONFIG));
+  vtkSmartPointer<vtkPlusDataCollector> dataCollector = StartDataCollector(configRootElement);
+  if (dataCollector == NULL)
+  {
+    return 1;
+  }
+  vtkPlusDevice* tracker = NULL;
+  dataCollector->GetDevice(tracker, TRACKER_DEVICE_ID);
+  int numberOfFailures = 0;
+
+  // Live changes: acquisition rate, time offset, buffer size, and channel data sources
+  vtkXMLDataElement* trackerElement = GetTrackerElement(configRootElement);
+  trackerElement->SetDoubleAttribute("AcquisitionRate", 20);
+  trackerElement->SetDoubleAttribute("LocalTimeOffsetSec", 0.1);
+  trackerElement->FindNestedElementWithName("DataSources")->FindNestedElementWithNameAndAttribute("DataSource", "Id", "Stylus")->SetIntAttribute("BufferSize", 50);
+  vtkSmartPointer<vtkXMLDataElement> channelSourceElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  channelSourceElement->SetName("DataSource");
+  channelSourceElement->SetAttribute("Id", "Stylus-2");
+  trackerElement->FindNestedElementWithName("OutputChannels")->FindNestedElementWithName("OutputChannel")->AddNestedElement(channelSourceElement);
+  numberOfFailures += ApplyConfiguration(dataCollector, configRootElement, PLUS_SUCCESS, 1, 0, "Live changes");
+  numberOfFailures += CheckTracker(dataCollector, tracker, true, 3, "Live changes");
+  vtkPlusDataSource* stylus = NULL;
+  igsioTransformName stylusName("Stylus", "Tracker");
+  if (tracker->GetAcquisitionRate() != 20 || tracker->GetLocalTimeOffsetSec() != 0.1
+      || tracker->GetTool(stylusName.GetTransformName(), stylus) != PLUS_SUCCESS || stylus->GetBufferSize() != 50)
+  {
+    LOG_ERROR("Live changes: acquisition rate, local time offset, or buffer size is not applied");
+    numberOfFailures++;
+  }
+
+  // Applying the same configuration again does not change anything
+  numberOfFailures += ApplyConfiguration(dataCollector, configRootElement, PLUS_SUCCESS, 0, 0, "Unchanged configuration");
+
+  // Removing the buffer size resets it to the default, as if the device was created from the configuration
+  trackerElement->FindNestedElementWithName("DataSources")->FindNestedElementWithNameAndAttribute("DataSource", "Id", "Stylus")->RemoveAttribute("BufferSize");
+  numberOfFailures += ApplyConfiguration(dataCollector, configRootElement, PLUS_SUCCESS, 1, 0, "Removed buffer size");
+  if (stylus == NULL || stylus->GetBufferSize() != vtkPlusBuffer::DEFAULT_BUFFER_SIZE)
+  {
+    LOG_ERROR("Removed buffer size: buffer size is " << (stylus != NULL ? stylus->GetBufferSize() : -1) << " instead of the default " << vtkPlusBuffer::DEFAULT_BUFFER_SIZE);
+    numberOfFailures++;
+  }
+
+  // Other attributes restart the device
+  trackerElement->SetDoubleAttribute("MissingInputGracePeriodSec", 3);
+  numberOfFailures += ApplyConfiguration(dataCollector, configRootElement, PLUS_SUCCESS, 0, 1, "Restart");
+  numberOfFailures += CheckTracker(dataCollector, tracker, false, 3, "Restart");
+  dataCollector->GetDevice(tracker, TRACKER_DEVICE_ID);
+
+  // The smooth move mode requires a Probe tool, so the new device cannot be connected and the running device is kept
+  vtkSmartPointer<vtkXMLDataElement> restartedConfigRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  restartedConfigRootElement->DeepCopy(configRootElement);
+  trackerElement->SetAttribute("Mode", "SmoothMove");
+  numberOfFailures += ApplyConfiguration(dataCollector, configRootElement, PLUS_FAIL, 0, 0, "Failed restart");
+  numberOfFailures += CheckTracker(dataCollector, tracker, true, 3, "Failed restart");
+
+  // The configuration of the running device is not replaced by the failed one
+  numberOfFailures += ApplyConfiguration(dataCollector, restartedConfigRootElement, PLUS_SUCCESS, 0, 0, "Configuration after failed restart");
+
+  dataCollector->Stop();
+  dataCollector->Disconnect();
+  return numberOfFailures;
+}
+
+//-----------------------------------------------------------------------------
+// Devices that use the channels of the tracker without an internal update thread cannot be paused, so no change is applied
+int TestDependentDevice()
+{
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(TRACKER_CONFIG));
+  vtkSmartPointer<vtkXMLDataElement> mixerElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(MIXER_DEVICE_CONFIG));
+  configRootElement->FindNestedElementWithName("DataCollection")->AddNestedElement(mixerElement);
+  vtkSmartPointer<vtkPlusDataCollector> dataCollector = StartDataCollector(configRootElement);
+  if (dataCollector == NULL)
+  {
+    return 1;
+  }
+  vtkPlusDevice* tracker = NULL;
+  dataCollector->GetDevice(tracker, TRACKER_DEVICE_ID);
+  int numberOfFailures = 0;
+
+  GetTrackerElement(configRootElement)->SetDoubleAttribute("LocalTimeOffsetSec", 0.1);
+  numberOfFailures += ApplyConfiguration(dataCollector, configRootElement, PLUS_FAIL, 0, 0, "Change with dependent device");
+  numberOfFailures += CheckTracker(dataCollector, tracker, true, 2, "Change with dependent device");
+  if (tracker->GetLocalTimeOffsetSec() != 0)
+  {
+    LOG_ERROR("Change with dependent device: local time offset is changed");
+    numberOfFailures++;
+  }
+
+  dataCollector->Stop();
+  dataCollector->Disconnect();
+  return numberOfFailures;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfFailures = 0;
+  numberOfFailures += TestCanApplyConfigurationChanges();
+  numberOfFailures += TestApplyConfiguration();
+  numberOfFailures += TestDependentDevice();
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfFailures << " errors");
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Exit success!!!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,213 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusImplicitSplineForceTest.cxx
+  \brief This test generates B-spline knot and control point files of a plane-like implicit surface and checks that
+  forces interpolated from the distance grid match the exact spline evaluation, and that files that cannot be read
+  do not change the loaded spline
+*/
+
+#include "PlusConfigure.h"
+#include "vtkMatrix4x4.h"
+#include "vtkMinimalStandardRandomSequence.h"
+#include "vtkPlusImplicitSplineForce.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdlib.h>
+
+///////////////////////////////////////////////////////////////////
+const int NUMBER_OF_POSITIONS = 500;
+const double MAX_FORCE_DIFFERENCE = 0.01; // force magnitude is between 0 and 1
+const double PLANE_CONTROL_POINT_INDEX = 25; // the surface is close to the plane at this control point index along the third axis
+
+//-----------------------------------------------------------------------------
+// Uniform knots (1 unit per knot interval), in the file format of vtkPlusImplicitSplineForce
+bool WriteKnotsFile(const std::string& fileName, bool truncated)
+{
+  std::ofstream knotsFile(fileName.c_str());
+  if (!knotsFile.is_open())
+  {
+    LOG_ERROR("Failed to create knots file: " << fileName);
+    return false;
+  }
+  const int numberOfKnots[6] = { NUM_INTERVALU_S + 1, NUM_INTERVALV_S + 1, NUM_INTERVALW_S + 1, DimKnot_U, DimKnot_V, DimKnot_W };
+  // a truncated file ends in the middle of the knot1b values
+  const int numberOfKnotVectors = truncated ? 4 : 6;
+  for (int knotVectorIndex = 0; knotVectorIndex < numberOfKnotVectors; knotVectorIndex++)
+  {
+    int numberOfWrittenKnots = (truncated && knotVectorIndex == numberOfKnotVectors - 1) ? numberOfKnots[knotVectorIndex] / 2 : numberOfKnots[knotVectorIndex];
+    for (int k = 0; k < numberOfWrittenKnots; k++)
+    {
+      knotsFile << k << " ";
+    }
+    knotsFile << std::endl;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Control point values change linearly along the third axis, so the implicit surface is close to a plane
+bool WriteControlPointsFile(const std::string& fileName)
+{
+  std::ofstream controlPointsFile(fileName.c_str());
+  if (!controlPointsFile.is_open())
+  {
+    LOG_ERROR("Failed to create control points file: " << fileName);
+    return false;
+  }
+  for (int w = 0; w < DimCPoint_W; w++)
+  {
+    for (int v = 0; v < DimCPoint_V; v++)
+    {
+      for (int u = 0; u < DimCPoint_U; u++)
+      {
+        controlPointsFile << w - PLANE_CONTROL_POINT_INDEX << " ";
+      }
+      controlPointsFile << std::endl;
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void ComputeForces(vtkPlusImplicitSplineForce* splineForce, const std::vector<double>& positions, std::vector<double>& forces)
+{
+  vtkSmartPointer<vtkMatrix4x4> transformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  forces.resize(positions.size());
+  for (unsigned int positionIndex = 0; positionIndex < positions.size() / 3; positionIndex++)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      transformMatrix->SetElement(i, 3, positions[positionIndex * 3 + i]);
+    }
+    splineForce->GenerateForce(transformMatrix, &forces[positionIndex * 3]);
+  }
+}
+
+//-----------------------------------------------------------------------------
+double GetMaxForceDifference(const std::vector<double>& forces1, const std::vector<double>& forces2)
+{
+  double maxDifference = 0;
+  for (unsigned int i = 0; i < forces1.size(); i++)
+  {
+    maxDifference = std::max(maxDifference, fabs(forces1[i] - forces2[i]));
+  }
+  return maxDifference;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments cmdargs;
+  cmdargs.Initialize(argc, argv);
+  cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!cmdargs.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << cmdargs.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  const std::string knotsFileName = "ImplicitSplineForceTestKnots.txt";
+  const std::string truncatedKnotsFileName = "ImplicitSplineForceTestTruncatedKnots.txt";
+  std::string controlPointsFileName = "ImplicitSplineForceTestControlPoints.txt";
+  std::string missingControlPointsFileName = "ImplicitSplineForceTestMissingControlPoints.txt";
+  if (!WriteKnotsFile(knotsFileName, false) || !WriteKnotsFile(truncatedKnotsFileName, true) || !WriteControlPointsFile(controlPointsFileName))
+  {
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Random positions around the surface, at least 3 knot intervals from the ends of the knot vectors
+  vtkSmartPointer<vtkMinimalStandardRandomSequence> random = vtkSmartPointer<vtkMinimalStandardRandomSequence>::New();
+  random->SetSeed(183495439);
+  const double positionRange[3][2] = { { 3.0, DimKnot_U - 4.0 }, { 3.0, DimKnot_V - 4.0 }, { PLANE_CONTROL_POINT_INDEX - 6.0, PLANE_CONTROL_POINT_INDEX + 6.0 } };
+  std::vector<double> positions;
+  for (int positionIndex = 0; positionIndex < NUMBER_OF_POSITIONS; positionIndex++)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      random->Next();
+      positions.push_back(random->GetRangeValue(positionRange[i][0], positionRange[i][1]));
+    }
+  }
+
+  int numberOfFailures = 0;
+
+  // Exact evaluation
+  vtkSmartPointer<vtkPlusImplicitSplineForce> splineForce = vtkSmartPointer<vtkPlusImplicitSplineForce>::New();
+  splineForce->SetSplineKnots(knotsFileName);
+  splineForce->SetInput(0); // knots only
+  splineForce->SetInput(&controlPointsFileName[0]);
+  std::vector<double> exactForces;
+  ComputeForces(splineForce, positions, exactForces);
+  int numberOfPositionsWithForce = 0;
+  for (int positionIndex = 0; positionIndex < NUMBER_OF_POSITIONS; positionIndex++)
+  {
+    if (exactForces[positionIndex * 3] != 0 || exactForces[positionIndex * 3 + 1] != 0 || exactForces[positionIndex * 3 + 2] != 0)
+    {
+      numberOfPositionsWithForce++;
+    }
+  }
+  LOG_INFO("Force is generated at " << numberOfPositionsWithForce << " of " << NUMBER_OF_POSITIONS << " positions");
+  if (numberOfPositionsWithForce == 0)
+  {
+    LOG_ERROR("No force was generated at any of the positions");
+    numberOfFailures++;
+  }
+
+  // Files that cannot be read must not change the spline (errors are logged by the force object)
+  std::vector<double> forces;
+  splineForce->SetInput(&missingControlPointsFileName[0]);
+  ComputeForces(splineForce, positions, forces);
+  if (GetMaxForceDifference(exactForces, forces) != 0)
+  {
+    LOG_ERROR("Forces changed after failing to read control points");
+    numberOfFailures++;
+  }
+  splineForce->SetSplineKnots(truncatedKnotsFileName);
+  splineForce->SetInput(0);
+  ComputeForces(splineForce, positions, forces);
+  if (GetMaxForceDifference(exactForces, forces) != 0)
+  {
+    LOG_ERROR("Forces changed after failing to read knots");
+    numberOfFailures++;
+  }
+
+  // Distance grid
+  vtkSmartPointer<vtkPlusImplicitSplineForce> gridSplineForce = vtkSmartPointer<vtkPlusImplicitSplineForce>::New();
+  gridSplineForce->UseDistanceGridOn();
+  gridSplineForce->SetSplineKnots(knotsFileName);
+  gridSplineForce->SetInput(0);
+  gridSplineForce->SetInput(&controlPointsFileName[0]);
+  ComputeForces(gridSplineForce, positions, forces);
+  double maxForceDifference = GetMaxForceDifference(exactForces, forces);
+  LOG_INFO("Distance grid max error: " << gridSplineForce->GetDistanceGridMaxError() << ", max force difference: " << maxForceDifference);
+  if (maxForceDifference > MAX_FORCE_DIFFERENCE)
+  {
+    LOG_ERROR("Forces interpolated from the distance grid differ from the exact forces by " << maxForceDifference << " (allowed: " << MAX_FORCE_DIFFERENCE << ")");
+    numberOfFailures++;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Number of failures: " << numberOfFailures);
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Exit success!!!" << std::endl;
+  return EXIT_SUCCESS;
+}
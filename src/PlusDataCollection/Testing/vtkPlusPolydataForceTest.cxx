@@ -0,0 +1,150 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusPolydataForceTest.cxx
+  \brief This test computes forces of a sphere surface model at many random positions, checks that force is
+  generated only close to the surface, and reports the force computation time. The time is only checked if a maximum is specified,
+  as it depends on the machine and its load
+*/
+
+#include "PlusConfigure.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkMatrix4x4.h"
+#include "vtkMinimalStandardRandomSequence.h"
+#include "vtkPlusPolydataForce.h"
+#include "vtkPolyData.h"
+#include "vtkSmartPointer.h"
+#include "vtkSphereSource.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <algorithm>
+#include <iostream>
+#include <stdlib.h>
+
+///////////////////////////////////////////////////////////////////
+const double SPHERE_RADIUS = 50.0;
+const double FORCE_DISTANCE_THRESHOLD = vtkPlusPolydataForce::FORCE_DISTANCE_THRESHOLD;
+const double TESSELLATION_TOLERANCE = 0.5; // maximum distance between the sphere and its tessellated surface
+const int NUMBER_OF_POSITIONS = 20000;
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+  double maxEvaluationTimeUsec = 0; // not checked by default
+
+  vtksys::CommandLineArguments cmdargs;
+  cmdargs.Initialize(argc, argv);
+  cmdargs.AddArgument("--max-evaluation-time-usec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxEvaluationTimeUsec, "Maximum allowed time of 99% of the force computations (in microseconds, optional)");
+  cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!cmdargs.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << cmdargs.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+  sphere->SetRadius(SPHERE_RADIUS);
+  sphere->SetThetaResolution(128);
+  sphere->SetPhiResolution(128);
+  sphere->Update();
+
+  vtkSmartPointer<vtkPlusPolydataForce> polydataForce = vtkSmartPointer<vtkPlusPolydataForce>::New();
+  polydataForce->SetInput(sphere->GetOutput());
+
+  vtkSmartPointer<vtkMinimalStandardRandomSequence> random = vtkSmartPointer<vtkMinimalStandardRandomSequence>::New();
+  random->SetSeed(183495439); // Just some random number was chosen as seed
+
+  vtkSmartPointer<vtkMatrix4x4> transformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  std::vector<double> evaluationTimesUsec;
+  evaluationTimesUsec.reserve(NUMBER_OF_POSITIONS);
+  int numberOfFailures = 0;
+  int numberOfPositionsWithForce = 0;
+  for (int positionIndex = 0; positionIndex < NUMBER_OF_POSITIONS; positionIndex++)
+  {
+    // Random positions in a shell around the surface, both inside and outside the sphere
+    double position[3] = {0, 0, 0};
+    double norm = 0;
+    do
+    {
+      for (int i = 0; i < 3; i++)
+      {
+        random->Next();
+        position[i] = random->GetRangeValue(-1, 1);
+      }
+      norm = sqrt(position[0] * position[0] + position[1] * position[1] + position[2] * position[2]);
+    }
+    while (norm < 0.1 || norm > 1.0);
+    random->Next();
+    double distanceFromCenter = random->GetRangeValue(SPHERE_RADIUS - 3 * FORCE_DISTANCE_THRESHOLD, SPHERE_RADIUS + 3 * FORCE_DISTANCE_THRESHOLD);
+    for (int i = 0; i < 3; i++)
+    {
+      position[i] *= distanceFromCenter / norm;
+      transformMatrix->SetElement(i, 3, position[i]);
+    }
+
+    double force[3] = {0, 0, 0};
+    double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    polydataForce->GenerateForce(transformMatrix, force);
+    evaluationTimesUsec.push_back((vtkIGSIOAccurateTimer::GetSystemTime() - startTime) * 1e6);
+
+    double distanceFromSurface = fabs(distanceFromCenter - SPHERE_RADIUS);
+    if (fabs(distanceFromSurface - FORCE_DISTANCE_THRESHOLD) < TESSELLATION_TOLERANCE)
+    {
+      // the tessellated surface may be on either side of the threshold
+      continue;
+    }
+    bool forceExpected = distanceFromSurface < FORCE_DISTANCE_THRESHOLD;
+    bool forceGenerated = (force[0] != 0 || force[1] != 0 || force[2] != 0);
+    if (forceGenerated)
+    {
+      numberOfPositionsWithForce++;
+    }
+    if (forceExpected != forceGenerated)
+    {
+      LOG_ERROR("Position (" << position[0] << ", " << position[1] << ", " << position[2] << ") is " << distanceFromSurface << " from the surface, force is "
+                << (forceExpected ? "expected" : "not expected") << ", but computed force is (" << force[0] << ", " << force[1] << ", " << force[2] << ")");
+      numberOfFailures++;
+    }
+  }
+
+  if (numberOfPositionsWithForce == 0)
+  {
+    LOG_ERROR("No force was generated at any of the positions");
+    numberOfFailures++;
+  }
+
+  // A few measurements may be affected by the operating system scheduler, so the 99th percentile is checked instead of the maximum
+  std::sort(evaluationTimesUsec.begin(), evaluationTimesUsec.end());
+  double meanEvaluationTimeUsec = 0;
+  for (std::vector<double>::iterator it = evaluationTimesUsec.begin(); it != evaluationTimesUsec.end(); ++it)
+  {
+    meanEvaluationTimeUsec += *it;
+  }
+  meanEvaluationTimeUsec /= evaluationTimesUsec.size();
+  double percentileEvaluationTimeUsec = evaluationTimesUsec[evaluationTimesUsec.size() * 99 / 100];
+  LOG_INFO("Force computation time: mean " << meanEvaluationTimeUsec << " us, 99th percentile " << percentileEvaluationTimeUsec
+           << " us, maximum " << evaluationTimesUsec.back() << " us (" << numberOfPositionsWithForce << " of " << NUMBER_OF_POSITIONS << " positions with force)");
+  if (maxEvaluationTimeUsec > 0 && percentileEvaluationTimeUsec > maxEvaluationTimeUsec)
+  {
+    LOG_ERROR("Force computation is too slow: 99th percentile is " << percentileEvaluationTimeUsec << " us (allowed: " << maxEvaluationTimeUsec << " us)");
+    numberOfFailures++;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Number of failures: " << numberOfFailures);
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Exit success!!!" << std::endl;
+  return EXIT_SUCCESS;
+}
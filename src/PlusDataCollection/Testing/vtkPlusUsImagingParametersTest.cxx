@@ -0,0 +1,161 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusUsImagingParametersTest.cxx
+  \brief This test checks that typed and serialized values of the ultrasound imaging parameters are consistent
+  and that the modification time changes only when a parameter value is changed
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusUsImagingParameters.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <iostream>
+#include <stdlib.h>
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments cmdargs;
+  cmdargs.Initialize(argc, argv);
+  cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!cmdargs.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << cmdargs.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfFailures = 0;
+  vtkSmartPointer<vtkPlusUsImagingParameters> parameters = vtkSmartPointer<vtkPlusUsImagingParameters>::New();
+
+  // Typed values
+  double depthMm = 0;
+  if (parameters->GetDepthMm(depthMm) == PLUS_SUCCESS)
+  {
+    LOG_ERROR("Depth is not set, but it could be retrieved");
+    numberOfFailures++;
+  }
+  parameters->SetDepthMm(55.5);
+  if (parameters->GetDepthMm(depthMm) != PLUS_SUCCESS || depthMm != 55.5)
+  {
+    LOG_ERROR("Depth mismatch: " << depthMm << " (expected: 55.5)");
+    numberOfFailures++;
+  }
+  std::string depthStr;
+  if (parameters->GetValue<std::string>(vtkPlusUsImagingParameters::KEY_DEPTH, depthStr) != PLUS_SUCCESS || depthStr != "55.5")
+  {
+    LOG_ERROR("Serialized depth mismatch: " << depthStr << " (expected: 55.5)");
+    numberOfFailures++;
+  }
+  if (!parameters->IsPending(vtkPlusUsImagingParameters::KEY_DEPTH))
+  {
+    LOG_ERROR("Depth is changed, but it is not pending");
+    numberOfFailures++;
+  }
+  // A change that does not show up in the serialized value is pending, too
+  parameters->SetPending(vtkPlusUsImagingParameters::KEY_DEPTH, false);
+  parameters->SetDepthMm(55.5 + 1e-9);
+  parameters->GetValue<std::string>(vtkPlusUsImagingParameters::KEY_DEPTH, depthStr);
+  if (!parameters->IsPending(vtkPlusUsImagingParameters::KEY_DEPTH) || depthStr != "55.5")
+  {
+    LOG_ERROR("Depth is changed by less than the serialized precision, but it is not pending (serialized depth: " << depthStr << ")");
+    numberOfFailures++;
+  }
+  parameters->SetDepthMm(55.5);
+
+  // Vector values
+  std::vector<double> tgc;
+  tgc.push_back(10);
+  tgc.push_back(20.5);
+  tgc.push_back(30);
+  parameters->SetTimeGainCompensation(tgc);
+  std::string tgcStr;
+  parameters->GetValue<std::string>(vtkPlusUsImagingParameters::KEY_TGC, tgcStr);
+  if (parameters->GetTimeGainCompensation() != tgc || tgcStr != "10 20.5 30 ")
+  {
+    LOG_ERROR("Time gain compensation mismatch: " << tgcStr);
+    numberOfFailures++;
+  }
+  parameters->SetImageSize(640, 480, 1);
+  FrameSizeType imageSize = parameters->GetImageSize();
+  if (imageSize[0] != 640 || imageSize[1] != 480 || imageSize[2] != 1)
+  {
+    LOG_ERROR("Image size mismatch: " << imageSize[0] << " " << imageSize[1] << " " << imageSize[2]);
+    numberOfFailures++;
+  }
+  // Negative image size components are clamped to zero
+  vtkSmartPointer<vtkPlusUsImagingParameters> invalidSizeParameters = vtkSmartPointer<vtkPlusUsImagingParameters>::New();
+  invalidSizeParameters->SetValue<std::string>(vtkPlusUsImagingParameters::KEY_IMAGESIZE, "-5 480 1");
+  FrameSizeType invalidImageSize = invalidSizeParameters->GetImageSize();
+  if (invalidImageSize[0] != 0 || invalidImageSize[1] != 480 || invalidImageSize[2] != 1)
+  {
+    LOG_ERROR("Negative image size is not clamped: " << invalidImageSize[0] << " " << invalidImageSize[1] << " " << invalidImageSize[2]);
+    numberOfFailures++;
+  }
+
+  // Serialized values are parsed for the typed accessors
+  parameters->SetValue<std::string>(vtkPlusUsImagingParameters::KEY_FREQUENCY, "12.5");
+  if (parameters->GetFrequencyMhz() != 12.5)
+  {
+    LOG_ERROR("Frequency mismatch: " << parameters->GetFrequencyMhz() << " (expected: 12.5)");
+    numberOfFailures++;
+  }
+  parameters->SetValue<std::string>(vtkPlusUsImagingParameters::KEY_GAIN, "high");
+  double gain = 0;
+  if (parameters->GetValue<double>(vtkPlusUsImagingParameters::KEY_GAIN, gain) == PLUS_SUCCESS)
+  {
+    LOG_ERROR("Non-numeric gain value was retrieved as a number: " << gain);
+    numberOfFailures++;
+  }
+
+  // Modification time changes only if a value is changed
+  vtkMTimeType modifiedTime = parameters->GetMTime();
+  parameters->SetDepthMm(55.5);
+  parameters->SetTimeGainCompensation(tgc);
+  if (parameters->GetMTime() != modifiedTime)
+  {
+    LOG_ERROR("Modification time changed, but parameter values were not changed");
+    numberOfFailures++;
+  }
+  parameters->SetDepthMm(60);
+  if (parameters->GetMTime() == modifiedTime)
+  {
+    LOG_ERROR("Modification time did not change, but depth was changed");
+    numberOfFailures++;
+  }
+
+  // Configuration round trip
+  vtkSmartPointer<vtkXMLDataElement> deviceElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  deviceElement->SetName("Device");
+  parameters->WriteConfiguration(deviceElement);
+  vtkSmartPointer<vtkPlusUsImagingParameters> readParameters = vtkSmartPointer<vtkPlusUsImagingParameters>::New();
+  if (readParameters->ReadConfiguration(deviceElement) != PLUS_SUCCESS
+      || readParameters->GetDepthMm() != 60
+      || readParameters->GetTimeGainCompensation() != tgc
+      || readParameters->GetImageSize() != imageSize)
+  {
+    LOG_ERROR("Imaging parameters read from the configuration are different from the written ones");
+    numberOfFailures++;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Number of failures: " << numberOfFailures);
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Exit success!!!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusVirtualSwitcherTest.cxx
+  \brief This test feeds two fake video sources alternately and checks that the virtual switcher
+  activates the input that produces data and that the switch latency is within the allowed limit
+*/
+
+#include "PlusConfigure.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusVirtualSwitcher.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////
+const unsigned int FRAME_SIZE = 16;
+const int NUMBER_OF_FRAMES_PER_PHASE = 30;
+const int NUMBER_OF_INPUTS = 2;
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPlusDataSource> CreateFakeVideoSource(const std::string& sourceId)
+{
+  vtkSmartPointer<vtkPlusDataSource> source = vtkSmartPointer<vtkPlusDataSource>::New();
+  source->SetId(sourceId);
+  source->SetInputImageOrientation(US_IMG_ORIENT_MF);
+  source->SetOutputImageOrientation(US_IMG_ORIENT_MF);
+  source->SetPixelType(VTK_UNSIGNED_CHAR);
+  source->SetNumberOfScalarComponents(1);
+  source->SetImageType(US_IMG_BRIGHTNESS);
+  source->SetInputFrameSize(FRAME_SIZE, FRAME_SIZE, 1);
+  return source;
+}
+
+//-----------------------------------------------------------------------------
+// Add frames to the sources with the specified period, returns the time when the first frame was added
+double AddFrames(const std::vector<vtkPlusDataSource*>& sources, double framePeriodSec, long& frameNumber, int& numberOfFailures)
+{
+  std::vector<unsigned char> pixels(FRAME_SIZE * FRAME_SIZE, 0);
+  FrameSizeType frameSize = {FRAME_SIZE, FRAME_SIZE, 1};
+  double firstFrameTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  for (int i = 0; i < NUMBER_OF_FRAMES_PER_PHASE; i++)
+  {
+    frameNumber++;
+    for (std::vector<vtkPlusDataSource*>::const_iterator it = sources.begin(); it != sources.end(); ++it)
+    {
+      if ((*it)->AddItem(&pixels[0], US_IMG_ORIENT_MF, frameSize, VTK_UNSIGNED_CHAR, 1, US_IMG_BRIGHTNESS, 0, frameNumber) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add frame " << frameNumber << " to source " << (*it)->GetSourceId());
+        numberOfFailures++;
+      }
+    }
+    vtkIGSIOAccurateTimer::Delay(framePeriodSec);
+  }
+  return firstFrameTime;
+}
+
+//-----------------------------------------------------------------------------
+// Check the active input after a phase
+void CheckActiveInput(vtkPlusVirtualSwitcher* switcher, vtkPlusChannel* expectedInputChannel, vtkPlusChannel* outputChannel, int expectedNumberOfSwitches, int& numberOfFailures)
+{
+  vtkPlusChannel* activeChannel = NULL;
+  if (switcher->GetChannel(activeChannel) != PLUS_SUCCESS || activeChannel != expectedInputChannel)
+  {
+    LOG_ERROR("Active input channel is " << (activeChannel ? activeChannel->GetChannelId() : "none") << ", expected " << expectedInputChannel->GetChannelId());
+    numberOfFailures++;
+  }
+  vtkPlusDataSource* outputVideoSource = NULL;
+  vtkPlusDataSource* expectedVideoSource = NULL;
+  outputChannel->GetVideoSource(outputVideoSource);
+  expectedInputChannel->GetVideoSource(expectedVideoSource);
+  if (outputVideoSource != expectedVideoSource)
+  {
+    LOG_ERROR("Output channel does not provide the video source of input channel " << expectedInputChannel->GetChannelId());
+    numberOfFailures++;
+  }
+  if (switcher->GetNumberOfSwitches() != expectedNumberOfSwitches)
+  {
+    LOG_ERROR("Number of switches is " << switcher->GetNumberOfSwitches() << ", expected " << expectedNumberOfSwitches);
+    numberOfFailures++;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+  double framePeriodSec = 0.02;
+  double maxSwitchLatencySec = 0.2;
+
+  vtksys::CommandLineArguments cmdargs;
+  cmdargs.Initialize(argc, argv);
+  cmdargs.AddArgument("--frame-period-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &framePeriodSec, "Time between frames of the fake video sources (in seconds)");
+  cmdargs.AddArgument("--max-switch-latency-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxSwitchLatencySec, "Maximum allowed time between the first frame of an input and switching to it (in seconds)");
+  cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!cmdargs.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << cmdargs.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkPlusVirtualSwitcher> switcher = vtkSmartPointer<vtkPlusVirtualSwitcher>::New();
+  switcher->SetDeviceId("Switcher");
+
+  std::vector<vtkSmartPointer<vtkPlusDataSource> > sources;
+  std::vector<vtkSmartPointer<vtkPlusChannel> > inputChannels;
+  for (int i = 0; i < NUMBER_OF_INPUTS; i++)
+  {
+    std::ostringstream id;
+    id << "Input" << i;
+    sources.push_back(CreateFakeVideoSource(id.str() + "Video"));
+    vtkSmartPointer<vtkPlusChannel> channel = vtkSmartPointer<vtkPlusChannel>::New();
+    channel->SetChannelId((id.str() + "Stream").c_str());
+    channel->SetVideoSource(sources.back());
+    inputChannels.push_back(channel);
+    switcher->AddInputChannel(channel);
+  }
+  vtkSmartPointer<vtkPlusChannel> outputChannel = vtkSmartPointer<vtkPlusChannel>::New();
+  outputChannel->SetChannelId("SwitchedStream");
+  switcher->AddOutputChannel(outputChannel);
+
+  if (switcher->NotifyConfigured() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to configure the switcher");
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int numberOfFailures = 0;
+  long frameNumber = 0;
+  std::vector<vtkPlusDataSource*> firstInput(1, sources[0].GetPointer());
+  std::vector<vtkPlusDataSource*> secondInput(1, sources[1].GetPointer());
+  std::vector<vtkPlusDataSource*> bothInputs;
+  bothInputs.push_back(sources[0]);
+  bothInputs.push_back(sources[1]);
+
+  // No input is active yet, the first frame activates the first input
+  double firstFrameTime = AddFrames(firstInput, framePeriodSec, frameNumber, numberOfFailures);
+  CheckActiveInput(switcher, inputChannels[0], outputChannel, 1, numberOfFailures);
+  LOG_INFO("Initial activation latency: " << (switcher->GetLastSwitchTime() - firstFrameTime) * 1000.0 << " ms");
+
+  // The first input stops and the second one starts
+  firstFrameTime = AddFrames(secondInput, framePeriodSec, frameNumber, numberOfFailures);
+  CheckActiveInput(switcher, inputChannels[1], outputChannel, 2, numberOfFailures);
+  double switchLatencySec = switcher->GetLastSwitchTime() - firstFrameTime;
+  LOG_INFO("Switch latency: " << switchLatencySec * 1000.0 << " ms (reported by the switcher: " << switcher->GetLastSwitchLatencySec() * 1000.0 << " ms)");
+  if (switchLatencySec < 0 || switchLatencySec > maxSwitchLatencySec)
+  {
+    LOG_ERROR("Switch latency is " << switchLatencySec * 1000.0 << " ms (allowed: " << maxSwitchLatencySec * 1000.0 << " ms)");
+    numberOfFailures++;
+  }
+  if (switcher->GetLastSwitchLatencySec() < 0 || switcher->GetLastSwitchLatencySec() > switchLatencySec)
+  {
+    LOG_ERROR("Switch latency reported by the switcher is " << switcher->GetLastSwitchLatencySec() * 1000.0 << " ms, expected between 0 and " << switchLatencySec * 1000.0 << " ms");
+    numberOfFailures++;
+  }
+
+  // Both inputs produce data, the active input must be kept
+  AddFrames(bothInputs, framePeriodSec, frameNumber, numberOfFailures);
+  CheckActiveInput(switcher, inputChannels[1], outputChannel, 2, numberOfFailures);
+
+  // The second input stops, switch back to the first one, which has been producing data all along
+  firstFrameTime = AddFrames(firstInput, framePeriodSec, frameNumber, numberOfFailures);
+  CheckActiveInput(switcher, inputChannels[0], outputChannel, 3, numberOfFailures);
+  switchLatencySec = switcher->GetLastSwitchTime() - firstFrameTime;
+  double reportedSwitchLatencySec = switcher->GetLastSwitchLatencySec();
+  LOG_INFO("Switch back latency: " << switchLatencySec * 1000.0 << " ms (reported by the switcher: " << reportedSwitchLatencySec * 1000.0 << " ms)");
+  if (switchLatencySec < 0 || switchLatencySec > maxSwitchLatencySec)
+  {
+    LOG_ERROR("Switch back latency is " << switchLatencySec * 1000.0 << " ms (allowed: " << maxSwitchLatencySec * 1000.0 << " ms)");
+    numberOfFailures++;
+  }
+  // The switcher measures the latency from the moment the second input exceeded its inactivity period, which is after it stopped
+  if (reportedSwitchLatencySec < 0 || reportedSwitchLatencySec > switchLatencySec)
+  {
+    LOG_ERROR("Switch back latency reported by the switcher is " << reportedSwitchLatencySec * 1000.0 << " ms, expected between 0 and " << switchLatencySec * 1000.0 << " ms");
+    numberOfFailures++;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Number of failures: " << numberOfFailures);
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Exit success!!!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -16,6 +16,7 @@ int main(int argc, char** argv)
   std::string inputConfigFileName;
   std::string deviceId;
   std::string fieldValue;
+  int numberOfFields = 1;
 
   vtksys::CommandLineArguments args;
   args.Initialize(argc, argv);
@@ -26,6 +27,7 @@ int main(int argc, char** argv)
   args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Config file to test with.");
   args.AddArgument("--device-id", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &deviceId, "Id of the text recognizer device.");
   args.AddArgument("--field-value", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &fieldValue, "Value of the first field.");
+  args.AddArgument("--number-of-fields", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFields, "Number of copies of the first field to recognize, each by a separate recognition thread (default: 1).");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
   if (!args.Parse())
@@ -56,6 +58,30 @@ int main(int argc, char** argv)
     return EXIT_FAILURE;
   }
 
+  if (numberOfFields > 1)
+  {
+    // Copies of the first field are recognized concurrently, they all must have the same value
+    vtkXMLDataElement* dataCollectionElement = configRootElement->FindNestedElementWithName("DataCollection");
+    vtkXMLDataElement* deviceElement = (dataCollectionElement != NULL) ? dataCollectionElement->FindNestedElementWithNameAndAttribute("Device", "Id", deviceId.c_str()) : NULL;
+    vtkXMLDataElement* textFieldsElement = (deviceElement != NULL) ? deviceElement->FindNestedElementWithName("TextFields") : NULL;
+    vtkXMLDataElement* firstFieldElement = (textFieldsElement != NULL) ? textFieldsElement->FindNestedElementWithName("Field") : NULL;
+    if (firstFieldElement == NULL)
+    {
+      LOG_ERROR("Unable to find the first text field of device " << deviceId << " in the configuration");
+      return EXIT_FAILURE;
+    }
+    for (int i = 1; i < numberOfFields; ++i)
+    {
+      vtkSmartPointer<vtkXMLDataElement> fieldElement = vtkSmartPointer<vtkXMLDataElement>::New();
+      fieldElement->DeepCopy(firstFieldElement);
+      std::ostringstream fieldName;
+      fieldName << firstFieldElement->GetAttribute("Name") << i;
+      fieldElement->SetAttribute("Name", fieldName.str().c_str());
+      textFieldsElement->AddNestedElement(fieldElement);
+    }
+    deviceElement->SetIntAttribute("NumberOfRecognitionThreads", numberOfFields);
+  }
+
   vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
 
   vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
@@ -102,12 +128,39 @@ int main(int argc, char** argv)
 #endif
 
   vtkPlusVirtualTextRecognizer::ChannelFieldListMap map = textRecognizer->GetRecognitionFields();
-  vtkPlusVirtualTextRecognizer::FieldListIterator it = map.begin()->second.begin();
-  if ((*it)->LatestParameterValue != fieldValue)
+  if (static_cast<int>(map.begin()->second.size()) != numberOfFields)
+  {
+    LOG_ERROR("Number of recognized fields is " << map.begin()->second.size() << " instead of " << numberOfFields);
+    return EXIT_FAILURE;
+  }
+  for (vtkPlusVirtualTextRecognizer::FieldListIterator fieldIt = map.begin()->second.begin(); fieldIt != map.begin()->second.end(); ++fieldIt)
+  {
+    if ((*fieldIt)->LatestParameterValue != fieldValue)
+    {
+      LOG_ERROR("Direct: Parameter \"" << (*fieldIt)->ParameterName << "\" value=\"" << (*fieldIt)->LatestParameterValue << "\" does not match expected value=\"" << fieldValue << "\"");
+      return EXIT_FAILURE;
+    }
+  }
+
+  // New frames keep arriving, but the field regions do not change, so the fields must not be recognized again
+  int numberOfRecognitions = textRecognizer->GetNumberOfRecognitions();
+  if (numberOfRecognitions < numberOfFields)
   {
-    LOG_ERROR("Direct: Parameter \"" << (*it)->ParameterName << "\" value=\"" << (*it)->LatestParameterValue << "\" does not match expected value=\"" << fieldValue << "\"");
+    LOG_ERROR("Only " << numberOfRecognitions << " recognitions were performed for " << numberOfFields << " fields");
     return EXIT_FAILURE;
   }
+#ifdef _WIN32
+  Sleep(500);
+#else
+  usleep(500000);
+#endif
+  if (textRecognizer->GetNumberOfRecognitions() != numberOfRecognitions)
+  {
+    LOG_ERROR("Unchanged fields were recognized again: number of recognitions increased from " << numberOfRecognitions << " to " << textRecognizer->GetNumberOfRecognitions());
+    return EXIT_FAILURE;
+  }
+
+  vtkPlusVirtualTextRecognizer::FieldListIterator it = map.begin()->second.begin();
 
   igsioTrackedFrame frame;
   (*device->GetOutputChannelsStart())->GetTrackedFrame(frame);
@@ -133,7 +133,8 @@ PlusStatus vtkPlusUsSimulatorVideoSource::InternalUpdate()
     return PLUS_FAIL;
   }
 
-  // Get the simulated US image
+  // Get the simulated US image. Only the scanlines that moved since the previous frame are simulated again,
+  // if the probe and the objects are all stationary then the previous image is reused.
   this->UsSimulator->Modified(); // Signal that the transforms have changed so we need to recompute
   this->UsSimulator->Update();
 
@@ -144,7 +145,7 @@ PlusStatus vtkPlusUsSimulatorVideoSource::InternalUpdate()
     return PLUS_FAIL;
   }
 
-  LOG_DEBUG("Simulated frame " << this->FrameNumber << " generated.");
+  LOG_DEBUG("Simulated frame " << this->FrameNumber << " generated (" << this->UsSimulator->GetNumberOfSimulatedScanlines() << " scanlines recomputed).");
   PlusStatus status = aSource->AddItem(
                         this->UsSimulator->GetOutput(), aSource->GetInputImageOrientation(), US_IMG_BRIGHTNESS, this->FrameNumber, latestTrackerTimestamp, latestTrackerTimestamp);
 
@@ -275,6 +276,9 @@ PlusStatus vtkPlusUsSimulatorVideoSource::InternalApplyImagingParameterChange()
     this->ImagingParameters->SetPending(vtkPlusUsImagingParameters::KEY_CONTRAST, false);
   }
 
+  // Scanlines simulated with the previous imaging parameters cannot be reused
+  this->UsSimulator->InvalidatePoseCache();
+
   //TODO: Acknowledge parameter change
   //      (if here then need to trust developer, or do it everywhere this function is called)
 
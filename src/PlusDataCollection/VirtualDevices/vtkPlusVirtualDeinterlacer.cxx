@@ -10,16 +10,14 @@ See License.txt for details.
 #include "vtkPlusDataSource.h"
 #include "vtkPlusVirtualDeinterlacer.h"
 
-// IGSIO includes
-#include <igsioVideoFrame.h>
-#include <vtkIGSIOTrackedFrameList.h>
-
 // VTK includes
-#include <vtkImageData.h>
 #include <vtkObjectFactory.h>
 
 namespace
 {
+  // Maximum number of input frames that are processed in one update
+  static const int MAX_NUMBER_OF_FRAMES_PER_UPDATE = 100;
+
   //----------------------------------------------------------------------------
   std::string ModeToString(vtkPlusVirtualDeinterlacer::StereoMode mode)
   {
@@ -60,11 +58,10 @@ vtkPlusVirtualDeinterlacer::vtkPlusVirtualDeinterlacer()
   : vtkPlusDevice()
   , Mode(Stereo_Unknown)
   , Initialized(false)
-  , LastInputTimestamp(UNDEFINED_TIMESTAMP)
-  , FrameList(vtkIGSIOTrackedFrameList::New())
+  , LastInputUid(0)
   , InputSource(nullptr)
-  , LeftImage(nullptr)
-  , RightImage(nullptr)
+  , LeftSource(nullptr)
+  , RightSource(nullptr)
   , SwitchInterlaceOrdering(false)
 {
   this->AcquisitionRate = 400; // Super fast!
@@ -74,17 +71,6 @@ vtkPlusVirtualDeinterlacer::vtkPlusVirtualDeinterlacer()
 //----------------------------------------------------------------------------
 vtkPlusVirtualDeinterlacer::~vtkPlusVirtualDeinterlacer()
 {
-  if (this->LeftImage != nullptr)
-  {
-    this->LeftImage->Delete();
-    this->LeftImage = nullptr;
-  }
-  if (this->RightImage != nullptr)
-  {
-    this->RightImage->Delete();
-    this->RightImage = nullptr;
-  }
-  this->FrameList->Delete();
 }
 
 //----------------------------------------------------------------------------
@@ -160,86 +146,59 @@ PlusStatus vtkPlusVirtualDeinterlacer::InternalUpdate()
     this->LeftSource->SetImageType(this->InputSource->GetImageType());
     this->RightSource->SetImageType(this->InputSource->GetImageType());
 
-    this->LeftImage = vtkImageData::New();
-    this->RightImage = vtkImageData::New();
-    this->LeftImage->SetDimensions(size[0], size[1], size[2]);
-    this->RightImage->SetDimensions(size[0], size[1], size[2]);
-    this->LeftImage->AllocateScalars(this->InputSource->GetPixelType(), this->InputSource->GetNumberOfScalarComponents());
-    this->RightImage->AllocateScalars(this->InputSource->GetPixelType(), this->InputSource->GetNumberOfScalarComponents());
-
     this->Initialized = true;
   }
 
-  this->FrameList->Clear();
-  if (this->InputChannels[0]->GetTrackedFrameList(this->LastInputTimestamp, this->FrameList, 100) != PLUS_SUCCESS)
+  if (!this->Initialized)
   {
-    return PLUS_FAIL;
+    return PLUS_SUCCESS;
   }
 
-  for (auto frame : *this->FrameList)
+  // Left and right frames consist of every second row or column of the input frames
+  std::array<int, 2> pixelStride = {1, 1};
+  std::array<int, 2> leftFirstPixel = {0, 0};
+  std::array<int, 2> rightFirstPixel = {0, 0};
+  if (this->Mode == Stereo_HorizontalInterlace)
   {
-    if (this->Mode == Stereo_HorizontalInterlace)
-    {
-      this->SplitFrameHorizontal(frame);
-    }
-    else if (this->Mode == Stereo_VerticalInterlace)
-    {
-      this->SplitFrameVertical(frame);
-    }
-
-    this->LeftSource->AddItem(this->LeftImage, this->LeftSource->GetInputImageOrientation(), this->LeftSource->GetImageType(), this->FrameNumber);
-    this->RightSource->AddItem(this->RightImage, this->RightSource->GetInputImageOrientation(), this->RightSource->GetImageType(), this->FrameNumber);
-    this->FrameNumber++;
+    pixelStride[1] = 2;
+    rightFirstPixel[1] = 1;
   }
-
-  return PLUS_SUCCESS;
-}
-
-//----------------------------------------------------------------------------
-void vtkPlusVirtualDeinterlacer::SplitFrameHorizontal(igsioTrackedFrame* frame)
-{
-  vtkImageData* inputImage = frame->GetImageData()->GetImage();
-  vtkIdType* inputIncrements = inputImage->GetIncrements();
-  unsigned char* inputPtr = (unsigned char*)inputImage->GetScalarPointer();
-  unsigned char* leftPtr = (unsigned char*)this->LeftImage->GetScalarPointer();
-  unsigned char* rightPtr = (unsigned char*)this->RightImage->GetScalarPointer();
-  vtkIdType* outputIncrements = this->LeftImage->GetIncrements();
-
-  // for each input row
-  for (vtkIdType row = 0; row < inputImage->GetDimensions()[1]; row++)
+  else if (this->Mode == Stereo_VerticalInterlace)
   {
-    // %2 = 0 left, %2 = 1 right
-    bool left(false);
-    if (row % 2 == 0)
-    {
-      left = true;
-    }
-    if (this->SwitchInterlaceOrdering)
-    {
-      left = !left;
-    }
+    pixelStride[0] = 2;
+    rightFirstPixel[0] = 1;
+  }
+  if (this->SwitchInterlaceOrdering)
+  {
+    std::swap(leftFirstPixel, rightFirstPixel);
+  }
 
-    // finished with this row,
-    // increment output image pointer for this row's image
-    if (left)
+  // Process the input frames that have been added since the last update
+  BufferItemUidType latestInputUid = this->InputSource->GetLatestItemUidInBuffer();
+  BufferItemUidType firstInputUid = std::max(this->LastInputUid + 1, this->InputSource->GetOldestItemUidInBuffer());
+  if (latestInputUid >= firstInputUid + MAX_NUMBER_OF_FRAMES_PER_UPDATE)
+  {
+    firstInputUid = latestInputUid - MAX_NUMBER_OF_FRAMES_PER_UPDATE + 1;
+  }
+  for (BufferItemUidType inputUid = firstInputUid; inputUid <= latestInputUid; ++inputUid)
+  {
+    // The pixels are written directly from the input buffer into the left and right buffers.
+    // Both frames are added even if one of them fails, so that the left and right outputs stay in sync.
+    PlusStatus leftStatus = this->LeftSource->AddStridedItem(this->InputSource, inputUid, leftFirstPixel, pixelStride, this->FrameNumber);
+    PlusStatus rightStatus = this->RightSource->AddStridedItem(this->InputSource, inputUid, rightFirstPixel, pixelStride, this->FrameNumber);
+    if (leftStatus != PLUS_SUCCESS)
     {
-      // Copy row to left image, increment left image pointer
-      memcpy(leftPtr, inputPtr, inputIncrements[1]);
-      leftPtr += outputIncrements[1];
+      LOG_DEBUG("Failed to add left deinterlaced frame of input frame " << inputUid);
     }
-    else
+    if (rightStatus != PLUS_SUCCESS)
     {
-      memcpy(rightPtr, inputPtr, inputIncrements[1]);
-      rightPtr += outputIncrements[1];
+      LOG_DEBUG("Failed to add right deinterlaced frame of input frame " << inputUid);
     }
-    inputPtr += inputIncrements[1];
+    this->LastInputUid = inputUid;
+    this->FrameNumber++;
   }
-}
-
-//----------------------------------------------------------------------------
-void vtkPlusVirtualDeinterlacer::SplitFrameVertical(igsioTrackedFrame* frame)
-{
 
+  return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
@@ -14,15 +14,15 @@ See License.txt for details.
 // STL includes
 #include <memory>
 
-class igsioVideoFrame;
-class vtkIGSIOTrackedFrameList;
-class vtkImageData;
 class vtkPlusChannel;
 class vtkPlusDataSource;
 
 /*!
 \class vtkPlusVirtualDeinterlacer
-\brief
+\brief Split interlaced stereo frames into a left and a right video source
+
+The rows (or columns) of each input frame are written directly from the input buffer into the buffers
+of the left and right video sources in one pass, without intermediate images.
 
 \ingroup PlusLibDataCollection
 */
@@ -57,10 +57,6 @@ public:
   vtkGetMacro(SwitchInterlaceOrdering, bool);
   vtkSetMacro(SwitchInterlaceOrdering, bool);
 
-protected:
-  void SplitFrameHorizontal(igsioTrackedFrame* frame);
-  void SplitFrameVertical(igsioTrackedFrame* frame);
-
 protected:
   vtkPlusVirtualDeinterlacer();
   virtual ~vtkPlusVirtualDeinterlacer();
@@ -68,13 +64,10 @@ protected:
   StereoMode                                Mode;
   bool                                      Initialized;
   bool                                      SwitchInterlaceOrdering;
-  double                                    LastInputTimestamp;
+  BufferItemUidType                         LastInputUid;
   vtkPlusDataSource*                        InputSource;
   vtkPlusDataSource*                        LeftSource;
   vtkPlusDataSource*                        RightSource;
-  vtkImageData*                             LeftImage;
-  vtkImageData*                             RightImage;
-  vtkIGSIOTrackedFrameList*                 FrameList;
 
 private:
   vtkPlusVirtualDeinterlacer(const vtkPlusVirtualDeinterlacer&);  // Not implemented.
@@ -5,24 +5,46 @@
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "vtkCallbackCommand.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkIGSIORecursiveCriticalSection.h"
 #include "vtkObjectFactory.h"
 #include "vtkPlusDataSource.h"
 #include "vtkPlusVirtualSwitcher.h"
 
+#include <algorithm>
+
 //----------------------------------------------------------------------------
 
 vtkStandardNewMacro(vtkPlusVirtualSwitcher);
 
-const int FRAME_COUNT_BEFORE_INACTIVE = 25;
+// Weight of the latest inter-arrival period in the moving average of the period
+const double ARRIVAL_PERIOD_AVERAGING_WEIGHT = 0.1;
+
+//----------------------------------------------------------------------------
+vtkPlusVirtualSwitcher::InputActivity::InputActivity()
+: LastArrivalTime(0)
+, MeanArrivalPeriodSec(0)
+, NumberOfArrivals(0)
+{
+}
 
 //----------------------------------------------------------------------------
 vtkPlusVirtualSwitcher::vtkPlusVirtualSwitcher()
 : vtkPlusDevice()
 , CurrentActiveInputChannel(NULL)
 , OutputChannel(NULL)
-, FramesWhileInactive(0)
+, InactivityPeriodFactor(3.0)
+, ItemAddedCallback(vtkSmartPointer<vtkCallbackCommand>::New())
+, SwitchMutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
+, NumberOfSwitches(0)
+, LastSwitchTime(0)
+, LastSwitchLatencySec(0)
 {
-  // The data capture thread will be used to regularly check the input devices and generate and update the output
+  this->ItemAddedCallback->SetCallback(vtkPlusVirtualSwitcher::OnItemAdded);
+  this->ItemAddedCallback->SetClientData(this);
+
+  // The data capture thread will be used to regularly check whether the active input became inactive
   this->StartThreadForInternalUpdates=true;
   this->AcquisitionRate = vtkPlusDevice::VIRTUAL_DEVICE_FRAME_RATE;
 }
@@ -30,6 +52,7 @@ vtkPlusVirtualSwitcher::vtkPlusVirtualSwitcher()
 //----------------------------------------------------------------------------
 vtkPlusVirtualSwitcher::~vtkPlusVirtualSwitcher()
 {
+  this->RemoveInputDataSourceObservers();
 }
 
 //----------------------------------------------------------------------------
@@ -48,6 +71,10 @@ void vtkPlusVirtualSwitcher::PrintSelf(ostream& os, vtkIndent indent)
   {
     this->CurrentActiveInputChannel->PrintSelf(os, indent);
   }
+
+  os << indent << "InactivityPeriodFactor: " << this->InactivityPeriodFactor << "\n";
+  os << indent << "NumberOfSwitches: " << this->NumberOfSwitches << "\n";
+  os << indent << "LastSwitchLatencySec: " << this->LastSwitchLatencySec << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -66,92 +93,232 @@ PlusStatus vtkPlusVirtualSwitcher::GetChannel(vtkPlusChannel* &aChannel) const
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualSwitcher::InternalUpdate()
 {
-  // if this device runs faster than input device, we might falsely detect that the device is not active because the latest timestamp hasn't changed
-  //    correctly detect this situation and wait a few frames before switching
-      // if timestamp not changed within 'FRAME_COUNT_BEFORE_INACTIVE' frames, then do new stream check
+  // Switching is normally triggered by the arrival of new items (see InputItemAdded).
+  // Here we only handle the case when the active input became inactive after the other inputs had received their latest items.
+  return this->SelectActiveChannel();
+}
 
-  double latestCurrentTimestamp(0);
-  if( this->CurrentActiveInputChannel != NULL )
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualSwitcher::SelectActiveChannel()
+{
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> switchGuard(this->SwitchMutex);
+
+  double currentTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  if( this->CurrentActiveInputChannel != NULL && !this->IsInputInactive(this->CurrentActiveInputChannel, currentTime) )
   {
-    if( this->CurrentActiveInputChannel->GetLatestTimestamp(latestCurrentTimestamp) != PLUS_SUCCESS )
+    // Active input is still active
+    return PLUS_SUCCESS;
+  }
+
+  // Choose the active input that received the latest item
+  vtkPlusChannel* latestActiveChannel = NULL;
+  double latestArrivalTime = 0;
+  for( ChannelContainerConstIterator it = this->InputChannels.begin(); it != this->InputChannels.end(); ++it )
+  {
+    vtkPlusChannel* aChannel = (*it);
+    if( aChannel == this->CurrentActiveInputChannel || this->IsInputInactive(aChannel, currentTime) )
     {
-      LOG_ERROR("Unable to retrieve timestamp from active stream.");
-      return PLUS_FAIL;
+      continue;
     }
-    if( this->LastRecordedTimestampMap[this->CurrentActiveInputChannel] == 0 )
+    const InputActivity& activity = this->InputActivities[aChannel];
+    if( activity.LastArrivalTime > latestArrivalTime )
     {
-      this->LastRecordedTimestampMap[this->CurrentActiveInputChannel] = latestCurrentTimestamp;
-      return PLUS_SUCCESS;
+      latestArrivalTime = activity.LastArrivalTime;
+      latestActiveChannel = aChannel;
     }
+  }
 
-    if( latestCurrentTimestamp > this->LastRecordedTimestampMap[this->CurrentActiveInputChannel] )
+  if( latestActiveChannel == NULL )
+  {
+    // No other active input, keep the output unchanged
+    return PLUS_SUCCESS;
+  }
+
+  // The switch could have been done when the active input exceeded its inactivity period
+  double switchRequestTime = latestArrivalTime;
+  if( this->CurrentActiveInputChannel != NULL )
+  {
+    switchRequestTime = std::max(switchRequestTime, this->GetInactivityStartTime(this->CurrentActiveInputChannel));
+  }
+  this->SwitchToInputChannel(latestActiveChannel, switchRequestTime);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualSwitcher::OnItemAdded(vtkObject* caller, unsigned long vtkNotUsed(eventId), void* clientData, void* vtkNotUsed(callData))
+{
+  vtkPlusVirtualSwitcher* self = static_cast<vtkPlusVirtualSwitcher*>(clientData);
+  // Items are added on the threads of the input devices, while the observed data sources may be changed by NotifyConfigured
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> switchGuard(self->SwitchMutex);
+  for( std::vector<ObservedDataSource>::iterator it = self->ObservedDataSources.begin(); it != self->ObservedDataSources.end(); ++it )
+  {
+    if( it->DataSource == caller )
+    {
+      self->InputItemAdded(it->InputChannel);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualSwitcher::InputItemAdded(vtkPlusChannel* inputChannel)
+{
+  double currentTime = vtkIGSIOAccurateTimer::GetSystemTime();
+
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> switchGuard(this->SwitchMutex);
+
+  bool wasInactive = this->IsInputInactive(inputChannel, currentTime);
+  InputActivity& activity = this->InputActivities[inputChannel];
+  // If the input was inactive then the gap since the previous item is not part of the regular arrival period
+  if( !wasInactive )
+  {
+    double periodSec = currentTime - activity.LastArrivalTime;
+    if( activity.MeanArrivalPeriodSec <= 0 )
     {
-      // Device is still active
-      return PLUS_SUCCESS;
+      activity.MeanArrivalPeriodSec = periodSec;
     }
     else
     {
-      if( FramesWhileInactive >= FRAME_COUNT_BEFORE_INACTIVE )
-      {
-        this->FramesWhileInactive = 0;
-        // Device is no longer active
-        if( this->SelectActiveChannel() == PLUS_FAIL )
-        {
-          // No active devices, don't copy anything!
-          return PLUS_SUCCESS;
-        }
-      }
-      else
-      {
-        FramesWhileInactive++;
-      }
+      activity.MeanArrivalPeriodSec += ARRIVAL_PERIOD_AVERAGING_WEIGHT * (periodSec - activity.MeanArrivalPeriodSec);
     }
+  }
+  activity.LastArrivalTime = currentTime;
+  activity.NumberOfArrivals++;
 
-    this->CopyInputChannelToOutputChannel();
+  if( inputChannel == this->CurrentActiveInputChannel )
+  {
+    return;
   }
+  if( this->CurrentActiveInputChannel == NULL || this->IsInputInactive(this->CurrentActiveInputChannel, currentTime) )
+  {
+    // This is the first item of the input since the active input exceeded its inactivity period, as earlier items would have triggered the switch
+    this->SwitchToInputChannel(inputChannel, currentTime);
+  }
+}
 
-  return PLUS_SUCCESS;
+//----------------------------------------------------------------------------
+bool vtkPlusVirtualSwitcher::IsInputInactive(vtkPlusChannel* inputChannel, double currentTime)
+{
+  const InputActivity& activity = this->InputActivities[inputChannel];
+  if( activity.NumberOfArrivals == 0 )
+  {
+    return true;
+  }
+  return currentTime > this->GetInactivityStartTime(inputChannel);
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusVirtualSwitcher::SelectActiveChannel()
+double vtkPlusVirtualSwitcher::GetInactivityStartTime(vtkPlusChannel* inputChannel)
 {
-  std::vector<vtkPlusChannel*> ActiveChannels;
+  const InputActivity& activity = this->InputActivities[inputChannel];
+  return activity.LastArrivalTime + this->InactivityPeriodFactor * this->GetExpectedArrivalPeriodSec(inputChannel);
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusVirtualSwitcher::GetExpectedArrivalPeriodSec(vtkPlusChannel* inputChannel)
+{
+  const InputActivity& activity = this->InputActivities[inputChannel];
+  if( activity.MeanArrivalPeriodSec > 0 )
+  {
+    return activity.MeanArrivalPeriodSec;
+  }
+  // No measured period yet, use the nominal acquisition rate of the input device
+  double acquisitionRate = 0;
+  if( inputChannel->GetOwnerDevice() != NULL )
+  {
+    acquisitionRate = inputChannel->GetOwnerDevice()->GetAcquisitionRate();
+  }
+  if( acquisitionRate <= 0 )
+  {
+    acquisitionRate = vtkPlusDevice::VIRTUAL_DEVICE_FRAME_RATE;
+  }
+  return 1.0 / acquisitionRate;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualSwitcher::SwitchToInputChannel(vtkPlusChannel* inputChannel, double switchRequestTime)
+{
+  this->SetCurrentActiveInputChannel(inputChannel);
+  this->CopyInputChannelToOutputChannel();
+
+  this->NumberOfSwitches++;
+  this->LastSwitchTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  this->LastSwitchLatencySec = this->LastSwitchTime - switchRequestTime;
+  LOG_DEBUG("Switched to input channel " << inputChannel->GetChannelId() << " (latency: " << this->LastSwitchLatencySec * 1000.0 << " ms)");
+
+  // We will also now need to output the correct transform associated with the new stream
+  // Is there any way to make this generic?
+  // In config file, associate transform/image names to special prefix/postfixes?
+  // scan stream name, if postfix matches, output transform(s) with that postfix? eg stream id -- Output_depth:5cm, transform -- ImageToProbeTransform_5cm, etc...
+  //                                        have base transform name(s) in the config eg: ImageToProbeTransform
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusVirtualSwitcher::GetNumberOfSwitches()
+{
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> switchGuard(this->SwitchMutex);
+  return this->NumberOfSwitches;
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusVirtualSwitcher::GetLastSwitchTime()
+{
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> switchGuard(this->SwitchMutex);
+  return this->LastSwitchTime;
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusVirtualSwitcher::GetLastSwitchLatencySec()
+{
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> switchGuard(this->SwitchMutex);
+  return this->LastSwitchLatencySec;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualSwitcher::ObserveInputDataSources()
+{
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> switchGuard(this->SwitchMutex);
+  this->RemoveInputDataSourceObservers();
 
   for( ChannelContainerConstIterator it = this->InputChannels.begin(); it != this->InputChannels.end(); ++it )
   {
     vtkPlusChannel* aChannel = (*it);
-    double latestTimestamp(0);
-    if( aChannel->GetLatestTimestamp(latestTimestamp) != PLUS_SUCCESS )
+    // Arrival of the main data of the channel is tracked: video if available, otherwise the first tool or field data source
+    vtkPlusDataSource* aSource = NULL;
+    if( aChannel->HasVideoSource() )
     {
-      LOG_ERROR("Unable to retrieve latest timestamp from stream.");
-      continue;
+      aChannel->GetVideoSource(aSource);
+    }
+    else if( aChannel->ToolCount() > 0 )
+    {
+      aSource = aChannel->GetToolsStartIterator()->second;
     }
-    if( latestTimestamp > this->LastRecordedTimestampMap[aChannel] )
+    else if( aChannel->FieldCount() > 0 )
     {
-      // It's got new data... it's active
-      this->LastRecordedTimestampMap[aChannel] = latestTimestamp;
-      ActiveChannels.push_back(aChannel);
+      aSource = aChannel->GetFieldDataSourcesStartIterator()->second;
+    }
+    if( aSource == NULL )
+    {
+      LOG_WARNING("Input channel " << aChannel->GetChannelId() << " of switcher " << this->GetDeviceId() << " has no data sources. It will never be activated.");
+      continue;
     }
+
+    ObservedDataSource observed;
+    observed.DataSource = aSource;
+    observed.InputChannel = aChannel;
+    observed.ObserverTag = aSource->AddObserver(vtkPlusDataSource::ItemAddedEvent, this->ItemAddedCallback);
+    this->ObservedDataSources.push_back(observed);
   }
+}
 
-  if( ActiveChannels.size() > 0 )
+//----------------------------------------------------------------------------
+void vtkPlusVirtualSwitcher::RemoveInputDataSourceObservers()
+{
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> switchGuard(this->SwitchMutex);
+  for( std::vector<ObservedDataSource>::iterator it = this->ObservedDataSources.begin(); it != this->ObservedDataSources.end(); ++it )
   {
-    // For now, just choose the first... maybe in the future make it more elegant
-    this->SetCurrentActiveInputChannel(ActiveChannels[0]);
-    this->CopyInputChannelToOutputChannel();
-
-    // We will also now need to output the correct transform associated with the new stream
-    // Is there any way to make this generic?
-    // In config file, associate transform/image names to special prefix/postfixes?
-    // scan stream name, if postfix matches, output transform(s) with that postfix? eg stream id -- Output_depth:5cm, transform -- ImageToProbeTransform_5cm, etc...
-    //                                        have base transform name(s) in the config eg: ImageToProbeTransform
-
-    return PLUS_SUCCESS;
+    it->DataSource->RemoveObserver(it->ObserverTag);
   }
- 
-  this->SetCurrentActiveInputChannel(NULL);
-  return PLUS_FAIL;
+  this->ObservedDataSources.clear();
 }
 
 //----------------------------------------------------------------------------
@@ -171,6 +338,8 @@ PlusStatus vtkPlusVirtualSwitcher::ReadConfiguration( vtkXMLDataElement* rootCon
 {
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_READING(deviceConfig, rootConfigElement);
 
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, InactivityPeriodFactor, deviceConfig);
+
   if( this->OutputChannels.empty() )
   {
     LOG_ERROR("No output channels defined" );
@@ -186,14 +355,31 @@ PlusStatus vtkPlusVirtualSwitcher::ReadConfiguration( vtkXMLDataElement* rootCon
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualSwitcher::NotifyConfigured()
 {
-  this->LastRecordedTimestampMap.clear();
+  if( this->OutputChannel == NULL )
+  {
+    if( this->OutputChannels.empty() )
+    {
+      LOG_ERROR("No output channels defined for switcher " << this->GetDeviceId());
+      return PLUS_FAIL;
+    }
+    this->SetOutputChannel(this->OutputChannels[0]);
+  }
 
-  for( ChannelContainerConstIterator it = this->InputChannels.begin(); it != this->InputChannels.end(); ++it )
   {
-    vtkPlusChannel* aChannel = (*it);
-    this->LastRecordedTimestampMap[aChannel] = 0;
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> switchGuard(this->SwitchMutex);
+    this->InputActivities.clear();
+    for( ChannelContainerConstIterator it = this->InputChannels.begin(); it != this->InputChannels.end(); ++it )
+    {
+      this->InputActivities[*it] = InputActivity();
+    }
+    this->SetCurrentActiveInputChannel(NULL);
+    this->NumberOfSwitches = 0;
+    this->LastSwitchTime = 0;
+    this->LastSwitchLatencySec = 0;
   }
 
+  this->ObserveInputDataSources();
+
   return PLUS_SUCCESS;
 }
 
@@ -201,11 +387,11 @@ PlusStatus vtkPlusVirtualSwitcher::NotifyConfigured()
 PlusStatus vtkPlusVirtualSwitcher::CopyInputChannelToOutputChannel()
 {
   // Only destroy if things have to change
-  if( this->CurrentActiveInputChannel != NULL )
+  if( this->CurrentActiveInputChannel != NULL && this->OutputChannel != NULL )
   {
     // no need to do a deep copy, iterators are used to access data anyways
     this->OutputChannel->ShallowCopy(*this->CurrentActiveInputChannel);
   }
 
   return PLUS_SUCCESS;
-}
\ No newline at end of file
+}
@@ -12,9 +12,21 @@ See License.txt for details.
 #include "vtkPlusDevice.h"
 #include "vtkPlusChannel.h"
 
+#include <vtkSmartPointer.h>
+
+class vtkCallbackCommand;
+class vtkIGSIORecursiveCriticalSection;
+class vtkPlusDataSource;
+
 /*!
 \class vtkPlusVirtualSwitcher
-\brief 
+\brief Virtual device that forwards the data of the currently active input channel to its output channel
+
+The data sources of the input channels notify the switcher when a new item is added (vtkPlusDataSource::ItemAddedEvent),
+so the switcher keeps track of the mean inter-arrival period of each input.
+The active input becomes inactive if no new item arrived for InactivityPeriodFactor times its mean period.
+The switcher changes to another input as soon as a new item arrives in it while the active input is inactive.
+The internal update thread only checks for inputs that became inactive without any other input producing new items since then.
 
 \ingroup PlusLibDataCollection
 */
@@ -42,13 +54,69 @@ public:
   virtual bool IsTracker() const { return false; }
   virtual bool IsVirtual() const { return true; }
 
+  /*! The active input is considered inactive if no new item arrived for InactivityPeriodFactor times its mean inter-arrival period */
+  vtkSetMacro(InactivityPeriodFactor, double);
+  vtkGetMacro(InactivityPeriodFactor, double);
+
+  /*! Number of times the active input channel has been changed since the switcher was configured */
+  int GetNumberOfSwitches();
+
+  /*! System time of the last change of the active input channel */
+  double GetLastSwitchTime();
+
+  /*!
+    Time elapsed between the moment the last switch became possible and the change of the active input channel (in seconds).
+    The switch becomes possible when the active input exceeds its inactivity period, or when the first item of the new input
+    arrives after that.
+  */
+  double GetLastSwitchLatencySec();
+
 protected:
+  /*! Arrival statistics of an input channel */
+  struct InputActivity
+  {
+    InputActivity();
+    /*! System time of the arrival of the latest item */
+    double LastArrivalTime;
+    /*! Exponential moving average of the inter-arrival period while the input is active */
+    double MeanArrivalPeriodSec;
+    unsigned long NumberOfArrivals;
+  };
+
   virtual PlusStatus InternalUpdate();
 
+  /*! Activate the input that received the latest item if the active input is inactive */
   PlusStatus SelectActiveChannel();
 
   PlusStatus CopyInputChannelToOutputChannel();
 
+  /*! Called when a new item is added to a data source of an input channel */
+  static void OnItemAdded(vtkObject* caller, unsigned long eventId, void* clientData, void* callData);
+
+  /*! Update the arrival statistics of the input and switch to it if the active input is inactive */
+  void InputItemAdded(vtkPlusChannel* inputChannel);
+
+  /*! Returns true if no item arrived in the input for longer than the inactivity period. Must be called with SwitchMutex locked. */
+  bool IsInputInactive(vtkPlusChannel* inputChannel, double currentTime);
+
+  /*! System time when the input becomes inactive if no new item arrives. Must be called with SwitchMutex locked. */
+  double GetInactivityStartTime(vtkPlusChannel* inputChannel);
+
+  /*! Expected period between items of the input. Must be called with SwitchMutex locked. */
+  double GetExpectedArrivalPeriodSec(vtkPlusChannel* inputChannel);
+
+  /*!
+    Make the input the active channel. The switch latency is measured from switchRequestTime, when the switch became possible.
+    Must be called with SwitchMutex locked.
+  */
+  void SwitchToInputChannel(vtkPlusChannel* inputChannel, double switchRequestTime);
+
+  /*! Add observers to the data sources of the input channels */
+  void ObserveInputDataSources();
+
+  /*! Remove observers from the data sources of the input channels */
+  void RemoveInputDataSourceObservers();
+
   vtkPlusVirtualSwitcher();
   virtual ~vtkPlusVirtualSwitcher();
 
@@ -58,10 +126,30 @@ protected:
   vtkSetObjectMacro(OutputChannel, vtkPlusChannel);
 
   vtkPlusChannel*                    CurrentActiveInputChannel;
-  std::map<vtkPlusChannel*, double>  LastRecordedTimestampMap;
   vtkPlusChannel*                    OutputChannel;
 
-  unsigned long FramesWhileInactive;
+  double InactivityPeriodFactor;
+
+  /*! Arrival statistics of each input channel, guarded by SwitchMutex */
+  std::map<vtkPlusChannel*, InputActivity> InputActivities;
+
+  /*! Observed data source and the input channel it belongs to, and the observer tag. Guarded by SwitchMutex. */
+  struct ObservedDataSource
+  {
+    vtkPlusDataSource* DataSource;
+    vtkPlusChannel* InputChannel;
+    unsigned long ObserverTag;
+  };
+  std::vector<ObservedDataSource> ObservedDataSources;
+
+  vtkSmartPointer<vtkCallbackCommand> ItemAddedCallback;
+
+  /*! Mutex for the arrival statistics and the active input channel, items may be added from multiple threads */
+  vtkSmartPointer<vtkIGSIORecursiveCriticalSection> SwitchMutex;
+
+  int NumberOfSwitches;
+  double LastSwitchTime;
+  double LastSwitchLatencySec;
 
 private:
   vtkPlusVirtualSwitcher(const vtkPlusVirtualSwitcher&);
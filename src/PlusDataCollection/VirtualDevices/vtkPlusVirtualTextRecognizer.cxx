@@ -11,8 +11,11 @@ See License.txt for details.
 #include "vtkObjectFactory.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
-#include "vtkIGSIOTrackedFrameList.h"
 #include "vtkPlusVirtualTextRecognizer.h"
+#include "vtkPointData.h"
+
+// STL includes
+#include <atomic>
 
 // Tesseract includes
 #include <tesseract/baseapi.h>
@@ -39,13 +42,42 @@ namespace
   static const int PARAMETER_DEPTH_BITS = 8;
   static const char* DEFAULT_LANGUAGE = "eng";
   static const int TEXT_RECOGNIZER_MISSING_INPUT_DEFAULT = 1;
+
+  //----------------------------------------------------------------------------
+  /// FNV-1a hash of the image scalars, used for detecting changes in the screen regions
+  vtkTypeUInt64 ComputeImageHash(vtkImageData* image)
+  {
+    vtkTypeUInt64 hash = 14695981039346656037ULL;
+    vtkDataArray* scalars = image->GetPointData()->GetScalars();
+    if (scalars == NULL)
+    {
+      return hash;
+    }
+    const unsigned char* data = static_cast<const unsigned char*>(scalars->GetVoidPointer(0));
+    const vtkIdType numberOfBytes = scalars->GetDataSize() * scalars->GetDataTypeSize();
+    for (vtkIdType i = 0; i < numberOfBytes; ++i)
+    {
+      hash = (hash ^ data[i]) * 1099511628211ULL;
+    }
+    return hash;
+  }
 }
 
+//----------------------------------------------------------------------------
+struct vtkPlusVirtualTextRecognizer::RecognitionJob
+{
+  vtkPlusVirtualTextRecognizer* Self;
+  FieldList* Fields;
+  std::atomic<int> NextFieldIndex;
+};
+
 //----------------------------------------------------------------------------
 vtkPlusVirtualTextRecognizer::vtkPlusVirtualTextRecognizer()
   : vtkPlusDevice()
   , Language()
-  , TrackedFrames(vtkIGSIOTrackedFrameList::New())
+  , NumberOfRecognitionThreads(0)
+  , NumberOfRecognitions(0)
+  , Threader(vtkSmartPointer<vtkMultiThreader>::New())
   , OutputChannel(NULL)
 {
   // The data capture thread will be used to regularly check the input devices and generate and update the output
@@ -71,14 +103,13 @@ void vtkPlusVirtualTextRecognizer::ClearConfiguration()
 //----------------------------------------------------------------------------
 vtkPlusVirtualTextRecognizer::~vtkPlusVirtualTextRecognizer()
 {
-  TrackedFrames->Delete();
-  TrackedFrames = NULL;
 }
 
 //----------------------------------------------------------------------------
 void vtkPlusVirtualTextRecognizer::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfRecognitionThreads: " << this->NumberOfRecognitionThreads << std::endl;
 }
 
 #ifdef PLUS_TEST_TextRecognizer
@@ -87,47 +118,41 @@ vtkPlusVirtualTextRecognizer::ChannelFieldListMap& vtkPlusVirtualTextRecognizer:
 {
   return this->RecognitionFields;
 }
+
+//----------------------------------------------------------------------------
+int vtkPlusVirtualTextRecognizer::GetNumberOfRecognitions() const
+{
+  return this->NumberOfRecognitions;
+}
 #endif
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualTextRecognizer::InternalUpdate()
 {
-  std::map<double, int> queriedFramesIndexes;
-  std::vector<igsioTrackedFrame*> queriedFrames;
-
   if (!this->HasGracePeriodExpired())
   {
     return PLUS_SUCCESS;
   }
 
+  // Text is recognized again only in those fields where the screen region has changed
+  FieldList changedFields;
   for (ChannelFieldListMapIterator it = this->RecognitionFields.begin(); it != this->RecognitionFields.end(); ++it)
   {
     for (FieldListIterator fieldIt = it->second.begin(); fieldIt != it->second.end(); ++fieldIt)
     {
-      TextFieldParameter* parameter = *fieldIt;
-      igsioTrackedFrame frame;
-
-      // Attempt to find the frame already retrieved
-      PlusStatus result = FindOrQueryFrame(frame, queriedFramesIndexes, parameter, queriedFrames);
-
-      if (result != PLUS_SUCCESS || frame.GetImageData()->GetImage() == NULL)
+      bool regionChanged(false);
+      if (this->UpdateScreenRegion(*fieldIt, regionChanged) == PLUS_SUCCESS && regionChanged)
       {
-        continue;
+        changedFields.push_back(*fieldIt);
       }
-
-      // We have a frame, let's parse it
-      vtkImageDataToPix(frame, parameter);
-
-      this->TesseractAPI->SetImage(parameter->ReceivedFrame);
-      char* text_out = this->TesseractAPI->GetUTF8Text();
-      std::string textStr(text_out);
-      parameter->LatestParameterValue = igsioCommon::Trim(textStr);
-      delete [] text_out;
-
-      frame.SetFrameField(parameter->ParameterName, parameter->LatestParameterValue);
     }
   }
 
+  if (!changedFields.empty())
+  {
+    this->RecognizeFields(changedFields);
+  }
+
   // Build the field map to send to the data sources
   igsioFieldMapType fieldMap;
   for (ChannelFieldListMapIterator it = this->RecognitionFields.begin(); it != this->RecognitionFields.end(); ++it)
@@ -149,84 +174,124 @@ PlusStatus vtkPlusVirtualTextRecognizer::InternalUpdate()
 }
 
 //----------------------------------------------------------------------------
-void vtkPlusVirtualTextRecognizer::vtkImageDataToPix(igsioTrackedFrame& frame, TextFieldParameter* parameter)
+PlusStatus vtkPlusVirtualTextRecognizer::UpdateScreenRegion(TextFieldParameter* parameter, bool& regionChanged)
 {
-  igsioVideoFrame::GetOrientedClippedImage(frame.GetImageData()->GetImage(),
-      igsioVideoFrame::FlipInfoType(),
-      frame.GetImageData()->GetImageType(),
-      parameter->ScreenRegion,
-      parameter->Origin,
-      parameter->Size);
-
-  unsigned int* data = pixGetData(parameter->ReceivedFrame);
-  int wpl = pixGetWpl(parameter->ReceivedFrame);
-  int bpl = ((8 * parameter->Size[0]) + 7) / 8;
-  unsigned int* line;
-  unsigned char val8;
+  regionChanged = false;
 
-  int extents[6];
-  parameter->ScreenRegion->GetExtent(extents);
-  int ySize = extents[3] - extents[2];
+  if (!parameter->SourceChannel->GetVideoDataAvailable())
+  {
+    LOG_WARNING("Processed data is not generated, as no video data is available yet. Device ID: " << this->GetDeviceId());
+    return PLUS_FAIL;
+  }
 
-  int coords[3] = {0, 0, 0};
-  for (int y = 0; y < ySize; y++)
+  vtkPlusDataSource* videoSource(NULL);
+  if (parameter->SourceChannel->GetVideoSource(videoSource) != PLUS_SUCCESS)
   {
-    coords[1] = ySize - y - 1 + extents[2];
-    line = data + y * wpl;
-    for (int x = 0; x < bpl; x++)
-    {
-      coords[0] = x + extents[0];
-      val8 = (*(unsigned char*)parameter->ScreenRegion->GetScalarPointer(coords));
-      SET_DATA_BYTE(line, x, val8);
-    }
+    LOG_ERROR("Unable to retrieve video source for parameter " << parameter->ParameterName);
+    return PLUS_FAIL;
   }
-}
 
-//----------------------------------------------------------------------------
-PlusStatus vtkPlusVirtualTextRecognizer::FindOrQueryFrame(igsioTrackedFrame& frame, std::map<double, int>& QueriedFramesIndexes, TextFieldParameter* parameter, std::vector<igsioTrackedFrame*>& QueriedFrames)
-{
-  double mostRecent(-1);
+  BufferItemUidType latestFrameUid = videoSource->GetLatestItemUidInBuffer();
+  if (parameter->RegionHashValid && latestFrameUid == parameter->LatestFrameUid)
+  {
+    // No new frame since the last update
+    return PLUS_SUCCESS;
+  }
 
-  if (!parameter->SourceChannel->GetVideoDataAvailable())
+  // Only the screen region is copied from the buffer, not the full frame
+  if (videoSource->GetStreamBufferItemImageRegion(latestFrameUid, parameter->Origin, parameter->Size, parameter->ScreenRegion) != ITEM_OK)
   {
-    LOG_WARNING("Processed data is not generated, as no video data is available yet. Device ID: " << this->GetDeviceId());
+    LOG_INFO("Failed to get screen region of parameter " << parameter->ParameterName << " from the video buffer.");
     return PLUS_FAIL;
   }
+  parameter->LatestFrameUid = latestFrameUid;
 
-  if (parameter->SourceChannel->GetMostRecentTimestamp(mostRecent) != PLUS_SUCCESS)
+  vtkTypeUInt64 regionHash = ComputeImageHash(parameter->ScreenRegion);
+  if (parameter->RegionHashValid && regionHash == parameter->RegionHash)
   {
-    LOG_ERROR("Unable to retrieve most recent timestamp for parameter " << parameter->ParameterName);
-    return PLUS_FAIL;
+    // Same pixels as at the last recognition, the recognized text would be the same
+    return PLUS_SUCCESS;
   }
+  parameter->RegionHash = regionHash;
+  parameter->RegionHashValid = true;
+  regionChanged = true;
 
-  // Search the retrieved frames to see is this timestamp has already been pulled
-  std::map<double, int>::iterator frameIt = QueriedFramesIndexes.find(mostRecent);
+  return PLUS_SUCCESS;
+}
 
-  // If it hasn't, go get the latest
-  if (frameIt == QueriedFramesIndexes.end())
+//----------------------------------------------------------------------------
+void vtkPlusVirtualTextRecognizer::RecognizeFields(FieldList& fields)
+{
+  int numberOfThreads = std::min(static_cast<int>(fields.size()), static_cast<int>(this->TesseractAPIs.size()));
+  if (numberOfThreads <= 1)
   {
-    this->TrackedFrames->Clear();
-    double aTimestamp(UNDEFINED_TIMESTAMP);
-    if (parameter->SourceChannel->GetTrackedFrameList(aTimestamp, this->TrackedFrames, 1) != PLUS_SUCCESS)
+    for (FieldListIterator fieldIt = fields.begin(); fieldIt != fields.end(); ++fieldIt)
     {
-      LOG_INFO("Failed to get tracked frame list from data collector.");
-      return PLUS_FAIL;
+      this->RecognizeField(this->TesseractAPIs[0], *fieldIt);
     }
-    double timestamp = TrackedFrames->GetTrackedFrame(0)->GetTimestamp();
+    return;
+  }
 
-    // Copy the frame so it isn't lost when the tracked frame list is cleared
-    frame = (*TrackedFrames->GetTrackedFrame(0));
+  RecognitionJob job;
+  job.Self = this;
+  job.Fields = &fields;
+  job.NextFieldIndex = 0;
+  this->Threader->SetNumberOfThreads(numberOfThreads);
+  this->Threader->SetSingleMethod((vtkThreadFunctionType)&RecognizeFieldsThread, &job);
+  this->Threader->SingleMethodExecute();
+}
 
-    // Record the index of this timestamp
-    QueriedFramesIndexes[timestamp] = QueriedFrames.size();
-    QueriedFrames.push_back(&frame);
-  }
-  else
+//----------------------------------------------------------------------------
+void* vtkPlusVirtualTextRecognizer::RecognizeFieldsThread(vtkMultiThreader::ThreadInfo* data)
+{
+  RecognitionJob* job = static_cast<RecognitionJob*>(data->UserData);
+  tesseract::TessBaseAPI* tesseractAPI = job->Self->TesseractAPIs[data->ThreadID];
+  const int numberOfFields = static_cast<int>(job->Fields->size());
+  for (int fieldIndex = job->NextFieldIndex++; fieldIndex < numberOfFields; fieldIndex = job->NextFieldIndex++)
   {
-    frame = (*QueriedFrames[frameIt->second]);
+    job->Self->RecognizeField(tesseractAPI, (*job->Fields)[fieldIndex]);
   }
+  return NULL;
+}
 
-  return PLUS_SUCCESS;
+//----------------------------------------------------------------------------
+void vtkPlusVirtualTextRecognizer::RecognizeField(tesseract::TessBaseAPI* tesseractAPI, TextFieldParameter* parameter)
+{
+  this->vtkImageDataToPix(parameter);
+
+  tesseractAPI->SetImage(parameter->ReceivedFrame);
+  char* text_out = tesseractAPI->GetUTF8Text();
+  std::string textStr(text_out);
+  parameter->LatestParameterValue = igsioCommon::Trim(textStr);
+  delete [] text_out;
+  this->NumberOfRecognitions++;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualTextRecognizer::vtkImageDataToPix(TextFieldParameter* parameter)
+{
+  unsigned int* data = pixGetData(parameter->ReceivedFrame);
+  int wpl = pixGetWpl(parameter->ReceivedFrame);
+  int bpl = ((8 * parameter->Size[0]) + 7) / 8;
+  unsigned int* line;
+  unsigned char val8;
+
+  int extents[6];
+  parameter->ScreenRegion->GetExtent(extents);
+  int ySize = extents[3] - extents[2] + 1;
+  int numberOfScalarComponents = parameter->ScreenRegion->GetNumberOfScalarComponents();
+
+  for (int y = 0; y < ySize; y++)
+  {
+    // Image rows are stored bottom-up, pix rows top-down
+    unsigned char* regionRow = static_cast<unsigned char*>(parameter->ScreenRegion->GetScalarPointer(extents[0], ySize - y - 1 + extents[2], extents[4]));
+    line = data + y * wpl;
+    for (int x = 0; x < bpl; x++)
+    {
+      val8 = regionRow[x * numberOfScalarComponents];
+      SET_DATA_BYTE(line, x, val8);
+    }
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -245,13 +310,27 @@ PlusStatus vtkPlusVirtualTextRecognizer::InternalConnect()
   ss << "TESSDATA_PREFIX=" << this->TessdataDirectory;
   vtksys::SystemTools::PutEnv(ss.str());
 
-  this->TesseractAPI = new tesseract::TessBaseAPI();
-  if (this->TesseractAPI->Init(NULL, Language.c_str(), tesseract::OEM_TESSERACT_CUBE_COMBINED) != 0)
+  // One tesseract instance is needed for each recognition thread, as an instance can process one image at a time
+  int numberOfFields = 0;
+  for (ChannelFieldListMapIterator it = this->RecognitionFields.begin(); it != this->RecognitionFields.end(); ++it)
   {
-    LOG_ERROR("Unable to init tesseract library. Cannot perform text recognition.");
-    return PLUS_FAIL;
+    numberOfFields += static_cast<int>(it->second.size());
+  }
+  int numberOfTesseractInstances = (this->NumberOfRecognitionThreads > 0) ? this->NumberOfRecognitionThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  numberOfTesseractInstances = std::max(1, std::min(numberOfTesseractInstances, std::min(numberOfFields, static_cast<int>(VTK_MAX_THREADS))));
+  LOG_DEBUG("Using " << numberOfTesseractInstances << " text recognition threads");
+
+  for (int i = 0; i < numberOfTesseractInstances; ++i)
+  {
+    tesseract::TessBaseAPI* tesseractAPI = new tesseract::TessBaseAPI();
+    this->TesseractAPIs.push_back(tesseractAPI);
+    if (tesseractAPI->Init(NULL, Language.c_str(), tesseract::OEM_TESSERACT_CUBE_COMBINED) != 0)
+    {
+      LOG_ERROR("Unable to init tesseract library. Cannot perform text recognition.");
+      return PLUS_FAIL;
+    }
+    tesseractAPI->SetPageSegMode(tesseract::PSM_SINGLE_LINE);
   }
-  this->TesseractAPI->SetPageSegMode(tesseract::PSM_SINGLE_LINE);
 
   return PLUS_SUCCESS;
 }
@@ -259,8 +338,11 @@ PlusStatus vtkPlusVirtualTextRecognizer::InternalConnect()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusVirtualTextRecognizer::InternalDisconnect()
 {
-  delete this->TesseractAPI;
-  this->TesseractAPI = NULL;
+  for (std::vector<tesseract::TessBaseAPI*>::iterator it = this->TesseractAPIs.begin(); it != this->TesseractAPIs.end(); ++it)
+  {
+    delete *it;
+  }
+  this->TesseractAPIs.clear();
 
   ClearConfiguration();
 
@@ -290,6 +372,7 @@ PlusStatus vtkPlusVirtualTextRecognizer::ReadConfiguration(vtkXMLDataElement* ro
   this->SetLanguage(DEFAULT_LANGUAGE);
   XML_READ_CSTRING_ATTRIBUTE_OPTIONAL(Language, deviceConfig);
   XML_READ_STRING_ATTRIBUTE_OPTIONAL(TessdataDirectory, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfRecognitionThreads, deviceConfig);
 
   XML_FIND_NESTED_ELEMENT_OPTIONAL(screenFields, deviceConfig, PARAMETER_LIST_TAG_NAME);
  
@@ -354,6 +437,11 @@ PlusStatus vtkPlusVirtualTextRecognizer::WriteConfiguration(vtkXMLDataElement* r
     XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(Language, deviceConfig);
   }
 
+  if (this->NumberOfRecognitionThreads > 0)
+  {
+    deviceConfig->SetIntAttribute("NumberOfRecognitionThreads", this->NumberOfRecognitionThreads);
+  }
+
   XML_FIND_NESTED_ELEMENT_CREATE_IF_MISSING(screenFields, deviceConfig, PARAMETER_LIST_TAG_NAME);
 
   for (ChannelFieldListMapIterator it = this->RecognitionFields.begin(); it != this->RecognitionFields.end(); ++it)
@@ -12,6 +12,12 @@ See License.txt for details.
 #include "vtkPlusChannel.h"
 #include "vtkPlusDevice.h"
 
+// VTK includes
+#include <vtkMultiThreader.h>
+
+// STL includes
+#include <atomic>
+
 namespace tesseract
 {
   class TessBaseAPI;
@@ -21,7 +27,10 @@ typedef struct Pix PIX;
 
 /*!
 \class vtkPlusVirtualTextRecognizer
-\brief
+\brief Recognize text in screen regions of the input video and send it as field data
+
+The region of each field is cropped directly from the video buffer. Text recognition runs only for fields
+whose region pixels have changed since the last recognition, on a pool of tesseract instances in parallel.
 
 \ingroup PlusLibDataCollection
 */
@@ -34,6 +43,11 @@ public:
   {
   public:
     TextFieldParameter()
+      : ReceivedFrame(NULL)
+      , SourceChannel(NULL)
+      , LatestFrameUid(0)
+      , RegionHash(0)
+      , RegionHashValid(false)
     {
       this->Origin[0] = 0;
       this->Origin[1] = 0;
@@ -53,6 +67,12 @@ public:
     std::array<int, 3> Origin;
     /// This is only 3d for simplicity in passing to clipping function, OCR is 2d only
     std::array<int, 3> Size;
+    /// Uid of the frame that the screen region was last cropped from
+    BufferItemUidType LatestFrameUid;
+    /// Hash of the screen region pixels at the last recognition
+    vtkTypeUInt64 RegionHash;
+    /// True if RegionHash is computed
+    bool RegionHashValid;
   };
 
 public:
@@ -93,8 +113,14 @@ public:
   vtkSetStdStringMacro(TessdataDirectory);
   vtkGetStdStringMacro(TessdataDirectory);
 
+  /*! Number of threads (and tesseract instances) used for text recognition. If 0 then the number of threads is chosen automatically. */
+  vtkSetMacro(NumberOfRecognitionThreads, int);
+  vtkGetMacro(NumberOfRecognitionThreads, int);
+
 #ifdef PLUS_TEST_TextRecognizer
   ChannelFieldListMap& GetRecognitionFields();
+  /*! Number of text recognitions performed on fields, for checking that unchanged fields are not recognized again */
+  int GetNumberOfRecognitions() const;
 #endif
 
 protected:
@@ -103,22 +129,39 @@ protected:
   /// Remove any configuration data
   void ClearConfiguration();
 
-  /// Convert a vtkImage data to leptonica pix format
-  void vtkImageDataToPix(igsioTrackedFrame& frame, TextFieldParameter* parameter);
+  /// Crop the screen region of the field from the latest frame of its channel. regionChanged is set to true if the region pixels have changed since the last recognition.
+  PlusStatus UpdateScreenRegion(TextFieldParameter* parameter, bool& regionChanged);
+
+  /// Convert the screen region of the field to leptonica pix format
+  void vtkImageDataToPix(TextFieldParameter* parameter);
 
-  /// If a frame has been queried for this input channel, reuse it instead of getting a new one
-  PlusStatus FindOrQueryFrame(igsioTrackedFrame& frame, std::map<double, int>& queriedFramesIndexes, TextFieldParameter* parameter,
-                              std::vector<igsioTrackedFrame*>& queriedFrames);
+  /// Recognize the text in the screen region of the field
+  void RecognizeField(tesseract::TessBaseAPI* tesseractAPI, TextFieldParameter* parameter);
+
+  /// Recognize the text of multiple fields in parallel
+  void RecognizeFields(FieldList& fields);
+
+  struct RecognitionJob;
+
+  /// Thread function for recognizing fields, each thread uses its own tesseract instance
+  static void* RecognizeFieldsThread(vtkMultiThreader::ThreadInfo* data);
 
   /// Language used for detection
   std::string                 Language;
 
   std::string                 TessdataDirectory;
 
-  /// Main entry point for the tesseract API
-  tesseract::TessBaseAPI*     TesseractAPI;
+  /// Pool of tesseract API instances, one for each recognition thread
+  std::vector<tesseract::TessBaseAPI*> TesseractAPIs;
+
+  /// Requested number of recognition threads, 0 means automatic
+  int                         NumberOfRecognitionThreads;
+
+  /// Number of text recognitions performed on fields
+  std::atomic<int>            NumberOfRecognitions;
 
-  vtkIGSIOTrackedFrameList*    TrackedFrames;
+  /// Threader for running recognition of changed fields in parallel
+  vtkSmartPointer<vtkMultiThreader> Threader;
 
   /// Map of channels to fields so that we only have to grab an image once from the each source channel
   ChannelFieldListMap         RecognitionFields;
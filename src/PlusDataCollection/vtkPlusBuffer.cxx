@@ -26,6 +26,51 @@ See License.txt for details.
 #include <vtkStreamingVolumeCodec.h>
 
 static const double NEGLIGIBLE_TIME_DIFFERENCE = 0.00001; // in seconds, used for comparing between exact timestamps
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Copy every stride-th pixel of a row. The fixed pixel size lets the compiler vectorize the copy for the common 8-bit and RGB images.
+  template<int PixelSize>
+  void CopyStridedPixels(const unsigned char* inputPtr, unsigned char* outputPtr, int numberOfPixels, int stride)
+  {
+    const int inputPixelIncrement = PixelSize * stride;
+    for (int i = 0; i < numberOfPixels; ++i, inputPtr += inputPixelIncrement, outputPtr += PixelSize)
+    {
+      for (int c = 0; c < PixelSize; ++c)
+      {
+        outputPtr[c] = inputPtr[c];
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void CopyStridedPixels(const unsigned char* inputPtr, unsigned char* outputPtr, int numberOfPixels, int stride, int pixelSize)
+  {
+    if (stride == 1)
+    {
+      memcpy(outputPtr, inputPtr, numberOfPixels * pixelSize);
+      return;
+    }
+    switch (pixelSize)
+    {
+      case 1:
+        CopyStridedPixels<1>(inputPtr, outputPtr, numberOfPixels, stride);
+        break;
+      case 3:
+        CopyStridedPixels<3>(inputPtr, outputPtr, numberOfPixels, stride);
+        break;
+      case 4:
+        CopyStridedPixels<4>(inputPtr, outputPtr, numberOfPixels, stride);
+        break;
+      default:
+        for (int i = 0; i < numberOfPixels; ++i, inputPtr += pixelSize * stride, outputPtr += pixelSize)
+        {
+          memcpy(outputPtr, inputPtr, pixelSize);
+        }
+    }
+  }
+}
+
 static const double ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG = 10; // if the interpolated orientation differs from both the interpolated orientation by more than this threshold then display a warning
 
 vtkStandardNewMacro(vtkPlusBuffer);
@@ -73,6 +118,12 @@ vtkStandardNewMacro(vtkPlusBuffer);
   LOG_DEBUG(finalStr); \
 }
 
+//----------------------------------------------------------------------------
+// 150 is a reasonable default value, it means that we keep the last 5 secods of acquired data @30fps
+// (and last 2.5 seconds @60fps). It should be enough to have all the needed data available and
+// it does not consume too much memory, even for images.
+const int vtkPlusBuffer::DEFAULT_BUFFER_SIZE = 150;
+
 //----------------------------------------------------------------------------
 // vtkPlusBuffer
 //----------------------------------------------------------------------------
@@ -84,15 +135,13 @@ vtkPlusBuffer::vtkPlusBuffer()
   , StreamBuffer(vtkPlusTimestampedCircularBuffer::New())
   , MaxAllowedTimeDifference(0.5)
   , DescriptiveName(NULL)
+  , NumberOfDroppedItems(0)
 {
   this->FrameSize[0] = 0;
   this->FrameSize[1] = 0;
   this->FrameSize[2] = 1; // by default we assume we have a single-slice image
 
-  // 150 is a reasonable default value, it means that we keep the last 5 secods of acquired data @30fps
-  // (and last 2.5 seconds @60fps). It should be enough to have all the needed data available and
-  // it does not consume too much memory, even for images.
-  this->SetBufferSize(150);
+  this->SetBufferSize(DEFAULT_BUFFER_SIZE);
 }
 
 //----------------------------------------------------------------------------
@@ -341,6 +390,7 @@ PlusStatus vtkPlusBuffer::AddItem(const igsioFieldMapType& fields,
     if (!filteredTimestampProbablyValid)
     {
       LOG_INFO("Filtered timestamp is probably invalid for tracker buffer item with item index=" << frameNumber << ", time=" << unfilteredTimestamp << ". The item may have been tagged with an inaccurate timestamp, therefore it will not be recorded.");
+      this->NumberOfDroppedItems++;
       return PLUS_SUCCESS;
     }
   }
@@ -355,6 +405,7 @@ PlusStatus vtkPlusBuffer::AddItem(const igsioFieldMapType& fields,
   igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
   if (this->StreamBuffer->PrepareForNewItem(filteredTimestamp, itemUid, bufferIndex) != PLUS_SUCCESS)
   {
+    this->NumberOfDroppedItems++;
     // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
     LOCAL_LOG_DEBUG("vtkPlusBuffer: Failed to prepare for adding new frame to tracker buffer!");
     return PLUS_FAIL;
@@ -416,6 +467,7 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
     {
       LOG_INFO("Filtered timestamp is probably invalid for video buffer item with item index=" << frameNumber << ", time=" <<
                unfilteredTimestamp << ". The item may have been tagged with an inaccurate timestamp, therefore it will not be recorded.");
+      this->NumberOfDroppedItems++;
       return PLUS_SUCCESS;
     }
   }
@@ -466,6 +518,7 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
   igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
   if (this->StreamBuffer->PrepareForNewItem(filteredTimestamp, itemUid, bufferIndex) != PLUS_SUCCESS)
   {
+    this->NumberOfDroppedItems++;
     // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
     LOCAL_LOG_DEBUG("vtkPlusBuffer: Failed to prepare for adding new frame to video buffer!");
     return PLUS_FAIL;
@@ -554,6 +607,7 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, const FrameSizeType& frame
     {
       LOG_INFO("Filtered timestamp is probably invalid for video buffer item with item index=" << frameNumber << ", time=" <<
                unfilteredTimestamp << ". The item may have been tagged with an inaccurate timestamp, therefore it will not be recorded.");
+      this->NumberOfDroppedItems++;
       return PLUS_SUCCESS;
     }
   }
@@ -579,6 +633,7 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, const FrameSizeType& frame
   igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
   if (this->StreamBuffer->PrepareForNewItem(filteredTimestamp, itemUid, bufferIndex) != PLUS_SUCCESS)
   {
+    this->NumberOfDroppedItems++;
     // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
     LOCAL_LOG_DEBUG("vtkPlusBuffer: Failed to prepare for adding new frame to video buffer!");
     return PLUS_FAIL;
@@ -625,6 +680,128 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, const FrameSizeType& frame
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::AddStridedItem(vtkPlusBuffer* sourceBuffer, BufferItemUidType sourceUid, const std::array<int, 2>& firstPixel, const std::array<int, 2>& pixelStride, long frameNumber,
+                                        const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize)
+{
+  if (sourceBuffer == NULL || sourceBuffer == this)
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to add strided item, invalid source buffer!");
+    return PLUS_FAIL;
+  }
+  if (firstPixel[0] < 0 || firstPixel[1] < 0 || pixelStride[0] < 1 || pixelStride[1] < 1)
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to add strided item, invalid first pixel (" << firstPixel[0] << ", " << firstPixel[1]
+                    << ") or pixel stride (" << pixelStride[0] << ", " << pixelStride[1] << ")!");
+    return PLUS_FAIL;
+  }
+  if (sourceBuffer->GetPixelType() != this->GetPixelType()
+      || sourceBuffer->GetNumberOfScalarComponents() != this->GetNumberOfScalarComponents()
+      || sourceBuffer->GetImageOrientation() != this->GetImageOrientation())
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to add strided item, source buffer frame format doesn't match!");
+    return PLUS_FAIL;
+  }
+
+  // The source item must not be overwritten while its pixels are copied
+  igsioLockGuard<StreamItemCircularBuffer> sourceBufferGuardedLock(sourceBuffer->StreamBuffer);
+  StreamBufferItem* sourceItem = NULL;
+  if (sourceBuffer->StreamBuffer->GetBufferItemPointerFromUid(sourceUid, sourceItem) != ITEM_OK)
+  {
+    LOCAL_LOG_WARNING("Failed to retrieve source data item");
+    return PLUS_FAIL;
+  }
+  vtkImageData* sourceImage = sourceItem->GetFrame().GetImage();
+  if (sourceImage == NULL)
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to add strided item, source data item does not contain an image!");
+    return PLUS_FAIL;
+  }
+
+  double unfilteredTimestamp = sourceItem->GetUnfilteredTimestamp(sourceBuffer->GetLocalTimeOffsetSec());
+  double filteredTimestamp = sourceItem->GetFilteredTimestamp(sourceBuffer->GetLocalTimeOffsetSec());
+  this->StreamBuffer->AddToTimeStampReport(frameNumber, unfilteredTimestamp, filteredTimestamp);
+
+  int bufferIndex(0);
+  BufferItemUidType itemUid;
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  if (this->StreamBuffer->PrepareForNewItem(filteredTimestamp, itemUid, bufferIndex) != PLUS_SUCCESS)
+  {
+    this->NumberOfDroppedItems++;
+    // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
+    LOCAL_LOG_DEBUG("vtkPlusBuffer: Failed to prepare for adding new frame to video buffer!");
+    return PLUS_FAIL;
+  }
+
+  // get the pointer to the correct location in the frame buffer, where the pixels are written
+  StreamBufferItem* newObjectInBuffer = this->StreamBuffer->GetBufferItemPointerFromBufferIndex(bufferIndex);
+  if (newObjectInBuffer == NULL || newObjectInBuffer->GetFrame().GetImage() == NULL)
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get pointer to video buffer object from the video buffer for the new frame!");
+    return PLUS_FAIL;
+  }
+  vtkImageData* outputImage = newObjectInBuffer->GetFrame().GetImage();
+
+  int* inputDimensions = sourceImage->GetDimensions();
+  int* outputDimensions = outputImage->GetDimensions();
+  const int pixelSize = sourceImage->GetScalarSize() * sourceImage->GetNumberOfScalarComponents();
+  const vtkIdType inputRowIncrement = static_cast<vtkIdType>(inputDimensions[0]) * pixelSize;
+  const vtkIdType outputRowIncrement = static_cast<vtkIdType>(outputDimensions[0]) * pixelSize;
+
+  // The clip rectangle is applied to the strided image, the same way as AddItem applies it to the input frame
+  int stridedDimensions[3] =
+  {
+    std::max(0, (inputDimensions[0] - firstPixel[0] + pixelStride[0] - 1) / pixelStride[0]),
+    std::max(0, (inputDimensions[1] - firstPixel[1] + pixelStride[1] - 1) / pixelStride[1]),
+    inputDimensions[2]
+  };
+  int clipOrigin[3] = {0, 0, 0};
+  int clipSize[3] = {stridedDimensions[0], stridedDimensions[1], stridedDimensions[2]};
+  if (igsioCommon::IsClippingRequested(clipRectangleOrigin, clipRectangleSize))
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      clipOrigin[i] = std::min(std::max(0, clipRectangleOrigin[i]), stridedDimensions[i]);
+      clipSize[i] = std::min(std::max(0, clipRectangleSize[i]), stridedDimensions[i] - clipOrigin[i]);
+    }
+  }
+  const int numberOfPixelsPerRow = std::min(outputDimensions[0], clipSize[0]);
+  const int numberOfRows = std::min(outputDimensions[1], clipSize[1]);
+  const int numberOfSlices = std::min(outputDimensions[2], clipSize[2]);
+
+  const unsigned char* inputPtr = static_cast<const unsigned char*>(sourceImage->GetScalarPointer())
+                                  + static_cast<vtkIdType>(clipOrigin[2]) * inputRowIncrement * inputDimensions[1]
+                                  + static_cast<vtkIdType>(firstPixel[1] + clipOrigin[1] * pixelStride[1]) * inputRowIncrement
+                                  + static_cast<vtkIdType>(firstPixel[0] + clipOrigin[0] * pixelStride[0]) * pixelSize;
+  unsigned char* outputPtr = static_cast<unsigned char*>(outputImage->GetScalarPointer());
+  for (int z = 0; z < numberOfSlices; ++z)
+  {
+    const unsigned char* inputRowPtr = inputPtr + z * inputRowIncrement * inputDimensions[1];
+    unsigned char* outputRowPtr = outputPtr + z * outputRowIncrement * outputDimensions[1];
+    for (int row = 0; row < numberOfRows; ++row, inputRowPtr += pixelStride[1] * inputRowIncrement, outputRowPtr += outputRowIncrement)
+    {
+      CopyStridedPixels(inputRowPtr, outputRowPtr, numberOfPixelsPerRow, pixelStride[0], pixelSize);
+      if (numberOfPixelsPerRow < outputDimensions[0])
+      {
+        memset(outputRowPtr + numberOfPixelsPerRow * pixelSize, 0, (outputDimensions[0] - numberOfPixelsPerRow) * pixelSize);
+      }
+    }
+    if (numberOfRows < outputDimensions[1])
+    {
+      memset(outputRowPtr, 0, (outputDimensions[1] - numberOfRows) * outputRowIncrement);
+    }
+  }
+  outputImage->Modified();
+
+  newObjectInBuffer->SetFilteredTimestamp(filteredTimestamp);
+  newObjectInBuffer->SetUnfilteredTimestamp(unfilteredTimestamp);
+  newObjectInBuffer->SetIndex(frameNumber);
+  newObjectInBuffer->SetUid(itemUid);
+  newObjectInBuffer->GetFrame().SetImageType(sourceItem->GetFrame().GetImageType());
+
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp/*=UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
 {
@@ -648,6 +825,7 @@ PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus st
     if (!filteredTimestampProbablyValid)
     {
       LOG_INFO("Filtered timestamp is probably invalid for tracker buffer item with item index=" << frameNumber << ", time=" << unfilteredTimestamp << ". The item may have been tagged with an inaccurate timestamp, therefore it will not be recorded.");
+      this->NumberOfDroppedItems++;
       return PLUS_SUCCESS;
     }
   }
@@ -662,6 +840,7 @@ PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus st
   igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
   if (this->StreamBuffer->PrepareForNewItem(filteredTimestamp, itemUid, bufferIndex) != PLUS_SUCCESS)
   {
+    this->NumberOfDroppedItems++;
     // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
     LOCAL_LOG_DEBUG("vtkPlusBuffer: Failed to prepare for adding new frame to tracker buffer!");
     return PLUS_FAIL;
@@ -788,6 +967,42 @@ ItemStatus vtkPlusBuffer::GetStreamBufferItem(BufferItemUidType uid, StreamBuffe
   return ITEM_OK;
 }
 
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::GetStreamBufferItemImageRegion(BufferItemUidType uid, const std::array<int, 3>& regionOrigin, const std::array<int, 3>& regionSize, vtkImageData* regionImage)
+{
+  if (regionImage == NULL)
+  {
+    LOCAL_LOG_ERROR("Unable to copy data buffer item image region into a NULL image!");
+    return ITEM_UNKNOWN_ERROR;
+  }
+
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+
+  StreamBufferItem* dataItem = NULL;
+  ItemStatus itemStatus = this->StreamBuffer->GetBufferItemPointerFromUid(uid, dataItem);
+  if (itemStatus != ITEM_OK)
+  {
+    LOCAL_LOG_WARNING("Failed to retrieve data item");
+    return itemStatus;
+  }
+
+  vtkImageData* image = dataItem->GetFrame().GetImage();
+  if (image == NULL)
+  {
+    LOCAL_LOG_WARNING("Data item does not contain an image");
+    return ITEM_UNKNOWN_ERROR;
+  }
+
+  // Clip only, the image is already stored in the buffer orientation
+  if (igsioVideoFrame::GetOrientedClippedImage(image, igsioVideoFrame::FlipInfoType(), dataItem->GetFrame().GetImageType(), regionImage, regionOrigin, regionSize) != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_WARNING("Failed to copy data item image region");
+    return ITEM_UNKNOWN_ERROR;
+  }
+
+  return ITEM_OK;
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusBuffer::DeepCopy(vtkPlusBuffer* buffer)
 {
@@ -1072,64 +1287,103 @@ PlusStatus vtkPlusBuffer::CopyImagesFromTrackedFrameList(vtkIGSIOTrackedFrameLis
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusBuffer::WriteToSequenceFile(const char* filename, bool useCompression /*=false*/)
+PlusStatus vtkPlusBuffer::CopyToTrackedFrameList(vtkIGSIOTrackedFrameList* trackedFrameList)
 {
-  LOG_TRACE("vtkPlusBuffer::WriteToSequenceFile");
+  LOG_TRACE("vtkPlusBuffer::CopyToTrackedFrameList");
 
-  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (trackedFrameList == NULL)
+  {
+    LOCAL_LOG_ERROR("Unable to copy buffer items into a NULL tracked frame list!");
+    return PLUS_FAIL;
+  }
+  if (this->GetNumberOfItems() == 0)
+  {
+    return PLUS_SUCCESS;
+  }
 
   PlusStatus status = PLUS_SUCCESS;
+  int numberOfSkippedItems = 0;
 
-  for (BufferItemUidType frameUid = this->GetOldestItemUidInBuffer(); frameUid <= this->GetLatestItemUidInBuffer(); ++frameUid)
+  // Items that are added during the copy are not included
+  BufferItemUidType latestItemUid = this->GetLatestItemUidInBuffer();
+  for (BufferItemUidType frameUid = this->GetOldestItemUidInBuffer(); frameUid <= latestItemUid; ++frameUid)
   {
-    StreamBufferItem bufferItem;
-    if (this->GetStreamBufferItem(frameUid, &bufferItem) != ITEM_OK)
-    {
-      LOCAL_LOG_ERROR("Unable to get frame from buffer with UID: " << frameUid);
-      status = PLUS_FAIL;
-      continue;
-    }
-
     igsioTrackedFrame* trackedFrame = new igsioTrackedFrame;
-
-    // Add image data
-    trackedFrame->SetImageData(bufferItem.GetFrame());
-
-    // Add tracking data
-    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
-    bufferItem.GetMatrix(matrix);
-    trackedFrame->SetFrameTransform(igsioTransformName("Tool", "Tracker"), matrix);
-    trackedFrame->SetFrameTransformStatus(igsioTransformName("Tool", "Tracker"), bufferItem.GetStatus());
-
-    // Add filtered timestamp
-    double filteredTimestamp = bufferItem.GetFilteredTimestamp(this->GetLocalTimeOffsetSec());
-    std::ostringstream timestampFieldValue;
-    timestampFieldValue << std::fixed << filteredTimestamp;
-    trackedFrame->SetFrameField("Timestamp", timestampFieldValue.str());
-
-    // Add unfiltered timestamp
-    double unfilteredTimestamp = bufferItem.GetUnfilteredTimestamp(this->GetLocalTimeOffsetSec());
-    std::ostringstream unfilteredtimestampFieldValue;
-    unfilteredtimestampFieldValue << std::fixed << unfilteredTimestamp;
-    trackedFrame->SetFrameField("UnfilteredTimestamp", unfilteredtimestampFieldValue.str());
-
-    // Add frame number
-    unsigned long frameNumber = bufferItem.GetIndex();
-    std::ostringstream frameNumberFieldValue;
-    frameNumberFieldValue << std::fixed << frameNumber;
-    trackedFrame->SetFrameField("FrameNumber", frameNumberFieldValue.str());
-
-    // Add custom fields
-    const igsioFieldMapType& customFields = bufferItem.GetFrameFieldMap();
-    for (igsioFieldMapType::const_iterator cf = customFields.begin(); cf != customFields.end(); ++cf)
     {
-      trackedFrame->SetFrameField(cf->first, cf->second.second, cf->second.first);
+      // The tracked frame is filled directly from the buffer item, so the image is copied only once
+      igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+      StreamBufferItem* bufferItem = NULL;
+      ItemStatus itemStatus = this->StreamBuffer->GetBufferItemPointerFromUid(frameUid, bufferItem);
+      if (itemStatus != ITEM_OK)
+      {
+        delete trackedFrame;
+        if (itemStatus == ITEM_NOT_AVAILABLE_ANYMORE)
+        {
+          numberOfSkippedItems++;
+        }
+        else
+        {
+          LOCAL_LOG_ERROR("Unable to get frame from buffer with UID: " << frameUid);
+          status = PLUS_FAIL;
+        }
+        continue;
+      }
+
+      // Add image data
+      trackedFrame->SetImageData(bufferItem->GetFrame());
+
+      // Add tracking data
+      vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+      bufferItem->GetMatrix(matrix);
+      trackedFrame->SetFrameTransform(igsioTransformName("Tool", "Tracker"), matrix);
+      trackedFrame->SetFrameTransformStatus(igsioTransformName("Tool", "Tracker"), bufferItem->GetStatus());
+
+      // Add filtered timestamp
+      double filteredTimestamp = bufferItem->GetFilteredTimestamp(this->GetLocalTimeOffsetSec());
+      std::ostringstream timestampFieldValue;
+      timestampFieldValue << std::fixed << filteredTimestamp;
+      trackedFrame->SetFrameField("Timestamp", timestampFieldValue.str());
+
+      // Add unfiltered timestamp
+      double unfilteredTimestamp = bufferItem->GetUnfilteredTimestamp(this->GetLocalTimeOffsetSec());
+      std::ostringstream unfilteredtimestampFieldValue;
+      unfilteredtimestampFieldValue << std::fixed << unfilteredTimestamp;
+      trackedFrame->SetFrameField("UnfilteredTimestamp", unfilteredtimestampFieldValue.str());
+
+      // Add frame number
+      unsigned long frameNumber = bufferItem->GetIndex();
+      std::ostringstream frameNumberFieldValue;
+      frameNumberFieldValue << std::fixed << frameNumber;
+      trackedFrame->SetFrameField("FrameNumber", frameNumberFieldValue.str());
+
+      // Add custom fields
+      const igsioFieldMapType& customFields = bufferItem->GetFrameFieldMap();
+      for (igsioFieldMapType::const_iterator cf = customFields.begin(); cf != customFields.end(); ++cf)
+      {
+        trackedFrame->SetFrameField(cf->first, cf->second.second, cf->second.first);
+      }
     }
 
     // Add tracked frame to the list
     trackedFrameList->TakeTrackedFrame(trackedFrame);
   }
 
+  if (numberOfSkippedItems > 0)
+  {
+    LOCAL_LOG_DEBUG(numberOfSkippedItems << " items were overwritten by new data before they could be copied");
+  }
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::WriteToSequenceFile(const char* filename, bool useCompression /*=false*/)
+{
+  LOG_TRACE("vtkPlusBuffer::WriteToSequenceFile");
+
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  PlusStatus status = this->CopyToTrackedFrameList(trackedFrameList);
+
   // Save tracked frames to metafile
   if (vtkPlusSequenceIO::Write(filename, trackedFrameList, trackedFrameList->GetImageOrientation(), useCompression) != PLUS_SUCCESS)
   {
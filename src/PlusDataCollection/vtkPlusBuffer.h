@@ -26,6 +26,10 @@ See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
 // VTK includes
 #include <vtkObject.h>
 
+// STL includes
+#include <atomic>
+
+class vtkImageData;
 class vtkPlusDevice;
 enum ToolStatus;
 
@@ -55,12 +59,15 @@ public:
 
   /*!
     Set the size of the buffer, i.e. the maximum number of
-    video frames that it will hold.  The default is 30.
+    video frames that it will hold.  The default is DEFAULT_BUFFER_SIZE.
   */
   virtual PlusStatus SetBufferSize(int n);
   /*! Get the size of the buffer */
   virtual int GetBufferSize();
 
+  /*! Size of a newly created buffer */
+  static const int DEFAULT_BUFFER_SIZE;
+
   /*!
     Add a frame plus a timestamp to the buffer with frame index.
     If the timestamp is  less than or equal to the previous timestamp,
@@ -151,6 +158,18 @@ public:
   */
   PlusStatus AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp = UNDEFINED_TIMESTAMP, const igsioFieldMapType* customFields = NULL);
 
+  /*!
+    Add a frame that consists of every pixelStride[0]-th column and every pixelStride[1]-th row of the image of an item in another buffer,
+    starting from the firstPixel column and row (e.g., one view of an interlaced stereo frame).
+    The pixels are copied directly from the source buffer item into the new item of this buffer, without intermediate images.
+    The source and this buffer must have the same pixel type, number of scalar components, and image orientation.
+    If a clip rectangle is defined then only that portion of the strided image is extracted.
+    Rows of this buffer's frame that are not covered by the source image are set to zero.
+    The timestamps of the new item are the same as the timestamps of the source item.
+  */
+  virtual PlusStatus AddStridedItem(vtkPlusBuffer* sourceBuffer, BufferItemUidType sourceUid, const std::array<int, 2>& firstPixel, const std::array<int, 2>& pixelStride, long frameNumber,
+                                    const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize);
+
   /*! Get a frame with the specified frame uid from the buffer */
   virtual ItemStatus GetStreamBufferItem(BufferItemUidType uid, StreamBufferItem* bufferItem);
   /*! Get the most recent frame from the buffer */
@@ -165,6 +184,11 @@ public:
   };
   /*! Get a frame that was acquired at the specified time from buffer */
   virtual ItemStatus GetStreamBufferItemFromTime(double time, StreamBufferItem* bufferItem, DataItemTemporalInterpolationType interpolation);
+  /*!
+    Copy a rectangular region of the image of the frame with the specified frame uid into regionImage.
+    Only the region is copied, not the full frame. The buffer is locked only while the region is copied.
+  */
+  virtual ItemStatus GetStreamBufferItemImageRegion(BufferItemUidType uid, const std::array<int, 3>& regionOrigin, const std::array<int, 3>& regionSize, vtkImageData* regionImage);
   virtual PlusStatus ModifyBufferItemFrameField(BufferItemUidType uid, const std::string& key, const std::string& value);
 
   /*! Get latest timestamp in the buffer */
@@ -219,6 +243,15 @@ public:
     return this->StreamBuffer->GetNumberOfItems();
   }
 
+  /*!
+    Get the number of items that were not added to the buffer since the buffer was created, because their timestamp
+    was invalid or not newer than the latest item. Can be called from any thread.
+  */
+  unsigned long long GetNumberOfDroppedItems() const
+  {
+    return this->NumberOfDroppedItems.load(std::memory_order_relaxed);
+  }
+
   /*!
     Get the frame rate from the buffer based on the number of frames in the buffer and the elapsed time.
     Ideal frame rate shows the mean of the frame periods in the buffer based on the frame
@@ -311,6 +344,13 @@ public:
   /*! Copy images from a tracked frame buffer. It is useful when data is stored in a metafile and the data is needed as a vtkPlusDataBuffer. */
   PlusStatus CopyImagesFromTrackedFrameList(vtkIGSIOTrackedFrameList* sourceTrackedFrameList, TIMESTAMP_FILTERING_OPTION timestampFiltering, bool copyFrameFields);
 
+  /*!
+    Append the items that are currently in the buffer to a tracked frame list.
+    The buffer is locked only while an item is copied, so data acquisition can continue during the copy.
+    Items that are overwritten by new data before they could be copied are skipped.
+  */
+  virtual PlusStatus CopyToTrackedFrameList(vtkIGSIOTrackedFrameList* trackedFrameList);
+
   /*! Dump the current state of the video buffer to metafile */
   virtual PlusStatus WriteToSequenceFile(const char* filename, bool useCompression = false);
 
@@ -371,6 +411,9 @@ protected:
 
   char* DescriptiveName;
 
+  /*! Number of items that were not added to the buffer, counted without locking for monitoring */
+  std::atomic<unsigned long long> NumberOfDroppedItems;
+
 private:
   vtkPlusBuffer(const vtkPlusBuffer&);
   void operator=(const vtkPlusBuffer&);
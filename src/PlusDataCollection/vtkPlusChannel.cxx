@@ -88,46 +88,12 @@ PlusStatus vtkPlusChannel::ReadConfiguration(vtkXMLDataElement* aChannelElement,
     return PLUS_FAIL;
   }
 
-  vtkPlusDataSource* aSource = NULL;
-  for (int i = 0; i < aChannelElement->GetNumberOfNestedElements(); i++)
+  if (this->ReadDataSourcesConfiguration(aChannelElement, this->Tools, this->FieldDataSources) != PLUS_SUCCESS)
   {
-    vtkXMLDataElement* aSourceElement = aChannelElement->GetNestedElement(i);
-    if (STRCASECMP(aSourceElement->GetName(), "DataSource") != 0)
-    {
-      // if this is not an data source element, skip it
-      continue;
-    }
-
-    const char* id = aSourceElement->GetAttribute("Id");
-    if (id == NULL)
-    {
-      LOG_ERROR("No field \"Id\" defined in the source element " << this->GetChannelId() << ". Unable to add it to the channel.");
-      continue;
-    }
-
-    igsioTransformName idName(id, this->OwnerDevice->GetToolReferenceFrameName());
-    if (this->OwnerDevice->GetDataSource(id, aSource) == PLUS_SUCCESS)
-    {
-      if (aSource->GetType() == DATA_SOURCE_TYPE_TOOL)
-      {
-        this->Tools[aSource->GetId()] = aSource;
-      }
-      else
-      {
-        this->FieldDataSources[aSource->GetId()] = aSource;
-      }
-    }
-    else if (this->OwnerDevice->GetDataSource(idName.GetTransformName().c_str(), aSource) == PLUS_SUCCESS)
-    {
-      this->Tools[aSource->GetId()] = aSource;
-    }
-    else
-    {
-      LOG_ERROR("Unable to find data source with Id=\'" << id << "\'.");
-      return PLUS_FAIL;
-    }
+    return PLUS_FAIL;
   }
 
+  vtkPlusDataSource* aSource = NULL;
   if (aChannelElement->GetAttribute("VideoDataSourceId") != NULL && this->OwnerDevice->GetVideoSource(aChannelElement->GetAttribute("VideoDataSourceId"), aSource) == PLUS_SUCCESS)
   {
     this->VideoSource = aSource;
@@ -181,6 +147,91 @@ PlusStatus vtkPlusChannel::ReadConfiguration(vtkXMLDataElement* aChannelElement,
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusChannel::ReadDataSourcesConfiguration(vtkXMLDataElement* aChannelElement, DataSourceContainer& tools, DataSourceContainer& fieldDataSources)
+{
+  vtkPlusDataSource* aSource = NULL;
+  for (int i = 0; i < aChannelElement->GetNumberOfNestedElements(); i++)
+  {
+    vtkXMLDataElement* aSourceElement = aChannelElement->GetNestedElement(i);
+    if (STRCASECMP(aSourceElement->GetName(), "DataSource") != 0)
+    {
+      // if this is not an data source element, skip it
+      continue;
+    }
+
+    const char* id = aSourceElement->GetAttribute("Id");
+    if (id == NULL)
+    {
+      LOG_ERROR("No field \"Id\" defined in the source element " << this->GetChannelId() << ". Unable to add it to the channel.");
+      continue;
+    }
+
+    igsioTransformName idName(id, this->OwnerDevice->GetToolReferenceFrameName());
+    if (this->OwnerDevice->GetDataSource(id, aSource) == PLUS_SUCCESS)
+    {
+      if (aSource->GetType() == DATA_SOURCE_TYPE_TOOL)
+      {
+        tools[aSource->GetId()] = aSource;
+      }
+      else
+      {
+        fieldDataSources[aSource->GetId()] = aSource;
+      }
+    }
+    else if (this->OwnerDevice->GetDataSource(idName.GetTransformName().c_str(), aSource) == PLUS_SUCCESS)
+    {
+      tools[aSource->GetId()] = aSource;
+    }
+    else
+    {
+      LOG_ERROR("Unable to find data source with Id=\'" << id << "\'.");
+      return PLUS_FAIL;
+    }
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusChannel::UpdateDataSources(vtkXMLDataElement* aChannelElement)
+{
+  if (this->OwnerDevice == NULL)
+  {
+    LOG_ERROR("Channel does not know about its parent device. Unable to update data sources.");
+    return PLUS_FAIL;
+  }
+
+  // Resolve all the data sources first, so that the channel is left unchanged if any of them is missing
+  DataSourceContainer tools;
+  DataSourceContainer fieldDataSources;
+  if (this->ReadDataSourcesConfiguration(aChannelElement, tools, fieldDataSources) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to update data sources of channel " << (this->GetChannelId() ? this->GetChannelId() : "(undefined)"));
+    return PLUS_FAIL;
+  }
+
+  this->Tools = tools;
+  this->FieldDataSources = fieldDataSources;
+
+  bool masterToolFound = false;
+  for (DataSourceContainerConstIterator it = this->Tools.begin(); it != this->Tools.end(); ++it)
+  {
+    if (it->second == this->TimestampMasterTool)
+    {
+      masterToolFound = true;
+      break;
+    }
+  }
+  if (!masterToolFound)
+  {
+    // the master tool has been removed, the first tool will be used
+    this->TimestampMasterTool = NULL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::WriteConfiguration(vtkXMLDataElement* aChannelElement)
 {
@@ -318,12 +369,12 @@ PlusStatus vtkPlusChannel::RemoveTool(const std::string& toolSourceId)
   {
     if (it->second->GetId() == toolSourceId)
     {
-      this->Tools.erase(it);
       if (this->TimestampMasterTool == it->second)
       {
         // the master tool has been deleted
         this->TimestampMasterTool = NULL;
       }
+      this->Tools.erase(it);
       return PLUS_SUCCESS;
     }
   }
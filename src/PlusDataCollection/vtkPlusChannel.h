@@ -51,6 +51,13 @@ public:
   */
   virtual PlusStatus WriteConfiguration(vtkXMLDataElement* aChannelElement);
 
+  /*!
+    Replace the tools and field data sources of the channel by the DataSource elements of the channel XML.
+    The channel is not modified if any of the data sources does not exist in the owner device.
+    Threads that read the channel (the owner device, devices that use it as input channel, servers) must be paused by the caller.
+  */
+  PlusStatus UpdateDataSources(vtkXMLDataElement* aChannelElement);
+
   inline PlusStatus GetVideoSource(vtkPlusDataSource*& aVideoSource) const
   {
     aVideoSource = this->VideoSource;
@@ -175,6 +182,9 @@ protected:
   virtual int GetNumberOfFramesBetweenTimestamps(double aTimestampFrom, double aTimestampTo);
 
 protected:
+  /*! Find the tools and field data sources of the owner device that are listed in the DataSource elements of the channel XML */
+  PlusStatus ReadDataSourcesConfiguration(vtkXMLDataElement* aChannelElement, DataSourceContainer& tools, DataSourceContainer& fieldDataSources);
+
   DataSourceContainer       FieldDataSources;
   DataSourceContainer       Tools;
   vtkPlusDataSource*        VideoSource;
@@ -13,18 +13,22 @@ See License.txt for details.
 #include "vtkPlusDevice.h"
 #include "vtkPlusDeviceFactory.h"
 #include "vtkPlusSavedDataSource.h"
+#include "vtkPlusSequenceIO.h"
 
 // vtkAddon includes
 #include <vtkStreamingVolumeCodecFactory.h>
 
 // IGSIO includes
 #include <igsioTrackedFrame.h>
+#include <vtkIGSIOAccurateTimer.h>
+#include <vtkIGSIORecursiveCriticalSection.h>
 #include <vtkIGSIOTrackedFrameList.h>
 #if defined PLUS_USE_VP9
   #include <vtkVP9VolumeCodec.h>
 #endif
 
 // STD includes
+#include <algorithm>
 #include <set>
 
 // VTK includes
@@ -41,8 +45,17 @@ vtkPlusDataCollector::vtkPlusDataCollector()
   : vtkObject()
   , StartupDelaySec(0.0)
   , DeviceFactory(vtkSmartPointer<vtkPlusDeviceFactory>::New())
+  , DevicesMutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
   , Connected(false)
   , Started(false)
+  , MaximumNumberOfBufferDumpThreads(4)
+  , BufferDumpMutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
+  , NextBufferDumpJobIndex(0)
+  , NumberOfWrittenBufferDumpJobs(0)
+  , NumberOfFinishedBufferDumpThreads(0)
+  , BufferDumpStatus(PLUS_SUCCESS)
+  , BufferDumpActive(false)
+  , BufferDumpThreader(vtkSmartPointer<vtkMultiThreader>::New())
 {
   vtkStreamingVolumeCodecFactory* factory = vtkStreamingVolumeCodecFactory::GetInstance();
 #if defined PLUS_USE_VP9
@@ -55,6 +68,8 @@ vtkPlusDataCollector::vtkPlusDataCollector()
 vtkPlusDataCollector::~vtkPlusDataCollector()
 {
   LOG_TRACE("vtkPlusDataCollector::~vtkPlusDataCollector()");
+  // The dump threads access the collector, wait until they exit
+  this->WaitForBufferDump();
   if (this->Started)
   {
     this->Stop();
@@ -143,6 +158,11 @@ PlusStatus vtkPlusDataCollector::ReadConfiguration(vtkXMLDataElement* aConfig)
       return PLUS_FAIL;
     }
     Devices.push_back(device);
+
+    // Keep a copy of the device configuration to find the changes when a new configuration is applied
+    vtkSmartPointer<vtkXMLDataElement> deviceConfiguration = vtkSmartPointer<vtkXMLDataElement>::New();
+    deviceConfiguration->DeepCopy(deviceElement);
+    this->DeviceConfigurations[deviceId] = deviceConfiguration;
   }
 
   if (Devices.size() == 0)
@@ -192,45 +212,9 @@ PlusStatus vtkPlusDataCollector::ReadConfiguration(vtkXMLDataElement* aConfig)
       LOG_ERROR("Device " << deviceElement->GetAttribute("Id") << " does not exist.");
       return PLUS_FAIL;
     }
-    vtkXMLDataElement* inputChannelsElement = deviceElement->FindNestedElementWithName("InputChannels");
-    if (inputChannelsElement == NULL)
+    if (this->ConnectInputChannels(thisDevice, deviceElement) != PLUS_SUCCESS)
     {
-      // no input channels, nothing to connect
-      continue;
-    }
-    for (int i = 0; i < inputChannelsElement->GetNumberOfNestedElements(); ++i)
-    {
-      vtkXMLDataElement* inputChannelElement = inputChannelsElement->GetNestedElement(i);
-      if (STRCASECMP(inputChannelElement->GetName(), "InputChannel") == 0)
-      {
-        // We have an input channel, lets find it
-        const char* inputChannelId = inputChannelElement->GetAttribute("Id");
-        if (inputChannelId == NULL)
-        {
-          LOG_ERROR("Device " << deviceElement->GetAttribute("Id") << " has an input channel without Id attribute.");
-          return PLUS_FAIL;
-        }
-        vtkPlusChannel* aChannel = NULL;
-        for (DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++it)
-        {
-          vtkPlusDevice* device = (*it);
-          if (device->GetOutputChannelByName(aChannel, inputChannelId) == PLUS_SUCCESS)
-          {
-            // Found it!
-            break;
-          }
-        }
-        if (aChannel == NULL)
-        {
-          LOG_ERROR("Device " << deviceElement->GetAttribute("Id") << " is specified to use channel " << inputChannelId << " as input, but an output channel by this Id does not exist");
-          return PLUS_FAIL;
-        }
-        if (thisDevice->AddInputChannel(aChannel) != PLUS_SUCCESS)
-        {
-          LOG_ERROR("Failed to add input channel " << inputChannelId << " to device " << deviceElement->GetAttribute("Id"));
-          return PLUS_FAIL;
-        }
-      }
+      return PLUS_FAIL;
     }
   }
 
@@ -268,6 +252,355 @@ PlusStatus vtkPlusDataCollector::ReadConfiguration(const std::string& fileName)
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::ConnectInputChannels(vtkPlusDevice* aDevice, vtkXMLDataElement* deviceElement)
+{
+  vtkXMLDataElement* inputChannelsElement = deviceElement->FindNestedElementWithName("InputChannels");
+  if (inputChannelsElement == NULL)
+  {
+    // no input channels, nothing to connect
+    return PLUS_SUCCESS;
+  }
+  for (int i = 0; i < inputChannelsElement->GetNumberOfNestedElements(); ++i)
+  {
+    vtkXMLDataElement* inputChannelElement = inputChannelsElement->GetNestedElement(i);
+    if (STRCASECMP(inputChannelElement->GetName(), "InputChannel") == 0)
+    {
+      // We have an input channel, lets find it
+      const char* inputChannelId = inputChannelElement->GetAttribute("Id");
+      if (inputChannelId == NULL)
+      {
+        LOG_ERROR("Device " << deviceElement->GetAttribute("Id") << " has an input channel without Id attribute.");
+        return PLUS_FAIL;
+      }
+      vtkPlusChannel* aChannel = NULL;
+      for (DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++it)
+      {
+        vtkPlusDevice* device = (*it);
+        if (device->GetOutputChannelByName(aChannel, inputChannelId) == PLUS_SUCCESS)
+        {
+          // Found it!
+          break;
+        }
+      }
+      if (aChannel == NULL)
+      {
+        LOG_ERROR("Device " << deviceElement->GetAttribute("Id") << " is specified to use channel " << inputChannelId << " as input, but an output channel by this Id does not exist");
+        return PLUS_FAIL;
+      }
+      if (aDevice->AddInputChannel(aChannel) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add input channel " << inputChannelId << " to device " << deviceElement->GetAttribute("Id"));
+        return PLUS_FAIL;
+      }
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::ApplyConfiguration(vtkXMLDataElement* aConfig, std::vector<std::string>& updatedDeviceIds, std::vector<std::string>& restartedDeviceIds)
+{
+  LOG_TRACE("vtkPlusDataCollector::ApplyConfiguration()");
+
+  updatedDeviceIds.clear();
+  restartedDeviceIds.clear();
+
+  if (aConfig == NULL)
+  {
+    LOG_ERROR("Unable to apply configuration");
+    return PLUS_FAIL;
+  }
+
+  if (this->DeviceConfigurations.empty())
+  {
+    LOG_ERROR("Configuration can only be applied after vtkPlusDataCollector::ReadConfiguration has been called.");
+    return PLUS_FAIL;
+  }
+
+  vtkXMLDataElement* dataCollectionElement = aConfig->FindNestedElementWithName("DataCollection");
+  if (dataCollectionElement == NULL)
+  {
+    LOG_ERROR("Unable to find data collection element in XML tree!");
+    return PLUS_FAIL;
+  }
+
+  // Match the device elements of the new configuration to the running devices
+  std::map<std::string, vtkXMLDataElement*> newDeviceElements;
+  for (int i = 0; i < dataCollectionElement->GetNumberOfNestedElements(); ++i)
+  {
+    vtkXMLDataElement* deviceElement = dataCollectionElement->GetNestedElement(i);
+    if (deviceElement == NULL || STRCASECMP(deviceElement->GetName(), "Device") != 0)
+    {
+      continue;
+    }
+    const char* deviceId = deviceElement->GetAttribute("Id");
+    if (deviceId == NULL)
+    {
+      LOG_ERROR("Device of type " << (deviceElement->GetAttribute("Type") == NULL ? "UNDEFINED" : deviceElement->GetAttribute("Type")) << " has no Id attribute");
+      return PLUS_FAIL;
+    }
+    if (newDeviceElements.count(deviceId) > 0)
+    {
+      LOG_ERROR("Multiple devices exist with the same Id: \'" << deviceId << "\'");
+      return PLUS_FAIL;
+    }
+    if (this->DeviceConfigurations.count(deviceId) == 0)
+    {
+      LOG_ERROR("Device " << deviceId << " is not in the running configuration. Adding devices requires a full reconnect.");
+      return PLUS_FAIL;
+    }
+    newDeviceElements[deviceId] = deviceElement;
+  }
+  if (newDeviceElements.size() != this->DeviceConfigurations.size())
+  {
+    LOG_ERROR("Devices are removed from the configuration. Removing devices requires a full reconnect.");
+    return PLUS_FAIL;
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  std::vector<vtkPlusDevice*> devicesToRestart;
+  {
+    // Other threads must not read the devices or their channels until the changes of the running devices are applied.
+    // Restarted devices are connected without the lock (see RestartDevice), only their replacement is locked.
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> devicesGuard(this->DevicesMutex);
+
+    // Sort the changed devices: either the changes are applied to the running device or the device is replaced
+    std::vector<vtkPlusDevice*> devicesToUpdate;
+    for (DeviceCollectionIterator it = this->Devices.begin(); it != this->Devices.end(); ++it)
+    {
+      std::map<std::string, vtkSmartPointer<vtkXMLDataElement> >::iterator currentElementIt = this->DeviceConfigurations.find((*it)->GetDeviceId());
+      if (currentElementIt == this->DeviceConfigurations.end())
+      {
+        // device is not created from the configuration (added by AddDevice)
+        continue;
+      }
+      vtkXMLDataElement* currentElement = currentElementIt->second;
+      vtkXMLDataElement* newElement = newDeviceElements[(*it)->GetDeviceId()];
+      if (currentElement->IsEqualTo(newElement))
+      {
+        continue;
+      }
+      bool sameType = (currentElement->GetAttribute("Type") != NULL && newElement->GetAttribute("Type") != NULL && STRCASECMP(currentElement->GetAttribute("Type"), newElement->GetAttribute("Type")) == 0);
+      if (sameType && (*it)->CanApplyConfigurationChanges(currentElement, newElement) && this->CanPauseDependentDevices(*it))
+      {
+        devicesToUpdate.push_back(*it);
+      }
+      else
+      {
+        devicesToRestart.push_back(*it);
+      }
+    }
+
+    // Devices that use the output channels of a replaced device would keep references to the deleted channels
+    for (std::vector<vtkPlusDevice*>::iterator restartIt = devicesToRestart.begin(); restartIt != devicesToRestart.end(); ++restartIt)
+    {
+      std::vector<vtkPlusDevice*> dependentDevices;
+      this->GetDependentDevices(*restartIt, dependentDevices);
+      if (!dependentDevices.empty())
+      {
+        LOG_ERROR("Device " << (*restartIt)->GetDeviceId() << " has to be restarted to apply the configuration, but its output channels are used by device " << dependentDevices.front()->GetDeviceId() << ". This change requires a full reconnect.");
+        return PLUS_FAIL;
+      }
+    }
+
+    double startupDelaySec(0.0);
+    if (dataCollectionElement->GetScalarAttribute("StartupDelaySec", startupDelaySec))
+    {
+      this->SetStartupDelaySec(startupDelaySec);
+    }
+
+    if (devicesToUpdate.empty() && devicesToRestart.empty())
+    {
+      return PLUS_SUCCESS;
+    }
+
+    for (std::vector<vtkPlusDevice*>::iterator updateIt = devicesToUpdate.begin(); updateIt != devicesToUpdate.end(); ++updateIt)
+    {
+      vtkPlusDevice* device = *updateIt;
+
+      // Pause the devices that read the output channels of this device while the channels are modified
+      std::vector<vtkPlusDevice*> dependentDevices;
+      this->GetDependentDevices(device, dependentDevices);
+      for (std::vector<vtkPlusDevice*>::iterator it = dependentDevices.begin(); it != dependentDevices.end(); ++it)
+      {
+        // All dependent devices use the internal update thread (see CanPauseDependentDevices), which holds the mutex during updates
+        (*it)->UpdateMutex->Lock();
+      }
+      PlusStatus deviceStatus = device->ApplyConfigurationChanges(aConfig);
+      for (std::vector<vtkPlusDevice*>::reverse_iterator it = dependentDevices.rbegin(); it != dependentDevices.rend(); ++it)
+      {
+        (*it)->UpdateMutex->Unlock();
+      }
+
+      if (deviceStatus != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to apply configuration changes to device " << device->GetDeviceId());
+        status = PLUS_FAIL;
+        continue;
+      }
+      this->DeviceConfigurations[device->GetDeviceId()]->DeepCopy(newDeviceElements[device->GetDeviceId()]);
+      updatedDeviceIds.push_back(device->GetDeviceId());
+    }
+  }
+
+  std::vector<vtkPlusDevice*> replacedDevices;
+  for (std::vector<vtkPlusDevice*>::iterator restartIt = devicesToRestart.begin(); restartIt != devicesToRestart.end(); ++restartIt)
+  {
+    std::string deviceId = (*restartIt)->GetDeviceId();
+    bool replaced = false;
+    if (this->RestartDevice(*restartIt, aConfig, newDeviceElements[deviceId], replaced) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+    if (!replaced)
+    {
+      continue;
+    }
+    replacedDevices.push_back(*restartIt);
+    this->DeviceConfigurations[deviceId]->DeepCopy(newDeviceElements[deviceId]);
+    restartedDeviceIds.push_back(deviceId);
+  }
+
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> devicesGuard(this->DevicesMutex);
+  if (!restartedDeviceIds.empty() && this->SetLoopTimes() != PLUS_SUCCESS)
+  {
+    LOG_WARNING("Failed to set loop times!");
+  }
+
+  this->InvokeEvent(ConfigurationAppliedEvent);
+
+  // Observers may have used the channels of the replaced devices until they were notified
+  for (std::vector<vtkPlusDevice*>::iterator it = replacedDevices.begin(); it != replacedDevices.end(); ++it)
+  {
+    (*it)->Delete();
+  }
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDataCollector::GetDependentDevices(vtkPlusDevice* aDevice, std::vector<vtkPlusDevice*>& dependentDevices) const
+{
+  dependentDevices.clear();
+  for (DeviceCollectionConstIterator it = this->Devices.begin(); it != this->Devices.end(); ++it)
+  {
+    std::vector<vtkPlusDevice*> inputDevices;
+    (*it)->GetInputDevices(inputDevices);
+    if (std::find(inputDevices.begin(), inputDevices.end(), aDevice) != inputDevices.end())
+    {
+      dependentDevices.push_back(*it);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusDataCollector::CanPauseDependentDevices(vtkPlusDevice* aDevice) const
+{
+  std::vector<vtkPlusDevice*> dependentDevices;
+  this->GetDependentDevices(aDevice, dependentDevices);
+  for (std::vector<vtkPlusDevice*>::iterator it = dependentDevices.begin(); it != dependentDevices.end(); ++it)
+  {
+    if (!(*it)->GetStartThreadForInternalUpdates())
+    {
+      LOG_DEBUG("Device " << (*it)->GetDeviceId() << " uses the output channels of device " << aDevice->GetDeviceId() << " in its own threads, changes cannot be applied while it is running.");
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::RestartDevice(vtkPlusDevice* oldDevice, vtkXMLDataElement* aConfig, vtkXMLDataElement* deviceElement, bool& replaced)
+{
+  replaced = false;
+  const std::string deviceId = oldDevice->GetDeviceId();
+  LOG_INFO("Restarting device " << deviceId << " to apply the new configuration");
+
+  // Configure the new device completely before the old one is stopped
+  vtkPlusDevice* newDevice = NULL;
+  if (this->DeviceFactory->CreateInstance(deviceElement->GetAttribute("Type"), newDevice, deviceId) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to create device: " << deviceElement->GetAttribute("Type"));
+    return PLUS_FAIL;
+  }
+  newDevice->SetDataCollector(this);
+  if (newDevice->ReadConfiguration(aConfig) != PLUS_SUCCESS
+      || this->ConnectInputChannels(newDevice, deviceElement) != PLUS_SUCCESS
+      || newDevice->NotifyConfigured() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read the new configuration of device " << deviceId << ". The device keeps running with its previous configuration.");
+    newDevice->Delete();
+    return PLUS_FAIL;
+  }
+  {
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> devicesGuard(this->DevicesMutex);
+    for (ChannelContainerConstIterator channelIt = newDevice->GetOutputChannelsStart(); channelIt != newDevice->GetOutputChannelsEnd(); ++channelIt)
+    {
+      for (DeviceCollectionIterator it = this->Devices.begin(); it != this->Devices.end(); ++it)
+      {
+        vtkPlusChannel* existingChannel = NULL;
+        if (*it != oldDevice && (*it)->GetOutputChannelByName(existingChannel, (*channelIt)->GetChannelId()) == PLUS_SUCCESS)
+        {
+          LOG_ERROR("Same output channel Id is defined at multiple locations: " << (*channelIt)->GetChannelId());
+          newDevice->Delete();
+          return PLUS_FAIL;
+        }
+      }
+    }
+  }
+
+  const bool wasRecording = oldDevice->IsRecording();
+  const double startTime = oldDevice->GetStartTime();
+  if (wasRecording && oldDevice->StopRecording() != PLUS_SUCCESS)
+  {
+    LOG_WARNING("Failed to stop data acquisition for device " << deviceId << ".");
+  }
+  if (oldDevice->GetConnected() && oldDevice->Disconnect() != PLUS_SUCCESS)
+  {
+    LOG_WARNING("Unable to disconnect device: " << deviceId << ".");
+  }
+
+  // Connecting may take long, the device list is not locked meanwhile
+  if (this->Connected && newDevice->Connect() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to connect device " << deviceId << " with the new configuration. Reconnecting with the previous configuration.");
+    newDevice->Delete();
+    if (oldDevice->Connect() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to reconnect device: " << deviceId << ".");
+    }
+    else if (wasRecording)
+    {
+      if (oldDevice->StartRecording() != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to restart data acquisition for device " << deviceId << ".");
+      }
+      oldDevice->SetStartTime(startTime);
+    }
+    return PLUS_FAIL;
+  }
+
+  {
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> devicesGuard(this->DevicesMutex);
+    std::replace(this->Devices.begin(), this->Devices.end(), oldDevice, newDevice);
+  }
+  replaced = true;
+
+  PlusStatus status = PLUS_SUCCESS;
+  if (wasRecording)
+  {
+    if (newDevice->StartRecording() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to start data acquisition for device " << deviceId << ".");
+      status = PLUS_FAIL;
+    }
+    newDevice->SetStartTime(startTime);
+  }
+
+  return status;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDataCollector::WriteConfiguration(vtkXMLDataElement* aConfig)
 {
@@ -430,6 +763,8 @@ PlusStatus vtkPlusDataCollector::GetDevice(vtkPlusDevice*& aDevice, const std::s
 {
   LOG_TRACE("vtkPlusDataCollector::GetDevice( aDevice, " << aDeviceId << ")");
 
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> devicesGuard(this->DevicesMutex);
+
   for (DeviceCollectionConstIterator it = Devices.begin(); it != Devices.end(); ++it)
   {
     vtkPlusDevice* device = (*it);
@@ -451,6 +786,7 @@ PlusStatus vtkPlusDataCollector::GetDevices(DeviceCollection& OutVector) const
 
   OutVector.clear();
 
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> devicesGuard(this->DevicesMutex);
   for (DeviceCollectionConstIterator it = Devices.begin(); it != Devices.end(); ++it)
   {
     OutVector.push_back(*it);
@@ -476,29 +812,216 @@ PlusStatus vtkPlusDataCollector::DumpBuffersToDirectory(const char* aDirectory)
 {
   LOG_TRACE("vtkPlusDataCollector::DumpBuffersToDirectory(" << aDirectory << ")");
 
+  PlusStatus status = this->StartBufferDump(aDirectory);
+  if (this->WaitForBufferDump() != PLUS_SUCCESS)
+  {
+    status = PLUS_FAIL;
+  }
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::StartBufferDump(const char* aDirectory)
+{
+  LOG_TRACE("vtkPlusDataCollector::StartBufferDump(" << (aDirectory != NULL ? aDirectory : "") << ")");
+
+  if (this->IsBufferDumpInProgress())
+  {
+    LOG_ERROR("Unable to start buffer dump: the previous buffer dump is still in progress");
+    return PLUS_FAIL;
+  }
+  if (this->MaximumNumberOfBufferDumpThreads < 1)
+  {
+    LOG_ERROR("Invalid maximum number of buffer dump threads: " << this->MaximumNumberOfBufferDumpThreads << ". It must be at least 1.");
+    return PLUS_FAIL;
+  }
+  // Release the threads of the previous dump
+  this->JoinBufferDumpThreads();
+
   // Assemble file names
   std::string dateAndTime = vtksys::SystemTools::GetCurrentDateTime("%Y%m%d_%H%M%S");
 
-  for (DeviceCollectionIterator it = this->Devices.begin(); it != this->Devices.end(); ++it)
+  PlusStatus status = PLUS_SUCCESS;
+  this->BufferDumpJobs.clear();
+
+  // Virtual devices share the data sources of their input devices, each source is dumped only once.
+  // The device list is locked while the buffers are copied, so that devices cannot be replaced or deleted meanwhile.
   {
-    vtkPlusDevice* device = *it;
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> devicesGuard(this->DevicesMutex);
+    std::set<vtkPlusDataSource*> dumpedSources;
+    for (DeviceCollectionIterator it = this->Devices.begin(); it != this->Devices.end(); ++it)
+    {
+      vtkPlusDevice* device = *it;
+
+      std::vector<vtkPlusDataSource*> sources = device->GetVideoSources();
+      for (DataSourceContainerConstIterator toolIt = device->GetToolIteratorBegin(); toolIt != device->GetToolIteratorEnd(); ++toolIt)
+      {
+        sources.push_back(toolIt->second);
+      }
+      for (DataSourceContainerConstIterator fieldIt = device->GetFieldDataSourcessIteratorBegin(); fieldIt != device->GetFieldDataSourcessIteratorEnd(); ++fieldIt)
+      {
+        sources.push_back(fieldIt->second);
+      }
+
+      for (std::vector<vtkPlusDataSource*>::iterator sourceIt = sources.begin(); sourceIt != sources.end(); ++sourceIt)
+      {
+        vtkPlusDataSource* source = *sourceIt;
+        if (source == NULL || !dumpedSources.insert(source).second)
+        {
+          continue;
+        }
+
+        vtkPlusDevice* ownerDevice = (source->GetDevice() != NULL ? source->GetDevice() : device);
+        std::string fileName = std::string("BufferDump_") + ownerDevice->GetDeviceId() + "_" + source->GetSourceId() + "_" + dateAndTime + ".nrrd";
+
+        BufferDumpJob job;
+        job.FileName = (aDirectory != NULL && aDirectory[0] != 0) ? std::string(aDirectory) + "/" + fileName : vtkPlusConfig::GetInstance()->GetOutputPath(fileName);
+        job.TrackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+        if (source->CopyToTrackedFrameList(job.TrackedFrameList) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to take a snapshot of the buffer of " << source->GetSourceId() << ", the dump may be incomplete");
+          status = PLUS_FAIL;
+        }
+        this->BufferDumpJobs.push_back(job);
+      }
+    }
+  }
+
+  this->NextBufferDumpJobIndex = 0;
+  this->NumberOfWrittenBufferDumpJobs = 0;
+  this->NumberOfFinishedBufferDumpThreads = 0;
+  this->BufferDumpStatus = status;
+
+  if (this->BufferDumpJobs.empty())
+  {
+    LOG_WARNING("There are no data sources to dump");
+    BufferDumpProgress progress;
+    progress.NumberOfWrittenSources = 0;
+    progress.NumberOfSources = 0;
+    progress.Status = status;
+    this->InvokeEvent(BufferDumpCompletedEvent, &progress);
+    return status;
+  }
+
+  // The threads wait for the mutex before taking a job, so none of them can finish before all are spawned
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> bufferDumpGuard(this->BufferDumpMutex);
+  int numberOfThreads = std::min(this->MaximumNumberOfBufferDumpThreads, static_cast<int>(this->BufferDumpJobs.size()));
+  this->BufferDumpActive = true;
+  for (int i = 0; i < numberOfThreads; ++i)
+  {
+    int threadId = this->BufferDumpThreader->SpawnThread((vtkThreadFunctionType)&BufferDumpThread, this);
+    if (threadId < 0)
+    {
+      // the jobs are taken by the threads that could be started
+      LOG_WARNING("Unable to start buffer dump thread, " << this->BufferDumpThreadIds.size() << " threads are used");
+      break;
+    }
+    this->BufferDumpThreadIds.push_back(threadId);
+  }
+  if (this->BufferDumpThreadIds.empty())
+  {
+    LOG_ERROR("Unable to start buffer dump threads");
+    this->BufferDumpActive = false;
+    this->BufferDumpStatus = PLUS_FAIL;
+    return PLUS_FAIL;
+  }
+  LOG_INFO("Writing the buffers of " << this->BufferDumpJobs.size() << " data sources in " << this->BufferDumpThreadIds.size() << " threads");
 
-    std::string outputDeviceBufferSequenceFileName = vtkPlusConfig::GetInstance()->GetOutputPath(std::string("BufferDump_") + device->GetDeviceId() + "_" + dateAndTime + ".nrrd");
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::WaitForBufferDump()
+{
+  while (this->BufferDumpActive)
+  {
+    vtkIGSIOAccurateTimer::Delay(0.01);
+  }
+  this->JoinBufferDumpThreads();
+
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> bufferDumpGuard(this->BufferDumpMutex);
+  return this->BufferDumpStatus;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusDataCollector::IsBufferDumpInProgress() const
+{
+  return this->BufferDumpActive;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDataCollector::JoinBufferDumpThreads()
+{
+  for (std::vector<int>::iterator it = this->BufferDumpThreadIds.begin(); it != this->BufferDumpThreadIds.end(); ++it)
+  {
+    this->BufferDumpThreader->TerminateThread(*it);
+  }
+  this->BufferDumpThreadIds.clear();
+}
 
-    LOG_INFO("Write device buffer to " << outputDeviceBufferSequenceFileName);
-    vtkPlusDataSource* aSource(NULL);
-    for (ChannelContainerIterator chanIt = device->GetOutputChannelsStart(); chanIt != device->GetOutputChannelsEnd(); ++chanIt)
+//----------------------------------------------------------------------------
+void* vtkPlusDataCollector::BufferDumpThread(vtkMultiThreader::ThreadInfo* data)
+{
+  vtkPlusDataCollector* self = (vtkPlusDataCollector*)(data->UserData);
+  int numberOfJobs = static_cast<int>(self->BufferDumpJobs.size());
+
+  while (1)
+  {
+    int jobIndex = 0;
     {
-      if ((*chanIt)->GetVideoSource(aSource) != PLUS_SUCCESS)
+      igsioLockGuard<vtkIGSIORecursiveCriticalSection> bufferDumpGuard(self->BufferDumpMutex);
+      if (self->NextBufferDumpJobIndex >= numberOfJobs)
       {
-        LOG_ERROR("Unable to retrieve the video source in the device.");
-        return PLUS_FAIL;
+        break;
       }
-      aSource->WriteToSequenceFile(outputDeviceBufferSequenceFileName.c_str(), false);
+      jobIndex = self->NextBufferDumpJobIndex++;
+    }
+
+    // Each job is processed by only one thread, so the file can be written without locking
+    BufferDumpJob& job = self->BufferDumpJobs[jobIndex];
+    LOG_INFO("Write device buffer to " << job.FileName);
+    PlusStatus status = vtkPlusSequenceIO::Write(job.FileName, job.TrackedFrameList, job.TrackedFrameList->GetImageOrientation(), false);
+    if (status != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to write device buffer to " << job.FileName);
+    }
+    // Release the memory of the snapshot as soon as possible
+    job.TrackedFrameList = NULL;
+
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> bufferDumpGuard(self->BufferDumpMutex);
+    self->NumberOfWrittenBufferDumpJobs++;
+    if (status != PLUS_SUCCESS)
+    {
+      self->BufferDumpStatus = PLUS_FAIL;
     }
+    BufferDumpProgress progress;
+    progress.NumberOfWrittenSources = self->NumberOfWrittenBufferDumpJobs;
+    progress.NumberOfSources = numberOfJobs;
+    progress.FileName = job.FileName;
+    progress.Status = status;
+    self->InvokeEvent(BufferDumpProgressEvent, &progress);
   }
 
-  return PLUS_SUCCESS;
+  // The last thread reports the completion of the dump
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> bufferDumpGuard(self->BufferDumpMutex);
+  self->NumberOfFinishedBufferDumpThreads++;
+  if (self->NumberOfFinishedBufferDumpThreads == static_cast<int>(self->BufferDumpThreadIds.size()))
+  {
+    BufferDumpProgress progress;
+    progress.NumberOfWrittenSources = self->NumberOfWrittenBufferDumpJobs;
+    progress.NumberOfSources = numberOfJobs;
+    progress.Status = self->BufferDumpStatus;
+    self->InvokeEvent(BufferDumpCompletedEvent, &progress);
+    LOG_INFO("Buffer dump completed: " << self->NumberOfWrittenBufferDumpJobs << " data sources are written");
+    self->BufferDumpActive = false;
+  }
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+vtkIGSIORecursiveCriticalSection* vtkPlusDataCollector::GetDevicesMutex() const
+{
+  return this->DevicesMutex;
 }
 
 //----------------------------------------------------------------------------
@@ -720,6 +1243,7 @@ PlusStatus vtkPlusDataCollector::AddDevice(vtkPlusDevice* aDevice)
     return PLUS_FAIL;
   }
 
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> devicesGuard(this->DevicesMutex);
   vtkPlusDevice* device(nullptr);
   if (GetDevice(device, aDevice->GetDeviceId()) == PLUS_SUCCESS)
   {
@@ -735,6 +1259,7 @@ PlusStatus vtkPlusDataCollector::AddDevice(vtkPlusDevice* aDevice)
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDataCollector::GetChannel(vtkPlusChannel*& aChannel, const std::string& aChannelId) const
 {
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> devicesGuard(this->DevicesMutex);
   for (DeviceCollectionConstIterator it = this->Devices.begin(); it != this->Devices.end(); ++it)
   {
     if ((*it)->GetOutputChannelByName(aChannel, aChannelId.c_str()) == PLUS_SUCCESS)
@@ -13,12 +13,19 @@ See License.txt for details.
 #include "vtkPlusDevice.h"
 
 // VTK includes
+#include <vtkCommand.h>
+#include <vtkMultiThreader.h>
 #include <vtkObject.h>
 
+// STL includes
+#include <atomic>
+#include <map>
+
 //class igsioTrackedFrame; 
+class vtkIGSIORecursiveCriticalSection;
+class vtkIGSIOTrackedFrameList;
 class vtkPlusChannel;
 class vtkPlusDeviceFactory;
-//class vtkIGSIOTrackedFrameList;
 class vtkXMLDataElement;
 
 /*!
@@ -36,6 +43,34 @@ public:
   vtkTypeMacro(vtkPlusDataCollector, vtkObject);
   virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
 
+  /*!
+    Events invoked during a buffer dump, the call data is a pointer to a BufferDumpProgress structure.
+    BufferDumpProgressEvent is invoked after each data source is written, BufferDumpCompletedEvent after all of them.
+    The events are invoked in the writer threads (one at a time), therefore observers must be thread-safe and return quickly.
+
+    ConfigurationAppliedEvent is invoked by ApplyConfiguration after devices and channels are modified (also if some of them failed),
+    from the calling thread while the devices mutex is still locked, without call data. Observers can look up the new channels there.
+  */
+  enum
+  {
+    BufferDumpProgressEvent = vtkCommand::UserEvent + 1,
+    BufferDumpCompletedEvent,
+    ConfigurationAppliedEvent
+  };
+
+  /*! State of a buffer dump, passed to the observers of the buffer dump events */
+  struct BufferDumpProgress
+  {
+    /*! Number of data sources that are written (successfully or not) */
+    int NumberOfWrittenSources;
+    /*! Number of data sources in the dump */
+    int NumberOfSources;
+    /*! File of the data source that has just been written. Empty in BufferDumpCompletedEvent. */
+    std::string FileName;
+    /*! Result of writing the file, or in BufferDumpCompletedEvent the result of the whole dump */
+    PlusStatus Status;
+  };
+
   /*!
   Read main configuration from xml data
   */
@@ -46,6 +81,24 @@ public:
   */
   PlusStatus WriteConfiguration(vtkXMLDataElement* aConfig);
 
+  /*!
+    Apply a modified device set configuration without reconnecting all the devices.
+    Each device element is compared to the configuration that the device was created from.
+    If only attributes that can be changed while the device is connected differ (see vtkPlusDevice::ApplyConfigurationChanges)
+    then the changes are applied to the running device. Devices with other changes are replaced by a new instance,
+    which is connected (and started, if the old one was recording) in place of the old one.
+    Changes are applied to a running device only if the devices that use its output channels acquire their data
+    in the internal update thread, as they are paused by locking their update mutex.
+    Adding or removing devices, or replacing a device whose output channels are used by other devices, requires
+    a full reconnect and is rejected without modifying any device. The devices mutex is locked while the changes are
+    applied to the running devices and while a device is replaced, but not while the new instance connects.
+    Observers of ConfigurationAppliedEvent are notified with the devices mutex locked, the replaced devices are deleted after that.
+    \param aConfig Root element of the new device set configuration
+    \param updatedDeviceIds Devices that the changes are applied to
+    \param restartedDeviceIds Devices that are replaced by a new instance
+  */
+  PlusStatus ApplyConfiguration(vtkXMLDataElement* aConfig, std::vector<std::string>& updatedDeviceIds, std::vector<std::string>& restartedDeviceIds);
+
   /*!
   Set the factory instance used to create devices
   */
@@ -107,18 +160,43 @@ public:
   PlusStatus GetFirstChannel(vtkPlusChannel*& aChannel) const;
 
   /*!
-    Allow iteration over devices
+    Allow iteration over devices.
+    Threads other than the one that applies configuration changes must lock the devices mutex while iterating.
   */
   DeviceCollectionConstIterator GetDeviceConstIteratorBegin() const;
   DeviceCollectionConstIterator GetDeviceConstIteratorEnd() const;
 
   /*!
-    Have each device dump their buffers to disk
-    \param aDirectory directory to dump to
-    \param maxTimeLimitSec Maximum time spent in the function (in sec)
+    Mutex that is locked while the device list is modified or devices are replaced by ApplyConfiguration.
+    Threads that iterate over the devices or read the output channels of the devices must lock it.
+  */
+  vtkIGSIORecursiveCriticalSection* GetDevicesMutex() const;
+
+  /*!
+    Have each device dump their buffers to disk and wait until all files are written.
+    Each video, tool, and field data source is written into a separate BufferDump_[DeviceId]_[SourceId]_[DateTime].nrrd file.
+    \param aDirectory directory to dump to. If empty then the files are written into the output directory.
   */
   PlusStatus DumpBuffersToDirectory(const char* aDirectory);
 
+  /*!
+    Take a snapshot of the buffers of all data sources and write them to disk in background threads.
+    Data acquisition continues during the snapshot, the buffers are locked only while an item is copied.
+    Returns after the snapshot is taken, the progress is reported by BufferDumpProgressEvent and BufferDumpCompletedEvent.
+    \param aDirectory directory to dump to. If empty then the files are written into the output directory.
+  */
+  PlusStatus StartBufferDump(const char* aDirectory);
+
+  /*! Wait until the files of the last buffer dump are written. Returns PLUS_FAIL if any of the data sources could not be dumped. */
+  PlusStatus WaitForBufferDump();
+
+  /*! Returns true if files of a buffer dump are being written */
+  bool IsBufferDumpInProgress() const;
+
+  /*! Maximum number of threads that write the files of a buffer dump in parallel */
+  vtkSetMacro(MaximumNumberOfBufferDumpThreads, int);
+  vtkGetMacro(MaximumNumberOfBufferDumpThreads, int);
+
   /*!
     Get tracking data in a tracked frame list since time specified
     \param aTimestamp The oldest timestamp we search for in the buffer. If -1 get all frames in the time range since the most recent timestamp. Out parameter - changed to timestamp of last added frame
@@ -158,6 +236,35 @@ protected:
   vtkPlusDataCollector();
   virtual ~vtkPlusDataCollector();
 
+  /*! Data source snapshot that is waiting to be written by a buffer dump thread */
+  struct BufferDumpJob
+  {
+    std::string FileName;
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> TrackedFrameList;
+  };
+
+  /*! Thread that writes buffer dump jobs until all of them are taken */
+  static void* BufferDumpThread(vtkMultiThreader::ThreadInfo* data);
+
+  /*! Wait for the buffer dump threads to exit and release them */
+  void JoinBufferDumpThreads();
+
+  /*! Add the output channels that are listed in the InputChannels element of the device to its input channels */
+  PlusStatus ConnectInputChannels(vtkPlusDevice* aDevice, vtkXMLDataElement* deviceElement);
+
+  /*! Collect the devices that use any output channel of the device as input */
+  void GetDependentDevices(vtkPlusDevice* aDevice, std::vector<vtkPlusDevice*>& dependentDevices) const;
+
+  /*! Returns true if all devices that use the output channels of the device can be paused by locking their update mutex */
+  bool CanPauseDependentDevices(vtkPlusDevice* aDevice) const;
+
+  /*!
+    Replace a device by a new instance created from the new configuration. The old device is kept if the new one cannot be connected.
+    The new device is connected without the devices mutex locked. If the device is replaced (even if the new one fails to start recording)
+    then replaced is set to true and the old device is disconnected but not deleted, the caller deletes it.
+  */
+  PlusStatus RestartDevice(vtkPlusDevice* oldDevice, vtkXMLDataElement* aConfig, vtkXMLDataElement* deviceElement, bool& replaced);
+
   /*! The timestamp filtering methods require some time to initialize. Synchronization will ignore data that are acquired during startup delay. */
   double StartupDelaySec;
 
@@ -165,9 +272,31 @@ protected:
 
   DeviceCollection Devices;
 
+  /*! Mutex for the device list and for replacing devices */
+  vtkSmartPointer<vtkIGSIORecursiveCriticalSection> DevicesMutex;
+
+  /*! Copy of the configuration of each device that is created from the device set configuration, by device Id */
+  std::map<std::string, vtkSmartPointer<vtkXMLDataElement> > DeviceConfigurations;
+
   bool Connected;
   bool Started;
 
+  int MaximumNumberOfBufferDumpThreads;
+
+  /*! Snapshots of the current buffer dump. The list is not modified while the dump threads are running. */
+  std::vector<BufferDumpJob> BufferDumpJobs;
+
+  /*! Mutex for the buffer dump state below and for serializing the buffer dump events */
+  vtkSmartPointer<vtkIGSIORecursiveCriticalSection> BufferDumpMutex;
+  int NextBufferDumpJobIndex;
+  int NumberOfWrittenBufferDumpJobs;
+  int NumberOfFinishedBufferDumpThreads;
+  PlusStatus BufferDumpStatus;
+
+  std::atomic<bool> BufferDumpActive;
+  vtkSmartPointer<vtkMultiThreader> BufferDumpThreader;
+  std::vector<int> BufferDumpThreadIds;
+
 private:
   vtkPlusDataCollector(const vtkPlusDataCollector&);
   void operator=(const vtkPlusDataCollector&);
@@ -548,20 +548,20 @@ void vtkPlusDataSource::SetCustomProperty(const std::string& propertyName, const
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusDataSource::AddItem(vtkImageData* frame, US_IMAGE_ORIENTATION usImageOrientation, US_IMAGE_TYPE imageType, long frameNumber, double unfilteredTimestamp/*=UNDEFINED_TIMESTAMP*/, double filteredTimestamp/*=UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
 {
-  return this->GetBuffer()->AddItem(frame, usImageOrientation, imageType, frameNumber, this->ClipRectangleOrigin, this->ClipRectangleSize, unfilteredTimestamp, filteredTimestamp, customFields);
+  return this->NotifyItemAdded(this->GetBuffer()->AddItem(frame, usImageOrientation, imageType, frameNumber, this->ClipRectangleOrigin, this->ClipRectangleSize, unfilteredTimestamp, filteredTimestamp, customFields));
 }
 
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusDataSource::AddItem(const igsioVideoFrame* frame, long frameNumber, double unfilteredTimestamp/*=UNDEFINED_TIMESTAMP*/, double filteredTimestamp/*=UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
 {
-  return this->GetBuffer()->AddItem(frame, frameNumber, this->ClipRectangleOrigin, this->ClipRectangleSize, unfilteredTimestamp, filteredTimestamp, customFields);
+  return this->NotifyItemAdded(this->GetBuffer()->AddItem(frame, frameNumber, this->ClipRectangleOrigin, this->ClipRectangleSize, unfilteredTimestamp, filteredTimestamp, customFields));
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDataSource::AddItem(const igsioFieldMapType& customFields, long frameNumber, double unfilteredTimestamp/*=UNDEFINED_TIMESTAMP*/,
                                       double filteredTimestamp/*=UNDEFINED_TIMESTAMP*/)
 {
-  return this->GetBuffer()->AddItem(customFields, frameNumber, unfilteredTimestamp, filteredTimestamp);
+  return this->NotifyItemAdded(this->GetBuffer()->AddItem(customFields, frameNumber, unfilteredTimestamp, filteredTimestamp));
 }
 
 //----------------------------------------------------------------------------
@@ -569,14 +569,14 @@ PlusStatus vtkPlusDataSource::AddItem(void* imageDataPtr, US_IMAGE_ORIENTATION u
                                       unsigned int numberOfScalarComponents, US_IMAGE_TYPE imageType, int numberOfBytesToSkip, long frameNumber, double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/,
                                       double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
 {
-  return this->GetBuffer()->AddItem(imageDataPtr, usImageOrientation, frameSizeInPx, pixelType, numberOfScalarComponents, imageType, numberOfBytesToSkip, frameNumber,
-                                    this->ClipRectangleOrigin, this->ClipRectangleSize, unfilteredTimestamp, filteredTimestamp, customFields);
+  return this->NotifyItemAdded(this->GetBuffer()->AddItem(imageDataPtr, usImageOrientation, frameSizeInPx, pixelType, numberOfScalarComponents, imageType, numberOfBytesToSkip, frameNumber,
+                                this->ClipRectangleOrigin, this->ClipRectangleSize, unfilteredTimestamp, filteredTimestamp, customFields));
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDataSource::AddItem(void* imageDataPtr, const FrameSizeType& frameSize, unsigned int frameSizeInBytes, US_IMAGE_TYPE imageType, long frameNumber, double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/, double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
 {
-  return this->GetBuffer()->AddItem(imageDataPtr, frameSize, frameSizeInBytes, imageType, frameNumber, unfilteredTimestamp, filteredTimestamp, customFields);
+  return this->NotifyItemAdded(this->GetBuffer()->AddItem(imageDataPtr, frameSize, frameSizeInBytes, imageType, frameNumber, unfilteredTimestamp, filteredTimestamp, customFields));
 }
 
 //-----------------------------------------------------------------------------
@@ -825,6 +825,23 @@ ItemStatus vtkPlusDataSource::GetOldestStreamBufferItem(StreamBufferItem* buffer
   return this->GetBuffer()->GetOldestStreamBufferItem(bufferItem);
 }
 
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::AddStridedItem(vtkPlusDataSource* sourceDataSource, BufferItemUidType sourceUid, const std::array<int, 2>& firstPixel, const std::array<int, 2>& pixelStride, long frameNumber)
+{
+  if (sourceDataSource == NULL)
+  {
+    LOG_ERROR("Unable to add strided item, invalid source data source");
+    return PLUS_FAIL;
+  }
+  return this->NotifyItemAdded(this->GetBuffer()->AddStridedItem(sourceDataSource->GetBuffer(), sourceUid, firstPixel, pixelStride, frameNumber, this->ClipRectangleOrigin, this->ClipRectangleSize));
+}
+
+//-----------------------------------------------------------------------------
+ItemStatus vtkPlusDataSource::GetStreamBufferItemImageRegion(BufferItemUidType uid, const std::array<int, 3>& regionOrigin, const std::array<int, 3>& regionSize, vtkImageData* regionImage)
+{
+  return this->GetBuffer()->GetStreamBufferItemImageRegion(uid, regionOrigin, regionSize, regionImage);
+}
+
 //-----------------------------------------------------------------------------
 ItemStatus vtkPlusDataSource::GetStreamBufferItemFromTime(double time, StreamBufferItem* bufferItem, vtkPlusBuffer::DataItemTemporalInterpolationType interpolation)
 {
@@ -909,6 +926,12 @@ PlusStatus vtkPlusDataSource::WriteToSequenceFile(const char* filename, bool use
   return this->GetBuffer()->WriteToSequenceFile(filename, useCompression);
 }
 
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::CopyToTrackedFrameList(vtkIGSIOTrackedFrameList* trackedFrameList)
+{
+  return this->GetBuffer()->CopyToTrackedFrameList(trackedFrameList);
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusDataSource::DeepCopyBufferTo(vtkPlusBuffer& bufferToFill)
 {
@@ -920,7 +943,17 @@ PlusStatus vtkPlusDataSource::DeepCopyBufferTo(vtkPlusBuffer& bufferToFill)
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusDataSource::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp/*=UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
 {
-  return this->GetBuffer()->AddTimeStampedItem(matrix, status, frameNumber, unfilteredTimestamp, filteredTimestamp, customFields);
+  return this->NotifyItemAdded(this->GetBuffer()->AddTimeStampedItem(matrix, status, frameNumber, unfilteredTimestamp, filteredTimestamp, customFields));
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::NotifyItemAdded(PlusStatus addItemStatus)
+{
+  if (addItemStatus == PLUS_SUCCESS)
+  {
+    this->InvokeEvent(ItemAddedEvent);
+  }
+  return addItemStatus;
 }
 
 //-----------------------------------------------------------------------------
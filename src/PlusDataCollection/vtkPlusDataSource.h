@@ -20,6 +20,7 @@
 #include "vtkPlusDevice.h"
 
 // VTK includes
+#include <vtkCommand.h>
 #include <vtkObject.h>
 
 /*!
@@ -55,6 +56,16 @@ public:
   vtkTypeMacro(vtkPlusDataSource, vtkObject);
   virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
 
+  /*!
+    Event invoked after an item is successfully added to the buffer.
+    The event is invoked in the thread that added the item, therefore observers must be thread-safe and return quickly.
+    Observers should be added and removed only while the data acquisition is stopped.
+  */
+  enum
+  {
+    ItemAddedEvent = vtkCommand::UserEvent + 1
+  };
+
   /*! Read main configuration from xml data */
   virtual PlusStatus ReadConfiguration(vtkXMLDataElement* toolElement, bool requirePortNameInSourceConfiguration = false, bool requireImageOrientationInChannelConfiguration = false, const std::string& aDescriptiveNameForBuffer = std::string(""));
   /*! Write main configuration to xml data */
@@ -140,6 +151,14 @@ public:
   virtual ItemStatus GetOldestStreamBufferItem(StreamBufferItem* bufferItem);
   /*! Get a frame that was acquired at the specified time from buffer */
   virtual ItemStatus GetStreamBufferItemFromTime(double time, StreamBufferItem* bufferItem, vtkPlusBuffer::DataItemTemporalInterpolationType interpolation);
+  /*!
+    Add a frame that consists of every pixelStride[0]-th column and every pixelStride[1]-th row of an item of the source data source,
+    starting from the firstPixel column and row. The pixels are copied directly between the buffers, see vtkPlusBuffer::AddStridedItem.
+    The clip rectangle of this data source is applied to the strided frame.
+  */
+  virtual PlusStatus AddStridedItem(vtkPlusDataSource* sourceDataSource, BufferItemUidType sourceUid, const std::array<int, 2>& firstPixel, const std::array<int, 2>& pixelStride, long frameNumber);
+  /*! Copy a rectangular region of the image of the frame with the specified frame uid, without copying the full frame */
+  virtual ItemStatus GetStreamBufferItemImageRegion(BufferItemUidType uid, const std::array<int, 3>& regionOrigin, const std::array<int, 3>& regionSize, vtkImageData* regionImage);
   /*! Update a field in the specified stream buffer item */
   virtual PlusStatus ModifyBufferItemFrameField(BufferItemUidType uid, const std::string& key, const std::string& value);
 
@@ -152,6 +171,9 @@ public:
   /*! Dump the current state of the video buffer to metafile */
   virtual PlusStatus WriteToSequenceFile(const char* filename, bool useCompression = false);
 
+  /*! Append the items that are currently in the buffer to a tracked frame list without stopping data acquisition */
+  virtual PlusStatus CopyToTrackedFrameList(vtkIGSIOTrackedFrameList* trackedFrameList);
+
   /*! Get the table report of the timestamped buffer  */
   virtual PlusStatus GetTimeStampReportTable(vtkTable* timeStampReportTable);
 
@@ -360,6 +382,9 @@ protected:
   /*! Access the data buffer */
   virtual vtkPlusBuffer* GetBuffer() const;
 
+  /*! Invoke ItemAddedEvent if an item was successfully added. Returns the status unchanged. */
+  PlusStatus NotifyItemAdded(PlusStatus addItemStatus);
+
 protected:
   vtkPlusDataSource();
   ~vtkPlusDataSource();
@@ -26,6 +26,7 @@ See License.txt for details.
 #include <vtksys/SystemTools.hxx>
 
 // STD includes
+#include <algorithm>
 #include <set>
 
 // System includes
@@ -143,6 +144,9 @@ vtkPlusDevice::vtkPlusDevice()
   , MissingInputGracePeriodSec(0.0)
   , RequireImageOrientationInConfiguration(false)
   , RequirePortNameInDeviceSetConfiguration(false)
+  , NumberOfInternalUpdates(0)
+  , TotalInternalUpdateDurationUsec(0)
+  , LastInternalUpdateDurationSec(0.0)
 {
   this->SetNumberOfInputPorts(0);
 
@@ -665,6 +669,36 @@ double vtkPlusDevice::GetInternalUpdateRate() const
   return this->InternalUpdateRate;
 }
 
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusDevice::GetNumberOfInternalUpdates() const
+{
+  return this->NumberOfInternalUpdates.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusDevice::GetTotalInternalUpdateDurationSec() const
+{
+  return this->TotalInternalUpdateDurationUsec.load(std::memory_order_relaxed) * 1e-6;
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusDevice::GetLastInternalUpdateDurationSec() const
+{
+  return this->LastInternalUpdateDurationSec.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDevice::InternalUpdateWithStatistics()
+{
+  double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  PlusStatus status = this->InternalUpdate();
+  double durationSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+  this->LastInternalUpdateDurationSec.store(durationSec, std::memory_order_relaxed);
+  this->TotalInternalUpdateDurationUsec.fetch_add(static_cast<unsigned long long>(durationSec * 1e6), std::memory_order_relaxed);
+  this->NumberOfInternalUpdates.fetch_add(1, std::memory_order_relaxed);
+  return status;
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusDevice::SetAcquisitionRate(double aRate)
 {
@@ -1132,6 +1166,180 @@ PlusStatus vtkPlusDevice::ReadConfiguration(vtkXMLDataElement* rootXMLElement)
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+// Remove the attributes from a copy of a device element that vtkPlusDevice::ApplyConfigurationChanges can change
+static void RemoveLiveConfigurationAttributes(vtkXMLDataElement* deviceXMLElement, const std::vector<std::string>& liveAttributeNames, bool removeDataSources)
+{
+  for (std::vector<std::string>::const_iterator it = liveAttributeNames.begin(); it != liveAttributeNames.end(); ++it)
+  {
+    deviceXMLElement->RemoveAttribute(it->c_str());
+  }
+  if (!removeDataSources)
+  {
+    return;
+  }
+
+  vtkXMLDataElement* dataSourcesElement = deviceXMLElement->FindNestedElementWithName("DataSources");
+  if (dataSourcesElement != NULL)
+  {
+    for (int i = 0; i < dataSourcesElement->GetNumberOfNestedElements(); i++)
+    {
+      dataSourcesElement->GetNestedElement(i)->RemoveAttribute("BufferSize");
+    }
+  }
+
+  vtkXMLDataElement* outputChannelsElement = deviceXMLElement->FindNestedElementWithName("OutputChannels");
+  if (outputChannelsElement != NULL)
+  {
+    for (int channel = 0; channel < outputChannelsElement->GetNumberOfNestedElements(); channel++)
+    {
+      vtkXMLDataElement* channelElement = outputChannelsElement->GetNestedElement(channel);
+      for (int i = channelElement->GetNumberOfNestedElements() - 1; i >= 0; i--)
+      {
+        if (STRCASECMP(channelElement->GetNestedElement(i)->GetName(), "DataSource") == 0)
+        {
+          channelElement->RemoveNestedElement(channelElement->GetNestedElement(i));
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusDevice::CanApplyConfigurationChanges(vtkXMLDataElement* currentDeviceElement, vtkXMLDataElement* newDeviceElement)
+{
+  if (currentDeviceElement == NULL || newDeviceElement == NULL)
+  {
+    return false;
+  }
+
+  // Data sources and channels can only be modified while the thread that uses them is paused
+  std::vector<std::string> liveAttributeNames;
+  this->GetLiveConfigurationAttributes(liveAttributeNames);
+  const bool removeDataSources = this->GetStartThreadForInternalUpdates();
+
+  vtkSmartPointer<vtkXMLDataElement> currentElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  currentElement->DeepCopy(currentDeviceElement);
+  RemoveLiveConfigurationAttributes(currentElement, liveAttributeNames, removeDataSources);
+
+  vtkSmartPointer<vtkXMLDataElement> newElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  newElement->DeepCopy(newDeviceElement);
+  RemoveLiveConfigurationAttributes(newElement, liveAttributeNames, removeDataSources);
+
+  return currentElement->IsEqualTo(newElement) != 0;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDevice::ApplyConfigurationChanges(vtkXMLDataElement* rootXMLElement)
+{
+  LOCAL_LOG_TRACE("vtkPlusDevice::ApplyConfigurationChanges");
+
+  vtkXMLDataElement* deviceXMLElement = this->FindThisDeviceElement(rootXMLElement);
+  if (deviceXMLElement == NULL)
+  {
+    LOCAL_LOG_ERROR("Unable to find device XML element for device");
+    return PLUS_FAIL;
+  }
+
+  // Pause the internal update thread while the data sources and channels are modified
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->UpdateMutex);
+
+  PlusStatus status = PLUS_SUCCESS;
+
+  std::vector<std::string> liveAttributeNames;
+  this->GetLiveConfigurationAttributes(liveAttributeNames);
+
+  double acquisitionRate = 0;
+  if (std::find(liveAttributeNames.begin(), liveAttributeNames.end(), "AcquisitionRate") != liveAttributeNames.end()
+      && deviceXMLElement->GetScalarAttribute("AcquisitionRate", acquisitionRate) && acquisitionRate != this->GetAcquisitionRate())
+  {
+    LOCAL_LOG_INFO("Acquisition rate: " << acquisitionRate << " fps");
+    if (this->SetAcquisitionRate(acquisitionRate) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+  }
+
+  double localTimeOffsetSec = 0;
+  if (std::find(liveAttributeNames.begin(), liveAttributeNames.end(), "LocalTimeOffsetSec") != liveAttributeNames.end()
+      && deviceXMLElement->GetScalarAttribute("LocalTimeOffsetSec", localTimeOffsetSec) && localTimeOffsetSec != this->GetLocalTimeOffsetSec())
+  {
+    LOCAL_LOG_INFO("Local time offset: " << 1000 * localTimeOffsetSec << "ms");
+    this->SetLocalTimeOffsetSec(localTimeOffsetSec);
+  }
+
+  if (!this->GetStartThreadForInternalUpdates())
+  {
+    // Other threads of the device may use the data sources and channels, they cannot be paused
+    return status;
+  }
+
+  vtkXMLDataElement* dataSourcesElement = deviceXMLElement->FindNestedElementWithName("DataSources");
+  if (dataSourcesElement != NULL)
+  {
+    for (int source = 0; source < dataSourcesElement->GetNumberOfNestedElements(); source++)
+    {
+      vtkXMLDataElement* dataSourceElement = dataSourcesElement->GetNestedElement(source);
+      if (STRCASECMP(dataSourceElement->GetName(), "DataSource") != 0
+          || dataSourceElement->GetAttribute("Id") == NULL)
+      {
+        continue;
+      }
+      // Same as in vtkPlusDataSource::ReadConfiguration: the buffer has the default size if the attribute is not defined
+      int bufferSize = vtkPlusBuffer::DEFAULT_BUFFER_SIZE;
+      dataSourceElement->GetScalarAttribute("BufferSize", bufferSize);
+
+      // Tool ids are stored as transform names
+      const char* sourceId = dataSourceElement->GetAttribute("Id");
+      igsioTransformName toolName(sourceId, this->GetToolReferenceFrameName());
+      vtkPlusDataSource* aSource = NULL;
+      if (this->GetDataSource(sourceId, aSource) != PLUS_SUCCESS && this->GetDataSource(toolName.GetTransformName(), aSource) != PLUS_SUCCESS)
+      {
+        LOCAL_LOG_ERROR("Unable to find data source " << sourceId << " to change its buffer size");
+        status = PLUS_FAIL;
+        continue;
+      }
+      if (aSource->GetBufferSize() != bufferSize)
+      {
+        LOCAL_LOG_INFO("Buffer size of data source " << aSource->GetId() << ": " << bufferSize);
+        if (aSource->SetBufferSize(bufferSize) != PLUS_SUCCESS)
+        {
+          LOCAL_LOG_ERROR("Failed to set buffer size of data source " << aSource->GetId());
+          status = PLUS_FAIL;
+        }
+      }
+    }
+  }
+
+  vtkXMLDataElement* outputChannelsElement = deviceXMLElement->FindNestedElementWithName("OutputChannels");
+  if (outputChannelsElement != NULL)
+  {
+    for (int channel = 0; channel < outputChannelsElement->GetNumberOfNestedElements(); channel++)
+    {
+      vtkXMLDataElement* channelElement = outputChannelsElement->GetNestedElement(channel);
+      vtkPlusChannel* aChannel = NULL;
+      if (STRCASECMP(channelElement->GetName(), "OutputChannel") != 0
+          || this->GetOutputChannelByName(aChannel, channelElement->GetAttribute("Id")) != PLUS_SUCCESS)
+      {
+        continue;
+      }
+      if (aChannel->UpdateDataSources(channelElement) != PLUS_SUCCESS)
+      {
+        status = PLUS_FAIL;
+      }
+    }
+  }
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDevice::GetLiveConfigurationAttributes(std::vector<std::string>& attributeNames) const
+{
+  attributeNames.clear();
+  attributeNames.push_back("LocalTimeOffsetSec");
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDevice::WriteConfiguration(vtkXMLDataElement* config)
 {
@@ -1379,8 +1587,10 @@ void* vtkPlusDevice::vtkDataCaptureThread(vtkMultiThreader::ThreadInfo* data)
         // recording has been stopped
         break;
       }
-      self->InternalUpdate();
+      self->InternalUpdateWithStatistics();
       self->UpdateTime.Modified();
+      // The rate may be changed by ApplyConfigurationChanges while the thread is running
+      rate = self->GetAcquisitionRate();
     }
 
     double delay = (newtime + 1.0 / rate - vtkIGSIOAccurateTimer::GetSystemTime());
@@ -1609,7 +1819,7 @@ PlusStatus vtkPlusDevice::ForceUpdate()
 
   {
     igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->UpdateMutex);
-    this->InternalUpdate();
+    this->InternalUpdateWithStatistics();
   }
   return PLUS_SUCCESS;
 }
@@ -22,6 +22,7 @@ See License.txt for details.
 #include <set>
 
 // STL includes
+#include <atomic>
 #include <string>
 
 class vtkPlusBuffer;
@@ -84,6 +85,24 @@ public:
   /*! Write main configuration to xml data */
   virtual PlusStatus WriteConfiguration(vtkXMLDataElement*);
 
+  /*!
+  Returns true if the new device element differs from the current one only in changes that
+  ApplyConfigurationChanges can apply while the device is connected:
+  the attributes listed by GetLiveConfigurationAttributes and, if the device acquires its data
+  in the internal update thread, the BufferSize of the data sources and the data sources of the output channels.
+  */
+  virtual bool CanApplyConfigurationChanges(vtkXMLDataElement* currentDeviceElement, vtkXMLDataElement* newDeviceElement);
+
+  /*!
+  Apply the changes of the device configuration that can be applied while the device is connected
+  (see CanApplyConfigurationChanges). The internal update thread is paused while the changes are applied.
+  Attributes that are removed from the configuration keep their current values.
+  */
+  virtual PlusStatus ApplyConfigurationChanges(vtkXMLDataElement* rootXMLElement);
+
+  /*! Returns true if the data is acquired in the internal update thread, which can be paused by locking UpdateMutex */
+  bool GetStartThreadForInternalUpdates() const;
+
   /*! Connect to device. Connection is needed for recording or single frame acquisition */
   virtual PlusStatus Connect();
 
@@ -162,6 +181,18 @@ public:
   /*! Get the internal update rate for this tracking system.  This is the number of buffer entry items sent by the device per second (per tool). */
   double GetInternalUpdateRate() const;
 
+  /*!
+    Number of InternalUpdate calls made by the internal update thread (or by a single frame update) since the device was created.
+    Devices that acquire data from their own threads do not update these statistics. Can be called from any thread.
+  */
+  unsigned long long GetNumberOfInternalUpdates() const;
+
+  /*! Total time spent in InternalUpdate since the device was created (in seconds). Can be called from any thread. */
+  double GetTotalInternalUpdateDurationSec() const;
+
+  /*! Duration of the most recent InternalUpdate call (in seconds). Can be called from any thread. */
+  double GetLastInternalUpdateDurationSec() const;
+
   /*! Get the data source object for the specified Id name, checks both video and tools */
   PlusStatus GetDataSource(const char* aSourceId, vtkPlusDataSource*& aSource);
   PlusStatus GetDataSource(const std::string& aSourceId, vtkPlusDataSource*& aSource);
@@ -445,6 +476,14 @@ public:
 protected:
   static void* vtkDataCaptureThread(vtkMultiThreader::ThreadInfo* data);
 
+  /*!
+  Names of the device element attributes that ApplyConfigurationChanges applies while the device is connected.
+  Changes of other attributes restart the device. The default is LocalTimeOffsetSec, which is applied to the buffers.
+  Devices opt in to further attributes by overriding this method (and ApplyConfigurationChanges, if vtkPlusDevice does not
+  apply the attribute). Devices that use AcquisitionRate only for timing the internal update thread may add AcquisitionRate.
+  */
+  virtual void GetLiveConfigurationAttributes(std::vector<std::string>& attributeNames) const;
+
   /*! Should be overridden to connect to the hardware */
   virtual PlusStatus InternalConnect();
 
@@ -518,7 +557,6 @@ protected:
   vtkSetMacro(CorrectlyConfigured, bool);
 
   vtkSetMacro(StartThreadForInternalUpdates, bool);
-  bool GetStartThreadForInternalUpdates() const;
 
   vtkSetMacro(RecordingStartTime, double);
   double GetRecordingStartTime() const;
@@ -616,6 +654,14 @@ protected:
   bool RequirePortNameInDeviceSetConfiguration;
 
 private:
+  /*! Call InternalUpdate and update the update statistics. UpdateMutex must be locked by the caller. */
+  PlusStatus InternalUpdateWithStatistics();
+
+  /*! InternalUpdate statistics, updated without locking so that they can be monitored while the device is updated */
+  std::atomic<unsigned long long> NumberOfInternalUpdates;
+  std::atomic<unsigned long long> TotalInternalUpdateDurationUsec;
+  std::atomic<double> LastInternalUpdateDurationSec;
+
   vtkPlusDevice(const vtkPlusDevice&);   // Not implemented.
   void operator=(const vtkPlusDevice&);   // Not implemented.
 };
@@ -22,6 +22,8 @@ vtkPlusUsDevice::vtkPlusUsDevice()
   : vtkPlusDevice()
   , ImagingParameters(vtkPlusUsImagingParameters::New())
   , ImageToTransducerTransformName("")
+  , ImageToTransducerFieldsTransformName("")
+  , ImageToTransducerFieldsImagingParametersTime(0)
 {
   this->CurrentTransducerOriginPixels[0] = 0;
   this->CurrentTransducerOriginPixels[1] = 0;
@@ -30,6 +32,12 @@ vtkPlusUsDevice::vtkPlusUsDevice()
   this->CurrentPixelSpacingMm[0] = 1;
   this->CurrentPixelSpacingMm[1] = 1;
   this->CurrentPixelSpacingMm[2] = 1;
+
+  for (int i = 0; i < 3; i++)
+  {
+    this->ImageToTransducerFieldsPixelSpacingMm[i] = 0;
+    this->ImageToTransducerFieldsTransducerOriginPixels[i] = 0;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -110,15 +118,17 @@ PlusStatus vtkPlusUsDevice::SetNewImagingParameters(const vtkPlusUsImagingParame
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsDevice::AddVideoItemToVideoSource(vtkPlusDataSource& videoSource, const igsioVideoFrame& frame, long frameNumber, double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/, double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
 {
+  if (this->ImageToTransducerTransform.GetTransformName().empty())
+  {
+    return videoSource.AddItem(&frame, frameNumber, unfilteredTimestamp, filteredTimestamp, customFields);
+  }
+
   igsioFieldMapType localCustomFields;
-  if (!this->ImageToTransducerTransform.GetTransformName().empty())
+  if (customFields != NULL)
   {
-    if (customFields != NULL)
-    {
-      localCustomFields = *customFields;
-    }
-    this->CalculateImageToTransducer(localCustomFields);
+    localCustomFields = *customFields;
   }
+  this->CalculateImageToTransducer(localCustomFields);
 
   return videoSource.AddItem(&frame, frameNumber, unfilteredTimestamp, filteredTimestamp, &localCustomFields);
 }
@@ -126,17 +136,19 @@ PlusStatus vtkPlusUsDevice::AddVideoItemToVideoSource(vtkPlusDataSource& videoSo
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsDevice::AddVideoItemToVideoSource(vtkPlusDataSource& videoSource, void* imageDataPtr, US_IMAGE_ORIENTATION usImageOrientation, const FrameSizeType& frameSizeInPx, igsioCommon::VTKScalarPixelType pixelType, unsigned int numberOfScalarComponents, US_IMAGE_TYPE imageType, int numberOfBytesToSkip, long frameNumber, double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/, double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
 {
+  if (this->ImageToTransducerTransform.GetTransformName().empty())
+  {
+    return videoSource.AddItem(imageDataPtr, usImageOrientation, frameSizeInPx, pixelType, numberOfScalarComponents, imageType, numberOfBytesToSkip, frameNumber, unfilteredTimestamp, filteredTimestamp, customFields);
+  }
+
   igsioFieldMapType localCustomFields;
-  if (!this->ImageToTransducerTransform.GetTransformName().empty())
+  if (customFields != NULL)
   {
-    if (customFields != NULL)
-    {
-      localCustomFields = *customFields;
-    }
-    this->CalculateImageToTransducer(localCustomFields);
+    localCustomFields = *customFields;
   }
+  this->CalculateImageToTransducer(localCustomFields);
 
-  return videoSource.AddItem(imageDataPtr, usImageOrientation, frameSizeInPx, pixelType, numberOfScalarComponents, imageType, numberOfBytesToSkip, frameNumber, unfilteredTimestamp, filteredTimestamp, customFields);
+  return videoSource.AddItem(imageDataPtr, usImageOrientation, frameSizeInPx, pixelType, numberOfScalarComponents, imageType, numberOfBytesToSkip, frameNumber, unfilteredTimestamp, filteredTimestamp, &localCustomFields);
 }
 
 //----------------------------------------------------------------------------
@@ -274,17 +286,45 @@ PlusStatus vtkPlusUsDevice::InternalApplyImagingParameterChange()
 //----------------------------------------------------------------------------
 void vtkPlusUsDevice::CalculateImageToTransducer(igsioFieldMapType& customFields)
 {
-  std::ostringstream imageToTransducerName;
-  imageToTransducerName << ImageToTransducerTransform.GetTransformName() << "Transform";
-
-  std::ostringstream imageToTransducerTransformStr;
-  imageToTransducerTransformStr << this->CurrentPixelSpacingMm[0] << " 0 0 " << -1.0 * this->CurrentTransducerOriginPixels[0]*this->CurrentPixelSpacingMm[0];
-  imageToTransducerTransformStr << " 0 " << this->CurrentPixelSpacingMm[1] << " 0 " << -1.0 * this->CurrentTransducerOriginPixels[1]*this->CurrentPixelSpacingMm[1];
-  imageToTransducerTransformStr << " 0 0 " << this->CurrentPixelSpacingMm[2] << " " << -1.0 * this->CurrentTransducerOriginPixels[2]*this->CurrentPixelSpacingMm[2];
-  imageToTransducerTransformStr << " 0 0 0 1";
-  customFields[imageToTransducerName.str()].first = FRAMEFIELD_NONE;
-  customFields[imageToTransducerName.str()].second = imageToTransducerTransformStr.str();
-  imageToTransducerName << "Status";
-  customFields[imageToTransducerName.str()].first = FRAMEFIELD_NONE;
-  customFields[imageToTransducerName.str()].second = "OK";
+  // Spacing and origin are set directly by the subclasses, so they are compared to the cached values as well
+  std::string transformName = this->ImageToTransducerTransform.GetTransformName();
+  bool upToDate = !this->ImageToTransducerFields.empty()
+                  && this->ImageToTransducerFieldsImagingParametersTime == this->ImagingParameters->GetMTime()
+                  && this->ImageToTransducerFieldsTransformName == transformName;
+  for (int i = 0; upToDate && i < 3; i++)
+  {
+    upToDate = this->ImageToTransducerFieldsPixelSpacingMm[i] == this->CurrentPixelSpacingMm[i]
+               && this->ImageToTransducerFieldsTransducerOriginPixels[i] == this->CurrentTransducerOriginPixels[i];
+  }
+
+  if (!upToDate)
+  {
+    std::ostringstream imageToTransducerName;
+    imageToTransducerName << transformName << "Transform";
+
+    std::ostringstream imageToTransducerTransformStr;
+    imageToTransducerTransformStr << this->CurrentPixelSpacingMm[0] << " 0 0 " << -1.0 * this->CurrentTransducerOriginPixels[0]*this->CurrentPixelSpacingMm[0];
+    imageToTransducerTransformStr << " 0 " << this->CurrentPixelSpacingMm[1] << " 0 " << -1.0 * this->CurrentTransducerOriginPixels[1]*this->CurrentPixelSpacingMm[1];
+    imageToTransducerTransformStr << " 0 0 " << this->CurrentPixelSpacingMm[2] << " " << -1.0 * this->CurrentTransducerOriginPixels[2]*this->CurrentPixelSpacingMm[2];
+    imageToTransducerTransformStr << " 0 0 0 1";
+    this->ImageToTransducerFields.clear();
+    this->ImageToTransducerFields[imageToTransducerName.str()].first = FRAMEFIELD_NONE;
+    this->ImageToTransducerFields[imageToTransducerName.str()].second = imageToTransducerTransformStr.str();
+    imageToTransducerName << "Status";
+    this->ImageToTransducerFields[imageToTransducerName.str()].first = FRAMEFIELD_NONE;
+    this->ImageToTransducerFields[imageToTransducerName.str()].second = "OK";
+
+    this->ImageToTransducerFieldsTransformName = transformName;
+    this->ImageToTransducerFieldsImagingParametersTime = this->ImagingParameters->GetMTime();
+    for (int i = 0; i < 3; i++)
+    {
+      this->ImageToTransducerFieldsPixelSpacingMm[i] = this->CurrentPixelSpacingMm[i];
+      this->ImageToTransducerFieldsTransducerOriginPixels[i] = this->CurrentTransducerOriginPixels[i];
+    }
+  }
+
+  for (igsioFieldMapType::const_iterator it = this->ImageToTransducerFields.begin(); it != this->ImageToTransducerFields.end(); ++it)
+  {
+    customFields[it->first] = it->second;
+  }
 }
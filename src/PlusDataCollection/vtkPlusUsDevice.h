@@ -111,6 +111,11 @@ protected:
   /*! Set changed imaging parameter to device */
   virtual PlusStatus InternalApplyImagingParameterChange();
 
+  /*!
+    Add the ImageToTransducer transform and its status to the custom fields.
+    The field values are formatted only when the pixel spacing, transducer origin, transform name, or imaging parameters change,
+    otherwise the previously formatted values are reused.
+  */
   void CalculateImageToTransducer(igsioFieldMapType& customFields);
 
   vtkPlusUsDevice();
@@ -128,6 +133,14 @@ protected:
   igsioTransformName ImageToTransducerTransform;
   std::string ImageToTransducerTransformName;
 
+  /// Preformatted ImageToTransducer custom fields
+  igsioFieldMapType ImageToTransducerFields;
+  /// Values that the preformatted ImageToTransducer custom fields were computed from
+  double ImageToTransducerFieldsPixelSpacingMm[3];
+  int ImageToTransducerFieldsTransducerOriginPixels[3];
+  std::string ImageToTransducerFieldsTransformName;
+  vtkMTimeType ImageToTransducerFieldsImagingParametersTime;
+
 private:
   vtkPlusUsDevice(const vtkPlusUsDevice&);  // Not implemented.
   void operator=(const vtkPlusUsDevice&);  // Not implemented.
@@ -7,12 +7,26 @@ See License.txt for details.
 #include "PlusConfigure.h"
 #include "vtkPlusUsImagingParameters.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <iterator>
+#include <limits>
 
 //----------------------------------------------------------------------------
 
 vtkStandardNewMacro(vtkPlusUsImagingParameters);
 
+//----------------------------------------------------------------------------
+namespace
+{
+  /// Image size components may be set from any string, so they are clamped to the valid range before the conversion
+  unsigned int ImageSizeComponentFromNumber(double number)
+  {
+    return static_cast<unsigned int>(std::min(std::max(number, 0.0), static_cast<double>(std::numeric_limits<unsigned int>::max())));
+  }
+}
+
 //----------------------------------------------------------------------------
 
 const char* vtkPlusUsImagingParameters::XML_ELEMENT_TAG   = "UsImagingParameters";
@@ -30,6 +44,15 @@ const char* vtkPlusUsImagingParameters::KEY_SOUNDVELOCITY = "SoundVelocity";
 const char* vtkPlusUsImagingParameters::KEY_VOLTAGE       = "Voltage";
 const char* vtkPlusUsImagingParameters::KEY_IMAGESIZE     = "ImageSize";
 
+//----------------------------------------------------------------------------
+vtkPlusUsImagingParameters::ParameterInfo::ParameterInfo(const std::string& defaultValue)
+  : Value(defaultValue)
+  , Set(false)
+  , Pending(false)
+{
+  this->IsNumeric = ParseNumbers(defaultValue, this->Numbers);
+}
+
 //----------------------------------------------------------------------------
 vtkPlusUsImagingParameters::vtkPlusUsImagingParameters()
   : vtkObject()
@@ -47,6 +70,21 @@ vtkPlusUsImagingParameters::vtkPlusUsImagingParameters()
   this->Parameters[KEY_SOUNDVELOCITY] = ParameterInfo("1540");
   this->Parameters[KEY_VOLTAGE] = ParameterInfo("-1");
   this->Parameters[KEY_IMAGESIZE] = ParameterInfo("-1 -1 -1");
+
+  // Elements of a std::map are never moved, so the pointers remain valid when new parameters are added
+  this->KnownParameters[PARAMETER_FREQUENCY] = &this->Parameters[KEY_FREQUENCY];
+  this->KnownParameters[PARAMETER_DEPTH] = &this->Parameters[KEY_DEPTH];
+  this->KnownParameters[PARAMETER_DYNRANGE] = &this->Parameters[KEY_DYNRANGE];
+  this->KnownParameters[PARAMETER_GAIN] = &this->Parameters[KEY_GAIN];
+  this->KnownParameters[PARAMETER_TGC] = &this->Parameters[KEY_TGC];
+  this->KnownParameters[PARAMETER_INTENSITY] = &this->Parameters[KEY_INTENSITY];
+  this->KnownParameters[PARAMETER_CONTRAST] = &this->Parameters[KEY_CONTRAST];
+  this->KnownParameters[PARAMETER_POWER] = &this->Parameters[KEY_POWER];
+  this->KnownParameters[PARAMETER_SECTOR] = &this->Parameters[KEY_SECTOR];
+  this->KnownParameters[PARAMETER_ZOOM] = &this->Parameters[KEY_ZOOM];
+  this->KnownParameters[PARAMETER_SOUNDVELOCITY] = &this->Parameters[KEY_SOUNDVELOCITY];
+  this->KnownParameters[PARAMETER_VOLTAGE] = &this->Parameters[KEY_VOLTAGE];
+  this->KnownParameters[PARAMETER_IMAGESIZE] = &this->Parameters[KEY_IMAGESIZE];
 }
 
 //----------------------------------------------------------------------------
@@ -58,77 +96,67 @@ vtkPlusUsImagingParameters::~vtkPlusUsImagingParameters()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::SetFrequencyMhz(double aFrequencyMhz)
 {
-  return this->SetValue<double>(KEY_FREQUENCY, aFrequencyMhz);
+  return this->SetNumericValue(PARAMETER_FREQUENCY, aFrequencyMhz);
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::GetFrequencyMhz(double& aFrequencyMhz) const
 {
-  return this->GetValue<double>(KEY_FREQUENCY, aFrequencyMhz);
+  return this->GetNumericValue(PARAMETER_FREQUENCY, aFrequencyMhz);
 }
 
 //----------------------------------------------------------------------------
 double vtkPlusUsImagingParameters::GetFrequencyMhz() const
 {
   double aValue;
-  this->GetValue<double>(KEY_FREQUENCY, aValue);
+  this->GetNumericValue(PARAMETER_FREQUENCY, aValue);
   return aValue;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::SetDepthMm(double aDepthMm)
 {
-  return this->SetValue<double>(KEY_DEPTH, aDepthMm);
+  return this->SetNumericValue(PARAMETER_DEPTH, aDepthMm);
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::GetDepthMm(double& aDepthMm) const
 {
-  return this->GetValue<double>(KEY_DEPTH, aDepthMm);
+  return this->GetNumericValue(PARAMETER_DEPTH, aDepthMm);
 }
 
 //----------------------------------------------------------------------------
 double vtkPlusUsImagingParameters::GetDepthMm() const
 {
   double aValue;
-  this->GetValue<double>(KEY_DEPTH, aValue);
+  this->GetNumericValue(PARAMETER_DEPTH, aValue);
   return aValue;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::SetGainPercent(double aGainPercent)
 {
-  return this->SetValue<double>(KEY_GAIN, aGainPercent);
+  return this->SetNumericValue(PARAMETER_GAIN, aGainPercent);
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::GetGainPercent(double aGainPercent) const
 {
-  return this->GetValue<double>(KEY_GAIN, aGainPercent);
+  return this->GetNumericValue(PARAMETER_GAIN, aGainPercent);
 }
 
 //----------------------------------------------------------------------------
 double vtkPlusUsImagingParameters::GetGainPercent() const
 {
   double aValue;
-  this->GetValue<double>(KEY_GAIN, aValue);
+  this->GetNumericValue(PARAMETER_GAIN, aValue);
   return aValue;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::SetTimeGainCompensation(const std::vector<double>& tgc)
 {
-  std::stringstream result;
-  std::copy(tgc.begin(), tgc.end(), std::ostream_iterator<double>(result, " "));
-
-  if (this->Parameters[KEY_TGC].Value != result.str())
-  {
-    // If the value changed, then mark it pending
-    this->Parameters[KEY_TGC].Pending = true;
-  }
-  this->Parameters[KEY_TGC].Value = result.str();
-  this->Parameters[KEY_TGC].Set = true;
-  return PLUS_SUCCESS;
+  return this->SetNumericValue(PARAMETER_TGC, tgc);
 }
 
 //----------------------------------------------------------------------------
@@ -141,22 +169,7 @@ PlusStatus vtkPlusUsImagingParameters::SetTimeGainCompensation(double* tgc, int
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::GetTimeGainCompensation(std::vector<double>& tgc) const
 {
-  ParameterMapConstIterator keyIt = this->Parameters.find(KEY_TGC);
-  if (keyIt != this->Parameters.end() && keyIt->second.Set == false)
-  {
-    return PLUS_FAIL;
-  }
-  else if (keyIt == this->Parameters.end())
-  {
-    return PLUS_FAIL;
-  }
-
-  std::stringstream ss;
-  ParameterMapConstIterator it = this->Parameters.find(KEY_TGC);
-  ss.str(it->second.Value);
-  std::vector<double> numbers((std::istream_iterator<double>(ss)), std::istream_iterator<double>());
-  tgc = numbers;
-  return PLUS_SUCCESS;
+  return this->GetNumericValue(PARAMETER_TGC, tgc);
 }
 
 //----------------------------------------------------------------------------
@@ -170,140 +183,140 @@ std::vector<double> vtkPlusUsImagingParameters::GetTimeGainCompensation() const
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::SetIntensity(double aIntensity)
 {
-  return this->SetValue<double>(KEY_INTENSITY, aIntensity);
+  return this->SetNumericValue(PARAMETER_INTENSITY, aIntensity);
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::GetIntensity(double& aIntensity) const
 {
-  return this->GetValue<double>(KEY_INTENSITY, aIntensity);
+  return this->GetNumericValue(PARAMETER_INTENSITY, aIntensity);
 }
 
 //----------------------------------------------------------------------------
 double vtkPlusUsImagingParameters::GetIntensity() const
 {
   double aValue;
-  this->GetValue<double>(KEY_INTENSITY, aValue);
+  this->GetNumericValue(PARAMETER_INTENSITY, aValue);
   return aValue;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::SetContrast(double aContrast)
 {
-  return this->SetValue<double>(KEY_CONTRAST, aContrast);
+  return this->SetNumericValue(PARAMETER_CONTRAST, aContrast);
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::GetContrast(double& aContrast) const
 {
-  return this->GetValue<double>(KEY_CONTRAST, aContrast);
+  return this->GetNumericValue(PARAMETER_CONTRAST, aContrast);
 }
 
 //----------------------------------------------------------------------------
 double vtkPlusUsImagingParameters::GetContrast() const
 {
   double aValue;
-  this->GetValue<double>(KEY_CONTRAST, aValue);
+  this->GetNumericValue(PARAMETER_CONTRAST, aValue);
   return aValue;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::SetPowerDb(double aPower)
 {
-  return this->SetValue<double>(KEY_POWER, aPower);
+  return this->SetNumericValue(PARAMETER_POWER, aPower);
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::GetPowerDb(double& aPower) const
 {
-  return this->GetValue<double>(KEY_POWER, aPower);
+  return this->GetNumericValue(PARAMETER_POWER, aPower);
 }
 
 //----------------------------------------------------------------------------
 double vtkPlusUsImagingParameters::GetPowerDb() const
 {
   double aValue;
-  this->GetValue<double>(KEY_POWER, aValue);
+  this->GetNumericValue(PARAMETER_POWER, aValue);
   return aValue;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::SetDynRangeDb(double aDynRangeDb)
 {
-  return this->SetValue<double>(KEY_DYNRANGE, aDynRangeDb);
+  return this->SetNumericValue(PARAMETER_DYNRANGE, aDynRangeDb);
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::GetDynRangeDb(double& aDynRangeDb) const
 {
-  return this->GetValue<double>(KEY_DYNRANGE, aDynRangeDb);
+  return this->GetNumericValue(PARAMETER_DYNRANGE, aDynRangeDb);
 }
 
 //----------------------------------------------------------------------------
 double vtkPlusUsImagingParameters::GetDynRangeDb() const
 {
   double aValue;
-  this->GetValue<double>(KEY_DYNRANGE, aValue);
+  this->GetNumericValue(PARAMETER_DYNRANGE, aValue);
   return aValue;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::SetZoomFactor(double aZoomFactor)
 {
-  return this->SetValue<double>(KEY_ZOOM, aZoomFactor);
+  return this->SetNumericValue(PARAMETER_ZOOM, aZoomFactor);
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::GetZoomFactor(double& aZoomFactor) const
 {
-  return this->GetValue<double>(KEY_ZOOM, aZoomFactor);
+  return this->GetNumericValue(PARAMETER_ZOOM, aZoomFactor);
 }
 
 //----------------------------------------------------------------------------
 double vtkPlusUsImagingParameters::GetZoomFactor() const
 {
   double aValue;
-  this->GetValue<double>(KEY_ZOOM, aValue);
+  this->GetNumericValue(PARAMETER_ZOOM, aValue);
   return aValue;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::SetSectorPercent(double aSectorPercent)
 {
-  return this->SetValue<double>(KEY_SECTOR, aSectorPercent);
+  return this->SetNumericValue(PARAMETER_SECTOR, aSectorPercent);
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::GetSectorPercent(double& aSectorPercent) const
 {
-  return this->GetValue<double>(KEY_SECTOR, aSectorPercent);
+  return this->GetNumericValue(PARAMETER_SECTOR, aSectorPercent);
 }
 
 //----------------------------------------------------------------------------
 double vtkPlusUsImagingParameters::GetSectorPercent() const
 {
   double aValue;
-  this->GetValue<double>(KEY_SECTOR, aValue);
+  this->GetNumericValue(PARAMETER_SECTOR, aValue);
   return aValue;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::SetSoundVelocity(float aSoundVelocity)
 {
-  return this->SetValue<float>(KEY_SOUNDVELOCITY, aSoundVelocity);
+  return this->SetNumericValue(PARAMETER_SOUNDVELOCITY, aSoundVelocity);
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::GetSoundVelocity(float& aSoundVelocity) const
 {
-  return this->GetValue<float>(KEY_SOUNDVELOCITY, aSoundVelocity);
+  return this->GetNumericValue(PARAMETER_SOUNDVELOCITY, aSoundVelocity);
 }
 
 //----------------------------------------------------------------------------
 float vtkPlusUsImagingParameters::GetSoundVelocity() const
 {
   float aValue;
-  this->GetValue<float>(KEY_SOUNDVELOCITY, aValue);
+  this->GetNumericValue(PARAMETER_SOUNDVELOCITY, aValue);
   return aValue;
 }
 
@@ -323,38 +336,28 @@ vtkPlusUsImagingParameters::ParameterMapConstIterator vtkPlusUsImagingParameters
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::SetProbeVoltage(float aVoltage)
 {
-  return this->SetValue<float>(KEY_VOLTAGE, aVoltage);
+  return this->SetNumericValue(PARAMETER_VOLTAGE, aVoltage);
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::GetProbeVoltage(float& aVoltage) const
 {
-  return this->GetValue<float>(KEY_VOLTAGE, aVoltage);
+  return this->GetNumericValue(PARAMETER_VOLTAGE, aVoltage);
 }
 
 //----------------------------------------------------------------------------
 float vtkPlusUsImagingParameters::GetProbeVoltage() const
 {
   float aValue;
-  this->GetValue<float>(KEY_VOLTAGE, aValue);
+  this->GetNumericValue(PARAMETER_VOLTAGE, aValue);
   return aValue;
 }
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::SetImageSize(const FrameSizeType& imageSize)
 {
-  std::stringstream result;
-  std::copy(imageSize.begin(), imageSize.end(), std::ostream_iterator<double>(result, " "));
-
-  if (this->Parameters[KEY_IMAGESIZE].Value != result.str())
-  {
-    // If the value changed, then mark it pending
-    this->Parameters[KEY_IMAGESIZE].Pending = true;
-  }
-  this->Parameters[KEY_IMAGESIZE].Value = result.str();
-  this->Parameters[KEY_IMAGESIZE].Set = true;
-
-  return PLUS_SUCCESS;
+  std::vector<double> imageSizeVec(imageSize.begin(), imageSize.end());
+  return this->SetNumericValue(PARAMETER_IMAGESIZE, imageSizeVec);
 }
 
 //----------------------------------------------------------------------------
@@ -367,29 +370,20 @@ PlusStatus vtkPlusUsImagingParameters::SetImageSize(unsigned int x, unsigned int
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusUsImagingParameters::GetImageSize(FrameSizeType& imageSize) const
 {
-  ParameterMapConstIterator keyIt = this->Parameters.find(KEY_IMAGESIZE);
-  if (keyIt != this->Parameters.end() && keyIt->second.Set == false)
-  {
-    return PLUS_FAIL;
-  }
-  else if (keyIt == this->Parameters.end())
+  std::vector<double> numbers;
+  if (this->GetNumericValue(PARAMETER_IMAGESIZE, numbers) != PLUS_SUCCESS || numbers.empty())
   {
     return PLUS_FAIL;
   }
 
-  std::stringstream ss;
-  ParameterMapConstIterator it = this->Parameters.find(KEY_IMAGESIZE);
-  ss.str(it->second.Value);
-  std::vector<unsigned int> numbers((std::istream_iterator<unsigned int>(ss)), std::istream_iterator<unsigned int>());
-
-  imageSize[0] = numbers[0];
+  imageSize[0] = ImageSizeComponentFromNumber(numbers[0]);
   if (numbers.size() > 1)
   {
-    imageSize[1] = numbers[1];
+    imageSize[1] = ImageSizeComponentFromNumber(numbers[1]);
   }
   if (numbers.size() > 2)
   {
-    imageSize[2] = numbers[2];
+    imageSize[2] = ImageSizeComponentFromNumber(numbers[2]);
   }
   return PLUS_SUCCESS;
 }
@@ -447,13 +441,7 @@ PlusStatus vtkPlusUsImagingParameters::ReadConfiguration(vtkXMLDataElement* devi
       continue;
     }
 
-    if (this->Parameters[name].Value != value)
-    {
-      // If the value changed, then mark it pending
-      this->Parameters[name].Pending = true;
-    }
-    this->Parameters[name].Value = value;
-    this->Parameters[name].Set = true;
+    this->SetSerializedValue(this->Parameters[name], value);
   }
 
   return PLUS_SUCCESS;
@@ -549,14 +537,137 @@ PlusStatus vtkPlusUsImagingParameters::DeepCopy(const vtkPlusUsImagingParameters
 {
   for (ParameterMapConstIterator it = otherParameters.Parameters.begin(); it != otherParameters.Parameters.end(); ++it)
   {
-    if (this->Parameters[it->first].Value != it->second.Value)
+    ParameterInfo& parameter = this->Parameters[it->first];
+    if (parameter.Value != it->second.Value || parameter.IsNumeric != it->second.IsNumeric || parameter.Numbers != it->second.Numbers)
     {
       // If the value changed, then mark it pending
-      this->Parameters[it->first].Pending = true;
+      parameter.Pending = true;
+      parameter.Value = it->second.Value;
+      parameter.Numbers = it->second.Numbers;
+      parameter.IsNumeric = it->second.IsNumeric;
+      this->Modified();
+    }
+    if (parameter.Set != it->second.Set)
+    {
+      parameter.Set = it->second.Set;
+      this->Modified();
     }
-    this->Parameters[it->first].Value = it->second.Value;
-    this->Parameters[it->first].Set = it->second.Set;
   }
 
   return PLUS_SUCCESS;
 }
+
+//-----------------------------------------------------------------------------
+void vtkPlusUsImagingParameters::SetSerializedValue(ParameterInfo& parameter, const std::string& value)
+{
+  if (parameter.Value != value)
+  {
+    // If the value changed, then mark it pending
+    parameter.Pending = true;
+    parameter.Value = value;
+    parameter.IsNumeric = ParseNumbers(value, parameter.Numbers);
+    this->Modified();
+  }
+  if (!parameter.Set)
+  {
+    parameter.Set = true;
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusUsImagingParameters::SetNumericValue(KnownParameterId parameterId, const std::vector<double>& values)
+{
+  ParameterInfo& parameter = *this->KnownParameters[parameterId];
+  if (!parameter.IsNumeric || parameter.Numbers != values)
+  {
+    // Devices use the numeric value, so the parameter is pending even if the change is too small to show up in the serialized value
+    parameter.Pending = true;
+    // The serialized value is only needed for configuration files and the generic interface, so it is formatted only if the value is changed
+    std::stringstream result;
+    if (values.size() == 1 && parameterId != PARAMETER_TGC && parameterId != PARAMETER_IMAGESIZE)
+    {
+      result << values[0];
+    }
+    else
+    {
+      std::copy(values.begin(), values.end(), std::ostream_iterator<double>(result, " "));
+    }
+    parameter.Value = result.str();
+    parameter.Numbers = values;
+    parameter.IsNumeric = true;
+    this->Modified();
+  }
+  if (!parameter.Set)
+  {
+    parameter.Set = true;
+    this->Modified();
+  }
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusUsImagingParameters::SetNumericValue(KnownParameterId parameterId, double value)
+{
+  return this->SetNumericValue(parameterId, std::vector<double>(1, value));
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusUsImagingParameters::GetNumericValue(KnownParameterId parameterId, std::vector<double>& values) const
+{
+  const ParameterInfo& parameter = *this->KnownParameters[parameterId];
+  if (!parameter.Set || !parameter.IsNumeric)
+  {
+    return PLUS_FAIL;
+  }
+  values = parameter.Numbers;
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusUsImagingParameters::GetNumericValue(KnownParameterId parameterId, double& value) const
+{
+  const ParameterInfo& parameter = *this->KnownParameters[parameterId];
+  if (!parameter.Set || !parameter.IsNumeric || parameter.Numbers.empty())
+  {
+    return PLUS_FAIL;
+  }
+  value = parameter.Numbers[0];
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusUsImagingParameters::GetNumericValue(KnownParameterId parameterId, float& value) const
+{
+  double doubleValue = 0;
+  if (this->GetNumericValue(parameterId, doubleValue) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  value = static_cast<float>(doubleValue);
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkPlusUsImagingParameters::ParseNumbers(const std::string& str, std::vector<double>& numbers)
+{
+  numbers.clear();
+  const char* current = str.c_str();
+  while (true)
+  {
+    char* end = NULL;
+    double number = strtod(current, &end);
+    if (end == current)
+    {
+      break;
+    }
+    numbers.push_back(number);
+    current = end;
+  }
+  // Only trailing whitespace is allowed after the last number
+  while (*current != 0 && isspace(static_cast<unsigned char>(*current)))
+  {
+    current++;
+  }
+  return *current == 0 && !numbers.empty();
+}
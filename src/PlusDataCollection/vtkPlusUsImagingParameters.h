@@ -11,6 +11,7 @@ See License.txt for details.
 
 #include <string>
 #include <map>
+#include <vector>
 
 /*!
 \class vtkPlusUsImagingParameters
@@ -35,6 +36,11 @@ Currently contains the following items
 * Voltage
 * ImageSize [x, y, z]
 * SoundVelocity
+
+Each parameter is stored both in serialized (string) form, which is used for configuration files and the generic
+key/value interface, and as parsed numbers, which are used by the typed accessors (GetDepthMm, ...) without
+any string conversion. The modification time of the object (GetMTime) is updated whenever any parameter value
+changes, so derived values can be recomputed only when needed.
 */
 
 class vtkPlusDataCollectionExport vtkPlusUsImagingParameters : public vtkObject
@@ -43,8 +49,8 @@ protected:
   class ParameterInfo
   {
   public:
-    ParameterInfo() : Value(""), Set(false), Pending(false) {};
-    ParameterInfo(std::string defaultValue) : Value(defaultValue), Set(false), Pending(false) {};
+    ParameterInfo() : Value(""), Set(false), Pending(false), IsNumeric(false) {};
+    ParameterInfo(const std::string& defaultValue);
 
     /// Serialized parameter value
     std::string Value;
@@ -53,6 +59,10 @@ protected:
     bool Set;
     /// Flag indicating whether the parameter is changed but has not been set to device
     bool Pending;
+    /// Numbers parsed from the serialized value (one element for scalar parameters)
+    std::vector<double> Numbers;
+    /// Flag indicating whether the serialized value consists of numbers only
+    bool IsNumeric;
   };
   typedef std::map<std::string, ParameterInfo> ParameterMap;
   typedef ParameterMap::iterator ParameterMapIterator;
@@ -136,12 +146,7 @@ public:
   {
     std::stringstream ss;
     ss << aValue;
-    if (this->Parameters[paramName].Value != ss.str())
-    {
-      this->Parameters[paramName].Pending = true;
-    }
-    this->Parameters[paramName].Value = ss.str();
-    this->Parameters[paramName].Set = true;
+    this->SetSerializedValue(this->Parameters[paramName], ss.str());
     return PLUS_SUCCESS;
   };
   /*!
@@ -305,10 +310,73 @@ public:
   };
 
 protected:
+  /*! Identifiers of the parameters that have typed accessors */
+  enum KnownParameterId
+  {
+    PARAMETER_FREQUENCY,
+    PARAMETER_DEPTH,
+    PARAMETER_DYNRANGE,
+    PARAMETER_GAIN,
+    PARAMETER_TGC,
+    PARAMETER_INTENSITY,
+    PARAMETER_CONTRAST,
+    PARAMETER_POWER,
+    PARAMETER_SECTOR,
+    PARAMETER_ZOOM,
+    PARAMETER_SOUNDVELOCITY,
+    PARAMETER_VOLTAGE,
+    PARAMETER_IMAGESIZE,
+    NUMBER_OF_KNOWN_PARAMETERS
+  };
+
   vtkPlusUsImagingParameters();
   virtual ~vtkPlusUsImagingParameters();
 
+  /*! Set the serialized value of a parameter and update its numeric value. The parameter becomes pending if its value is changed. */
+  void SetSerializedValue(ParameterInfo& parameter, const std::string& value);
+
+  /*! Set the numeric value of a known parameter and update its serialized value. The parameter becomes pending if its value is changed. */
+  PlusStatus SetNumericValue(KnownParameterId parameterId, const std::vector<double>& values);
+  PlusStatus SetNumericValue(KnownParameterId parameterId, double value);
+
+  /*! Get the numeric value of a known parameter. Fails if the parameter is not set or its value is not numeric. */
+  PlusStatus GetNumericValue(KnownParameterId parameterId, std::vector<double>& values) const;
+  PlusStatus GetNumericValue(KnownParameterId parameterId, double& value) const;
+  PlusStatus GetNumericValue(KnownParameterId parameterId, float& value) const;
+
+  /*! Parse whitespace separated numbers. Returns false if the string contains anything else. */
+  static bool ParseNumbers(const std::string& str, std::vector<double>& numbers);
+
   ParameterMap Parameters;
+
+  /*! Direct access to the known parameters in the Parameters map, avoids key lookup */
+  ParameterInfo* KnownParameters[NUMBER_OF_KNOWN_PARAMETERS];
 };
 
+//----------------------------------------------------------------------------
+/*! The complete serialized value is returned, as a string value may contain whitespace (e.g., time gain compensation) */
+template<> inline PlusStatus vtkPlusUsImagingParameters::GetValue<std::string>(const std::string& paramName, std::string& outputValue) const
+{
+  ParameterMapConstIterator keyIt = this->Parameters.find(paramName);
+  if (keyIt == this->Parameters.end() || keyIt->second.Set == false)
+  {
+    return PLUS_FAIL;
+  }
+  outputValue = keyIt->second.Value;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+/*! Numeric values are returned from the already parsed numbers, without string conversion */
+template<> inline PlusStatus vtkPlusUsImagingParameters::GetValue<double>(const std::string& paramName, double& outputValue) const
+{
+  ParameterMapConstIterator keyIt = this->Parameters.find(paramName);
+  if (keyIt == this->Parameters.end() || keyIt->second.Set == false || !keyIt->second.IsNumeric || keyIt->second.Numbers.empty())
+  {
+    return PLUS_FAIL;
+  }
+  outputValue = keyIt->second.Numbers[0];
+  return PLUS_SUCCESS;
+}
+
 #endif
\ No newline at end of file
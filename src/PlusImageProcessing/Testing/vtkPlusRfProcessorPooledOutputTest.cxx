@@ -0,0 +1,189 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusRfProcessorPooledOutputTest.cxx
+  \brief This test scan converts many frames using pooled outputs and checks that the output image buffers
+  are reused (the allocation counters do not change) and that the copied images are the same as the scan converted images
+*/
+
+#include "PlusConfigure.h"
+#include "vtkImageData.h"
+#include "vtkPlusRfProcessor.h"
+#include "vtkPointData.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+#include "vtkXMLUtilities.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+
+///////////////////////////////////////////////////////////////////
+const int NUMBER_OF_POOLED_OUTPUTS = 3;
+const int NUMBER_OF_FRAMES = 20;
+const int SCANLINE_LENGTH_PIXELS = 256;
+const int NUMBER_OF_SCANLINES = 128;
+
+const char* RF_PROCESSING_CONFIG =
+  "<RfProcessing NumberOfPooledOutputs=\"3\">"
+  "  <ScanConversion TransducerGeometry=\"LINEAR\" ImagingDepthMm=\"40\" TransducerWidthMm=\"38\""
+  "    OutputImageSizePixel=\"200 250\" OutputImageSpacingMmPerPixel=\"0.2 0.2\" />"
+  "</RfProcessing>";
+
+//-----------------------------------------------------------------------------
+bool IsSameImage(vtkImageData* image1, vtkImageData* image2)
+{
+  int extent1[6] = {0};
+  int extent2[6] = {0};
+  image1->GetExtent(extent1);
+  image2->GetExtent(extent2);
+  for (int i = 0; i < 6; i++)
+  {
+    if (extent1[i] != extent2[i])
+    {
+      return false;
+    }
+  }
+  if (image1->GetScalarType() != image2->GetScalarType() || image1->GetNumberOfScalarComponents() != image2->GetNumberOfScalarComponents())
+  {
+    return false;
+  }
+  vtkDataArray* scalars1 = image1->GetPointData()->GetScalars();
+  vtkDataArray* scalars2 = image2->GetPointData()->GetScalars();
+  return memcmp(scalars1->GetVoidPointer(0), scalars2->GetVoidPointer(0), scalars1->GetDataSize() * scalars1->GetDataTypeSize()) == 0;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments cmdargs;
+  cmdargs.Initialize(argc, argv);
+  cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!cmdargs.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << cmdargs.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkXMLDataElement> rfProcessingElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(RF_PROCESSING_CONFIG));
+  vtkSmartPointer<vtkPlusRfProcessor> rfProcessor = vtkSmartPointer<vtkPlusRfProcessor>::New();
+  if (rfProcessingElement == NULL || rfProcessor->ReadConfiguration(rfProcessingElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read RF processing configuration");
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int numberOfFailures = 0;
+
+  // Pooled outputs are preallocated when the configuration is read
+  if (rfProcessor->GetNumberOfPooledOutputAllocations() != NUMBER_OF_POOLED_OUTPUTS)
+  {
+    LOG_ERROR("Number of pooled output allocations after reading the configuration is " << rfProcessor->GetNumberOfPooledOutputAllocations()
+              << " (expected: " << NUMBER_OF_POOLED_OUTPUTS << ")");
+    numberOfFailures++;
+  }
+
+  // Brightness scanlines (FM orientation: samples along the first axis)
+  vtkSmartPointer<vtkImageData> scanLines = vtkSmartPointer<vtkImageData>::New();
+  scanLines->SetExtent(0, SCANLINE_LENGTH_PIXELS - 1, 0, NUMBER_OF_SCANLINES - 1, 0, 0);
+  scanLines->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+
+  vtkSmartPointer<vtkImageData> destination = vtkSmartPointer<vtkImageData>::New();
+  std::vector<vtkImageData*> outputs;
+  for (int frameIndex = 0; frameIndex < NUMBER_OF_FRAMES; frameIndex++)
+  {
+    // A different pattern in each frame
+    unsigned char* scanLinePixel = static_cast<unsigned char*>(scanLines->GetScalarPointer());
+    for (int lineIndex = 0; lineIndex < NUMBER_OF_SCANLINES; lineIndex++)
+    {
+      for (int sampleIndex = 0; sampleIndex < SCANLINE_LENGTH_PIXELS; sampleIndex++, scanLinePixel++)
+      {
+        *scanLinePixel = static_cast<unsigned char>((sampleIndex + lineIndex * 3 + frameIndex * 17) % 256);
+      }
+    }
+    scanLines->Modified();
+
+    rfProcessor->SetRfFrame(scanLines, US_IMG_BRIGHTNESS);
+    vtkImageData* output = rfProcessor->GetBrightnessScanConvertedImage();
+    if (output == NULL)
+    {
+      LOG_ERROR("Frame " << frameIndex << ": no scan converted image");
+      numberOfFailures++;
+      break;
+    }
+    outputs.push_back(output);
+
+    // Outputs are used in a round-robin order
+    if (frameIndex >= NUMBER_OF_POOLED_OUTPUTS && output != outputs[frameIndex - NUMBER_OF_POOLED_OUTPUTS])
+    {
+      LOG_ERROR("Frame " << frameIndex << ": output is not the pooled output that was used " << NUMBER_OF_POOLED_OUTPUTS << " frames earlier");
+      numberOfFailures++;
+    }
+    if (frameIndex >= 1 && output == outputs[frameIndex - 1])
+    {
+      LOG_ERROR("Frame " << frameIndex << ": output is the same as the output of the previous frame");
+      numberOfFailures++;
+    }
+
+    // The current output is returned again if there is no new frame
+    if (rfProcessor->GetBrightnessScanConvertedImage() != output)
+    {
+      LOG_ERROR("Frame " << frameIndex << ": a different output is returned without setting a new frame");
+      numberOfFailures++;
+    }
+
+    if (rfProcessor->CopyBrightnessScanConvertedImage(destination) != PLUS_SUCCESS || !IsSameImage(output, destination))
+    {
+      LOG_ERROR("Frame " << frameIndex << ": copied image is different from the scan converted image");
+      numberOfFailures++;
+    }
+  }
+
+  LOG_INFO("Allocations: pooled outputs " << rfProcessor->GetNumberOfPooledOutputAllocations() << ", destination " << rfProcessor->GetNumberOfDestinationAllocations());
+  if (rfProcessor->GetNumberOfPooledOutputAllocations() != NUMBER_OF_POOLED_OUTPUTS)
+  {
+    LOG_ERROR("Pooled output buffers were reallocated: " << rfProcessor->GetNumberOfPooledOutputAllocations() << " allocations (expected: " << NUMBER_OF_POOLED_OUTPUTS << ")");
+    numberOfFailures++;
+  }
+  if (rfProcessor->GetNumberOfDestinationAllocations() != 1)
+  {
+    LOG_ERROR("Destination buffer was reallocated: " << rfProcessor->GetNumberOfDestinationAllocations() << " allocations (expected: 1)");
+    numberOfFailures++;
+  }
+
+  // A destination buffer that is shared with another image must not be overwritten
+  vtkSmartPointer<vtkImageData> sharedImage = vtkSmartPointer<vtkImageData>::New();
+  sharedImage->ShallowCopy(destination);
+  vtkDataArray* sharedScalars = sharedImage->GetPointData()->GetScalars();
+  rfProcessor->ResetAllocationCounters();
+  scanLines->Modified();
+  rfProcessor->SetRfFrame(scanLines, US_IMG_BRIGHTNESS);
+  if (rfProcessor->CopyBrightnessScanConvertedImage(destination) != PLUS_SUCCESS
+      || rfProcessor->GetNumberOfDestinationAllocations() != 1
+      || destination->GetPointData()->GetScalars() == sharedScalars)
+  {
+    LOG_ERROR("Destination buffer that is shared with another image was not reallocated");
+    numberOfFailures++;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Number of failures: " << numberOfFailures);
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Exit success!!!" << std::endl;
+  return EXIT_SUCCESS;
+}
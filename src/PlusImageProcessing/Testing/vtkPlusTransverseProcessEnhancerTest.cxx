@@ -35,6 +35,7 @@ int main(int argc, char** argv)
   std::string outputConfigFileName;
   std::string outputFileName;
   bool saveIntermediateResults = false;
+  int intermediateImageFrameStride = 1;
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   //Get command line arguments
@@ -45,6 +46,7 @@ int main(int argc, char** argv)
   args.AddArgument("--output-config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputConfigFileName, "Optional filename for output config file. Creates new config file with paramaters used during this test");
   args.AddArgument("--output-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFileName, "The filename to write the processed sequence to.");
   args.AddArgument("--save-intermediate-images", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &saveIntermediateResults, "If intermediate images should be saved to output files");
+  args.AddArgument("--intermediate-image-frame-stride", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &intermediateImageFrameStride, "Only intermediate images of every N-th frame are saved (default: 1)");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
   if (!args.Parse())
@@ -143,17 +145,10 @@ int main(int argc, char** argv)
 
   // Process the frames for the input file
   enhancer->SetSaveIntermediateResults(saveIntermediateResults);
-  LOG_INFO("Processing frames...");
-
-  if (enhancer->Update() == PLUS_FAIL)
-  {
-    LOG_ERROR("Processing frames failed!");
-    return EXIT_FAILURE;
-  }
-
-  LOG_INFO("Processing frames successful");
   if (saveIntermediateResults)
   {
+    enhancer->SetIntermediateImageFrameStride(intermediateImageFrameStride);
+
     // Find out where to add the unique suffix for each intermediate image
     int startInputFileNameIndex = 0;
     if (inputFileName.find("/") != std::string::npos)
@@ -174,10 +169,28 @@ int main(int argc, char** argv)
       startOutputFileNameIndex = outputFileName.rfind("\\") + 1;
     }
 
-    // Saves the intermediate results that were recorded during the call to enhancer->Update()
+    // Intermediate images are written into these files during the call to enhancer->Update()
     enhancer->SetIntermediateImageFileName(
       outputFileName.substr(0, startOutputFileNameIndex) + inputFileName.substr(startInputFileNameIndex, inputFileName.find(".") - startInputFileNameIndex));
-    enhancer->SaveAllIntermediateResultsToFile();
+  }
+
+  LOG_INFO("Processing frames...");
+
+  if (enhancer->Update() == PLUS_FAIL)
+  {
+    LOG_ERROR("Processing frames failed!");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Processing frames successful");
+  if (saveIntermediateResults)
+  {
+    // Writes the intermediate images that were not written yet and completes the intermediate image files
+    if (enhancer->SaveAllIntermediateResultsToFile() == PLUS_FAIL)
+    {
+      LOG_ERROR("Saving intermediate images failed!");
+      return EXIT_FAILURE;
+    }
   }
 
   if (vtkPlusSequenceIO::Write(outputFileName, enhancer->GetOutputFrames()) == PLUS_FAIL)
@@ -0,0 +1,226 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file vtkPlusUsScanConvertSampleTableTest.cxx
+\brief This test checks that scanlines sampled using a scanline sample table match the scanlines extracted
+pixel by pixel from the scan converter geometry (as ExtractScanLines did before using the table), and that
+linear interpolation rounds the interpolated values
+*/
+
+#include "PlusConfigure.h"
+#include "vtkImageData.h"
+#include "vtkMinimalStandardRandomSequence.h"
+#include "vtkPlusUsScanConvertCurvilinear.h"
+#include "vtkPlusUsScanConvertLinear.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+#include "vtkXMLUtilities.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <cmath>
+
+namespace
+{
+  const int NUMBER_OF_SCAN_LINES = 64;
+  const int NUMBER_OF_SAMPLES_PER_SCAN_LINE = 256;
+  const unsigned char CONSTANT_PIXEL_VALUE = 100;
+
+  //----------------------------------------------------------------------------
+  // Scanline extraction as it was done in ExtractScanLines for each frame
+  void ExtractScanLinesReference(vtkPlusUsScanConvert* scanConverter, vtkImageData* inputImageData, vtkImageData* outputImageData)
+  {
+    int* linesImageExtent = scanConverter->GetInputImageExtent();
+    int lineLengthPx = linesImageExtent[1] - linesImageExtent[0] + 1;
+    int numScanLines = linesImageExtent[3] - linesImageExtent[2] + 1;
+
+    int* inputExtent = inputImageData->GetExtent();
+    for (int scanLine = 0; scanLine < numScanLines; scanLine++)
+    {
+      double start[4] = {0};
+      double end[4] = {0};
+      scanConverter->GetScanLineEndPoints(scanLine, start, end);
+
+      double directionVectorX = static_cast<double>(end[0] - start[0]) / (lineLengthPx - 1);
+      double directionVectorY = static_cast<double>(end[1] - start[1]) / (lineLengthPx - 1);
+      for (int pointIndex = 0; pointIndex < lineLengthPx; ++pointIndex)
+      {
+        int pixelCoordX = start[0] + directionVectorX * pointIndex;
+        int pixelCoordY = start[1] + directionVectorY * pointIndex;
+        if (pixelCoordX < inputExtent[0] || pixelCoordX > inputExtent[1] || pixelCoordY < inputExtent[2] || pixelCoordY > inputExtent[3])
+        {
+          outputImageData->SetScalarComponentFromFloat(pointIndex, scanLine, 0, 0, 0);
+          continue; // outside of the specified extent
+        }
+        outputImageData->SetScalarComponentFromFloat(pointIndex, scanLine, 0, 0, inputImageData->GetScalarComponentAsFloat(pixelCoordX, pixelCoordY, 0, 0));
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Returns true if the bilinear interpolation of the sample point uses only pixels inside the image
+  bool IsSampleInsideImage(vtkPlusUsScanConvert* scanConverter, int scanLine, int pointIndex, const int imageExtent[6])
+  {
+    double start[4] = {0};
+    double end[4] = {0};
+    scanConverter->GetScanLineEndPoints(scanLine, start, end);
+    double pointX = start[0] + (end[0] - start[0]) / (NUMBER_OF_SAMPLES_PER_SCAN_LINE - 1) * pointIndex;
+    double pointY = start[1] + (end[1] - start[1]) / (NUMBER_OF_SAMPLES_PER_SCAN_LINE - 1) * pointIndex;
+    return floor(pointX) >= imageExtent[0] && floor(pointX) + 1 <= imageExtent[1] && floor(pointY) >= imageExtent[2] && floor(pointY) + 1 <= imageExtent[3];
+  }
+
+  //----------------------------------------------------------------------------
+  int TestScanConverter(vtkPlusUsScanConvert* scanConverter, vtkMinimalStandardRandomSequence* random)
+  {
+    int numberOfFailures = 0;
+    const std::string geometry = scanConverter->GetTransducerGeometry();
+
+    int linesImageExtent[6] = {0, NUMBER_OF_SAMPLES_PER_SCAN_LINE - 1, 0, NUMBER_OF_SCAN_LINES - 1, 0, 0};
+    scanConverter->SetInputImageExtent(linesImageExtent);
+
+    // Random image with the geometry of the scan converted image
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetExtent(scanConverter->GetOutputImageExtent());
+    image->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    unsigned char* imagePixels = static_cast<unsigned char*>(image->GetScalarPointer());
+    for (vtkIdType i = 0; i < image->GetNumberOfPoints(); i++)
+    {
+      imagePixels[i] = static_cast<unsigned char>(random->GetRangeValue(0, 255.99));
+      random->Next();
+    }
+
+    vtkSmartPointer<vtkImageData> referenceLinesImage = vtkSmartPointer<vtkImageData>::New();
+    referenceLinesImage->SetExtent(linesImageExtent);
+    referenceLinesImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    vtkSmartPointer<vtkImageData> linesImage = vtkSmartPointer<vtkImageData>::New();
+    linesImage->SetExtent(linesImageExtent);
+    linesImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+
+    // Nearest: same result as the per-pixel extraction
+    ExtractScanLinesReference(scanConverter, image, referenceLinesImage);
+    vtkPlusUsScanConvert::ScanLineSampleTable nearestTable;
+    if (scanConverter->ComputeScanLineSampleTable(image->GetExtent(), vtkPlusUsScanConvert::SCAN_LINE_SAMPLE_INTERPOLATION_NEAREST, nearestTable) != PLUS_SUCCESS
+        || vtkPlusUsScanConvert::SampleScanLines(image, nearestTable, linesImage) != PLUS_SUCCESS)
+    {
+      LOG_ERROR(geometry << ": failed to sample scanlines with nearest interpolation");
+      return numberOfFailures + 1;
+    }
+    int numberOfDifferentSamples = 0;
+    for (int scanLine = 0; scanLine < NUMBER_OF_SCAN_LINES; scanLine++)
+    {
+      for (int pointIndex = 0; pointIndex < NUMBER_OF_SAMPLES_PER_SCAN_LINE; pointIndex++)
+      {
+        if (*static_cast<unsigned char*>(linesImage->GetScalarPointer(pointIndex, scanLine, 0)) != *static_cast<unsigned char*>(referenceLinesImage->GetScalarPointer(pointIndex, scanLine, 0)))
+        {
+          numberOfDifferentSamples++;
+        }
+      }
+    }
+    if (numberOfDifferentSamples > 0)
+    {
+      LOG_ERROR(geometry << ": " << numberOfDifferentSamples << " samples are different from the per-pixel scanline extraction");
+      numberOfFailures++;
+    }
+
+    // Linear: interpolating a constant image gives the same constant, even if the sum of the weights is slightly less than 1
+    for (vtkIdType i = 0; i < image->GetNumberOfPoints(); i++)
+    {
+      imagePixels[i] = CONSTANT_PIXEL_VALUE;
+    }
+    vtkPlusUsScanConvert::ScanLineSampleTable linearTable;
+    if (scanConverter->ComputeScanLineSampleTable(image->GetExtent(), vtkPlusUsScanConvert::SCAN_LINE_SAMPLE_INTERPOLATION_LINEAR, linearTable) != PLUS_SUCCESS
+        || vtkPlusUsScanConvert::SampleScanLines(image, linearTable, linesImage) != PLUS_SUCCESS)
+    {
+      LOG_ERROR(geometry << ": failed to sample scanlines with linear interpolation");
+      return numberOfFailures + 1;
+    }
+    numberOfDifferentSamples = 0;
+    int numberOfInsideSamples = 0;
+    for (int scanLine = 0; scanLine < NUMBER_OF_SCAN_LINES; scanLine++)
+    {
+      for (int pointIndex = 0; pointIndex < NUMBER_OF_SAMPLES_PER_SCAN_LINE; pointIndex++)
+      {
+        if (!IsSampleInsideImage(scanConverter, scanLine, pointIndex, image->GetExtent()))
+        {
+          continue;
+        }
+        numberOfInsideSamples++;
+        if (*static_cast<unsigned char*>(linesImage->GetScalarPointer(pointIndex, scanLine, 0)) != CONSTANT_PIXEL_VALUE)
+        {
+          numberOfDifferentSamples++;
+        }
+      }
+    }
+    LOG_INFO(geometry << ": " << numberOfInsideSamples << " linearly interpolated samples inside the image");
+    if (numberOfInsideSamples == 0 || numberOfDifferentSamples > 0)
+    {
+      LOG_ERROR(geometry << ": " << numberOfDifferentSamples << " of " << numberOfInsideSamples << " linearly interpolated samples of a constant image are different from " << static_cast<int>(CONSTANT_PIXEL_VALUE));
+      numberOfFailures++;
+    }
+
+    return numberOfFailures;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkMinimalStandardRandomSequence> random = vtkSmartPointer<vtkMinimalStandardRandomSequence>::New();
+  random->SetSeed(8923);
+
+  int numberOfFailures = 0;
+
+  vtkSmartPointer<vtkXMLDataElement> curvilinearElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(
+        "<ScanConversion TransducerGeometry=\"CURVILINEAR\" RadiusStartMm=\"47.5\" RadiusStopMm=\"117.5\" ThetaStartDeg=\"-36.3\" ThetaStopDeg=\"36.3\""
+        " OutputImageSizePixel=\"640 480\" TransducerCenterPixel=\"320 30\" OutputImageSpacingMmPerPixel=\"0.2 0.2\" />"));
+  vtkSmartPointer<vtkPlusUsScanConvertCurvilinear> curvilinearScanConverter = vtkSmartPointer<vtkPlusUsScanConvertCurvilinear>::New();
+  if (curvilinearScanConverter->ReadConfiguration(curvilinearElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read curvilinear scan converter configuration");
+    numberOfFailures++;
+  }
+  else
+  {
+    numberOfFailures += TestScanConverter(curvilinearScanConverter, random);
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> linearElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(
+        "<ScanConversion TransducerGeometry=\"LINEAR\" ImagingDepthMm=\"60\" TransducerWidthMm=\"38\""
+        " OutputImageSizePixel=\"500 400\" TransducerCenterPixel=\"250 10\" OutputImageSpacingMmPerPixel=\"0.11 0.13\" />"));
+  vtkSmartPointer<vtkPlusUsScanConvertLinear> linearScanConverter = vtkSmartPointer<vtkPlusUsScanConvertLinear>::New();
+  if (linearScanConverter->ReadConfiguration(linearElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read linear scan converter configuration");
+    numberOfFailures++;
+  }
+  else
+  {
+    numberOfFailures += TestScanConverter(linearScanConverter, random);
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfFailures << " errors");
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Exit success!!!" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -11,20 +11,74 @@ See License.txt for details.
 #include "igsioTrackedFrame.h"
 #include "igsioVideoFrame.h"
 #include "vtkPlusSequenceIO.h"
+#include "vtkIGSIOSequenceIO.h"
+#include "vtkIGSIOSequenceIOBase.h"
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkPlusUsScanConvertCurvilinear.h"
 #include "vtkPlusUsScanConvertLinear.h"
 
 // VTK includes
 #include <vtkImageData.h>
+#include <vtkDataArray.h>
 #include <vtkLineSource.h>
+#include <vtkMultiThreader.h>
+#include <vtkPointData.h>
 #include <vtkSmartPointer.h>
 #include <vtkXMLUtilities.h>
 #include <vtksys/CommandLineArguments.hxx>
 
+// STL includes
+#include <algorithm>
+#include <atomic>
+
 namespace
 {
   const float DRAWING_COLOR = 255;
+
+  /*! Drawing of the scanlines on a batch of frames, shared between the threads */
+  struct DrawScanLinesJob
+  {
+    /*! Offsets of the scalar values that belong to the scanlines (in number of scalar values from the first pixel) */
+    const std::vector<vtkIdType>* ScanLineScalarOffsets;
+    /*! Number of scalar values in the image that the offsets were computed for */
+    vtkIdType NumberOfScalarValues;
+    vtkIGSIOTrackedFrameList* FrameList;
+    /*! Index of the next frame that is not yet taken by any thread */
+    std::atomic<int> NextFrameIndex;
+    std::atomic<bool> Failed;
+  };
+
+  //----------------------------------------------------------------------------
+  template<class T>
+  void DrawScanLineScalars(T* scalars, const std::vector<vtkIdType>& scalarOffsets)
+  {
+    for (std::vector<vtkIdType>::const_iterator it = scalarOffsets.begin(); it != scalarOffsets.end(); ++it)
+    {
+      scalars[*it] = static_cast<T>(DRAWING_COLOR);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void* DrawScanLinesThread(vtkMultiThreader::ThreadInfo* data)
+  {
+    DrawScanLinesJob* job = static_cast<DrawScanLinesJob*>(data->UserData);
+    const int numberOfFrames = job->FrameList->GetNumberOfTrackedFrames();
+    for (int frameIndex = job->NextFrameIndex++; frameIndex < numberOfFrames && !job->Failed; frameIndex = job->NextFrameIndex++)
+    {
+      vtkImageData* image = job->FrameList->GetTrackedFrame(frameIndex)->GetImageData()->GetImage();
+      if (image->GetNumberOfPoints() * image->GetNumberOfScalarComponents() != job->NumberOfScalarValues)
+      {
+        LOG_ERROR("Size of frame " << frameIndex << " of the batch is different from the size of the first frame");
+        job->Failed = true;
+        break;
+      }
+      switch (image->GetScalarType())
+      {
+        vtkTemplateMacro(DrawScanLineScalars(static_cast<VTK_TT*>(image->GetScalarPointer()), *job->ScanLineScalarOffsets));
+      }
+    }
+    return NULL;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -35,6 +89,8 @@ int main(int argc, char** argv)
   std::string inputImgSeqFileName;
   std::string outputImgSeqFileName;
   std::string inputConfigFileName;
+  int numberOfThreads = 0;
+  int framesPerBatch = 32;
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   vtksys::CommandLineArguments args;
@@ -43,6 +99,8 @@ int main(int argc, char** argv)
   args.AddArgument("--source-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputImgSeqFileName, "The ultrasound sequence to draw the scanlines on.");
   args.AddArgument("--output-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputImgSeqFileName, "The output ultrasound sequence with scanlines overlaid on the images.");
   args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "The ultrasound sequence config file.");
+  args.AddArgument("--number-of-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of threads that draw the scanlines (default: number of processor cores).");
+  args.AddArgument("--frames-per-batch", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &framesPerBatch, "Number of frames that are processed and written to the output file at once (default: 32).");
   args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
@@ -74,6 +132,11 @@ int main(int argc, char** argv)
     LOG_ERROR("--config-file required");
     exit(EXIT_FAILURE);
   }
+  if (framesPerBatch < 1)
+  {
+    LOG_ERROR("Invalid --frames-per-batch: " << framesPerBatch);
+    exit(EXIT_FAILURE);
+  }
 
   // Read the image sequence
   vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
@@ -150,13 +213,35 @@ int main(int argc, char** argv)
     lines.push_back(igsioCommon::PixelLine(startPoint, endPoint));
   }
 
+  int numberOfFrames = trackedFrameList->GetNumberOfTrackedFrames();
+  if (numberOfFrames < 1)
+  {
+    LOG_ERROR("Input image sequence contains no frames.");
+    return EXIT_FAILURE;
+  }
+
+  // The scanlines are at the same position in all frames, therefore they are drawn only once, into a blank image,
+  // and the modified scalar values are recorded. Drawing on the frames then only requires setting these values.
+  std::vector<vtkIdType> scanLineScalarOffsets;
+  vtkIdType numberOfScalarValues = 0;
   if (!lines.empty())
   {
-    igsioCommon::DrawScanLines(rfImageExtent, 255, lines, trackedFrameList);
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> blankFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    blankFrameList->AddTrackedFrame(trackedFrameList->GetTrackedFrame(0));
+    vtkDataArray* blankScalars = blankFrameList->GetTrackedFrame(0)->GetImageData()->GetImage()->GetPointData()->GetScalars();
+    blankScalars->Fill(0);
+    igsioCommon::DrawScanLines(rfImageExtent, DRAWING_COLOR, lines, blankFrameList);
+    numberOfScalarValues = blankScalars->GetNumberOfTuples() * blankScalars->GetNumberOfComponents();
+    for (vtkIdType scalarOffset = 0; scalarOffset < numberOfScalarValues; scalarOffset++)
+    {
+      if (blankScalars->GetComponent(scalarOffset / blankScalars->GetNumberOfComponents(), scalarOffset % blankScalars->GetNumberOfComponents()) != 0)
+      {
+        scanLineScalarOffsets.push_back(scalarOffset);
+      }
+    }
   }
 
   // Write the new TrackedFrameList to metafile
-  LOG_INFO("Writing new sequence to file...");
   if (outputImgSeqFileName.empty())
   {
     int extensionDot = inputImgSeqFileName.find_last_of(".");
@@ -166,8 +251,68 @@ int main(int argc, char** argv)
     }
     outputImgSeqFileName = inputImgSeqFileName + "-Scanlines.nrrd";
   }
-  if (vtkPlusSequenceIO::Write(outputImgSeqFileName, trackedFrameList) != PLUS_SUCCESS)
+  std::string outputImgSeqFilePath = outputImgSeqFileName;
+  if (!vtksys::SystemTools::FileIsFullPath(outputImgSeqFilePath))
+  {
+    outputImgSeqFilePath = vtkPlusConfig::GetInstance()->GetOutputPath(outputImgSeqFileName);
+  }
+
+  // Frames are written to the output file batch by batch, so the whole output sequence is not kept in memory
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> outputFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  vtkSmartPointer<vtkIGSIOSequenceIOBase> writer = vtkSmartPointer<vtkIGSIOSequenceIOBase>::Take(vtkIGSIOSequenceIO::CreateSequenceHandlerForFile(outputImgSeqFilePath));
+  if (writer.GetPointer() == NULL)
+  {
+    LOG_ERROR("Unable to create writer for output file: " << outputImgSeqFilePath);
+    return EXIT_FAILURE;
+  }
+  writer->SetUseCompression(true);
+  writer->SetTrackedFrameList(outputFrameList);
+  writer->SetFileName(outputImgSeqFilePath);
+  bool isHeaderPrepared = false;
+
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  }
+  numberOfThreads = std::max(1, std::min(numberOfThreads, std::min(framesPerBatch, static_cast<int>(VTK_MAX_THREADS))));
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  threader->SetNumberOfThreads(numberOfThreads);
+
+  LOG_INFO("Writing new sequence to file...");
+  for (int firstFrameIndex = 0; firstFrameIndex < numberOfFrames; firstFrameIndex += framesPerBatch)
+  {
+    int numberOfFramesInBatch = std::min(framesPerBatch, numberOfFrames - firstFrameIndex);
+    for (int frameIndex = firstFrameIndex; frameIndex < firstFrameIndex + numberOfFramesInBatch; frameIndex++)
+    {
+      outputFrameList->AddTrackedFrame(trackedFrameList->GetTrackedFrame(frameIndex));
+    }
+
+    if (!scanLineScalarOffsets.empty())
+    {
+      DrawScanLinesJob job;
+      job.ScanLineScalarOffsets = &scanLineScalarOffsets;
+      job.NumberOfScalarValues = numberOfScalarValues;
+      job.FrameList = outputFrameList;
+      job.NextFrameIndex = 0;
+      job.Failed = false;
+      threader->SetSingleMethod((vtkThreadFunctionType)&DrawScanLinesThread, &job);
+      threader->SingleMethodExecute();
+      if (job.Failed)
+      {
+        LOG_ERROR("Failed to draw scan lines on frames " << firstFrameIndex << "-" << firstFrameIndex + numberOfFramesInBatch - 1);
+        return EXIT_FAILURE;
+      }
+    }
+
+    if (vtkPlusSequenceIO::AppendFramesToFile(writer, isHeaderPrepared) != PLUS_SUCCESS)
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (vtkPlusSequenceIO::FinalizeFile(writer, numberOfFrames) != PLUS_SUCCESS)
   {
+    LOG_ERROR("Unable to finalize output file: " << outputImgSeqFilePath);
     return EXIT_FAILURE;
   }
   LOG_INFO("Writing to " << outputImgSeqFileName << " complete.");
@@ -121,15 +121,6 @@ int main(int argc, char **argv)
   boneFilter->SetInputFrames(trackedFrameList);
   boneFilter->ReadConfiguration(processorElement);
 
-  PlusStatus filterStatus = boneFilter->Update();
-  if (filterStatus != PlusStatus::PLUS_SUCCESS)
-  {
-    LOG_ERROR("Failed processing frames");
-    return EXIT_FAILURE;
-  }
-
-  LOG_INFO("Writing output to file");
-
   if (saveIntermediateResults)
   {
     // Find out where to add the unique suffix for each intermediate image
@@ -152,9 +143,23 @@ int main(int argc, char **argv)
       startOutputFileNameIndex = outputFileName.rfind("\\") + 1;
     }
 
-    // Saves the intermediate results that were recorded during the call to boneFilter->Update()
+    // Intermediate images are written into these files during the call to boneFilter->Update()
     boneFilter->SetIntermediateImageFileName(
       outputFileName.substr(0, startOutputFileNameIndex) + inputFileName.substr(startInputFileNameIndex, inputFileName.find(".") - startInputFileNameIndex) );
+  }
+
+  PlusStatus filterStatus = boneFilter->Update();
+  if (filterStatus != PlusStatus::PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed processing frames");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Writing output to file");
+
+  if (saveIntermediateResults)
+  {
+    // Writes the intermediate images that were not written yet and completes the intermediate image files
     boneFilter->SaveAllIntermediateResultsToFile();
   }
 
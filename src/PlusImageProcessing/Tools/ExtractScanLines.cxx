@@ -2,7 +2,9 @@
 #include "igsioTrackedFrame.h"
 #include "vtkImageCast.h"
 #include "vtkImageData.h"
-#include "vtkIGSIOMetaImageSequenceIO.h"
+#include "vtkIGSIOSequenceIO.h"
+#include "vtkIGSIOSequenceIOBase.h"
+#include "vtkMultiThreader.h"
 #include "vtkSmartPointer.h"
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkPlusUsScanConvert.h"
@@ -12,40 +14,42 @@
 
 #include "vtksys/CommandLineArguments.hxx"
 
+#include <algorithm>
+#include <atomic>
 
-void extractScanLines(vtkPlusUsScanConvert* scanConverter, vtkImageData* inputImageData, vtkImageData* outputImageData)
+namespace
 {
-  int* linesImageExtent = scanConverter->GetInputImageExtent();
-  int lineLengthPx = linesImageExtent[1] - linesImageExtent[0] + 1;
-  int numScanLines = linesImageExtent[3] - linesImageExtent[2] + 1;
-
-  float inputPixelValue = 0.0;
-
-  int* inputExtent = inputImageData->GetExtent();
-  for (int scanLine = 0; scanLine < numScanLines; scanLine ++ )
+  /*! Scanline extraction of a batch of frames, shared between the threads */
+  struct ExtractScanLinesJob
   {
-    double start[4] = {0};
-    double end[4] = {0};
-    scanConverter->GetScanLineEndPoints(scanLine, start, end);
-
-    double directionVectorX = static_cast<double>(end[0]-start[0])/(lineLengthPx-1);
-    double directionVectorY = static_cast<double>(end[1]-start[1])/(lineLengthPx-1);
-    for (int pointIndex=0; pointIndex<lineLengthPx; ++pointIndex)
+    const vtkPlusUsScanConvert::ScanLineSampleTable* SampleTable;
+    vtkIGSIOTrackedFrameList* InputFrameList;
+    /*! Index of the input frame that corresponds to the first lines frame */
+    int FirstInputFrameIndex;
+    vtkIGSIOTrackedFrameList* LinesFrameList;
+    /*! Index of the next lines frame that is not yet taken by any thread */
+    std::atomic<int> NextLinesFrameIndex;
+    std::atomic<bool> Failed;
+  };
+
+  //----------------------------------------------------------------------------
+  void* ExtractScanLinesThread(vtkMultiThreader::ThreadInfo* data)
+  {
+    ExtractScanLinesJob* job = static_cast<ExtractScanLinesJob*>(data->UserData);
+    const int numberOfLinesFrames = job->LinesFrameList->GetNumberOfTrackedFrames();
+    for (int linesFrameIndex = job->NextLinesFrameIndex++; linesFrameIndex < numberOfLinesFrames && !job->Failed; linesFrameIndex = job->NextLinesFrameIndex++)
     {
-      int pixelCoordX = start[0] + directionVectorX * pointIndex;
-      int pixelCoordY = start[1] + directionVectorY * pointIndex;
-      if ( pixelCoordX<inputExtent[0] ||  pixelCoordX>inputExtent[1] || pixelCoordY<inputExtent[2] ||  pixelCoordY>inputExtent[3] )
+      igsioTrackedFrame* inputFrame = job->InputFrameList->GetTrackedFrame(job->FirstInputFrameIndex + linesFrameIndex);
+      igsioTrackedFrame* linesFrame = job->LinesFrameList->GetTrackedFrame(linesFrameIndex);
+      if (vtkPlusUsScanConvert::SampleScanLines(inputFrame->GetImageData()->GetImage(), *job->SampleTable, linesFrame->GetImageData()->GetImage()) != PLUS_SUCCESS)
       {
-        outputImageData->SetScalarComponentFromFloat(pointIndex, scanLine, 0, 0, 0);
-        continue; // outside of the specified extent
+        job->Failed = true;
       }
-      inputPixelValue = inputImageData->GetScalarComponentAsFloat(pixelCoordX, pixelCoordY, 0, 0);
-      outputImageData->SetScalarComponentFromFloat(pointIndex, scanLine, 0, 0, inputPixelValue);
     }
+    return NULL;
   }
 }
 
-
 int main(int argc, char** argv)
 {
   bool printHelp = false;
@@ -54,6 +58,9 @@ int main(int argc, char** argv)
   std::string inputFileName;
   std::string outputFileName;
   std::string configFileName;
+  std::string interpolation = "NEAREST";
+  int numberOfThreads = 0;
+  int framesPerBatch = 32;
   int verboseLevel=vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   args.Initialize(argc, argv);
@@ -61,6 +68,9 @@ int main(int argc, char** argv)
   args.AddArgument("--input-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputFileName, "The filename for the input ultrasound sequence to process.");
   args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &configFileName, "The filename for input config file.");
   args.AddArgument("--output-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFileName, "The filename to write the processed sequence to.");
+  args.AddArgument("--interpolation", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &interpolation, "Interpolation of scanline samples: NEAREST (value of the pixel that contains the sample, default) or LINEAR.");
+  args.AddArgument("--number-of-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of threads that extract scanlines (default: number of processor cores).");
+  args.AddArgument("--frames-per-batch", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &framesPerBatch, "Number of frames that are processed and written to the output file at once (default: 32).");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
   if (!args.Parse())
@@ -96,6 +106,23 @@ int main(int argc, char** argv)
     return EXIT_FAILURE;
   }
 
+  vtkPlusUsScanConvert::ScanLineSampleInterpolationType interpolationType = vtkPlusUsScanConvert::SCAN_LINE_SAMPLE_INTERPOLATION_NEAREST;
+  if (STRCASECMP(interpolation.c_str(), "LINEAR") == 0)
+  {
+    interpolationType = vtkPlusUsScanConvert::SCAN_LINE_SAMPLE_INTERPOLATION_LINEAR;
+  }
+  else if (STRCASECMP(interpolation.c_str(), "NEAREST") != 0)
+  {
+    std::cerr << "Invalid --interpolation: " << interpolation << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (framesPerBatch < 1)
+  {
+    std::cerr << "Invalid --frames-per-batch: " << framesPerBatch << std::endl;
+    return EXIT_FAILURE;
+  }
+
   // Read config file.
 
   vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
@@ -156,8 +183,18 @@ int main(int argc, char** argv)
   // Read input image.
 
   vtkSmartPointer<vtkIGSIOTrackedFrameList> inputFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
-  vtkPlusSequenceIO::Read(inputFileName.c_str(), inputFrameList);
+  if (vtkPlusSequenceIO::Read(inputFileName.c_str(), inputFrameList) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to read input sequence: " << inputFileName);
+    return EXIT_FAILURE;
+  }
   int numberOfFrames = inputFrameList->GetNumberOfTrackedFrames();
+  if (numberOfFrames < 1)
+  {
+    LOG_ERROR("Input sequence contains no frames: " << inputFileName);
+    return EXIT_FAILURE;
+  }
+  vtkImageData* firstInputImage = inputFrameList->GetTrackedFrame(0)->GetImageData()->GetImage();
 
   // Create lines image (this is the image which holds scan lines in rows).
 
@@ -166,29 +203,84 @@ int main(int argc, char** argv)
 
   vtkSmartPointer<vtkImageData> linesImage = vtkSmartPointer<vtkImageData>::New();
   linesImage->SetExtent(linesImageExtent);
-  linesImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  linesImage->AllocateScalars(firstInputImage->GetScalarType(), 1);
 
-  // Create frame lists for lines images and output images.
-  vtkSmartPointer<vtkIGSIOTrackedFrameList> linesFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
-  vtkSmartPointer<vtkIGSIOTrackedFrameList> outputFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
-
-  // Iterate thought every frame.
-  for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex ++ )
+  // The scanline geometry is the same for all frames, so sample positions are computed only once.
+  vtkPlusUsScanConvert::ScanLineSampleTable sampleTable;
+  if (scanConverter->ComputeScanLineSampleTable(firstInputImage->GetExtent(), interpolationType, sampleTable) != PLUS_SUCCESS)
   {
-    igsioTrackedFrame* inputFrame = inputFrameList->GetTrackedFrame(frameIndex);
+    LOG_ERROR("Unable to compute scanline sample positions");
+    return EXIT_FAILURE;
+  }
 
-    linesFrameList->AddTrackedFrame(inputFrame);
-    igsioTrackedFrame* linesFrame = linesFrameList->GetTrackedFrame(linesFrameList->GetNumberOfTrackedFrames()-1);
-    linesFrame->GetImageData()->DeepCopyFrom(linesImage);  // Would there be a more efficient way to create this tracked frame?
+  // Lines frames are written to the output file batch by batch, so the whole output sequence is not kept in memory.
+  std::string outputFilePath = outputFileName;
+  if (!vtksys::SystemTools::FileIsFullPath(outputFilePath))
+  {
+    outputFilePath = vtkPlusConfig::GetInstance()->GetOutputPath(outputFileName);
+  }
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> linesFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  vtkSmartPointer<vtkIGSIOSequenceIOBase> writer = vtkSmartPointer<vtkIGSIOSequenceIOBase>::Take(vtkIGSIOSequenceIO::CreateSequenceHandlerForFile(outputFilePath));
+  if (writer.GetPointer() == NULL)
+  {
+    LOG_ERROR("Unable to create writer for output file: " << outputFilePath);
+    return EXIT_FAILURE;
+  }
+  writer->SetUseCompression(true);
+  writer->SetTrackedFrameList(linesFrameList);
+  writer->SetFileName(outputFilePath);
+  bool isHeaderPrepared = false;
 
-    // Extract scan lines from image.
-    extractScanLines(scanConverter, inputFrame->GetImageData()->GetImage(), linesFrame->GetImageData()->GetImage() );
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
   }
+  numberOfThreads = std::max(1, std::min(numberOfThreads, std::min(framesPerBatch, static_cast<int>(VTK_MAX_THREADS))));
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  threader->SetNumberOfThreads(numberOfThreads);
 
   std::cout << "Writing output to file. Setting log level to 1, regardless of user specified verbose level." << std::endl;
   vtkPlusLogger::Instance()->SetLogLevel(1);
 
-  vtkPlusSequenceIO::Write(outputFileName.c_str(), linesFrameList);
+  for (int firstFrameIndex = 0; firstFrameIndex < numberOfFrames; firstFrameIndex += framesPerBatch)
+  {
+    int numberOfFramesInBatch = std::min(framesPerBatch, numberOfFrames - firstFrameIndex);
+
+    // Create the lines frames, they have the same fields as the input frames
+    for (int frameIndex = firstFrameIndex; frameIndex < firstFrameIndex + numberOfFramesInBatch; frameIndex++)
+    {
+      linesFrameList->AddTrackedFrame(inputFrameList->GetTrackedFrame(frameIndex));
+      igsioTrackedFrame* linesFrame = linesFrameList->GetTrackedFrame(linesFrameList->GetNumberOfTrackedFrames() - 1);
+      linesFrame->GetImageData()->DeepCopyFrom(linesImage);
+    }
+
+    // Extract scan lines from images.
+    ExtractScanLinesJob job;
+    job.SampleTable = &sampleTable;
+    job.InputFrameList = inputFrameList;
+    job.FirstInputFrameIndex = firstFrameIndex;
+    job.LinesFrameList = linesFrameList;
+    job.NextLinesFrameIndex = 0;
+    job.Failed = false;
+    threader->SetSingleMethod((vtkThreadFunctionType)&ExtractScanLinesThread, &job);
+    threader->SingleMethodExecute();
+    if (job.Failed)
+    {
+      LOG_ERROR("Failed to extract scan lines from frames " << firstFrameIndex << "-" << firstFrameIndex + numberOfFramesInBatch - 1);
+      return EXIT_FAILURE;
+    }
+
+    if (vtkPlusSequenceIO::AppendFramesToFile(writer, isHeaderPrepared) != PLUS_SUCCESS)
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (vtkPlusSequenceIO::FinalizeFile(writer, numberOfFrames) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to finalize output file: " << outputFilePath);
+    return EXIT_FAILURE;
+  }
 
   return EXIT_SUCCESS;
 }
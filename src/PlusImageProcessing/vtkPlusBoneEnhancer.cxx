@@ -8,6 +8,7 @@ See License.txt for details.
 #include "PlusConfigure.h"
 #include "PlusMath.h"
 #include "vtkPlusBoneEnhancer.h"
+#include "vtkPlusIntermediateImageWriter.h"
 #include "vtkPlusUsScanConvertCurvilinear.h"
 #include "vtkPlusUsScanConvertLinear.h"
 #include "vtkPlusSequenceIO.h"
@@ -26,11 +27,27 @@ See License.txt for details.
 #include <vtkIGSIOTrackedFrameList.h>
 
 
+#include <algorithm>
 #include <cmath>
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkPlusBoneEnhancer);
 
+//----------------------------------------------------------------------------
+// Average the first two components of each pixel (approximation of the gradient magnitude)
+template <class T>
+void vtkPlusBoneEnhancerVectorToUchar(const T* inPtr, int numberOfComponents, unsigned char* outPtr, vtkIdType numberOfPixels)
+{
+  for (vtkIdType pixelIndex = 0; pixelIndex < numberOfPixels; ++pixelIndex)
+  {
+    unsigned char edgeDetectorOutput0 = static_cast<unsigned char>(static_cast<float>(inPtr[0]));
+    unsigned char edgeDetectorOutput1 = static_cast<unsigned char>(static_cast<float>(inPtr[1]));
+    float output = (float)(edgeDetectorOutput0 + edgeDetectorOutput1) / (float)2;                                       // Not mathematically correct, but a quick approximation of sqrt(x^2 + y^2)
+    *(outPtr++) = (unsigned char)std::max(0, std::min(255, (int)output));
+    inPtr += numberOfComponents;
+  }
+}
+
 //----------------------------------------------------------------------------
 vtkPlusBoneEnhancer::vtkPlusBoneEnhancer()
 : ScanConverter(NULL),
@@ -59,7 +76,8 @@ vtkPlusBoneEnhancer::vtkPlusBoneEnhancer()
   ProcessedLinesImage(NULL),
   FirstFrame(true),
 
-  SaveIntermediateResults(false)
+  SaveIntermediateResults(false),
+  IntermediateImageFrameStride(1)
 {
 
   this->GaussianSmooth = vtkSmartPointer<vtkImageGaussianSmooth>::New();    // Used to smooth the image
@@ -104,15 +122,14 @@ vtkPlusBoneEnhancer::vtkPlusBoneEnhancer()
   this->LinesImage->SetExtent(0, 0, 0, 0, 0, 0);
   this->ProcessedLinesImage->SetExtent(0, 0, 0, 0, 0, 0);
 
-  this->IntermediateImageMap.clear();
+  this->IntermediateImageWriter = vtkSmartPointer<vtkPlusIntermediateImageWriter>::New();
 }
 
 //----------------------------------------------------------------------------
 vtkPlusBoneEnhancer::~vtkPlusBoneEnhancer()
 {
-  // Make sure contained smart pointers are deleted
-  this->IntermediateImageMap.clear();
-  this->IntermediatePostfixes.clear();
+  // Make sure that the intermediate image files are complete
+  this->IntermediateImageWriter->Stop();
 }
 
 //----------------------------------------------------------------------------
@@ -182,6 +199,7 @@ PlusStatus vtkPlusBoneEnhancer::ReadConfiguration(vtkSmartPointer<vtkXMLDataElem
     else
     {
       XML_READ_BOOL_ATTRIBUTE_OPTIONAL(SaveIntermediateResults, saveIntermediateResultsBool);
+      XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, IntermediateImageFrameStride, saveIntermediateResultsBool);
     }
     
     // Read tags related to the Gaussian filter
@@ -269,6 +287,7 @@ PlusStatus vtkPlusBoneEnhancer::WriteConfiguration(vtkSmartPointer<vtkXMLDataEle
 
   XML_FIND_NESTED_ELEMENT_CREATE_IF_MISSING(saveIntermediateResultsBool, imageProcessingOperations, "SaveIntermediateResults");
   XML_WRITE_BOOL_ATTRIBUTE(SaveIntermediateResults, saveIntermediateResultsBool)
+  saveIntermediateResultsBool->SetIntAttribute("IntermediateImageFrameStride", this->IntermediateImageFrameStride);
 
   XML_FIND_NESTED_ELEMENT_CREATE_IF_MISSING(gaussianParameters, imageProcessingOperations, "GaussianSmoothing");
   gaussianParameters->SetDoubleAttribute("GaussianStdDev", this->GaussianStdDev);
@@ -366,30 +385,34 @@ void vtkPlusBoneEnhancer::FillLinesImage(vtkSmartPointer<vtkImageData> inputImag
 //----------------------------------------------------------------------------
 void vtkPlusBoneEnhancer::VectorImageToUchar(vtkSmartPointer<vtkImageData> inputImage)
 {
-  unsigned char* vOutput = 0;
-  unsigned char edgeDetectorOutput0;
-  unsigned char edgeDetectorOutput1;
-  float output = 0.0;     // Keep this in [0..255] instead [0..1] for possible future optimization.
-  float output2 = 0.0;
-
   int dims[3] = { 0, 0, 0 };
   this->LinesImage->GetDimensions(dims);
-  this->ConversionImage->SetExtent(this->LinesImage->GetExtent());
-  this->ConversionImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
-  for (int y = dims[1] - 1; y >= 0; --y)
+  if (this->ConversionImage->GetScalarType() != VTK_UNSIGNED_CHAR || this->ConversionImage->GetNumberOfScalarComponents() != 1
+      || !std::equal(this->LinesImage->GetExtent(), this->LinesImage->GetExtent() + 6, this->ConversionImage->GetExtent()))
   {
-    // Initialize variables for a new scan line.
+    // Only reallocate if the extent has changed
+    this->ConversionImage->SetExtent(this->LinesImage->GetExtent());
+    this->ConversionImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  }
 
-    for (int x = dims[0] - 1; x >= 0; --x)   // Go towards transducer
-    {
-      edgeDetectorOutput0 = static_cast<unsigned char>(inputImage->GetScalarComponentAsFloat(x, y, 0, 0));
-      edgeDetectorOutput1 = static_cast<unsigned char>(inputImage->GetScalarComponentAsFloat(x, y, 0, 1));
-      vOutput = static_cast<unsigned char*>(this->ConversionImage->GetScalarPointer(x, y, 0));
-      output = (float)(edgeDetectorOutput0 + edgeDetectorOutput1) / (float)2;                                         // Not mathematically correct, but a quick approximation of sqrt(x^2 + y^2)
+  if (inputImage->GetNumberOfScalarComponents() < 2)
+  {
+    LOG_ERROR("Edge detector output is expected to have at least 2 components");
+    return;
+  }
 
-      *vOutput = (unsigned char)std::max(0, std::min(255, (int)output));
-    }
+  // Both images have the same extent, so pixels can be processed in memory order
+  void* inPtr = inputImage->GetScalarPointer();
+  unsigned char* outPtr = static_cast<unsigned char*>(this->ConversionImage->GetScalarPointer());
+  vtkIdType numberOfPixels = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  switch (inputImage->GetScalarType())
+  {
+    vtkTemplateMacro(vtkPlusBoneEnhancerVectorToUchar(static_cast<VTK_TT*>(inPtr), inputImage->GetNumberOfScalarComponents(), outPtr, numberOfPixels));
+  default:
+    LOG_ERROR("Unsupported edge detector output scalar type: " << inputImage->GetScalarTypeAsString());
   }
+  // Scalars were modified directly, notify the filters that use this image as input
+  this->ConversionImage->Modified();
 }
 
 //----------------------------------------------------------------------------
@@ -405,11 +428,12 @@ void vtkPlusBoneEnhancer::MarkShadowOutline(vtkSmartPointer<vtkImageData> inputI
   int keepInfoCounter;
   bool foundBone;
   unsigned char* vOutput;
+  unsigned char* imagePixels = static_cast<unsigned char*>(inputImage->GetScalarPointer());
 
   int lastVistedValue = 0;
 
   //Setup variables for recording bone areas
-  std::map<std::string, int> currentBoneArea;
+  BoneArea currentBoneArea;
   int boneAreaStart = dims[1] - 1;  //The y coordinate of where the bone outline starts
   int boneDepthSum = 0;             //The sum of the x coordinates of each pixel in the bone outline
   int boneMaxDepth = dims[0] - 1;   //The x coordinate of the right-most pixel in the bone outline
@@ -422,10 +446,11 @@ void vtkPlusBoneEnhancer::MarkShadowOutline(vtkSmartPointer<vtkImageData> inputI
     //When an image is detected, keep up to this many pixles after it
     keepInfoCounter = this->BoneOutlineDepthPx + this->BonePushBackPx;
     foundBone = false;
+    unsigned char* imageRow = imagePixels + static_cast<vtkIdType>(y) * dims[0];
 
     for (int x = dims[0] - 1; x >= 0; --x)
     {
-      vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(x, y, 0));
+      vOutput = imageRow + x;
 
       //If an image is detected
       if (*vOutput != 0)
@@ -449,13 +474,12 @@ void vtkPlusBoneEnhancer::MarkShadowOutline(vtkSmartPointer<vtkImageData> inputI
               if (boneDepthSum != 0)
               {
                 //Save info related to where the bone area
-                currentBoneArea["depth"] = boneDepthSum / (boneAreaStart - y);                  // Store the outline's average x-coordinate
-                currentBoneArea["xMax"] = boneMaxDepth;                                         // Store the outline's maximum x-coordinate (Used for efficiency)
-                currentBoneArea["xMin"] = std::max(boneMinDepth - this->BoneOutlineDepthPx, 0); // Store the outline's minimum x-coordinate (Used for efficiency)
-                currentBoneArea["yMax"] = boneAreaStart;                                        // Store the outline's maximum y-coordinate
-                currentBoneArea["yMin"] = y + 1;                                                // Store the outline's minimum y-coordinate
+                currentBoneArea.Depth = boneDepthSum / (boneAreaStart - y);                    // Store the outline's average x-coordinate
+                currentBoneArea.XMax = boneMaxDepth;                                           // Store the outline's maximum x-coordinate (Used for efficiency)
+                currentBoneArea.XMin = std::max(boneMinDepth - this->BoneOutlineDepthPx, 0);   // Store the outline's minimum x-coordinate (Used for efficiency)
+                currentBoneArea.YMax = boneAreaStart;                                          // Store the outline's maximum y-coordinate
+                currentBoneArea.YMin = y + 1;                                                  // Store the outline's minimum y-coordinate
                 this->BoneAreasInfo.push_back(currentBoneArea);
-                currentBoneArea.clear();
               }
               boneAreaStart = y;
               boneDepthSum = 0;
@@ -496,14 +520,13 @@ void vtkPlusBoneEnhancer::MarkShadowOutline(vtkSmartPointer<vtkImageData> inputI
       if (boneDepthSum != 0)
       {
         //Save info related to where the bone area
-        currentBoneArea["depth"] = boneDepthSum / (boneAreaStart - y);                  // Store the outline's average x-coordinate
-        currentBoneArea["xMax"] = boneMaxDepth;                                         // Store the outline's maximum x-coordinate (Used for efficiency)
-        currentBoneArea["xMin"] = std::max(boneMinDepth - this->BoneOutlineDepthPx, 0); // Store the outline's minimum x-coordinate (Used for efficiency)
-        currentBoneArea["yMax"] = boneAreaStart;                                        // Store the outline's maximum y-coordinate
-        currentBoneArea["yMin"] = y + 1;                                                // Store the outline's minimum y-coordinate
+        currentBoneArea.Depth = boneDepthSum / (boneAreaStart - y);                    // Store the outline's average x-coordinate
+        currentBoneArea.XMax = boneMaxDepth;                                           // Store the outline's maximum x-coordinate (Used for efficiency)
+        currentBoneArea.XMin = std::max(boneMinDepth - this->BoneOutlineDepthPx, 0);   // Store the outline's minimum x-coordinate (Used for efficiency)
+        currentBoneArea.YMax = boneAreaStart;                                          // Store the outline's maximum y-coordinate
+        currentBoneArea.YMin = y + 1;                                                  // Store the outline's minimum y-coordinate
         this->BoneAreasInfo.push_back(currentBoneArea);
         boneDepthSum = 0;
-        currentBoneArea.clear();
       }
       boneMaxDepth = dims[0] - 1;
       boneMinDepth = 0;
@@ -516,13 +539,12 @@ void vtkPlusBoneEnhancer::MarkShadowOutline(vtkSmartPointer<vtkImageData> inputI
   if (boneDepthSum != 0)
   {
     //Save info related to where the bone area
-    currentBoneArea["depth"] = boneDepthSum / (boneAreaStart + 1);                  // Store the outline's average x-coordinate
-    currentBoneArea["xMax"] = boneMaxDepth;                                         // Store the outline's maximum x-coordinate (Used for efficiency)
-    currentBoneArea["xMin"] = std::max(boneMinDepth - this->BoneOutlineDepthPx, 0); // Store the outline's minimum x-coordinate (Used for efficiency)
-    currentBoneArea["yMax"] = boneAreaStart;                                        // Store the outline's maximum y-coordinate
-    currentBoneArea["yMin"] = 0;                                                    // Store the outline's minimum y-coordinate
+    currentBoneArea.Depth = boneDepthSum / (boneAreaStart + 1);                    // Store the outline's average x-coordinate
+    currentBoneArea.XMax = boneMaxDepth;                                           // Store the outline's maximum x-coordinate (Used for efficiency)
+    currentBoneArea.XMin = std::max(boneMinDepth - this->BoneOutlineDepthPx, 0);   // Store the outline's minimum x-coordinate (Used for efficiency)
+    currentBoneArea.YMax = boneAreaStart;                                          // Store the outline's maximum y-coordinate
+    currentBoneArea.YMin = 0;                                                      // Store the outline's minimum y-coordinate
     this->BoneAreasInfo.push_back(currentBoneArea);
-    currentBoneArea.clear();
   }
 }
 
@@ -537,6 +559,7 @@ void vtkPlusBoneEnhancer::ThresholdViaStdDeviation(vtkSmartPointer<vtkImageData>
 
   int dims[3] = { 0, 0, 0 };
   inputImage->GetDimensions(dims);
+  unsigned char* imagePixels = static_cast<unsigned char*>(inputImage->GetScalarPointer());
 
   int max;
 
@@ -555,11 +578,12 @@ void vtkPlusBoneEnhancer::ThresholdViaStdDeviation(vtkSmartPointer<vtkImageData>
     pixelSum = 0;
     squearSum = 0;
     pixelAverage = 0;
+    unsigned char* imageRow = imagePixels + static_cast<vtkIdType>(y) * dims[0];
 
     //determine the average, sum, and max of the row
     for (int x = dims[0] - 1; x >= fatLayerToCut; --x)
     {
-      vInput = inputImage->GetScalarComponentAsFloat(x, y, 0, 0);
+      vInput = imageRow[x];
       pixelSum += vInput;
       squearSum += vInput * vInput;
 
@@ -581,7 +605,7 @@ void vtkPlusBoneEnhancer::ThresholdViaStdDeviation(vtkSmartPointer<vtkImageData>
     {
       for (int x = dims[0] - 1; x >= 0; --x)
       {
-        vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(x, y, 0));
+        vOutput = imageRow + x;
         if (*vOutput < thresholdValue && *vOutput != 0)
         {
           *vOutput = 0;
@@ -658,6 +682,10 @@ vtkSmartPointer<vtkImageData> vtkPlusBoneEnhancer::UnprocessedFrameToLinearImage
     this->FirstFrame = false;
   }
   this->BoneAreasInfo.clear();
+  if (this->SaveIntermediateResults)
+  {
+    this->BeginIntermediateImageFrame();
+  }
 
   igsioVideoFrame* inputImage = inputFrame->GetImageData();
   //an image used to transport output between filters
@@ -749,94 +777,55 @@ void vtkPlusBoneEnhancer::RemoveNoise(vtkSmartPointer<vtkImageData> inputImage)
     this->AddIntermediateImage("_09PostFilters_1ShadowOutline", this->BinaryImageForMorphology);
   }
 
-  // Save all stored intermediate images to mha files in output
-  if (this->SaveIntermediateResults)
-  {
-    this->SaveAllIntermediateResultsToFile();
-  }
-  
   inputImage->DeepCopy(this->BinaryImageForMorphology);
 }
 
 
 //----------------------------------------------------------------------------
-/*
-Finds and saves all intermediate images that have been recorded.
-Saves the images by calling this->SaveIntermediateResultToFile()
-Returns PLUS_FAIL if this->SaveIntermediateResultToFile() encounters an error occured during this
-process, returns PLUS_SUCCESS otherwise.
-*/
 PlusStatus vtkPlusBoneEnhancer::SaveAllIntermediateResultsToFile()
 {
-  for (int postfixIndex = this->IntermediatePostfixes.size() - 1; postfixIndex >= 0; postfixIndex -= 1)
-  {
-    if (this->SaveIntermediateResultToFile(this->IntermediatePostfixes.at(postfixIndex)) == PLUS_FAIL)
-    {
-      return PLUS_FAIL;
-    }
-  }
-  return PLUS_SUCCESS;
+  return this->IntermediateImageWriter->Stop();
 }
 
 //----------------------------------------------------------------------------
-/*
-Takes a postfix as an argument and saves the intermediate image associated with that postfix
-Returns PLUS_FAIL if an error occured during this process, returns PLUS_SUCCESS otherwise
-*/
-PlusStatus vtkPlusBoneEnhancer::SaveIntermediateResultToFile(char* fileNamePostfix)
+void vtkPlusBoneEnhancer::BeginIntermediateImageFrame()
 {
-  std::map<char*, vtkSmartPointer<vtkIGSIOTrackedFrameList> >::iterator indexIterator = this->IntermediateImageMap.find(fileNamePostfix);
-  if (indexIterator != this->IntermediateImageMap.end())
+  if (!this->IntermediateImageWriter->IsStarted())
   {
-    //Try to save the intermediate image
-    if (vtkPlusSequenceIO::Write(this->IntermediateImageFileName + "_Plus" + std::string(fileNamePostfix) + ".mha", this->IntermediateImageMap[fileNamePostfix], US_IMG_ORIENT_MF, false) == PLUS_FAIL)
+    this->IntermediateImageWriter->SetFileNamePrefix(this->IntermediateImageFileName + "_Plus");
+    this->IntermediateImageWriter->SetFrameStride(this->IntermediateImageFrameStride);
+    if (this->IntermediateImageWriter->Start() != PLUS_SUCCESS)
     {
-      LOG_ERROR("An issue occured when trying to save the intermediate image with the postfix: " << fileNamePostfix);
-      return PLUS_FAIL;
-    }
-    else
-    {
-      LOG_INFO("Sucessfully wrote the intermediate image with the postfix: " << fileNamePostfix);
+      LOG_ERROR("Failed to start writing of intermediate images");
+      return;
     }
   }
-
-  return PLUS_SUCCESS;
+  this->IntermediateImageWriter->BeginFrame();
 }
 
 //----------------------------------------------------------------------------
-void vtkPlusBoneEnhancer::AddIntermediateImage(char* fileNamePostfix, vtkSmartPointer<vtkImageData> image)
+void vtkPlusBoneEnhancer::AddIntermediateImage(const char* fileNamePostfix, vtkSmartPointer<vtkImageData> image)
 {
-  if (fileNamePostfix == "")
+  if (fileNamePostfix == NULL || fileNamePostfix[0] == 0)
   {
     LOG_WARNING("The empty string was given as an intermediate image file postfix.");
+    return;
   }
-
-  // See if the intermediate image should be created
-  std::map<char*, vtkSmartPointer<vtkIGSIOTrackedFrameList> >::iterator indexIterator = this->IntermediateImageMap.find(fileNamePostfix);
-  if (indexIterator != this->IntermediateImageMap.end()){}
-  else
+  if (!this->IntermediateImageWriter->IsCurrentFrameRecorded())
   {
-    // Create if not found
-    this->IntermediateImageMap[fileNamePostfix] = vtkIGSIOTrackedFrameList::New();
-
-    this->IntermediatePostfixes.push_back(fileNamePostfix);
+    return;
   }
-
-  //Add the current frame to its vtkIGSIOTrackedFrameList
-  igsioVideoFrame linesVideoFrame;
-  linesVideoFrame.DeepCopyFrom(image);
-  igsioTrackedFrame linesTrackedFrame;
-  linesTrackedFrame.SetImageData(linesVideoFrame);
-  this->IntermediateImageMap[fileNamePostfix]->AddTrackedFrame(&linesTrackedFrame);
+  this->IntermediateImageWriter->AddImage(fileNamePostfix, image);
 }
 
 //----------------------------------------------------------------------------
 // Given a vtk filter, get the image that would display at that point and save it
-void vtkPlusBoneEnhancer::AddIntermediateFromFilter(char* fileNamePostfix, vtkImageAlgorithm* imageFilter)
+void vtkPlusBoneEnhancer::AddIntermediateFromFilter(const char* fileNamePostfix, vtkImageAlgorithm* imageFilter)
 {
-  if (fileNamePostfix == "")
+  if (!this->IntermediateImageWriter->IsCurrentFrameRecorded())
   {
-    LOG_WARNING("The empty string was given as an intermediate image file postfix.");
+    // Skip the filter update, the image would not be saved anyway
+    return;
   }
 
   vtkSmartPointer<vtkImageData> tempOutputImage = vtkSmartPointer<vtkImageData>::New();
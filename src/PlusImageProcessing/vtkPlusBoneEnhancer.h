@@ -22,6 +22,7 @@ class vtkImageGaussianSmooth;
 class vtkImageSobel2D;
 class vtkImageIslandRemoval2D;
 class vtkImageDilateErode3D;
+class vtkPlusIntermediateImageWriter;
 class vtkPlusUsScanConvert;
 
 /*!
@@ -48,10 +49,18 @@ public:
   /*! Get the Type attribute of the configuration element */
   virtual const char* GetProcessorTypeName() { return "vtkPlusBoneEnhancer"; };
 
-  /*! If optional output files for intermediate images should saved */
+  /*!
+    If optional output files for intermediate images should saved.
+    The file name must be set before the first frame is processed, as images are written into the files during processing.
+  */
   vtkSetMacro(IntermediateImageFileName, std::string);
+  vtkGetMacro(IntermediateImageFileName, std::string);
   vtkSetMacro(SaveIntermediateResults, bool);
   vtkGetMacro(SaveIntermediateResults, bool);
+
+  /*! Only intermediate images of every N-th frame are saved. 1 means that images of all frames are saved. */
+  vtkSetMacro(IntermediateImageFrameStride, int);
+  vtkGetMacro(IntermediateImageFrameStride, int);
   
   /*! Get and Set methods for variables related to the scanner used */
   vtkSetMacro(NumberOfScanLines, int);
@@ -98,12 +107,23 @@ public:
   /*! Steps to note and eliminate false boen areas */
   void MarkShadowOutline(vtkSmartPointer<vtkImageData> inputImage);
 
-  /*! Methods related to intermediate images */
-  std::map<char*, vtkSmartPointer<vtkIGSIOTrackedFrameList> > GetIntermediateImageMap() { return (this->IntermediateImageMap); };
+  /*! Write the remaining intermediate images and finalize the intermediate image files. Processing of further frames starts new files. */
   PlusStatus SaveAllIntermediateResultsToFile();
-  PlusStatus SaveIntermediateResultToFile(char* fileNamePostfix);
 
 protected:
+  /*! Location of a bone outline segment that MarkShadowOutline found, in lines image pixel coordinates */
+  struct BoneArea
+  {
+    /*! Average x coordinate of the outline */
+    int Depth;
+    /*! Minimum x coordinate of the outline, including the outline depth */
+    int XMin;
+    /*! Maximum x coordinate of the outline */
+    int XMax;
+    int YMin;
+    int YMax;
+  };
+
   vtkPlusBoneEnhancer();
   virtual ~vtkPlusBoneEnhancer();
 
@@ -112,8 +132,10 @@ protected:
 
   void ImageConjunction(vtkSmartPointer<vtkImageData> inputImage, vtkSmartPointer<vtkImageData> maskImage);
 
-  void AddIntermediateImage(char* fileNamePostfix, vtkSmartPointer<vtkImageData> image);
-  void AddIntermediateFromFilter(char* fileNamePostfix, vtkImageAlgorithm* imageAlgorithm);
+  /*! Start the intermediate image writer if needed and notify it that processing of a new frame is started */
+  void BeginIntermediateImageFrame();
+  void AddIntermediateImage(const char* fileNamePostfix, vtkSmartPointer<vtkImageData> image);
+  void AddIntermediateFromFilter(const char* fileNamePostfix, vtkImageAlgorithm* imageAlgorithm);
 
   virtual PlusStatus ProcessImageExtents();
 
@@ -152,17 +174,18 @@ protected:
 
   bool SaveIntermediateResults;
   std::string IntermediateImageFileName;
-  std::vector<char*> IntermediatePostfixes;
+  int IntermediateImageFrameStride;
 
-  /*! Image after some of the processing operations have been applied */
-  std::map<char*, vtkSmartPointer<vtkIGSIOTrackedFrameList> > IntermediateImageMap;
+  /*! Writes images after some of the processing operations have been applied, one sequence file per processing stage */
+  vtkSmartPointer<vtkPlusIntermediateImageWriter> IntermediateImageWriter;
 
   /*! Image for pixels (uchar) along scan lines only */
   vtkSmartPointer<vtkImageData> LinesImage;
   /*! Pixels (float) store probability of belonging to shadow */
   vtkSmartPointer<vtkImageData> ProcessedLinesImage;
 
-  std::vector<std::map<std::string, int> > BoneAreasInfo;
+  /*! Bone areas of the current frame. The vector is reused between frames to avoid memory allocations. */
+  std::vector<BoneArea> BoneAreasInfo;
   bool FirstFrame;
 
 private:
@@ -0,0 +1,306 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusIntermediateImageWriter.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <igsioVideoFrame.h>
+#include <vtkIGSIOAccurateTimer.h>
+#include <vtkIGSIORecursiveCriticalSection.h>
+#include <vtkIGSIOSequenceIO.h>
+#include <vtkIGSIOSequenceIOBase.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkPlusIntermediateImageWriter);
+
+//----------------------------------------------------------------------------
+vtkPlusIntermediateImageWriter::StageFile::StageFile()
+  : Writer(NULL)
+  , Frames(vtkSmartPointer<vtkIGSIOTrackedFrameList>::New())
+  , IsHeaderPrepared(false)
+  , NumberOfWrittenFrames(0)
+  , Failed(false)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusIntermediateImageWriter::vtkPlusIntermediateImageWriter()
+  : FrameStride(1)
+  , MaximumQueueLength(50)
+  , CurrentFrameIndex(-1)
+  , Threader(vtkSmartPointer<vtkMultiThreader>::New())
+  , Mutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
+  , WriterActive(false)
+  , WriterThreadId(-1)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusIntermediateImageWriter::~vtkPlusIntermediateImageWriter()
+{
+  // Make sure the files are complete even if the user did not call Stop
+  this->Stop();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIntermediateImageWriter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileNamePrefix: " << this->FileNamePrefix << std::endl;
+  os << indent << "FrameStride: " << this->FrameStride << std::endl;
+  os << indent << "MaximumQueueLength: " << this->MaximumQueueLength << std::endl;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIntermediateImageWriter::Start()
+{
+  if (this->WriterThreadId >= 0)
+  {
+    // already started
+    return PLUS_SUCCESS;
+  }
+  if (this->FrameStride < 1)
+  {
+    LOG_ERROR("Invalid intermediate image frame stride: " << this->FrameStride << ". It must be at least 1.");
+    return PLUS_FAIL;
+  }
+  if (this->MaximumQueueLength < 1)
+  {
+    LOG_ERROR("Invalid intermediate image maximum queue length: " << this->MaximumQueueLength << ". It must be at least 1.");
+    return PLUS_FAIL;
+  }
+
+  this->CurrentFrameIndex = -1;
+  this->WriterActive = true;
+  this->WriterThreadId = this->Threader->SpawnThread((vtkThreadFunctionType)&WriterThread, this);
+  if (this->WriterThreadId < 0)
+  {
+    LOG_ERROR("Failed to start intermediate image writer thread");
+    this->WriterActive = false;
+    this->WriterThreadId = -1;
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIntermediateImageWriter::Stop()
+{
+  if (this->WriterThreadId < 0)
+  {
+    // not started
+    return PLUS_SUCCESS;
+  }
+
+  // The writer thread writes all the queued images before it stops, wait until it has finished
+  this->WriterActive = false;
+  this->Threader->TerminateThread(this->WriterThreadId);
+  this->WriterThreadId = -1;
+
+  LOG_DEBUG("Intermediate image writer thread stopped");
+
+  return this->CloseFiles();
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIntermediateImageWriter::IsStarted() const
+{
+  return this->WriterThreadId >= 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIntermediateImageWriter::BeginFrame()
+{
+  this->CurrentFrameIndex++;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIntermediateImageWriter::IsCurrentFrameRecorded() const
+{
+  return this->IsStarted() && this->CurrentFrameIndex >= 0 && (this->CurrentFrameIndex % this->FrameStride) == 0;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIntermediateImageWriter::AddImage(const std::string& stageName, vtkImageData* image)
+{
+  if (!this->IsStarted())
+  {
+    LOG_ERROR("Cannot add intermediate image of stage " << stageName << ": the writer is not started");
+    return PLUS_FAIL;
+  }
+  if (image == NULL)
+  {
+    LOG_ERROR("Cannot add intermediate image of stage " << stageName << ": invalid image");
+    return PLUS_FAIL;
+  }
+  if (!this->IsCurrentFrameRecorded())
+  {
+    return PLUS_SUCCESS;
+  }
+
+  // The image is copied, because the caller reuses it for processing the next stages
+  QueuedImage queuedImage;
+  queuedImage.StageName = stageName;
+  queuedImage.Image = vtkSmartPointer<vtkImageData>::New();
+  queuedImage.Image->DeepCopy(image);
+
+  while (1)
+  {
+    {
+      igsioLockGuard<vtkIGSIORecursiveCriticalSection> queueGuard(this->Mutex);
+      if (static_cast<int>(this->Queue.size()) < this->MaximumQueueLength)
+      {
+        this->Queue.push_back(queuedImage);
+        return PLUS_SUCCESS;
+      }
+    }
+    // queue is full, wait until the writer thread catches up
+    vtkIGSIOAccurateTimer::Delay(0.001);
+  }
+}
+
+//----------------------------------------------------------------------------
+void* vtkPlusIntermediateImageWriter::WriterThread(vtkMultiThreader::ThreadInfo* data)
+{
+  vtkPlusIntermediateImageWriter* self = (vtkPlusIntermediateImageWriter*)(data->UserData);
+
+  // Write images until a stop is requested
+  while (self->WriterActive)
+  {
+    self->WriteQueuedImages();
+    // no images in the queue, wait a bit before checking again
+    vtkIGSIOAccurateTimer::Delay(0.005);
+  }
+
+  // Images that were added before the stop request are still written
+  self->WriteQueuedImages();
+
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIntermediateImageWriter::WriteQueuedImages()
+{
+  // The mutex is locked only during management of the queue, so images can be added while an image is written
+  while (1)
+  {
+    QueuedImage queuedImage;
+    {
+      igsioLockGuard<vtkIGSIORecursiveCriticalSection> queueGuard(this->Mutex);
+      if (this->Queue.empty())
+      {
+        return;
+      }
+      queuedImage = this->Queue.front();
+      this->Queue.pop_front();
+    }
+    this->WriteImage(queuedImage);
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIntermediateImageWriter::WriteImage(const QueuedImage& queuedImage)
+{
+  StageFile& stageFile = this->StageFiles[queuedImage.StageName];
+  if (stageFile.Failed)
+  {
+    // error has been already reported
+    return PLUS_FAIL;
+  }
+
+  if (stageFile.Writer == NULL)
+  {
+    std::string fileName = this->FileNamePrefix + queuedImage.StageName + ".mha";
+    if (!vtksys::SystemTools::FileIsFullPath(fileName))
+    {
+      fileName = vtkPlusConfig::GetInstance()->GetOutputPath(fileName);
+    }
+    stageFile.Writer = vtkIGSIOSequenceIO::CreateSequenceHandlerForFile(fileName);
+    if (stageFile.Writer == NULL)
+    {
+      LOG_ERROR("Could not create writer for intermediate image file: " << fileName);
+      stageFile.Failed = true;
+      return PLUS_FAIL;
+    }
+    stageFile.Writer->SetUseCompression(false);
+    stageFile.Writer->SetImageOrientationInFile(US_IMG_ORIENT_MF);
+    stageFile.Writer->SetTrackedFrameList(stageFile.Frames);
+    stageFile.Writer->SetFileName(fileName);
+  }
+
+  igsioVideoFrame videoFrame;
+  videoFrame.DeepCopyFrom(queuedImage.Image);
+  igsioTrackedFrame trackedFrame;
+  trackedFrame.SetImageData(videoFrame);
+  stageFile.Frames->AddTrackedFrame(&trackedFrame);
+
+  if (!stageFile.IsHeaderPrepared)
+  {
+    if (stageFile.Writer->PrepareHeader() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to prepare header of intermediate image file: " << stageFile.Writer->GetFileName());
+      stageFile.Failed = true;
+      return PLUS_FAIL;
+    }
+    stageFile.IsHeaderPrepared = true;
+  }
+  if (stageFile.Writer->AppendImagesToHeader() != PLUS_SUCCESS || stageFile.Writer->WriteImages() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to write image into intermediate image file: " << stageFile.Writer->GetFileName());
+    stageFile.Failed = true;
+    return PLUS_FAIL;
+  }
+  stageFile.Frames->Clear();
+  stageFile.NumberOfWrittenFrames++;
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIntermediateImageWriter::CloseFiles()
+{
+  PlusStatus status = PLUS_SUCCESS;
+  for (std::map<std::string, StageFile>::iterator it = this->StageFiles.begin(); it != this->StageFiles.end(); ++it)
+  {
+    StageFile& stageFile = it->second;
+    if (stageFile.Writer == NULL)
+    {
+      continue;
+    }
+    if (stageFile.Failed)
+    {
+      status = PLUS_FAIL;
+    }
+    if (stageFile.IsHeaderPrepared)
+    {
+      stageFile.Writer->UpdateDimensionsCustomStrings(stageFile.NumberOfWrittenFrames, false);
+      stageFile.Writer->UpdateFieldInImageHeader(stageFile.Writer->GetDimensionSizeString());
+      stageFile.Writer->UpdateFieldInImageHeader(stageFile.Writer->GetDimensionKindsString());
+      if (stageFile.Writer->FinalizeHeader() != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Unable to finalize header of intermediate image file: " << stageFile.Writer->GetFileName());
+        status = PLUS_FAIL;
+      }
+      else
+      {
+        LOG_INFO("Successfully wrote " << stageFile.NumberOfWrittenFrames << " intermediate images into " << stageFile.Writer->GetFileName());
+      }
+      stageFile.Writer->Close();
+    }
+    stageFile.Writer->Delete();
+    stageFile.Writer = NULL;
+  }
+  this->StageFiles.clear();
+  return status;
+}
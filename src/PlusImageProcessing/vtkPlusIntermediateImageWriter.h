@@ -0,0 +1,141 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusIntermediateImageWriter_h
+#define __vtkPlusIntermediateImageWriter_h
+
+// Local includes
+#include "vtkPlusImageProcessingExport.h"
+
+// VTK includes
+#include <vtkMultiThreader.h>
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+// STL includes
+#include <atomic>
+#include <deque>
+#include <map>
+
+class vtkIGSIORecursiveCriticalSection;
+class vtkIGSIOSequenceIOBase;
+class vtkIGSIOTrackedFrameList;
+class vtkImageData;
+
+/*!
+\class vtkPlusIntermediateImageWriter
+\brief Write images of the processing stages of an image processing algorithm into sequence files while the frames are processed
+
+Each processing stage is written into its own sequence file (FileNamePrefix + stage name + ".mha").
+Images are copied into a queue by AddImage and a background thread appends them to the sequence files,
+so the images do not have to be kept in memory until the end of the processing.
+The queue length is limited: AddImage waits for the writer thread if the queue is full.
+The sequence file headers are finalized in Stop.
+
+\ingroup PlusLibImageProcessingAlgo
+*/
+class vtkPlusImageProcessingExport vtkPlusIntermediateImageWriter : public vtkObject
+{
+public:
+  static vtkPlusIntermediateImageWriter* New();
+  vtkTypeMacro(vtkPlusIntermediateImageWriter, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent);
+
+  /*! Start the writer thread. Images can be added only after the writer is started. */
+  PlusStatus Start();
+
+  /*! Write all queued images, finalize and close the sequence files, and stop the writer thread */
+  PlusStatus Stop();
+
+  /*! Returns true if the writer thread is running */
+  bool IsStarted() const;
+
+  /*! Notify the writer that processing of a new frame is started. Images of every FrameStride-th frame are written, starting with the first frame. */
+  void BeginFrame();
+
+  /*! Returns true if images of the current frame are written. Images of other frames are ignored by AddImage, so the caller may skip computing them. */
+  bool IsCurrentFrameRecorded() const;
+
+  /*! Queue a copy of the image for writing into the sequence file of the processing stage */
+  PlusStatus AddImage(const std::string& stageName, vtkImageData* image);
+
+  /*! Prefix of the sequence file names. Relative paths are interpreted relative to the output directory. */
+  vtkSetMacro(FileNamePrefix, std::string);
+  vtkGetMacro(FileNamePrefix, std::string);
+
+  /*! Only every N-th frame is written. 1 means that all frames are written. */
+  vtkSetMacro(FrameStride, int);
+  vtkGetMacro(FrameStride, int);
+
+  /*! Maximum number of images waiting to be written, limits the memory usage if image writing is slower than processing */
+  vtkSetMacro(MaximumQueueLength, int);
+  vtkGetMacro(MaximumQueueLength, int);
+
+protected:
+  vtkPlusIntermediateImageWriter();
+  virtual ~vtkPlusIntermediateImageWriter();
+
+  /*! Image waiting to be written */
+  struct QueuedImage
+  {
+    std::string StageName;
+    vtkSmartPointer<vtkImageData> Image;
+  };
+
+  /*! Sequence file of a processing stage */
+  struct StageFile
+  {
+    StageFile();
+    vtkIGSIOSequenceIOBase* Writer;
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> Frames;
+    bool IsHeaderPrepared;
+    int NumberOfWrittenFrames;
+    bool Failed;
+  };
+
+  /*! Thread that writes the queued images into the sequence files */
+  static void* WriterThread(vtkMultiThreader::ThreadInfo* data);
+
+  /*! Write all images that are currently in the queue. Called from the writer thread only. */
+  void WriteQueuedImages();
+
+  /*! Append an image to the sequence file of its processing stage. Called from the writer thread only. */
+  PlusStatus WriteImage(const QueuedImage& queuedImage);
+
+  /*! Finalize the headers of all sequence files and close them */
+  PlusStatus CloseFiles();
+
+  std::string FileNamePrefix;
+  int FrameStride;
+  int MaximumQueueLength;
+
+  /*! Index of the current frame since the writer was started */
+  int CurrentFrameIndex;
+
+  /*! Images waiting to be written, guarded by Mutex */
+  std::deque<QueuedImage> Queue;
+
+  /*! Sequence files, accessed only by the writer thread while it is running */
+  std::map<std::string, StageFile> StageFiles;
+
+  /*! vtkMultiThreader instance for controlling threads */
+  vtkSmartPointer<vtkMultiThreader> Threader;
+
+  /*! Mutex instance for safe data access */
+  vtkSmartPointer<vtkIGSIORecursiveCriticalSection> Mutex;
+
+  /*! Set while the writer thread has to keep waiting for new images, cleared by Stop */
+  std::atomic<bool> WriterActive;
+
+  // Thread identifier
+  int WriterThreadId;
+
+private:
+  vtkPlusIntermediateImageWriter(const vtkPlusIntermediateImageWriter&);  // Not implemented.
+  void operator=(const vtkPlusIntermediateImageWriter&);  // Not implemented.
+};
+
+#endif
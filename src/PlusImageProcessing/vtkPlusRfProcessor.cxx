@@ -12,6 +12,7 @@ See License.txt for details.
 #include "vtkPlusUsScanConvertLinear.h"
 #include "vtkPlusUsScanConvertCurvilinear.h"
 #include "vtkImageData.h"
+#include "vtkPointData.h"
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkPlusRfProcessor);
@@ -24,6 +25,11 @@ vtkPlusRfProcessor::vtkPlusRfProcessor()
 {
   this->RfToBrightnessConverter=vtkPlusRfToBrightnessConvert::New();
   this->ScanConverter=NULL;  
+  this->NumberOfPooledOutputs=0;
+  this->CurrentPooledOutputIndex=-1;
+  this->PooledOutputSourceTime=0;
+  this->NumberOfPooledOutputAllocations=0;
+  this->NumberOfDestinationAllocations=0;
 }
 
 //----------------------------------------------------------------------------
@@ -38,6 +44,9 @@ vtkPlusRfProcessor::~vtkPlusRfProcessor()
 void vtkPlusRfProcessor::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+  os << indent << "NumberOfPooledOutputs: " << this->NumberOfPooledOutputs << std::endl;
+  os << indent << "NumberOfPooledOutputAllocations: " << this->NumberOfPooledOutputAllocations << std::endl;
+  os << indent << "NumberOfDestinationAllocations: " << this->NumberOfDestinationAllocations << std::endl;
 }
 
 //-----------------------------------------------------------------------------
@@ -64,7 +73,113 @@ vtkImageData* vtkPlusRfProcessor::GetBrightnessScanConvertedImage()
     return GetBrightnessConvertedImage();
   }
   this->ScanConverter->Update();
-  return this->ScanConverter->GetOutput();
+  vtkImageData* scanConvertedImage=this->ScanConverter->GetOutput();
+  if (this->NumberOfPooledOutputs<=0)
+  {
+    return scanConvertedImage;
+  }
+
+  if (static_cast<int>(this->PooledOutputs.size())!=this->NumberOfPooledOutputs)
+  {
+    AllocatePooledOutputs();
+  }
+  if (this->CurrentPooledOutputIndex>=0 && scanConvertedImage->GetMTime()==this->PooledOutputSourceTime)
+  {
+    // The scan converter output has not changed since the last call, the current pooled output is up-to-date
+    return this->PooledOutputs[this->CurrentPooledOutputIndex];
+  }
+
+  // Use the oldest pooled output, images that were returned recently remain valid
+  this->CurrentPooledOutputIndex=(this->CurrentPooledOutputIndex+1)%this->NumberOfPooledOutputs;
+  vtkImageData* pooledOutput=this->PooledOutputs[this->CurrentPooledOutputIndex];
+  if (CopyImage(scanConvertedImage, pooledOutput))
+  {
+    this->NumberOfPooledOutputAllocations++;
+  }
+  this->PooledOutputSourceTime=scanConvertedImage->GetMTime();
+  return pooledOutput;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusRfProcessor::CopyBrightnessScanConvertedImage(vtkImageData* destination)
+{
+  if (destination==NULL)
+  {
+    LOG_ERROR("vtkPlusRfProcessor::CopyBrightnessScanConvertedImage failed: invalid destination image");
+    return PLUS_FAIL;
+  }
+  vtkImageData* scanConvertedImage=GetBrightnessScanConvertedImage();
+  if (scanConvertedImage==NULL)
+  {
+    LOG_ERROR("vtkPlusRfProcessor::CopyBrightnessScanConvertedImage failed: no scan converted image is available");
+    return PLUS_FAIL;
+  }
+  if (CopyImage(scanConvertedImage, destination))
+  {
+    this->NumberOfDestinationAllocations++;
+  }
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusRfProcessor::ResetAllocationCounters()
+{
+  this->NumberOfPooledOutputAllocations=0;
+  this->NumberOfDestinationAllocations=0;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusRfProcessor::AllocatePooledOutputs()
+{
+  this->PooledOutputs.clear();
+  this->CurrentPooledOutputIndex=-1;
+  this->PooledOutputSourceTime=0;
+  for (int i=0; i<this->NumberOfPooledOutputs; i++)
+  {
+    vtkSmartPointer<vtkImageData> pooledOutput=vtkSmartPointer<vtkImageData>::New();
+    if (this->ScanConverter!=NULL)
+    {
+      // Scan converted B-mode images are single-component unsigned char images
+      int outputExtent[6]={0};
+      this->ScanConverter->GetOutputImageExtent(outputExtent);
+      pooledOutput->SetExtent(outputExtent);
+      pooledOutput->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+      this->NumberOfPooledOutputAllocations++;
+    }
+    this->PooledOutputs.push_back(pooledOutput);
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool vtkPlusRfProcessor::CopyImage(vtkImageData* source, vtkImageData* destination)
+{
+  vtkDataArray* sourceScalars=source->GetPointData()->GetScalars();
+  if (sourceScalars==NULL)
+  {
+    destination->DeepCopy(source);
+    return true;
+  }
+
+  // A buffer that is shared with another image must not be overwritten
+  vtkDataArray* destinationScalars=destination->GetPointData()->GetScalars();
+  bool reuseBuffer=(destinationScalars!=NULL
+    && destinationScalars->GetReferenceCount()==1
+    && destinationScalars->GetDataType()==sourceScalars->GetDataType()
+    && destinationScalars->GetNumberOfComponents()==sourceScalars->GetNumberOfComponents()
+    && destinationScalars->GetNumberOfTuples()==sourceScalars->GetNumberOfTuples());
+
+  destination->SetExtent(source->GetExtent());
+  destination->SetSpacing(source->GetSpacing());
+  destination->SetOrigin(source->GetOrigin());
+  if (!reuseBuffer)
+  {
+    destination->AllocateScalars(sourceScalars->GetDataType(), sourceScalars->GetNumberOfComponents());
+    destinationScalars=destination->GetPointData()->GetScalars();
+  }
+  memcpy(destinationScalars->GetVoidPointer(0), sourceScalars->GetVoidPointer(0), sourceScalars->GetDataSize()*sourceScalars->GetDataTypeSize());
+  destinationScalars->Modified();
+  destination->Modified();
+  return !reuseBuffer;
 }
 
 //-----------------------------------------------------------------------------
@@ -79,6 +194,9 @@ void vtkPlusRfProcessor::SetScanConverter(vtkPlusUsScanConvert* scanConverter)
     this->ScanConverter->UnRegister(this);
     this->ScanConverter=NULL;
   }    
+  // Pooled outputs are reallocated with the output image size of the new scan converter
+  this->PooledOutputs.clear();
+  this->CurrentPooledOutputIndex=-1;
   this->ScanConverter=scanConverter;
   if (scanConverter!=NULL)
   {
@@ -94,6 +212,8 @@ PlusStatus vtkPlusRfProcessor::ReadConfiguration(vtkXMLDataElement* rfProcessing
 
   PlusStatus status=PLUS_SUCCESS;
 
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfPooledOutputs, rfProcessingElement);
+
   vtkXMLDataElement* brightnessConversionElement = rfProcessingElement->FindNestedElementWithName("RfToBrightnessConversion"); 
   if (brightnessConversionElement)
   {
@@ -152,6 +272,12 @@ PlusStatus vtkPlusRfProcessor::ReadConfiguration(vtkXMLDataElement* rfProcessing
     SetScanConverter(NULL);
   }
 
+  if (this->NumberOfPooledOutputs>0)
+  {
+    // Preallocate the pooled outputs now, so that no allocation is needed while processing frames
+    AllocatePooledOutputs();
+  }
+
   return status;
 }
 
@@ -168,6 +294,15 @@ PlusStatus vtkPlusRfProcessor::WriteConfiguration(vtkXMLDataElement* rfElement)
 
   PlusStatus status(PLUS_SUCCESS);
 
+  if (this->NumberOfPooledOutputs>0)
+  {
+    rfElement->SetIntAttribute("NumberOfPooledOutputs", this->NumberOfPooledOutputs);
+  }
+  else
+  {
+    XML_REMOVE_ATTRIBUTE("NumberOfPooledOutputs", rfElement);
+  }
+
   if ( this->RfToBrightnessConverter->WriteConfiguration(brightnessConversionElement) != PLUS_SUCCESS )
   {
     status = PLUS_FAIL;
@@ -9,6 +9,10 @@
 
 #include "vtkPlusImageProcessingExport.h"
 
+#include "vtkSmartPointer.h"
+
+#include <vector>
+
 class vtkPlusRfToBrightnessConvert;
 class vtkPlusUsScanConvert;
 class vtkImageData;
@@ -16,6 +20,9 @@ class vtkImageData;
 /*!
   \class vtkPlusRfProcessor 
   \brief Convenience class to combine multiple algorithms to compute a displayable B-mode frame from RF data
+
+  If NumberOfPooledOutputs is positive then scan converted images are copied into a fixed ring of preallocated
+  output images, so the image buffers are not reallocated as long as the output image geometry is unchanged.
   \ingroup PlusLibImageProcessingAlgo
 */ 
 class vtkPlusImageProcessingExport vtkPlusRfProcessor : public vtkObject
@@ -33,9 +40,20 @@ public:
   /*! Get the B-mode image after brightness conversion, before scan conversion */
   virtual vtkImageData* GetBrightnessConvertedImage(); 
 
-  /*! Get the B-mode image after brightness and scan conversion */
+  /*!
+    Get the B-mode image after brightness and scan conversion.
+    If NumberOfPooledOutputs is positive then one of the pooled output images is returned,
+    which remains valid until NumberOfPooledOutputs more scan converted images are generated.
+  */
   virtual vtkImageData* GetBrightnessScanConvertedImage(); 
 
+  /*!
+    Copy the B-mode image after brightness and scan conversion into the destination image.
+    The image buffer of the destination is reused if the image size and scalar type are unchanged
+    and the buffer is not shared with other images.
+  */
+  virtual PlusStatus CopyBrightnessScanConvertedImage(vtkImageData* destination);
+
   /*! Read configuration from xml data */
   virtual PlusStatus ReadConfiguration(vtkXMLDataElement* rfElement); 
 
@@ -51,6 +69,19 @@ public:
   /*! Get the rf to brightness converter object */
   vtkGetMacro(RfToBrightnessConverter, vtkPlusRfToBrightnessConvert*);
 
+  /*! Number of pooled output images. If 0 then the output image of the scan converter is returned directly. */
+  vtkSetMacro(NumberOfPooledOutputs, int);
+  vtkGetMacro(NumberOfPooledOutputs, int);
+
+  /*! Get the number of pooled output image buffer allocations, including the preallocation of the pool */
+  vtkGetMacro(NumberOfPooledOutputAllocations, int);
+
+  /*! Get the number of destination image buffer allocations in CopyBrightnessScanConvertedImage */
+  vtkGetMacro(NumberOfDestinationAllocations, int);
+
+  /*! Set all allocation counters to zero */
+  void ResetAllocationCounters();
+
   static const char* GetRfProcessorTagName();
 
 protected:
@@ -62,6 +93,22 @@ protected:
   vtkPlusUsScanConvert* ScanConverter;  
   std::vector<vtkPlusUsScanConvert*> AvailableScanConverters;  
 
+  /*! Create the pooled output images and allocate their buffers with the output image size of the scan converter */
+  void AllocatePooledOutputs();
+
+  /*! Copy image geometry and scalars. Returns true if the image buffer of the destination had to be allocated. */
+  static bool CopyImage(vtkImageData* source, vtkImageData* destination);
+
+  int NumberOfPooledOutputs;
+  std::vector< vtkSmartPointer<vtkImageData> > PooledOutputs;
+  /*! Index of the pooled output that contains the latest scan converted image, -1 if none of them */
+  int CurrentPooledOutputIndex;
+  /*! Modification time of the scan converter output when it was last copied into a pooled output */
+  vtkMTimeType PooledOutputSourceTime;
+
+  int NumberOfPooledOutputAllocations;
+  int NumberOfDestinationAllocations;
+
   static const char* RF_PROCESSOR_TAG_NAME;
 }; 
 
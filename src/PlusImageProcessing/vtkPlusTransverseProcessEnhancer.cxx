@@ -24,6 +24,7 @@ See License.txt for details.
 #include <vtkImageThreshold.h>
 #include <vtkObjectFactory.h>
 
+#include <algorithm>
 #include <cmath>
 
 //----------------------------------------------------------------------------
@@ -45,6 +46,32 @@ void vtkPlusTransverseProcessEnhancer::PrintSelf(ostream& os, vtkIndent indent)
   this->Superclass::PrintSelf(os, indent);
 }
 
+//----------------------------------------------------------------------------
+// Removes the outline pixels of a bone area from a single component unsigned char image.
+// In each row of the area, the first outline pixel is searched from the right side of the area, then that pixel
+// and the outline pixels preceding it are cleared.
+void vtkPlusTransverseProcessEnhancer::ClearBoneArea(vtkImageData* inputImage, const BoneArea& area)
+{
+  int dims[3] = { 0, 0, 0 };
+  inputImage->GetDimensions(dims);
+  unsigned char* imagePixels = static_cast<unsigned char*>(inputImage->GetScalarPointer());
+
+  for (int y = area.YMax; y >= area.YMin; --y)
+  {
+    unsigned char* imageRow = imagePixels + static_cast<vtkIdType>(y) * dims[0];
+    //search through the area where the pixels are known to be
+    for (int x = area.XMax - this->BonePushBackPx; x >= area.XMin - this->BonePushBackPx && x >= 0; --x)
+    {
+      if (imageRow[x] != 0)
+      {
+        //remove all pixels in the outline
+        std::fill(imageRow + std::max(0, x - (this->BoneOutlineDepthPx - 1)), imageRow + x + 1, 0);
+        break;
+      }
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 // Takes a vtkSmartPointer<vtkImageData> with clearly defined possible bone segments as an
 // argument and modifies it so the bone areas that are too close to the camera's edge are removed.
@@ -53,43 +80,38 @@ void vtkPlusTransverseProcessEnhancer::RemoveOffCameraBones(vtkSmartPointer<vtkI
   int dims[3] = { 0, 0, 0 };
   inputImage->GetDimensions(dims);
 
-  unsigned char* vOutput = 0;
-
   int distanceVerticalBuffer = 10;    // For a bone to be valid, it must be this distance from the transducer
   int distanceHorizontalBuffer = 20;  // For a bone to be valid, it must be this distance from the horizontal sides of the frame
   int boneMinSize = 10;               // Minimum bone size a bone must have to be valid
-  std::vector<std::map<std::string, int> > boneAreas = this->BoneAreasInfo;
 
   int boneHalfLen;
   bool clearArea;
-  bool foundBone;
-
-  this->BoneAreasInfo.clear();
 
-  for (int areaIndex = boneAreas.size() - 1; areaIndex >= 0; --areaIndex)
+  // Areas are processed starting from the last one and invalid areas are removed from the list in place
+  for (int areaIndex = static_cast<int>(this->BoneAreasInfo.size()) - 1; areaIndex >= 0; --areaIndex)
   {
-    std::map<std::string, int> currentArea = boneAreas.at(areaIndex);
+    const BoneArea& currentArea = this->BoneAreasInfo[areaIndex];
 
     clearArea = false;
-    boneHalfLen = ((currentArea["yMax"] - currentArea["yMin"]) + 1) / 2;
+    boneHalfLen = ((currentArea.YMax - currentArea.YMin) + 1) / 2;
 
     //check if the bone is to close too the scan's edge
-    if (currentArea["yMax"] + distanceVerticalBuffer >= dims[1] - 1 || currentArea["yMin"] - distanceVerticalBuffer <= 0)
+    if (currentArea.YMax + distanceVerticalBuffer >= dims[1] - 1 || currentArea.YMin - distanceVerticalBuffer <= 0)
     {
       clearArea = true;
     }
     //check if given the size, the bone is too close to the scan's edge
-    else if (boneHalfLen + currentArea["yMax"] >= dims[1] - 1 || (currentArea["yMin"] - 1) - boneHalfLen <= 0)
+    else if (boneHalfLen + currentArea.YMax >= dims[1] - 1 || (currentArea.YMin - 1) - boneHalfLen <= 0)
     {
       clearArea = true;
     }
     //check if the bone is too close/far from the transducer 
-    else if (currentArea["depth"] < distanceHorizontalBuffer || currentArea["depth"] > dims[0] - distanceHorizontalBuffer)
+    else if (currentArea.Depth < distanceHorizontalBuffer || currentArea.Depth > dims[0] - distanceHorizontalBuffer)
     {
       clearArea = true;
     }
     //check if the bone is to small
-    else if (currentArea["yMax"] - currentArea["yMin"] <= boneMinSize)
+    else if (currentArea.YMax - currentArea.YMin <= boneMinSize)
     {
       clearArea = true;
     }
@@ -97,33 +119,8 @@ void vtkPlusTransverseProcessEnhancer::RemoveOffCameraBones(vtkSmartPointer<vtkI
     //If it does not meet the criteria, remove the bones in this area
     if (clearArea == true)
     {
-      //search through the area where the pixels are known to be
-      for (int y = currentArea["yMax"]; y >= currentArea["yMin"]; --y)
-      {
-        int x = currentArea["xMax"] - this->BonePushBackPx;
-        foundBone = false;
-        while (x >= currentArea["xMin"] - this->BonePushBackPx && x >= 0 && foundBone == false)
-        {
-          vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(x, y, 0));
-          if (*vOutput != 0)
-          {
-            //remove all pixels in the outline
-            *vOutput = 0;
-            for (int removeBonex = std::max(0, x - (this->BoneOutlineDepthPx - 1)); removeBonex < x; ++removeBonex)
-            {
-              vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(removeBonex, y, 0));
-              *vOutput = 0;
-            }
-
-            foundBone = true;
-          }
-          x--;
-        }
-      }
-    }
-    else
-    {
-      this->BoneAreasInfo.push_back(currentArea);
+      this->ClearBoneArea(inputImage, currentArea);
+      this->BoneAreasInfo.erase(this->BoneAreasInfo.begin() + areaIndex);
     }
   }
 }
@@ -138,105 +135,72 @@ void vtkPlusTransverseProcessEnhancer::CompareShadowAreas(vtkSmartPointer<vtkIma
   int dims[3] = { 0, 0, 0 };
   inputImage->GetDimensions(dims);
 
-  float vInput = 0;
-  unsigned char* vOutput = 0;
+  if (originalImage->GetScalarType() != VTK_UNSIGNED_CHAR || originalImage->GetNumberOfScalarComponents() != 1)
+  {
+    LOG_ERROR("CompareShadowAreas requires a single component unsigned char original image");
+    return;
+  }
+  const unsigned char* originalPixels = static_cast<unsigned char*>(originalImage->GetScalarPointer());
 
   //Variables used for measuring the size and intensity sum for bone, above, and below areas
   int boneLen;
   int boneHalfLen;
   float boneArea;
-  float aboveSum;
-  float areaSum;
-  float belowSum;
+  // Pixel values are integers, so they are summed exactly
+  vtkTypeInt64 aboveSum;
+  vtkTypeInt64 areaSum;
+  vtkTypeInt64 belowSum;
 
   float aboveAvgShadow; //Shadow intensity of the above area
   float areaAvgShadow;  //Shadow intensity of the area
   float belowAvgShadow; //Shadow intensity of the below area
 
-  std::map<std::string, int> currentArea;
-  std::vector<std::map<std::string, int> > boneAreas = this->BoneAreasInfo;
-
-  bool foundBone;
-  this->BoneAreasInfo.clear();
-
-  for (int areaIndex = boneAreas.size() - 1; areaIndex >= 0; --areaIndex)
+  // Areas are processed in the order they were found by MarkShadowOutline and invalid areas are removed from the list in place
+  for (std::vector<BoneArea>::iterator currentArea = this->BoneAreasInfo.begin(); currentArea != this->BoneAreasInfo.end();)
   {
-    currentArea = boneAreas.at(areaIndex);
-
-    aboveSum = 0;
-    areaSum = 0;
-    belowSum = 0;
-
-    boneLen = (currentArea["yMax"] - currentArea["yMin"]) + 1;
+    boneLen = (currentArea->YMax - currentArea->YMin) + 1;
     boneHalfLen = boneLen / 2;
-    boneArea = boneLen * currentArea["depth"];
+    boneArea = boneLen * currentArea->Depth;
 
-    //gather sum of shadow areas from above the area
-    for (int y = currentArea["yMax"] + boneHalfLen; y > currentArea["yMax"]; --y)
-    {
-      for (int x = dims[0] - 1; x >= currentArea["depth"]; --x)
-      {
-        vInput = (originalImage->GetScalarComponentAsFloat(x, y, 0, 0));
-        aboveSum += vInput;
-      }
-    }
-    //gather sum of shadow areas from the area
-    for (int y = currentArea["yMax"]; y >= currentArea["yMin"]; --y)
-    {
-      for (int x = dims[0] - 1; x >= currentArea["depth"]; --x)
-      {
-        vInput = (originalImage->GetScalarComponentAsFloat(x, y, 0, 0));
-        areaSum += vInput;
-      }
-    }
-    //gather sum of shadow areas from below the area
-    for (int y = currentArea["yMin"] - boneHalfLen; y < currentArea["yMin"]; ++y)
-    {
-      for (int x = dims[0] - 1; x >= currentArea["depth"]; --x)
-      {
-        vInput = (originalImage->GetScalarComponentAsFloat(x, y, 0, 0));
-        belowSum += vInput;
-      }
-    }
+    //gather sum of shadow areas from above the area, from the area, and from below the area
+    aboveSum = this->SumShadowRows(originalPixels, dims, currentArea->YMax + 1, currentArea->YMax + boneHalfLen, currentArea->Depth);
+    areaSum = this->SumShadowRows(originalPixels, dims, currentArea->YMin, currentArea->YMax, currentArea->Depth);
+    belowSum = this->SumShadowRows(originalPixels, dims, currentArea->YMin - boneHalfLen, currentArea->YMin - 1, currentArea->Depth);
 
     //Calculate average shadow intensity
-    aboveAvgShadow = aboveSum / (boneArea / 2);
-    areaAvgShadow = areaSum / boneArea;
-    belowAvgShadow = belowSum / (boneArea / 2);
+    aboveAvgShadow = static_cast<float>(aboveSum) / (boneArea / 2);
+    areaAvgShadow = static_cast<float>(areaSum) / boneArea;
+    belowAvgShadow = static_cast<float>(belowSum) / (boneArea / 2);
 
     //If there is a higher amount of bones around it, remove the area
     if (aboveAvgShadow - areaAvgShadow <= areaAvgShadow / 2 || belowAvgShadow - areaAvgShadow <= areaAvgShadow / 2)
     {
-
-      for (int y = currentArea["yMax"]; y >= currentArea["yMin"]; --y)
-      {
-        //search through the area where the pixels are known to be
-        int x = currentArea["xMax"] - this->BonePushBackPx;
-        foundBone = false;
-        while (x >= currentArea["xMin"] - this->BonePushBackPx && x >= 0 && foundBone == false)
-        {
-          vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(x, y, 0));
-          if (*vOutput != 0)
-          {
-            //remove all pixels in the outline
-            *vOutput = 0;
-
-            for (int removeBonex = std::max(0, x - (this->BoneOutlineDepthPx - 1)); removeBonex < x; ++removeBonex)
-            {
-              vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(removeBonex, y, 0));
-              *vOutput = 0;
-            }
-            foundBone = true;
-          }
-          x--;
-        }
-      }
+      this->ClearBoneArea(inputImage, *currentArea);
+      currentArea = this->BoneAreasInfo.erase(currentArea);
     }
     else
     {
-      this->BoneAreasInfo.push_back(currentArea);
+      ++currentArea;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// Sum of the pixels of rows yMin..yMax (rows outside of the image are ignored), from x=depth to the far end of the rows
+vtkTypeInt64 vtkPlusTransverseProcessEnhancer::SumShadowRows(const unsigned char* imagePixels, const int dims[3], int yMin, int yMax, int depth)
+{
+  vtkTypeInt64 sum = 0;
+  for (int y = std::max(yMin, 0); y <= std::min(yMax, dims[1] - 1); ++y)
+  {
+    const unsigned char* imageRow = imagePixels + static_cast<vtkIdType>(y) * dims[0];
+    int rowSum = 0;
+    for (int x = std::max(depth, 0); x < dims[0]; ++x)
+    {
+      rowSum += imageRow[x];
     }
+    sum += rowSum;
   }
+  return sum;
 }
 
 //----------------------------------------------------------------------------
@@ -42,6 +42,12 @@ protected:
   vtkPlusTransverseProcessEnhancer();
   virtual ~vtkPlusTransverseProcessEnhancer();
 
+  /*! Remove the outline pixels of a bone area from the image */
+  void ClearBoneArea(vtkImageData* inputImage, const BoneArea& area);
+
+  /*! Get the sum of the pixel values in the given rows of a single component unsigned char image, from x=depth to the end of the rows */
+  vtkTypeInt64 SumShadowRows(const unsigned char* imagePixels, const int dims[3], int yMin, int yMax, int depth);
+
 private:
   vtkPlusTransverseProcessEnhancer(const vtkPlusTransverseProcessEnhancer&);  // Not implemented.
   void operator=(const vtkPlusTransverseProcessEnhancer&);  // Not implemented.
@@ -8,8 +8,52 @@ See License.txt for details.
 
 #include "vtkPlusUsScanConvert.h"
 
+#include "vtkImageData.h"
 #include "vtkObjectFactory.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+//----------------------------------------------------------------------------
+namespace
+{
+  // Interpolated values are rounded to the nearest integer for integer scalar types (instead of truncating them)
+  template<class T>
+  T vtkPlusUsScanConvertCastSampleValue(float value)
+  {
+    if (std::numeric_limits<T>::is_integer)
+    {
+      return static_cast<T>(floor(value + 0.5f));
+    }
+    return static_cast<T>(value);
+  }
+
+  //----------------------------------------------------------------------------
+  template<class T>
+  void vtkPlusUsScanConvertSampleScanLines(const T* imagePixels, int numberOfImageComponents, const vtkPlusUsScanConvert::ScanLineSampleTable& table,
+      T* linesImagePixels, int numberOfLinesImageComponents)
+  {
+    const int numberOfSamples = table.NumberOfScanLines * table.NumberOfSamplesPerScanLine;
+    const vtkIdType* pixelOffsets = &table.PixelOffsets[0];
+    const float* weights = &table.Weights[0];
+    for (int sampleIndex = 0; sampleIndex < numberOfSamples; ++sampleIndex)
+    {
+      float value = 0;
+      for (int i = 0; i < vtkPlusUsScanConvert::ScanLineSampleTable::NUMBER_OF_WEIGHTS; ++i)
+      {
+        if (weights[i] != 0)
+        {
+          value += weights[i] * imagePixels[pixelOffsets[i] * numberOfImageComponents];
+        }
+      }
+      linesImagePixels[sampleIndex * numberOfLinesImageComponents] = vtkPlusUsScanConvertCastSampleValue<T>(value);
+      pixelOffsets += vtkPlusUsScanConvert::ScanLineSampleTable::NUMBER_OF_WEIGHTS;
+      weights += vtkPlusUsScanConvert::ScanLineSampleTable::NUMBER_OF_WEIGHTS;
+    }
+  }
+}
+
 
 //----------------------------------------------------------------------------
 vtkPlusUsScanConvert::vtkPlusUsScanConvert()
@@ -137,3 +181,127 @@ FrameSizeType vtkPlusUsScanConvert::GetOutputImageSizePixel()
                             };
   return frameSize;
 }
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusUsScanConvert::ComputeScanLineSampleTable(const int sampledImageExtent[6], ScanLineSampleInterpolationType interpolation, ScanLineSampleTable& table)
+{
+  const int numberOfWeights = ScanLineSampleTable::NUMBER_OF_WEIGHTS;
+  table.NumberOfSamplesPerScanLine = this->InputImageExtent[1] - this->InputImageExtent[0] + 1;
+  table.NumberOfScanLines = this->InputImageExtent[3] - this->InputImageExtent[2] + 1;
+  if (table.NumberOfSamplesPerScanLine < 2 || table.NumberOfScanLines < 1)
+  {
+    LOG_ERROR("Cannot compute scanline sample table: input image extent is invalid ("
+              << this->InputImageExtent[0] << ", " << this->InputImageExtent[1] << ", " << this->InputImageExtent[2] << ", " << this->InputImageExtent[3] << ")");
+    return PLUS_FAIL;
+  }
+  std::copy(sampledImageExtent, sampledImageExtent + 6, table.ImageExtent);
+  const int imageSizeX = sampledImageExtent[1] - sampledImageExtent[0] + 1;
+
+  const int numberOfSamples = table.NumberOfScanLines * table.NumberOfSamplesPerScanLine;
+  table.PixelOffsets.assign(numberOfSamples * numberOfWeights, 0);
+  table.Weights.assign(numberOfSamples * numberOfWeights, 0.0f);
+
+  for (int scanLine = 0; scanLine < table.NumberOfScanLines; scanLine++)
+  {
+    double start[4] = {0};
+    double end[4] = {0};
+    if (this->GetScanLineEndPoints(scanLine, start, end) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    double directionVectorX = (end[0] - start[0]) / (table.NumberOfSamplesPerScanLine - 1);
+    double directionVectorY = (end[1] - start[1]) / (table.NumberOfSamplesPerScanLine - 1);
+    for (int pointIndex = 0; pointIndex < table.NumberOfSamplesPerScanLine; ++pointIndex)
+    {
+      const int tableIndex = (scanLine * table.NumberOfSamplesPerScanLine + pointIndex) * numberOfWeights;
+      vtkIdType* pixelOffsets = &table.PixelOffsets[tableIndex];
+      float* weights = &table.Weights[tableIndex];
+      double pointX = start[0] + directionVectorX * pointIndex;
+      double pointY = start[1] + directionVectorY * pointIndex;
+      switch (interpolation)
+      {
+        case SCAN_LINE_SAMPLE_INTERPOLATION_NEAREST:
+        {
+          int pixelCoordX = static_cast<int>(pointX);
+          int pixelCoordY = static_cast<int>(pointY);
+          if (pixelCoordX < sampledImageExtent[0] || pixelCoordX > sampledImageExtent[1] || pixelCoordY < sampledImageExtent[2] || pixelCoordY > sampledImageExtent[3])
+          {
+            continue; // outside of the specified extent
+          }
+          pixelOffsets[0] = (pixelCoordX - sampledImageExtent[0]) + (pixelCoordY - sampledImageExtent[2]) * imageSizeX;
+          weights[0] = 1.0f;
+          break;
+        }
+        case SCAN_LINE_SAMPLE_INTERPOLATION_LINEAR:
+        {
+          int pixelCoordX = static_cast<int>(floor(pointX));
+          int pixelCoordY = static_cast<int>(floor(pointY));
+          double fractionX = pointX - pixelCoordX;
+          double fractionY = pointY - pixelCoordY;
+          for (int i = 0; i < numberOfWeights; ++i)
+          {
+            int neighborX = pixelCoordX + (i & 1);
+            int neighborY = pixelCoordY + (i >> 1);
+            if (neighborX < sampledImageExtent[0] || neighborX > sampledImageExtent[1] || neighborY < sampledImageExtent[2] || neighborY > sampledImageExtent[3])
+            {
+              continue; // outside of the specified extent
+            }
+            pixelOffsets[i] = (neighborX - sampledImageExtent[0]) + (neighborY - sampledImageExtent[2]) * imageSizeX;
+            weights[i] = static_cast<float>(((i & 1) ? fractionX : 1.0 - fractionX) * ((i >> 1) ? fractionY : 1.0 - fractionY));
+          }
+          break;
+        }
+        default:
+          LOG_ERROR("Cannot compute scanline sample table: unknown interpolation type: " << interpolation);
+          return PLUS_FAIL;
+      }
+    }
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusUsScanConvert::SampleScanLines(vtkImageData* image, const ScanLineSampleTable& table, vtkImageData* linesImage)
+{
+  if (image == NULL || linesImage == NULL)
+  {
+    LOG_ERROR("vtkPlusUsScanConvert::SampleScanLines failed: invalid image");
+    return PLUS_FAIL;
+  }
+  int* imageExtent = image->GetExtent();
+  for (int i = 0; i < 4; i++)
+  {
+    if (imageExtent[i] != table.ImageExtent[i])
+    {
+      LOG_ERROR("vtkPlusUsScanConvert::SampleScanLines failed: image extent (" << imageExtent[0] << ", " << imageExtent[1] << ", " << imageExtent[2] << ", " << imageExtent[3]
+                << ") does not match the extent that the scanline sample table was computed for (" << table.ImageExtent[0] << ", " << table.ImageExtent[1]
+                << ", " << table.ImageExtent[2] << ", " << table.ImageExtent[3] << ")");
+      return PLUS_FAIL;
+    }
+  }
+  int linesImageDims[3] = {0, 0, 0};
+  linesImage->GetDimensions(linesImageDims);
+  if (linesImageDims[0] != table.NumberOfSamplesPerScanLine || linesImageDims[1] != table.NumberOfScanLines)
+  {
+    LOG_ERROR("vtkPlusUsScanConvert::SampleScanLines failed: lines image size (" << linesImageDims[0] << "x" << linesImageDims[1]
+              << ") does not match the number of samples (" << table.NumberOfSamplesPerScanLine << "x" << table.NumberOfScanLines << ")");
+    return PLUS_FAIL;
+  }
+  if (image->GetScalarType() != linesImage->GetScalarType())
+  {
+    LOG_ERROR("vtkPlusUsScanConvert::SampleScanLines failed: lines image scalar type (" << linesImage->GetScalarTypeAsString()
+              << ") does not match the image scalar type (" << image->GetScalarTypeAsString() << ")");
+    return PLUS_FAIL;
+  }
+
+  switch (image->GetScalarType())
+  {
+    vtkTemplateMacro(vtkPlusUsScanConvertSampleScanLines(static_cast<const VTK_TT*>(image->GetScalarPointer()), image->GetNumberOfScalarComponents(), table,
+                     static_cast<VTK_TT*>(linesImage->GetScalarPointer()), linesImage->GetNumberOfScalarComponents()));
+    default:
+      LOG_ERROR("vtkPlusUsScanConvert::SampleScanLines failed: unsupported scalar type: " << image->GetScalarTypeAsString());
+      return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
@@ -10,6 +10,8 @@ See License.txt for details.
 #include "vtkPlusImageProcessingExport.h"
 #include "vtkThreadedImageAlgorithm.h"
 
+#include <vector>
+
 /*!
 \class vtkPlusUsScanConvert
 \brief This is a base class for defining a common scan conversion algorithm interface for all kinds of probes
@@ -66,6 +68,46 @@ public:
   /*! Get the distance between two sample points in the scanline, in mm. Setting of the input image or at least the input image extent is required before calling this method. */
   virtual double GetDistanceBetweenScanlineSamplePointsMm() = 0;
 
+  enum ScanLineSampleInterpolationType
+  {
+    /*! Value of the pixel that contains the sample point (sample coordinates are truncated) */
+    SCAN_LINE_SAMPLE_INTERPOLATION_NEAREST,
+    /*! Bilinear interpolation of the four pixels around the sample point */
+    SCAN_LINE_SAMPLE_INTERPOLATION_LINEAR
+  };
+
+  /*!
+    Lookup table for sampling the scanlines in an image that has the geometry of the scan converted (output) image.
+    Sample points of a scanline are evenly distributed between the scanline end points, the number of samples is the scanline length of the input image.
+    For each sample (index: scanLineIndex * NumberOfSamplesPerScanLine + sampleIndex) NUMBER_OF_WEIGHTS pixel offsets
+    (in the scalar array of the sampled image, in number of pixels) and interpolation weights are stored.
+    Pixels outside of the sampled image have zero weight.
+    Computing the table once and using it for all frames avoids computing the scanline geometry for each frame.
+  */
+  struct ScanLineSampleTable
+  {
+    static const int NUMBER_OF_WEIGHTS = 4;
+    int NumberOfScanLines;
+    int NumberOfSamplesPerScanLine;
+    /*! Extent of the sampled image */
+    int ImageExtent[6];
+    std::vector<vtkIdType> PixelOffsets;
+    std::vector<float> Weights;
+  };
+
+  /*!
+    Compute the lookup table for sampling the scanlines in an image of the specified extent.
+    Setting of the input image or at least the input image extent is required before calling this method.
+  */
+  PlusStatus ComputeScanLineSampleTable(const int sampledImageExtent[6], ScanLineSampleInterpolationType interpolation, ScanLineSampleTable& table);
+
+  /*!
+    Sample the scanlines of the image using a lookup table.
+    The lines image must be allocated with the same scalar type as the image and it must have a pixel for each sample point (scanlines in rows).
+    Only the first scalar component is sampled. The method does not modify the table, so it can be called from multiple threads.
+  */
+  static PlusStatus SampleScanLines(vtkImageData* image, const ScanLineSampleTable& table, vtkImageData* linesImage);
+
 protected:
   vtkPlusUsScanConvert();
   virtual ~vtkPlusUsScanConvert();
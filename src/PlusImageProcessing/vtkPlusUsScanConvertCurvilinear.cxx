@@ -493,7 +493,7 @@ PlusStatus vtkPlusUsScanConvertCurvilinear::GetScanLineEndPoints( int scanLineIn
   scanlineEndPoint_OutputImage[2] = 0;
   scanlineEndPoint_OutputImage[3] = 1;
 
-  return PLUS_FAIL;
+  return PLUS_SUCCESS;
 }
 
 //-----------------------------------------------------------------------------
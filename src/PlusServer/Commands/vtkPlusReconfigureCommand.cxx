@@ -0,0 +1,177 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommandProcessor.h"
+#include "vtkPlusCommandResponse.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusOpenIGTLinkServer.h"
+#include "vtkPlusReconfigureCommand.h"
+
+vtkStandardNewMacro(vtkPlusReconfigureCommand);
+
+namespace
+{
+  static const std::string RECONFIGURE_CMD = "Reconfigure";
+
+  //----------------------------------------------------------------------------
+  std::string JoinDeviceIds(const std::vector<std::string>& deviceIds)
+  {
+    std::string joined;
+    for (std::vector<std::string>::const_iterator it = deviceIds.begin(); it != deviceIds.end(); ++it)
+    {
+      joined += (it == deviceIds.begin() ? "" : ", ") + *it;
+    }
+    return joined.empty() ? "none" : joined;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkPlusReconfigureCommand::vtkPlusReconfigureCommand()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusReconfigureCommand::~vtkPlusReconfigureCommand()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusReconfigureCommand::SetNameToReconfigure()
+{
+  this->SetName(RECONFIGURE_CMD);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusReconfigureCommand::GetCommandNames(std::list<std::string>& cmdNames)
+{
+  cmdNames.clear();
+  cmdNames.push_back(RECONFIGURE_CMD);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusReconfigureCommand::GetDescription(const std::string& commandName)
+{
+  std::string desc;
+  if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, RECONFIGURE_CMD))
+  {
+    desc += RECONFIGURE_CMD;
+    desc += ": Apply a modified device set configuration file without reconnecting all devices. Attributes: Filename: configuration file to apply (optional, default: the configuration file of the server).";
+  }
+  return desc;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusReconfigureCommand::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Filename: " << this->Filename;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusReconfigureCommand::ReadConfiguration(vtkXMLDataElement* aConfig)
+{
+  if (vtkPlusCommand::ReadConfiguration(aConfig) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  this->SetFilename(aConfig->GetAttribute("Filename") ? aConfig->GetAttribute("Filename") : "");
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusReconfigureCommand::WriteConfiguration(vtkXMLDataElement* aConfig)
+{
+  if (vtkPlusCommand::WriteConfiguration(aConfig) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(Filename, aConfig);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+vtkXMLDataElement* vtkPlusReconfigureCommand::FindServerElement(vtkXMLDataElement* configRootElement)
+{
+  vtkPlusOpenIGTLinkServer* server = this->CommandProcessor->GetPlusServer();
+  for (int i = 0; i < configRootElement->GetNumberOfNestedElements(); ++i)
+  {
+    vtkXMLDataElement* serverElement = configRootElement->GetNestedElement(i);
+    int listeningPort = -1;
+    if (STRCASECMP(serverElement->GetName(), "PlusOpenIGTLinkServer") == 0
+        && serverElement->GetScalarAttribute("ListeningPort", listeningPort)
+        && listeningPort == server->GetListeningPort())
+    {
+      return serverElement;
+    }
+  }
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusReconfigureCommand::Execute()
+{
+  LOG_INFO("vtkPlusReconfigureCommand::Execute");
+
+  vtkPlusOpenIGTLinkServer* server = this->CommandProcessor->GetPlusServer();
+  if (this->GetFilename().empty() && server != NULL)
+  {
+    this->SetFilename(server->GetConfigFilename());
+  }
+
+  std::string baseMessageString = std::string("Reconfigure (") + (!this->Filename.empty() ? this->Filename : "undefined") + ")";
+
+  if (this->GetDataCollector() == NULL || server == NULL)
+  {
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", baseMessageString + " Can't access data collector.");
+    return PLUS_FAIL;
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkPlusConfig::GetInstance()->CreateDeviceSetConfigurationFromFile(this->Filename));
+  if (configRootElement == NULL)
+  {
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", baseMessageString + " Unable to read configuration file.");
+    return PLUS_FAIL;
+  }
+
+  vtkXMLDataElement* serverElement = this->FindServerElement(configRootElement);
+  if (serverElement == NULL)
+  {
+    std::ostringstream ss;
+    ss << baseMessageString << " No PlusOpenIGTLinkServer element with ListeningPort=" << server->GetListeningPort() << " in the configuration.";
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", ss.str());
+    return PLUS_FAIL;
+  }
+
+  // The devices cannot be rolled back once changed, so the server element is checked first
+  if (server->ValidateConfiguration(serverElement) != PLUS_SUCCESS)
+  {
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", baseMessageString + " Invalid server configuration. No devices are changed.");
+    return PLUS_FAIL;
+  }
+
+  std::vector<std::string> updatedDeviceIds;
+  std::vector<std::string> restartedDeviceIds;
+  PlusStatus devicesStatus = this->GetDataCollector()->ApplyConfiguration(configRootElement, updatedDeviceIds, restartedDeviceIds);
+  std::string devicesMessage = " Updated devices: " + JoinDeviceIds(updatedDeviceIds) + ". Restarted devices: " + JoinDeviceIds(restartedDeviceIds) + ".";
+  if (devicesStatus != PLUS_SUCCESS)
+  {
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", baseMessageString + " Unable to apply device configuration." + devicesMessage);
+    return PLUS_FAIL;
+  }
+
+  if (server->ApplyConfiguration(serverElement) != PLUS_SUCCESS)
+  {
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", baseMessageString + " Unable to apply server configuration." + devicesMessage);
+    return PLUS_FAIL;
+  }
+
+  // Commands that save the configuration continue from the applied one
+  vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+  this->QueueCommandResponse(PLUS_SUCCESS, baseMessageString + " Completed successfully." + devicesMessage);
+  return PLUS_SUCCESS;
+}
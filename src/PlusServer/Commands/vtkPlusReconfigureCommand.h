@@ -0,0 +1,70 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusReconfigureCommand_h
+#define __vtkPlusReconfigureCommand_h
+
+#include "vtkPlusServerExport.h"
+
+#include "vtkPlusCommand.h"
+
+/*!
+  \class vtkPlusReconfigureCommand
+  \brief This command applies a modified device set configuration file to the running devices and server
+
+  Only the devices with changed configuration are affected: changes that the device can apply while it is connected
+  (see vtkPlusDevice::CanApplyConfigurationChanges) are applied in place, other changes restart the device.
+  The server element with the same listening port as this server is applied to this server.
+  Adding or removing devices, or changing the listening port or output channel of the server requires a full restart.
+
+  \ingroup PlusLibPlusServer
+ */
+class vtkPlusServerExport vtkPlusReconfigureCommand : public vtkPlusCommand
+{
+public:
+
+  static vtkPlusReconfigureCommand* New();
+  vtkTypeMacro(vtkPlusReconfigureCommand, vtkPlusCommand);
+  virtual void PrintSelf(ostream& os, vtkIndent indent);
+  virtual vtkPlusCommand* Clone() { return New(); }
+
+  /*! Executes the command  */
+  virtual PlusStatus Execute();
+
+  /*! Read command parameters from XML */
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement* aConfig);
+
+  /*! Write command parameters to XML */
+  virtual PlusStatus WriteConfiguration(vtkXMLDataElement* aConfig);
+
+  /*! Get all the command names that this class can execute */
+  virtual void GetCommandNames(std::list<std::string>& cmdNames);
+
+  /*! Gets the description for the specified command name. */
+  virtual std::string GetDescription(const std::string& commandName);
+
+  /*! Device set configuration file to apply. If empty then the configuration file of the server is read again. */
+  vtkGetStdStringMacro(Filename);
+  vtkSetStdStringMacro(Filename);
+
+  void SetNameToReconfigure();
+
+protected:
+  vtkPlusReconfigureCommand();
+  virtual ~vtkPlusReconfigureCommand();
+
+  /*! Find the server element of the configuration that belongs to this server */
+  vtkXMLDataElement* FindServerElement(vtkXMLDataElement* configRootElement);
+
+private:
+  std::string Filename;
+
+  vtkPlusReconfigureCommand(const vtkPlusReconfigureCommand&);
+  void operator=(const vtkPlusReconfigureCommand&);
+};
+
+
+#endif
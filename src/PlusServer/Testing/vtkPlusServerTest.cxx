@@ -10,13 +10,19 @@ See License.txt for details.
 #include "vtkPlusDataSource.h"
 #include "vtkPlusOpenIGTLinkServer.h"
 #include "vtkPlusDataCollector.h"
+#include "vtkPlusMetricsServer.h"
+#include "vtkPlusOpenIGTLinkClient.h"
 #include "vtkPlusOpenIGTLinkVideoSource.h"
+#include "vtkPlusReconfigureCommand.h"
 #include "vtkIGSIOTransformRepository.h"
 
 // VTK includes
 #include <vtkSmartPointer.h>
 #include <vtksys/CommandLineArguments.hxx>
 
+// STL includes
+#include <algorithm>
+
 // -------------------------------------------------
 PlusStatus ConnectClients(int listeningPort, std::vector< vtkSmartPointer<vtkPlusOpenIGTLinkVideoSource> >& testClientList, int numberOfClientsToConnect, vtkSmartPointer<vtkXMLDataElement> configRootElement)
 {
@@ -192,6 +198,206 @@ vtkSmartPointer<vtkPlusOpenIGTLinkServer> StartServer(const std::string& inputCo
   return nullptr;
 }
 
+//-----------------------------------------------------------------------------
+// Send an HTTP GET request to the metrics server and return the full response
+PlusStatus GetHttpResponse(int port, const std::string& path, std::string& response)
+{
+  igtl::ClientSocket::Pointer socket = igtl::ClientSocket::New();
+  if (socket->ConnectToServer("127.0.0.1", port) != 0)
+  {
+    LOG_ERROR("Unable to connect to metrics server on port " << port);
+    return PLUS_FAIL;
+  }
+  socket->SetReceiveTimeout(2000);
+  std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  if (socket->Send(request.c_str(), request.size()) == 0)
+  {
+    LOG_ERROR("Unable to send request to metrics server");
+    socket->CloseSocket();
+    return PLUS_FAIL;
+  }
+  // The server closes the connection after the response
+  response.clear();
+  char buffer[1024];
+  igtlUint64 receivedBytes = 0;
+  while ((receivedBytes = socket->Receive(buffer, sizeof(buffer))) > 0)
+  {
+    response.append(buffer, receivedBytes);
+  }
+  socket->CloseSocket();
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Check that the metrics endpoint reports the statistics of the connected clients
+int TestMetricsServer(vtkPlusOpenIGTLinkServer* server, int metricsPort)
+{
+  int numberOfFailures = 0;
+  vtkSmartPointer<vtkPlusMetricsServer> metricsServer = vtkSmartPointer<vtkPlusMetricsServer>::New();
+  metricsServer->SetListeningPort(metricsPort);
+  metricsServer->SetDataCollector(server->GetDataCollector());
+  metricsServer->AddOpenIGTLinkServer(server);
+  if (metricsServer->Start() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to start metrics server");
+    return 1;
+  }
+
+  std::string response;
+  if (GetHttpResponse(metricsPort, "/metrics", response) != PLUS_SUCCESS)
+  {
+    numberOfFailures++;
+  }
+  else
+  {
+    const char* expectedStrings[] = { "HTTP/1.1 200 OK", "plus_device_internal_updates_total{device=", "plus_buffer_items{device=",
+                                      "plus_client_sent_messages_total{port=", "plus_commands_executed_total{port=", "process_resident_memory_bytes"
+                                    };
+    for (unsigned int i = 0; i < sizeof(expectedStrings) / sizeof(expectedStrings[0]); ++i)
+    {
+      if (response.find(expectedStrings[i]) == std::string::npos)
+      {
+        LOG_ERROR("Metrics response does not contain " << expectedStrings[i] << ". Response:\n" << response);
+        numberOfFailures++;
+      }
+    }
+    if (response.find("plus_client_sent_bytes_total{port=\"" + igsioCommon::ToString<int>(server->GetListeningPort()) + "\",client=") == std::string::npos)
+    {
+      LOG_ERROR("Metrics response does not contain sent bytes of the connected clients. Response:\n" << response);
+      numberOfFailures++;
+    }
+  }
+
+  if (GetHttpResponse(metricsPort, "/unknown", response) != PLUS_SUCCESS || response.find("HTTP/1.1 404") != 0)
+  {
+    LOG_ERROR("Metrics server did not report missing resource. Response:\n" << response);
+    numberOfFailures++;
+  }
+
+  metricsServer->Stop();
+  return numberOfFailures;
+}
+
+//-----------------------------------------------------------------------------
+// Find a device that is created from the configuration and whose output channels are not used by other devices
+vtkXMLDataElement* FindIndependentDeviceElement(vtkPlusDataCollector* dataCollector, vtkXMLDataElement* dataCollectionElement, vtkPlusDevice*& device)
+{
+  DeviceCollection devices;
+  dataCollector->GetDevices(devices);
+  for (DeviceCollectionIterator it = devices.begin(); it != devices.end(); ++it)
+  {
+    bool hasDependentDevices = false;
+    for (DeviceCollectionIterator otherIt = devices.begin(); otherIt != devices.end(); ++otherIt)
+    {
+      std::vector<vtkPlusDevice*> inputDevices;
+      (*otherIt)->GetInputDevices(inputDevices);
+      hasDependentDevices = hasDependentDevices || std::find(inputDevices.begin(), inputDevices.end(), *it) != inputDevices.end();
+    }
+    vtkXMLDataElement* deviceElement = dataCollectionElement->FindNestedElementWithNameAndAttribute("Device", "Id", (*it)->GetDeviceId().c_str());
+    if (!hasDependentDevices && deviceElement != NULL)
+    {
+      device = *it;
+      return deviceElement;
+    }
+  }
+  return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Send a Reconfigure command with a modified configuration file and check that the changes are applied to the running device and server
+int TestReconfigure(vtkPlusOpenIGTLinkServer* server)
+{
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  configRootElement->DeepCopy(vtkPlusConfig::GetInstance()->GetDeviceSetConfigurationData());
+  vtkXMLDataElement* dataCollectionElement = configRootElement->FindNestedElementWithName("DataCollection");
+  vtkXMLDataElement* serverElement = configRootElement->FindNestedElementWithNameAndAttribute("PlusOpenIGTLinkServer", "ListeningPort", igsioCommon::ToString<int>(server->GetListeningPort()).c_str());
+  vtkPlusDevice* device = NULL;
+  vtkXMLDataElement* deviceElement = (dataCollectionElement != NULL ? FindIndependentDeviceElement(server->GetDataCollector(), dataCollectionElement, device) : NULL);
+  if (serverElement == NULL || deviceElement == NULL)
+  {
+    LOG_ERROR("Unable to find a server and a device element to modify in the configuration");
+    return 1;
+  }
+
+  // LocalTimeOffsetSec can be changed while any device is connected, the device is not restarted
+  const double localTimeOffsetSec = device->GetLocalTimeOffsetSec() + 0.025;
+  const double keepAliveIntervalSec = server->GetKeepAliveIntervalSec() + 0.5;
+  deviceElement->SetDoubleAttribute("LocalTimeOffsetSec", localTimeOffsetSec);
+  serverElement->SetDoubleAttribute("KeepAliveIntervalSec", keepAliveIntervalSec);
+  const std::string configFileName = vtkPlusConfig::GetInstance()->GetOutputPath("PlusServerReconfigureTest.xml");
+  if (igsioCommon::XML::PrintXML(configFileName, configRootElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to write modified configuration file " << configFileName);
+    return 1;
+  }
+
+  vtkSmartPointer<vtkPlusOpenIGTLinkClient> client = vtkSmartPointer<vtkPlusOpenIGTLinkClient>::New();
+  client->SetServerHost("127.0.0.1");
+  client->SetServerPort(server->GetListeningPort());
+  if (client->Connect(5.0) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to connect command client to server");
+    return 1;
+  }
+  vtkSmartPointer<vtkPlusReconfigureCommand> command = vtkSmartPointer<vtkPlusReconfigureCommand>::New();
+  command->SetNameToReconfigure();
+  command->SetId(1);
+  command->SetFilename(configFileName);
+  if (client->SendCommand(command) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to send Reconfigure command");
+    client->Disconnect();
+    return 1;
+  }
+
+  // Commands are executed in this thread, so process them while waiting for the reply
+  PlusStatus replyStatus = PLUS_FAIL;
+  PlusStatus result = PLUS_FAIL;
+  int32_t commandId = 0;
+  std::string errorString;
+  std::string content;
+  std::string commandName;
+  igtl::MessageBase::MetaDataMap parameters;
+  const double replyTimeoutSec = 10.0;
+  const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  while (replyStatus != PLUS_SUCCESS && vtkIGSIOAccurateTimer::GetSystemTime() < startTime + replyTimeoutSec)
+  {
+    server->ProcessPendingCommands();
+    replyStatus = client->ReceiveReply(result, commandId, errorString, content, parameters, commandName, 0.010);
+  }
+  client->Disconnect();
+
+  int numberOfFailures = 0;
+  if (replyStatus != PLUS_SUCCESS || result != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Reconfigure command failed: " << errorString << " " << content);
+    return 1;
+  }
+  LOG_INFO("Reconfigure reply: " << content);
+  if (content.find("Updated devices: " + device->GetDeviceId()) == std::string::npos || content.find("Restarted devices: none") == std::string::npos)
+  {
+    LOG_ERROR("Device " << device->GetDeviceId() << " is not reported as updated without restart: " << content);
+    numberOfFailures++;
+  }
+  vtkPlusDevice* updatedDevice = NULL;
+  if (server->GetDataCollector()->GetDevice(updatedDevice, device->GetDeviceId()) != PLUS_SUCCESS || updatedDevice != device)
+  {
+    LOG_ERROR("Device " << device->GetDeviceId() << " is replaced, although only its local time offset is changed");
+    numberOfFailures++;
+  }
+  else if (fabs(device->GetLocalTimeOffsetSec() - localTimeOffsetSec) > 1e-6)
+  {
+    LOG_ERROR("Local time offset of device " << device->GetDeviceId() << " is " << device->GetLocalTimeOffsetSec() << " instead of " << localTimeOffsetSec);
+    numberOfFailures++;
+  }
+  if (fabs(server->GetKeepAliveIntervalSec() - keepAliveIntervalSec) > 1e-6)
+  {
+    LOG_ERROR("Keep alive interval of the server is " << server->GetKeepAliveIntervalSec() << " instead of " << keepAliveIntervalSec);
+    numberOfFailures++;
+  }
+  return numberOfFailures;
+}
+
 //-----------------------------------------------------------------------------
 int main(int argc, char** argv)
 {
@@ -200,6 +406,8 @@ int main(int argc, char** argv)
   std::string inputConfigFileName;
   std::string testingConfigFileName;
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+  int metricsPort = 0;
+  bool testReconfigure(false);
 
   const double WAIT_TIME_SEC = 5.0;
   const int NUM_TEST_CLIENTS = 5; // only if testing is enabled S
@@ -211,6 +419,8 @@ int main(int argc, char** argv)
   args.AddArgument("--server-config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Name of the server configuration file.");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
   args.AddArgument("--testing-config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &testingConfigFileName, "Name of the testing configuration file");
+  args.AddArgument("--metrics-port", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &metricsPort, "Port of the metrics server. The metrics server is tested only if a port is specified.");
+  args.AddArgument("--test-reconfigure", vtksys::CommandLineArguments::NO_ARGUMENT, &testReconfigure, "Apply a modified configuration file by a Reconfigure command while the clients are connected.");
 
   if (!args.Parse())
   {
@@ -279,6 +489,20 @@ int main(int argc, char** argv)
 
   LOG_INFO("Requested testing time elapsed");
 
+  if (metricsPort > 0 && TestMetricsServer(server, metricsPort) > 0)
+  {
+    LOG_ERROR("Metrics server test failed");
+    DisconnectClients(outTestClients);
+    exit(EXIT_FAILURE);
+  }
+
+  if (testReconfigure && TestReconfigure(server) > 0)
+  {
+    LOG_ERROR("Reconfigure test failed");
+    DisconnectClients(outTestClients);
+    exit(EXIT_FAILURE);
+  }
+
   // Make sure all the clients are still connected
   unsigned int numOfActuallyConnectedClients = server->GetNumberOfConnectedClients();
   if (numOfActuallyConnectedClients != outTestClients.size())
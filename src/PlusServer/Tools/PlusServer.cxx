@@ -19,6 +19,7 @@ happens between two threads. In real life, it happens between two programs.
 #include "vtkPlusBuffer.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
+#include "vtkPlusMetricsServer.h"
 #include "vtkPlusOpenIGTLinkServer.h"
 #include "vtkSmartPointer.h"
 #include "vtkIGSIOTransformRepository.h"
@@ -45,6 +46,8 @@ int main(int argc, char** argv)
   std::string testingConfigFileName;
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
   double runTimeSec = 0.0;
+  bool asynchronousLogging(false);
+  int metricsPort = 0;
 
   const int numOfTestClientsToConnect = 5; // only if testing is enabled S
 
@@ -55,6 +58,8 @@ int main(int argc, char** argv)
   args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Name of the input configuration file.");
   args.AddArgument("--running-time", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &runTimeSec, "Server running time period in seconds. If the parameter is not defined or 0 then the server runs infinitely.");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+  args.AddArgument("--async-log", vtksys::CommandLineArguments::NO_ARGUMENT, &asynchronousLogging, "Write debug and trace messages from a background thread, so that logging does not slow down data acquisition.");
+  args.AddArgument("--metrics-port", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &metricsPort, "Port of the HTTP endpoint that provides performance metrics in Prometheus text format at /metrics. If the parameter is not defined or 0 then metrics are not served.");
 
   if (!args.Parse())
   {
@@ -70,6 +75,10 @@ int main(int argc, char** argv)
   }
 
   vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+  if (asynchronousLogging)
+  {
+    vtkPlusLogger::SetAsynchronousLogging(true);
+  }
 
   if (inputConfigFileName.empty())
   {
@@ -142,6 +151,23 @@ int main(int argc, char** argv)
     exit(EXIT_FAILURE);
   }
 
+  vtkSmartPointer<vtkPlusMetricsServer> metricsServer;
+  if (metricsPort > 0)
+  {
+    metricsServer = vtkSmartPointer<vtkPlusMetricsServer>::New();
+    metricsServer->SetListeningPort(metricsPort);
+    metricsServer->SetDataCollector(dataCollector.GetPointer());
+    for (std::vector<vtkPlusOpenIGTLinkServer*>::iterator it = serverList.begin(); it != serverList.end(); ++it)
+    {
+      metricsServer->AddOpenIGTLinkServer(*it);
+    }
+    if (metricsServer->Start() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to start metrics server");
+      exit(EXIT_FAILURE);
+    }
+  }
+
   double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
 
   LOG_INFO("Server status: Server(s) are running.");
@@ -172,11 +198,19 @@ int main(int argc, char** argv)
     vtkIGSIOAccurateTimer::DelayWithEventProcessing(commandQueuePollIntervalSec);
   }
 
+  if (metricsServer != NULL)
+  {
+    metricsServer->Stop();
+  }
+
   for (std::vector<vtkPlusOpenIGTLinkServer*>::iterator it = serverList.begin(); it != serverList.end(); ++it)
   {
     (*it)->Stop();
   }
 
+  // Write all queued log messages before exiting
+  vtkPlusLogger::SetAsynchronousLogging(false);
+
   LOG_INFO("Shutdown successful.");
 
   return EXIT_SUCCESS;
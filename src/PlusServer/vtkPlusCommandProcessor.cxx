@@ -30,6 +30,7 @@ See License.txt for details.
 #include "vtkPlusGetPolydataCommand.h"
 #include "vtkPlusGetTransformCommand.h"
 #include "vtkPlusGetUsParameterCommand.h"
+#include "vtkPlusReconfigureCommand.h"
 #include "vtkPlusRequestIdsCommand.h"
 #include "vtkPlusSaveConfigCommand.h"
 #include "vtkPlusSendTextCommand.h"
@@ -56,6 +57,9 @@ vtkPlusCommandProcessor::vtkPlusCommandProcessor()
   , Mutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
   , CommandExecutionActive(std::make_pair(false, false))
   , CommandExecutionThreadId(-1)
+  , NumberOfExecutedCommands(0)
+  , NumberOfFailedCommands(0)
+  , TotalCommandExecutionTimeUsec(0)
 {
   // Register default commands
   RegisterPlusCommand(vtkSmartPointer<vtkPlusGetImageCommand>::New());
@@ -71,6 +75,7 @@ vtkPlusCommandProcessor::vtkPlusCommandProcessor()
   RegisterPlusCommand(vtkSmartPointer<vtkPlusSetUsParameterCommand>::New());
   RegisterPlusCommand(vtkSmartPointer<vtkPlusGetUsParameterCommand>::New());
   RegisterPlusCommand(vtkSmartPointer<vtkPlusAddRecordingDeviceCommand>::New());
+  RegisterPlusCommand(vtkSmartPointer<vtkPlusReconfigureCommand>::New());
 #ifdef PLUS_USE_STEALTHLINK
   RegisterPlusCommand(vtkSmartPointer<vtkPlusStealthLinkCommand>::New());
 #endif
@@ -178,10 +183,14 @@ int vtkPlusCommandProcessor::ExecuteCommands()
     }
 
     LOG_DEBUG("Executing command");
+    double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
     if (cmd->Execute() != PLUS_SUCCESS)
     {
       LOG_ERROR("Command execution failed");
+      this->NumberOfFailedCommands++;
     }
+    this->TotalCommandExecutionTimeUsec += static_cast<unsigned long long>((vtkIGSIOAccurateTimer::GetSystemTime() - startTime) * 1e6);
+    this->NumberOfExecutedCommands++;
 
     // move the response objects from the command to the processor's queue
     {
@@ -196,6 +205,31 @@ int vtkPlusCommandProcessor::ExecuteCommands()
   return numberOfExecutedCommands;
 }
 
+//----------------------------------------------------------------------------
+int vtkPlusCommandProcessor::GetCommandQueueLength()
+{
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+  return static_cast<int>(this->CommandQueue.size());
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusCommandProcessor::GetNumberOfExecutedCommands() const
+{
+  return this->NumberOfExecutedCommands.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusCommandProcessor::GetNumberOfFailedCommands() const
+{
+  return this->NumberOfFailedCommands.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusCommandProcessor::GetTotalCommandExecutionTimeSec() const
+{
+  return this->TotalCommandExecutionTimeUsec.load(std::memory_order_relaxed) * 1e-6;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusCommandProcessor::RegisterPlusCommand(vtkPlusCommand* cmd)
 {
@@ -14,6 +14,7 @@
 #include "vtkPlusCommand.h"
 #include "vtkPlusCommandResponse.h"
 #include "vtkPlusOpenIGTLinkServer.h"
+#include <atomic>
 #include <string>
 
 class vtkImageData;
@@ -88,6 +89,18 @@ public:
   */
   virtual void PopCommandResponses(PlusCommandResponseList& responses);
 
+  /*! Number of commands waiting for execution. Can be called from any thread. */
+  int GetCommandQueueLength();
+
+  /*! Number of commands executed since the processor was created. Can be called from any thread. */
+  unsigned long long GetNumberOfExecutedCommands() const;
+
+  /*! Number of executed commands that failed. Can be called from any thread. */
+  unsigned long long GetNumberOfFailedCommands() const;
+
+  /*! Total time spent with command execution (in seconds). Can be called from any thread. */
+  double GetTotalCommandExecutionTimeSec() const;
+
   vtkGetObjectMacro(PlusServer, vtkPlusOpenIGTLinkServer);
   vtkSetObjectMacro(PlusServer, vtkPlusOpenIGTLinkServer);
 
@@ -129,6 +142,11 @@ private:
   PlusCommandList CommandQueue;
   PlusCommandResponseList CommandResponseQueue;
 
+  /*! Command execution statistics, updated without locking so that they can be monitored while commands are executed */
+  std::atomic<unsigned long long> NumberOfExecutedCommands;
+  std::atomic<unsigned long long> NumberOfFailedCommands;
+  std::atomic<unsigned long long> TotalCommandExecutionTimeUsec;
+
   vtkPlusCommandProcessor(const vtkPlusCommandProcessor&);  // Not implemented.
   void operator=(const vtkPlusCommandProcessor&);  // Not implemented.
 };
@@ -0,0 +1,417 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusCommandProcessor.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDevice.h"
+#include "vtkPlusMetricsServer.h"
+#include "vtkPlusOpenIGTLinkServer.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtksys/SystemInformation.hxx>
+
+// STL includes
+#include <sstream>
+
+namespace
+{
+  const int CONNECTION_WAIT_TIMEOUT_MSEC = 200;
+  const int CLIENT_SOCKET_TIMEOUT_MSEC = 1000;
+  const size_t MAX_REQUEST_HEADER_LENGTH = 8192;
+
+  //----------------------------------------------------------------------------
+  void WriteMetricHeader(std::ostream& os, const char* name, const char* type, const char* help)
+  {
+    os << "# HELP " << name << " " << help << "\n";
+    os << "# TYPE " << name << " " << type << "\n";
+  }
+
+  //----------------------------------------------------------------------------
+  struct MonitoredBuffer
+  {
+    std::string DeviceId;
+    std::string SourceId;
+    vtkPlusBuffer* Buffer;
+  };
+
+  //----------------------------------------------------------------------------
+  void AddMonitoredBuffers(vtkPlusDevice* device, DataSourceContainerConstIterator begin, DataSourceContainerConstIterator end, std::vector<MonitoredBuffer>& buffers)
+  {
+    for (DataSourceContainerConstIterator it = begin; it != end; ++it)
+    {
+      if (it->second == NULL || it->second->GetBuffer() == NULL)
+      {
+        continue;
+      }
+      MonitoredBuffer monitoredBuffer;
+      monitoredBuffer.DeviceId = device->GetDeviceId();
+      monitoredBuffer.SourceId = it->second->GetSourceId();
+      monitoredBuffer.Buffer = it->second->GetBuffer();
+      buffers.push_back(monitoredBuffer);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkPlusMetricsServer);
+
+//----------------------------------------------------------------------------
+vtkPlusMetricsServer::vtkPlusMetricsServer()
+  : ListeningPort(-1)
+  , ServerSocket(igtl::ServerSocket::New())
+  , Threader(vtkSmartPointer<vtkMultiThreader>::New())
+  , ServerStopRequested(false)
+  , ServerThreadId(-1)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusMetricsServer::~vtkPlusMetricsServer()
+{
+  this->Stop();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusMetricsServer::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "ListeningPort: " << this->ListeningPort << std::endl;
+  os << indent << "NumberOfOpenIGTLinkServers: " << this->OpenIGTLinkServers.size() << std::endl;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusMetricsServer::SetDataCollector(vtkPlusDataCollector* dataCollector)
+{
+  this->DataCollector = dataCollector;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusMetricsServer::AddOpenIGTLinkServer(vtkPlusOpenIGTLinkServer* server)
+{
+  if (server == NULL)
+  {
+    LOG_ERROR("vtkPlusMetricsServer::AddOpenIGTLinkServer failed: invalid server");
+    return;
+  }
+  this->OpenIGTLinkServers.push_back(server);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusMetricsServer::Start()
+{
+  if (this->ServerThreadId >= 0)
+  {
+    // already started
+    return PLUS_SUCCESS;
+  }
+  if (this->ListeningPort <= 0)
+  {
+    LOG_ERROR("Invalid metrics server listening port: " << this->ListeningPort);
+    return PLUS_FAIL;
+  }
+  if (this->ServerSocket->CreateServer(this->ListeningPort) < 0)
+  {
+    LOG_ERROR("Cannot create metrics server socket on port " << this->ListeningPort);
+    return PLUS_FAIL;
+  }
+
+  this->ServerStopRequested.store(false);
+  this->ServerThreadId = this->Threader->SpawnThread((vtkThreadFunctionType)&ServerThread, this);
+  LOG_INFO("Metrics are available at http://localhost:" << this->ListeningPort << "/metrics");
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusMetricsServer::Stop()
+{
+  if (this->ServerThreadId < 0)
+  {
+    // not started
+    return PLUS_SUCCESS;
+  }
+
+  this->ServerStopRequested.store(true);
+  // Wait until the thread stops
+  this->Threader->TerminateThread(this->ServerThreadId);
+  this->ServerThreadId = -1;
+  this->ServerSocket->CloseSocket();
+
+  LOG_DEBUG("Metrics server stopped");
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusMetricsServer::IsStarted() const
+{
+  return this->ServerThreadId >= 0;
+}
+
+//----------------------------------------------------------------------------
+void* vtkPlusMetricsServer::ServerThread(vtkMultiThreader::ThreadInfo* data)
+{
+  vtkPlusMetricsServer* self = (vtkPlusMetricsServer*)(data->UserData);
+
+  // Serve requests until a stop is requested
+  while (!self->ServerStopRequested.load())
+  {
+    igtl::ClientSocket::Pointer clientSocket = self->ServerSocket->WaitForConnection(CONNECTION_WAIT_TIMEOUT_MSEC);
+    if (clientSocket.IsNull())
+    {
+      continue;
+    }
+    self->ServeRequest(clientSocket);
+    clientSocket->CloseSocket();
+  }
+
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusMetricsServer::ServeRequest(igtl::ClientSocket* clientSocket)
+{
+  clientSocket->SetReceiveTimeout(CLIENT_SOCKET_TIMEOUT_MSEC);
+  clientSocket->SetSendTimeout(CLIENT_SOCKET_TIMEOUT_MSEC);
+
+  // Read the request header, the request body (if any) is ignored
+  std::string request;
+  while (request.size() < MAX_REQUEST_HEADER_LENGTH && request.find("\r\n\r\n") == std::string::npos)
+  {
+    char c = 0;
+    if (clientSocket->Receive(&c, 1) <= 0)
+    {
+      LOG_DEBUG("Metrics request was not received completely");
+      return;
+    }
+    request.push_back(c);
+  }
+
+  std::string status;
+  std::string contentType = "text/plain; charset=utf-8";
+  std::string body;
+  std::string requestLine = request.substr(0, request.find("\r\n"));
+  if (requestLine.compare(0, 13, "GET /metrics ") == 0 || requestLine.compare(0, 13, "GET /metrics?") == 0)
+  {
+    status = "200 OK";
+    contentType = "text/plain; version=0.0.4; charset=utf-8";
+    body = this->GetMetricsText();
+  }
+  else if (requestLine.compare(0, 4, "GET ") == 0)
+  {
+    status = "404 Not Found";
+    body = "Metrics are available at /metrics\n";
+  }
+  else
+  {
+    status = "405 Method Not Allowed";
+    body = "Only GET requests are supported\n";
+  }
+
+  std::ostringstream response;
+  response << "HTTP/1.1 " << status << "\r\n"
+           << "Content-Type: " << contentType << "\r\n"
+           << "Content-Length: " << body.size() << "\r\n"
+           << "Connection: close\r\n"
+           << "\r\n"
+           << body;
+  std::string responseStr = response.str();
+  if (clientSocket->Send(responseStr.c_str(), responseStr.size()) == 0)
+  {
+    LOG_DEBUG("Failed to send metrics response");
+  }
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusMetricsServer::GetMetricsText()
+{
+  std::ostringstream os;
+  os.precision(9);
+  this->AppendDeviceMetrics(os);
+  this->AppendServerMetrics(os);
+  this->AppendProcessMetrics(os);
+  return os.str();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusMetricsServer::AppendDeviceMetrics(std::ostream& os)
+{
+  if (this->DataCollector == NULL)
+  {
+    return;
+  }
+
+  // The devices must not be replaced by vtkPlusDataCollector::ApplyConfiguration while their metrics are written
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> devicesMutexGuardedLock(this->DataCollector->GetDevicesMutex());
+  std::vector<vtkPlusDevice*> devices;
+  std::vector<MonitoredBuffer> buffers;
+  for (DeviceCollectionConstIterator it = this->DataCollector->GetDeviceConstIteratorBegin(); it != this->DataCollector->GetDeviceConstIteratorEnd(); ++it)
+  {
+    vtkPlusDevice* device = *it;
+    devices.push_back(device);
+    AddMonitoredBuffers(device, device->GetVideoSourceIteratorBegin(), device->GetVideoSourceIteratorEnd(), buffers);
+    AddMonitoredBuffers(device, device->GetToolIteratorBegin(), device->GetToolIteratorEnd(), buffers);
+    AddMonitoredBuffers(device, device->GetFieldDataSourcessIteratorBegin(), device->GetFieldDataSourcessIteratorEnd(), buffers);
+  }
+
+  WriteMetricHeader(os, "plus_device_acquisition_rate_hz", "gauge", "Requested acquisition rate of the device.");
+  for (std::vector<vtkPlusDevice*>::iterator it = devices.begin(); it != devices.end(); ++it)
+  {
+    os << "plus_device_acquisition_rate_hz{device=\"" << EscapeLabelValue((*it)->GetDeviceId()) << "\"} " << (*it)->GetAcquisitionRate() << "\n";
+  }
+  WriteMetricHeader(os, "plus_device_internal_update_rate_hz", "gauge", "Measured rate of the internal update thread of the device.");
+  for (std::vector<vtkPlusDevice*>::iterator it = devices.begin(); it != devices.end(); ++it)
+  {
+    os << "plus_device_internal_update_rate_hz{device=\"" << EscapeLabelValue((*it)->GetDeviceId()) << "\"} " << (*it)->GetInternalUpdateRate() << "\n";
+  }
+  WriteMetricHeader(os, "plus_device_internal_updates_total", "counter", "Number of InternalUpdate calls.");
+  for (std::vector<vtkPlusDevice*>::iterator it = devices.begin(); it != devices.end(); ++it)
+  {
+    os << "plus_device_internal_updates_total{device=\"" << EscapeLabelValue((*it)->GetDeviceId()) << "\"} " << (*it)->GetNumberOfInternalUpdates() << "\n";
+  }
+  WriteMetricHeader(os, "plus_device_internal_update_duration_seconds_total", "counter", "Total time spent in InternalUpdate.");
+  for (std::vector<vtkPlusDevice*>::iterator it = devices.begin(); it != devices.end(); ++it)
+  {
+    os << "plus_device_internal_update_duration_seconds_total{device=\"" << EscapeLabelValue((*it)->GetDeviceId()) << "\"} " << (*it)->GetTotalInternalUpdateDurationSec() << "\n";
+  }
+  WriteMetricHeader(os, "plus_device_last_internal_update_duration_seconds", "gauge", "Duration of the most recent InternalUpdate call.");
+  for (std::vector<vtkPlusDevice*>::iterator it = devices.begin(); it != devices.end(); ++it)
+  {
+    os << "plus_device_last_internal_update_duration_seconds{device=\"" << EscapeLabelValue((*it)->GetDeviceId()) << "\"} " << (*it)->GetLastInternalUpdateDurationSec() << "\n";
+  }
+
+  WriteMetricHeader(os, "plus_buffer_items", "gauge", "Number of items in the buffer of the data source.");
+  for (std::vector<MonitoredBuffer>::iterator it = buffers.begin(); it != buffers.end(); ++it)
+  {
+    os << "plus_buffer_items{device=\"" << EscapeLabelValue(it->DeviceId) << "\",source=\"" << EscapeLabelValue(it->SourceId) << "\"} " << it->Buffer->GetNumberOfItems() << "\n";
+  }
+  WriteMetricHeader(os, "plus_buffer_capacity_items", "gauge", "Maximum number of items in the buffer of the data source.");
+  for (std::vector<MonitoredBuffer>::iterator it = buffers.begin(); it != buffers.end(); ++it)
+  {
+    os << "plus_buffer_capacity_items{device=\"" << EscapeLabelValue(it->DeviceId) << "\",source=\"" << EscapeLabelValue(it->SourceId) << "\"} " << it->Buffer->GetBufferSize() << "\n";
+  }
+  WriteMetricHeader(os, "plus_buffer_dropped_items_total", "counter", "Number of items that were not added to the buffer because of invalid or duplicate timestamps.");
+  for (std::vector<MonitoredBuffer>::iterator it = buffers.begin(); it != buffers.end(); ++it)
+  {
+    os << "plus_buffer_dropped_items_total{device=\"" << EscapeLabelValue(it->DeviceId) << "\",source=\"" << EscapeLabelValue(it->SourceId) << "\"} " << it->Buffer->GetNumberOfDroppedItems() << "\n";
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusMetricsServer::AppendServerMetrics(std::ostream& os)
+{
+  if (this->OpenIGTLinkServers.empty())
+  {
+    return;
+  }
+
+  std::vector<std::vector<vtkPlusOpenIGTLinkServer::ClientStatistics> > clientStatistics(this->OpenIGTLinkServers.size());
+  for (unsigned int i = 0; i < this->OpenIGTLinkServers.size(); ++i)
+  {
+    this->OpenIGTLinkServers[i]->GetClientStatistics(clientStatistics[i]);
+  }
+
+  WriteMetricHeader(os, "plus_server_connected_clients", "gauge", "Number of clients connected to the OpenIGTLink server.");
+  for (unsigned int i = 0; i < this->OpenIGTLinkServers.size(); ++i)
+  {
+    os << "plus_server_connected_clients{port=\"" << this->OpenIGTLinkServers[i]->GetListeningPort() << "\"} " << clientStatistics[i].size() << "\n";
+  }
+  WriteMetricHeader(os, "plus_client_sent_messages_total", "counter", "Number of OpenIGTLink messages sent to the client.");
+  for (unsigned int i = 0; i < this->OpenIGTLinkServers.size(); ++i)
+  {
+    for (std::vector<vtkPlusOpenIGTLinkServer::ClientStatistics>::iterator it = clientStatistics[i].begin(); it != clientStatistics[i].end(); ++it)
+    {
+      os << "plus_client_sent_messages_total{port=\"" << this->OpenIGTLinkServers[i]->GetListeningPort() << "\",client=\"" << it->ClientId << "\"} " << it->NumberOfSentMessages << "\n";
+    }
+  }
+  WriteMetricHeader(os, "plus_client_sent_bytes_total", "counter", "Number of bytes sent to the client.");
+  for (unsigned int i = 0; i < this->OpenIGTLinkServers.size(); ++i)
+  {
+    for (std::vector<vtkPlusOpenIGTLinkServer::ClientStatistics>::iterator it = clientStatistics[i].begin(); it != clientStatistics[i].end(); ++it)
+    {
+      os << "plus_client_sent_bytes_total{port=\"" << this->OpenIGTLinkServers[i]->GetListeningPort() << "\",client=\"" << it->ClientId << "\"} " << it->NumberOfSentBytes << "\n";
+    }
+  }
+  WriteMetricHeader(os, "plus_client_send_duration_seconds_total", "counter", "Total time spent with sending messages to the client.");
+  for (unsigned int i = 0; i < this->OpenIGTLinkServers.size(); ++i)
+  {
+    for (std::vector<vtkPlusOpenIGTLinkServer::ClientStatistics>::iterator it = clientStatistics[i].begin(); it != clientStatistics[i].end(); ++it)
+    {
+      os << "plus_client_send_duration_seconds_total{port=\"" << this->OpenIGTLinkServers[i]->GetListeningPort() << "\",client=\"" << it->ClientId << "\"} " << it->TotalSendTimeSec << "\n";
+    }
+  }
+  WriteMetricHeader(os, "plus_client_last_send_duration_seconds", "gauge", "Duration of sending the most recent message to the client.");
+  for (unsigned int i = 0; i < this->OpenIGTLinkServers.size(); ++i)
+  {
+    for (std::vector<vtkPlusOpenIGTLinkServer::ClientStatistics>::iterator it = clientStatistics[i].begin(); it != clientStatistics[i].end(); ++it)
+    {
+      os << "plus_client_last_send_duration_seconds{port=\"" << this->OpenIGTLinkServers[i]->GetListeningPort() << "\",client=\"" << it->ClientId << "\"} " << it->LastSendTimeSec << "\n";
+    }
+  }
+
+  WriteMetricHeader(os, "plus_command_queue_length", "gauge", "Number of commands waiting for execution.");
+  for (unsigned int i = 0; i < this->OpenIGTLinkServers.size(); ++i)
+  {
+    os << "plus_command_queue_length{port=\"" << this->OpenIGTLinkServers[i]->GetListeningPort() << "\"} " << this->OpenIGTLinkServers[i]->GetCommandProcessor()->GetCommandQueueLength() << "\n";
+  }
+  WriteMetricHeader(os, "plus_commands_executed_total", "counter", "Number of executed commands.");
+  for (unsigned int i = 0; i < this->OpenIGTLinkServers.size(); ++i)
+  {
+    os << "plus_commands_executed_total{port=\"" << this->OpenIGTLinkServers[i]->GetListeningPort() << "\"} " << this->OpenIGTLinkServers[i]->GetCommandProcessor()->GetNumberOfExecutedCommands() << "\n";
+  }
+  WriteMetricHeader(os, "plus_commands_failed_total", "counter", "Number of commands that failed.");
+  for (unsigned int i = 0; i < this->OpenIGTLinkServers.size(); ++i)
+  {
+    os << "plus_commands_failed_total{port=\"" << this->OpenIGTLinkServers[i]->GetListeningPort() << "\"} " << this->OpenIGTLinkServers[i]->GetCommandProcessor()->GetNumberOfFailedCommands() << "\n";
+  }
+  WriteMetricHeader(os, "plus_command_execution_duration_seconds_total", "counter", "Total time spent with command execution.");
+  for (unsigned int i = 0; i < this->OpenIGTLinkServers.size(); ++i)
+  {
+    os << "plus_command_execution_duration_seconds_total{port=\"" << this->OpenIGTLinkServers[i]->GetListeningPort() << "\"} " << this->OpenIGTLinkServers[i]->GetCommandProcessor()->GetTotalCommandExecutionTimeSec() << "\n";
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusMetricsServer::AppendProcessMetrics(std::ostream& os)
+{
+  vtksys::SystemInformation systemInformation;
+  long long memoryUsedKiB = systemInformation.GetProcMemoryUsed();
+  if (memoryUsedKiB < 0)
+  {
+    // not available on this platform
+    return;
+  }
+  WriteMetricHeader(os, "process_resident_memory_bytes", "gauge", "Resident memory size of the process.");
+  os << "process_resident_memory_bytes " << memoryUsedKiB * 1024 << "\n";
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusMetricsServer::EscapeLabelValue(const std::string& value)
+{
+  std::string escapedValue;
+  escapedValue.reserve(value.size());
+  for (std::string::const_iterator it = value.begin(); it != value.end(); ++it)
+  {
+    switch (*it)
+    {
+      case '\\':
+        escapedValue += "\\\\";
+        break;
+      case '"':
+        escapedValue += "\\\"";
+        break;
+      case '\n':
+        escapedValue += "\\n";
+        break;
+      default:
+        escapedValue += *it;
+    }
+  }
+  return escapedValue;
+}
@@ -0,0 +1,124 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusMetricsServer_h
+#define __vtkPlusMetricsServer_h
+
+// Local includes
+#include "vtkPlusServerExport.h"
+
+// VTK includes
+#include <vtkMultiThreader.h>
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+// IGTL includes
+#include <igtlServerSocket.h>
+
+// STL includes
+#include <atomic>
+#include <string>
+#include <vector>
+
+class vtkPlusDataCollector;
+class vtkPlusOpenIGTLinkServer;
+
+/*!
+  \class vtkPlusMetricsServer
+  \brief Minimal HTTP server that provides live acquisition and streaming metrics in Prometheus text format
+
+  GET /metrics returns the current values of
+  - device acquisition rate and InternalUpdate duration,
+  - buffer fill level and number of dropped items,
+  - number of messages, bytes, and send time for each OpenIGTLink client,
+  - command queue length and command execution time,
+  - resident memory of the process.
+
+  The values are collected from the counters of the monitored objects when the metrics are requested,
+  therefore the monitoring does not add any work to the acquisition and streaming threads.
+  Requests are served one by one by a background thread.
+
+  \ingroup PlusLibPlusServer
+*/
+class vtkPlusServerExport vtkPlusMetricsServer : public vtkObject
+{
+public:
+  static vtkPlusMetricsServer* New();
+  vtkTypeMacro(vtkPlusMetricsServer, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*! Open the listening port and start serving requests */
+  PlusStatus Start();
+
+  /*! Stop serving requests and close the listening port */
+  PlusStatus Stop();
+
+  /*! Returns true if the server is running */
+  bool IsStarted() const;
+
+  /*! Set server listening port */
+  vtkSetMacro(ListeningPort, int);
+  /*! Get server listening port */
+  vtkGetMacro(ListeningPort, int);
+
+  /*! Set the data collector whose devices and buffers are monitored */
+  void SetDataCollector(vtkPlusDataCollector* dataCollector);
+
+  /*! Add an OpenIGTLink server whose clients and command processor are monitored */
+  void AddOpenIGTLinkServer(vtkPlusOpenIGTLinkServer* server);
+
+  /*! Get the current metrics in Prometheus text exposition format */
+  std::string GetMetricsText();
+
+protected:
+  vtkPlusMetricsServer();
+  virtual ~vtkPlusMetricsServer();
+
+  /*! Thread that accepts connections and serves requests */
+  static void* ServerThread(vtkMultiThreader::ThreadInfo* data);
+
+  /*! Read a request from the connected client and send the response */
+  void ServeRequest(igtl::ClientSocket* clientSocket);
+
+  /*! Append the metrics of the devices and their buffers */
+  void AppendDeviceMetrics(std::ostream& os);
+
+  /*! Append the metrics of the OpenIGTLink clients and command processors */
+  void AppendServerMetrics(std::ostream& os);
+
+  /*! Append the metrics of the process */
+  void AppendProcessMetrics(std::ostream& os);
+
+  /*! Escape a Prometheus label value */
+  static std::string EscapeLabelValue(const std::string& value);
+
+  /*! Server listening port */
+  int ListeningPort;
+
+  /*! Monitored data collector */
+  vtkSmartPointer<vtkPlusDataCollector> DataCollector;
+
+  /*! Monitored OpenIGTLink servers */
+  std::vector<vtkSmartPointer<vtkPlusOpenIGTLinkServer> > OpenIGTLinkServers;
+
+  /*! HTTP server socket */
+  igtl::ServerSocket::Pointer ServerSocket;
+
+  /*! vtkMultiThreader instance for controlling threads */
+  vtkSmartPointer<vtkMultiThreader> Threader;
+
+  /*! Set by Stop, the server thread exits when it finds it set */
+  std::atomic<bool> ServerStopRequested;
+
+  // Thread identifier
+  int ServerThreadId;
+
+private:
+  vtkPlusMetricsServer(const vtkPlusMetricsServer&);  // Not implemented.
+  void operator=(const vtkPlusMetricsServer&);  // Not implemented.
+};
+
+#endif
@@ -102,6 +102,7 @@ vtkPlusOpenIGTLinkServer::vtkPlusOpenIGTLinkServer()
   , PlusCommandProcessor(vtkSmartPointer<vtkPlusCommandProcessor>::New())
   , MessageResponseQueueMutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
   , BroadcastChannel(NULL)
+  , ConfigurationAppliedObserverTag(0)
   , LogWarningOnNoDataAvailable(true)
   , KeepAliveIntervalSec(CLIENT_SOCKET_TIMEOUT_SEC / 2.0)
   , GracePeriodLogLevel(vtkPlusLogger::LOG_LEVEL_DEBUG)
@@ -193,6 +194,11 @@ PlusStatus vtkPlusOpenIGTLinkServer::StartOpenIGTLinkService()
 
   this->PlusCommandProcessor->SetPlusServer(this);
 
+  if (this->ConfigurationAppliedObserverTag == 0)
+  {
+    this->ConfigurationAppliedObserverTag = this->DataCollector->AddObserver(vtkPlusDataCollector::ConfigurationAppliedEvent, this, &vtkPlusOpenIGTLinkServer::OnDataCollectorConfigurationApplied);
+  }
+
   this->BroadcastStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
 
   return PLUS_SUCCESS;
@@ -201,6 +207,12 @@ PlusStatus vtkPlusOpenIGTLinkServer::StartOpenIGTLinkService()
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusOpenIGTLinkServer::StopOpenIGTLinkService()
 {
+  if (this->DataCollector != NULL && this->ConfigurationAppliedObserverTag != 0)
+  {
+    this->DataCollector->RemoveObserver(this->ConfigurationAppliedObserverTag);
+  }
+  this->ConfigurationAppliedObserverTag = 0;
+
   // Stop connection receiver thread
   if (this->ConnectionReceiverThreadId >= 0)
   {
@@ -269,27 +281,11 @@ void* vtkPlusOpenIGTLinkServer::ConnectionReceiverThread(vtkMultiThreader::Threa
       client->ClientSocket->SetReceiveTimeout(self->DefaultClientReceiveTimeoutSec * 1000);
       client->ClientSocket->SetSendTimeout(self->DefaultClientSendTimeoutSec * 1000);
       client->ClientInfo = self->DefaultClientInfo;
+      client->UsesDefaultClientInfo = true;
       client->Server = self;
 
       // Setup vtkIGSIOFrameConverters for each stream
-      for (std::vector<PlusIgtlClientInfo::ImageStream>::iterator imageStreamIterator = client->ClientInfo.ImageStreams.begin();
-        imageStreamIterator != client->ClientInfo.ImageStreams.end(); ++imageStreamIterator)
-      {
-        PlusIgtlClientInfo::ImageStream* imageStream = &(*imageStreamIterator);
-        if (!imageStream->FrameConverter)
-        {
-          imageStream->FrameConverter = vtkSmartPointer<vtkIGSIOFrameConverter>::New();
-        }
-      }
-      for (std::vector<PlusIgtlClientInfo::VideoStream>::iterator videoStreamIterator = client->ClientInfo.VideoStreams.begin();
-           videoStreamIterator != client->ClientInfo.VideoStreams.end(); ++videoStreamIterator)
-      {
-        PlusIgtlClientInfo::VideoStream* videoStream = &(*videoStreamIterator);
-        if (!videoStream->FrameConverter)
-        {
-          videoStream->FrameConverter = vtkSmartPointer<vtkIGSIOFrameConverter>::New();
-        }
-      }
+      CreateFrameConverters(client->ClientInfo);
 
       int port = 0;
       std::string address = "unknown";
@@ -321,58 +317,33 @@ void* vtkPlusOpenIGTLinkServer::DataSenderThread(vtkMultiThreader::ThreadInfo* d
   vtkPlusOpenIGTLinkServer* self = (vtkPlusOpenIGTLinkServer*)(data->UserData);
   self->DataSenderActive.Respond = true;
 
-  vtkPlusDevice* aDevice(NULL);
-  vtkPlusChannel* aChannel(NULL);
-
-  DeviceCollection aCollection;
-  if (self->DataCollector->GetDevices(aCollection) != PLUS_SUCCESS || aCollection.size() == 0)
+  if (self->DataCollector == NULL)
   {
-    LOG_ERROR("Unable to retrieve devices. Check configuration and connection.");
+    LOG_ERROR("Unable to start data sending. Data collector is not set.");
     return NULL;
   }
 
-  // Find the requested channel ID in all the devices
-  for (DeviceCollectionIterator it = aCollection.begin(); it != aCollection.end(); ++it)
-  {
-    aDevice = *it;
-    if (aDevice->GetOutputChannelByName(aChannel, self->GetOutputChannelId()) == PLUS_SUCCESS)
-    {
-      break;
-    }
-  }
-
-  if (aChannel == NULL)
   {
-    // The requested channel ID is not found
-    if (!self->GetOutputChannelId().empty())
+    // The devices must not be replaced while the channel is looked up
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> devicesMutexGuardedLock(self->DataCollector->GetDevicesMutex());
+    vtkPlusChannel* aChannel(NULL);
+    if (self->FindBroadcastChannel(aChannel) != PLUS_SUCCESS)
     {
-      // the user explicitly requested a specific channel, but none was found by that name
-      // this is an error
       LOG_ERROR("Unable to start data sending. OutputChannelId not found: " << self->GetOutputChannelId());
       return NULL;
     }
-    // the user did not specify any channel, so just use the first channel that can be found in any device
-    for (DeviceCollectionIterator it = aCollection.begin(); it != aCollection.end(); ++it)
+
+    // If we didn't find any channel then return
+    if (aChannel == NULL)
     {
-      aDevice = *it;
-      if (aDevice->OutputChannelCount() > 0)
-      {
-        aChannel = *(aDevice->GetOutputChannelsStart());
-        break;
-      }
+      LOG_WARNING("There are no channels to broadcast. Only command processing is available.");
     }
-  }
-
-  // If we didn't find any channel then return
-  if (aChannel == NULL)
-  {
-    LOG_WARNING("There are no channels to broadcast. Only command processing is available.");
-  }
 
-  self->BroadcastChannel = aChannel;
-  if (self->BroadcastChannel)
-  {
-    self->BroadcastChannel->GetMostRecentTimestamp(self->LastSentTrackedFrameTimestamp);
+    self->BroadcastChannel = aChannel;
+    if (self->BroadcastChannel)
+    {
+      self->BroadcastChannel->GetMostRecentTimestamp(self->LastSentTrackedFrameTimestamp);
+    }
   }
 
   double elapsedTimeSinceLastPacketSentSec = 0;
@@ -413,6 +384,68 @@ void* vtkPlusOpenIGTLinkServer::DataSenderThread(vtkMultiThreader::ThreadInfo* d
   return NULL;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkServer::FindBroadcastChannel(vtkPlusChannel*& aChannel)
+{
+  aChannel = NULL;
+
+  DeviceCollection aCollection;
+  if (this->DataCollector == NULL || this->DataCollector->GetDevices(aCollection) != PLUS_SUCCESS || aCollection.size() == 0)
+  {
+    LOG_ERROR("Unable to retrieve devices. Check configuration and connection.");
+    return PLUS_FAIL;
+  }
+
+  // Find the requested channel ID in all the devices
+  for (DeviceCollectionIterator it = aCollection.begin(); it != aCollection.end(); ++it)
+  {
+    if ((*it)->GetOutputChannelByName(aChannel, this->GetOutputChannelId()) == PLUS_SUCCESS)
+    {
+      return PLUS_SUCCESS;
+    }
+  }
+  aChannel = NULL;
+
+  // The requested channel ID is not found
+  if (!this->GetOutputChannelId().empty())
+  {
+    // the user explicitly requested a specific channel, but none was found by that name
+    return PLUS_FAIL;
+  }
+
+  // the user did not specify any channel, so just use the first channel that can be found in any device
+  for (DeviceCollectionIterator it = aCollection.begin(); it != aCollection.end(); ++it)
+  {
+    if ((*it)->OutputChannelCount() > 0)
+    {
+      aChannel = *((*it)->GetOutputChannelsStart());
+      break;
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusOpenIGTLinkServer::CreateFrameConverters(PlusIgtlClientInfo& clientInfo)
+{
+  for (std::vector<PlusIgtlClientInfo::ImageStream>::iterator imageStreamIterator = clientInfo.ImageStreams.begin();
+       imageStreamIterator != clientInfo.ImageStreams.end(); ++imageStreamIterator)
+  {
+    if (!imageStreamIterator->FrameConverter)
+    {
+      imageStreamIterator->FrameConverter = vtkSmartPointer<vtkIGSIOFrameConverter>::New();
+    }
+  }
+  for (std::vector<PlusIgtlClientInfo::VideoStream>::iterator videoStreamIterator = clientInfo.VideoStreams.begin();
+       videoStreamIterator != clientInfo.VideoStreams.end(); ++videoStreamIterator)
+  {
+    if (!videoStreamIterator->FrameConverter)
+    {
+      videoStreamIterator->FrameConverter = vtkSmartPointer<vtkIGSIOFrameConverter>::New();
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusOpenIGTLinkServer::SendLatestFramesToClients(vtkPlusOpenIGTLinkServer& self, double& elapsedTimeSinceLastPacketSentSec)
 {
@@ -429,30 +462,34 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendLatestFramesToClients(vtkPlusOpenIGTLin
   // Maximize the number of frames to send
   numberOfFramesToGet = std::min(numberOfFramesToGet, self.MaxNumberOfIgtlMessagesToSend);
 
-  if (self.BroadcastChannel != NULL)
   {
-    if ((self.BroadcastChannel->HasVideoSource() && !self.BroadcastChannel->GetVideoDataAvailable())
-        || (self.BroadcastChannel->ToolCount() > 0 && !self.BroadcastChannel->GetTrackingDataAvailable())
-        || (self.BroadcastChannel->FieldCount() > 0 && !self.BroadcastChannel->GetFieldDataAvailable()))
+    // Read the frames while the broadcast channel cannot be replaced by vtkPlusDataCollector::ApplyConfiguration, but send them unlocked
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> devicesMutexGuardedLock(self.DataCollector->GetDevicesMutex());
+    if (self.BroadcastChannel != NULL)
     {
-      if (self.LogWarningOnNoDataAvailable)
+      if ((self.BroadcastChannel->HasVideoSource() && !self.BroadcastChannel->GetVideoDataAvailable())
+          || (self.BroadcastChannel->ToolCount() > 0 && !self.BroadcastChannel->GetTrackingDataAvailable())
+          || (self.BroadcastChannel->FieldCount() > 0 && !self.BroadcastChannel->GetFieldDataAvailable()))
       {
-        LOG_DYNAMIC("No data is broadcasted, as no data is available yet.", self.GracePeriodLogLevel);
+        if (self.LogWarningOnNoDataAvailable)
+        {
+          LOG_DYNAMIC("No data is broadcasted, as no data is available yet.", self.GracePeriodLogLevel);
+        }
       }
-    }
-    else
-    {
-      double oldestDataTimestamp = 0;
-      if (self.BroadcastChannel->GetOldestTimestamp(oldestDataTimestamp) == PLUS_SUCCESS)
+      else
       {
-        if (self.LastSentTrackedFrameTimestamp < oldestDataTimestamp)
+        double oldestDataTimestamp = 0;
+        if (self.BroadcastChannel->GetOldestTimestamp(oldestDataTimestamp) == PLUS_SUCCESS)
         {
-          LOG_INFO("OpenIGTLink broadcasting started. No data was available between " << self.LastSentTrackedFrameTimestamp << "-" << oldestDataTimestamp << "sec, therefore no data were broadcasted during this time period.");
-          self.LastSentTrackedFrameTimestamp = oldestDataTimestamp + SAMPLING_SKIPPING_MARGIN_SEC;
+          if (self.LastSentTrackedFrameTimestamp < oldestDataTimestamp)
+          {
+            LOG_INFO("OpenIGTLink broadcasting started. No data was available between " << self.LastSentTrackedFrameTimestamp << "-" << oldestDataTimestamp << "sec, therefore no data were broadcasted during this time period.");
+            self.LastSentTrackedFrameTimestamp = oldestDataTimestamp + SAMPLING_SKIPPING_MARGIN_SEC;
+          }
+          static vtkIGSIOLogHelper logHelper(60.0, 500000);
+          CUSTOM_RETURN_WITH_FAIL_IF(self.BroadcastChannel->GetTrackedFrameList(self.LastSentTrackedFrameTimestamp, trackedFrameList, numberOfFramesToGet) != PLUS_SUCCESS,
+                                     "Failed to get tracked frame list from data collector (last recorded timestamp: " << std::fixed << self.LastSentTrackedFrameTimestamp);
         }
-        static vtkIGSIOLogHelper logHelper(60.0, 500000);
-        CUSTOM_RETURN_WITH_FAIL_IF(self.BroadcastChannel->GetTrackedFrameList(self.LastSentTrackedFrameTimestamp, trackedFrameList, numberOfFramesToGet) != PLUS_SUCCESS,
-                                   "Failed to get tracked frame list from data collector (last recorded timestamp: " << std::fixed << self.LastSentTrackedFrameTimestamp);
       }
     }
   }
@@ -501,17 +538,17 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendMessageResponses(vtkPlusOpenIGTLinkServ
     for (ClientIdToMessageListMap::iterator it = self.MessageResponseQueue.begin(); it != self.MessageResponseQueue.end(); ++it)
     {
       igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(self.IgtlClientsMutex);
-      igtl::ClientSocket::Pointer clientSocket = NULL;
+      ClientData* client = NULL;
 
       for (std::list<ClientData>::iterator clientIterator = self.IgtlClients.begin(); clientIterator != self.IgtlClients.end(); ++clientIterator)
       {
         if (clientIterator->ClientId == it->first)
         {
-          clientSocket = clientIterator->ClientSocket;
+          client = &(*clientIterator);
           break;
         }
       }
-      if (clientSocket.IsNull())
+      if (client == NULL || client->ClientSocket.IsNull())
       {
         LOG_WARNING("Message reply cannot be sent to client " << it->first << ", probably client has been disconnected.");
         continue;
@@ -519,7 +556,7 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendMessageResponses(vtkPlusOpenIGTLinkServ
 
       for (std::vector<igtl::MessageBase::Pointer>::iterator messageIt = it->second.begin(); messageIt != it->second.end(); ++messageIt)
       {
-        clientSocket->Send((*messageIt)->GetBufferPointer(), (*messageIt)->GetBufferSize());
+        self.SendToClient(*client, (*messageIt)->GetBufferPointer(), (*messageIt)->GetBufferSize());
       }
     }
     self.MessageResponseQueue.clear();
@@ -548,22 +585,22 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendCommandResponses(vtkPlusOpenIGTLinkServ
       // Only send the response to the client that requested the command
       LOG_DEBUG("Send command reply to client " << (*responseIt)->GetClientId() << ": " << igtlResponseMessage->GetDeviceName());
       igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(self.IgtlClientsMutex);
-      igtl::ClientSocket::Pointer clientSocket = NULL;
+      ClientData* client = NULL;
       for (std::list<ClientData>::iterator clientIterator = self.IgtlClients.begin(); clientIterator != self.IgtlClients.end(); ++clientIterator)
       {
         if (clientIterator->ClientId == (*responseIt)->GetClientId())
         {
-          clientSocket = clientIterator->ClientSocket;
+          client = &(*clientIterator);
           break;
         }
       }
 
-      if (clientSocket.IsNull())
+      if (client == NULL || client->ClientSocket.IsNull())
       {
         LOG_WARNING("Message reply cannot be sent to client " << (*responseIt)->GetClientId() << ", probably client has been disconnected");
         continue;
       }
-      clientSocket->Send(igtlResponseMessage->GetBufferPointer(), igtlResponseMessage->GetBufferSize());
+      self.SendToClient(*client, igtlResponseMessage->GetBufferPointer(), igtlResponseMessage->GetBufferSize());
     }
   }
 
@@ -631,6 +668,7 @@ void* vtkPlusOpenIGTLinkServer::DataReceiverThread(vtkMultiThreader::ThreadInfo*
         // Message received from client, need to lock to modify client info
         igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(self->IgtlClientsMutex);
         client->ClientInfo = clientInfoMsg->GetClientInfo();
+        client->UsesDefaultClientInfo = false;
         LOG_DEBUG("Client info message received from client " << clientId);
       }
     }
@@ -642,7 +680,7 @@ void* vtkPlusOpenIGTLinkServer::DataReceiverThread(vtkMultiThreader::ThreadInfo*
       igtl::StatusMessage::Pointer replyMsg = dynamic_cast<igtl::StatusMessage*>(self->IgtlMessageFactory->CreateSendMessage("STATUS", client->ClientInfo.GetClientHeaderVersion()).GetPointer());
       replyMsg->SetCode(igtl::StatusMessage::STATUS_OK);
       replyMsg->Pack();
-      clientSocket->Send(replyMsg->GetBufferPointer(), replyMsg->GetBufferSize());
+      self->SendToClient(*client, replyMsg->GetBufferPointer(), replyMsg->GetBufferSize());
     }
     else if (typeid(*bodyMessage) == typeid(igtl::StringMessage)
              && vtkPlusCommand::IsCommandDeviceName(headerMsg->GetDeviceName()))
@@ -1047,8 +1085,6 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendTrackedFrame(igsioTrackedFrame& tracked
 
     for (std::list<ClientData>::iterator clientIterator = this->IgtlClients.begin(); clientIterator != this->IgtlClients.end(); ++clientIterator)
     {
-      igtl::ClientSocket::Pointer clientSocket = (*clientIterator).ClientSocket;
-
       // Create IGT messages
       std::vector<igtl::MessageBase::Pointer> igtlMessages;
       std::vector<igtl::MessageBase::Pointer>::iterator igtlMessageIterator;
@@ -1068,7 +1104,7 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendTrackedFrame(igsioTrackedFrame& tracked
         }
 
         int retValue = 0;
-        RETRY_UNTIL_TRUE((retValue = clientSocket->Send(igtlMessage->GetBufferPointer(), igtlMessage->GetBufferSize())) != 0, this->NumberOfRetryAttempts, this->DelayBetweenRetryAttemptsSec);
+        RETRY_UNTIL_TRUE((retValue = this->SendToClient(*clientIterator, igtlMessage->GetBufferPointer(), igtlMessage->GetBufferSize())) != 0, this->NumberOfRetryAttempts, this->DelayBetweenRetryAttemptsSec);
         if (retValue == 0)
         {
           disconnectedClientIds.push_back(clientIterator->ClientId);
@@ -1198,7 +1234,7 @@ void vtkPlusOpenIGTLinkServer::KeepAlive()
 
       int retValue = 0;
       RETRY_UNTIL_TRUE(
-        (retValue = clientIterator->ClientSocket->Send(replyMsg->GetPackPointer(), replyMsg->GetPackSize())) != 0,
+        (retValue = this->SendToClient(*clientIterator, replyMsg->GetPackPointer(), replyMsg->GetPackSize())) != 0,
         this->NumberOfRetryAttempts, this->DelayBetweenRetryAttemptsSec);
       if (retValue == 0)
       {
@@ -1227,6 +1263,47 @@ unsigned int vtkPlusOpenIGTLinkServer::GetNumberOfConnectedClients() const
   return this->IgtlClients.size();
 }
 
+//------------------------------------------------------------------------------
+void vtkPlusOpenIGTLinkServer::GetClientStatistics(std::vector<ClientStatistics>& statistics) const
+{
+  statistics.clear();
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(this->IgtlClientsMutex);
+  for (std::list<ClientData>::const_iterator it = this->IgtlClients.begin(); it != this->IgtlClients.end(); ++it)
+  {
+    ClientStatistics clientStatistics;
+    clientStatistics.ClientId = it->ClientId;
+    clientStatistics.NumberOfSentMessages = it->NumberOfSentMessages;
+    clientStatistics.NumberOfSentBytes = it->NumberOfSentBytes;
+    clientStatistics.TotalSendTimeSec = it->TotalSendTimeSec;
+    clientStatistics.LastSendTimeSec = it->LastSendTimeSec;
+    statistics.push_back(clientStatistics);
+  }
+}
+
+//------------------------------------------------------------------------------
+vtkPlusCommandProcessor* vtkPlusOpenIGTLinkServer::GetCommandProcessor() const
+{
+  return this->PlusCommandProcessor;
+}
+
+//------------------------------------------------------------------------------
+int vtkPlusOpenIGTLinkServer::SendToClient(ClientData& client, const void* data, igtlUint64 length)
+{
+  double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  int retValue = client.ClientSocket->Send(data, length);
+  double sendTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+  if (retValue != 0)
+  {
+    // The lock is recursive, so this can be called while the client list is locked
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(this->IgtlClientsMutex);
+    client.NumberOfSentMessages++;
+    client.NumberOfSentBytes += length;
+    client.TotalSendTimeSec += sendTimeSec;
+    client.LastSendTimeSec = sendTimeSec;
+  }
+  return retValue;
+}
+
 //------------------------------------------------------------------------------
 PlusStatus vtkPlusOpenIGTLinkServer::GetClientInfo(unsigned int clientId, PlusIgtlClientInfo& outClientInfo) const
 {
@@ -1275,6 +1352,7 @@ PlusStatus vtkPlusOpenIGTLinkServer::ReadConfiguration(vtkXMLDataElement* server
   this->DefaultClientInfo.SetTDATAResolution(0);
   this->DefaultClientInfo.SetTDATARequested(false);
 
+  this->DefaultClientInfoElement = NULL;
   vtkXMLDataElement* defaultClientInfo = serverElement->FindNestedElementWithName("DefaultClientInfo");
   if (defaultClientInfo != NULL)
   {
@@ -1282,6 +1360,8 @@ PlusStatus vtkPlusOpenIGTLinkServer::ReadConfiguration(vtkXMLDataElement* server
     {
       return PLUS_FAIL;
     }
+    this->DefaultClientInfoElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    this->DefaultClientInfoElement->DeepCopy(defaultClientInfo);
   }
 
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(float, DefaultClientSendTimeoutSec, serverElement);
@@ -1290,6 +1370,120 @@ PlusStatus vtkPlusOpenIGTLinkServer::ReadConfiguration(vtkXMLDataElement* server
   return PLUS_SUCCESS;
 }
 
+//------------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkServer::ValidateConfiguration(vtkXMLDataElement* serverElement) const
+{
+  LOG_TRACE("vtkPlusOpenIGTLinkServer::ValidateConfiguration");
+
+  if (serverElement == NULL)
+  {
+    LOG_ERROR("Unable to apply PlusOpenIGTLinkServer configuration");
+    return PLUS_FAIL;
+  }
+
+  int listeningPort = -1;
+  if (!serverElement->GetScalarAttribute("ListeningPort", listeningPort) || listeningPort != this->ListeningPort)
+  {
+    LOG_ERROR("ListeningPort of the server cannot be changed while the server is running. Restart the server to apply this change.");
+    return PLUS_FAIL;
+  }
+  const char* outputChannelId = serverElement->GetAttribute("OutputChannelId");
+  if (outputChannelId == NULL || this->OutputChannelId != outputChannelId)
+  {
+    LOG_ERROR("OutputChannelId of the server cannot be changed while the server is running. Restart the server to apply this change.");
+    return PLUS_FAIL;
+  }
+
+  PlusIgtlClientInfo defaultClientInfo;
+  vtkXMLDataElement* defaultClientInfoElement = serverElement->FindNestedElementWithName("DefaultClientInfo");
+  if (defaultClientInfoElement != NULL && defaultClientInfo.SetClientInfoFromXmlData(defaultClientInfoElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read DefaultClientInfo of the server");
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusOpenIGTLinkServer::ApplyConfiguration(vtkXMLDataElement* serverElement)
+{
+  LOG_TRACE("vtkPlusOpenIGTLinkServer::ApplyConfiguration");
+
+  // Nothing is modified if the element cannot be applied
+  if (this->ValidateConfiguration(serverElement) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  PlusIgtlClientInfo defaultClientInfo;
+  vtkXMLDataElement* defaultClientInfoElement = serverElement->FindNestedElementWithName("DefaultClientInfo");
+  if (defaultClientInfoElement != NULL)
+  {
+    defaultClientInfo.SetClientInfoFromXmlData(defaultClientInfoElement);
+  }
+  bool defaultClientInfoChanged = (defaultClientInfoElement == NULL) != (this->DefaultClientInfoElement == NULL)
+                                  || (defaultClientInfoElement != NULL && !defaultClientInfoElement->IsEqualTo(this->DefaultClientInfoElement));
+
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(this->IgtlClientsMutex);
+
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, MissingInputGracePeriodSec, serverElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, MaxTimeSpentWithProcessingMs, serverElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, MaxNumberOfIgtlMessagesToSend, serverElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfRetryAttempts, serverElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, DelayBetweenRetryAttemptsSec, serverElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, KeepAliveIntervalSec, serverElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(SendValidTransformsOnly, serverElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(IgtlMessageCrcCheckEnabled, serverElement);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(LogWarningOnNoDataAvailable, serverElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(float, DefaultClientSendTimeoutSec, serverElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(float, DefaultClientReceiveTimeoutSec, serverElement);
+
+  if (!defaultClientInfoChanged)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  this->DefaultClientInfo = defaultClientInfo;
+  this->DefaultClientInfoElement = NULL;
+  if (defaultClientInfoElement != NULL)
+  {
+    this->DefaultClientInfoElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    this->DefaultClientInfoElement->DeepCopy(defaultClientInfoElement);
+  }
+
+  // Clients that requested their own streams keep them
+  int numberOfUpdatedClients = 0;
+  for (std::list<ClientData>::iterator clientIterator = this->IgtlClients.begin(); clientIterator != this->IgtlClients.end(); ++clientIterator)
+  {
+    if (!clientIterator->UsesDefaultClientInfo)
+    {
+      continue;
+    }
+    clientIterator->ClientInfo = this->DefaultClientInfo;
+    CreateFrameConverters(clientIterator->ClientInfo);
+    numberOfUpdatedClients++;
+  }
+  LOG_INFO("Default client info of the server is updated. Number of clients that receive the new streams: " << numberOfUpdatedClients);
+
+  return PLUS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+void vtkPlusOpenIGTLinkServer::OnDataCollectorConfigurationApplied(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eventId), void* vtkNotUsed(callData))
+{
+  // The data collector still holds the devices mutex, so the data sender thread cannot read the old channel meanwhile
+  if (this->DataSenderActive.Respond)
+  {
+    vtkPlusChannel* aChannel(NULL);
+    if (this->FindBroadcastChannel(aChannel) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("OutputChannelId not found: " << this->GetOutputChannelId() << ". No data is broadcasted.");
+    }
+    this->BroadcastChannel = aChannel;
+  }
+}
+
 //------------------------------------------------------------------------------
 int vtkPlusOpenIGTLinkServer::ProcessPendingCommands()
 {
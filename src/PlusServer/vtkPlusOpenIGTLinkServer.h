@@ -48,6 +48,11 @@ struct ClientData
     , DataReceiverActive(std::make_pair(false, false))
     , DataReceiverThreadId(-1)
     , Server(NULL)
+    , NumberOfSentMessages(0)
+    , NumberOfSentBytes(0)
+    , TotalSendTimeSec(0.0)
+    , LastSendTimeSec(0.0)
+    , UsesDefaultClientInfo(true)
   {
   }
 
@@ -68,6 +73,15 @@ struct ClientData
   PlusIgtlClientInfo ClientInfo;
 
   vtkPlusOpenIGTLinkServer* Server;
+
+  /// Sending statistics, guarded by the IgtlClientsMutex of the server
+  unsigned long long NumberOfSentMessages;
+  unsigned long long NumberOfSentBytes;
+  double TotalSendTimeSec;
+  double LastSendTimeSec;
+
+  /// True until the client sends a CLIENTINFO message, guarded by the IgtlClientsMutex of the server
+  bool UsesDefaultClientInfo;
 };
 
 /*!
@@ -104,6 +118,17 @@ public:
   /*! Read the configuration file in XML format and set up the devices */
   virtual PlusStatus ReadConfiguration(vtkXMLDataElement* serverElement, const std::string& aFilename);
 
+  /*!
+    Apply a modified PlusOpenIGTLinkServer element while the server is running.
+    The sending parameters and the default client info are updated. Clients that have not sent a CLIENTINFO message
+    receive the new default client info. Changing ListeningPort or OutputChannelId requires a restart of the server.
+    The server is not modified if ValidateConfiguration fails.
+  */
+  virtual PlusStatus ApplyConfiguration(vtkXMLDataElement* serverElement);
+
+  /*! Returns PLUS_SUCCESS if ApplyConfiguration can apply the PlusOpenIGTLinkServer element to the running server */
+  virtual PlusStatus ValidateConfiguration(vtkXMLDataElement* serverElement) const;
+
   /*! Set server listening port */
   vtkSetMacro(ListeningPort, int);
   /*! Get server listening port */
@@ -137,6 +162,22 @@ public:
   /*! Get number of connected clients */
   virtual unsigned int GetNumberOfConnectedClients() const;
 
+  /*! Sending statistics of a connected client */
+  struct ClientStatistics
+  {
+    int ClientId;
+    unsigned long long NumberOfSentMessages;
+    unsigned long long NumberOfSentBytes;
+    double TotalSendTimeSec;
+    double LastSendTimeSec;
+  };
+
+  /*! Get a copy of the sending statistics of all connected clients. Can be called from any thread. */
+  virtual void GetClientStatistics(std::vector<ClientStatistics>& statistics) const;
+
+  /*! Get the command processor of the server */
+  vtkPlusCommandProcessor* GetCommandProcessor() const;
+
   /*! Retrieve a COPY of client info for a given clientId
     Locks access to the client info for the duration of the function
     */
@@ -172,6 +213,18 @@ protected:
   /*! Thread for sending data to clients */
   static void* DataSenderThread(vtkMultiThreader::ThreadInfo* data);
 
+  /*!
+    Find the output channel of the data collector to broadcast. If OutputChannelId is empty then the first channel is used.
+    Returns failure if the requested channel does not exist, the channel is NULL if there are no channels at all.
+  */
+  PlusStatus FindBroadcastChannel(vtkPlusChannel*& aChannel);
+
+  /*! Create frame converters for the image and video streams of a client info that does not have them yet */
+  static void CreateFrameConverters(PlusIgtlClientInfo& clientInfo);
+
+  /*! Look up the broadcast channel again after the data collector applied a new configuration, as its device may have been replaced */
+  void OnDataCollectorConfigurationApplied(vtkObject* caller, unsigned long eventId, void* callData);
+
   /*! Attempt to send any unsent frames to clients, if unsuccessful, accumulate an elapsed time */
   static PlusStatus SendLatestFramesToClients(vtkPlusOpenIGTLinkServer& self, double& elapsedTimeSinceLastPacketSentSec);
 
@@ -193,6 +246,9 @@ protected:
   /*! Send status message to clients to keep alive the connection */
   virtual void KeepAlive();
 
+  /*! Send data to a client and update the sending statistics of the client. Returns the return value of the socket Send method. */
+  int SendToClient(ClientData& client, const void* data, igtlUint64 length);
+
   /*! Stops client's data receiving thread, closes the socket, and removes the client from the client list */
   void DisconnectClient(int clientId);
 
@@ -297,6 +353,8 @@ private:
   The default client info can be set in the devices set config file in the DefaultClientInfo element.
   */
   PlusIgtlClientInfo DefaultClientInfo;
+  /*! Copy of the DefaultClientInfo element, NULL if the configuration does not have one */
+  vtkSmartPointer<vtkXMLDataElement> DefaultClientInfoElement;
   float DefaultClientSendTimeoutSec;
   float DefaultClientReceiveTimeoutSec;
 
@@ -315,9 +373,12 @@ private:
   /*! Channel ID to request the data from */
   std::string OutputChannelId;
 
-  /*! Channel to use for broadcasting */
+  /*! Channel to use for broadcasting. Accessed while the devices mutex of the data collector is locked. */
   vtkPlusChannel* BroadcastChannel;
 
+  /*! Observer of the configuration applied event of the data collector, 0 if not observed */
+  unsigned long ConfigurationAppliedObserverTag;
+
   bool LogWarningOnNoDataAvailable;
 
   double KeepAliveIntervalSec;
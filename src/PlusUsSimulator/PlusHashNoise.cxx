@@ -0,0 +1,151 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+
+#include "PlusHashNoise.h"
+
+#include <cmath>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Smooth interpolation weight, its derivative is 0 at the lattice points to avoid visible lattice edges
+  inline double SmoothStep(double t)
+  {
+    return t * t * (3.0 - 2.0 * t);
+  }
+
+  //----------------------------------------------------------------------------
+  inline double Lerp(double a, double b, double t)
+  {
+    return a + t * (b - a);
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusHashNoise::PlusHashNoise()
+  : Seed(0)
+  , Amplitude(1.0)
+{
+  for (int i = 0; i < 3; i++)
+  {
+    this->Frequency[i] = 1.0;
+    this->Phase[i] = 0.0;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusHashNoise::~PlusHashNoise()
+{
+}
+
+//----------------------------------------------------------------------------
+void PlusHashNoise::SetSeed(unsigned int seed)
+{
+  this->Seed = seed;
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusHashNoise::GetSeed() const
+{
+  return this->Seed;
+}
+
+//----------------------------------------------------------------------------
+void PlusHashNoise::SetAmplitude(double amplitude)
+{
+  this->Amplitude = amplitude;
+}
+
+//----------------------------------------------------------------------------
+double PlusHashNoise::GetAmplitude() const
+{
+  return this->Amplitude;
+}
+
+//----------------------------------------------------------------------------
+void PlusHashNoise::SetFrequency(const double frequency[3])
+{
+  for (int i = 0; i < 3; i++)
+  {
+    this->Frequency[i] = frequency[i];
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusHashNoise::SetPhase(const double phase[3])
+{
+  for (int i = 0; i < 3; i++)
+  {
+    this->Phase[i] = phase[i];
+  }
+}
+
+//----------------------------------------------------------------------------
+double PlusHashNoise::GetLatticeValue(int x, int y, int z) const
+{
+  // Combine the coordinates with large odd constants then mix the bits (finalizer of MurmurHash3)
+  unsigned int hash = this->Seed * 0x9e3779b9u;
+  hash ^= static_cast<unsigned int>(x) * 0x8da6b343u;
+  hash ^= static_cast<unsigned int>(y) * 0xd8163841u;
+  hash ^= static_cast<unsigned int>(z) * 0xcb1ab31fu;
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35u;
+  hash ^= hash >> 16;
+  // Map the 32-bit value to -1..1
+  return hash * (2.0 / 4294967295.0) - 1.0;
+}
+
+//----------------------------------------------------------------------------
+double PlusHashNoise::Evaluate(const double position[3]) const
+{
+  double noise = 0;
+  const double step[3] = {0, 0, 0};
+  EvaluateLine(position, step, 1, &noise);
+  return noise;
+}
+
+//----------------------------------------------------------------------------
+void PlusHashNoise::EvaluateLine(const double startPosition[3], const double step[3], int numberOfSamples, double* noise) const
+{
+  // Neighbor samples are usually in the same lattice cell, so the corner values are only recomputed when the cell changes
+  int cellIndex[3] = {0, 0, 0};
+  double cornerValues[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  bool cornerValuesValid = false;
+  for (int sampleIndex = 0; sampleIndex < numberOfSamples; sampleIndex++)
+  {
+    int latticeIndex[3] = {0, 0, 0};
+    double weight[3] = {0, 0, 0};
+    for (int i = 0; i < 3; i++)
+    {
+      double latticePosition = (startPosition[i] + sampleIndex * step[i]) * this->Frequency[i] - this->Phase[i];
+      double latticeIndexFloor = floor(latticePosition);
+      latticeIndex[i] = static_cast<int>(latticeIndexFloor);
+      weight[i] = SmoothStep(latticePosition - latticeIndexFloor);
+    }
+    if (!cornerValuesValid || latticeIndex[0] != cellIndex[0] || latticeIndex[1] != cellIndex[1] || latticeIndex[2] != cellIndex[2])
+    {
+      for (int corner = 0; corner < 8; corner++)
+      {
+        cornerValues[corner] = GetLatticeValue(latticeIndex[0] + (corner & 1), latticeIndex[1] + ((corner >> 1) & 1), latticeIndex[2] + ((corner >> 2) & 1));
+      }
+      cellIndex[0] = latticeIndex[0];
+      cellIndex[1] = latticeIndex[1];
+      cellIndex[2] = latticeIndex[2];
+      cornerValuesValid = true;
+    }
+    double value00 = Lerp(cornerValues[0], cornerValues[1], weight[0]);
+    double value10 = Lerp(cornerValues[2], cornerValues[3], weight[0]);
+    double value01 = Lerp(cornerValues[4], cornerValues[5], weight[0]);
+    double value11 = Lerp(cornerValues[6], cornerValues[7], weight[0]);
+    double value0 = Lerp(value00, value10, weight[1]);
+    double value1 = Lerp(value01, value11, weight[1]);
+    noise[sampleIndex] = this->Amplitude * Lerp(value0, value1, weight[2]);
+  }
+}
@@ -0,0 +1,59 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusHashNoise_h
+#define __PlusHashNoise_h
+
+#include "vtkPlusUsSimulatorExport.h"
+
+/*!
+  \class PlusHashNoise
+  \brief Fast deterministic 3D noise for speckle simulation
+
+  Value noise: a pseudo-random value in the range of -1..1 is assigned to each point of an integer lattice by hashing
+  the lattice coordinates and the seed (counter-based generator, so no random number tables or state are needed)
+  and the values are interpolated between the lattice points using smoothstep-weighted trilinear interpolation.
+  The noise is evaluated at position * Frequency - Phase and scaled by Amplitude, similarly to vtkPerlinNoise,
+  but it is several times cheaper to compute and different seeds generate different, reproducible patterns.
+
+  The object is not modified by the evaluation methods, therefore they can be called from multiple threads.
+
+  \ingroup PlusLibUsSimulatorAlgo
+*/
+class vtkPlusUsSimulatorExport PlusHashNoise
+{
+public:
+  PlusHashNoise();
+  virtual ~PlusHashNoise();
+
+  void SetSeed(unsigned int seed);
+  unsigned int GetSeed() const;
+
+  void SetAmplitude(double amplitude);
+  double GetAmplitude() const;
+
+  /*! Set the spatial frequency of the noise (1/mm) along each axis */
+  void SetFrequency(const double frequency[3]);
+  /*! Set the offset of the noise pattern (in lattice units) along each axis */
+  void SetPhase(const double phase[3]);
+
+  /*! Get the noise value at a single position */
+  double Evaluate(const double position[3]) const;
+
+  /*! Get the noise values at numberOfSamples equally spaced positions: startPosition, startPosition+step, startPosition+2*step, ... */
+  void EvaluateLine(const double startPosition[3], const double step[3], int numberOfSamples, double* noise) const;
+
+protected:
+  /*! Pseudo-random value in the range of -1..1 at a lattice point */
+  double GetLatticeValue(int x, int y, int z) const;
+
+  unsigned int Seed;
+  double Amplitude;
+  double Frequency[3];
+  double Phase[3];
+};
+
+#endif
@@ -8,6 +8,9 @@ See License.txt for details.
 
 #include "PlusSpatialModel.h"
 
+#include <algorithm>
+
+#include "vtkGenericCell.h"
 #include "vtkMath.h"
 #include "vtkMatrix4x4.h"
 #include "vtkModifiedBSPTree.h"
@@ -26,6 +29,37 @@ const double MINIMUM_BEAM_INTENSITY = 1e-9;
 // Characterizes the specular reflection BRDF. If the value is smaller then reflection is limited to a smaller angle range (closer to 90deg incidence angle).
 double SPECULAR_REFLECTION_BRDF_STDEV = 30.0;
 
+//-----------------------------------------------------------------------------
+PlusSpatialModel::LineIntersectionWorkspace::LineIntersectionWorkspace()
+  : IntersectionPoints_Model(vtkSmartPointer<vtkPoints>::New())
+  , IntersectionCellIds(vtkSmartPointer<vtkIdList>::New())
+  , IntersectionCell(vtkSmartPointer<vtkGenericCell>::New())
+  , ReferenceToModelMatrix(vtkSmartPointer<vtkMatrix4x4>::New())
+  , ModelToReferenceMatrix(vtkSmartPointer<vtkMatrix4x4>::New())
+  , ObjectToModelMatrix(vtkSmartPointer<vtkMatrix4x4>::New())
+  , ModelLocalizerPolyDataMTime(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+PlusSpatialModel::LineIntersectionWorkspace::~LineIntersectionWorkspace()
+{
+}
+
+//-----------------------------------------------------------------------------
+PlusSpatialModel::PrecomputedIntensityCoefficients::PrecomputedIntensityCoefficients()
+  : DistanceBetweenScanlineSamplePointsMm(-1)
+  , ImagingFrequencyMhz(-1)
+  , AttenuationCoefficientDbPerCmMhz(-1)
+  , SurfaceReflectionIntensityDecayDbPerMm(-1)
+  , IntensityAttenuationCoefficientPerPixel(1)
+  , IntensityTransmittedFractionPerPixelTwoWay(1)
+  , LogIntensityTransmittedFractionPerPixelTwoWay(0)
+  , SurfaceReflectionIntensityDecayPerPixel(1)
+  , LogSurfaceReflectionIntensityDecayPerPixel(0)
+{
+}
+
 //-----------------------------------------------------------------------------
 PlusSpatialModel::PlusSpatialModel()
   : Name("")
@@ -45,6 +79,7 @@ PlusSpatialModel::PlusSpatialModel()
   , SurfaceDiffuseReflectionCoefficient(0.1)
   , ModelLocalizer(vtkModifiedBSPTree::New())
   , PolyData(NULL)
+  , ModelBvhPolyDataMTime(0)
 {
 }
 
@@ -81,7 +116,11 @@ PlusSpatialModel::PlusSpatialModel(const PlusSpatialModel& model)
   SetPolyData(model.PolyData);
   this->ModelFileNeedsUpdate = model.ModelFileNeedsUpdate;
   this->PrecomputedAttenuations = model.PrecomputedAttenuations;
+  this->IntensityCoefficients = model.IntensityCoefficients;
   this->TransducerSpatialModelMaxOverlapMm = model.TransducerSpatialModelMaxOverlapMm;
+  this->ModelBvh = model.ModelBvh;
+  this->ModelBvhPolyData = model.ModelBvhPolyData;
+  this->ModelBvhPolyDataMTime = model.ModelBvhPolyDataMTime;
 }
 
 //-----------------------------------------------------------------------------
@@ -104,7 +143,11 @@ void PlusSpatialModel::operator=(const PlusSpatialModel& model)
   SetPolyData(model.PolyData);
   this->ModelFileNeedsUpdate = model.ModelFileNeedsUpdate;
   this->PrecomputedAttenuations = model.PrecomputedAttenuations;
+  this->IntensityCoefficients = model.IntensityCoefficients;
   this->TransducerSpatialModelMaxOverlapMm = model.TransducerSpatialModelMaxOverlapMm;
+  this->ModelBvh = model.ModelBvh;
+  this->ModelBvhPolyData = model.ModelBvhPolyData;
+  this->ModelBvhPolyDataMTime = model.ModelBvhPolyDataMTime;
 }
 
 //-----------------------------------------------------------------------------
@@ -201,17 +244,15 @@ PlusStatus PlusSpatialModel::ReadConfiguration(vtkXMLDataElement* spatialModelEl
 }
 
 //-----------------------------------------------------------------------------
-double PlusSpatialModel::GetAcousticImpedanceMegarayls()
+double PlusSpatialModel::GetAcousticImpedanceMegarayls() const
 {
   double acousticImpedanceRayls = this->DensityKgPerM3 * this->SoundVelocityMPerSec; // kg / (s * m2)
   return acousticImpedanceRayls * 1e-6; // megarayls
 }
 
 //-----------------------------------------------------------------------------
-void PlusSpatialModel::CalculateIntensity(std::vector<double>& reflectedIntensity, unsigned int numberOfFilledPixels, double distanceBetweenScanlineSamplePointsMm, double previousModelAcousticImpedanceMegarayls, double incidentIntensity, double& transmittedIntensity, double incidenceAngleRad)
+void PlusSpatialModel::CalculateIntensity(std::vector<double>& reflectedIntensity, unsigned int numberOfFilledPixels, double distanceBetweenScanlineSamplePointsMm, double previousModelAcousticImpedanceMegarayls, double incidentIntensity, double& transmittedIntensity, double incidenceAngleRad) const
 {
-  UpdateModelFile();
-
   if (numberOfFilledPixels <= 0)
   {
     transmittedIntensity = incidentIntensity;
@@ -224,6 +265,16 @@ void PlusSpatialModel::CalculateIntensity(std::vector<double>& reflectedIntensit
     reflectedIntensity.resize(numberOfFilledPixels);
   }
 
+  // Coefficients are computed by PrepareForScanlineSimulation, they must not be updated here, as this method may be called from multiple threads
+  if (!IsPrecomputedIntensityCoefficientsUpToDate(distanceBetweenScanlineSamplePointsMm, numberOfFilledPixels))
+  {
+    LOG_ERROR("SpatialModel::CalculateIntensity error: SpatialModel " << this->Name << " is not prepared for scanline simulation");
+    std::fill(reflectedIntensity.begin(), reflectedIntensity.begin() + numberOfFilledPixels, 0.0);
+    transmittedIntensity = 0;
+    return;
+  }
+  const PrecomputedIntensityCoefficients& coefficients = this->IntensityCoefficients;
+
   // Compute reflection from the surface of the previous and this model
   double acousticImpedanceMegarayls = GetAcousticImpedanceMegarayls();
   // intensityReflectionCoefficient: reflected beam intensity / incident beam intensity => can be computed from acoustic impedance mismatch
@@ -253,20 +304,16 @@ void PlusSpatialModel::CalculateIntensity(std::vector<double>& reflectedIntensit
   }
 
   // Compute attenuation within this model
-  double intensityAttenuationCoefficientdBPerPixel = this->AttenuationCoefficientDbPerCmMhz * (distanceBetweenScanlineSamplePointsMm / 10.0) * this->ImagingFrequencyMhz;
   // intensityAttenuationCoefficientPerPixel: should be close to 1, as it's the ratio of (transmitted beam intensity / incident beam intensity) after traversing through a single pixel
-  double intensityAttenuationCoefficientPerPixel = pow(10.0, -intensityAttenuationCoefficientdBPerPixel / 10.0);
+  double intensityAttenuationCoefficientPerPixel = coefficients.IntensityAttenuationCoefficientPerPixel;
   // intensityAttenuatedFractionPerPixel: how big fraction of the intensity is attenuated during traversing through one voxel
   double intensityAttenuatedFractionPerPixel = (1 - intensityAttenuationCoefficientPerPixel);
   // intensityTransmittedFractionPerPixelTwoWay: how big fraction of the intensity is transmitted during traversing through one voxel; takes into account both propagation directions
-  double intensityTransmittedFractionPerPixelTwoWay = intensityAttenuationCoefficientPerPixel * intensityAttenuationCoefficientPerPixel;
+  double intensityTransmittedFractionPerPixelTwoWay = coefficients.IntensityTransmittedFractionPerPixelTwoWay;
 
   transmittedIntensity = surfaceTransmittedBeamIntensity * intensityTransmittedFractionPerPixelTwoWay;
 
-  if ((numberOfFilledPixels > 0 && this->PrecomputedAttenuations.size() < numberOfFilledPixels) || intensityTransmittedFractionPerPixelTwoWay != this->PrecomputedAttenuations[0])
-  {
-    UpdatePrecomputedAttenuations(intensityTransmittedFractionPerPixelTwoWay, numberOfFilledPixels);
-  }
+  double* reflectedIntensityPixels = &reflectedIntensity[0];
 
   // We iterate until transmittedIntensity * intensityTransmittedFractionPerPixelTwoWay^n > MINIMUM_BEAM_INTENSITY
   // So, n = log(MINIMUM_BEAM_INTENSITY/transmittedIntensity) / log(intensityTransmittedFractionPerPixelTwoWay)
@@ -276,13 +323,14 @@ void PlusSpatialModel::CalculateIntensity(std::vector<double>& reflectedIntensit
     numberOfIterationsToReachMinimumBeamIntensity =
       std::min<unsigned int>(numberOfFilledPixels,  // value may be larger than number of pixels to fill -> clamp it to the number of pixels to fill
                              static_cast<unsigned int>(std::max<int>(0,   // value may be negative when AttenuationCoefficientDbPerCmMhz is close to 0 -> clamp it to zero
-                                 floor(log(MINIMUM_BEAM_INTENSITY / transmittedIntensity) / log(intensityTransmittedFractionPerPixelTwoWay)) + 1)));
+                                 floor(log(MINIMUM_BEAM_INTENSITY / transmittedIntensity) / coefficients.LogIntensityTransmittedFractionPerPixelTwoWay) + 1)));
     double backScatterFactor = transmittedIntensity * intensityAttenuatedFractionPerPixel * this->BackscatterDiffuseReflectionCoefficient / intensityTransmittedFractionPerPixelTwoWay;
+    // a fraction of the attenuation is caused by backscattering, the backscattering is sensed by the transducer
+    // (independent iterations on plain arrays, so that the compiler can vectorize the loop)
+    const double* attenuations = &this->PrecomputedAttenuations[0];
     for (unsigned int currentPixelInFilledPixels = 0; currentPixelInFilledPixels < numberOfIterationsToReachMinimumBeamIntensity; currentPixelInFilledPixels++)
     {
-      // a fraction of the attenuation is caused by backscattering, the backscattering is sensed by the transducer
-      //reflectedIntensity[currentPixelInFilledPixels] = *(attenuation++) * backScatterFactor;
-      reflectedIntensity[currentPixelInFilledPixels] = this->PrecomputedAttenuations[currentPixelInFilledPixels] * backScatterFactor;
+      reflectedIntensityPixels[currentPixelInFilledPixels] = attenuations[currentPixelInFilledPixels] * backScatterFactor;
     }
     transmittedIntensity *= pow(intensityTransmittedFractionPerPixelTwoWay, static_cast<double>(numberOfIterationsToReachMinimumBeamIntensity));
   }
@@ -291,33 +339,125 @@ void PlusSpatialModel::CalculateIntensity(std::vector<double>& reflectedIntensit
     transmittedIntensity = 0;
   }
   // The beam intensity is very close to 0, so fill the remaining values with 0 instead of computing miniscule values
-  for (unsigned int currentPixelInFilledPixels = numberOfIterationsToReachMinimumBeamIntensity; currentPixelInFilledPixels < numberOfFilledPixels; currentPixelInFilledPixels++)
-  {
-    reflectedIntensity[currentPixelInFilledPixels] = 0.0;
-  }
+  std::fill(reflectedIntensityPixels + numberOfIterationsToReachMinimumBeamIntensity, reflectedIntensityPixels + numberOfFilledPixels, 0.0);
 
   // Add surface reflection
   if (backscatteredReflectedIntensity > MINIMUM_BEAM_INTENSITY)
   {
-    double surfaceReflectionIntensityDecayPerPixel = pow(10.0, -this->SurfaceReflectionIntensityDecayDbPerMm * distanceBetweenScanlineSamplePointsMm / 10.0);
+    double surfaceReflectionIntensityDecayPerPixel = coefficients.SurfaceReflectionIntensityDecayPerPixel;
     // We iterate until backscatteredReflectedIntensity * surfaceReflectionIntensityDecayPerPixel^n > MINIMUM_BEAM_INTENSITY
     // So, n = log(MINIMUM_BEAM_INTENSITY/backscatteredReflectedIntensity) / log(surfaceReflectionIntensityDecayPerPixel)
-    int numberOfIterationsToReachMinimumBackscatteredIntensity = std::min<int>(numberOfFilledPixels, floor(log(MINIMUM_BEAM_INTENSITY / backscatteredReflectedIntensity) / log(surfaceReflectionIntensityDecayPerPixel)) + 1);
+    int numberOfIterationsToReachMinimumBackscatteredIntensity = std::min<int>(numberOfFilledPixels, floor(log(MINIMUM_BEAM_INTENSITY / backscatteredReflectedIntensity) / coefficients.LogSurfaceReflectionIntensityDecayPerPixel) + 1);
+    // The decay is computed incrementally (and not from a table) to get exactly the same intensities as before, it spans only a few pixels anyway
     for (int currentPixelInFilledPixels = 0; currentPixelInFilledPixels < numberOfIterationsToReachMinimumBackscatteredIntensity; currentPixelInFilledPixels++)
     {
       // a fraction of the attenuation is caused by backscattering, the backscattering is sensed by the transducer
-      reflectedIntensity[currentPixelInFilledPixels] += backscatteredReflectedIntensity;
+      reflectedIntensityPixels[currentPixelInFilledPixels] += backscatteredReflectedIntensity;
       backscatteredReflectedIntensity *= surfaceReflectionIntensityDecayPerPixel;
     }
   }
   // TODO: to simulate beamwidth, take into account the incidence angle and disperse the reflection on a larger area if the angle is large
 }
 
+//-----------------------------------------------------------------------------
+double PlusSpatialModel::GetIntensityAttenuationCoefficientPerPixel(double distanceBetweenScanlineSamplePointsMm)
+{
+  double intensityAttenuationCoefficientdBPerPixel = this->AttenuationCoefficientDbPerCmMhz * (distanceBetweenScanlineSamplePointsMm / 10.0) * this->ImagingFrequencyMhz;
+  return pow(10.0, -intensityAttenuationCoefficientdBPerPixel / 10.0);
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus PlusSpatialModel::PrepareForScanlineSimulation(double distanceBetweenScanlineSamplePointsMm, unsigned int numberOfSamplesPerScanline)
+{
+  PlusStatus status = UpdateModelFile();
+
+  // Compute the coefficients and fill the attenuation table now, so that CalculateIntensity never has to update them
+  UpdatePrecomputedIntensityCoefficients(distanceBetweenScanlineSamplePointsMm, numberOfSamplesPerScanline);
+
+  return status;
+}
+
+//-----------------------------------------------------------------------------
+bool PlusSpatialModel::IsPrecomputedIntensityCoefficientsUpToDate(double distanceBetweenScanlineSamplePointsMm, unsigned int numberOfSamplesPerScanline) const
+{
+  const PrecomputedIntensityCoefficients& coefficients = this->IntensityCoefficients;
+  return coefficients.DistanceBetweenScanlineSamplePointsMm == distanceBetweenScanlineSamplePointsMm
+         && coefficients.ImagingFrequencyMhz == this->ImagingFrequencyMhz
+         && coefficients.AttenuationCoefficientDbPerCmMhz == this->AttenuationCoefficientDbPerCmMhz
+         && coefficients.SurfaceReflectionIntensityDecayDbPerMm == this->SurfaceReflectionIntensityDecayDbPerMm
+         && this->PrecomputedAttenuations.size() >= numberOfSamplesPerScanline
+         && (this->PrecomputedAttenuations.empty() || coefficients.IntensityTransmittedFractionPerPixelTwoWay == this->PrecomputedAttenuations[0]);
+}
+
+//-----------------------------------------------------------------------------
+void PlusSpatialModel::UpdatePrecomputedIntensityCoefficients(double distanceBetweenScanlineSamplePointsMm, unsigned int numberOfSamplesPerScanline)
+{
+  PrecomputedIntensityCoefficients& coefficients = this->IntensityCoefficients;
+  if (coefficients.DistanceBetweenScanlineSamplePointsMm != distanceBetweenScanlineSamplePointsMm
+      || coefficients.ImagingFrequencyMhz != this->ImagingFrequencyMhz
+      || coefficients.AttenuationCoefficientDbPerCmMhz != this->AttenuationCoefficientDbPerCmMhz
+      || coefficients.SurfaceReflectionIntensityDecayDbPerMm != this->SurfaceReflectionIntensityDecayDbPerMm)
+  {
+    coefficients.DistanceBetweenScanlineSamplePointsMm = distanceBetweenScanlineSamplePointsMm;
+    coefficients.ImagingFrequencyMhz = this->ImagingFrequencyMhz;
+    coefficients.AttenuationCoefficientDbPerCmMhz = this->AttenuationCoefficientDbPerCmMhz;
+    coefficients.SurfaceReflectionIntensityDecayDbPerMm = this->SurfaceReflectionIntensityDecayDbPerMm;
+    coefficients.IntensityAttenuationCoefficientPerPixel = GetIntensityAttenuationCoefficientPerPixel(distanceBetweenScanlineSamplePointsMm);
+    coefficients.IntensityTransmittedFractionPerPixelTwoWay = coefficients.IntensityAttenuationCoefficientPerPixel * coefficients.IntensityAttenuationCoefficientPerPixel;
+    coefficients.LogIntensityTransmittedFractionPerPixelTwoWay = log(coefficients.IntensityTransmittedFractionPerPixelTwoWay);
+    coefficients.SurfaceReflectionIntensityDecayPerPixel = pow(10.0, -this->SurfaceReflectionIntensityDecayDbPerMm * distanceBetweenScanlineSamplePointsMm / 10.0);
+    coefficients.LogSurfaceReflectionIntensityDecayPerPixel = log(coefficients.SurfaceReflectionIntensityDecayPerPixel);
+    // the attenuation table has to be recomputed
+    this->PrecomputedAttenuations.clear();
+  }
+  if (numberOfSamplesPerScanline > 0
+      && (this->PrecomputedAttenuations.size() < numberOfSamplesPerScanline || coefficients.IntensityTransmittedFractionPerPixelTwoWay != this->PrecomputedAttenuations[0]))
+  {
+    UpdatePrecomputedAttenuations(coefficients.IntensityTransmittedFractionPerPixelTwoWay, numberOfSamplesPerScanline);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void PlusSpatialModel::PrepareLineIntersectionWorkspace(LineIntersectionWorkspace& workspace, bool useModelLocalizer)
+{
+  if (useModelLocalizer || this->PolyData == NULL)
+  {
+    workspace.ModelLocalizer = NULL;
+    workspace.ModelLocalizerPolyData = NULL;
+    return;
+  }
+  if (workspace.ModelLocalizer.GetPointer() != NULL && workspace.ModelLocalizerPolyData.GetPointer() == this->PolyData
+      && workspace.ModelLocalizerPolyDataMTime == this->PolyData->GetMTime())
+  {
+    // locator is already built for this surface and the surface has not been modified since then
+    return;
+  }
+  workspace.ModelLocalizer = vtkSmartPointer<vtkModifiedBSPTree>::New();
+  workspace.ModelLocalizerPolyData = this->PolyData;
+  workspace.ModelLocalizerPolyDataMTime = this->PolyData->GetMTime();
+  BuildModelLocalizer(workspace.ModelLocalizer, this->PolyData);
+}
+
+//-----------------------------------------------------------------------------
+void PlusSpatialModel::BuildModelLocalizer(vtkModifiedBSPTree* modelLocalizer, vtkPolyData* polyData)
+{
+  modelLocalizer->SetDataSet(polyData);
+  modelLocalizer->SetMaxLevel(24);
+  modelLocalizer->SetNumberOfCellsPerNode(32);
+  modelLocalizer->BuildLocator();
+}
+
 //-----------------------------------------------------------------------------
 void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& lineIntersections, double* scanLineStartPoint_Reference, double* scanLineEndPoint_Reference)
 {
   UpdateModelFile();
+  LineIntersectionWorkspace workspace;
+  GetLineIntersections(lineIntersections, scanLineStartPoint_Reference, scanLineEndPoint_Reference, workspace);
+}
 
+//-----------------------------------------------------------------------------
+void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& lineIntersections, double* scanLineStartPoint_Reference, double* scanLineEndPoint_Reference, LineIntersectionWorkspace& workspace)
+{
   if (this->ModelFile.empty())
   {
     // no model is defined, which means that the model is everywhere
@@ -345,9 +485,9 @@ void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& li
     searchLineStartPoint_Reference[i] = scanLineStartPoint_Reference[i] - this->TransducerSpatialModelMaxOverlapMm * scanLineDirectionVector_Reference[i] / scanLineDirectionVectorNorm_Reference;
   }
 
-  vtkSmartPointer<vtkMatrix4x4> objectToModelMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkMatrix4x4* objectToModelMatrix = workspace.ObjectToModelMatrix;
   vtkMatrix4x4::Invert(this->ModelToObjectTransform, objectToModelMatrix);
-  vtkSmartPointer<vtkMatrix4x4> referenceToModelMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkMatrix4x4* referenceToModelMatrix = workspace.ReferenceToModelMatrix;
   vtkMatrix4x4::Multiply4x4(objectToModelMatrix, this->ReferenceToObjectTransform, referenceToModelMatrix);
 
   double searchLineStartPoint_Model[4] = {0, 0, 0, 1};
@@ -355,9 +495,10 @@ void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& li
   referenceToModelMatrix->MultiplyPoint(searchLineStartPoint_Reference, searchLineStartPoint_Model);
   referenceToModelMatrix->MultiplyPoint(scanLineEndPoint_Reference, scanLineEndPoint_Model);
 
-  vtkSmartPointer<vtkPoints> intersectionPoints_Model = vtkSmartPointer<vtkPoints>::New();
-  vtkSmartPointer<vtkIdList> intersectionCellIds = vtkSmartPointer<vtkIdList>::New();
-  this->ModelLocalizer->IntersectWithLine(searchLineStartPoint_Model, scanLineEndPoint_Model, 0.0, intersectionPoints_Model, intersectionCellIds);
+  vtkPoints* intersectionPoints_Model = workspace.IntersectionPoints_Model;
+  vtkIdList* intersectionCellIds = workspace.IntersectionCellIds;
+  vtkModifiedBSPTree* modelLocalizer = (workspace.ModelLocalizer.GetPointer() != NULL) ? workspace.ModelLocalizer.GetPointer() : this->ModelLocalizer;
+  modelLocalizer->IntersectWithLine(searchLineStartPoint_Model, scanLineEndPoint_Model, 0.0, intersectionPoints_Model, intersectionCellIds);
 
   if (intersectionPoints_Model->GetNumberOfPoints() < 1)
   {
@@ -365,7 +506,7 @@ void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& li
     return;
   }
 
-  vtkSmartPointer<vtkMatrix4x4> modelToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkMatrix4x4* modelToReferenceMatrix = workspace.ModelToReferenceMatrix;
   vtkMatrix4x4::Invert(referenceToModelMatrix, modelToReferenceMatrix);
 
   // Measure the distance from the starting point in the reference coordinate system
@@ -416,8 +557,10 @@ void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& li
     intersectionPoints_Model->GetPoint(intersectionPointIndex, intersectionPoint_Model);
     modelToReferenceMatrix->MultiplyPoint(intersectionPoint_Model, intersectionPoint_Reference);
     intersectionInfo.IntersectionDistanceFromStartPointMm = sqrt(vtkMath::Distance2BetweenPoints(scanLineStartPoint_Reference, intersectionPoint_Reference));
-    vtkTriangle* cell = vtkTriangle::SafeDownCast(this->PolyData->GetCell(intersectionCellIds->GetId(intersectionPointIndex)));
-    if (cell != NULL && normals_Model != NULL)
+    // The cell is retrieved into the workspace (instead of using the cell object that is shared by all callers of vtkPolyData::GetCell)
+    vtkGenericCell* cell = workspace.IntersectionCell;
+    this->PolyData->GetCell(intersectionCellIds->GetId(intersectionPointIndex), cell);
+    if (cell->GetCellType() == VTK_TRIANGLE && normals_Model != NULL)
     {
       const int NUMBER_OF_POINTS_PER_CELL = 3; // triangle cell
       double pcoords[NUMBER_OF_POINTS_PER_CELL] = {0, 0, 0};
@@ -427,14 +570,17 @@ void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& li
       int subId = 0;
       cell->EvaluatePosition(intersectionPoint_Model, closestPoint, subId, pcoords, dist2, weights);
       double interpolatedNormal_Model[3] = {0, 0, 0};
+      double normalAtCellCorner[3] = {0, 0, 0};
       for (int pointIndex = 0; pointIndex < NUMBER_OF_POINTS_PER_CELL; pointIndex++)
       {
-        double* normalAtCellCorner = normals_Model->GetTuple3(cell->GetPointId(pointIndex));
-        if (normalAtCellCorner == NULL)
+        vtkIdType pointId = cell->GetPointId(pointIndex);
+        if (pointId < 0 || pointId >= normals_Model->GetNumberOfTuples())
         {
           LOG_ERROR("SpatialModel::GetLineIntersections error: invalid normal");
           continue;
         }
+        // GetTuple3 would return a pointer to a buffer that is shared between threads, therefore the tuple is copied to a local array
+        normals_Model->GetTuple(pointId, normalAtCellCorner);
         interpolatedNormal_Model[0] += normalAtCellCorner[0] * weights[pointIndex];
         interpolatedNormal_Model[1] += normalAtCellCorner[1] * weights[pointIndex];
         interpolatedNormal_Model[2] += normalAtCellCorner[2] * weights[pointIndex];
@@ -451,6 +597,153 @@ void PlusSpatialModel::GetLineIntersections(std::deque<LineIntersectionInfo>& li
   }
 }
 
+//-----------------------------------------------------------------------------
+PlusStatus PlusSpatialModel::PrepareBoundingVolumeHierarchy()
+{
+  if (this->PolyData == NULL)
+  {
+    // background material or model could not be loaded
+    this->ModelBvh.reset();
+    this->ModelBvhPolyData = NULL;
+    return PLUS_SUCCESS;
+  }
+  if (this->ModelBvh && this->ModelBvhPolyData.GetPointer() == this->PolyData && this->ModelBvhPolyDataMTime == this->PolyData->GetMTime())
+  {
+    // already built for this surface and the surface has not been modified since then
+    return PLUS_SUCCESS;
+  }
+  std::shared_ptr<PlusTriangleBvh> modelBvh = std::make_shared<PlusTriangleBvh>();
+  if (modelBvh->Build(this->PolyData) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to build bounding volume hierarchy for SpatialModel " << this->Name);
+    this->ModelBvh.reset();
+    this->ModelBvhPolyData = NULL;
+    return PLUS_FAIL;
+  }
+  this->ModelBvh = modelBvh;
+  this->ModelBvhPolyData = this->PolyData;
+  this->ModelBvhPolyDataMTime = this->PolyData->GetMTime();
+  return PLUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+void PlusSpatialModel::GetLinePacketIntersections(int numberOfLines, const double* scanLineStartPoints_Reference, const double* scanLineEndPoints_Reference, LinePacketIntersections& intersections)
+{
+  intersections.FirstIntersectionIndex.resize(numberOfLines + 1);
+  intersections.FirstIntersectionIndex[0] = 0;
+  intersections.IntersectionDistanceFromStartPointMm.clear();
+  intersections.IntersectionIncidenceAngleRad.clear();
+
+  if (this->ModelFile.empty())
+  {
+    // no model is defined, which means that the model is everywhere
+    // add an intersection point at 0 distance to each line, which means that the whole line is in this model
+    for (int lineIndex = 0; lineIndex < numberOfLines; lineIndex++)
+    {
+      intersections.IntersectionDistanceFromStartPointMm.push_back(0);
+      intersections.IntersectionIncidenceAngleRad.push_back(0);
+      intersections.FirstIntersectionIndex[lineIndex + 1] = lineIndex + 1;
+    }
+    return;
+  }
+
+  if (!this->ModelBvh)
+  {
+    LOG_ERROR("SpatialModel::GetLinePacketIntersections error: bounding volume hierarchy is not available for SpatialModel " << this->Name);
+    std::fill(intersections.FirstIntersectionIndex.begin(), intersections.FirstIntersectionIndex.end(), 0);
+    return;
+  }
+
+  // The matrices are computed from the raw elements, so that no VTK objects are modified
+  double objectToModelMatrix[16];
+  vtkMatrix4x4::Invert(&this->ModelToObjectTransform->Element[0][0], objectToModelMatrix);
+  double referenceToModelMatrix[16];
+  vtkMatrix4x4::Multiply4x4(objectToModelMatrix, &this->ReferenceToObjectTransform->Element[0][0], referenceToModelMatrix);
+
+  const int maximumPacketSize = PlusTriangleBvh::MAX_PACKET_SIZE;
+  PlusTriangleBvh::RayPacket packet;
+  double searchLineLength_Reference[PlusTriangleBvh::MAX_PACKET_SIZE];
+  double scanLineDirectionVector_Model[PlusTriangleBvh::MAX_PACKET_SIZE][4];
+  for (int firstLineIndex = 0; firstLineIndex < numberOfLines; firstLineIndex += maximumPacketSize)
+  {
+    packet.NumberOfRays = std::min(maximumPacketSize, numberOfLines - firstLineIndex);
+    for (int rayIndex = 0; rayIndex < packet.NumberOfRays; rayIndex++)
+    {
+      const double* scanLineStartPoint_Reference = scanLineStartPoints_Reference + (firstLineIndex + rayIndex) * 3;
+      const double* scanLineEndPoint_Reference = scanLineEndPoints_Reference + (firstLineIndex + rayIndex) * 3;
+      double scanLineDirectionVector_Reference[4] =
+      {
+        scanLineEndPoint_Reference[0] - scanLineStartPoint_Reference[0],
+        scanLineEndPoint_Reference[1] - scanLineStartPoint_Reference[1],
+        scanLineEndPoint_Reference[2] - scanLineStartPoint_Reference[2],
+        0
+      };
+      double scanLineDirectionVectorNorm_Reference = vtkMath::Norm(scanLineDirectionVector_Reference);
+      // The search line starts inside the transducer to detect model/transducer overlap (see TransducerSpatialModelMaxOverlapMm)
+      double searchLineStartPoint_Reference[4] = {0, 0, 0, 1};
+      double scanLineEndPointHomogeneous_Reference[4] = {scanLineEndPoint_Reference[0], scanLineEndPoint_Reference[1], scanLineEndPoint_Reference[2], 1};
+      for (int i = 0; i < 3; i++)
+      {
+        searchLineStartPoint_Reference[i] = scanLineStartPoint_Reference[i] - this->TransducerSpatialModelMaxOverlapMm * scanLineDirectionVector_Reference[i] / scanLineDirectionVectorNorm_Reference;
+      }
+      searchLineLength_Reference[rayIndex] = scanLineDirectionVectorNorm_Reference + this->TransducerSpatialModelMaxOverlapMm;
+
+      double searchLineStartPoint_Model[4] = {0, 0, 0, 1};
+      double scanLineEndPoint_Model[4] = {0, 0, 0, 1};
+      vtkMatrix4x4::MultiplyPoint(referenceToModelMatrix, searchLineStartPoint_Reference, searchLineStartPoint_Model);
+      vtkMatrix4x4::MultiplyPoint(referenceToModelMatrix, scanLineEndPointHomogeneous_Reference, scanLineEndPoint_Model);
+      for (int i = 0; i < 3; i++)
+      {
+        packet.Origin[i][rayIndex] = searchLineStartPoint_Model[i];
+        packet.Direction[i][rayIndex] = scanLineEndPoint_Model[i] - searchLineStartPoint_Model[i];
+      }
+
+      vtkMatrix4x4::MultiplyPoint(referenceToModelMatrix, scanLineDirectionVector_Reference, scanLineDirectionVector_Model[rayIndex]);
+      vtkMath::Normalize(scanLineDirectionVector_Model[rayIndex]);
+    }
+
+    this->ModelBvh->IntersectRayPacket(packet, intersections.RayHits);
+
+    for (int rayIndex = 0; rayIndex < packet.NumberOfRays; rayIndex++)
+    {
+      const std::vector<PlusTriangleBvh::RayHit>& rayHits = intersections.RayHits[rayIndex];
+      // An affine transform does not change the relative position along the line, therefore the distance
+      // in the Reference coordinate system can be computed directly from the ray parameter
+      unsigned int hitIndex = 0;
+      bool scanLineStartPointInsideModel = false;
+      for (; hitIndex < rayHits.size(); hitIndex++)
+      {
+        if (rayHits[hitIndex].T * searchLineLength_Reference[rayIndex] <= this->TransducerSpatialModelMaxOverlapMm)
+        {
+          // there is an intersection point in the search line that is not part of the scanline
+          scanLineStartPointInsideModel = (!scanLineStartPointInsideModel);
+        }
+        else
+        {
+          // we reached the scanline starting point
+          break;
+        }
+      }
+      if (scanLineStartPointInsideModel)
+      {
+        // the scanline starting point is inside the model, so add an intersection point at 0 distance
+        intersections.IntersectionDistanceFromStartPointMm.push_back(0);
+        intersections.IntersectionIncidenceAngleRad.push_back(0);
+      }
+      for (; hitIndex < rayHits.size(); hitIndex++)
+      {
+        intersections.IntersectionDistanceFromStartPointMm.push_back(rayHits[hitIndex].T * searchLineLength_Reference[rayIndex] - this->TransducerSpatialModelMaxOverlapMm);
+        double interpolatedNormal_Model[3] = {0, 0, 0};
+        this->ModelBvh->GetInterpolatedNormal(rayHits[hitIndex], interpolatedNormal_Model);
+        vtkMath::Normalize(interpolatedNormal_Model);
+        double cosIncidenceAngle = std::max(-1.0, std::min(1.0, vtkMath::Dot(interpolatedNormal_Model, scanLineDirectionVector_Model[rayIndex])));
+        intersections.IntersectionIncidenceAngleRad.push_back(acos(cosIncidenceAngle));
+      }
+      intersections.FirstIntersectionIndex[firstLineIndex + rayIndex + 1] = static_cast<int>(intersections.IntersectionDistanceFromStartPointMm.size());
+    }
+  }
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus PlusSpatialModel::UpdateModelFile()
 {
@@ -512,10 +805,7 @@ PlusStatus PlusSpatialModel::UpdateModelFile()
   this->PolyData = polyDataNormalsComputer->GetOutput();
   this->PolyData->Register(NULL);
 
-  this->ModelLocalizer->SetDataSet(this->PolyData);
-  this->ModelLocalizer->SetMaxLevel(24);
-  this->ModelLocalizer->SetNumberOfCellsPerNode(32);
-  this->ModelLocalizer->BuildLocator();
+  BuildModelLocalizer(this->ModelLocalizer, this->PolyData);
 
   return PLUS_SUCCESS;
 }
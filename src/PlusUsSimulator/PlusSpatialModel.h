@@ -7,12 +7,20 @@
 #define __SpatialModel_h
 
 #include <deque>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "vtkPlusUsSimulatorExport.h"
 
+#include "PlusTriangleBvh.h"
+#include "vtkSmartPointer.h"
+
+class vtkGenericCell;
+class vtkIdList;
 class vtkMatrix4x4;
 class vtkModifiedBSPTree;
+class vtkPoints;
 class vtkPolyData;
 
 /*!
@@ -38,6 +46,46 @@ public:
     double IntersectionIncidenceAngleRad;
   };
 
+  /*!
+    Temporary objects used by GetLineIntersections. The same workspace can be reused for many lines to avoid reallocations.
+    GetLineIntersections may be called concurrently from multiple threads if each thread uses its own workspace.
+  */
+  struct vtkPlusUsSimulatorExport LineIntersectionWorkspace
+  {
+    LineIntersectionWorkspace();
+    ~LineIntersectionWorkspace();
+
+    vtkSmartPointer<vtkPoints> IntersectionPoints_Model;
+    vtkSmartPointer<vtkIdList> IntersectionCellIds;
+    vtkSmartPointer<vtkGenericCell> IntersectionCell;
+    vtkSmartPointer<vtkMatrix4x4> ReferenceToModelMatrix;
+    vtkSmartPointer<vtkMatrix4x4> ModelToReferenceMatrix;
+    vtkSmartPointer<vtkMatrix4x4> ObjectToModelMatrix;
+    /*!
+      Cell locator that is only used with this workspace. vtkModifiedBSPTree stores the cell that it tests for intersection
+      in a member variable, therefore a locator cannot be used by multiple threads at the same time.
+      If it is NULL then the locator of the model is used.
+    */
+    vtkSmartPointer<vtkModifiedBSPTree> ModelLocalizer;
+    /*! Surface mesh that ModelLocalizer was built for */
+    vtkSmartPointer<vtkPolyData> ModelLocalizerPolyData;
+    /*! Modification time of the surface mesh when ModelLocalizer was built */
+    vtkMTimeType ModelLocalizerPolyDataMTime;
+  };
+
+  /*!
+    Intersections of multiple lines with the model, stored in plain arrays.
+    Intersections of the i-th line are stored at indices FirstIntersectionIndex[i] ... FirstIntersectionIndex[i+1]-1.
+  */
+  struct LinePacketIntersections
+  {
+    std::vector<int> FirstIntersectionIndex;
+    std::vector<double> IntersectionDistanceFromStartPointMm;
+    std::vector<double> IntersectionIncidenceAngleRad;
+    /*! Temporary storage of the ray-triangle intersections */
+    std::vector<PlusTriangleBvh::RayHit> RayHits[PlusTriangleBvh::MAX_PACKET_SIZE];
+  };
+
   PlusSpatialModel();
   virtual ~PlusSpatialModel();
 
@@ -72,16 +120,54 @@ public:
   */
   void GetLineIntersections(std::deque<LineIntersectionInfo>& lineIntersections, double* scanLineStartPoint_Reference, double* scanLineEndPoint_Reference);
 
-  double GetAcousticImpedanceMegarayls();
+  /*!
+    Same as GetLineIntersections, but all temporary objects are taken from the provided workspace.
+    The model must have been prepared by calling PrepareForScanlineSimulation and the workspace by calling PrepareLineIntersectionWorkspace.
+  */
+  void GetLineIntersections(std::deque<LineIntersectionInfo>& lineIntersections, double* scanLineStartPoint_Reference, double* scanLineEndPoint_Reference, LineIntersectionWorkspace& workspace);
+
+  /*!
+    Load the model file (if needed) and precompute all values that CalculateIntensity needs for scanlines of the specified sampling.
+    After this call GetLineIntersections (with workspace) and CalculateIntensity do not modify the model, so they can be called from multiple threads.
+  */
+  PlusStatus PrepareForScanlineSimulation(double distanceBetweenScanlineSamplePointsMm, unsigned int numberOfSamplesPerScanline);
+
+  /*!
+    Prepare a workspace for computing line intersections with this model.
+    \param useModelLocalizer If true then the workspace uses the cell locator of the model (only one thread may use such workspace at a time),
+      otherwise a separate cell locator is built for the workspace (if it has not been built for the current model surface yet).
+  */
+  void PrepareLineIntersectionWorkspace(LineIntersectionWorkspace& workspace, bool useModelLocalizer);
+
+  /*!
+    Build the bounding volume hierarchy of the model triangles (if it has not been built for the current model surface yet).
+    Must be called before GetLinePacketIntersections, while the model is not used by other threads.
+  */
+  PlusStatus PrepareBoundingVolumeHierarchy();
+
+  /*!
+    Compute the intersections of multiple lines with the model. The result is the same as calling GetLineIntersections for each line,
+    but the lines are traced together in packets through the bounding volume hierarchy of the model triangles.
+    Surface normals are interpolated from the normals stored at the triangle corners.
+    Can be called from multiple threads at the same time if each thread uses its own intersections object.
+    \param numberOfLines Number of lines
+    \param scanLineStartPoints_Reference Line start points (3 values per line)
+    \param scanLineEndPoints_Reference Line end points (3 values per line)
+  */
+  void GetLinePacketIntersections(int numberOfLines, const double* scanLineStartPoints_Reference, const double* scanLineEndPoints_Reference, LinePacketIntersections& intersections);
+
+  double GetAcousticImpedanceMegarayls() const;
 
   /*!
     Computes relative intensities inside the model
     \param incidentIntensity Dimensionless value, if there is 100% reflection at the surface then this
       fraction of the beam intensity would be sensed at the transducer. It includes the effect of attenuation of both incoming and reflected direction.
     \param transmittedIntensity: intensity when the beam leaves the model
+    The model must have been prepared by calling PrepareForScanlineSimulation with the same sample distance and at least numberOfFilledPixels samples.
+    The model is not modified, so it can be called from multiple threads at the same time.
   */
   void CalculateIntensity(std::vector<double>& reflectedIntensity, unsigned int numberOfFilledPixels, double distanceBetweenScanlineSamplePointsMm,
-                          double previousModelAcousticImpedanceMegarayls, double incidentIntensity, double& transmittedIntensity, double incidenceAngleRad);
+                          double previousModelAcousticImpedanceMegarayls, double incidentIntensity, double& transmittedIntensity, double incidenceAngleRad) const;
 
   SetMacro(DensityKgPerM3, double);
   SetMacro(SoundVelocityMPerSec, double);
@@ -101,6 +187,21 @@ protected:
   PlusStatus UpdateModelFile();
   void UpdatePrecomputedAttenuations(double intensityTransmittedFractionPerPixelTwoWay, int numberOfElements);
 
+  /*!
+    Compute all the coefficients of CalculateIntensity that only depend on the material, the imaging frequency and the sample distance,
+    and the attenuation table for at least numberOfSamplesPerScanline samples. Does nothing if they are already up-to-date.
+  */
+  void UpdatePrecomputedIntensityCoefficients(double distanceBetweenScanlineSamplePointsMm, unsigned int numberOfSamplesPerScanline);
+
+  /*! Returns true if the coefficients and the attenuation table of CalculateIntensity are computed for the specified sampling */
+  bool IsPrecomputedIntensityCoefficientsUpToDate(double distanceBetweenScanlineSamplePointsMm, unsigned int numberOfSamplesPerScanline) const;
+
+  /*! Ratio of (transmitted beam intensity / incident beam intensity) after traversing through a single pixel */
+  double GetIntensityAttenuationCoefficientPerPixel(double distanceBetweenScanlineSamplePointsMm);
+
+  /*! Build a cell locator for the surface mesh */
+  static void BuildModelLocalizer(vtkModifiedBSPTree* modelLocalizer, vtkPolyData* polyData);
+
 protected:
   //PlusStatus LoadModel(const std::string& absoluteImagePath);
 
@@ -189,8 +290,37 @@ protected:
   /*! Surface mesh. Points are stored in the Model coordinate system (as in the input file) */
   vtkPolyData* PolyData;
 
+  /*! Bounding volume hierarchy of the model triangles. Shared between the shallow copies of the model. */
+  std::shared_ptr<PlusTriangleBvh> ModelBvh;
+
+  /*! Surface mesh that ModelBvh was built for */
+  vtkSmartPointer<vtkPolyData> ModelBvhPolyData;
+
+  /*! Modification time of the surface mesh when ModelBvh was built */
+  vtkMTimeType ModelBvhPolyDataMTime;
+
   /*! List of attenuations: intensityTransmittedFractionPerPixelTwoWay, intensityTransmittedFractionPerPixelTwoWay^2, intensityTransmittedFractionPerPixelTwoWay^3, ... */
   std::vector<double> PrecomputedAttenuations;
+
+  /*! Coefficients of CalculateIntensity that only change when the material, the imaging frequency or the sample distance changes */
+  struct PrecomputedIntensityCoefficients
+  {
+    PrecomputedIntensityCoefficients();
+    /*! Parameters that the coefficients were computed from */
+    double DistanceBetweenScanlineSamplePointsMm;
+    double ImagingFrequencyMhz;
+    double AttenuationCoefficientDbPerCmMhz;
+    double SurfaceReflectionIntensityDecayDbPerMm;
+    /*! Ratio of (transmitted beam intensity / incident beam intensity) after traversing through a single pixel */
+    double IntensityAttenuationCoefficientPerPixel;
+    /*! Fraction of the intensity that is transmitted through a single pixel, taking into account both propagation directions */
+    double IntensityTransmittedFractionPerPixelTwoWay;
+    double LogIntensityTransmittedFractionPerPixelTwoWay;
+    /*! Decay of the surface reflection intensity in a single pixel */
+    double SurfaceReflectionIntensityDecayPerPixel;
+    double LogSurfaceReflectionIntensityDecayPerPixel;
+  };
+  PrecomputedIntensityCoefficients IntensityCoefficients;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,355 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+
+#include "PlusTriangleBvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "vtkCellArray.h"
+#include "vtkDataArray.h"
+#include "vtkMath.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+
+namespace
+{
+  // Nodes with this many triangles or less are not split further
+  const int MAX_NUMBER_OF_TRIANGLES_PER_LEAF = 4;
+  // Depth of the traversal stack. Nodes are split at the median, so the depth of the tree is about log2(numberOfTriangles).
+  const int MAX_TREE_DEPTH = 60;
+  // Bounding boxes are enlarged by this value (in mm) to make sure that rounding errors do not cause missed intersections
+  const double BOUNDING_BOX_MARGIN_MM = 1e-6;
+
+  //----------------------------------------------------------------------------
+  struct TriangleCentroidLessThan
+  {
+    TriangleCentroidLessThan(const std::vector<double>& centroids, int axis) : Centroids(centroids), Axis(axis) {}
+    bool operator()(int a, int b) const
+    {
+      return this->Centroids[a * 3 + this->Axis] < this->Centroids[b * 3 + this->Axis];
+    }
+    const std::vector<double>& Centroids;
+    int Axis;
+  };
+
+  //----------------------------------------------------------------------------
+  bool RayHitLessThan(const PlusTriangleBvh::RayHit& a, const PlusTriangleBvh::RayHit& b)
+  {
+    return a.T < b.T;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusTriangleBvh::PlusTriangleBvh()
+{
+}
+
+//----------------------------------------------------------------------------
+PlusTriangleBvh::~PlusTriangleBvh()
+{
+}
+
+//----------------------------------------------------------------------------
+int PlusTriangleBvh::GetNumberOfTriangles() const
+{
+  return static_cast<int>(this->TriangleVertex0.size() / 3);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusTriangleBvh::Build(vtkPolyData* polyData)
+{
+  this->Nodes.clear();
+  this->TriangleVertex0.clear();
+  this->TriangleEdge1.clear();
+  this->TriangleEdge2.clear();
+  this->TriangleCornerNormals.clear();
+
+  if (polyData == NULL || polyData->GetPoints() == NULL)
+  {
+    LOG_ERROR("PlusTriangleBvh::Build failed: invalid surface mesh");
+    return PLUS_FAIL;
+  }
+
+  vtkPoints* points = polyData->GetPoints();
+  vtkDataArray* normals = (polyData->GetPointData() != NULL) ? polyData->GetPointData()->GetNormals() : NULL;
+
+  // Collect the triangles (corners, edges, corner normals) in the original cell order
+  std::vector<double> vertex0;
+  std::vector<double> edge1;
+  std::vector<double> edge2;
+  std::vector<double> cornerNormals;
+  std::vector<double> triangleCentroids;
+  std::vector<double> triangleBounds;
+  vtkCellArray* polys = polyData->GetPolys();
+  if (polys != NULL)
+  {
+    vtkIdType numberOfPoints = 0;
+    vtkIdType* pointIds = NULL;
+    double corners[3][3];
+    for (polys->InitTraversal(); polys->GetNextCell(numberOfPoints, pointIds);)
+    {
+      if (numberOfPoints != 3)
+      {
+        continue;
+      }
+      for (int cornerIndex = 0; cornerIndex < 3; cornerIndex++)
+      {
+        points->GetPoint(pointIds[cornerIndex], corners[cornerIndex]);
+      }
+      double triangleEdge1[3] = { corners[1][0] - corners[0][0], corners[1][1] - corners[0][1], corners[1][2] - corners[0][2] };
+      double triangleEdge2[3] = { corners[2][0] - corners[0][0], corners[2][1] - corners[0][1], corners[2][2] - corners[0][2] };
+      double triangleNormal[3] = { 0, 0, 0 };
+      vtkMath::Cross(triangleEdge1, triangleEdge2, triangleNormal);
+      vtkMath::Normalize(triangleNormal);
+      for (int i = 0; i < 3; i++)
+      {
+        vertex0.push_back(corners[0][i]);
+        edge1.push_back(triangleEdge1[i]);
+        edge2.push_back(triangleEdge2[i]);
+        triangleCentroids.push_back((corners[0][i] + corners[1][i] + corners[2][i]) / 3.0);
+      }
+      for (int i = 0; i < 3; i++)
+      {
+        triangleBounds.push_back(std::min(corners[0][i], std::min(corners[1][i], corners[2][i])));
+        triangleBounds.push_back(std::max(corners[0][i], std::max(corners[1][i], corners[2][i])));
+      }
+      for (int cornerIndex = 0; cornerIndex < 3; cornerIndex++)
+      {
+        double cornerNormal[3] = { triangleNormal[0], triangleNormal[1], triangleNormal[2] };
+        if (normals != NULL)
+        {
+          normals->GetTuple(pointIds[cornerIndex], cornerNormal);
+        }
+        cornerNormals.insert(cornerNormals.end(), cornerNormal, cornerNormal + 3);
+      }
+    }
+  }
+
+  const int numberOfTriangles = static_cast<int>(vertex0.size() / 3);
+  if (numberOfTriangles == 0)
+  {
+    LOG_ERROR("PlusTriangleBvh::Build failed: the surface mesh does not contain triangles");
+    return PLUS_FAIL;
+  }
+
+  std::vector<int> triangleOrder(numberOfTriangles);
+  for (int i = 0; i < numberOfTriangles; i++)
+  {
+    triangleOrder[i] = i;
+  }
+  this->Nodes.reserve(2 * (numberOfTriangles / MAX_NUMBER_OF_TRIANGLES_PER_LEAF + 1));
+  BuildNode(triangleOrder, 0, numberOfTriangles, triangleCentroids, triangleBounds, 0);
+
+  // Store triangle data in the order of the leaves, so that triangles of a leaf are next to each other in memory
+  this->TriangleVertex0.resize(numberOfTriangles * 3);
+  this->TriangleEdge1.resize(numberOfTriangles * 3);
+  this->TriangleEdge2.resize(numberOfTriangles * 3);
+  this->TriangleCornerNormals.resize(numberOfTriangles * 9);
+  for (int i = 0; i < numberOfTriangles; i++)
+  {
+    const int originalIndex = triangleOrder[i];
+    std::copy(vertex0.begin() + originalIndex * 3, vertex0.begin() + originalIndex * 3 + 3, this->TriangleVertex0.begin() + i * 3);
+    std::copy(edge1.begin() + originalIndex * 3, edge1.begin() + originalIndex * 3 + 3, this->TriangleEdge1.begin() + i * 3);
+    std::copy(edge2.begin() + originalIndex * 3, edge2.begin() + originalIndex * 3 + 3, this->TriangleEdge2.begin() + i * 3);
+    std::copy(cornerNormals.begin() + originalIndex * 9, cornerNormals.begin() + originalIndex * 9 + 9, this->TriangleCornerNormals.begin() + i * 9);
+  }
+
+  LOG_DEBUG("Bounding volume hierarchy is built: " << numberOfTriangles << " triangles, " << this->Nodes.size() << " nodes");
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+int PlusTriangleBvh::BuildNode(std::vector<int>& triangleOrder, int first, int count, const std::vector<double>& triangleCentroids, const std::vector<double>& triangleBounds, int depth)
+{
+  const int nodeIndex = static_cast<int>(this->Nodes.size());
+  this->Nodes.push_back(Node());
+
+  // Compute bounding box of the triangles and of their centroids
+  double boundsMin[3] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, VTK_DOUBLE_MAX };
+  double boundsMax[3] = { -VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX };
+  double centroidMin[3] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, VTK_DOUBLE_MAX };
+  double centroidMax[3] = { -VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX };
+  for (int i = first; i < first + count; i++)
+  {
+    const int triangleIndex = triangleOrder[i];
+    for (int axis = 0; axis < 3; axis++)
+    {
+      boundsMin[axis] = std::min(boundsMin[axis], triangleBounds[triangleIndex * 6 + axis * 2]);
+      boundsMax[axis] = std::max(boundsMax[axis], triangleBounds[triangleIndex * 6 + axis * 2 + 1]);
+      centroidMin[axis] = std::min(centroidMin[axis], triangleCentroids[triangleIndex * 3 + axis]);
+      centroidMax[axis] = std::max(centroidMax[axis], triangleCentroids[triangleIndex * 3 + axis]);
+    }
+  }
+  for (int axis = 0; axis < 3; axis++)
+  {
+    this->Nodes[nodeIndex].BoundsMin[axis] = boundsMin[axis] - BOUNDING_BOX_MARGIN_MM;
+    this->Nodes[nodeIndex].BoundsMax[axis] = boundsMax[axis] + BOUNDING_BOX_MARGIN_MM;
+  }
+
+  if (count <= MAX_NUMBER_OF_TRIANGLES_PER_LEAF || depth >= MAX_TREE_DEPTH - 1)
+  {
+    this->Nodes[nodeIndex].FirstTriangleIndex = first;
+    this->Nodes[nodeIndex].NumberOfTriangles = count;
+    this->Nodes[nodeIndex].SecondChildIndex = -1;
+    return nodeIndex;
+  }
+
+  // Split at the median of the centroids along the longest axis
+  int splitAxis = 0;
+  for (int axis = 1; axis < 3; axis++)
+  {
+    if (centroidMax[axis] - centroidMin[axis] > centroidMax[splitAxis] - centroidMin[splitAxis])
+    {
+      splitAxis = axis;
+    }
+  }
+  const int firstChildCount = count / 2;
+  std::nth_element(triangleOrder.begin() + first, triangleOrder.begin() + first + firstChildCount, triangleOrder.begin() + first + count,
+                   TriangleCentroidLessThan(triangleCentroids, splitAxis));
+
+  this->Nodes[nodeIndex].FirstTriangleIndex = -1;
+  this->Nodes[nodeIndex].NumberOfTriangles = 0;
+  BuildNode(triangleOrder, first, firstChildCount, triangleCentroids, triangleBounds, depth + 1);
+  // Nodes vector may be reallocated by the recursive calls, so the node is not referenced by a pointer
+  int secondChildIndex = BuildNode(triangleOrder, first + firstChildCount, count - firstChildCount, triangleCentroids, triangleBounds, depth + 1);
+  this->Nodes[nodeIndex].SecondChildIndex = secondChildIndex;
+  return nodeIndex;
+}
+
+//----------------------------------------------------------------------------
+void PlusTriangleBvh::IntersectRayPacket(const RayPacket& packet, std::vector<RayHit> hits[MAX_PACKET_SIZE]) const
+{
+  const int numberOfRays = std::min(packet.NumberOfRays, static_cast<int>(MAX_PACKET_SIZE));
+  for (int rayIndex = 0; rayIndex < numberOfRays; rayIndex++)
+  {
+    hits[rayIndex].clear();
+  }
+  if (this->Nodes.empty() || numberOfRays < 1)
+  {
+    return;
+  }
+
+  // Inverse of the ray directions for the bounding box tests. Division by zero results in infinity, which is handled by the slab test.
+  double inverseDirection[3][MAX_PACKET_SIZE];
+  for (int axis = 0; axis < 3; axis++)
+  {
+    for (int rayIndex = 0; rayIndex < numberOfRays; rayIndex++)
+    {
+      inverseDirection[axis][rayIndex] = 1.0 / packet.Direction[axis][rayIndex];
+    }
+  }
+
+  int nodeStack[MAX_TREE_DEPTH + 1];
+  int nodeStackSize = 0;
+  nodeStack[nodeStackSize++] = 0;
+  while (nodeStackSize > 0)
+  {
+    const int nodeIndex = nodeStack[--nodeStackSize];
+    const Node& node = this->Nodes[nodeIndex];
+
+    // Slab test of the bounding box with all the rays of the packet.
+    // fmin/fmax ignore NaN values (0*inf when the ray lies in the plane of a slab), which makes the test conservative.
+    bool rayHitsNode[MAX_PACKET_SIZE];
+    bool anyRayHitsNode = false;
+    for (int rayIndex = 0; rayIndex < numberOfRays; rayIndex++)
+    {
+      double tMin = 0.0;
+      double tMax = 1.0;
+      for (int axis = 0; axis < 3; axis++)
+      {
+        double t1 = (node.BoundsMin[axis] - packet.Origin[axis][rayIndex]) * inverseDirection[axis][rayIndex];
+        double t2 = (node.BoundsMax[axis] - packet.Origin[axis][rayIndex]) * inverseDirection[axis][rayIndex];
+        tMin = std::fmax(tMin, std::fmin(t1, t2));
+        tMax = std::fmin(tMax, std::fmax(t1, t2));
+      }
+      rayHitsNode[rayIndex] = (tMin <= tMax);
+      anyRayHitsNode |= rayHitsNode[rayIndex];
+    }
+    if (!anyRayHitsNode)
+    {
+      continue;
+    }
+
+    if (node.NumberOfTriangles == 0)
+    {
+      // internal node
+      nodeStack[nodeStackSize++] = node.SecondChildIndex;
+      nodeStack[nodeStackSize++] = nodeIndex + 1;
+      continue;
+    }
+
+    // Leaf node: Moller-Trumbore ray-triangle test for all the rays of the packet
+    for (int triangleIndex = node.FirstTriangleIndex; triangleIndex < node.FirstTriangleIndex + node.NumberOfTriangles; triangleIndex++)
+    {
+      const double* v0 = &this->TriangleVertex0[triangleIndex * 3];
+      const double* e1 = &this->TriangleEdge1[triangleIndex * 3];
+      const double* e2 = &this->TriangleEdge2[triangleIndex * 3];
+      double hitT[MAX_PACKET_SIZE];
+      double hitU[MAX_PACKET_SIZE];
+      double hitV[MAX_PACKET_SIZE];
+      bool hit[MAX_PACKET_SIZE];
+      for (int rayIndex = 0; rayIndex < numberOfRays; rayIndex++)
+      {
+        const double dx = packet.Direction[0][rayIndex];
+        const double dy = packet.Direction[1][rayIndex];
+        const double dz = packet.Direction[2][rayIndex];
+        // p = direction x e2
+        const double px = dy * e2[2] - dz * e2[1];
+        const double py = dz * e2[0] - dx * e2[2];
+        const double pz = dx * e2[1] - dy * e2[0];
+        const double determinant = e1[0] * px + e1[1] * py + e1[2] * pz;
+        const double inverseDeterminant = (determinant != 0.0) ? 1.0 / determinant : 0.0;
+        // s = origin - v0
+        const double sx = packet.Origin[0][rayIndex] - v0[0];
+        const double sy = packet.Origin[1][rayIndex] - v0[1];
+        const double sz = packet.Origin[2][rayIndex] - v0[2];
+        const double u = (sx * px + sy * py + sz * pz) * inverseDeterminant;
+        // q = s x e1
+        const double qx = sy * e1[2] - sz * e1[1];
+        const double qy = sz * e1[0] - sx * e1[2];
+        const double qz = sx * e1[1] - sy * e1[0];
+        const double v = (dx * qx + dy * qy + dz * qz) * inverseDeterminant;
+        const double t = (e2[0] * qx + e2[1] * qy + e2[2] * qz) * inverseDeterminant;
+        hitT[rayIndex] = t;
+        hitU[rayIndex] = u;
+        hitV[rayIndex] = v;
+        hit[rayIndex] = rayHitsNode[rayIndex] && (determinant != 0.0) && (u >= 0.0) && (v >= 0.0) && (u + v <= 1.0) && (t >= 0.0) && (t <= 1.0);
+      }
+      for (int rayIndex = 0; rayIndex < numberOfRays; rayIndex++)
+      {
+        if (hit[rayIndex])
+        {
+          RayHit rayHit;
+          rayHit.T = hitT[rayIndex];
+          rayHit.U = hitU[rayIndex];
+          rayHit.V = hitV[rayIndex];
+          rayHit.TriangleIndex = triangleIndex;
+          hits[rayIndex].push_back(rayHit);
+        }
+      }
+    }
+  }
+
+  for (int rayIndex = 0; rayIndex < numberOfRays; rayIndex++)
+  {
+    std::sort(hits[rayIndex].begin(), hits[rayIndex].end(), RayHitLessThan);
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusTriangleBvh::GetInterpolatedNormal(const RayHit& hit, double normal[3]) const
+{
+  const double* cornerNormals = &this->TriangleCornerNormals[hit.TriangleIndex * 9];
+  const double w0 = 1.0 - hit.U - hit.V;
+  for (int i = 0; i < 3; i++)
+  {
+    normal[i] = w0 * cornerNormals[i] + hit.U * cornerNormals[3 + i] + hit.V * cornerNormals[6 + i];
+  }
+}
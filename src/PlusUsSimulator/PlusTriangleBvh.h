@@ -0,0 +1,106 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusTriangleBvh_h
+#define __PlusTriangleBvh_h
+
+#include <vector>
+
+#include "vtkPlusUsSimulatorExport.h"
+
+class vtkPolyData;
+
+/*!
+  \class PlusTriangleBvh
+  \brief Bounding volume hierarchy of the triangles of a surface mesh for computing intersections with packets of rays
+
+  The hierarchy is stored in a flat node array and all triangle data (vertices, edges, corner normals) is copied into
+  plain arrays in the order of the leaf nodes, so no VTK objects are accessed during intersection computation.
+  Rays are processed in packets of up to MAX_PACKET_SIZE rays: a node is visited once for the whole packet if any of the rays
+  hits its bounding box. Ray data is stored in structure-of-arrays layout and the box and triangle tests loop over the rays of the
+  packet, so that the compiler can vectorize them.
+
+  After Build() the object is not modified anymore, therefore IntersectRayPacket can be called from multiple threads.
+
+  \ingroup PlusLibUsSimulatorAlgo
+*/
+class vtkPlusUsSimulatorExport PlusTriangleBvh
+{
+public:
+  /*! Maximum number of rays that are traced together */
+  static const int MAX_PACKET_SIZE = 8;
+
+  /*! Intersection of a ray and a triangle */
+  struct RayHit
+  {
+    /*! Position of the intersection along the ray: 0 at the ray origin, 1 at the ray end point */
+    double T;
+    /*! Barycentric coordinate of the intersection point (weight of the second triangle corner) */
+    double U;
+    /*! Barycentric coordinate of the intersection point (weight of the third triangle corner) */
+    double V;
+    /*! Index of the intersected triangle (in the internal triangle order) */
+    int TriangleIndex;
+  };
+
+  /*! Rays in structure-of-arrays layout. Each ray is a line segment from Origin to Origin+Direction. */
+  struct RayPacket
+  {
+    int NumberOfRays;
+    double Origin[3][MAX_PACKET_SIZE];
+    double Direction[3][MAX_PACKET_SIZE];
+  };
+
+  PlusTriangleBvh();
+  virtual ~PlusTriangleBvh();
+
+  /*!
+    Build the hierarchy from the triangles of the surface mesh. Other cell types are ignored.
+    If the mesh has point normals then they are stored at the triangle corners, otherwise the triangle normal is used at each corner.
+  */
+  PlusStatus Build(vtkPolyData* polyData);
+
+  /*!
+    Compute all intersections of each ray of the packet with the triangles.
+    Intersections of the i-th ray are returned in hits[i], sorted by increasing distance from the ray origin.
+  */
+  void IntersectRayPacket(const RayPacket& packet, std::vector<RayHit> hits[MAX_PACKET_SIZE]) const;
+
+  /*! Get the surface normal at an intersection point, interpolated from the normals at the triangle corners. The result is not normalized. */
+  void GetInterpolatedNormal(const RayHit& hit, double normal[3]) const;
+
+  int GetNumberOfTriangles() const;
+
+protected:
+  /*! Node of the hierarchy. The first child of an internal node is stored right after the node. */
+  struct Node
+  {
+    double BoundsMin[3];
+    double BoundsMax[3];
+    /*! Index of the first triangle of a leaf node */
+    int FirstTriangleIndex;
+    /*! Number of triangles of a leaf node, 0 for internal nodes */
+    int NumberOfTriangles;
+    /*! Index of the second child of an internal node */
+    int SecondChildIndex;
+  };
+
+  /*! Create node for the triangles triangleOrder[first] ... triangleOrder[first+count-1] and all its children. Returns the node index. */
+  int BuildNode(std::vector<int>& triangleOrder, int first, int count, const std::vector<double>& triangleCentroids, const std::vector<double>& triangleBounds, int depth);
+
+  std::vector<Node> Nodes;
+
+  /*! First corner of each triangle (3 values per triangle) */
+  std::vector<double> TriangleVertex0;
+  /*! Second corner minus first corner (3 values per triangle) */
+  std::vector<double> TriangleEdge1;
+  /*! Third corner minus first corner (3 values per triangle) */
+  std::vector<double> TriangleEdge2;
+  /*! Normals at the three corners of each triangle (9 values per triangle) */
+  std::vector<double> TriangleCornerNormals;
+};
+
+#endif
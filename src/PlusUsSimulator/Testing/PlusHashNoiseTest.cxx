@@ -0,0 +1,158 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusHashNoiseTest.cxx
+  \brief This test checks that PlusHashNoise is reproducible, depends on the seed, stays within the amplitude
+  and that evaluating along a line gives the same values as evaluating each point. Speed is compared to vtkPerlinNoise.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusHashNoise.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkPerlinNoise.h"
+#include "vtkSmartPointer.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <algorithm>
+#include <iostream>
+#include <stdlib.h>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////
+const int NUMBER_OF_SAMPLES = 200000;
+const double AMPLITUDE = 20.0;
+const double FREQUENCY[3] = {0.8, 1.1, 0.5};
+const double PHASE[3] = {0.3, 0.0, 1.7};
+// Line along which the noise is sampled (mm), similarly to a scanline
+const double START_POSITION[3] = {-12.3, 4.5, 30.1};
+const double STEP[3] = {0.021, 0.047, -0.013};
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments cmdargs;
+  cmdargs.Initialize(argc, argv);
+  cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!cmdargs.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << cmdargs.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfFailures = 0;
+
+  PlusHashNoise noise;
+  noise.SetSeed(12345);
+  noise.SetAmplitude(AMPLITUDE);
+  noise.SetFrequency(FREQUENCY);
+  noise.SetPhase(PHASE);
+
+  std::vector<double> lineNoise(NUMBER_OF_SAMPLES);
+  double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  noise.EvaluateLine(START_POSITION, STEP, NUMBER_OF_SAMPLES, &lineNoise[0]);
+  double hashNoiseTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+  // Same noise must be generated by the same seed, both along a line and point by point
+  PlusHashNoise sameSeedNoise(noise);
+  std::vector<double> sameSeedLineNoise(NUMBER_OF_SAMPLES);
+  sameSeedNoise.EvaluateLine(START_POSITION, STEP, NUMBER_OF_SAMPLES, &sameSeedLineNoise[0]);
+  int numberOfPointMismatches = 0;
+  double sum = 0;
+  double minValue = lineNoise[0];
+  double maxValue = lineNoise[0];
+  for (int sampleIndex = 0; sampleIndex < NUMBER_OF_SAMPLES; sampleIndex++)
+  {
+    double position[3] = {0, 0, 0};
+    for (int i = 0; i < 3; i++)
+    {
+      position[i] = START_POSITION[i] + sampleIndex * STEP[i];
+    }
+    if (lineNoise[sampleIndex] != sameSeedLineNoise[sampleIndex] || lineNoise[sampleIndex] != noise.Evaluate(position))
+    {
+      numberOfPointMismatches++;
+    }
+    sum += lineNoise[sampleIndex];
+    minValue = std::min(minValue, lineNoise[sampleIndex]);
+    maxValue = std::max(maxValue, lineNoise[sampleIndex]);
+  }
+  if (numberOfPointMismatches > 0)
+  {
+    LOG_ERROR("Noise is not reproducible: " << numberOfPointMismatches << " samples differ");
+    numberOfFailures++;
+  }
+  double mean = sum / NUMBER_OF_SAMPLES;
+  LOG_INFO("Noise range: " << minValue << " .. " << maxValue << ", mean: " << mean);
+  if (minValue < -AMPLITUDE || maxValue > AMPLITUDE)
+  {
+    LOG_ERROR("Noise is out of the -amplitude..amplitude range: " << minValue << " .. " << maxValue);
+    numberOfFailures++;
+  }
+  if (maxValue - minValue < AMPLITUDE)
+  {
+    LOG_ERROR("Noise range is too small: " << minValue << " .. " << maxValue);
+    numberOfFailures++;
+  }
+  if (fabs(mean) > 0.1 * AMPLITUDE)
+  {
+    LOG_ERROR("Noise mean is too far from zero: " << mean);
+    numberOfFailures++;
+  }
+
+  // A different seed must generate a different pattern
+  PlusHashNoise otherSeedNoise(noise);
+  otherSeedNoise.SetSeed(noise.GetSeed() + 1);
+  std::vector<double> otherSeedLineNoise(NUMBER_OF_SAMPLES);
+  otherSeedNoise.EvaluateLine(START_POSITION, STEP, NUMBER_OF_SAMPLES, &otherSeedLineNoise[0]);
+  int numberOfEqualSamples = 0;
+  for (int sampleIndex = 0; sampleIndex < NUMBER_OF_SAMPLES; sampleIndex++)
+  {
+    if (lineNoise[sampleIndex] == otherSeedLineNoise[sampleIndex])
+    {
+      numberOfEqualSamples++;
+    }
+  }
+  if (numberOfEqualSamples > NUMBER_OF_SAMPLES / 100)
+  {
+    LOG_ERROR("Noise does not depend on the seed: " << numberOfEqualSamples << " samples are the same");
+    numberOfFailures++;
+  }
+
+  // Reference: Perlin noise, evaluated point by point
+  vtkSmartPointer<vtkPerlinNoise> perlinNoise = vtkSmartPointer<vtkPerlinNoise>::New();
+  perlinNoise->SetAmplitude(AMPLITUDE);
+  perlinNoise->SetFrequency(FREQUENCY[0], FREQUENCY[1], FREQUENCY[2]);
+  perlinNoise->SetPhase(PHASE[0], PHASE[1], PHASE[2]);
+  double perlinSum = 0;
+  startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  for (int sampleIndex = 0; sampleIndex < NUMBER_OF_SAMPLES; sampleIndex++)
+  {
+    double position[3] = {0, 0, 0};
+    for (int i = 0; i < 3; i++)
+    {
+      position[i] = START_POSITION[i] + sampleIndex * STEP[i];
+    }
+    perlinSum += perlinNoise->EvaluateFunction(position);
+  }
+  double perlinNoiseTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+  LOG_INFO(NUMBER_OF_SAMPLES << " samples: hash noise " << hashNoiseTimeSec * 1000.0 << " ms, Perlin noise " << perlinNoiseTimeSec * 1000.0
+           << " ms (mean " << perlinSum / NUMBER_OF_SAMPLES << ")");
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Number of failures: " << numberOfFailures);
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Exit success!!!" << std::endl;
+  return EXIT_SUCCESS;
+}
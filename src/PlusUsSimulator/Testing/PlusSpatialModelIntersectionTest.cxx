@@ -0,0 +1,216 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusSpatialModelIntersectionTest.cxx
+  \brief This test computes intersections of many lines with a surface model using both the BSP tree (reference implementation)
+  and the bounding volume hierarchy of PlusSpatialModel and checks that the intersection distances and incidence angles are the same
+*/
+
+#include "PlusConfigure.h"
+#include "PlusSpatialModel.h"
+#include "vtkAppendPolyData.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkMath.h"
+#include "vtkMatrix4x4.h"
+#include "vtkMinimalStandardRandomSequence.h"
+#include "vtkSTLWriter.h"
+#include "vtkSmartPointer.h"
+#include "vtkSphereSource.h"
+#include "vtkTransform.h"
+#include "vtkXMLDataElement.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+
+///////////////////////////////////////////////////////////////////
+const double DISTANCE_TOLERANCE_MM = 1e-6;
+const double ANGLE_TOLERANCE_RAD = 1e-5;
+const int NUMBER_OF_LINES = 2000;
+
+// Model to object transform: rotation around the Y axis combined with anisotropic scaling and translation
+const char* MODEL_TO_OBJECT_TRANSFORM = "0.8 0 0.6 5  0 1.5 0 -3  -0.6 0 0.8 2  0 0 0 1";
+
+//-----------------------------------------------------------------------------
+void GetRandomPointOnSphere(vtkMinimalStandardRandomSequence* random, double radius, double point[3])
+{
+  double norm = 0;
+  do
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      random->Next();
+      point[i] = random->GetRangeValue(-1, 1);
+    }
+    norm = vtkMath::Norm(point);
+  }
+  while (norm < 0.1 || norm > 1.0);
+  for (int i = 0; i < 3; i++)
+  {
+    point[i] *= radius / norm;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments cmdargs;
+  cmdargs.Initialize(argc, argv);
+  cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!cmdargs.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << cmdargs.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  // Create a surface model of two concentric spheres, so that lines have multiple intersections with the model
+  vtkSmartPointer<vtkSphereSource> outerSphere = vtkSmartPointer<vtkSphereSource>::New();
+  outerSphere->SetRadius(20);
+  outerSphere->SetThetaResolution(48);
+  outerSphere->SetPhiResolution(48);
+  vtkSmartPointer<vtkSphereSource> innerSphere = vtkSmartPointer<vtkSphereSource>::New();
+  innerSphere->SetRadius(8);
+  innerSphere->SetCenter(3, -2, 1);
+  innerSphere->SetThetaResolution(24);
+  innerSphere->SetPhiResolution(24);
+  vtkSmartPointer<vtkAppendPolyData> appender = vtkSmartPointer<vtkAppendPolyData>::New();
+  appender->AddInputConnection(outerSphere->GetOutputPort());
+  appender->AddInputConnection(innerSphere->GetOutputPort());
+  std::string modelFilePath = vtkPlusConfig::GetInstance()->GetOutputPath("PlusSpatialModelIntersectionTestModel.stl");
+  vtkSmartPointer<vtkSTLWriter> modelWriter = vtkSmartPointer<vtkSTLWriter>::New();
+  modelWriter->SetFileName(modelFilePath.c_str());
+  modelWriter->SetInputConnection(appender->GetOutputPort());
+  modelWriter->Write();
+
+  vtkSmartPointer<vtkXMLDataElement> spatialModelElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  spatialModelElement->SetName("SpatialModel");
+  spatialModelElement->SetAttribute("Name", "Spheres");
+  spatialModelElement->SetAttribute("ModelFile", modelFilePath.c_str());
+  spatialModelElement->SetAttribute("ModelToObjectTransform", MODEL_TO_OBJECT_TRANSFORM);
+  PlusSpatialModel spatialModel;
+  if (spatialModel.ReadConfiguration(spatialModelElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read spatial model configuration");
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkTransform> referenceToObjectTransform = vtkSmartPointer<vtkTransform>::New();
+  referenceToObjectTransform->Translate(-4, 7, 12);
+  referenceToObjectTransform->RotateWXYZ(35, 0.2, 0.7, 0.4);
+  spatialModel.SetReferenceToObjectTransform(referenceToObjectTransform->GetMatrix());
+
+  if (spatialModel.PrepareForScanlineSimulation(0.1, 1000) != PLUS_SUCCESS || spatialModel.PrepareBoundingVolumeHierarchy() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to prepare the spatial model");
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Lines are generated in the Model coordinate system, so that most of them intersect the spheres, then transformed to the Reference coordinate system
+  vtkSmartPointer<vtkMatrix4x4> modelToObjectMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  std::istringstream modelToObjectStream(MODEL_TO_OBJECT_TRANSFORM);
+  for (int i = 0; i < 16; i++)
+  {
+    modelToObjectStream >> modelToObjectMatrix->Element[i / 4][i % 4];
+  }
+  vtkSmartPointer<vtkMatrix4x4> objectToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkMatrix4x4::Invert(referenceToObjectTransform->GetMatrix(), objectToReferenceMatrix);
+  vtkSmartPointer<vtkMatrix4x4> modelToReferenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkMatrix4x4::Multiply4x4(objectToReferenceMatrix, modelToObjectMatrix, modelToReferenceMatrix);
+
+  vtkSmartPointer<vtkMinimalStandardRandomSequence> random = vtkSmartPointer<vtkMinimalStandardRandomSequence>::New();
+  random->SetSeed(183495439); // Just some random number was chosen as seed
+  std::vector<double> lineStartPoints_Reference(NUMBER_OF_LINES * 3);
+  std::vector<double> lineEndPoints_Reference(NUMBER_OF_LINES * 3);
+  for (int lineIndex = 0; lineIndex < NUMBER_OF_LINES; lineIndex++)
+  {
+    double lineStartPoint_Model[4] = {0, 0, 0, 1};
+    double lineEndPoint_Model[4] = {0, 0, 0, 1};
+    // Every 4th line starts inside the outer sphere to test model/transducer overlap
+    GetRandomPointOnSphere(random, (lineIndex % 4 == 0) ? 18 : 40, lineStartPoint_Model);
+    GetRandomPointOnSphere(random, 40, lineEndPoint_Model);
+    double lineStartPoint_Reference[4] = {0, 0, 0, 1};
+    double lineEndPoint_Reference[4] = {0, 0, 0, 1};
+    modelToReferenceMatrix->MultiplyPoint(lineStartPoint_Model, lineStartPoint_Reference);
+    modelToReferenceMatrix->MultiplyPoint(lineEndPoint_Model, lineEndPoint_Reference);
+    std::copy(lineStartPoint_Reference, lineStartPoint_Reference + 3, lineStartPoints_Reference.begin() + lineIndex * 3);
+    std::copy(lineEndPoint_Reference, lineEndPoint_Reference + 3, lineEndPoints_Reference.begin() + lineIndex * 3);
+  }
+
+  // Reference implementation
+  std::vector< std::deque<PlusSpatialModel::LineIntersectionInfo> > bspIntersections(NUMBER_OF_LINES);
+  PlusSpatialModel::LineIntersectionWorkspace workspace;
+  spatialModel.PrepareLineIntersectionWorkspace(workspace, true);
+  double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  for (int lineIndex = 0; lineIndex < NUMBER_OF_LINES; lineIndex++)
+  {
+    spatialModel.GetLineIntersections(bspIntersections[lineIndex], &lineStartPoints_Reference[lineIndex * 3], &lineEndPoints_Reference[lineIndex * 3], workspace);
+  }
+  double bspTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+  // Bounding volume hierarchy
+  PlusSpatialModel::LinePacketIntersections bvhIntersections;
+  startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  spatialModel.GetLinePacketIntersections(NUMBER_OF_LINES, &lineStartPoints_Reference[0], &lineEndPoints_Reference[0], bvhIntersections);
+  double bvhTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+  LOG_INFO(NUMBER_OF_LINES << " lines: BSP tree " << bspTimeSec * 1000.0 << " ms, bounding volume hierarchy " << bvhTimeSec * 1000.0 << " ms");
+
+  int numberOfFailures = 0;
+  int totalNumberOfIntersections = 0;
+  for (int lineIndex = 0; lineIndex < NUMBER_OF_LINES; lineIndex++)
+  {
+    const std::deque<PlusSpatialModel::LineIntersectionInfo>& expected = bspIntersections[lineIndex];
+    const int firstIntersectionIndex = bvhIntersections.FirstIntersectionIndex[lineIndex];
+    const int numberOfIntersections = bvhIntersections.FirstIntersectionIndex[lineIndex + 1] - firstIntersectionIndex;
+    totalNumberOfIntersections += numberOfIntersections;
+    if (numberOfIntersections != static_cast<int>(expected.size()))
+    {
+      LOG_ERROR("Line " << lineIndex << ": number of intersections mismatch (BSP tree: " << expected.size() << ", bounding volume hierarchy: " << numberOfIntersections << ")");
+      numberOfFailures++;
+      continue;
+    }
+    for (int i = 0; i < numberOfIntersections; i++)
+    {
+      double distanceMm = bvhIntersections.IntersectionDistanceFromStartPointMm[firstIntersectionIndex + i];
+      double angleRad = bvhIntersections.IntersectionIncidenceAngleRad[firstIntersectionIndex + i];
+      if (fabs(distanceMm - expected[i].IntersectionDistanceFromStartPointMm) > DISTANCE_TOLERANCE_MM
+          || fabs(angleRad - expected[i].IntersectionIncidenceAngleRad) > ANGLE_TOLERANCE_RAD)
+      {
+        LOG_ERROR("Line " << lineIndex << ", intersection " << i << " mismatch: distance " << distanceMm << " vs. " << expected[i].IntersectionDistanceFromStartPointMm
+                  << " mm, incidence angle " << angleRad << " vs. " << expected[i].IntersectionIncidenceAngleRad << " rad");
+        numberOfFailures++;
+      }
+    }
+  }
+  LOG_INFO("Compared " << totalNumberOfIntersections << " intersections");
+
+  if (totalNumberOfIntersections < NUMBER_OF_LINES)
+  {
+    LOG_ERROR("Too few intersections were found, the test lines probably do not intersect the model");
+    numberOfFailures++;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Number of failures: " << numberOfFailures);
+    std::cout << "Exit failure!!!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Exit success!!!" << std::endl;
+  return EXIT_SUCCESS;
+}
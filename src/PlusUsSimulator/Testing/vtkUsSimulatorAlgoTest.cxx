@@ -24,6 +24,7 @@ See License.txt for details.
 #include "vtkXMLImageDataWriter.h"
 #include "vtkXMLUtilities.h"
 #include "vtksys/CommandLineArguments.hxx"
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 
@@ -174,6 +175,9 @@ int main(int argc, char** argv)
   std::string intersectionFile;
   bool showResults = false;
   bool useCompression(true);
+  int numberOfThreads = 0;
+  std::string noiseGenerator;
+  double noiseAmplitude = -1;
 
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
@@ -188,6 +192,9 @@ int main(int argc, char** argv)
   args.AddArgument("--output-us-img-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputUsImageFile, "File name of the generated output ultrasound image");
   args.AddArgument("--output-slice-model-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &intersectionFile, "Name of STL output file containing the model of all the frames (optional)");
   args.AddArgument("--show-results", vtksys::CommandLineArguments::NO_ARGUMENT, &showResults, "Show the simulated image on the screen");
+  args.AddArgument("--number-of-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of threads used for the simulation (0 = number of processors). The result is compared to single-threaded simulation.");
+  args.AddArgument("--noise-generator", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &noiseGenerator, "Noise generator, overrides the value in the config file (PERLIN or HASH, optional)");
+  args.AddArgument("--noise-amplitude", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &noiseAmplitude, "Noise amplitude, overrides the value in the config file (optional)");
 
   // Input arguments error checking
   if (!args.Parse())
@@ -221,6 +228,17 @@ int main(int argc, char** argv)
     exit(EXIT_FAILURE);
   }
 
+  vtkPlusUsSimulatorAlgo::NoiseGeneratorType noiseGeneratorType = vtkPlusUsSimulatorAlgo::NOISE_GENERATOR_PERLIN;
+  if (igsioCommon::IsEqualInsensitive(noiseGenerator, "HASH"))
+  {
+    noiseGeneratorType = vtkPlusUsSimulatorAlgo::NOISE_GENERATOR_HASH;
+  }
+  else if (!noiseGenerator.empty() && !igsioCommon::IsEqualInsensitive(noiseGenerator, "PERLIN"))
+  {
+    std::cerr << "Invalid --noise-generator value: " << noiseGenerator << " (PERLIN or HASH is expected)" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
   // Read transformations data
   LOG_DEBUG("Reading input meta file...");
   vtkSmartPointer< vtkIGSIOTrackedFrameList > trackedFrameList = vtkSmartPointer< vtkIGSIOTrackedFrameList >::New();
@@ -260,6 +278,35 @@ int main(int argc, char** argv)
     exit(EXIT_FAILURE);
   }
   usSimulator->SetTransformRepository(transformRepository);
+  usSimulator->SetNumberOfThreads(numberOfThreads);
+  if (!noiseGenerator.empty())
+  {
+    usSimulator->SetNoiseGenerator(noiseGeneratorType);
+  }
+  if (noiseAmplitude >= 0)
+  {
+    usSimulator->SetNoiseAmplitude(noiseAmplitude);
+  }
+
+  // Single-threaded simulator without reusing results of previous frames, used as reference for the multi-threaded simulation
+  vtkSmartPointer<vtkPlusUsSimulatorAlgo> singleThreadedUsSimulator = vtkSmartPointer<vtkPlusUsSimulatorAlgo>::New();
+  if (singleThreadedUsSimulator->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read US simulator configuration!");
+    exit(EXIT_FAILURE);
+  }
+  singleThreadedUsSimulator->SetTransformRepository(transformRepository);
+  singleThreadedUsSimulator->SetNumberOfThreads(1);
+  singleThreadedUsSimulator->PoseCachingOff();
+  if (!noiseGenerator.empty())
+  {
+    singleThreadedUsSimulator->SetNoiseGenerator(noiseGeneratorType);
+  }
+  if (noiseAmplitude >= 0)
+  {
+    singleThreadedUsSimulator->SetNoiseAmplitude(noiseAmplitude);
+  }
+
   igsioTransformName imageToReferenceTransformName(usSimulator->GetImageCoordinateFrame(), usSimulator->GetReferenceCoordinateFrame());
 
   // Write slice model file
@@ -279,6 +326,9 @@ int main(int argc, char** argv)
   }
 
   std::vector<double> timeElapsedPerFrameSec;
+  std::vector<double> singleThreadedTimeElapsedPerFrameSec;
+  int numberOfMismatchingFrames = 0;
+  vtkSmartPointer<vtkImageData> previousSimOutput = vtkSmartPointer<vtkImageData>::New();
   double startTimeSec = 0;
   double endTimeSec = 0;
 
@@ -304,6 +354,41 @@ int main(int argc, char** argv)
     usSimulator->Update();
     vtkImageData* simOutput = usSimulator->GetOutput();
 
+    endTimeSec = vtkTimerLog::GetUniversalTime();
+    timeElapsedPerFrameSec.push_back(endTimeSec - startTimeSec);
+
+    // Simulate the same frame with a single thread, the result must be exactly the same
+    startTimeSec = vtkTimerLog::GetUniversalTime();
+    singleThreadedUsSimulator->Modified();
+    singleThreadedUsSimulator->Update();
+    vtkImageData* singleThreadedSimOutput = singleThreadedUsSimulator->GetOutput();
+    endTimeSec = vtkTimerLog::GetUniversalTime();
+    singleThreadedTimeElapsedPerFrameSec.push_back(endTimeSec - startTimeSec);
+
+    int* simOutputDimensions = simOutput->GetDimensions();
+    int* singleThreadedSimOutputDimensions = singleThreadedSimOutput->GetDimensions();
+    if (simOutputDimensions[0] != singleThreadedSimOutputDimensions[0] || simOutputDimensions[1] != singleThreadedSimOutputDimensions[1]
+        || simOutputDimensions[2] != singleThreadedSimOutputDimensions[2]
+        || memcmp(simOutput->GetScalarPointer(), singleThreadedSimOutput->GetScalarPointer(),
+                  simOutput->GetNumberOfPoints() * simOutput->GetScalarSize() * simOutput->GetNumberOfScalarComponents()) != 0)
+    {
+      LOG_ERROR("Multi-threaded simulation result differs from the single-threaded result in frame " << i);
+      numberOfMismatchingFrames++;
+    }
+
+    // Simulate the same frame again (as if the probe was parked), the previous image must be returned without simulating any scanlines
+    previousSimOutput->DeepCopy(simOutput);
+    usSimulator->Modified();
+    usSimulator->Update();
+    simOutput = usSimulator->GetOutput();
+    if (usSimulator->GetNumberOfSimulatedScanlines() != 0
+        || memcmp(simOutput->GetScalarPointer(), previousSimOutput->GetScalarPointer(),
+                  simOutput->GetNumberOfPoints() * simOutput->GetScalarSize() * simOutput->GetNumberOfScalarComponents()) != 0)
+    {
+      LOG_ERROR("Simulation result of an unchanged pose was not reused in frame " << i << " (" << usSimulator->GetNumberOfSimulatedScanlines() << " scanlines were simulated)");
+      numberOfMismatchingFrames++;
+    }
+
     igsioVideoFrame* simulatorOutputigsioVideoFrame = new igsioVideoFrame();
     simulatorOutputigsioVideoFrame->DeepCopyFrom(simOutput);
 
@@ -335,9 +420,6 @@ int main(int argc, char** argv)
     {
       ShowImage(simOutput);
     }
-
-    endTimeSec = vtkTimerLog::GetUniversalTime();
-    timeElapsedPerFrameSec.push_back(endTimeSec - startTimeSec);
   }
 
   if (vtkPlusSequenceIO::Write(outputUsImageFile, trackedFrameList, trackedFrameList->GetImageOrientation(), useCompression) != PLUS_SUCCESS)
@@ -350,6 +432,7 @@ int main(int argc, char** argv)
 
   // Remove the first frame from the statistics computation because extra processing is done for the first frame
   timeElapsedPerFrameSec.erase(timeElapsedPerFrameSec.begin());
+  singleThreadedTimeElapsedPerFrameSec.erase(singleThreadedTimeElapsedPerFrameSec.begin());
 
   double meanTimeElapsedPerFrameSec = 0;
   double stdevTimeElapsedPerFrameSec = 0;
@@ -358,5 +441,17 @@ int main(int argc, char** argv)
   LOG_INFO(" Standard dev computation time per frame (sec): " << stdevTimeElapsedPerFrameSec) ;
   LOG_INFO(" Average fps:  " << 1 / meanTimeElapsedPerFrameSec) ;
 
+  double meanSingleThreadedTimeElapsedPerFrameSec = 0;
+  double stdevSingleThreadedTimeElapsedPerFrameSec = 0;
+  igsioMath::ComputeMeanAndStdev(singleThreadedTimeElapsedPerFrameSec, meanSingleThreadedTimeElapsedPerFrameSec, stdevSingleThreadedTimeElapsedPerFrameSec);
+  LOG_INFO(" Average single-threaded computation time per frame (sec): " << meanSingleThreadedTimeElapsedPerFrameSec);
+  LOG_INFO(" Multi-threaded speedup: " << meanSingleThreadedTimeElapsedPerFrameSec / meanTimeElapsedPerFrameSec);
+
+  if (numberOfMismatchingFrames > 0)
+  {
+    LOG_ERROR("Multi-threaded simulation result differs from the single-threaded result in " << numberOfMismatchingFrames << " frames");
+    return EXIT_FAILURE;
+  }
+
   return EXIT_SUCCESS;
 }
@@ -7,6 +7,8 @@ See License.txt for details.
 #include "PlusConfigure.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <list>
 #include <map>
 
@@ -20,6 +22,7 @@ See License.txt for details.
 #include "vtkSmartPointer.h"
 #include "vtkImageStencil.h"
 #include "vtkInformationVector.h"
+#include "vtkMatrix4x4.h"
 #include "vtkImageData.h"
 #include "vtkObjectFactory.h"
 #include "vtkPointData.h"
@@ -28,6 +31,7 @@ See License.txt for details.
 #include "vtkPolyData.h"
 #include "vtksys/SystemTools.hxx"
 
+#include "PlusHashNoise.h"
 #include "vtkPlusRfProcessor.h"
 #include "vtkPlusUsScanConvert.h"
 
@@ -60,6 +64,9 @@ vtkPlusUsSimulatorAlgo::vtkPlusUsSimulatorAlgo()
   this->BrightnessConversionScale = 30;
 
   this->RfProcessor = vtkPlusRfProcessor::New();
+  // The output shares the image buffer of a pooled output of the RF processor. Two pooled outputs are enough
+  // to keep the previous output unchanged while the next frame is generated.
+  this->RfProcessor->SetNumberOfPooledOutputs(2);
 
   this->NoiseAmplitude = 0;
   this->NoiseFrequency[0] = 0;
@@ -68,6 +75,14 @@ vtkPlusUsSimulatorAlgo::vtkPlusUsSimulatorAlgo()
   this->NoisePhase[0] = 0;
   this->NoisePhase[1] = 0;
   this->NoisePhase[2] = 0;
+  this->NoiseGenerator = NOISE_GENERATOR_PERLIN;
+  this->NoiseSeed = 0;
+
+  this->NumberOfThreads = 0;
+  this->LineIntersectionMethod = LINE_INTERSECTION_BSP_TREE;
+  this->PoseCaching = true;
+  this->PoseCacheToleranceMm = 0;
+  this->NumberOfSimulatedScanlines = 0;
 
   // this->TransducerSpatialModel doesn't have to be initialized, as the default parameters of SpatialModel
   // are for soft tissue that should match the transducer material in acoustic impedance
@@ -112,6 +127,87 @@ inline double fastPow(double a, double b)
   return u.d;
 }
 
+//-----------------------------------------------------------------------------
+struct vtkPlusUsSimulatorAlgo::ScanlineSimulationJob
+{
+  vtkPlusUsSimulatorAlgo* Self;
+  /*! Image data containing the scanlines in rows, each thread writes only the rows of the scanlines that it simulates */
+  vtkImageData* ScanLines;
+  /*! Scanline start and end points in the Reference coordinate system, indexed by the scanline index */
+  std::vector<double> ScanLineStartPoints_Reference;
+  std::vector<double> ScanLineEndPoints_Reference;
+  double DistanceBetweenScanlineSamplePointsMm;
+  vtkPerlinNoise* NoiseFunction;
+  PlusHashNoise HashNoiseFunction;
+  /*! Index of the next block of scanlines that is not yet taken by any thread */
+  std::atomic<int> NextScanLineBlockIndex;
+  /*! Set if the simulation of any scanline failed, all threads stop as soon as possible */
+  std::atomic<bool> SimulationFailed;
+  /*! For each scanline: non-zero if it moved in the Reference coordinate system since the previous frame */
+  std::vector<char> ScanLineMoved_Reference;
+  /*! For each model and scanline (index: modelIndex * NumberOfScanlines + scanLineIndex): non-zero if the scanline moved relative to the model */
+  std::vector<char> ScanLineMoved_Object;
+};
+
+namespace
+{
+  // Number of scanlines that a thread takes at once. Small enough to balance the load between threads
+  // (the cost of a scanline depends on the number of intersected models), large enough to keep the synchronization cost low.
+  // Scanlines of a block are traced together when the bounding volume hierarchy is used, therefore it matches the packet size.
+  const int NUMBER_OF_SCANLINES_PER_BLOCK = PlusTriangleBvh::MAX_PACKET_SIZE;
+
+  //-----------------------------------------------------------------------------
+  // Scanlines are compared using their start and end point positions, quantized to a grid of toleranceMm.
+  // Returns true if the key is different from the previous key, which is then replaced by the new key.
+  bool UpdateScanLineKey(const double* startPoint_Reference, const double* endPoint_Reference, vtkMatrix4x4* referenceToObjectMatrix, double toleranceMm, double* previousKey)
+  {
+    double points[6] = {0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < 3; i++)
+    {
+      points[i] = startPoint_Reference[i];
+      points[3 + i] = endPoint_Reference[i];
+    }
+    if (referenceToObjectMatrix != NULL)
+    {
+      for (int i = 0; i < 3; i++)
+      {
+        points[i] = referenceToObjectMatrix->Element[i][0] * startPoint_Reference[0] + referenceToObjectMatrix->Element[i][1] * startPoint_Reference[1]
+                    + referenceToObjectMatrix->Element[i][2] * startPoint_Reference[2] + referenceToObjectMatrix->Element[i][3];
+        points[3 + i] = referenceToObjectMatrix->Element[i][0] * endPoint_Reference[0] + referenceToObjectMatrix->Element[i][1] * endPoint_Reference[1]
+                        + referenceToObjectMatrix->Element[i][2] * endPoint_Reference[2] + referenceToObjectMatrix->Element[i][3];
+      }
+    }
+    bool changed = false;
+    for (int i = 0; i < 6; i++)
+    {
+      double key = (toleranceMm > 0) ? floor(points[i] / toleranceMm + 0.5) : points[i];
+      if (key != previousKey[i])
+      {
+        previousKey[i] = key;
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  //-----------------------------------------------------------------------------
+  // Replace the cached intersections of a scanline with a model by the newly computed ones. Returns true if they are different.
+  bool UpdateCachedIntersections(std::vector<PlusSpatialModel::LineIntersectionInfo>& cachedIntersections, const std::deque<PlusSpatialModel::LineIntersectionInfo>& intersections)
+  {
+    bool changed = (cachedIntersections.size() != intersections.size());
+    for (unsigned int i = 0; !changed && i < intersections.size(); i++)
+    {
+      changed = (cachedIntersections[i].IntersectionDistanceFromStartPointMm != intersections[i].IntersectionDistanceFromStartPointMm
+                 || cachedIntersections[i].IntersectionIncidenceAngleRad != intersections[i].IntersectionIncidenceAngleRad);
+    }
+    if (changed)
+    {
+      cachedIntersections.assign(intersections.begin(), intersections.end());
+    }
+    return changed;
+  }
+}
+
 //-----------------------------------------------------------------------------
 int vtkPlusUsSimulatorAlgo::RequestData(vtkInformation* request, vtkInformationVector** inputVector, vtkInformationVector* outputVector)
 {
@@ -130,12 +226,25 @@ int vtkPlusUsSimulatorAlgo::RequestData(vtkInformation* request, vtkInformationV
   }
   this->TransducerSpatialModel.SetImagingFrequencyMhz(this->FrequencyMhz);
 
-  vtkSmartPointer<vtkImageData> scanLines = vtkSmartPointer<vtkImageData>::New(); // image data containing the scanlines in rows (FM orientation)
-  scanLines->SetExtent(0, this->NumberOfSamplesPerScanline - 1, 0, this->NumberOfScanlines - 1, 0, 0);
-  scanLines->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
-
-  // Create BSPTree for fast scanline-model intersection computation
-  vtkSmartPointer<vtkPoints> scanLineIntersectionWithModel = vtkSmartPointer<vtkPoints>::New();
+  // Cached results cannot be reused if any simulation parameter has changed since the previous frame
+  PoseCacheData& cache = this->PoseCache;
+  std::vector<double> simulationParameters;
+  this->GetPoseCacheParameters(simulationParameters);
+  if (!this->PoseCaching || simulationParameters != cache.SimulationParameters)
+  {
+    cache.Valid = false;
+  }
+  if (!cache.Valid)
+  {
+    cache.SimulationParameters = simulationParameters;
+    cache.ScanLineKeys_Reference.assign(this->NumberOfScanlines * 6, 0);
+    cache.ScanLineKeys_Object.assign(this->SpatialModels.size(), std::vector<double>(this->NumberOfScanlines * 6, 0));
+    cache.ModelIntersections.assign(this->SpatialModels.size(), std::vector< std::vector<PlusSpatialModel::LineIntersectionInfo> >(this->NumberOfScanlines));
+    cache.ScanLines = vtkSmartPointer<vtkImageData>::New(); // image data containing the scanlines in rows (FM orientation)
+    cache.ScanLines->SetExtent(0, this->NumberOfSamplesPerScanline - 1, 0, this->NumberOfScanlines - 1, 0, 0);
+    cache.ScanLines->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  }
+  vtkImageData* scanLines = cache.ScanLines;
 
   vtkPlusUsScanConvert* scanConverter = this->RfProcessor->GetScanConverter();
   if (scanConverter == NULL)
@@ -153,12 +262,9 @@ int vtkPlusUsSimulatorAlgo::RequestData(vtkInformation* request, vtkInformationV
   double distanceBetweenScanlineSamplePointsMm = scanConverter->GetDistanceBetweenScanlineSamplePointsMm();
 
   // Initialize noise generator
-  vtkSmartPointer<vtkLineSource> noiseSamplerLine_Reference = vtkSmartPointer<vtkLineSource>::New();
   vtkSmartPointer<vtkPerlinNoise> noiseFunction = vtkSmartPointer<vtkPerlinNoise>::New();
-  double samplePointPosition_Reference[3] = {0, 0, 0};
   if (this->NoiseAmplitude > 0)
   {
-    noiseSamplerLine_Reference->SetResolution(this->NumberOfSamplesPerScanline - 1);
     noiseFunction->SetAmplitude(this->NoiseAmplitude);
     noiseFunction->SetFrequency(this->NoiseFrequency);
     noiseFunction->SetPhase(this->NoisePhase);
@@ -186,19 +292,11 @@ int vtkPlusUsSimulatorAlgo::RequestData(vtkInformation* request, vtkInformationV
   vtkSmartPointer<vtkMatrix4x4> referenceToImageMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   vtkMatrix4x4::Invert(imageToReferenceMatrix, referenceToImageMatrix);
 
-  // Create a few variables outside the loop to avoid reallocations and to make the code easier to read
-  vtkPoints* samplePointPositions_Reference = 0;
-  // Create a buffer outside the for loop to allow reusing it
-  std::vector<double> intensities;
-  // scanline start/end positions in Image and Reference coordinate systems
-  double scanLineStartPoint_Image[4] = {0, 0, 0, 1};
-  double scanLineEndPoint_Image[4] = {0, 0, 0, 1};
-  double scanLineStartPoint_Reference[4] = {0, 0, 0, 1};
-  double scanLineEndPoint_Reference[4] = {0, 0, 0, 1};
-
+  std::vector< vtkSmartPointer<vtkMatrix4x4> > referenceToObjectMatrices;
   for (std::vector<PlusSpatialModel>::iterator spatialModelIt = this->SpatialModels.begin(); spatialModelIt != this->SpatialModels.end(); ++spatialModelIt)
   {
     vtkSmartPointer<vtkMatrix4x4> referenceToObjectMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    referenceToObjectMatrices.push_back(referenceToObjectMatrix);
     if (!spatialModelIt->GetObjectCoordinateFrame().empty())
     {
       igsioTransformName referenceToObjectTransformName(this->GetReferenceCoordinateFrame(), spatialModelIt->GetObjectCoordinateFrame());
@@ -210,118 +308,390 @@ int vtkPlusUsSimulatorAlgo::RequestData(vtkInformation* request, vtkInformationV
       }
     }
     spatialModelIt->SetReferenceToObjectTransform(referenceToObjectMatrix);
+    // Load models and fill lookup tables now, so that the models are not modified while scanlines are simulated in parallel
+    spatialModelIt->PrepareForScanlineSimulation(distanceBetweenScanlineSamplePointsMm, this->NumberOfSamplesPerScanline);
+    if (this->LineIntersectionMethod == LINE_INTERSECTION_BVH && spatialModelIt->PrepareBoundingVolumeHierarchy() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to prepare " << spatialModelIt->GetName() << " SpatialModel for line intersection computation");
+      return 0;
+    }
   }
 
+  ScanlineSimulationJob job;
+  job.Self = this;
+  job.ScanLines = scanLines;
+  job.DistanceBetweenScanlineSamplePointsMm = distanceBetweenScanlineSamplePointsMm;
+  job.NoiseFunction = noiseFunction;
+  job.HashNoiseFunction.SetSeed(static_cast<unsigned int>(this->NoiseSeed));
+  job.HashNoiseFunction.SetAmplitude(this->NoiseAmplitude);
+  job.HashNoiseFunction.SetFrequency(this->NoiseFrequency);
+  job.HashNoiseFunction.SetPhase(this->NoisePhase);
+  job.NextScanLineBlockIndex = 0;
+  job.SimulationFailed = false;
+
+  // Scanline start/end positions are computed in advance, as the scan converter is not used concurrently
+  job.ScanLineStartPoints_Reference.resize(this->NumberOfScanlines * 3);
+  job.ScanLineEndPoints_Reference.resize(this->NumberOfScanlines * 3);
+  double scanLineStartPoint_Image[4] = {0, 0, 0, 1};
+  double scanLineEndPoint_Image[4] = {0, 0, 0, 1};
+  double scanLineStartPoint_Reference[4] = {0, 0, 0, 1};
+  double scanLineEndPoint_Reference[4] = {0, 0, 0, 1};
   for (int scanLineIndex = 0; scanLineIndex < this->NumberOfScanlines; scanLineIndex++)
   {
     scanConverter->GetScanLineEndPoints(scanLineIndex, scanLineStartPoint_Image, scanLineEndPoint_Image);
     imageToReferenceMatrix->MultiplyPoint(scanLineStartPoint_Image, scanLineStartPoint_Reference);
     imageToReferenceMatrix->MultiplyPoint(scanLineEndPoint_Image, scanLineEndPoint_Reference);
+    std::copy(scanLineStartPoint_Reference, scanLineStartPoint_Reference + 3, job.ScanLineStartPoints_Reference.begin() + scanLineIndex * 3);
+    std::copy(scanLineEndPoint_Reference, scanLineEndPoint_Reference + 3, job.ScanLineEndPoints_Reference.begin() + scanLineIndex * 3);
+  }
+
+  // Find the scanlines that moved relative to the Reference coordinate system (affects the noise) and relative to each model (affects the intersections)
+  job.ScanLineMoved_Reference.assign(this->NumberOfScanlines, 1);
+  job.ScanLineMoved_Object.assign(this->SpatialModels.size() * this->NumberOfScanlines, 1);
+  bool anyScanLineMoved = !cache.Valid;
+  for (int scanLineIndex = 0; scanLineIndex < this->NumberOfScanlines; scanLineIndex++)
+  {
+    const double* startPoint_Reference = &job.ScanLineStartPoints_Reference[scanLineIndex * 3];
+    const double* endPoint_Reference = &job.ScanLineEndPoints_Reference[scanLineIndex * 3];
+    bool moved = UpdateScanLineKey(startPoint_Reference, endPoint_Reference, NULL, this->PoseCacheToleranceMm, &cache.ScanLineKeys_Reference[scanLineIndex * 6]);
+    job.ScanLineMoved_Reference[scanLineIndex] = (moved || !cache.Valid);
+    for (unsigned int modelIndex = 0; modelIndex < this->SpatialModels.size(); modelIndex++)
+    {
+      moved = UpdateScanLineKey(startPoint_Reference, endPoint_Reference, referenceToObjectMatrices[modelIndex], this->PoseCacheToleranceMm, &cache.ScanLineKeys_Object[modelIndex][scanLineIndex * 6]);
+      job.ScanLineMoved_Object[modelIndex * this->NumberOfScanlines + scanLineIndex] = (moved || !cache.Valid);
+      anyScanLineMoved = anyScanLineMoved || moved;
+    }
+  }
 
-    if (this->NoiseAmplitude > 0)
+  vtkImageData* simulatedUsImage = vtkImageData::SafeDownCast(outInfo->Get(vtkDataObject::DATA_OBJECT()));
+  if (simulatedUsImage == NULL)
+  {
+    LOG_ERROR("vtkPlusUsSimulatorAlgo output type is invalid");
+    return 0;
+  }
+
+  if (!anyScanLineMoved && (this->NoiseAmplitude <= 0 || std::find(job.ScanLineMoved_Reference.begin(), job.ScanLineMoved_Reference.end(), 1) == job.ScanLineMoved_Reference.end()))
+  {
+    // Nothing has moved, the scan converter still holds the image of the previous frame
+    LOG_TRACE("Scanline positions have not changed, previous simulated image is reused");
+    this->NumberOfSimulatedScanlines = 0;
+    simulatedUsImage->ShallowCopy(this->RfProcessor->GetBrightnessScanConvertedImage());
+    return 1;
+  }
+
+  int numberOfScanLineBlocks = (this->NumberOfScanlines + NUMBER_OF_SCANLINES_PER_BLOCK - 1) / NUMBER_OF_SCANLINES_PER_BLOCK;
+  int numberOfThreads = (this->NumberOfThreads > 0) ? this->NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  numberOfThreads = std::max(1, std::min(numberOfThreads, std::min(numberOfScanLineBlocks, static_cast<int>(VTK_MAX_THREADS))));
+
+  // Prepare the workspaces. The first thread uses the cell locators of the models, the other threads need their own copy.
+  // The cell locators are not used if intersections are computed using the bounding volume hierarchy.
+  const bool useModelLocalizersOnly = (this->LineIntersectionMethod == LINE_INTERSECTION_BVH);
+  if (this->ScanlineSimulationWorkspaces.size() < static_cast<unsigned int>(numberOfThreads))
+  {
+    this->ScanlineSimulationWorkspaces.resize(numberOfThreads);
+  }
+  for (int threadId = 0; threadId < numberOfThreads; threadId++)
+  {
+    ScanlineSimulationWorkspace& workspace = this->ScanlineSimulationWorkspaces[threadId];
+    workspace.NumberOfSimulatedScanlines = 0;
+    workspace.LineIntersectionWorkspaces.resize(this->SpatialModels.size());
+    for (unsigned int modelIndex = 0; modelIndex < this->SpatialModels.size(); modelIndex++)
+    {
+      this->SpatialModels[modelIndex].PrepareLineIntersectionWorkspace(workspace.LineIntersectionWorkspaces[modelIndex], threadId == 0 || useModelLocalizersOnly);
+    }
+    if (this->NoiseAmplitude > 0 && this->NoiseGenerator == NOISE_GENERATOR_PERLIN && workspace.NoiseSamplerLine_Reference.GetPointer() == NULL)
+    {
+      workspace.NoiseSamplerLine_Reference = vtkSmartPointer<vtkLineSource>::New();
+    }
+    if (workspace.NoiseSamplerLine_Reference.GetPointer() != NULL)
     {
-      noiseSamplerLine_Reference->SetPoint1(scanLineStartPoint_Reference);
-      noiseSamplerLine_Reference->SetPoint2(scanLineEndPoint_Reference);
-      noiseSamplerLine_Reference->Update();
-      samplePointPositions_Reference = noiseSamplerLine_Reference->GetOutput()->GetPoints();
+      workspace.NoiseSamplerLine_Reference->SetResolution(this->NumberOfSamplesPerScanline - 1);
     }
+  }
 
-    // Get model intersection positions along the scanline for all the models
-    std::deque<PlusSpatialModel::LineIntersectionInfo> lineIntersectionsWithModels;
-    for (std::vector<PlusSpatialModel>::iterator spatialModelIt = this->SpatialModels.begin(); spatialModelIt != this->SpatialModels.end(); ++spatialModelIt)
+  if (numberOfThreads == 1)
+  {
+    for (int blockIndex = 0; blockIndex < numberOfScanLineBlocks && !job.SimulationFailed; blockIndex++)
     {
-      // Append line intersections found with this model to lineIntersectionsWithModels
-      spatialModelIt->GetLineIntersections(lineIntersectionsWithModels, scanLineStartPoint_Reference, scanLineEndPoint_Reference);
+      if (SimulateScanlineBlock(blockIndex, this->ScanlineSimulationWorkspaces[0], job) != PLUS_SUCCESS)
+      {
+        job.SimulationFailed = true;
+      }
     }
+  }
+  else
+  {
+    vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod((vtkThreadFunctionType)&SimulateScanlinesThread, &job);
+    threader->SingleMethodExecute();
+  }
 
-    ConvertLineModelIntersectionsToSegmentDescriptor(lineIntersectionsWithModels);
+  if (job.SimulationFailed)
+  {
+    // the cache may contain results of both the previous and the current frame
+    cache.Valid = false;
+    return 0;
+  }
+  cache.Valid = this->PoseCaching;
+
+  this->NumberOfSimulatedScanlines = 0;
+  for (int threadId = 0; threadId < numberOfThreads; threadId++)
+  {
+    this->NumberOfSimulatedScanlines += this->ScanlineSimulationWorkspaces[threadId].NumberOfSimulatedScanlines;
+  }
+  LOG_TRACE("Simulated " << this->NumberOfSimulatedScanlines << " of " << this->NumberOfScanlines << " scanlines");
 
-    int currentPixelIndex = 0;
-    int scanLineExtent[6] = {0, this->NumberOfSamplesPerScanline - 1, scanLineIndex, scanLineIndex, 0, 0};
-    unsigned char* dstPixelAddress = (unsigned char*)scanLines->GetScalarPointerForExtent(scanLineExtent);
-    double incomingBeamIntensity = this->IncomingIntensityMwPerCm2 * 1000;
-    int numIntersectionPoints = lineIntersectionsWithModels.size();
-    if (numIntersectionPoints < 1)
+  // Rows of the scanline image were written directly, the scan converter has to be notified
+  scanLines->Modified();
+  this->RfProcessor->SetRfFrame(scanLines, US_IMG_BRIGHTNESS);
+  simulatedUsImage->ShallowCopy(this->RfProcessor->GetBrightnessScanConvertedImage());
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void* vtkPlusUsSimulatorAlgo::SimulateScanlinesThread(vtkMultiThreader::ThreadInfo* data)
+{
+  ScanlineSimulationJob* job = static_cast<ScanlineSimulationJob*>(data->UserData);
+  ScanlineSimulationWorkspace& workspace = job->Self->ScanlineSimulationWorkspaces[data->ThreadID];
+  const int numberOfScanLines = job->Self->NumberOfScanlines;
+  for (int blockIndex = job->NextScanLineBlockIndex++; blockIndex * NUMBER_OF_SCANLINES_PER_BLOCK < numberOfScanLines; blockIndex = job->NextScanLineBlockIndex++)
+  {
+    if (job->SimulationFailed)
     {
-      LOG_ERROR("No intersections with any SpatialObjects. Probably no background object is specified.");
-      return 0;
+      return NULL;
+    }
+    if (job->Self->SimulateScanlineBlock(blockIndex, workspace, *job) != PLUS_SUCCESS)
+    {
+      job->SimulationFailed = true;
+      return NULL;
+    }
+  }
+  return NULL;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusUsSimulatorAlgo::SimulateScanlineBlock(int blockIndex, ScanlineSimulationWorkspace& workspace, const ScanlineSimulationJob& job)
+{
+  const int firstScanLineIndex = blockIndex * NUMBER_OF_SCANLINES_PER_BLOCK;
+  const int numberOfScanLinesInBlock = std::min(NUMBER_OF_SCANLINES_PER_BLOCK, this->NumberOfScanlines - firstScanLineIndex);
+
+  // A scanline has to be simulated if the noise samples or the intersections with any of the models have changed
+  bool scanLineChanged[NUMBER_OF_SCANLINES_PER_BLOCK] = {false};
+  for (int i = 0; i < numberOfScanLinesInBlock; i++)
+  {
+    scanLineChanged[i] = (this->NoiseAmplitude > 0 && job.ScanLineMoved_Reference[firstScanLineIndex + i]);
+  }
+
+  // Update the cached intersections of the scanlines that moved relative to the models
+  std::deque<PlusSpatialModel::LineIntersectionInfo>& modelLineIntersections = workspace.ModelLineIntersections;
+  for (unsigned int modelIndex = 0; modelIndex < this->SpatialModels.size(); modelIndex++)
+  {
+    const char* scanLineMoved = &job.ScanLineMoved_Object[modelIndex * this->NumberOfScanlines + firstScanLineIndex];
+    if (std::find(scanLineMoved, scanLineMoved + numberOfScanLinesInBlock, 1) == scanLineMoved + numberOfScanLinesInBlock)
+    {
+      // none of the scanlines of the block moved relative to this model
+      continue;
     }
-    PlusSpatialModel* previousModel = &this->TransducerSpatialModel;
-    for (vtkIdType intersectionIndex = 0; (intersectionIndex <= numIntersectionPoints) && (currentPixelIndex < this->NumberOfSamplesPerScanline); intersectionIndex++)
+    std::vector< std::vector<PlusSpatialModel::LineIntersectionInfo> >& cachedIntersections = this->PoseCache.ModelIntersections[modelIndex];
+    if (this->LineIntersectionMethod == LINE_INTERSECTION_BVH)
     {
-      // determine end of segment position and pixel color
-      int endOfSegmentPixelIndex = currentPixelIndex;
-      double distanceOfIntersectionPointFromScanLineStartPointMm = 0; // defined here to allow for access later on in code
-      if (intersectionIndex + 1 < numIntersectionPoints)
+      // Trace all scanlines of the block together
+      const PlusSpatialModel::LinePacketIntersections& packetIntersections = workspace.PacketIntersections;
+      this->SpatialModels[modelIndex].GetLinePacketIntersections(numberOfScanLinesInBlock, &job.ScanLineStartPoints_Reference[firstScanLineIndex * 3],
+          &job.ScanLineEndPoints_Reference[firstScanLineIndex * 3], workspace.PacketIntersections);
+      PlusSpatialModel::LineIntersectionInfo intersectionInfo;
+      intersectionInfo.Model = &this->SpatialModels[modelIndex];
+      for (int i = 0; i < numberOfScanLinesInBlock; i++)
       {
-        distanceOfIntersectionPointFromScanLineStartPointMm = lineIntersectionsWithModels[intersectionIndex + 1].IntersectionDistanceFromStartPointMm;
-        endOfSegmentPixelIndex = distanceOfIntersectionPointFromScanLineStartPointMm / distanceBetweenScanlineSamplePointsMm;
-        if (endOfSegmentPixelIndex > this->NumberOfSamplesPerScanline)
+        if (!scanLineMoved[i])
+        {
+          continue;
+        }
+        modelLineIntersections.clear();
+        for (int intersectionIndex = packetIntersections.FirstIntersectionIndex[i]; intersectionIndex < packetIntersections.FirstIntersectionIndex[i + 1]; intersectionIndex++)
         {
-          // the next intersection point is out of the image
-          endOfSegmentPixelIndex = this->NumberOfSamplesPerScanline;
+          intersectionInfo.IntersectionDistanceFromStartPointMm = packetIntersections.IntersectionDistanceFromStartPointMm[intersectionIndex];
+          intersectionInfo.IntersectionIncidenceAngleRad = packetIntersections.IntersectionIncidenceAngleRad[intersectionIndex];
+          modelLineIntersections.push_back(intersectionInfo);
+        }
+        if (UpdateCachedIntersections(cachedIntersections[firstScanLineIndex + i], modelLineIntersections))
+        {
+          scanLineChanged[i] = true;
         }
       }
-      else
+    }
+    else
+    {
+      for (int i = 0; i < numberOfScanLinesInBlock; i++)
       {
-        // last segment, after all the intersection points
-        endOfSegmentPixelIndex = this->NumberOfSamplesPerScanline;
+        if (!scanLineMoved[i])
+        {
+          continue;
+        }
+        const int scanLineIndex = firstScanLineIndex + i;
+        double scanLineStartPoint_Reference[3] = {0, 0, 0};
+        double scanLineEndPoint_Reference[3] = {0, 0, 0};
+        std::copy(job.ScanLineStartPoints_Reference.begin() + scanLineIndex * 3, job.ScanLineStartPoints_Reference.begin() + scanLineIndex * 3 + 3, scanLineStartPoint_Reference);
+        std::copy(job.ScanLineEndPoints_Reference.begin() + scanLineIndex * 3, job.ScanLineEndPoints_Reference.begin() + scanLineIndex * 3 + 3, scanLineEndPoint_Reference);
+        modelLineIntersections.clear();
+        this->SpatialModels[modelIndex].GetLineIntersections(modelLineIntersections, scanLineStartPoint_Reference, scanLineEndPoint_Reference, workspace.LineIntersectionWorkspaces[modelIndex]);
+        if (UpdateCachedIntersections(cachedIntersections[scanLineIndex], modelLineIntersections))
+        {
+          scanLineChanged[i] = true;
+        }
       }
+    }
+  }
 
-      int numberOfFilledPixels = endOfSegmentPixelIndex - currentPixelIndex;
-      if (numberOfFilledPixels < 1)
-      {
-        continue;
-      }
+  for (int i = 0; i < numberOfScanLinesInBlock; i++)
+  {
+    // If the cache was invalidated then the scanline image contains garbage, all the scanlines have to be simulated
+    if (!scanLineChanged[i] && this->PoseCache.Valid)
+    {
+      continue;
+    }
+    if (SimulateScanline(firstScanLineIndex + i, workspace, job) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    workspace.NumberOfSimulatedScanlines++;
+  }
+  return PLUS_SUCCESS;
+}
 
-      PlusSpatialModel* currentModel = NULL;
-      if (intersectionIndex < numIntersectionPoints)
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusUsSimulatorAlgo::SimulateScanline(int scanLineIndex, ScanlineSimulationWorkspace& workspace, const ScanlineSimulationJob& job)
+{
+  double scanLineStartPoint_Reference[3] = {0, 0, 0};
+  double scanLineEndPoint_Reference[3] = {0, 0, 0};
+  std::copy(job.ScanLineStartPoints_Reference.begin() + scanLineIndex * 3, job.ScanLineStartPoints_Reference.begin() + scanLineIndex * 3 + 3, scanLineStartPoint_Reference);
+  std::copy(job.ScanLineEndPoints_Reference.begin() + scanLineIndex * 3, job.ScanLineEndPoints_Reference.begin() + scanLineIndex * 3 + 3, scanLineEndPoint_Reference);
+  const double distanceBetweenScanlineSamplePointsMm = job.DistanceBetweenScanlineSamplePointsMm;
+
+  vtkPoints* samplePointPositions_Reference = 0;
+  double samplePointPosition_Reference[3] = {0, 0, 0};
+  const double* noiseValues = NULL;
+  if (this->NoiseAmplitude > 0 && this->NoiseGenerator == NOISE_GENERATOR_HASH)
+  {
+    // Noise is computed for all the samples of the scanline at once
+    double sampleStep_Reference[3] = {0, 0, 0};
+    if (this->NumberOfSamplesPerScanline > 1)
+    {
+      for (int i = 0; i < 3; i++)
       {
-        currentModel = lineIntersectionsWithModels[intersectionIndex].Model;
+        sampleStep_Reference[i] = (scanLineEndPoint_Reference[i] - scanLineStartPoint_Reference[i]) / (this->NumberOfSamplesPerScanline - 1);
       }
-      else
+    }
+    workspace.NoiseValues.resize(this->NumberOfSamplesPerScanline);
+    job.HashNoiseFunction.EvaluateLine(scanLineStartPoint_Reference, sampleStep_Reference, this->NumberOfSamplesPerScanline, &workspace.NoiseValues[0]);
+    noiseValues = &workspace.NoiseValues[0];
+  }
+  else if (this->NoiseAmplitude > 0)
+  {
+    workspace.NoiseSamplerLine_Reference->SetPoint1(scanLineStartPoint_Reference);
+    workspace.NoiseSamplerLine_Reference->SetPoint2(scanLineEndPoint_Reference);
+    workspace.NoiseSamplerLine_Reference->Update();
+    samplePointPositions_Reference = workspace.NoiseSamplerLine_Reference->GetOutput()->GetPoints();
+  }
+
+  // Get model intersection positions along the scanline for all the models (they have been already computed for the whole block)
+  std::deque<PlusSpatialModel::LineIntersectionInfo>& lineIntersectionsWithModels = workspace.LineIntersectionsWithModels;
+  lineIntersectionsWithModels.clear();
+  for (unsigned int modelIndex = 0; modelIndex < this->SpatialModels.size(); modelIndex++)
+  {
+    const std::vector<PlusSpatialModel::LineIntersectionInfo>& modelIntersections = this->PoseCache.ModelIntersections[modelIndex][scanLineIndex];
+    lineIntersectionsWithModels.insert(lineIntersectionsWithModels.end(), modelIntersections.begin(), modelIntersections.end());
+  }
+
+  ConvertLineModelIntersectionsToSegmentDescriptor(lineIntersectionsWithModels);
+
+  std::vector<double>& intensities = workspace.Intensities;
+  int currentPixelIndex = 0;
+  int scanLineExtent[6] = {0, this->NumberOfSamplesPerScanline - 1, scanLineIndex, scanLineIndex, 0, 0};
+  unsigned char* dstPixelAddress = (unsigned char*)job.ScanLines->GetScalarPointerForExtent(scanLineExtent);
+  double incomingBeamIntensity = this->IncomingIntensityMwPerCm2 * 1000;
+  int numIntersectionPoints = lineIntersectionsWithModels.size();
+  if (numIntersectionPoints < 1)
+  {
+    LOG_ERROR("No intersections with any SpatialObjects. Probably no background object is specified.");
+    return PLUS_FAIL;
+  }
+  PlusSpatialModel* previousModel = &this->TransducerSpatialModel;
+  for (vtkIdType intersectionIndex = 0; (intersectionIndex <= numIntersectionPoints) && (currentPixelIndex < this->NumberOfSamplesPerScanline); intersectionIndex++)
+  {
+    // determine end of segment position and pixel color
+    int endOfSegmentPixelIndex = currentPixelIndex;
+    double distanceOfIntersectionPointFromScanLineStartPointMm = 0; // defined here to allow for access later on in code
+    if (intersectionIndex + 1 < numIntersectionPoints)
+    {
+      distanceOfIntersectionPointFromScanLineStartPointMm = lineIntersectionsWithModels[intersectionIndex + 1].IntersectionDistanceFromStartPointMm;
+      endOfSegmentPixelIndex = distanceOfIntersectionPointFromScanLineStartPointMm / distanceBetweenScanlineSamplePointsMm;
+      if (endOfSegmentPixelIndex > this->NumberOfSamplesPerScanline)
       {
-        // the segment after the last intersection point is assumed to belong to the model of the last intersection
-        currentModel = lineIntersectionsWithModels[numIntersectionPoints - 1].Model;
+        // the next intersection point is out of the image
+        endOfSegmentPixelIndex = this->NumberOfSamplesPerScanline;
       }
+    }
+    else
+    {
+      // last segment, after all the intersection points
+      endOfSegmentPixelIndex = this->NumberOfSamplesPerScanline;
+    }
 
-      double outgoingBeamIntensity = 0;
-      currentModel->CalculateIntensity(intensities, numberOfFilledPixels, distanceBetweenScanlineSamplePointsMm, previousModel->GetAcousticImpedanceMegarayls(), incomingBeamIntensity, outgoingBeamIntensity, lineIntersectionsWithModels[intersectionIndex].IntersectionIncidenceAngleRad);
-      previousModel = currentModel;
+    int numberOfFilledPixels = endOfSegmentPixelIndex - currentPixelIndex;
+    if (numberOfFilledPixels < 1)
+    {
+      continue;
+    }
 
-      if (this->NoiseAmplitude > 0)
+    PlusSpatialModel* currentModel = NULL;
+    if (intersectionIndex < numIntersectionPoints)
+    {
+      currentModel = lineIntersectionsWithModels[intersectionIndex].Model;
+    }
+    else
+    {
+      // the segment after the last intersection point is assumed to belong to the model of the last intersection
+      currentModel = lineIntersectionsWithModels[numIntersectionPoints - 1].Model;
+    }
+
+    double outgoingBeamIntensity = 0;
+    currentModel->CalculateIntensity(intensities, numberOfFilledPixels, distanceBetweenScanlineSamplePointsMm, previousModel->GetAcousticImpedanceMegarayls(), incomingBeamIntensity, outgoingBeamIntensity, lineIntersectionsWithModels[intersectionIndex].IntersectionIncidenceAngleRad);
+    previousModel = currentModel;
+
+    if (noiseValues != NULL)
+    {
+      const double* segmentNoiseValues = noiseValues + currentPixelIndex;
+      for (int pixelIndex = 0; pixelIndex < numberOfFilledPixels; pixelIndex++)
       {
-        for (int pixelIndex = 0; pixelIndex < numberOfFilledPixels; pixelIndex++)
-        {
-          samplePointPositions_Reference->GetPoint(currentPixelIndex + pixelIndex, samplePointPosition_Reference);
-          double noise = noiseFunction->EvaluateFunction(samplePointPosition_Reference);
-          // Noise is multiplicative: NoisySignal = signal + noise * (signal-SignalMean) = signal*(1+noise) - noise*SignalMean;
-          (*dstPixelAddress++) = std::max(std::min(this->BrightnessConversionOffset + this->BrightnessConversionScale * fastPow(intensities[pixelIndex], this->BrightnessConversionGamma) + noise, 255.0), 0.0);
-        }
+        (*dstPixelAddress++) = std::max(std::min(this->BrightnessConversionOffset + this->BrightnessConversionScale * fastPow(intensities[pixelIndex], this->BrightnessConversionGamma) + segmentNoiseValues[pixelIndex], 255.0), 0.0);
       }
-      else
+    }
+    else if (this->NoiseAmplitude > 0)
+    {
+      for (int pixelIndex = 0; pixelIndex < numberOfFilledPixels; pixelIndex++)
       {
-        for (int pixelIndex = 0; pixelIndex < numberOfFilledPixels; pixelIndex++)
-        {
-          (*dstPixelAddress++) = std::max(std::min(this->BrightnessConversionOffset + this->BrightnessConversionScale * fastPow(intensities[pixelIndex], this->BrightnessConversionGamma), 255.0), 0.0);
-        }
+        samplePointPositions_Reference->GetPoint(currentPixelIndex + pixelIndex, samplePointPosition_Reference);
+        double noise = job.NoiseFunction->EvaluateFunction(samplePointPosition_Reference);
+        // Noise is multiplicative: NoisySignal = signal + noise * (signal-SignalMean) = signal*(1+noise) - noise*SignalMean;
+        (*dstPixelAddress++) = std::max(std::min(this->BrightnessConversionOffset + this->BrightnessConversionScale * fastPow(intensities[pixelIndex], this->BrightnessConversionGamma) + noise, 255.0), 0.0);
+      }
+    }
+    else
+    {
+      for (int pixelIndex = 0; pixelIndex < numberOfFilledPixels; pixelIndex++)
+      {
+        (*dstPixelAddress++) = std::max(std::min(this->BrightnessConversionOffset + this->BrightnessConversionScale * fastPow(intensities[pixelIndex], this->BrightnessConversionGamma), 255.0), 0.0);
       }
+    }
 
-      incomingBeamIntensity = outgoingBeamIntensity;
+    incomingBeamIntensity = outgoingBeamIntensity;
 
-      currentPixelIndex += numberOfFilledPixels;
-    }
+    currentPixelIndex += numberOfFilledPixels;
   }
 
-  vtkImageData* simulatedUsImage = vtkImageData::SafeDownCast(outInfo->Get(vtkDataObject::DATA_OBJECT()));
-  if (simulatedUsImage == NULL)
-  {
-    LOG_ERROR("vtkPlusUsSimulatorAlgo output type is invalid");
-    return 0;
-  }
-  this->RfProcessor->SetRfFrame(scanLines, US_IMG_BRIGHTNESS);
-  simulatedUsImage->DeepCopy(this->RfProcessor->GetBrightnessScanConvertedImage());
-  return 1;
+  return PLUS_SUCCESS;
 }
 
 bool lineIntersectionLessThan(PlusSpatialModel::LineIntersectionInfo a, PlusSpatialModel::LineIntersectionInfo b)
@@ -405,6 +775,16 @@ PlusStatus vtkPlusUsSimulatorAlgo::ReadConfiguration(vtkXMLDataElement* config)
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, NoiseAmplitude, usSimulatorAlgoElement);
   XML_READ_VECTOR_ATTRIBUTE_OPTIONAL(double, 3, NoiseFrequency, usSimulatorAlgoElement);
   XML_READ_VECTOR_ATTRIBUTE_OPTIONAL(double, 3, NoisePhase, usSimulatorAlgoElement);
+  XML_READ_ENUM2_ATTRIBUTE_OPTIONAL(NoiseGenerator, usSimulatorAlgoElement,
+    "PERLIN", NOISE_GENERATOR_PERLIN,
+    "HASH", NOISE_GENERATOR_HASH);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NoiseSeed, usSimulatorAlgoElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfThreads, usSimulatorAlgoElement);
+  XML_READ_ENUM2_ATTRIBUTE_OPTIONAL(LineIntersectionMethod, usSimulatorAlgoElement,
+    "BSP_TREE", LINE_INTERSECTION_BSP_TREE,
+    "BVH", LINE_INTERSECTION_BVH);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(PoseCaching, usSimulatorAlgoElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, PoseCacheToleranceMm, usSimulatorAlgoElement);
   XML_READ_CSTRING_ATTRIBUTE_REQUIRED(ImageCoordinateFrame, usSimulatorAlgoElement);
   XML_READ_CSTRING_ATTRIBUTE_REQUIRED(ReferenceCoordinateFrame, usSimulatorAlgoElement);
 
@@ -427,9 +807,42 @@ PlusStatus vtkPlusUsSimulatorAlgo::ReadConfiguration(vtkXMLDataElement* config)
     this->SpatialModels.push_back(model);
   }
 
+  // Cached intersections refer to the previous spatial models
+  this->InvalidatePoseCache();
+
   return PLUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+void vtkPlusUsSimulatorAlgo::InvalidatePoseCache()
+{
+  this->PoseCache.Valid = false;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusUsSimulatorAlgo::GetPoseCacheParameters(std::vector<double>& parameters)
+{
+  parameters.clear();
+  parameters.push_back(this->NumberOfScanlines);
+  parameters.push_back(this->NumberOfSamplesPerScanline);
+  parameters.push_back(this->IncomingIntensityMwPerCm2);
+  parameters.push_back(this->FrequencyMhz);
+  parameters.push_back(this->BrightnessConversionGamma);
+  parameters.push_back(this->BrightnessConversionOffset);
+  parameters.push_back(this->BrightnessConversionScale);
+  parameters.push_back(this->NoiseAmplitude);
+  parameters.insert(parameters.end(), this->NoiseFrequency, this->NoiseFrequency + 3);
+  parameters.insert(parameters.end(), this->NoisePhase, this->NoisePhase + 3);
+  parameters.push_back(this->NoiseGenerator);
+  parameters.push_back(this->NoiseSeed);
+  parameters.push_back(this->LineIntersectionMethod);
+  parameters.push_back(this->PoseCacheToleranceMm);
+  parameters.push_back(this->SpatialModels.size());
+  // Imaging depth and field of view are stored in the scan converter
+  vtkPlusUsScanConvert* scanConverter = this->RfProcessor->GetScanConverter();
+  parameters.push_back(scanConverter ? static_cast<double>(scanConverter->GetMTime()) : 0.0);
+}
+
 //-----------------------------------------------------------------------------
 PlusStatus vtkPlusUsSimulatorAlgo::GetFrameSize(FrameSizeType& frameSize)
 {
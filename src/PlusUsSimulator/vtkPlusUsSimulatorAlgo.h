@@ -10,10 +10,13 @@
 #include "vtkPlusUsSimulatorExport.h"
 
 #include "vtkImageAlgorithm.h"
+#include "vtkMultiThreader.h"
 
 #include "PlusSpatialModel.h"
 #include "vtkIGSIOTransformRepository.h"
 
+class vtkImageData;
+class vtkLineSource;
 class vtkPolyDataNormals;
 class vtkTriangleFilter;
 class vtkStripper;
@@ -28,6 +31,24 @@ class vtkPlusRfProcessor;
 class vtkPlusUsSimulatorExport vtkPlusUsSimulatorAlgo : public vtkImageAlgorithm
 {
 public:
+  /*! Method of computing intersections of scanlines with the spatial models */
+  enum LineIntersectionMethodType
+  {
+    /*! Each scanline is intersected with each model separately, using vtkModifiedBSPTree (reference implementation) */
+    LINE_INTERSECTION_BSP_TREE,
+    /*! Packets of neighbor scanlines are traced together through a bounding volume hierarchy of the model triangles */
+    LINE_INTERSECTION_BVH
+  };
+
+  /*! Generator of the noise that is added to the simulated pixels */
+  enum NoiseGeneratorType
+  {
+    /*! vtkPerlinNoise (reference implementation) */
+    NOISE_GENERATOR_PERLIN,
+    /*! PlusHashNoise: hash-based value noise, much faster and the pattern can be changed by NoiseSeed */
+    NOISE_GENERATOR_HASH
+  };
+
   vtkTypeMacro(vtkPlusUsSimulatorAlgo, vtkImageAlgorithm);
   void PrintSelf(ostream& os, vtkIndent indent);
   static vtkPlusUsSimulatorAlgo* New();
@@ -104,12 +125,108 @@ public:
   vtkSetVector3Macro(NoiseFrequency, double);
   vtkSetVector3Macro(NoisePhase, double);
 
+  /*! Set the noise generator */
+  vtkSetMacro(NoiseGenerator, NoiseGeneratorType);
+  /*! Get the noise generator */
+  vtkGetMacro(NoiseGenerator, NoiseGeneratorType);
+
+  /*! Set the seed of the noise pattern (only used by NOISE_GENERATOR_HASH). The same seed always generates the same noise. */
+  vtkSetMacro(NoiseSeed, int);
+  /*! Get the seed of the noise pattern */
+  vtkGetMacro(NoiseSeed, int);
+
+  /*! Set the number of threads that simulate scanlines in parallel. If 0 then the number of processors is used. */
+  vtkSetMacro(NumberOfThreads, int);
+  /*! Get the number of threads that simulate scanlines in parallel */
+  vtkGetMacro(NumberOfThreads, int);
+
+  /*! Set the method of computing scanline intersections with the spatial models */
+  vtkSetMacro(LineIntersectionMethod, LineIntersectionMethodType);
+  /*! Get the method of computing scanline intersections with the spatial models */
+  vtkGetMacro(LineIntersectionMethod, LineIntersectionMethodType);
+
+  /*!
+    Enable reusing simulation results of the previous frame. A scanline is simulated again only if it moved relative to
+    the Reference coordinate system or to any of the spatial models by more than PoseCacheToleranceMm. If nothing moved then
+    the previous output image is returned without any computation.
+  */
+  vtkSetMacro(PoseCaching, bool);
+  /*! Get if simulation results of the previous frame are reused */
+  vtkGetMacro(PoseCaching, bool);
+  vtkBooleanMacro(PoseCaching, bool);
+
+  /*!
+    Set the grid size (in mm) that scanline start and end points are quantized to when it is decided if a scanline moved.
+    If 0 then cached results are only reused if the scanline position is exactly the same.
+  */
+  vtkSetMacro(PoseCacheToleranceMm, double);
+  /*! Get the grid size (in mm) that scanline start and end points are quantized to when it is decided if a scanline moved */
+  vtkGetMacro(PoseCacheToleranceMm, double);
+
+  /*! Discard all the cached simulation results, the next frame is simulated from scratch */
+  void InvalidatePoseCache();
+
+  /*! Get the number of scanlines that were simulated for the last frame (the other scanlines were reused from the previous frame) */
+  vtkGetMacro(NumberOfSimulatedScanlines, int);
+
 protected:
+  /*! Temporary objects that a thread uses for simulating scanlines. Kept between frames to avoid reallocations. */
+  struct ScanlineSimulationWorkspace
+  {
+    /*! Intersections of the current scanline with all the spatial models */
+    std::deque<PlusSpatialModel::LineIntersectionInfo> LineIntersectionsWithModels;
+    /*! Intersections of the current scanline with one spatial model */
+    std::deque<PlusSpatialModel::LineIntersectionInfo> ModelLineIntersections;
+    /*! Reflected intensities of the current segment */
+    std::vector<double> Intensities;
+    /*! Line intersection workspaces, one for each spatial model */
+    std::vector<PlusSpatialModel::LineIntersectionWorkspace> LineIntersectionWorkspaces;
+    /*! Intersections of the current block of scanlines with one spatial model (only used with LINE_INTERSECTION_BVH) */
+    PlusSpatialModel::LinePacketIntersections PacketIntersections;
+    /*! Number of scanlines that this thread simulated in the current frame */
+    int NumberOfSimulatedScanlines;
+    /*! Generates sample point positions along the current scanline for noise computation (only used with NOISE_GENERATOR_PERLIN) */
+    vtkSmartPointer<vtkLineSource> NoiseSamplerLine_Reference;
+    /*! Noise values along the current scanline (only used with NOISE_GENERATOR_HASH) */
+    std::vector<double> NoiseValues;
+  };
+  struct ScanlineSimulationJob;
+
+  /*! Simulation results of the previous frame that can be reused if the scanlines do not move */
+  struct PoseCacheData
+  {
+    PoseCacheData() : Valid(false) {}
+    /*! If false then nothing can be reused, all scanlines have to be simulated */
+    bool Valid;
+    /*! Simulation parameters that the cached results were computed with (see GetPoseCacheParameters) */
+    std::vector<double> SimulationParameters;
+    /*! Quantized scanline start and end points in the Reference coordinate system (6 values per scanline) */
+    std::vector<double> ScanLineKeys_Reference;
+    /*! Quantized scanline start and end points in the Object coordinate system of each spatial model (6 values per scanline) */
+    std::vector< std::vector<double> > ScanLineKeys_Object;
+    /*! Intersections of each scanline with each spatial model, indexed by the model index then the scanline index */
+    std::vector< std::vector< std::vector<PlusSpatialModel::LineIntersectionInfo> > > ModelIntersections;
+    /*! Image data containing the scanlines in rows (FM orientation) */
+    vtkSmartPointer<vtkImageData> ScanLines;
+  };
+
+  /*! Thread function that simulates blocks of scanlines until all the scanlines are done */
+  static void* SimulateScanlinesThread(vtkMultiThreader::ThreadInfo* data);
+
+  /*! Simulate a block of neighbor scanlines */
+  PlusStatus SimulateScanlineBlock(int blockIndex, ScanlineSimulationWorkspace& workspace, const ScanlineSimulationJob& job);
+
+  /*! Compute pixel values of one scanline and write it to the corresponding row of the scanline image */
+  PlusStatus SimulateScanline(int scanLineIndex, ScanlineSimulationWorkspace& workspace, const ScanlineSimulationJob& job);
+
   virtual int FillOutputPortInformation(int port, vtkInformation* info);
   virtual int RequestData(vtkInformation* request,
                           vtkInformationVector** inputVector,
                           vtkInformationVector* outputVector);
 
+  /*! Get all the parameters that the simulated scanlines depend on, except the scanline positions */
+  void GetPoseCacheParameters(std::vector<double>& parameters);
+
   void ConvertLineModelIntersectionsToSegmentDescriptor(std::deque<PlusSpatialModel::LineIntersectionInfo>& lineIntersectionsWithModels);
 
 protected:
@@ -163,6 +280,29 @@ private:
   double NoiseAmplitude;
   double NoiseFrequency[3];
   double NoisePhase[3];
+  NoiseGeneratorType NoiseGenerator;
+  int NoiseSeed;
+
+  /*! Number of threads used for simulating scanlines. If 0 then the number of processors is used. */
+  int NumberOfThreads;
+
+  /*! Method of computing scanline intersections with the spatial models */
+  LineIntersectionMethodType LineIntersectionMethod;
+
+  /*! One workspace for each thread, indexed by the thread ID */
+  std::vector<ScanlineSimulationWorkspace> ScanlineSimulationWorkspaces;
+
+  /*! If enabled then simulation results of the previous frame are reused for scanlines that have not moved */
+  bool PoseCaching;
+
+  /*! Grid size (in mm) that scanline start and end points are quantized to when it is decided if a scanline moved */
+  double PoseCacheToleranceMm;
+
+  /*! Simulation results of the previous frame */
+  PoseCacheData PoseCache;
+
+  /*! Number of scanlines that were simulated for the last frame */
+  int NumberOfSimulatedScanlines;
 };
 
 #endif // __vtkPlusUsSimulatorAlgo_h
@@ -5,9 +5,11 @@
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusProfiler.h"
 #include "igsioTrackedFrame.h"
 #include "vtkImageData.h"
 #include "vtkMatrix4x4.h"
+#include "vtkPlusHTMLGenerator.h"
 #include "vtkIGSIOSequenceIO.h"
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkIGSIOTransformRepository.h"
@@ -36,6 +38,7 @@ int main(int argc, char* argv[])
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   bool disableCompression = false;
+  bool profileReport = false;
 
   vtksys::CommandLineArguments cmdargs;
   cmdargs.Initialize(argc, argv);
@@ -48,6 +51,7 @@ int main(int argc, char* argv[])
   cmdargs.AddArgument("--output-frame-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFrameFileName, "A filename that will be used for storing the tracked image frames. Each frame will be exported individually, with the proper position and orientation in the reference coordinate system");
   cmdargs.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
   cmdargs.AddArgument("--disable-compression", vtksys::CommandLineArguments::NO_ARGUMENT, &disableCompression, "Do not compress output image files.");
+  cmdargs.AddArgument("--profile-report", vtksys::CommandLineArguments::NO_ARGUMENT, &profileReport, "Write an HTML report of the processing time of the reconstruction stages into the output directory.");
   cmdargs.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
   cmdargs.AddArgument("--importance-mask-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &importanceMaskFileName, "The file to use as the importance mask.");
 
@@ -72,6 +76,7 @@ int main(int argc, char* argv[])
 
   // Set the log level
   vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+  PlusProfiler::SetEnabled(profileReport);
 
   // Deprecated arguments (2013-07-29, #800)
   if (!inputImageToReferenceTransformNameDeprecated.empty())
@@ -172,7 +177,12 @@ int main(int argc, char* argv[])
 
   LOG_INFO("Set volume output extent...");
   std::string errorDetail;
-  if (reconstructor->SetOutputExtentFromFrameList(trackedFrameList, transformRepository, errorDetail) != PLUS_SUCCESS)
+  PlusStatus outputExtentStatus(PLUS_FAIL);
+  {
+    PLUS_PROFILE_SCOPE("SetOutputExtent");
+    outputExtentStatus = reconstructor->SetOutputExtentFromFrameList(trackedFrameList, transformRepository, errorDetail);
+  }
+  if (outputExtentStatus != PLUS_SUCCESS)
   {
     LOG_ERROR("Failed to set output extent of volume!");
     return EXIT_FAILURE;
@@ -197,7 +207,12 @@ int main(int argc, char* argv[])
 
     // Insert slice for reconstruction
     bool insertedIntoVolume = false;
-    if (reconstructor->AddTrackedFrame(frame, transformRepository, &insertedIntoVolume) != PLUS_SUCCESS)
+    PlusStatus addFrameStatus(PLUS_FAIL);
+    {
+      PLUS_PROFILE_SCOPE("InsertFrame");
+      addFrameStatus = reconstructor->AddTrackedFrame(frame, transformRepository, &insertedIntoVolume);
+    }
+    if (addFrameStatus != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to add tracked frame to volume with frame #" << frameIndex);
       continue;
@@ -253,5 +268,14 @@ int main(int argc, char* argv[])
     reconstructor->SaveReconstructedVolumeToFile(outputVolumeAccumulationFileName, true, !disableCompression);
   }
 
+  if (profileReport)
+  {
+    vtkSmartPointer<vtkPlusHTMLGenerator> htmlGenerator = vtkSmartPointer<vtkPlusHTMLGenerator>::New();
+    htmlGenerator->SetTitle("Volume reconstruction performance profile");
+    htmlGenerator->SetBaseFilename("VolumeReconstructionProfile");
+    htmlGenerator->AddProfilerReport();
+    htmlGenerator->SaveHtmlPageAutoFilename();
+  }
+
   return EXIT_SUCCESS;
 }
@@ -6,6 +6,7 @@
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusProfiler.h"
 #include "vtkPlusSequenceIO.h"
 #include "vtkPlusVolumeReconstructor.h"
 
@@ -35,6 +36,7 @@ void vtkPlusVolumeReconstructor::PrintSelf(ostream& os, vtkIndent indent)
 //----------------------------------------------------------------------------
 igsioStatus vtkPlusVolumeReconstructor::SaveReconstructedVolumeToFile(const std::string& filename, bool accumulation/*=false*/, bool useCompression/*=true*/)
 {
+  PLUS_PROFILE_SCOPE("SaveVolume");
   vtkSmartPointer<vtkImageData> volumeToSave = vtkSmartPointer<vtkImageData>::New();
   if (accumulation)
   {
@@ -77,6 +79,7 @@ PlusStatus vtkPlusVolumeReconstructor::SaveReconstructedVolumeToFile(vtkImageDat
   image.SetImageType(US_IMG_BRIGHTNESS);
   frame.SetImageData(image);
   list->AddTrackedFrame(&frame);
+  PLUS_PROFILE_SCOPE("WriteVolumeFile");
   if (vtkPlusSequenceIO::Write(filename, list.GetPointer(), US_IMG_ORIENT_MF, useCompression) != PLUS_SUCCESS)
   {
     LOG_ERROR("Failed to save reconstructed volume in sequence metafile!");
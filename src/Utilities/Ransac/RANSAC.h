@@ -8,6 +8,7 @@
 #include <set>
 #include <vector>
 #include <limits>
+#include <random>
 
 // OS includes
 #include <stdlib.h>
@@ -82,6 +83,15 @@ namespace itk
     void SetNumberOfThreads(unsigned int numberOfThreads);
     unsigned int GetNumberOfThreads();
 
+    /**
+     * Set the seed of the random generator that selects the data subsets.
+     * By default the generator is seeded from the current time. With a fixed
+     * seed and a single thread the result is reproducible, and the random
+     * state is owned by this object, so separate instances can be used from
+     * different threads concurrently.
+     */
+    void SetRandomSeed(unsigned int seed);
+
     /**
      * Set the function object that is able to estimate the desired parametric
      * entity (e.g. PlaneParametersEstimator).
@@ -167,9 +177,19 @@ namespace itk
     static ITK_THREAD_RETURN_TYPE RANSACThreadCallback(void* arg);
 #endif
 
+    /**
+     * Return a random index in [0,maxIndex].
+     */
+    int GetRandomIndex(unsigned int maxIndex);
+
     //number of threads used in computing the RANSAC hypotheses
     unsigned int numberOfThreads;
 
+    //random generator used for subset selection if a seed is set
+    bool useRandomSeed;
+    unsigned int randomSeed;
+    std::minstd_rand randomGenerator;
+
     //the following variables are shared by all threads used in the RANSAC
     //computation
 
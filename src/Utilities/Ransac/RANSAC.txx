@@ -7,6 +7,8 @@ namespace itk
   RANSAC<T, S>::RANSAC()
   {
     this->numberOfThreads = 1;
+    this->useRandomSeed = false;
+    this->randomSeed = 0;
   }
 
 
@@ -40,6 +42,38 @@ namespace itk
   }
 
 
+  template<class T, class S>
+  void RANSAC<T, S>::SetRandomSeed(unsigned int seed)
+  {
+    this->useRandomSeed = true;
+    this->randomSeed = seed;
+  }
+
+
+  template<class T, class S>
+  int RANSAC<T, S>::GetRandomIndex(unsigned int maxIndex)
+  {
+    if (!this->useRandomSeed)
+    {
+      return (int)(((float)rand() / (float)RAND_MAX) * maxIndex + 0.5);
+    }
+    std::uniform_int_distribution<int> distribution(0, maxIndex);
+    if (this->numberOfThreads == 1)
+    {
+      return distribution(this->randomGenerator);
+    }
+#if ITK_VERSION_MAJOR >= 5
+    std::lock_guard<std::mutex> lock(this->hypothesisMutex);
+    return distribution(this->randomGenerator);
+#else
+    this->hypothesisMutex.Lock();
+    int selectedIndex = distribution(this->randomGenerator);
+    this->hypothesisMutex.Unlock();
+    return selectedIndex;
+#endif
+  }
+
+
   template<class T, class S>
   void RANSAC<T, S>::SetParametersEstimator(typename ParametersEstimator<T, S>::Pointer paramEstimator)
   {
@@ -101,20 +135,42 @@ namespace itk
     this->numerator = log(1.0 - desiredProbabilityForNoOutliers);
 
 
-    srand((unsigned)time(NULL));   //seed random number generator
+    if (this->useRandomSeed)
+    {
+      this->randomGenerator.seed(this->randomSeed);
+    }
+    else
+    {
+      srand((unsigned)time(NULL));   //seed random number generator
+    }
 
     //STEP2: create the threads that generate hypotheses and test
 
 #if ITK_VERSION_MAJOR >= 5
-    itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
-    threader->SetNumberOfWorkUnits(this->numberOfThreads);
+    typedef itk::MultiThreaderBase::WorkUnitInfo ThreadInfoType;
+#else
+    typedef itk::MultiThreader::ThreadInfoStruct ThreadInfoType;
+#endif
+    if (this->numberOfThreads == 1)
+    {
+      //run the hypotheses on the calling thread, no need for a threader
+      ThreadInfoType infoStruct;
+      infoStruct.UserData = this;
+      RANSAC<T, S>::RANSACThreadCallback(&infoStruct);
+    }
+    else
+    {
+#if ITK_VERSION_MAJOR >= 5
+      itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+      threader->SetNumberOfWorkUnits(this->numberOfThreads);
 #else
-    itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
-    threader->SetNumberOfThreads(this->numberOfThreads);
+      itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+      threader->SetNumberOfThreads(this->numberOfThreads);
 #endif
-    threader->SetSingleMethod(RANSAC<T, S>::RANSACThreadCallback, this);
-    //runs all threads and blocks till they finish
-    threader->SingleMethodExecute();
+      threader->SetSingleMethod(RANSAC<T, S>::RANSACThreadCallback, this);
+      //runs all threads and blocks till they finish
+      threader->SingleMethodExecute();
+    }
 
     //STEP3: least squares estimate using largest consensus set and cleanup
 
@@ -191,7 +247,7 @@ namespace itk
         for (unsigned int l = 0; l < numForEstimate; l++)
         {
           //selectedIndex is in [0,maxIndex]
-          int selectedIndex = (int)(((float)rand() / (float)RAND_MAX) * maxIndex + 0.5);
+          int selectedIndex = caller->GetRandomIndex(maxIndex);
           unsigned int k(0);
           int j(-1);
           for (; k < numDataObjects && j < selectedIndex; k++)